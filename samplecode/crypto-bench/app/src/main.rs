@@ -0,0 +1,234 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License..
+
+extern crate sgx_types;
+extern crate sgx_ucrypto;
+extern crate sgx_urts;
+use sgx_types::*;
+use sgx_ucrypto as ucrypto;
+use sgx_urts::SgxEnclave;
+
+use std::arch::x86_64::_rdtsc;
+
+static ENCLAVE_FILE: &'static str = "enclave.signed.so";
+
+// Keep in sync with BENCH_OP_* in enclave/src/lib.rs.
+const BENCH_OP_AES_GCM_ENCRYPT: u32 = 0;
+const BENCH_OP_SHA256: u32 = 1;
+const BENCH_OP_ECDSA_SIGN: u32 = 2;
+const BENCH_OP_ECDSA_VERIFY: u32 = 3;
+const BENCH_OP_SEAL: u32 = 4;
+const BENCH_OP_UNSEAL: u32 = 5;
+
+const SIZES: [usize; 5] = [64, 1024, 16 * 1024, 256 * 1024, 1024 * 1024];
+
+// Per-measurement work budget for throughput ops. Small sizes get many
+// iterations, so per-call setup (buffer fill, key schedule) amortizes
+// to noise and the fixed inputs keep runs comparable across machines.
+const TARGET_BYTES: usize = 16 * 1024 * 1024;
+const MIN_ITERS: u64 = 16;
+const MAX_ITERS: u64 = 65536;
+// ECDSA is per-operation, not per-byte; a fixed count keeps it fast.
+const ECDSA_ITERS: u64 = 300;
+const EMPTY_CALL_ROUNDS: u64 = 1000;
+
+extern {
+    fn bench_empty(eid: sgx_enclave_id_t, retval: *mut sgx_status_t) -> sgx_status_t;
+    fn bench_run(eid: sgx_enclave_id_t, retval: *mut sgx_status_t,
+                 op: u32, size: usize, iters: u64) -> sgx_status_t;
+}
+
+fn init_enclave() -> SgxResult<SgxEnclave> {
+    let mut launch_token: sgx_launch_token_t = [0; 1024];
+    let mut launch_token_updated: i32 = 0;
+    // call sgx_create_enclave to initialize an enclave instance
+    // Debug Support: set 2nd parameter to 1
+    let debug = 1;
+    let mut misc_attr = sgx_misc_attribute_t {secs_attr: sgx_attributes_t { flags:0, xfrm:0}, misc_select:0};
+    SgxEnclave::create(ENCLAVE_FILE,
+                       debug,
+                       &mut launch_token,
+                       &mut launch_token_updated,
+                       &mut misc_attr)
+}
+
+fn rdtsc() -> u64 {
+    unsafe { _rdtsc() }
+}
+
+fn throughput_iters(size: usize) -> u64 {
+    ((TARGET_BYTES / size) as u64).max(MIN_ITERS).min(MAX_ITERS)
+}
+
+/// Average cycles of a bare ecall round trip; subtracted from every
+/// trusted measurement so the numbers reflect the crypto, not the
+/// transition.
+fn measure_ecall_overhead(eid: sgx_enclave_id_t) -> u64 {
+    let mut retval = sgx_status_t::SGX_SUCCESS;
+    // warm up the code path before timing
+    for _ in 0..100 {
+        unsafe { bench_empty(eid, &mut retval) };
+    }
+    let start = rdtsc();
+    for _ in 0..EMPTY_CALL_ROUNDS {
+        unsafe { bench_empty(eid, &mut retval) };
+    }
+    (rdtsc() - start) / EMPTY_CALL_ROUNDS
+}
+
+/// Cycles per iteration of `op` over `size` bytes inside the enclave.
+fn measure_trusted(eid: sgx_enclave_id_t, overhead: u64, op: u32, size: usize, iters: u64) -> Option<u64> {
+    let mut retval = sgx_status_t::SGX_SUCCESS;
+    let start = rdtsc();
+    let status = unsafe { bench_run(eid, &mut retval, op, size, iters) };
+    let elapsed = rdtsc() - start;
+    if status != sgx_status_t::SGX_SUCCESS || retval != sgx_status_t::SGX_SUCCESS {
+        println!("[-] bench_run op={} size={} failed: {} / {}",
+                 op, size, status.as_str(), retval.as_str());
+        return None;
+    }
+    Some(elapsed.saturating_sub(overhead) / iters)
+}
+
+/// Cycles per iteration of the matching sgx_ucrypto operation, run in
+/// this process with the same fixed inputs. Sealing has no untrusted
+/// counterpart.
+fn measure_untrusted(op: u32, size: usize, iters: u64) -> Option<u64> {
+    let data = vec![0xA5u8; size];
+    match op {
+        BENCH_OP_AES_GCM_ENCRYPT => {
+            let key: sgx_aes_gcm_128bit_key_t = [0x42; SGX_AESGCM_KEY_SIZE];
+            let iv = [0x24u8; SGX_AESGCM_IV_SIZE];
+            let aad = [0u8; 16];
+            let mut dst = vec![0u8; size];
+            let mut mac = sgx_aes_gcm_128bit_tag_t::default();
+            let start = rdtsc();
+            for _ in 0..iters {
+                ucrypto::rsgx_rijndael128GCM_encrypt(&key, &data, &iv, &aad, &mut dst, &mut mac).ok()?;
+            }
+            Some((rdtsc() - start) / iters)
+        }
+        BENCH_OP_SHA256 => {
+            let start = rdtsc();
+            for _ in 0..iters {
+                ucrypto::rsgx_sha256_slice(&data).ok()?;
+            }
+            Some((rdtsc() - start) / iters)
+        }
+        BENCH_OP_ECDSA_SIGN => {
+            let ecc = ucrypto::SgxEccHandle::new();
+            ecc.open().ok()?;
+            let (private, _public) = ecc.create_key_pair().ok()?;
+            let start = rdtsc();
+            for _ in 0..iters {
+                ecc.ecdsa_sign_slice(&data, &private).ok()?;
+            }
+            Some((rdtsc() - start) / iters)
+        }
+        BENCH_OP_ECDSA_VERIFY => {
+            let ecc = ucrypto::SgxEccHandle::new();
+            ecc.open().ok()?;
+            let (private, public) = ecc.create_key_pair().ok()?;
+            let signature = ecc.ecdsa_sign_slice(&data, &private).ok()?;
+            let start = rdtsc();
+            for _ in 0..iters {
+                ecc.ecdsa_verify_slice(&data, &public, &signature).ok()?;
+            }
+            Some((rdtsc() - start) / iters)
+        }
+        _ => None,
+    }
+}
+
+fn fmt_per_byte(cycles: Option<u64>, size: usize) -> String {
+    match cycles {
+        Some(c) => format!("{:>12.3}", c as f64 / size as f64),
+        None => format!("{:>12}", "n/a"),
+    }
+}
+
+fn fmt_per_op(cycles: Option<u64>) -> String {
+    match cycles {
+        Some(c) => format!("{:>12}", c),
+        None => format!("{:>12}", "n/a"),
+    }
+}
+
+fn main() {
+    let enclave = match init_enclave() {
+        Ok(r) => {
+            println!("[+] Init Enclave Successful {}!", r.geteid());
+            r
+        },
+        Err(x) => {
+            println!("[-] Init Enclave Failed {}!", x.as_str());
+            return;
+        },
+    };
+    let eid = enclave.geteid();
+
+    let overhead = measure_ecall_overhead(eid);
+    println!("[+] Empty ecall round trip: {} cycles (subtracted below)", overhead);
+    println!();
+
+    let per_byte_ops: [(u32, &str); 4] = [
+        (BENCH_OP_AES_GCM_ENCRYPT, "aes-gcm-128-enc"),
+        (BENCH_OP_SHA256, "sha-256"),
+        (BENCH_OP_SEAL, "seal"),
+        (BENCH_OP_UNSEAL, "unseal"),
+    ];
+
+    println!("cycles/byte ({}..{} bytes, {}MB budget per cell)",
+             SIZES[0], SIZES[SIZES.len() - 1], TARGET_BYTES >> 20);
+    println!("{:<16} {:>10} {:>12} {:>12} {:>8}", "op", "size", "trusted", "untrusted", "ratio");
+    for &(op, name) in per_byte_ops.iter() {
+        for &size in SIZES.iter() {
+            let iters = throughput_iters(size);
+            let trusted = measure_trusted(eid, overhead, op, size, iters);
+            let untrusted = measure_untrusted(op, size, iters);
+            let ratio = match (trusted, untrusted) {
+                (Some(t), Some(u)) if u > 0 => format!("{:>8.2}", t as f64 / u as f64),
+                _ => format!("{:>8}", "-"),
+            };
+            println!("{:<16} {:>10} {} {} {}",
+                     name, size, fmt_per_byte(trusted, size), fmt_per_byte(untrusted, size), ratio);
+        }
+    }
+    println!();
+
+    let per_op_ops: [(u32, &str); 2] = [
+        (BENCH_OP_ECDSA_SIGN, "ecdsa-p256-sign"),
+        (BENCH_OP_ECDSA_VERIFY, "ecdsa-p256-verify"),
+    ];
+
+    println!("cycles/op ({} ops per cell, hashing of the payload included)", ECDSA_ITERS);
+    println!("{:<18} {:>10} {:>12} {:>12} {:>8}", "op", "size", "trusted", "untrusted", "ratio");
+    for &(op, name) in per_op_ops.iter() {
+        for &size in SIZES.iter() {
+            let trusted = measure_trusted(eid, overhead, op, size, ECDSA_ITERS);
+            let untrusted = measure_untrusted(op, size, ECDSA_ITERS);
+            let ratio = match (trusted, untrusted) {
+                (Some(t), Some(u)) if u > 0 => format!("{:>8.2}", t as f64 / u as f64),
+                _ => format!("{:>8}", "-"),
+            };
+            println!("{:<18} {:>10} {} {} {}",
+                     name, size, fmt_per_op(trusted), fmt_per_op(untrusted), ratio);
+        }
+    }
+
+    enclave.destroy();
+}
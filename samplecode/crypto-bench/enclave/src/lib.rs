@@ -0,0 +1,132 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License..
+
+#![crate_name = "cryptobenchenclave"]
+#![crate_type = "staticlib"]
+#![cfg_attr(not(target_env = "sgx"), no_std)]
+#![cfg_attr(target_env = "sgx", feature(rustc_private))]
+
+extern crate sgx_tcrypto;
+extern crate sgx_tseal;
+extern crate sgx_types;
+#[cfg(not(target_env = "sgx"))]
+#[macro_use]
+extern crate sgx_tstd as std;
+
+use sgx_tcrypto::*;
+use sgx_tseal::SgxSealedData;
+use sgx_types::*;
+use std::vec::Vec;
+
+// Keep in sync with BENCH_OP_* in app/src/main.rs.
+const BENCH_OP_AES_GCM_ENCRYPT: u32 = 0;
+const BENCH_OP_SHA256: u32 = 1;
+const BENCH_OP_ECDSA_SIGN: u32 = 2;
+const BENCH_OP_ECDSA_VERIFY: u32 = 3;
+const BENCH_OP_SEAL: u32 = 4;
+const BENCH_OP_UNSEAL: u32 = 5;
+
+/// An empty round trip. The app times this to learn the bare
+/// ecall/oret transition cost and subtracts it from every measurement.
+#[no_mangle]
+pub extern "C" fn bench_empty() -> sgx_status_t {
+    sgx_status_t::SGX_SUCCESS
+}
+
+/// Runs `iters` iterations of `op` over a `size`-byte working set.
+///
+/// The working set and any keys are set up once per call, inside the
+/// ecall; the app amortizes that by choosing `iters` large and dividing
+/// by the iteration count, so the loop body is the only thing that
+/// matters. Inputs are fixed constants so runs are comparable across
+/// machines and SDK releases.
+#[no_mangle]
+pub extern "C" fn bench_run(op: u32, size: usize, iters: u64) -> sgx_status_t {
+    let data = vec![0xA5u8; size];
+    let result = match op {
+        BENCH_OP_AES_GCM_ENCRYPT => bench_aes_gcm_encrypt(&data, iters),
+        BENCH_OP_SHA256 => bench_sha256(&data, iters),
+        BENCH_OP_ECDSA_SIGN => bench_ecdsa_sign(&data, iters),
+        BENCH_OP_ECDSA_VERIFY => bench_ecdsa_verify(&data, iters),
+        BENCH_OP_SEAL => bench_seal(&data, iters),
+        BENCH_OP_UNSEAL => bench_unseal(&data, iters),
+        _ => Err(sgx_status_t::SGX_ERROR_INVALID_PARAMETER),
+    };
+    match result {
+        Ok(_) => sgx_status_t::SGX_SUCCESS,
+        Err(e) => e,
+    }
+}
+
+fn bench_aes_gcm_encrypt(data: &[u8], iters: u64) -> SgxError {
+    let key: sgx_aes_gcm_128bit_key_t = [0x42; SGX_AESGCM_KEY_SIZE];
+    let iv = [0x24u8; SGX_AESGCM_IV_SIZE];
+    let aad = [0u8; 16];
+    let mut dst: Vec<u8> = vec![0; data.len()];
+    let mut mac = sgx_aes_gcm_128bit_tag_t::default();
+    for _ in 0..iters {
+        rsgx_rijndael128GCM_encrypt(&key, data, &iv, &aad, &mut dst, &mut mac)?;
+    }
+    Ok(())
+}
+
+fn bench_sha256(data: &[u8], iters: u64) -> SgxError {
+    for _ in 0..iters {
+        rsgx_sha256_slice(data)?;
+    }
+    Ok(())
+}
+
+fn bench_ecdsa_sign(data: &[u8], iters: u64) -> SgxError {
+    let ecc = SgxEccHandle::new();
+    ecc.open()?;
+    let (private, _public) = ecc.create_key_pair()?;
+    for _ in 0..iters {
+        ecc.ecdsa_sign_slice(data, &private)?;
+    }
+    ecc.close()
+}
+
+fn bench_ecdsa_verify(data: &[u8], iters: u64) -> SgxError {
+    let ecc = SgxEccHandle::new();
+    ecc.open()?;
+    let (private, public) = ecc.create_key_pair()?;
+    let signature = ecc.ecdsa_sign_slice(data, &private)?;
+    for _ in 0..iters {
+        if !ecc.ecdsa_verify_slice(data, &public, &signature)? {
+            return Err(sgx_status_t::SGX_ERROR_UNEXPECTED);
+        }
+    }
+    ecc.close()
+}
+
+fn bench_seal(data: &[u8], iters: u64) -> SgxError {
+    let aad = [0u8; 16];
+    for _ in 0..iters {
+        SgxSealedData::<[u8]>::seal_data(&aad, data)?;
+    }
+    Ok(())
+}
+
+fn bench_unseal(data: &[u8], iters: u64) -> SgxError {
+    let aad = [0u8; 16];
+    let sealed = SgxSealedData::<[u8]>::seal_data(&aad, data)?;
+    for _ in 0..iters {
+        sealed.unseal_data()?;
+    }
+    Ok(())
+}
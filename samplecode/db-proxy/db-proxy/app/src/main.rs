@@ -22,9 +22,46 @@ use sgx_urts::SgxEnclave;
 
 static ENCLAVE_FILE: &'static str = "enclave.signed.so";
 
+use std::ffi::CString;
+
 extern {
     fn say_something(eid: sgx_enclave_id_t, retval: *mut sgx_status_t,
                      some_string: *const u8, len: usize) -> sgx_status_t;
+    fn proxy_open_session(eid: sgx_enclave_id_t, retval: *mut usize) -> sgx_status_t;
+    fn proxy_close_session(eid: sgx_enclave_id_t, retval: *mut sgx_status_t,
+                           session_id: usize) -> sgx_status_t;
+    fn proxy_query(eid: sgx_enclave_id_t, retval: *mut sgx_status_t,
+                   session_id: usize, query: *const c_char,
+                   result: *mut u8, result_capacity: usize,
+                   result_len: *mut usize) -> sgx_status_t;
+    fn proxy_print_stats(eid: sgx_enclave_id_t, retval: *mut sgx_status_t) -> sgx_status_t;
+}
+
+fn run_query(eid: sgx_enclave_id_t, session_id: usize, query: &str) {
+    let mut retval = sgx_status_t::SGX_SUCCESS;
+    let mut result = vec![0u8; 256];
+    let mut result_len: usize = 0;
+    let c_query = CString::new(query).unwrap();
+
+    let status = unsafe {
+        proxy_query(eid,
+                    &mut retval,
+                    session_id,
+                    c_query.as_ptr(),
+                    result.as_mut_ptr(),
+                    result.len(),
+                    &mut result_len)
+    };
+    if status != sgx_status_t::SGX_SUCCESS {
+        println!("[-] ECALL Enclave Failed {}!", status.as_str());
+        return;
+    }
+
+    let payload = String::from_utf8_lossy(&result[..result_len]);
+    match retval {
+        sgx_status_t::SGX_SUCCESS => println!("session {} | {} => ok {}", session_id, query, payload),
+        _ => println!("session {} | {} => err {}", session_id, query, payload),
+    }
 }
 
 fn init_enclave() -> SgxResult<SgxEnclave> {
@@ -76,5 +113,38 @@ fn main() {
 
     println!("[+] say_something success...");
 
+    // Several client sessions multiplexed over the enclave's backend
+    // pool; the same statement shapes repeat so the parse cache should
+    // serve nearly every lookup.
+    let mut sessions = Vec::new();
+    for _ in 0..3 {
+        let mut session_id: usize = 0;
+        let status = unsafe { proxy_open_session(enclave.geteid(), &mut session_id) };
+        if status != sgx_status_t::SGX_SUCCESS {
+            println!("[-] ECALL Enclave Failed {}!", status.as_str());
+            return;
+        }
+        sessions.push(session_id);
+    }
+
+    for round in 0..4 {
+        for &session_id in sessions.iter() {
+            let key = format!("key-{}-{}", session_id, round);
+            run_query(enclave.geteid(), session_id, &format!("INSERT {} value-{}", key, round));
+            run_query(enclave.geteid(), session_id, &format!("GET {}", key));
+            run_query(enclave.geteid(), session_id, &format!("PUT {} value-{}x", key, round));
+            run_query(enclave.geteid(), session_id, &format!("DELETE {}", key));
+        }
+    }
+
+    let mut retval = sgx_status_t::SGX_SUCCESS;
+    let _ = unsafe { proxy_print_stats(enclave.geteid(), &mut retval) };
+
+    for &session_id in sessions.iter() {
+        let _ = unsafe { proxy_close_session(enclave.geteid(), &mut retval, session_id) };
+    }
+
+    println!("[+] proxy queries success...");
+
     enclave.destroy();
 }
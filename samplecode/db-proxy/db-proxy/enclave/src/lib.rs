@@ -31,6 +31,10 @@ use std::string::String;
 use std::vec::Vec;
 use std::io::{self, Write};
 use std::slice;
+use std::ffi::CStr;
+use std::os::raw::c_char;
+
+mod proxy;
 
 #[no_mangle]
 pub extern "C" fn say_something(some_string: *const u8, some_len: usize) -> sgx_status_t {
@@ -60,5 +64,58 @@ pub extern "C" fn say_something(some_string: *const u8, some_len: usize) -> sgx_
     // Ocall to normal world for output
     println!("{}", &hello_string);
 
+    sgx_status_t::SGX_SUCCESS
+}
+
+/// Open a client session on the proxy. Session and pool state live in
+/// enclave globals and survive across ECALLs.
+#[no_mangle]
+pub extern "C" fn proxy_open_session() -> usize {
+    proxy::proxy_core().open_session()
+}
+
+#[no_mangle]
+pub extern "C" fn proxy_close_session(session_id: usize) -> sgx_status_t {
+    if proxy::proxy_core().close_session(session_id) {
+        sgx_status_t::SGX_SUCCESS
+    } else {
+        sgx_status_t::SGX_ERROR_INVALID_PARAMETER
+    }
+}
+
+/// Execute one textual query ("GET k", "PUT k v", "INSERT k v",
+/// "DELETE k") for a session. The result (or error text) is copied
+/// into the caller's buffer and its length stored in result_len.
+#[no_mangle]
+pub extern "C" fn proxy_query(session_id: usize,
+                              query: *const c_char,
+                              result: *mut u8,
+                              result_capacity: usize,
+                              result_len: *mut usize) -> sgx_status_t {
+    if query.is_null() || result.is_null() || result_len.is_null() {
+        return sgx_status_t::SGX_ERROR_INVALID_PARAMETER;
+    }
+
+    let query = match unsafe { CStr::from_ptr(query).to_str() } {
+        Ok(q) => q,
+        Err(_) => return sgx_status_t::SGX_ERROR_INVALID_PARAMETER,
+    };
+
+    let (payload, status) = match proxy::proxy_core().query(session_id, query) {
+        Ok(data) => (data, sgx_status_t::SGX_SUCCESS),
+        Err(info) => (info, sgx_status_t::SGX_ERROR_UNEXPECTED),
+    };
+
+    let n = payload.len().min(result_capacity);
+    let out = unsafe { slice::from_raw_parts_mut(result, n) };
+    out.copy_from_slice(&payload.as_bytes()[..n]);
+    unsafe { *result_len = n };
+    status
+}
+
+/// Print statement-cache and backend dispatch counters.
+#[no_mangle]
+pub extern "C" fn proxy_print_stats() -> sgx_status_t {
+    proxy::proxy_core().print_stats();
     sgx_status_t::SGX_SUCCESS
 }
\ No newline at end of file
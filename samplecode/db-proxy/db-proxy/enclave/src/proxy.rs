@@ -0,0 +1,266 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License..
+
+//! Query proxy core: prepared-statement cache plus backend
+//! multiplexing.
+//!
+//! Queries arrive as text ("GET k" / "PUT k v" / "INSERT k v" /
+//! "DELETE k"). Instead of re-parsing every query, the proxy
+//! fingerprints the query template (literals stripped) and caches the
+//! parsed form, so a workload that repeats the same handful of
+//! statement shapes parses each shape once. Client sessions do not own
+//! a backend: every query is dispatched onto one of a small fixed set
+//! of backend sessions, so N client sessions share M backend
+//! connections instead of holding one each.
+//!
+//! The sample has no networked database, so a backend session here
+//! fronts an in-enclave store; against a real backend the checkout and
+//! dispatch logic is unchanged, only Backend::execute would write to a
+//! socket.
+
+use std::collections::HashMap;
+use std::string::{String, ToString};
+use std::sync::atomic::{AtomicUsize, Ordering};
+use std::sync::{Arc, Once, SgxMutex, SgxRwLock};
+use std::vec::Vec;
+
+/// Backend sessions shared by all client sessions.
+const BACKEND_COUNT: usize = 4;
+
+#[derive(Clone, Copy, PartialEq, Debug)]
+pub enum Verb {
+    Get,
+    Put,
+    Insert,
+    Delete,
+}
+
+/// The parsed, reusable form of one query shape.
+struct PreparedStatement {
+    verb: Verb,
+    argc: usize,
+    hits: u64,
+}
+
+struct StatementCache {
+    stmts: SgxMutex<HashMap<u64, PreparedStatement>>,
+    misses: AtomicUsize,
+    lookups: AtomicUsize,
+}
+
+/// FNV-1a over the query template: the verb and the argument count,
+/// not the argument values, so "GET db" and "GET dba" share one entry.
+fn fingerprint(verb: &str, argc: usize) -> u64 {
+    let mut hash: u64 = 0xcbf2_9ce4_8422_2325;
+    for byte in verb.as_bytes().iter().chain(&[argc as u8]) {
+        hash ^= *byte as u64;
+        hash = hash.wrapping_mul(0x0100_0000_01b3);
+    }
+    hash
+}
+
+impl StatementCache {
+    fn new() -> StatementCache {
+        StatementCache {
+            stmts: SgxMutex::new(HashMap::new()),
+            misses: AtomicUsize::new(0),
+            lookups: AtomicUsize::new(0),
+        }
+    }
+
+    /// Resolve the verb for a query shape, parsing it only on the
+    /// first sighting of that shape.
+    fn prepare(&self, verb_text: &str, argc: usize) -> Result<Verb, String> {
+        self.lookups.fetch_add(1, Ordering::Relaxed);
+        let key = fingerprint(verb_text, argc);
+
+        let mut stmts = self.stmts.lock().unwrap();
+        if let Some(stmt) = stmts.get_mut(&key) {
+            if stmt.argc == argc {
+                stmt.hits += 1;
+                return Ok(stmt.verb);
+            }
+        }
+
+        self.misses.fetch_add(1, Ordering::Relaxed);
+        let verb = match verb_text.to_uppercase().as_str() {
+            "GET" if argc == 1 => Verb::Get,
+            "PUT" if argc == 2 => Verb::Put,
+            "INSERT" if argc == 2 => Verb::Insert,
+            "DELETE" if argc == 1 => Verb::Delete,
+            _ => return Err(format!("unknown statement: {} /{}", verb_text, argc)),
+        };
+        stmts.insert(
+            key,
+            PreparedStatement {
+                verb,
+                argc,
+                hits: 0,
+            },
+        );
+        Ok(verb)
+    }
+}
+
+/// One backend session. All sessions share the store the way pooled
+/// connections share one database server.
+struct Backend {
+    store: Arc<SgxRwLock<HashMap<String, String>>>,
+    executed: u64,
+}
+
+impl Backend {
+    fn execute(&mut self, verb: Verb, args: &[&str]) -> Result<String, String> {
+        self.executed += 1;
+        match verb {
+            Verb::Get => {
+                let store = self.store.read().unwrap();
+                store
+                    .get(args[0])
+                    .cloned()
+                    .ok_or_else(|| format!("key not found: {}", args[0]))
+            }
+            Verb::Put => {
+                let mut store = self.store.write().unwrap();
+                if !store.contains_key(args[0]) {
+                    return Err(format!("key not found: {}", args[0]));
+                }
+                store.insert(args[0].to_string(), args[1].to_string());
+                Ok(String::new())
+            }
+            Verb::Insert => {
+                let mut store = self.store.write().unwrap();
+                if store.contains_key(args[0]) {
+                    return Err(format!("key exists: {}", args[0]));
+                }
+                store.insert(args[0].to_string(), args[1].to_string());
+                Ok(String::new())
+            }
+            Verb::Delete => {
+                let mut store = self.store.write().unwrap();
+                store
+                    .remove(args[0])
+                    .map(|_| String::new())
+                    .ok_or_else(|| format!("key not found: {}", args[0]))
+            }
+        }
+    }
+}
+
+struct Session {
+    queries: u64,
+}
+
+pub struct ProxyCore {
+    backends: Vec<SgxMutex<Backend>>,
+    next_backend: AtomicUsize,
+    sessions: SgxMutex<HashMap<usize, Session>>,
+    next_session: AtomicUsize,
+    stmt_cache: StatementCache,
+}
+
+impl ProxyCore {
+    fn new() -> ProxyCore {
+        let store = Arc::new(SgxRwLock::new(HashMap::new()));
+        let backends = (0..BACKEND_COUNT)
+            .map(|_| {
+                SgxMutex::new(Backend {
+                    store: store.clone(),
+                    executed: 0,
+                })
+            })
+            .collect();
+        ProxyCore {
+            backends,
+            next_backend: AtomicUsize::new(0),
+            sessions: SgxMutex::new(HashMap::new()),
+            next_session: AtomicUsize::new(0),
+            stmt_cache: StatementCache::new(),
+        }
+    }
+
+    pub fn open_session(&self) -> usize {
+        let id = self.next_session.fetch_add(1, Ordering::SeqCst);
+        self.sessions
+            .lock()
+            .unwrap()
+            .insert(id, Session { queries: 0 });
+        id
+    }
+
+    pub fn close_session(&self, id: usize) -> bool {
+        self.sessions.lock().unwrap().remove(&id).is_some()
+    }
+
+    /// Dispatch one query for a session. Backends are picked round
+    /// robin, skipping busy ones so a slow query on one backend does
+    /// not stall the others.
+    pub fn query(&self, session_id: usize, query: &str) -> Result<String, String> {
+        match self.sessions.lock().unwrap().get_mut(&session_id) {
+            Some(session) => session.queries += 1,
+            None => return Err(format!("no such session: {}", session_id)),
+        }
+
+        let tokens: Vec<&str> = query.split_whitespace().collect();
+        if tokens.is_empty() {
+            return Err("empty query".to_string());
+        }
+        let args = &tokens[1..];
+        let verb = self.stmt_cache.prepare(tokens[0], args.len())?;
+
+        let start = self.next_backend.fetch_add(1, Ordering::Relaxed);
+        for i in 0..self.backends.len() {
+            let backend = &self.backends[(start + i) % self.backends.len()];
+            if let Ok(mut backend) = backend.try_lock() {
+                return backend.execute(verb, args);
+            }
+        }
+        // all busy: queue on the round-robin choice
+        let mut backend = self.backends[start % self.backends.len()].lock().unwrap();
+        backend.execute(verb, args)
+    }
+
+    pub fn print_stats(&self) {
+        let lookups = self.stmt_cache.lookups.load(Ordering::Relaxed);
+        let misses = self.stmt_cache.misses.load(Ordering::Relaxed);
+        println!(
+            "statement cache: {} lookups, {} parses ({} served from cache)",
+            lookups,
+            misses,
+            lookups - misses
+        );
+        for (i, backend) in self.backends.iter().enumerate() {
+            println!("backend {}: {} queries", i, backend.lock().unwrap().executed);
+        }
+        println!(
+            "sessions open: {}",
+            self.sessions.lock().unwrap().len()
+        );
+    }
+}
+
+static PROXY_INIT: Once = Once::new();
+static mut PROXY_CORE: Option<ProxyCore> = None;
+
+pub fn proxy_core() -> &'static ProxyCore {
+    unsafe {
+        PROXY_INIT.call_once(|| {
+            PROXY_CORE = Some(ProxyCore::new());
+        });
+        PROXY_CORE.as_ref().unwrap()
+    }
+}
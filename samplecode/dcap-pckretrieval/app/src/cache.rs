@@ -0,0 +1,193 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License..
+
+// Sealed on-disk cache for generated quotes.
+//
+// Quote generation pulls PCK certs and collateral through the quote
+// provider library, which costs hundreds of milliseconds per run. A
+// service that re-attests frequently can reuse a recent quote instead:
+// entries are keyed by the report data they attest to, sealed by the
+// enclave (MRSIGNER policy) before touching disk, and refreshed once
+// their TTL expires.
+//
+// Entry layout: 8-byte big-endian unix timestamp of creation, 4-byte
+// big-endian sealed blob length, then the sealed blob.
+
+use sgx_types::*;
+use std::fs;
+use std::io::{Read, Write};
+use std::path::{Path, PathBuf};
+use std::time::{Duration, SystemTime, UNIX_EPOCH};
+
+extern "C" {
+    fn enclave_seal_cache_entry(
+        eid: sgx_enclave_id_t,
+        retval: *mut u32,
+        data: *const u8,
+        data_len: u32,
+        sealed_log: *mut u8,
+        sealed_log_capacity: u32,
+        sealed_log_len: *mut u32,
+    ) -> sgx_status_t;
+    fn enclave_unseal_cache_entry(
+        eid: sgx_enclave_id_t,
+        retval: *mut u32,
+        sealed_log: *mut u8,
+        sealed_log_len: u32,
+        data: *mut u8,
+        data_capacity: u32,
+        data_len: *mut u32,
+    ) -> sgx_status_t;
+}
+
+// Room for the sgx_sealed_data_t header and MAC on top of the payload.
+const SEALED_OVERHEAD: usize = 1024;
+
+pub struct QuoteCache {
+    dir: PathBuf,
+}
+
+impl QuoteCache {
+    pub fn new<P: AsRef<Path>>(dir: P) -> std::io::Result<QuoteCache> {
+        fs::create_dir_all(dir.as_ref())?;
+        Ok(QuoteCache {
+            dir: dir.as_ref().to_path_buf(),
+        })
+    }
+
+    /// Cache key for a quote over `report_data`: the hex of the 64
+    /// bytes, so quotes attesting to different data never collide.
+    pub fn key_for_report_data(report_data: &sgx_report_data_t) -> String {
+        let mut key = String::with_capacity(report_data.d.len() * 2);
+        for byte in report_data.d.iter() {
+            key.push_str(&format!("{:02x}", byte));
+        }
+        key
+    }
+
+    fn entry_path(&self, key: &str) -> PathBuf {
+        self.dir.join(format!("{}.quote", key))
+    }
+
+    /// Returns the cached quote for `key` if one exists, unseals, and is
+    /// younger than `ttl`; expired or unreadable entries are removed so
+    /// the caller regenerates and re-stores.
+    pub fn load(&self, eid: sgx_enclave_id_t, key: &str, ttl: Duration) -> Option<Vec<u8>> {
+        let path = self.entry_path(key);
+        let entry = match self.read_entry(&path) {
+            Some(x) => x,
+            None => {
+                let _ = fs::remove_file(&path);
+                return None;
+            }
+        };
+        let (created, mut sealed) = entry;
+
+        let now = SystemTime::now()
+            .duration_since(UNIX_EPOCH)
+            .ok()?
+            .as_secs();
+        if now < created || now - created > ttl.as_secs() {
+            let _ = fs::remove_file(&path);
+            return None;
+        }
+
+        // the plaintext is strictly smaller than the sealed blob
+        let mut quote: Vec<u8> = vec![0; sealed.len()];
+        let mut quote_len: u32 = 0;
+        let mut retval: u32 = 0;
+        let status = unsafe {
+            enclave_unseal_cache_entry(
+                eid,
+                &mut retval,
+                sealed.as_mut_ptr(),
+                sealed.len() as u32,
+                quote.as_mut_ptr(),
+                quote.len() as u32,
+                &mut quote_len,
+            )
+        };
+        if status != sgx_status_t::SGX_SUCCESS || retval != sgx_status_t::SGX_SUCCESS as u32 {
+            let _ = fs::remove_file(&path);
+            return None;
+        }
+
+        quote.truncate(quote_len as usize);
+        Some(quote)
+    }
+
+    /// Seals `quote` inside the enclave and writes the entry atomically;
+    /// a failure leaves no partial entry behind.
+    pub fn store(&self, eid: sgx_enclave_id_t, key: &str, quote: &[u8]) -> bool {
+        let mut sealed: Vec<u8> = vec![0; quote.len() + SEALED_OVERHEAD];
+        let mut sealed_len: u32 = 0;
+        let mut retval: u32 = 0;
+        let status = unsafe {
+            enclave_seal_cache_entry(
+                eid,
+                &mut retval,
+                quote.as_ptr(),
+                quote.len() as u32,
+                sealed.as_mut_ptr(),
+                sealed.len() as u32,
+                &mut sealed_len,
+            )
+        };
+        if status != sgx_status_t::SGX_SUCCESS || retval != sgx_status_t::SGX_SUCCESS as u32 {
+            return false;
+        }
+        sealed.truncate(sealed_len as usize);
+
+        let now = match SystemTime::now().duration_since(UNIX_EPOCH) {
+            Ok(x) => x.as_secs(),
+            Err(_) => return false,
+        };
+
+        let path = self.entry_path(key);
+        let tmp = self.dir.join(format!("{}.quote.tmp", key));
+        let written = fs::File::create(&tmp)
+            .and_then(|mut file| {
+                file.write_all(&now.to_be_bytes())?;
+                file.write_all(&(sealed.len() as u32).to_be_bytes())?;
+                file.write_all(&sealed)
+            })
+            .and_then(|_| fs::rename(&tmp, &path));
+        if written.is_err() {
+            let _ = fs::remove_file(&tmp);
+            return false;
+        }
+        true
+    }
+
+    fn read_entry(&self, path: &Path) -> Option<(u64, Vec<u8>)> {
+        let mut file = fs::File::open(path).ok()?;
+        let mut header = [0_u8; 12];
+        file.read_exact(&mut header).ok()?;
+
+        let mut created_bytes = [0_u8; 8];
+        created_bytes.copy_from_slice(&header[0..8]);
+        let created = u64::from_be_bytes(created_bytes);
+
+        let mut len_bytes = [0_u8; 4];
+        len_bytes.copy_from_slice(&header[8..12]);
+        let sealed_len = u32::from_be_bytes(len_bytes) as usize;
+
+        let mut sealed: Vec<u8> = vec![0; sealed_len];
+        file.read_exact(&mut sealed).ok()?;
+        Some((created, sealed))
+    }
+}
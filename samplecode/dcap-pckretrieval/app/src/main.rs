@@ -25,7 +25,15 @@ use itertools::*;
 use sgx_types::*;
 use sgx_urts::SgxEnclave;
 
+mod cache;
+use cache::QuoteCache;
+
 static ENCLAVE_FILE: &'static str = "enclave.signed.so";
+static QUOTE_CACHE_DIR: &'static str = "./quote_cache";
+// Collateral is refreshed by the provider at day granularity; one hour
+// keeps re-attesting services off the network without holding a stale
+// TCB level for long. Override with QUOTE_CACHE_TTL_SECS.
+const DEFAULT_CACHE_TTL_SECS: u64 = 3600;
 
 extern "C" {
     fn enclave_create_report(
@@ -55,9 +63,37 @@ fn init_enclave() -> SgxResult<SgxEnclave> {
     )
 }
 
+fn cache_ttl() -> std::time::Duration {
+    let secs = std::env::var("QUOTE_CACHE_TTL_SECS")
+        .ok()
+        .and_then(|v| v.parse::<u64>().ok())
+        .unwrap_or(DEFAULT_CACHE_TTL_SECS);
+    std::time::Duration::from_secs(secs)
+}
+
 fn main() {
-    // quote holds the generated quote
-    let quote: Vec<u8> = generate_quote().unwrap();
+    let enclave = init_enclave().expect("init_enclave failed");
+
+    // the report attests to empty report data (see enclave_create_report)
+    let report_data = sgx_report_data_t::default();
+    let key = QuoteCache::key_for_report_data(&report_data);
+    let cache = QuoteCache::new(QUOTE_CACHE_DIR).expect("cannot create quote cache dir");
+
+    // quote holds the generated quote; a fresh cached quote skips the
+    // collateral fetch and quote generation entirely
+    let quote: Vec<u8> = match cache.load(enclave.geteid(), &key, cache_ttl()) {
+        Some(quote) => {
+            println!("Reusing cached quote ({} bytes)", quote.len());
+            quote
+        }
+        None => {
+            let quote = generate_quote(&enclave).unwrap();
+            if !cache.store(enclave.geteid(), &key, &quote) {
+                println!("Warning: failed to cache generated quote");
+            }
+            quote
+        }
+    };
 
     // this quote has type `sgx_quote3_t` and is structured as:
     // sgx_quote3_t {
@@ -152,7 +188,7 @@ fn main() {
 
 // Re-invent App/utility.cpp
 // int generate_quote(uint8_t **quote_buffer, uint32_t& quote_size)
-fn generate_quote() -> Option<Vec<u8>> {
+fn generate_quote(enclave: &SgxEnclave) -> Option<Vec<u8>> {
     let mut ti: sgx_target_info_t = sgx_target_info_t::default();
 
     let _l = unsafe { libloading::Library::new("./libdcap_quoteprov.so.1").unwrap() };
@@ -182,7 +218,7 @@ fn generate_quote() -> Option<Vec<u8>> {
     //println!("quote = {:?}", v);
 
     println!("succeed!\nStep2: Call create_app_report:");
-    let app_report: sgx_report_t = if let Some(r) = create_app_enclave_report(&ti) {
+    let app_report: sgx_report_t = if let Some(r) = create_app_enclave_report(enclave, &ti) {
         println!("succeed! \nStep3: Call sgx_qe_get_quote_size:");
         r
     } else {
@@ -220,13 +256,10 @@ fn generate_quote() -> Option<Vec<u8>> {
     Some(quote_vec)
 }
 
-fn create_app_enclave_report(qe_ti: &sgx_target_info_t) -> Option<sgx_report_t> {
-    let enclave = if let Ok(r) = init_enclave() {
-        r
-    } else {
-        return None;
-    };
-
+fn create_app_enclave_report(
+    enclave: &SgxEnclave,
+    qe_ti: &sgx_target_info_t,
+) -> Option<sgx_report_t> {
     let mut retval = 0;
     let mut ret_report: sgx_report_t = sgx_report_t::default();
 
@@ -245,6 +278,5 @@ fn create_app_enclave_report(qe_ti: &sgx_target_info_t) -> Option<sgx_report_t>
             return None;
         }
     }
-    enclave.destroy();
     Some(ret_report)
 }
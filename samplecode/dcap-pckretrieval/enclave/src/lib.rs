@@ -23,12 +23,15 @@
 
 extern crate sgx_types;
 extern crate sgx_tse;
+extern crate sgx_tseal;
 #[cfg(not(target_env = "sgx"))]
 #[macro_use]
 extern crate sgx_tstd as std;
 
+use std::slice;
 use sgx_types::*;
 use sgx_tse::rsgx_create_report;
+use sgx_tseal::SgxSealedData;
 
 #[no_mangle]
 pub extern "C" fn enclave_create_report(
@@ -46,3 +49,83 @@ pub extern "C" fn enclave_create_report(
         }
     }
 }
+
+// Seals `data` for the quote cache kept by the untrusted side. Only this
+// enclave (same MRSIGNER) can unseal the blob again, so cached quotes and
+// collateral never sit on disk in the clear.
+#[no_mangle]
+pub extern "C" fn enclave_seal_cache_entry(
+    data: *const u8,
+    data_len: u32,
+    sealed_log: *mut u8,
+    sealed_log_capacity: u32,
+    sealed_log_len: *mut u32,
+) -> u32 {
+    if data.is_null() || sealed_log.is_null() || sealed_log_len.is_null() {
+        return sgx_status_t::SGX_ERROR_INVALID_PARAMETER as u32;
+    }
+
+    let raw_size = SgxSealedData::<[u8]>::calc_raw_sealed_data_size(0, data_len);
+    if raw_size == u32::max_value() || raw_size > sealed_log_capacity {
+        return sgx_status_t::SGX_ERROR_INVALID_PARAMETER as u32;
+    }
+
+    let plain = unsafe { slice::from_raw_parts(data, data_len as usize) };
+    let aad: [u8; 0] = [0_u8; 0];
+    let sealed_data = match SgxSealedData::<[u8]>::seal_data(&aad, plain) {
+        Ok(x) => x,
+        Err(ret) => return ret as u32,
+    };
+
+    let opt = unsafe {
+        sealed_data.to_raw_sealed_data_t(sealed_log as *mut sgx_sealed_data_t, sealed_log_capacity)
+    };
+    if opt.is_none() {
+        return sgx_status_t::SGX_ERROR_INVALID_PARAMETER as u32;
+    }
+    unsafe { *sealed_log_len = raw_size; }
+
+    sgx_status_t::SGX_SUCCESS as u32
+}
+
+// Unseals a cache entry previously produced by enclave_seal_cache_entry.
+// The plaintext is never larger than the sealed blob, so a buffer of the
+// sealed size is always a sufficient capacity.
+#[no_mangle]
+pub extern "C" fn enclave_unseal_cache_entry(
+    sealed_log: *mut u8,
+    sealed_log_len: u32,
+    data: *mut u8,
+    data_capacity: u32,
+    data_len: *mut u32,
+) -> u32 {
+    if sealed_log.is_null() || data.is_null() || data_len.is_null() {
+        return sgx_status_t::SGX_ERROR_INVALID_PARAMETER as u32;
+    }
+
+    let sealed_data = match unsafe {
+        SgxSealedData::<[u8]>::from_raw_sealed_data_t(
+            sealed_log as *mut sgx_sealed_data_t,
+            sealed_log_len,
+        )
+    } {
+        Some(x) => x,
+        None => return sgx_status_t::SGX_ERROR_INVALID_PARAMETER as u32,
+    };
+
+    let unsealed_data = match sealed_data.unseal_data() {
+        Ok(x) => x,
+        Err(ret) => return ret as u32,
+    };
+
+    let plain = unsealed_data.get_decrypt_txt();
+    if plain.len() > data_capacity as usize {
+        return sgx_status_t::SGX_ERROR_INVALID_PARAMETER as u32;
+    }
+    unsafe {
+        core::ptr::copy_nonoverlapping(plain.as_ptr(), data, plain.len());
+        *data_len = plain.len() as u32;
+    }
+
+    sgx_status_t::SGX_SUCCESS as u32
+}
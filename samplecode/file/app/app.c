@@ -181,6 +181,14 @@ int SGX_CDECL main(int argc, char *argv[])
    }
    printf("read_file success ...\n");
 
+    /* 16K nodes of 4K = 64MB streamed through O_DIRECT */
+    sgx_ret = write_direct_log(global_eid, &ret, 16384);
+    if(sgx_ret != SGX_SUCCESS) {
+       print_error_message(sgx_ret);
+       return -1;
+   }
+   printf("write_direct_log %s ...\n", ret == 0 ? "success" : "failed");
+
     /* Destroy the enclave */
     sgx_destroy_enclave(global_eid);
 
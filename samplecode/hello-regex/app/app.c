@@ -182,6 +182,53 @@ int SGX_CDECL main(int argc, char *argv[])
 
     printf("[+] test regex success ...\n");
 
+    /* Precompiled path: compile the same pattern to a DFA outside the
+     * enclave and hand the enclave the serialized tables plus their
+     * digest. The digest here stands in for a trusted provisioning
+     * channel (sealed storage, attested delivery); the enclave
+     * re-hashes and bounds-checks the blob before executing it. */
+    {
+        uint8_t *blob = NULL;
+        size_t blob_len = 0;
+        uint8_t digest[32];
+
+        if (dfa_compile("\\d{4}-\\d{2}-\\d{2}", &blob, &blob_len) != 0) {
+            printf("[-] dfa_compile failed\n");
+            return -1;
+        }
+        dfa_sha256(blob, blob_len, digest);
+
+        sgx_ret = test_precompiled_dfa(global_eid, &enclave_ret,
+                                       blob, blob_len, digest);
+        free(blob);
+
+        if(sgx_ret != SGX_SUCCESS) {
+            print_error_message(sgx_ret);
+            return -1;
+        }
+
+        if(enclave_ret != SGX_SUCCESS) {
+            print_error_message(enclave_ret);
+            return -1;
+        }
+
+        printf("[+] test precompiled dfa success ...\n");
+    }
+
+    sgx_ret = test_literal_prefilter(global_eid, &enclave_ret);
+
+    if(sgx_ret != SGX_SUCCESS) {
+        print_error_message(sgx_ret);
+        return -1;
+    }
+
+    if(enclave_ret != SGX_SUCCESS) {
+        print_error_message(enclave_ret);
+        return -1;
+    }
+
+    printf("[+] test literal prefilter success ...\n");
+
     /* Destroy the enclave */
     sgx_destroy_enclave(global_eid);
 
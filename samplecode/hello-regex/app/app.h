@@ -42,6 +42,9 @@ extern sgx_enclave_id_t global_eid;    /* global enclave id */
 extern "C" {
 #endif
 
+/* dfa_compile.c: untrusted regex-to-DFA precompiler */
+int dfa_compile(const char *pattern, uint8_t **out_blob, size_t *out_len);
+void dfa_sha256(const uint8_t *data, size_t len, uint8_t out[32]);
 
 #if defined(__cplusplus)
 }
@@ -0,0 +1,126 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License..
+
+//! Verified loader and matcher for precompiled DFAs.
+//!
+//! The untrusted side compiles patterns to serialized transition
+//! tables (`app/dfa_compile.c` documents the format); the enclave's
+//! job shrinks to checking the blob's digest against the provisioned
+//! one, bounds-checking every transition once at load, and running a
+//! table walk per input byte. No regex compiler in the trusted image,
+//! no compile time at startup - and a malformed or tampered blob is
+//! rejected before a single transition executes.
+
+use std::vec::Vec;
+
+const DFA_MAGIC: &[u8; 4] = b"SDFA";
+const DFA_VERSION: u32 = 1;
+const DFA_DEAD: u16 = 0xFFFF;
+const HEADER_SIZE: usize = 16;
+
+/// A validated view over a serialized DFA blob.
+pub struct Dfa<'a> {
+    nstates: usize,
+    start: u16,
+    accept: &'a [u8],
+    table: &'a [u8],
+}
+
+fn read_u32(blob: &[u8], at: usize) -> u32 {
+    u32::from_le_bytes([blob[at], blob[at + 1], blob[at + 2], blob[at + 3]])
+}
+
+impl<'a> Dfa<'a> {
+    /// Parses and fully validates a serialized DFA. Every transition
+    /// is checked to land in a real state or the dead state, so the
+    /// matcher needs no per-byte bounds checks beyond the table index.
+    pub fn load(blob: &'a [u8]) -> Result<Dfa<'a>, &'static str> {
+        if blob.len() < HEADER_SIZE || &blob[..4] != DFA_MAGIC {
+            return Err("bad magic");
+        }
+        if read_u32(blob, 4) != DFA_VERSION {
+            return Err("unsupported version");
+        }
+        let nstates = read_u32(blob, 8) as usize;
+        let start = read_u32(blob, 12);
+        if nstates == 0 || nstates >= DFA_DEAD as usize || start as usize >= nstates {
+            return Err("bad state count or start");
+        }
+        let expect = HEADER_SIZE + nstates + nstates * 256 * 2;
+        if blob.len() != expect {
+            return Err("bad length");
+        }
+
+        let accept = &blob[HEADER_SIZE..HEADER_SIZE + nstates];
+        let table = &blob[HEADER_SIZE + nstates..];
+        for i in 0..nstates * 256 {
+            let next = u16::from_le_bytes([table[i * 2], table[i * 2 + 1]]);
+            if next != DFA_DEAD && next as usize >= nstates {
+                return Err("transition out of range");
+            }
+        }
+
+        Ok(Dfa {
+            nstates,
+            start: start as u16,
+            accept,
+            table,
+        })
+    }
+
+    pub fn state_count(&self) -> usize {
+        self.nstates
+    }
+
+    #[inline]
+    fn next(&self, state: u16, byte: u8) -> u16 {
+        let i = (state as usize * 256 + byte as usize) * 2;
+        u16::from_le_bytes([self.table[i], self.table[i + 1]])
+    }
+
+    /// Leftmost-longest, non-overlapping matches over `haystack` as
+    /// (start, end) byte ranges.
+    pub fn find_iter(&self, haystack: &[u8]) -> Vec<(usize, usize)> {
+        let mut matches = Vec::new();
+        let mut pos = 0;
+        while pos < haystack.len() {
+            let mut state = self.start;
+            let mut end = if self.accept[state as usize] != 0 {
+                Some(pos)
+            } else {
+                None
+            };
+            for (i, &byte) in haystack[pos..].iter().enumerate() {
+                state = self.next(state, byte);
+                if state == DFA_DEAD {
+                    break;
+                }
+                if self.accept[state as usize] != 0 {
+                    end = Some(pos + i + 1);
+                }
+            }
+            match end {
+                Some(end) if end > pos => {
+                    matches.push((pos, end));
+                    pos = end;
+                }
+                _ => pos += 1,
+            }
+        }
+        matches
+    }
+}
@@ -28,7 +28,16 @@ extern crate sgx_tstd as std;
 use sgx_types::*;
 
 extern crate regex;
+extern crate sgx_tcrypto;
+extern crate sgx_trts;
 use regex::Regex;
+use sgx_tcrypto::rsgx_sha256_slice;
+use std::slice;
+
+mod dfa;
+mod prefilter;
+use dfa::Dfa;
+use prefilter::LiteralPrefilter;
 
 /// A function simply test regex lib
 ///
@@ -55,3 +64,93 @@ pub extern "C" fn test_regex() -> sgx_status_t {
 
     sgx_status_t::SGX_SUCCESS
 }
+
+/// Loads a DFA precompiled by the untrusted side, after checking the
+/// blob's SHA-256 against the provisioned digest and validating the
+/// tables, then runs it over the sample text.
+///
+/// # Return value
+///
+/// SGX_SUCCESS on match, an error status on a tampered or malformed
+/// blob
+#[no_mangle]
+pub extern "C" fn test_precompiled_dfa(
+    blob: *const u8,
+    blob_len: usize,
+    expected_hash: *const u8,
+) -> sgx_status_t {
+    const TO_SEARCH: &'static str = "
+        On 2010-03-14, foo happened. On 2014-10-14, bar happened.
+        ";
+
+    if blob.is_null() || blob_len == 0 || expected_hash.is_null() {
+        return sgx_status_t::SGX_ERROR_INVALID_PARAMETER;
+    }
+    // the EDL [in] attributes copied both buffers into the enclave, so
+    // hash, validation and execution all see the same bytes
+    let blob = unsafe { slice::from_raw_parts(blob, blob_len) };
+    let expected = unsafe { slice::from_raw_parts(expected_hash, SGX_SHA256_HASH_SIZE) };
+
+    let digest = match rsgx_sha256_slice(blob) {
+        Ok(digest) => digest,
+        Err(status) => return status,
+    };
+    if digest[..] != *expected {
+        println!("[-] dfa blob digest mismatch");
+        return sgx_status_t::SGX_ERROR_MAC_MISMATCH;
+    }
+
+    let dfa = match Dfa::load(blob) {
+        Ok(dfa) => dfa,
+        Err(reason) => {
+            println!("[-] dfa blob rejected: {}", reason);
+            return sgx_status_t::SGX_ERROR_INVALID_PARAMETER;
+        }
+    };
+    println!("loaded precompiled dfa: {} states, no in-enclave compile", dfa.state_count());
+
+    for (start, end) in dfa.find_iter(TO_SEARCH.as_bytes()) {
+        println!("date: {}", &TO_SEARCH[start..end]);
+    }
+
+    sgx_status_t::SGX_SUCCESS
+}
+
+/// Runs the Teddy-style multi-literal prefilter over the sample text:
+/// the full regex engine is consulted only at confirmed literal hits,
+/// which is the shape a high-volume scanning enclave wants.
+///
+/// # Return value
+///
+/// Always returns SGX_SUCCESS
+#[no_mangle]
+pub extern "C" fn test_literal_prefilter() -> sgx_status_t {
+    const TO_SEARCH: &'static str = "
+        On 2010-03-14, foo happened. On 2014-10-14, bar happened.
+        ";
+    // anchoring literals of the rules; prefixes of the date pattern
+    // plus two keywords
+    const LITERALS: &[&[u8]] = &[b"2010", b"2014", b"foo", b"bar"];
+
+    let filter = match LiteralPrefilter::new(LITERALS) {
+        Ok(filter) => filter,
+        Err(reason) => {
+            println!("[-] prefilter rejected literal set: {}", reason);
+            return sgx_status_t::SGX_ERROR_INVALID_PARAMETER;
+        }
+    };
+
+    let re = Regex::new(r"(\d{4})-(\d{2})-(\d{2})").unwrap();
+    for (pos, index) in filter.scan(TO_SEARCH.as_bytes()) {
+        let literal = core::str::from_utf8(LITERALS[index]).unwrap();
+        // fall back to the regex engine only at the hit, anchored there
+        match re.find_at(TO_SEARCH, pos) {
+            Some(found) if found.start() == pos => {
+                println!("literal {} at {} => date {}", literal, pos, found.as_str());
+            }
+            _ => println!("literal {} at {} (no rule match)", literal, pos),
+        }
+    }
+
+    sgx_status_t::SGX_SUCCESS
+}
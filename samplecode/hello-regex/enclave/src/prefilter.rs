@@ -0,0 +1,189 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License..
+
+//! Multi-literal SIMD prefilter, Teddy style.
+//!
+//! A scanning enclave should run its regex engine on almost nothing:
+//! the cheap question "could any literal start here?" filters the
+//! bulk of the input first. This module answers it with the nibble
+//! trick from Hyperscan's Teddy: literals are spread over eight
+//! buckets, and for each of the first two literal bytes a pair of
+//! 16-entry tables maps a byte's low and high nibble to a bucket
+//! bitmap. A position is a candidate only if the bitmaps of its first
+//! two bytes intersect; with AVX2 that test runs for 32 positions in
+//! a handful of shuffles. Candidates are confirmed by comparing the
+//! bucket's literals, so the caller sees true hits only and falls
+//! back to the full engine just there.
+//!
+//! The scalar path walks the same tables byte by byte; the AVX2
+//! kernel is selected at runtime with the `sgx_trts` feature check,
+//! since enclaves inherit the host CPU.
+
+use std::vec::Vec;
+
+const BUCKETS: usize = 8;
+
+/// Confirmed literal occurrence: (haystack offset, literal index).
+pub type PrefilterHit = (usize, usize);
+
+/// An eight-bucket two-byte nibble prefilter over a literal set.
+pub struct LiteralPrefilter {
+    literals: Vec<Vec<u8>>,
+    /// Literal indices per bucket, for candidate confirmation.
+    bucket_lits: [Vec<usize>; BUCKETS],
+    /// Nibble -> bucket bitmap, for byte 0 and byte 1 of a literal.
+    lo0: [u8; 16],
+    hi0: [u8; 16],
+    lo1: [u8; 16],
+    hi1: [u8; 16],
+}
+
+impl LiteralPrefilter {
+    /// Builds a prefilter; every literal must be at least two bytes,
+    /// since the candidate test keys on the first two.
+    pub fn new(literals: &[&[u8]]) -> Result<LiteralPrefilter, &'static str> {
+        if literals.is_empty() {
+            return Err("no literals");
+        }
+        let mut filter = LiteralPrefilter {
+            literals: Vec::with_capacity(literals.len()),
+            bucket_lits: Default::default(),
+            lo0: [0; 16],
+            hi0: [0; 16],
+            lo1: [0; 16],
+            hi1: [0; 16],
+        };
+        for (index, lit) in literals.iter().enumerate() {
+            if lit.len() < 2 {
+                return Err("literal shorter than two bytes");
+            }
+            let bucket = index % BUCKETS;
+            let bit = 1_u8 << bucket;
+            filter.lo0[(lit[0] & 0x0f) as usize] |= bit;
+            filter.hi0[(lit[0] >> 4) as usize] |= bit;
+            filter.lo1[(lit[1] & 0x0f) as usize] |= bit;
+            filter.hi1[(lit[1] >> 4) as usize] |= bit;
+            filter.bucket_lits[bucket].push(index);
+            filter.literals.push(lit.to_vec());
+        }
+        Ok(filter)
+    }
+
+    /// Bucket bitmaps for one byte at literal position 0 / 1.
+    #[inline]
+    fn classes0(&self, byte: u8) -> u8 {
+        self.lo0[(byte & 0x0f) as usize] & self.hi0[(byte >> 4) as usize]
+    }
+
+    #[inline]
+    fn classes1(&self, byte: u8) -> u8 {
+        self.lo1[(byte & 0x0f) as usize] & self.hi1[(byte >> 4) as usize]
+    }
+
+    /// Confirms the candidate buckets at `pos` against their literals.
+    fn confirm(&self, haystack: &[u8], pos: usize, buckets: u8, hits: &mut Vec<PrefilterHit>) {
+        let mut pending = buckets;
+        while pending != 0 {
+            let bucket = pending.trailing_zeros() as usize;
+            pending &= pending - 1;
+            for &index in &self.bucket_lits[bucket] {
+                let lit = &self.literals[index];
+                if haystack.len() - pos >= lit.len() && &haystack[pos..pos + lit.len()] == &lit[..] {
+                    hits.push((pos, index));
+                }
+            }
+        }
+    }
+
+    /// Scans `haystack`, returning confirmed hits only. Dispatches to
+    /// the AVX2 kernel when the CPU has it.
+    pub fn scan(&self, haystack: &[u8]) -> Vec<PrefilterHit> {
+        let mut hits = Vec::new();
+        if haystack.len() < 2 {
+            return hits;
+        }
+        if sgx_trts::is_x86_feature_detected!("avx2") {
+            unsafe { self.scan_avx2(haystack, &mut hits) };
+        } else {
+            self.scan_scalar(haystack, 0, haystack.len() - 1, &mut hits);
+        }
+        hits
+    }
+
+    fn scan_scalar(&self, haystack: &[u8], from: usize, to: usize, hits: &mut Vec<PrefilterHit>) {
+        for pos in from..to {
+            let cand = self.classes0(haystack[pos]) & self.classes1(haystack[pos + 1]);
+            if cand != 0 {
+                self.confirm(haystack, pos, cand, hits);
+            }
+        }
+    }
+
+    /// 32 candidate tests per iteration: shuffle the nibble tables by
+    /// the low/high nibbles of the block at `pos` (byte-0 classes) and
+    /// of the block at `pos + 1` (byte-1 classes), AND them, and
+    /// confirm wherever a byte of the result is non-zero.
+    #[target_feature(enable = "avx2")]
+    unsafe fn scan_avx2(&self, haystack: &[u8], hits: &mut Vec<PrefilterHit>) {
+        #[cfg(target_arch = "x86_64")]
+        use core::arch::x86_64::*;
+
+        let last = haystack.len() - 1;
+        if last < 32 {
+            self.scan_scalar(haystack, 0, last, hits);
+            return;
+        }
+
+        let lo0 = _mm256_broadcastsi128_si256(_mm_loadu_si128(self.lo0.as_ptr() as *const __m128i));
+        let hi0 = _mm256_broadcastsi128_si256(_mm_loadu_si128(self.hi0.as_ptr() as *const __m128i));
+        let lo1 = _mm256_broadcastsi128_si256(_mm_loadu_si128(self.lo1.as_ptr() as *const __m128i));
+        let hi1 = _mm256_broadcastsi128_si256(_mm_loadu_si128(self.hi1.as_ptr() as *const __m128i));
+        let nibble = _mm256_set1_epi8(0x0f);
+        let zero = _mm256_setzero_si256();
+
+        let mut pos = 0;
+        while pos + 32 <= last {
+            let b0 = _mm256_loadu_si256(haystack.as_ptr().add(pos) as *const __m256i);
+            let b1 = _mm256_loadu_si256(haystack.as_ptr().add(pos + 1) as *const __m256i);
+
+            let c0 = _mm256_and_si256(
+                _mm256_shuffle_epi8(lo0, _mm256_and_si256(b0, nibble)),
+                _mm256_shuffle_epi8(hi0, _mm256_and_si256(_mm256_srli_epi16(b0, 4), nibble)),
+            );
+            let c1 = _mm256_and_si256(
+                _mm256_shuffle_epi8(lo1, _mm256_and_si256(b1, nibble)),
+                _mm256_shuffle_epi8(hi1, _mm256_and_si256(_mm256_srli_epi16(b1, 4), nibble)),
+            );
+            let cand = _mm256_and_si256(c0, c1);
+
+            // one bit per lane byte that holds a candidate bucket set
+            let mut live =
+                !(_mm256_movemask_epi8(_mm256_cmpeq_epi8(cand, zero)) as u32);
+            if live != 0 {
+                let mut lanes = [0_u8; 32];
+                _mm256_storeu_si256(lanes.as_mut_ptr() as *mut __m256i, cand);
+                while live != 0 {
+                    let lane = live.trailing_zeros() as usize;
+                    live &= live - 1;
+                    self.confirm(haystack, pos + lane, lanes[lane], hits);
+                }
+            }
+            pos += 32;
+        }
+        self.scan_scalar(haystack, pos, last, hits);
+    }
+}
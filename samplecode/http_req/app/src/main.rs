@@ -30,6 +30,23 @@ extern "C" {
         retval: *mut sgx_status_t,
         hostname: *const c_char,
     ) -> sgx_status_t;
+    fn warm_up_connections(
+        eid: sgx_enclave_id_t,
+        retval: *mut sgx_status_t,
+        hostname: *const c_char,
+        count: usize,
+    ) -> sgx_status_t;
+    fn send_http_request_pooled(
+        eid: sgx_enclave_id_t,
+        retval: *mut sgx_status_t,
+        hostname: *const c_char,
+    ) -> sgx_status_t;
+    fn send_http_requests_pipelined(
+        eid: sgx_enclave_id_t,
+        retval: *mut sgx_status_t,
+        hostname: *const c_char,
+        count: usize,
+    ) -> sgx_status_t;
 }
 
 fn init_enclave() -> SgxResult<SgxEnclave> {
@@ -84,5 +101,49 @@ fn main() {
 
     println!("[+] send_http_request success...");
 
+    // Pooled path: warm up once, then reuse the connections across
+    // several ECALLs and pipeline a burst over one of them.
+    let result = unsafe {
+        warm_up_connections(
+            enclave.geteid(),
+            &mut retval,
+            c_hostname.as_ptr() as *const c_char,
+            2,
+        )
+    };
+    if result != sgx_status_t::SGX_SUCCESS {
+        println!("[-] ECALL Enclave Failed {}!", result.as_str());
+        return;
+    }
+
+    for _ in 0..3 {
+        let result = unsafe {
+            send_http_request_pooled(
+                enclave.geteid(),
+                &mut retval,
+                c_hostname.as_ptr() as *const c_char,
+            )
+        };
+        if result != sgx_status_t::SGX_SUCCESS {
+            println!("[-] ECALL Enclave Failed {}!", result.as_str());
+            return;
+        }
+    }
+
+    let result = unsafe {
+        send_http_requests_pipelined(
+            enclave.geteid(),
+            &mut retval,
+            c_hostname.as_ptr() as *const c_char,
+            3,
+        )
+    };
+    if result != sgx_status_t::SGX_SUCCESS {
+        println!("[-] ECALL Enclave Failed {}!", result.as_str());
+        return;
+    }
+
+    println!("[+] pooled requests success...");
+
     enclave.destroy();
 }
@@ -27,6 +27,11 @@ extern crate sgx_tstd as std;
 #[cfg(target_env = "sgx")]
 extern crate sgx_types;
 
+#[macro_use]
+extern crate lazy_static;
+
+mod pool;
+
 use http_req::{request::RequestBuilder, tls, uri::Uri};
 use sgx_types::*;
 use std::ffi::CStr;
@@ -71,3 +76,82 @@ pub extern "C" fn send_http_request(hostname: *const c_char) -> sgx_status_t {
 
     sgx_status_t::SGX_SUCCESS
 }
+
+/// Pre-establish TLS connections for the host so later pooled requests
+/// skip TCP connect and the handshake. Pool state lives in enclave
+/// globals and survives across ECALLs.
+#[no_mangle]
+pub extern "C" fn warm_up_connections(hostname: *const c_char, count: size_t) -> sgx_status_t {
+    if hostname.is_null() {
+        return sgx_status_t::SGX_ERROR_UNEXPECTED;
+    }
+
+    let hostname = unsafe { CStr::from_ptr(hostname).to_str() };
+    let hostname = hostname.expect("Failed to recover hostname");
+
+    match pool::warm_up(hostname, count) {
+        Ok(idle) => {
+            println!("Warmed up: {} idle connection(s) for {}", idle, hostname);
+            sgx_status_t::SGX_SUCCESS
+        }
+        Err(e) => {
+            println!("Warm-up failed: {}", e);
+            sgx_status_t::SGX_ERROR_UNEXPECTED
+        }
+    }
+}
+
+/// Same request as send_http_request, but over a pooled keep-alive
+/// connection: no TCP or TLS setup when the pool has an idle one.
+#[no_mangle]
+pub extern "C" fn send_http_request_pooled(hostname: *const c_char) -> sgx_status_t {
+    if hostname.is_null() {
+        return sgx_status_t::SGX_ERROR_UNEXPECTED;
+    }
+
+    let hostname = unsafe { CStr::from_ptr(hostname).to_str() };
+    let hostname = hostname.expect("Failed to recover hostname");
+
+    match pool::get(hostname) {
+        Ok(response) => {
+            println!("Status: {} {} ({} body bytes, pooled)",
+                     response.status,
+                     response.reason,
+                     response.body.len());
+            sgx_status_t::SGX_SUCCESS
+        }
+        Err(e) => {
+            println!("Pooled request failed: {}", e);
+            sgx_status_t::SGX_ERROR_UNEXPECTED
+        }
+    }
+}
+
+/// Write `count` requests back-to-back on one connection and read the
+/// responses in order, so a burst costs one round trip of latency.
+#[no_mangle]
+pub extern "C" fn send_http_requests_pipelined(hostname: *const c_char, count: size_t) -> sgx_status_t {
+    if hostname.is_null() || count == 0 {
+        return sgx_status_t::SGX_ERROR_UNEXPECTED;
+    }
+
+    let hostname = unsafe { CStr::from_ptr(hostname).to_str() };
+    let hostname = hostname.expect("Failed to recover hostname");
+
+    match pool::get_pipelined(hostname, count) {
+        Ok(responses) => {
+            for (i, response) in responses.iter().enumerate() {
+                println!("Pipelined {}: {} {} ({} body bytes)",
+                         i,
+                         response.status,
+                         response.reason,
+                         response.body.len());
+            }
+            sgx_status_t::SGX_SUCCESS
+        }
+        Err(e) => {
+            println!("Pipelined request failed: {}", e);
+            sgx_status_t::SGX_ERROR_UNEXPECTED
+        }
+    }
+}
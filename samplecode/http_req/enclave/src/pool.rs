@@ -0,0 +1,333 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License..
+
+//! A small pooled HTTP/1.1 client with keep-alive and pipelining.
+//!
+//! The one-shot path in lib.rs pays TCP connect plus a full TLS
+//! handshake for every request. The pool below keeps established TLS
+//! connections in enclave globals so they survive across ECALLs, lets
+//! callers pre-warm connections before the first request, and can
+//! pipeline several requests over one connection.
+
+use http_req::{tls, uri::Uri};
+use std::collections::HashMap;
+use std::io::{self, Read, Write};
+use std::net::TcpStream;
+use std::prelude::v1::*;
+use std::sync::SgxMutex;
+
+pub type TlsConn = tls::Conn<TcpStream>;
+
+/// Idle connections kept per host:port key.
+const MAX_IDLE_PER_HOST: usize = 8;
+
+pub struct HttpResponse {
+    pub status: u16,
+    pub reason: String,
+    pub body: Vec<u8>,
+    keep_alive: bool,
+}
+
+pub struct HttpPool {
+    idle: SgxMutex<HashMap<String, Vec<TlsConn>>>,
+}
+
+lazy_static! {
+    static ref HTTP_POOL: HttpPool = HttpPool::new();
+}
+
+impl HttpPool {
+    fn new() -> HttpPool {
+        HttpPool {
+            idle: SgxMutex::new(HashMap::new()),
+        }
+    }
+
+    fn checkout(&self, key: &str) -> Option<TlsConn> {
+        self.idle.lock().unwrap().get_mut(key).and_then(|v| v.pop())
+    }
+
+    fn checkin(&self, key: &str, conn: TlsConn) {
+        let mut idle = self.idle.lock().unwrap();
+        let conns = idle.entry(key.to_string()).or_insert_with(Vec::new);
+        if conns.len() < MAX_IDLE_PER_HOST {
+            conns.push(conn);
+        }
+    }
+
+    fn idle_count(&self, key: &str) -> usize {
+        self.idle.lock().unwrap().get(key).map_or(0, |v| v.len())
+    }
+}
+
+fn other_err(msg: &str) -> io::Error {
+    io::Error::new(io::ErrorKind::Other, msg.to_string())
+}
+
+fn parse_url(url: &str) -> io::Result<(Uri, String, String)> {
+    let addr: Uri = url.parse().map_err(|_| other_err("invalid url"))?;
+    let host = addr
+        .host()
+        .ok_or_else(|| other_err("url has no host"))?
+        .to_string();
+    let key = format!("{}:{}", host, addr.port().unwrap_or(443));
+    Ok((addr, host, key))
+}
+
+fn dial(host: &str, key: &str) -> io::Result<TlsConn> {
+    let stream = TcpStream::connect(key)?;
+    tls::Config::default()
+        .connect(host, stream)
+        .map_err(|_| other_err("TLS handshake failed"))
+}
+
+fn write_request(conn: &mut TlsConn, addr: &Uri, host: &str) -> io::Result<()> {
+    let request = format!(
+        "GET {} HTTP/1.1\r\nHost: {}\r\nConnection: keep-alive\r\nAccept: */*\r\n\r\n",
+        addr.resource(),
+        host
+    );
+    conn.write_all(request.as_bytes())
+}
+
+/// Buffered view over a connection that remembers bytes read past the
+/// header/chunk boundary, so body framing can be parsed incrementally.
+struct BodyReader<'a> {
+    conn: &'a mut TlsConn,
+    buf: Vec<u8>,
+    pos: usize,
+}
+
+impl<'a> BodyReader<'a> {
+    fn new(conn: &'a mut TlsConn, leftover: Vec<u8>) -> BodyReader<'a> {
+        BodyReader {
+            conn,
+            buf: leftover,
+            pos: 0,
+        }
+    }
+
+    fn fill(&mut self) -> io::Result<()> {
+        let mut chunk = [0u8; 2048];
+        let n = self.conn.read(&mut chunk)?;
+        if n == 0 {
+            return Err(io::Error::new(
+                io::ErrorKind::UnexpectedEof,
+                "connection closed mid-body",
+            ));
+        }
+        self.buf.extend_from_slice(&chunk[..n]);
+        Ok(())
+    }
+
+    fn read_line(&mut self) -> io::Result<String> {
+        loop {
+            if let Some(i) = self.buf[self.pos..].windows(2).position(|w| w == b"\r\n") {
+                let line = String::from_utf8_lossy(&self.buf[self.pos..self.pos + i]).into_owned();
+                self.pos += i + 2;
+                return Ok(line);
+            }
+            self.fill()?;
+        }
+    }
+
+    fn read_exact_into(&mut self, n: usize, out: &mut Vec<u8>) -> io::Result<()> {
+        while self.buf.len() - self.pos < n {
+            self.fill()?;
+        }
+        out.extend_from_slice(&self.buf[self.pos..self.pos + n]);
+        self.pos += n;
+        Ok(())
+    }
+}
+
+fn read_chunked_body(conn: &mut TlsConn, leftover: Vec<u8>) -> io::Result<Vec<u8>> {
+    let mut reader = BodyReader::new(conn, leftover);
+    let mut body = Vec::new();
+    loop {
+        let size_line = reader.read_line()?;
+        let size_str = size_line.split(';').next().unwrap_or("").trim();
+        let size = usize::from_str_radix(size_str, 16)
+            .map_err(|_| other_err("invalid chunk size"))?;
+        if size == 0 {
+            // consume the trailer up to the final empty line
+            while !reader.read_line()?.is_empty() {}
+            return Ok(body);
+        }
+        reader.read_exact_into(size, &mut body)?;
+        let crlf = reader.read_line()?;
+        if !crlf.is_empty() {
+            return Err(other_err("missing chunk terminator"));
+        }
+    }
+}
+
+fn read_response(conn: &mut TlsConn) -> io::Result<HttpResponse> {
+    let mut head = Vec::new();
+    let body_start;
+    let mut chunk = [0u8; 2048];
+    loop {
+        let n = conn.read(&mut chunk)?;
+        if n == 0 {
+            return Err(io::Error::new(
+                io::ErrorKind::UnexpectedEof,
+                "connection closed before response head",
+            ));
+        }
+        head.extend_from_slice(&chunk[..n]);
+        if let Some(i) = head.windows(4).position(|w| w == b"\r\n\r\n") {
+            body_start = i + 4;
+            break;
+        }
+    }
+    let leftover = head.split_off(body_start);
+    head.truncate(body_start - 4);
+
+    let head_str = String::from_utf8_lossy(&head).into_owned();
+    let mut lines = head_str.split("\r\n");
+    let status_line = lines.next().ok_or_else(|| other_err("empty response head"))?;
+    let mut parts = status_line.splitn(3, ' ');
+    let _version = parts.next();
+    let status: u16 = parts
+        .next()
+        .and_then(|s| s.parse().ok())
+        .ok_or_else(|| other_err("invalid status line"))?;
+    let reason = parts.next().unwrap_or("").to_string();
+
+    let mut content_len: Option<usize> = None;
+    let mut chunked = false;
+    // keep-alive is the HTTP/1.1 default
+    let mut keep_alive = true;
+    for line in lines {
+        let mut kv = line.splitn(2, ':');
+        let name = kv.next().unwrap_or("").trim().to_lowercase();
+        let value = kv.next().unwrap_or("").trim();
+        match name.as_str() {
+            "content-length" => content_len = value.parse().ok(),
+            "transfer-encoding" => chunked = value.to_lowercase().contains("chunked"),
+            "connection" => keep_alive = !value.eq_ignore_ascii_case("close"),
+            _ => {}
+        }
+    }
+
+    let body = if chunked {
+        read_chunked_body(conn, leftover)?
+    } else if let Some(len) = content_len {
+        let mut body = leftover;
+        while body.len() < len {
+            let n = conn.read(&mut chunk)?;
+            if n == 0 {
+                return Err(io::Error::new(
+                    io::ErrorKind::UnexpectedEof,
+                    "connection closed mid-body",
+                ));
+            }
+            body.extend_from_slice(&chunk[..n]);
+        }
+        body.truncate(len);
+        body
+    } else {
+        // no framing: body runs to EOF and the connection cannot be reused
+        keep_alive = false;
+        let mut body = leftover;
+        loop {
+            match conn.read(&mut chunk) {
+                Ok(0) => break,
+                Ok(n) => body.extend_from_slice(&chunk[..n]),
+                Err(e) => return Err(e),
+            }
+        }
+        body
+    };
+
+    Ok(HttpResponse {
+        status,
+        reason,
+        body,
+        keep_alive,
+    })
+}
+
+fn roundtrip(conn: &mut TlsConn, addr: &Uri, host: &str) -> io::Result<HttpResponse> {
+    write_request(conn, addr, host)?;
+    read_response(conn)
+}
+
+/// Issue one GET over a pooled connection, dialing only on a pool miss.
+/// A request that fails on a pooled connection (the peer may have idled
+/// it out) is retried once on a fresh connection.
+pub fn get(url: &str) -> io::Result<HttpResponse> {
+    let (addr, host, key) = parse_url(url)?;
+
+    if let Some(mut conn) = HTTP_POOL.checkout(&key) {
+        if let Ok(response) = roundtrip(&mut conn, &addr, &host) {
+            if response.keep_alive {
+                HTTP_POOL.checkin(&key, conn);
+            }
+            return Ok(response);
+        }
+    }
+
+    let mut conn = dial(&host, &key)?;
+    let response = roundtrip(&mut conn, &addr, &host)?;
+    if response.keep_alive {
+        HTTP_POOL.checkin(&key, conn);
+    }
+    Ok(response)
+}
+
+/// Write `count` GET requests back-to-back on a single connection, then
+/// read the responses in order. Responses after one that disables
+/// keep-alive cannot arrive and are reported as an error.
+pub fn get_pipelined(url: &str, count: usize) -> io::Result<Vec<HttpResponse>> {
+    let (addr, host, key) = parse_url(url)?;
+    let mut conn = match HTTP_POOL.checkout(&key) {
+        Some(conn) => conn,
+        None => dial(&host, &key)?,
+    };
+
+    for _ in 0..count {
+        write_request(&mut conn, &addr, &host)?;
+    }
+
+    let mut responses = Vec::with_capacity(count);
+    for i in 0..count {
+        let response = read_response(&mut conn)?;
+        let keep_alive = response.keep_alive;
+        responses.push(response);
+        if !keep_alive && i + 1 < count {
+            return Err(other_err("peer closed mid-pipeline"));
+        }
+    }
+
+    if responses.last().map_or(false, |r| r.keep_alive) {
+        HTTP_POOL.checkin(&key, conn);
+    }
+    Ok(responses)
+}
+
+/// Pre-establish connections so the first real requests skip TCP and
+/// TLS setup entirely. Returns the number of idle connections now held
+/// for the host.
+pub fn warm_up(url: &str, count: usize) -> io::Result<usize> {
+    let (_addr, host, key) = parse_url(url)?;
+    while HTTP_POOL.idle_count(&key) < count.min(MAX_IDLE_PER_HOST) {
+        let conn = dial(&host, &key)?;
+        HTTP_POOL.checkin(&key, conn);
+    }
+    Ok(HTTP_POOL.idle_count(&key))
+}
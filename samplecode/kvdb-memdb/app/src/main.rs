@@ -25,6 +25,66 @@ static ENCLAVE_FILE: &'static str = "enclave.signed.so";
 extern {
     fn say_something(eid: sgx_enclave_id_t, retval: *mut sgx_status_t,
                      some_string: *const u8, len: usize) -> sgx_status_t;
+    fn kv_setup(eid: sgx_enclave_id_t, retval: *mut sgx_status_t,
+                entries: u64) -> sgx_status_t;
+    fn kv_bench_locked(eid: sgx_enclave_id_t, retval: *mut u64,
+                       rounds: u64, seed: u64) -> sgx_status_t;
+    fn kv_bench_sharded(eid: sgx_enclave_id_t, retval: *mut u64,
+                        rounds: u64, seed: u64) -> sgx_status_t;
+    fn kv_tiered_test(eid: sgx_enclave_id_t, retval: *mut sgx_status_t,
+                      entries: u64, hot_capacity: u64) -> sgx_status_t;
+}
+
+const KV_ENTRIES: u64 = 100_000;
+const KV_ROUNDS_PER_THREAD: u64 = 1_000_000;
+
+// Runs `rounds` lookups on `threads` concurrently entered TCSs and
+// returns the aggregate lookups per second.
+fn run_kv_bench(eid: sgx_enclave_id_t, threads: usize, sharded: bool) -> f64 {
+    let start = std::time::Instant::now();
+    let handles: Vec<std::thread::JoinHandle<u64>> = (0..threads)
+        .map(|i| {
+            std::thread::spawn(move || {
+                let mut hits: u64 = 0;
+                let seed = 0x5eed_0000 + i as u64;
+                let result = unsafe {
+                    if sharded {
+                        kv_bench_sharded(eid, &mut hits, KV_ROUNDS_PER_THREAD, seed)
+                    } else {
+                        kv_bench_locked(eid, &mut hits, KV_ROUNDS_PER_THREAD, seed)
+                    }
+                };
+                assert_eq!(result, sgx_status_t::SGX_SUCCESS);
+                hits
+            })
+        })
+        .collect();
+    let mut total_hits: u64 = 0;
+    for handle in handles {
+        total_hits += handle.join().unwrap();
+    }
+    assert_eq!(total_hits, KV_ROUNDS_PER_THREAD * threads as u64);
+    let elapsed = start.elapsed();
+    let secs = elapsed.as_secs() as f64 + f64::from(elapsed.subsec_nanos()) * 1e-9;
+    (KV_ROUNDS_PER_THREAD * threads as u64) as f64 / secs
+}
+
+fn kv_bench(eid: sgx_enclave_id_t) {
+    let mut retval = sgx_status_t::SGX_SUCCESS;
+    let result = unsafe { kv_setup(eid, &mut retval, KV_ENTRIES) };
+    if result != sgx_status_t::SGX_SUCCESS || retval != sgx_status_t::SGX_SUCCESS {
+        println!("[-] kv_setup failed: {} / {}", result.as_str(), retval.as_str());
+        return;
+    }
+
+    println!("[+] {} entries, {} lookups per thread", KV_ENTRIES, KV_ROUNDS_PER_THREAD);
+    println!("{:>8} {:>20} {:>20}", "threads", "mutex (lookups/s)", "sharded (lookups/s)");
+    // the enclave is built with 8 TCSs; more threads would just queue
+    for &threads in [1_usize, 2, 4, 8].iter() {
+        let locked = run_kv_bench(eid, threads, false);
+        let sharded = run_kv_bench(eid, threads, true);
+        println!("{:>8} {:>20.0} {:>20.0}", threads, locked, sharded);
+    }
 }
 
 fn init_enclave() -> SgxResult<SgxEnclave> {
@@ -75,5 +135,17 @@ fn main() {
 
     println!("[+] say_something success...");
 
+    kv_bench(enclave.geteid());
+
+    // two-tier store: 1000 entries against a hot tier of 64 per shard,
+    // so most of the data lives sealed in the protected spill files
+    let mut retval = sgx_status_t::SGX_SUCCESS;
+    let result = unsafe { kv_tiered_test(enclave.geteid(), &mut retval, 1000, 64) };
+    if result != sgx_status_t::SGX_SUCCESS || retval != sgx_status_t::SGX_SUCCESS {
+        println!("[-] kv_tiered_test failed: {} / {}", result.as_str(), retval.as_str());
+        return;
+    }
+    println!("[+] kv_tiered_test success...");
+
     enclave.destroy();
 }
@@ -28,9 +28,15 @@ extern crate sgx_tstd as std;
 
 extern crate kvdb;
 extern crate kvdb_memorydb;
+extern crate sgx_tseal;
+
+mod tiered;
 
 use sgx_types::*;
+use std::collections::HashMap;
 use std::string::String;
+use std::sync::atomic::{AtomicU64, Ordering};
+use std::sync::{Once, SgxConcurrentHashMap, SgxMutex};
 use std::vec::Vec;
 use std::io::{self, Write};
 use std::slice;
@@ -83,4 +89,155 @@ pub extern "C" fn say_something(some_string: *const u8, some_len: usize) -> sgx_
 
 
     sgx_status_t::SGX_SUCCESS
-}
\ No newline at end of file
+}
+
+// Two stores over the same data, so the app can measure how read
+// throughput scales with concurrently entered TCSs: a HashMap behind a
+// single SgxMutex (every reader serializes on one lock) and an
+// SgxConcurrentHashMap (readers of different shards never contend).
+
+struct KvStores {
+    locked: SgxMutex<HashMap<u64, u64>>,
+    sharded: SgxConcurrentHashMap<u64, u64>,
+    entries: AtomicU64,
+}
+
+fn kv_stores() -> &'static KvStores {
+    static INIT: Once = Once::new();
+    static mut STORES: Option<KvStores> = None;
+    unsafe {
+        INIT.call_once(|| {
+            STORES = Some(KvStores {
+                locked: SgxMutex::new(HashMap::new()),
+                sharded: SgxConcurrentHashMap::with_shards(32),
+                entries: AtomicU64::new(0),
+            });
+        });
+        STORES.as_ref().unwrap()
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn kv_setup(entries: u64) -> sgx_status_t {
+    let stores = kv_stores();
+    let mut locked = stores.locked.lock().unwrap();
+    locked.clear();
+    stores.sharded.clear();
+    for key in 0..entries {
+        let value = key.wrapping_mul(0x9e37_79b9_7f4a_7c15);
+        locked.insert(key, value);
+        stores.sharded.insert(key, value);
+    }
+    stores.entries.store(entries, Ordering::Release);
+    sgx_status_t::SGX_SUCCESS
+}
+
+// xorshift64*; each benchmark thread passes its own seed so threads
+// walk different key sequences
+fn next_key(state: &mut u64, entries: u64) -> u64 {
+    let mut x = *state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *state = x;
+    x.wrapping_mul(0x2545_f491_4f6c_dd1d) % entries
+}
+
+#[no_mangle]
+pub extern "C" fn kv_bench_locked(rounds: u64, seed: u64) -> u64 {
+    let stores = kv_stores();
+    let entries = stores.entries.load(Ordering::Acquire);
+    if entries == 0 {
+        return 0;
+    }
+    let mut state = seed | 1;
+    let mut hits = 0_u64;
+    for _ in 0..rounds {
+        let key = next_key(&mut state, entries);
+        if stores.locked.lock().unwrap().get(&key).is_some() {
+            hits += 1;
+        }
+    }
+    hits
+}
+
+#[no_mangle]
+pub extern "C" fn kv_bench_sharded(rounds: u64, seed: u64) -> u64 {
+    let stores = kv_stores();
+    let entries = stores.entries.load(Ordering::Acquire);
+    if entries == 0 {
+        return 0;
+    }
+    let mut state = seed | 1;
+    let mut hits = 0_u64;
+    for _ in 0..rounds {
+        let key = next_key(&mut state, entries);
+        if stores.sharded.get(&key).is_some() {
+            hits += 1;
+        }
+    }
+    hits
+}
+
+#[no_mangle]
+pub extern "C" fn kv_tiered_test(entries: u64, hot_capacity: u64) -> sgx_status_t {
+    use tiered::TieredKv;
+
+    let store = match TieredKv::new(hot_capacity as usize, "tiered_spill") {
+        Ok(store) => store,
+        Err(e) => {
+            println!("[-] tiered store setup failed: {}", e);
+            return sgx_status_t::SGX_ERROR_UNEXPECTED;
+        }
+    };
+
+    // fill past the hot capacity so the early keys get sealed and
+    // spilled to the protected files
+    for key in 0..entries {
+        let value = format!("value-{}", key);
+        if let Err(e) = store.put(format!("key-{}", key).as_bytes(), value.as_bytes()) {
+            println!("[-] tiered put failed: {}", e);
+            return sgx_status_t::SGX_ERROR_UNEXPECTED;
+        }
+    }
+    let (hot, cold) = store.stats();
+    println!("tiered store after fill: {} hot / {} cold (sealed)", hot, cold);
+
+    // read everything back; cold hits unseal from the spill files and
+    // queue themselves for promotion
+    for key in 0..entries {
+        let name = format!("key-{}", key);
+        match store.get(name.as_bytes()) {
+            Ok(Some(value)) => {
+                if value != format!("value-{}", key).as_bytes() {
+                    println!("[-] tiered value mismatch for {}", name);
+                    return sgx_status_t::SGX_ERROR_UNEXPECTED;
+                }
+            }
+            Ok(None) => {
+                println!("[-] tiered entry lost: {}", name);
+                return sgx_status_t::SGX_ERROR_UNEXPECTED;
+            }
+            Err(e) => {
+                println!("[-] tiered get failed for {}: {}", name, e);
+                return sgx_status_t::SGX_ERROR_UNEXPECTED;
+            }
+        }
+    }
+
+    match store.promote_pending() {
+        Ok(promoted) => {
+            let (hot, cold) = store.stats();
+            println!(
+                "tiered store after batch promotion of {}: {} hot / {} cold",
+                promoted, hot, cold
+            );
+        }
+        Err(e) => {
+            println!("[-] tiered promotion failed: {}", e);
+            return sgx_status_t::SGX_ERROR_UNEXPECTED;
+        }
+    }
+
+    sgx_status_t::SGX_SUCCESS
+}
@@ -0,0 +1,281 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License..
+
+//! Two-tier key-value store: hot entries in EPC, cold entries sealed
+//! and spilled to protected files.
+//!
+//! Past EPC size, every access through an in-memory map risks an EWB
+//! round trip - transparent paging encrypts and evicts whole pages on
+//! the hardware's schedule, not the workload's. This store spills on
+//! ITS schedule instead: each shard keeps a bounded hot map in enclave
+//! memory and, when full, seals the least-recently-used entry
+//! (sgx_tseal, keyed to the enclave) and appends it to the shard's
+//! protected spill file, keeping only a small (key -> offset) index
+//! inside. A cold hit reads, unseals and serves the value, and queues
+//! the key for promotion; promotion runs in batches from
+//! [`promote_pending`] so the read path never pays the eviction work
+//! of making room - call it from a maintenance thread or between
+//! request bursts.
+//!
+//! Spill files are append-only; the space of promoted or overwritten
+//! entries is reclaimed only when the store is rebuilt. That is the
+//! usual log-structured trade and keeps the spill path one sequential
+//! write.
+
+use std::collections::HashMap;
+use std::io::{self, Read, Seek, SeekFrom, Write};
+use std::sgxfs::{OpenOptions, SgxFile};
+use std::string::String;
+use std::sync::SgxMutex;
+use std::vec::Vec;
+use sgx_tseal::SgxSealedData;
+use sgx_types::*;
+
+/// Power of two, so shard choice is a mask.
+const SHARDS: usize = 8;
+
+struct HotEntry {
+    value: Vec<u8>,
+    tick: u64,
+}
+
+struct ColdLoc {
+    offset: u64,
+    len: u32,
+}
+
+struct Shard {
+    hot: HashMap<Vec<u8>, HotEntry>,
+    cold: HashMap<Vec<u8>, ColdLoc>,
+    spill: SgxFile,
+    spill_end: u64,
+    tick: u64,
+    pending_promote: Vec<Vec<u8>>,
+}
+
+/// A sharded hot/cold store with sealed spill-to-disk.
+pub struct TieredKv {
+    shards: Vec<SgxMutex<Shard>>,
+    hot_capacity: usize,
+}
+
+fn fnv1a(key: &[u8]) -> u64 {
+    let mut hash: u64 = 0xcbf2_9ce4_8422_2325;
+    for byte in key {
+        hash ^= u64::from(*byte);
+        hash = hash.wrapping_mul(0x0000_0100_0000_01b3);
+    }
+    hash
+}
+
+/// Seals `value` with `key` as additional authenticated data, so an
+/// unsealed blob proves which key it belonged to.
+fn seal_entry(key: &[u8], value: &[u8]) -> SgxResult<Vec<u8>> {
+    let sealed = SgxSealedData::<[u8]>::seal_data(key, value)?;
+    let raw_len = SgxSealedData::<[u8]>::calc_raw_sealed_data_size(
+        key.len() as u32,
+        value.len() as u32,
+    );
+    let mut raw = vec![0_u8; raw_len as usize];
+    unsafe {
+        sealed
+            .to_raw_sealed_data_t(raw.as_mut_ptr() as *mut sgx_sealed_data_t, raw_len)
+            .ok_or(sgx_status_t::SGX_ERROR_UNEXPECTED)?;
+    }
+    Ok(raw)
+}
+
+fn unseal_entry(key: &[u8], mut raw: Vec<u8>) -> SgxResult<Vec<u8>> {
+    let sealed = unsafe {
+        SgxSealedData::<[u8]>::from_raw_sealed_data_t(
+            raw.as_mut_ptr() as *mut sgx_sealed_data_t,
+            raw.len() as u32,
+        )
+        .ok_or(sgx_status_t::SGX_ERROR_UNEXPECTED)?
+    };
+    let unsealed = sealed.unseal_data()?;
+    if unsealed.get_additional_txt() != key {
+        // spill file served a blob for a different key
+        return Err(sgx_status_t::SGX_ERROR_MAC_MISMATCH);
+    }
+    Ok(unsealed.get_decrypt_txt().to_vec())
+}
+
+impl Shard {
+    fn touch(&mut self, key: &[u8]) {
+        self.tick += 1;
+        let tick = self.tick;
+        if let Some(entry) = self.hot.get_mut(key) {
+            entry.tick = tick;
+        }
+    }
+
+    /// Seals and appends the least-recently-used hot entry.
+    fn spill_one(&mut self) -> io::Result<()> {
+        let victim = match self
+            .hot
+            .iter()
+            .min_by_key(|(_, entry)| entry.tick)
+            .map(|(key, _)| key.clone())
+        {
+            Some(victim) => victim,
+            None => return Ok(()),
+        };
+        let entry = self.hot.remove(&victim).unwrap();
+
+        let raw = seal_entry(&victim, &entry.value)
+            .map_err(|_| io::Error::new(io::ErrorKind::Other, "seal failed"))?;
+        self.spill.seek(SeekFrom::Start(self.spill_end))?;
+        self.spill.write_all(&raw)?;
+        self.cold.insert(
+            victim,
+            ColdLoc {
+                offset: self.spill_end,
+                len: raw.len() as u32,
+            },
+        );
+        self.spill_end += raw.len() as u64;
+        Ok(())
+    }
+
+    fn read_cold(&mut self, key: &[u8]) -> io::Result<Option<Vec<u8>>> {
+        let (offset, len) = match self.cold.get(key) {
+            Some(loc) => (loc.offset, loc.len as usize),
+            None => return Ok(None),
+        };
+        let mut raw = vec![0_u8; len];
+        self.spill.seek(SeekFrom::Start(offset))?;
+        self.spill.read_exact(&mut raw)?;
+        let value = unseal_entry(key, raw)
+            .map_err(|_| io::Error::new(io::ErrorKind::InvalidData, "unseal failed"))?;
+        Ok(Some(value))
+    }
+}
+
+impl TieredKv {
+    /// Creates a store with `hot_capacity` entries of EPC per shard;
+    /// spill files are created as `<prefix>.<shard>` protected files
+    /// under the enclave's auto key.
+    pub fn new(hot_capacity: usize, prefix: &str) -> io::Result<TieredKv> {
+        if hot_capacity == 0 {
+            return Err(io::Error::new(io::ErrorKind::InvalidInput, "hot capacity must be non-zero"));
+        }
+        let mut shards = Vec::with_capacity(SHARDS);
+        for index in 0..SHARDS {
+            let path = format!("{}.{}", prefix, index);
+            let spill = OpenOptions::new()
+                .write(true)
+                .update(true)
+                .binary(true)
+                .open(&path)?;
+            shards.push(SgxMutex::new(Shard {
+                hot: HashMap::new(),
+                cold: HashMap::new(),
+                spill,
+                spill_end: 0,
+                tick: 0,
+                pending_promote: Vec::new(),
+            }));
+        }
+        Ok(TieredKv {
+            shards,
+            hot_capacity,
+        })
+    }
+
+    fn shard(&self, key: &[u8]) -> &SgxMutex<Shard> {
+        &self.shards[(fnv1a(key) as usize) & (SHARDS - 1)]
+    }
+
+    /// Inserts or overwrites; spills the LRU entry when the shard's
+    /// hot tier is full.
+    pub fn put(&self, key: &[u8], value: &[u8]) -> io::Result<()> {
+        let mut shard = self.shard(key).lock().unwrap();
+        shard.tick += 1;
+        let tick = shard.tick;
+        // a fresh hot version shadows any cold one
+        shard.cold.remove(key);
+        shard.hot.insert(
+            key.to_vec(),
+            HotEntry {
+                value: value.to_vec(),
+                tick,
+            },
+        );
+        while shard.hot.len() > self.hot_capacity {
+            shard.spill_one()?;
+        }
+        Ok(())
+    }
+
+    /// Returns the value for `key`. Hot hits are a map probe; cold
+    /// hits read and unseal from the spill file and queue the key for
+    /// batched promotion rather than promoting inline.
+    pub fn get(&self, key: &[u8]) -> io::Result<Option<Vec<u8>>> {
+        let mut shard = self.shard(key).lock().unwrap();
+        if shard.hot.contains_key(key) {
+            shard.touch(key);
+            return Ok(shard.hot.get(key).map(|entry| entry.value.clone()));
+        }
+        match shard.read_cold(key)? {
+            Some(value) => {
+                shard.pending_promote.push(key.to_vec());
+                Ok(Some(value))
+            }
+            None => Ok(None),
+        }
+    }
+
+    /// Promotes recently hit cold entries into the hot tier, spilling
+    /// LRU entries to make room. Run from a maintenance thread or
+    /// between bursts; the read path itself never spills.
+    pub fn promote_pending(&self) -> io::Result<usize> {
+        let mut promoted = 0;
+        for locked in &self.shards {
+            let mut shard = locked.lock().unwrap();
+            let pending: Vec<Vec<u8>> = shard.pending_promote.drain(..).collect();
+            for key in pending {
+                if shard.hot.contains_key(&key) {
+                    continue;
+                }
+                if let Some(value) = shard.read_cold(&key)? {
+                    shard.cold.remove(&key);
+                    shard.tick += 1;
+                    let tick = shard.tick;
+                    shard.hot.insert(key, HotEntry { value, tick });
+                    promoted += 1;
+                    while shard.hot.len() > self.hot_capacity {
+                        shard.spill_one()?;
+                    }
+                }
+            }
+        }
+        Ok(promoted)
+    }
+
+    /// (hot entries, cold entries) across all shards.
+    pub fn stats(&self) -> (usize, usize) {
+        let mut hot = 0;
+        let mut cold = 0;
+        for locked in &self.shards {
+            let shard = locked.lock().unwrap();
+            hot += shard.hot.len();
+            cold += shard.cold.len();
+        }
+        (hot, cold)
+    }
+}
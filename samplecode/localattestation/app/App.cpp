@@ -17,6 +17,7 @@
 
 // App.cpp : Defines the entry point for the console application.
 #include <stdio.h>
+#include <pthread.h>
 #include <map>
 #include "Enclave1_u.h"
 #include "Enclave2_u.h"
@@ -32,6 +33,7 @@
 #define _tmain  main
 
 extern std::map<sgx_enclave_id_t, uint32_t>g_enclave_id_map;
+extern std::map<sgx_enclave_id_t, std::map<sgx_enclave_id_t, size_t> >g_session_ptr_map;
 
 
 sgx_enclave_id_t e1_enclave_id = 0;
@@ -48,6 +50,32 @@ void waitForKeyPress()
     getchar();
 }
 
+typedef struct _cache_serve_args_t
+{
+    sgx_enclave_id_t daemon_enclave_id;
+    sgx_enclave_id_t peer_enclave_id;
+    size_t* session_ptr;
+    uint32_t requests;
+    uint32_t ret_status;
+    sgx_status_t status;
+} cache_serve_args_t;
+
+// The daemon's serve ecall blocks on the bus until a request arrives, so it
+// runs on its own thread (and its own enclave's TCS) while the main thread
+// drives the peer's fetch ecalls.
+static void* cache_serve_thread(void* arg)
+{
+    cache_serve_args_t* args = (cache_serve_args_t*)arg;
+    for (uint32_t i = 0; i < args->requests; i++)
+    {
+        args->status = Enclave1_test_cache_serve(args->daemon_enclave_id, &args->ret_status,
+                args->peer_enclave_id, args->daemon_enclave_id, args->session_ptr);
+        if (args->status != SGX_SUCCESS || args->ret_status != 0)
+            break;
+    }
+    return NULL;
+}
+
 uint32_t load_enclaves()
 {
     uint32_t enclave_temp_no;
@@ -124,6 +152,100 @@ int _tmain(int argc, _TCHAR* argv[])
             }
         }
 
+        //Test message exchange over the shared-memory bus between Enclave1(Source) and Enclave2(Destination)
+        status = Enclave1_test_send_message(e1_enclave_id, &ret_status, e1_enclave_id, e2_enclave_id);
+        if (status!=SGX_SUCCESS)
+        {
+            printf("Enclave1_test_send_message Ecall failed: Error code is %x", status);
+            break;
+        }
+        else
+        {
+            if(ret_status!=0)
+            {
+                printf("\n\nMessage send failure between Source (E1) and Destination (E2): Error code is %x", ret_status);
+                break;
+            }
+        }
+
+        status = Enclave2_test_recv_message(e2_enclave_id, &ret_status, e1_enclave_id, e2_enclave_id, (size_t*)g_session_ptr_map[e2_enclave_id][e1_enclave_id]);
+        if (status!=SGX_SUCCESS)
+        {
+            printf("Enclave2_test_recv_message Ecall failed: Error code is %x", status);
+            break;
+        }
+        else
+        {
+            if(ret_status==0)
+            {
+                printf("\n\nMessage exchange over the shared-memory bus between Source (E1) and Destination (E2) Enclaves successful !!!");
+            }
+            else
+            {
+                printf("\n\nMessage receive failure between Source (E1) and Destination (E2): Error code is %x", ret_status);
+                break;
+            }
+        }
+
+        //Test the artifact cache daemon: Enclave2 (peer) authenticates to Enclave1 (daemon) and fetches an artifact twice
+        status = Enclave2_test_create_session(e2_enclave_id, &ret_status, e2_enclave_id, e1_enclave_id);
+        if (status!=SGX_SUCCESS)
+        {
+            printf("Enclave2_test_create_session Ecall failed: Error code is %x", status);
+            break;
+        }
+        else
+        {
+            if(ret_status!=0)
+            {
+                printf("\nSession establishment and key exchange failure between Source (E2) and Destination (E1): Error code is %x", ret_status);
+                break;
+            }
+        }
+
+        cache_serve_args_t serve_args;
+        serve_args.daemon_enclave_id = e1_enclave_id;
+        serve_args.peer_enclave_id = e2_enclave_id;
+        serve_args.session_ptr = (size_t*)g_session_ptr_map[e1_enclave_id][e2_enclave_id];
+        serve_args.requests = 2;
+        serve_args.ret_status = 0;
+        serve_args.status = SGX_SUCCESS;
+
+        pthread_t serve_thread;
+        if (pthread_create(&serve_thread, NULL, cache_serve_thread, &serve_args) != 0)
+        {
+            printf("\nFailed to start the cache daemon serve thread");
+            break;
+        }
+
+        // Two fetches: the first makes the daemon build and seal the
+        // artifact, the second is answered from the sealed cache. Both
+        // fetches are issued even on failure so the serve thread can drain
+        // its requests and join.
+        uint32_t fetch_failed = 0;
+        for (int round = 0; round < 2; round++)
+        {
+            status = Enclave2_test_cache_fetch(e2_enclave_id, &ret_status, e2_enclave_id, e1_enclave_id);
+            if (status!=SGX_SUCCESS || ret_status!=0)
+            {
+                printf("\n\nArtifact fetch %d from the cache daemon failed: Error code is %x", round + 1, status!=SGX_SUCCESS ? status : ret_status);
+                fetch_failed++;
+            }
+        }
+
+        pthread_join(serve_thread, NULL);
+
+        if (serve_args.status!=SGX_SUCCESS || serve_args.ret_status!=0)
+        {
+            printf("\n\nCache daemon serve failure on Enclave1: Error code is %x", serve_args.status!=SGX_SUCCESS ? serve_args.status : serve_args.ret_status);
+            break;
+        }
+        if (fetch_failed!=0)
+        {
+            break;
+        }
+        printf("\n\nArtifact fetched twice by the peer (E2) from the cache daemon (E1), built once and served from the sealed cache !!!");
+
         //Test Create session between Enclave1(Source) and Enclave3(Destination)
         status = Enclave1_test_create_session(e1_enclave_id, &ret_status, e1_enclave_id, e3_enclave_id);
         if (status!=SGX_SUCCESS)
@@ -184,6 +306,38 @@ int _tmain(int argc, _TCHAR* argv[])
             }
         }
 
+        //Test single-seal multicast: Enclave1 fans the same payload out to Enclave2 and Enclave3 over the bus
+        status = Enclave1_test_send_multicast(e1_enclave_id, &ret_status, e1_enclave_id, e2_enclave_id, e3_enclave_id);
+        if (status!=SGX_SUCCESS)
+        {
+            printf("Enclave1_test_send_multicast Ecall failed: Error code is %x", status);
+            break;
+        }
+        else
+        {
+            if(ret_status!=0)
+            {
+                printf("\n\nMulticast send failure from Source (E1): Error code is %x", ret_status);
+                break;
+            }
+        }
+
+        status = Enclave2_test_recv_message(e2_enclave_id, &ret_status, e1_enclave_id, e2_enclave_id, (size_t*)g_session_ptr_map[e2_enclave_id][e1_enclave_id]);
+        if (status!=SGX_SUCCESS || ret_status!=0)
+        {
+            printf("\n\nMulticast receive failure on Destination (E2): Error code is %x", status!=SGX_SUCCESS ? status : ret_status);
+            break;
+        }
+
+        status = Enclave3_test_recv_message(e3_enclave_id, &ret_status, e1_enclave_id, e3_enclave_id, (size_t*)g_session_ptr_map[e3_enclave_id][e1_enclave_id]);
+        if (status!=SGX_SUCCESS || ret_status!=0)
+        {
+            printf("\n\nMulticast receive failure on Destination (E3): Error code is %x", status!=SGX_SUCCESS ? status : ret_status);
+            break;
+        }
+
+        printf("\n\nMulticast payload sealed once by Source (E1) and received by Destinations (E2) and (E3) !!!");
+
         //Test Closing Session between Enclave1(Source) and Enclave2(Destination)
         status = Enclave1_test_close_session(e1_enclave_id, &ret_status, e1_enclave_id, e2_enclave_id);
         if (status!=SGX_SUCCESS)
@@ -22,10 +22,41 @@
 #include "UntrustedEnclaveMessageExchange.h"
 #include "sgx_dh.h"
 #include <map>
+#include <utility>
+#include <pthread.h>
+#include <limits.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <unistd.h>
 
 std::map<sgx_enclave_id_t, uint32_t>g_enclave_id_map;
 std::map<sgx_enclave_id_t, std::map<sgx_enclave_id_t, size_t> >g_session_ptr_map;
 
+// One shared ring per (source, destination) pair, handed to both enclaves.
+// The doorbell word the enclaves bump lives at this offset into the ring
+// header; the layout is owned by the trusted bus module.
+#define MSG_BUS_DOORBELL_OFFSET 12
+
+static std::map<std::pair<sgx_enclave_id_t, sgx_enclave_id_t>, void*> g_msg_bus_ring_map;
+static pthread_mutex_t g_msg_bus_ring_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void* msg_bus_find_ring(sgx_enclave_id_t src_enclave_id, sgx_enclave_id_t dest_enclave_id)
+{
+	void* ring = NULL;
+
+	pthread_mutex_lock(&g_msg_bus_ring_lock);
+	std::map<std::pair<sgx_enclave_id_t, sgx_enclave_id_t>, void*>::iterator it =
+		g_msg_bus_ring_map.find(std::make_pair(src_enclave_id, dest_enclave_id));
+	if(it != g_msg_bus_ring_map.end())
+	{
+		ring = it->second;
+	}
+	pthread_mutex_unlock(&g_msg_bus_ring_lock);
+
+	return ring;
+}
+
 //Makes an sgx_ecall to the destination enclave to get session id and message1
 ATTESTATION_STATUS session_request_ocall(sgx_enclave_id_t src_enclave_id, sgx_enclave_id_t dest_enclave_id, sgx_dh_msg1_t* dh_msg1)
 {
@@ -58,17 +89,10 @@ ATTESTATION_STATUS session_request_ocall(sgx_enclave_id_t src_enclave_id, sgx_en
 	}
 	if (ret == SGX_SUCCESS)
 	{
-		std::map<sgx_enclave_id_t, std::map<sgx_enclave_id_t, size_t> >::iterator it_ptr = g_session_ptr_map.find(dest_enclave_id);
-		if(it_ptr != g_session_ptr_map.end())
-		{
-			it_ptr->second.insert(std::pair<sgx_enclave_id_t, size_t>(src_enclave_id, session_ptr));
-		}
-		else
-		{
-			std::map<sgx_enclave_id_t, size_t> sub_map;
-			sub_map.insert(std::pair<sgx_enclave_id_t, size_t>(src_enclave_id, session_ptr));
-			g_session_ptr_map.insert(std::pair<sgx_enclave_id_t, std::map<sgx_enclave_id_t, size_t> >(dest_enclave_id, sub_map));
-		}
+		// Overwrite any previous pointer for this pair; insert() would keep
+		// the stale one and leak the responder's new session state when the
+		// initiator renegotiates after an idle expiry.
+		g_session_ptr_map[dest_enclave_id][src_enclave_id] = session_ptr;
 
 		return (ATTESTATION_STATUS)status;
 	}
@@ -172,8 +196,72 @@ ATTESTATION_STATUS end_session_ocall(sgx_enclave_id_t src_enclave_id, sgx_enclav
 			break;
 	}
 	if (ret == SGX_SUCCESS)
+	{
+		// The responder freed its session state; drop the dangling pointer.
+		it_ptr->second.erase(src_enclave_id);
 		return (ATTESTATION_STATUS)status;
+	}
 	else
 	    return INVALID_SESSION;
 
 }
+
+//Maps (or returns the existing) shared ring for the enclave pair. Both
+//enclaves of a pair end up with the same mapping; they validate it lies
+//outside enclave memory and never trust its contents.
+void* msg_bus_create_ocall(sgx_enclave_id_t src_enclave_id, sgx_enclave_id_t dest_enclave_id, size_t size)
+{
+	std::pair<sgx_enclave_id_t, sgx_enclave_id_t> ring_key(src_enclave_id, dest_enclave_id);
+	void* ring = NULL;
+
+	pthread_mutex_lock(&g_msg_bus_ring_lock);
+	std::map<std::pair<sgx_enclave_id_t, sgx_enclave_id_t>, void*>::iterator it = g_msg_bus_ring_map.find(ring_key);
+	if(it != g_msg_bus_ring_map.end())
+	{
+		ring = it->second;
+	}
+	else
+	{
+		// Fresh pages are zeroed, so head, tail and doorbell all start at 0.
+		ring = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if(ring == MAP_FAILED)
+		{
+			ring = NULL;
+		}
+		else
+		{
+			g_msg_bus_ring_map[ring_key] = ring;
+		}
+	}
+	pthread_mutex_unlock(&g_msg_bus_ring_lock);
+
+	return ring;
+}
+
+//Wakes any consumer parked on the pair's doorbell futex.
+void msg_bus_signal_ocall(sgx_enclave_id_t src_enclave_id, sgx_enclave_id_t dest_enclave_id)
+{
+	void* ring = msg_bus_find_ring(src_enclave_id, dest_enclave_id);
+	if(ring == NULL)
+	{
+		return;
+	}
+
+	uint32_t* doorbell = (uint32_t*)((char*)ring + MSG_BUS_DOORBELL_OFFSET);
+	syscall(SYS_futex, doorbell, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+}
+
+//Parks the caller until the doorbell moves past the value it last sampled.
+//Returns immediately if the producer got there first; spurious wakeups are
+//fine, the enclave re-checks the ring and calls back in.
+void msg_bus_wait_ocall(sgx_enclave_id_t src_enclave_id, sgx_enclave_id_t dest_enclave_id, uint32_t seen)
+{
+	void* ring = msg_bus_find_ring(src_enclave_id, dest_enclave_id);
+	if(ring == NULL)
+	{
+		return;
+	}
+
+	uint32_t* doorbell = (uint32_t*)((char*)ring + MSG_BUS_DOORBELL_OFFSET);
+	syscall(SYS_futex, doorbell, FUTEX_WAIT, seen, NULL, NULL, 0);
+}
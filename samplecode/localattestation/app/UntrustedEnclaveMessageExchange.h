@@ -45,6 +45,10 @@ uint32_t session_request_ocall(sgx_enclave_id_t src_enclave_id, sgx_enclave_id_t
 uint32_t exchange_report_ocall(sgx_enclave_id_t src_enclave_id, sgx_enclave_id_t dest_enclave_id, sgx_dh_msg2_t* dh_msg2, sgx_dh_msg3_t* dh_msg3);
 uint32_t end_session_ocall(sgx_enclave_id_t src_enclave_id, sgx_enclave_id_t dest_enclave_id);
 
+void* msg_bus_create_ocall(sgx_enclave_id_t src_enclave_id, sgx_enclave_id_t dest_enclave_id, size_t size);
+void msg_bus_signal_ocall(sgx_enclave_id_t src_enclave_id, sgx_enclave_id_t dest_enclave_id);
+void msg_bus_wait_ocall(sgx_enclave_id_t src_enclave_id, sgx_enclave_id_t dest_enclave_id, uint32_t seen);
+
 #ifdef __cplusplus
 }
 #endif
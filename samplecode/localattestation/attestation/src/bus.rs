@@ -0,0 +1,395 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License..
+
+//! Shared-memory message bus between enclaves with an established session.
+//!
+//! Once the sgx_dh handshake has produced a session key, payloads no longer
+//! need the ECALL -> OCALL -> ECALL transition chain: the sender seals each
+//! frame with AES-GCM under the session key and publishes it into an
+//! untrusted single-producer/single-consumer slot ring, and the receiver
+//! unseals it in place. Steady-state cost is one memcpy plus one AES pass
+//! per side; ocalls only happen to ring the doorbell when the receiver is
+//! asleep or to block when the ring is empty.
+//!
+//! Ring layout in untrusted memory (one ring per (src, dest) direction):
+//!
+//!   offset  0: u32 slot count
+//!   offset  4: u32 head  - consumer slot counter
+//!   offset  8: u32 tail  - producer slot counter
+//!   offset 12: u32 doorbell - futex word bumped by the producer
+//!   offset 64: slots, MSG_BUS_SLOT_SIZE bytes each:
+//!                u32 payload length, 12-byte IV, 16-byte GCM tag, payload
+//!
+//! Everything in the ring is attacker-writable; both sides copy a frame into
+//! enclave memory before trusting any of it, and the GCM tag authenticates
+//! length, direction and slot counter through the IV construction.
+//!
+//! Multicast frames (flagged in the slot length word) avoid re-encrypting a
+//! fan-out payload per subscriber: the payload is sealed once under a fresh
+//! content key, and each subscriber's frame carries only that key wrapped
+//! under the pair's session key, ahead of the shared ciphertext:
+//!
+//!                u32 payload length | flag, wrap IV, wrap tag,
+//!                wrapped content key, content IV, content tag, payload
+
+use sgx_types::*;
+use sgx_trts::trts::{rsgx_raw_is_outside_enclave, rsgx_read_rand};
+use sgx_tcrypto::{rsgx_rijndael128GCM_encrypt, rsgx_rijndael128GCM_decrypt};
+use std::boxed::Box;
+use std::collections::BTreeMap;
+use std::sync::atomic::{AtomicU32, AtomicPtr, Ordering};
+use std::sync::SgxMutex;
+use std::vec::Vec;
+use std::vec;
+
+use err::*;
+use func::get_session_key;
+
+pub const MSG_BUS_SLOTS: u32 = 64;
+pub const MSG_BUS_SLOT_SIZE: usize = 1024;
+const RING_HDR_SIZE: usize = 64;
+const SLOT_HDR_SIZE: usize = 4 + SGX_AESGCM_IV_SIZE + SGX_AESGCM_MAC_SIZE;
+pub const MSG_BUS_MAX_PAYLOAD: usize = MSG_BUS_SLOT_SIZE - SLOT_HDR_SIZE;
+
+// Length-word flag marking a multicast frame; the body then starts with the
+// wrapped content key, content IV and content tag.
+const MSG_BUS_MCAST_FLAG: u32 = 0x8000_0000;
+const MCAST_HDR_SIZE: usize = SGX_AESGCM_KEY_SIZE + SGX_AESGCM_IV_SIZE + SGX_AESGCM_MAC_SIZE;
+pub const MSG_BUS_MAX_MCAST_PAYLOAD: usize = MSG_BUS_MAX_PAYLOAD - MCAST_HDR_SIZE;
+
+const OFFSET_HEAD: usize = 4;
+const OFFSET_TAIL: usize = 8;
+const OFFSET_DOORBELL: usize = 12;
+
+extern {
+    fn msg_bus_create_ocall(ring: *mut *mut u8,
+                            src_enclave_id: sgx_enclave_id_t,
+                            dest_enclave_id: sgx_enclave_id_t,
+                            size: size_t) -> sgx_status_t;
+
+    fn msg_bus_signal_ocall(src_enclave_id: sgx_enclave_id_t,
+                            dest_enclave_id: sgx_enclave_id_t) -> sgx_status_t;
+
+    fn msg_bus_wait_ocall(src_enclave_id: sgx_enclave_id_t,
+                          dest_enclave_id: sgx_enclave_id_t,
+                          seen: u32) -> sgx_status_t;
+}
+
+static RING_MAP: AtomicPtr<()> = AtomicPtr::new(0 as * mut ());
+
+fn get_ring_map() -> &'static SgxMutex<BTreeMap<(sgx_enclave_id_t, sgx_enclave_id_t), usize>> {
+    let mut ptr = RING_MAP.load(Ordering::SeqCst)
+        as * mut SgxMutex<BTreeMap<(sgx_enclave_id_t, sgx_enclave_id_t), usize>>;
+    if ptr.is_null() {
+        let map = Box::into_raw(Box::new(SgxMutex::new(BTreeMap::new())));
+        match RING_MAP.compare_exchange(0 as * mut (), map as * mut (), Ordering::SeqCst, Ordering::SeqCst) {
+            Ok(_) => ptr = map,
+            Err(cur) => {
+                let _ = unsafe { Box::from_raw(map) };
+                ptr = cur as * mut _;
+            }
+        }
+    }
+    unsafe { &* ptr }
+}
+
+fn ring_size() -> usize {
+    RING_HDR_SIZE + MSG_BUS_SLOTS as usize * MSG_BUS_SLOT_SIZE
+}
+
+// Map (src, dest) to the untrusted ring base, asking the untrusted runtime
+// to create it on first use. The pointer is validated to lie fully outside
+// the enclave before it is cached.
+fn get_ring(src_enclave_id: sgx_enclave_id_t, dest_enclave_id: sgx_enclave_id_t) -> Option<*mut u8> {
+    let map = get_ring_map();
+
+    {
+        let rings = map.lock().unwrap();
+        if let Some(&base) = rings.get(&(src_enclave_id, dest_enclave_id)) {
+            return Some(base as *mut u8);
+        }
+    }
+
+    let mut base: *mut u8 = 0 as *mut u8;
+    let status = unsafe {
+        msg_bus_create_ocall(&mut base, src_enclave_id, dest_enclave_id, ring_size())
+    };
+    if status != sgx_status_t::SGX_SUCCESS || base.is_null() {
+        return None;
+    }
+    if !rsgx_raw_is_outside_enclave(base, ring_size()) {
+        return None;
+    }
+
+    let mut rings = map.lock().unwrap();
+    rings.insert((src_enclave_id, dest_enclave_id), base as usize);
+    Some(base)
+}
+
+fn ring_word(base: *mut u8, offset: usize) -> &'static AtomicU32 {
+    unsafe { &*(base.add(offset) as *const AtomicU32) }
+}
+
+fn slot_ptr(base: *mut u8, index: u32) -> *mut u8 {
+    unsafe { base.add(RING_HDR_SIZE + (index % MSG_BUS_SLOTS) as usize * MSG_BUS_SLOT_SIZE) }
+}
+
+// Frame IV: direction and slot counter. Unique per key because each slot
+// counter value is used once per direction for the lifetime of a session.
+fn frame_iv(src_enclave_id: sgx_enclave_id_t, index: u32) -> [u8; SGX_AESGCM_IV_SIZE] {
+    let mut iv = [0_u8; SGX_AESGCM_IV_SIZE];
+    iv[..8].copy_from_slice(&src_enclave_id.to_le_bytes());
+    iv[8..12].copy_from_slice(&index.to_le_bytes());
+    iv
+}
+
+// Wait for a free slot on the pair's ring. The producer owns tail, so only
+// head can move under us and the claimed index stays valid until
+// commit_frame advances it; this poll costs no transitions.
+fn claim_slot(base: *mut u8) -> Option<u32> {
+    let tail = ring_word(base, OFFSET_TAIL).load(Ordering::Relaxed);
+    let mut spins = 0_u32;
+    while tail.wrapping_sub(ring_word(base, OFFSET_HEAD).load(Ordering::Acquire)) >= MSG_BUS_SLOTS {
+        spins += 1;
+        if spins > 1_000_000 {
+            return None;
+        }
+    }
+    Some(tail)
+}
+
+// Write a sealed frame into its claimed slot and make it visible to the
+// consumer.
+fn commit_frame(base: *mut u8,
+                tail: u32,
+                len_word: u32,
+                iv: &[u8; SGX_AESGCM_IV_SIZE],
+                mac: &[u8; SGX_AESGCM_MAC_SIZE],
+                body: &[u8]) {
+    unsafe {
+        let slot = slot_ptr(base, tail);
+        core::ptr::copy_nonoverlapping(len_word.to_le_bytes().as_ptr(), slot, 4);
+        core::ptr::copy_nonoverlapping(iv.as_ptr(), slot.add(4), SGX_AESGCM_IV_SIZE);
+        core::ptr::copy_nonoverlapping(mac.as_ptr(), slot.add(4 + SGX_AESGCM_IV_SIZE), SGX_AESGCM_MAC_SIZE);
+        core::ptr::copy_nonoverlapping(body.as_ptr(), slot.add(SLOT_HDR_SIZE), body.len());
+    }
+    ring_word(base, OFFSET_TAIL).store(tail.wrapping_add(1), Ordering::Release);
+    ring_word(base, OFFSET_DOORBELL).fetch_add(1, Ordering::Release);
+}
+
+/// Seal `payload` under the warm session key for (src, dest) and publish it
+/// on the pair's ring. Spins briefly when the ring is full; the consumer
+/// only needs a memcpy and an AES pass to drain a slot.
+pub fn bus_send(src_enclave_id: sgx_enclave_id_t,
+                dest_enclave_id: sgx_enclave_id_t,
+                payload: &[u8]) -> ATTESTATION_STATUS {
+
+    if payload.is_empty() || payload.len() > MSG_BUS_MAX_PAYLOAD {
+        return ATTESTATION_STATUS::INVALID_PARAMETER;
+    }
+
+    let key = match get_session_key(src_enclave_id, dest_enclave_id) {
+        Some(key) => key,
+        None => return ATTESTATION_STATUS::INVALID_SESSION,
+    };
+
+    let base = match get_ring(src_enclave_id, dest_enclave_id) {
+        Some(base) => base,
+        None => return ATTESTATION_STATUS::ATTESTATION_SE_ERROR,
+    };
+
+    let tail = match claim_slot(base) {
+        Some(tail) => tail,
+        None => return ATTESTATION_STATUS::NO_AVAILABLE_SESSION_ERROR,
+    };
+
+    let iv = frame_iv(src_enclave_id, tail);
+    let aad: [u8; 0] = [0; 0];
+    let mut ciphertext: Vec<u8> = vec![0; payload.len()];
+    let mut mac = [0_u8; SGX_AESGCM_MAC_SIZE];
+
+    let ret = rsgx_rijndael128GCM_encrypt(&key, payload, &iv, &aad, ciphertext.as_mut_slice(), &mut mac);
+    if ret.is_err() {
+        return ATTESTATION_STATUS::ENCRYPT_DECRYPT_ERROR;
+    }
+
+    commit_frame(base, tail, payload.len() as u32, &iv, &mac, &ciphertext);
+
+    // Wake a receiver that went to sleep on the doorbell.
+    let _ = unsafe { msg_bus_signal_ocall(src_enclave_id, dest_enclave_id) };
+
+    ATTESTATION_STATUS::SUCCESS
+}
+
+/// Seal `payload` once under a fresh content key and publish it to every
+/// destination, wrapping only the 16-byte content key per session. The bulk
+/// AES pass runs once however many subscribers there are; each destination
+/// costs a key wrap plus a memcpy into its ring. Receivers open the frame
+/// through the normal [`bus_recv`] path.
+///
+/// Every destination needs a warm session; a missing one fails the call
+/// before anything is published.
+pub fn bus_multicast(src_enclave_id: sgx_enclave_id_t,
+                     dest_enclave_ids: &[sgx_enclave_id_t],
+                     payload: &[u8]) -> ATTESTATION_STATUS {
+
+    if dest_enclave_ids.is_empty() || payload.is_empty() || payload.len() > MSG_BUS_MAX_MCAST_PAYLOAD {
+        return ATTESTATION_STATUS::INVALID_PARAMETER;
+    }
+
+    let mut session_keys: Vec<sgx_key_128bit_t> = Vec::with_capacity(dest_enclave_ids.len());
+    for dest in dest_enclave_ids {
+        match get_session_key(src_enclave_id, *dest) {
+            Some(key) => session_keys.push(key),
+            None => return ATTESTATION_STATUS::INVALID_SESSION,
+        }
+    }
+
+    // One bulk encryption under a throwaway content key; the loop below
+    // never touches the payload again.
+    let mut content_key = sgx_key_128bit_t::default();
+    let mut content_iv = [0_u8; SGX_AESGCM_IV_SIZE];
+    if rsgx_read_rand(&mut content_key).is_err() || rsgx_read_rand(&mut content_iv).is_err() {
+        return ATTESTATION_STATUS::ENCRYPT_DECRYPT_ERROR;
+    }
+
+    let aad: [u8; 0] = [0; 0];
+    let mut body: Vec<u8> = vec![0; MCAST_HDR_SIZE + payload.len()];
+    let mut content_mac = [0_u8; SGX_AESGCM_MAC_SIZE];
+    let ret = rsgx_rijndael128GCM_encrypt(&content_key, payload, &content_iv, &aad,
+                                          &mut body[MCAST_HDR_SIZE..], &mut content_mac);
+    if ret.is_err() {
+        return ATTESTATION_STATUS::ENCRYPT_DECRYPT_ERROR;
+    }
+    body[SGX_AESGCM_KEY_SIZE..SGX_AESGCM_KEY_SIZE + SGX_AESGCM_IV_SIZE].copy_from_slice(&content_iv);
+    body[SGX_AESGCM_KEY_SIZE + SGX_AESGCM_IV_SIZE..MCAST_HDR_SIZE].copy_from_slice(&content_mac);
+
+    for (dest, key) in dest_enclave_ids.iter().zip(session_keys.iter()) {
+        let base = match get_ring(src_enclave_id, *dest) {
+            Some(base) => base,
+            None => return ATTESTATION_STATUS::ATTESTATION_SE_ERROR,
+        };
+        let tail = match claim_slot(base) {
+            Some(tail) => tail,
+            None => return ATTESTATION_STATUS::NO_AVAILABLE_SESSION_ERROR,
+        };
+
+        // Wrap the content key under this pair's session key; the wrap IV
+        // binds the frame to its slot and direction exactly like unicast.
+        let iv = frame_iv(src_enclave_id, tail);
+        let mut wrapped_key = [0_u8; SGX_AESGCM_KEY_SIZE];
+        let mut wrap_mac = [0_u8; SGX_AESGCM_MAC_SIZE];
+        let ret = rsgx_rijndael128GCM_encrypt(key, &content_key, &iv, &aad, &mut wrapped_key, &mut wrap_mac);
+        if ret.is_err() {
+            return ATTESTATION_STATUS::ENCRYPT_DECRYPT_ERROR;
+        }
+        body[..SGX_AESGCM_KEY_SIZE].copy_from_slice(&wrapped_key);
+
+        commit_frame(base, tail, body.len() as u32 | MSG_BUS_MCAST_FLAG, &iv, &wrap_mac, &body);
+        let _ = unsafe { msg_bus_signal_ocall(src_enclave_id, *dest) };
+    }
+
+    ATTESTATION_STATUS::SUCCESS
+}
+
+/// Take the next frame off the (src, dest) ring and unseal it with the
+/// responder's session key, blocking on the doorbell futex when the ring is
+/// empty. Opens unicast and multicast frames alike. The frame is copied
+/// into enclave memory before any of it is trusted.
+pub fn bus_recv(key: &sgx_key_128bit_t,
+                src_enclave_id: sgx_enclave_id_t,
+                dest_enclave_id: sgx_enclave_id_t,
+                out: &mut Vec<u8>) -> ATTESTATION_STATUS {
+
+    let base = match get_ring(src_enclave_id, dest_enclave_id) {
+        Some(base) => base,
+        None => return ATTESTATION_STATUS::ATTESTATION_SE_ERROR,
+    };
+
+    let head = ring_word(base, OFFSET_HEAD).load(Ordering::Relaxed);
+    loop {
+        let doorbell = ring_word(base, OFFSET_DOORBELL).load(Ordering::Acquire);
+        if ring_word(base, OFFSET_TAIL).load(Ordering::Acquire) != head {
+            break;
+        }
+        // Sample-then-sleep: a publish between the doorbell read and the
+        // futex wait changes the word and makes the wait return at once.
+        let _ = unsafe { msg_bus_wait_ocall(src_enclave_id, dest_enclave_id, doorbell) };
+    }
+
+    // Copy the whole frame in before looking at it.
+    let mut len_bytes = [0_u8; 4];
+    let mut iv = [0_u8; SGX_AESGCM_IV_SIZE];
+    let mut mac = [0_u8; SGX_AESGCM_MAC_SIZE];
+    let slot = slot_ptr(base, head);
+    unsafe {
+        core::ptr::copy_nonoverlapping(slot, len_bytes.as_mut_ptr(), 4);
+    }
+    let len_word = u32::from_le_bytes(len_bytes);
+    let is_mcast = len_word & MSG_BUS_MCAST_FLAG != 0;
+    let len = (len_word & !MSG_BUS_MCAST_FLAG) as usize;
+    let min_len = if is_mcast { MCAST_HDR_SIZE + 1 } else { 1 };
+    if len < min_len || len > MSG_BUS_MAX_PAYLOAD {
+        // Poisoned slot; drop it so the ring keeps moving.
+        ring_word(base, OFFSET_HEAD).store(head.wrapping_add(1), Ordering::Release);
+        return ATTESTATION_STATUS::ENCRYPT_DECRYPT_ERROR;
+    }
+
+    let mut ciphertext: Vec<u8> = vec![0; len];
+    unsafe {
+        core::ptr::copy_nonoverlapping(slot.add(4), iv.as_mut_ptr(), SGX_AESGCM_IV_SIZE);
+        core::ptr::copy_nonoverlapping(slot.add(4 + SGX_AESGCM_IV_SIZE), mac.as_mut_ptr(), SGX_AESGCM_MAC_SIZE);
+        core::ptr::copy_nonoverlapping(slot.add(SLOT_HDR_SIZE), ciphertext.as_mut_ptr(), len);
+    }
+
+    // The sender binds the frame to its slot counter via the IV; reject a
+    // frame replayed into a different slot.
+    if iv != frame_iv(src_enclave_id, head) {
+        ring_word(base, OFFSET_HEAD).store(head.wrapping_add(1), Ordering::Release);
+        return ATTESTATION_STATUS::ENCRYPT_DECRYPT_ERROR;
+    }
+
+    let aad: [u8; 0] = [0; 0];
+    out.clear();
+
+    let ret = if is_mcast {
+        // Unwrap the content key under the session key, then open the bulk
+        // ciphertext the sender sealed once for every subscriber.
+        let mut content_key = sgx_key_128bit_t::default();
+        let mut content_iv = [0_u8; SGX_AESGCM_IV_SIZE];
+        let mut content_mac = [0_u8; SGX_AESGCM_MAC_SIZE];
+        content_iv.copy_from_slice(&ciphertext[SGX_AESGCM_KEY_SIZE..SGX_AESGCM_KEY_SIZE + SGX_AESGCM_IV_SIZE]);
+        content_mac.copy_from_slice(&ciphertext[SGX_AESGCM_KEY_SIZE + SGX_AESGCM_IV_SIZE..MCAST_HDR_SIZE]);
+
+        out.resize(len - MCAST_HDR_SIZE, 0);
+        rsgx_rijndael128GCM_decrypt(key, &ciphertext[..SGX_AESGCM_KEY_SIZE], &iv, &aad, &mac, &mut content_key)
+            .and_then(|_| rsgx_rijndael128GCM_decrypt(&content_key, &ciphertext[MCAST_HDR_SIZE..],
+                                                      &content_iv, &aad, &content_mac, out.as_mut_slice()))
+    } else {
+        out.resize(len, 0);
+        rsgx_rijndael128GCM_decrypt(key, ciphertext.as_slice(), &iv, &aad, &mac, out.as_mut_slice())
+    };
+
+    ring_word(base, OFFSET_HEAD).store(head.wrapping_add(1), Ordering::Release);
+
+    if ret.is_err() {
+        out.clear();
+        return ATTESTATION_STATUS::ENCRYPT_DECRYPT_ERROR;
+    }
+
+    ATTESTATION_STATUS::SUCCESS
+}
@@ -0,0 +1,278 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License..
+
+//! Artifact cache daemon served over the attested message bus.
+//!
+//! When several enclaves on one host each need the same derived artifact -
+//! a validated config, a precomputed table, an unpacked model - the naive
+//! layout computes and seals it once per enclave. The cache daemon pattern
+//! moves that work into one enclave: peers authenticate to the daemon via
+//! the normal sgx_dh handshake, then fetch artifacts over the session-keyed
+//! shared-memory bus, so each artifact is built once per host instead of
+//! once per enclave.
+//!
+//! The daemon keeps artifacts sealed at rest (MRSIGNER policy of the daemon
+//! enclave itself) and unseals on demand. They are served as plaintext over
+//! the bus rather than as sealed blobs because the peers are separately
+//! signed enclaves that could not unseal the daemon's blobs anyway; the bus
+//! frames are already AES-GCM protected under the per-pair session key, and
+//! the daemon's identity callback has vetted the peer before any key exists.
+//!
+//! Wire protocol on the bus (one request per [`cache_serve_one`] call):
+//!
+//!   peer -> daemon:  [CACHE_OP_GET] [name length u8] [name bytes]
+//!   daemon -> peer:  [CACHE_OP_HDR] [status u8] [artifact length u32 LE]
+//!                    then the artifact in bus-sized chunks when status is 0
+//!
+//! The bus is an ordered single-producer/single-consumer ring with every
+//! frame authenticated and bound to its slot counter, so the chunks need no
+//! per-chunk framing of their own.
+
+use sgx_types::*;
+use sgx_tseal::SgxSealedData;
+use std::boxed::Box;
+use std::collections::BTreeMap;
+use std::sync::atomic::{AtomicPtr, Ordering};
+use std::sync::SgxMutex;
+use std::vec::Vec;
+use std::vec;
+
+use err::*;
+use func::{get_session_key, register_session_key};
+use bus::{bus_send, bus_recv, MSG_BUS_MAX_PAYLOAD};
+
+const CACHE_OP_GET: u8 = 1;
+const CACHE_OP_HDR: u8 = 2;
+const CACHE_HDR_SIZE: usize = 2 + 4;
+
+const CACHE_STATUS_OK: u8 = 0;
+const CACHE_STATUS_MISS: u8 = 1;
+
+/// Longest artifact name, bounded by the one-byte length in the request.
+pub const CACHE_MAX_NAME: usize = 255;
+/// Largest artifact the daemon will build or a peer will accept.
+pub const CACHE_MAX_ARTIFACT: usize = 1024 * 1024;
+
+/// Produces the artifact for a name the cache has not seen yet. Runs inside
+/// the daemon under the cache lock, so concurrent requests for the same
+/// name build it exactly once; return None for names the daemon does not
+/// recognize or cannot build.
+pub type ArtifactBuilder = fn(name: &[u8]) -> Option<Vec<u8>>;
+
+struct CacheState {
+    // Name -> raw sealed log; unsealed per request, never stored plaintext.
+    sealed: BTreeMap<Vec<u8>, Vec<u8>>,
+    builder: Option<ArtifactBuilder>,
+}
+
+static CACHE_STATE: AtomicPtr<()> = AtomicPtr::new(0 as * mut ());
+
+fn get_cache_state() -> &'static SgxMutex<CacheState> {
+    let mut ptr = CACHE_STATE.load(Ordering::SeqCst) as * mut SgxMutex<CacheState>;
+    if ptr.is_null() {
+        let state = Box::into_raw(Box::new(SgxMutex::new(CacheState {
+            sealed: BTreeMap::new(),
+            builder: None,
+        })));
+        match CACHE_STATE.compare_exchange(0 as * mut (), state as * mut (), Ordering::SeqCst, Ordering::SeqCst) {
+            Ok(_) => ptr = state,
+            Err(cur) => {
+                let _ = unsafe { Box::from_raw(state) };
+                ptr = cur as * mut _;
+            }
+        }
+    }
+    unsafe { &* ptr }
+}
+
+// Seal an artifact for at-rest storage, with the name as AAD so a log
+// cannot be replayed under a different name.
+fn seal_artifact(name: &[u8], plaintext: &[u8]) -> Option<Vec<u8>> {
+    let sealed_data = SgxSealedData::<[u8]>::seal_data(name, plaintext).ok()?;
+    let sealed_size = SgxSealedData::<[u8]>::calc_raw_sealed_data_size(name.len() as u32, plaintext.len() as u32);
+    if sealed_size == u32::MAX {
+        return None;
+    }
+    let mut sealed_log: Vec<u8> = vec![0; sealed_size as usize];
+    unsafe {
+        sealed_data.to_raw_sealed_data_t(sealed_log.as_mut_ptr() as * mut sgx_sealed_data_t, sealed_size)?;
+    }
+    Some(sealed_log)
+}
+
+fn unseal_artifact(sealed_log: &[u8]) -> Option<Vec<u8>> {
+    // from_raw_sealed_data_t wants a mutable log; work on a copy so the
+    // stored entry stays untouched.
+    let mut log = sealed_log.to_vec();
+    let sealed_data = unsafe {
+        SgxSealedData::<[u8]>::from_raw_sealed_data_t(log.as_mut_ptr() as * mut sgx_sealed_data_t, log.len() as u32)?
+    };
+    let unsealed = sealed_data.unseal_data().ok()?;
+    Some(unsealed.get_decrypt_txt().to_vec())
+}
+
+/// Install the daemon's artifact builder. Call once from the daemon
+/// enclave's init path, before serving requests.
+pub fn cache_set_builder(builder: ArtifactBuilder) {
+    get_cache_state().lock().unwrap().builder = Some(builder);
+}
+
+// Look up an artifact by name, building and sealing it on a miss. Holding
+// the lock across the build is what gives the once-per-host guarantee.
+fn lookup_or_build(name: &[u8]) -> Option<Vec<u8>> {
+    let mut state = get_cache_state().lock().unwrap();
+
+    if let Some(sealed_log) = state.sealed.get(name) {
+        return unseal_artifact(sealed_log);
+    }
+
+    let builder = state.builder?;
+    let plaintext = builder(name)?;
+    if plaintext.is_empty() || plaintext.len() > CACHE_MAX_ARTIFACT {
+        return None;
+    }
+    let sealed_log = seal_artifact(name, &plaintext)?;
+    state.sealed.insert(name.to_vec(), sealed_log);
+    Some(plaintext)
+}
+
+/// Serve one artifact request from `peer_enclave_id` on the daemon side,
+/// blocking on the bus until a request arrives.
+///
+/// `key` is the responder's session key for the peer, taken from the
+/// DH session the untrusted side handed back (the same extraction the
+/// receive path uses); it is registered for the reply direction so the
+/// daemon can drive `bus_send` without being the session initiator.
+/// A miss or failed build is answered with a miss header and still counts
+/// as successfully served.
+pub fn cache_serve_one(key: &sgx_key_128bit_t,
+                       peer_enclave_id: sgx_enclave_id_t,
+                       daemon_enclave_id: sgx_enclave_id_t) -> ATTESTATION_STATUS {
+
+    let mut request: Vec<u8> = Vec::new();
+    let status = bus_recv(key, peer_enclave_id, daemon_enclave_id, &mut request);
+    if status != ATTESTATION_STATUS::SUCCESS {
+        return status;
+    }
+
+    if request.len() < 3 || request[0] != CACHE_OP_GET {
+        return ATTESTATION_STATUS::INVALID_REQUEST_TYPE_ERROR;
+    }
+    let name_len = request[1] as usize;
+    if request.len() != 2 + name_len {
+        return ATTESTATION_STATUS::INVALID_PARAMETER;
+    }
+    let name = &request[2..];
+
+    let artifact = lookup_or_build(name);
+
+    // The reply rides the same session key on the (daemon, peer) ring.
+    register_session_key(daemon_enclave_id, peer_enclave_id, key);
+
+    let mut header = [0_u8; CACHE_HDR_SIZE];
+    header[0] = CACHE_OP_HDR;
+    match artifact {
+        Some(ref plaintext) => {
+            header[1] = CACHE_STATUS_OK;
+            header[2..].copy_from_slice(&(plaintext.len() as u32).to_le_bytes());
+        }
+        None => header[1] = CACHE_STATUS_MISS,
+    }
+
+    let status = bus_send(daemon_enclave_id, peer_enclave_id, &header);
+    if status != ATTESTATION_STATUS::SUCCESS {
+        return status;
+    }
+
+    if let Some(plaintext) = artifact {
+        for chunk in plaintext.chunks(MSG_BUS_MAX_PAYLOAD) {
+            let status = bus_send(daemon_enclave_id, peer_enclave_id, chunk);
+            if status != ATTESTATION_STATUS::SUCCESS {
+                return status;
+            }
+        }
+    }
+
+    ATTESTATION_STATUS::SUCCESS
+}
+
+/// Fetch the artifact called `name` from the daemon on the peer side. The
+/// peer must have an established session with the daemon (it is the
+/// initiator, so its warm pool holds the key). Blocks until the daemon
+/// answers; a miss comes back as UNKNOWN_ERROR with `out` cleared.
+pub fn cache_fetch(peer_enclave_id: sgx_enclave_id_t,
+                   daemon_enclave_id: sgx_enclave_id_t,
+                   name: &[u8],
+                   out: &mut Vec<u8>) -> ATTESTATION_STATUS {
+
+    out.clear();
+    if name.is_empty() || name.len() > CACHE_MAX_NAME {
+        return ATTESTATION_STATUS::INVALID_PARAMETER;
+    }
+
+    let key = match get_session_key(peer_enclave_id, daemon_enclave_id) {
+        Some(key) => key,
+        None => return ATTESTATION_STATUS::INVALID_SESSION,
+    };
+
+    let mut request: Vec<u8> = Vec::with_capacity(2 + name.len());
+    request.push(CACHE_OP_GET);
+    request.push(name.len() as u8);
+    request.extend_from_slice(name);
+
+    let status = bus_send(peer_enclave_id, daemon_enclave_id, &request);
+    if status != ATTESTATION_STATUS::SUCCESS {
+        return status;
+    }
+
+    let mut header: Vec<u8> = Vec::new();
+    let status = bus_recv(&key, daemon_enclave_id, peer_enclave_id, &mut header);
+    if status != ATTESTATION_STATUS::SUCCESS {
+        return status;
+    }
+    if header.len() != CACHE_HDR_SIZE || header[0] != CACHE_OP_HDR {
+        return ATTESTATION_STATUS::INVALID_REQUEST_TYPE_ERROR;
+    }
+    if header[1] != CACHE_STATUS_OK {
+        return ATTESTATION_STATUS::UNKNOWN_ERROR;
+    }
+
+    let mut len_bytes = [0_u8; 4];
+    len_bytes.copy_from_slice(&header[2..]);
+    let total_len = u32::from_le_bytes(len_bytes) as usize;
+    if total_len == 0 || total_len > CACHE_MAX_ARTIFACT {
+        return ATTESTATION_STATUS::OUT_BUFFER_LENGTH_ERROR;
+    }
+
+    // Chunks arrive in order on the authenticated ring; collect until the
+    // announced length is reached.
+    let mut chunk: Vec<u8> = Vec::new();
+    while out.len() < total_len {
+        let status = bus_recv(&key, daemon_enclave_id, peer_enclave_id, &mut chunk);
+        if status != ATTESTATION_STATUS::SUCCESS {
+            out.clear();
+            return status;
+        }
+        if chunk.len() > total_len - out.len() {
+            out.clear();
+            return ATTESTATION_STATUS::OUT_BUFFER_LENGTH_ERROR;
+        }
+        out.extend_from_slice(&chunk);
+    }
+
+    ATTESTATION_STATUS::SUCCESS
+}
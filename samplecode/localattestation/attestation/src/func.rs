@@ -22,7 +22,11 @@ use sgx_types::*;
 use sgx_trts::trts::{rsgx_raw_is_outside_enclave, rsgx_lfence};
 use sgx_tdh::{SgxDhMsg1, SgxDhMsg2, SgxDhMsg3, SgxDhInitiator, SgxDhResponder};
 use std::boxed::Box;
+use std::collections::BTreeMap;
+use std::vec::Vec;
 use std::sync::atomic::{AtomicPtr, Ordering};
+use std::sync::SgxMutex;
+use std::time::SystemTime;
 use std::mem;
 
 use types::*;
@@ -47,6 +51,56 @@ extern {
 
 static CALLBACK_FN: AtomicPtr<()> = AtomicPtr::new(0 as * mut ());
 
+// How long an unreferenced session stays warm before it is really closed.
+const SESSION_IDLE_TIMEOUT_SECS: u64 = 60;
+
+// Established session kept warm on the initiator side. The key is retained
+// so steady-state exchanges over the same enclave pair can seal messages
+// without redoing the DH handshake.
+struct PooledSession {
+    dh_aek: sgx_align_key_128bit_t,
+    refcount: u32,
+    last_used: SystemTime,
+}
+
+static SESSION_POOL: AtomicPtr<()> = AtomicPtr::new(0 as * mut ());
+
+fn get_session_pool() -> &'static SgxMutex<BTreeMap<(sgx_enclave_id_t, sgx_enclave_id_t), PooledSession>> {
+    let mut ptr = SESSION_POOL.load(Ordering::SeqCst)
+        as * mut SgxMutex<BTreeMap<(sgx_enclave_id_t, sgx_enclave_id_t), PooledSession>>;
+    if ptr.is_null() {
+        let pool = Box::into_raw(Box::new(SgxMutex::new(BTreeMap::new())));
+        match SESSION_POOL.compare_exchange(0 as * mut (), pool as * mut (), Ordering::SeqCst, Ordering::SeqCst) {
+            Ok(_) => ptr = pool,
+            Err(cur) => {
+                let _ = unsafe { Box::from_raw(pool) };
+                ptr = cur as * mut _;
+            }
+        }
+    }
+    unsafe { &* ptr }
+}
+
+// Really close any unreferenced sessions that sat idle past the timeout.
+fn expire_idle_sessions(pool: &mut BTreeMap<(sgx_enclave_id_t, sgx_enclave_id_t), PooledSession>) {
+    let now = SystemTime::now();
+    let expired: Vec<(sgx_enclave_id_t, sgx_enclave_id_t)> = pool.iter()
+        .filter(|(_, session)| {
+            session.refcount == 0 &&
+            now.duration_since(session.last_used)
+               .map(|idle| idle.as_secs() >= SESSION_IDLE_TIMEOUT_SECS)
+               .unwrap_or(true)
+        })
+        .map(|(pair, _)| *pair)
+        .collect();
+
+    for (src, dest) in expired {
+        pool.remove(&(src, dest));
+        let mut ret = 0;
+        let _ = unsafe { end_session_ocall(&mut ret, src, dest) };
+    }
+}
+
 pub fn init(cb: Callback) {
     let ptr = CALLBACK_FN.load(Ordering::SeqCst);
     if ptr.is_null() {
@@ -65,6 +119,17 @@ fn get_callback() -> Option<&'static Callback>{
 
 pub fn create_session(src_enclave_id: sgx_enclave_id_t, dest_enclave_id: sgx_enclave_id_t) -> ATTESTATION_STATUS {
 
+    // A warm session for this pair skips the two-ocall handshake entirely.
+    {
+        let mut pool = get_session_pool().lock().unwrap();
+        expire_idle_sessions(&mut pool);
+        if let Some(session) = pool.get_mut(&(src_enclave_id, dest_enclave_id)) {
+            session.refcount += 1;
+            session.last_used = SystemTime::now();
+            return ATTESTATION_STATUS::SUCCESS;
+        }
+    }
+
     let mut dh_msg1: SgxDhMsg1 = SgxDhMsg1::default(); //Diffie-Hellman Message 1
     let mut dh_msg2: SgxDhMsg2 = SgxDhMsg2::default(); //Diffie-Hellman Message 2
     let mut dh_aek: sgx_align_key_128bit_t = sgx_align_key_128bit_t::default(); // Session Key
@@ -116,10 +181,30 @@ pub fn create_session(src_enclave_id: sgx_enclave_id_t, dest_enclave_id: sgx_enc
         }
     }
 
+    let mut pool = get_session_pool().lock().unwrap();
+    pool.insert((src_enclave_id, dest_enclave_id), PooledSession {
+        dh_aek: dh_aek,
+        refcount: 1,
+        last_used: SystemTime::now(),
+    });
+
     ATTESTATION_STATUS::SUCCESS
 }
 
 pub fn close_session(src_enclave_id: sgx_enclave_id_t, dest_enclave_id: sgx_enclave_id_t) -> ATTESTATION_STATUS {
+    // Drop our reference but keep the session warm; the responder side is
+    // told to tear down only once the idle timeout expires the entry.
+    {
+        let mut pool = get_session_pool().lock().unwrap();
+        if let Some(session) = pool.get_mut(&(src_enclave_id, dest_enclave_id)) {
+            if session.refcount > 0 {
+                session.refcount -= 1;
+            }
+            session.last_used = SystemTime::now();
+            return ATTESTATION_STATUS::SUCCESS;
+        }
+    }
+
     let mut ret = 0;
     let status = unsafe { end_session_ocall(&mut ret, src_enclave_id, dest_enclave_id) };
     if status != sgx_status_t::SGX_SUCCESS {
@@ -128,6 +213,35 @@ pub fn close_session(src_enclave_id: sgx_enclave_id_t, dest_enclave_id: sgx_encl
     ATTESTATION_STATUS::from_repr(ret as u32).unwrap()
 }
 
+/// Fetch the warm session key for an established pair, refreshing its idle
+/// clock. Message paths use this instead of renegotiating per exchange.
+pub fn get_session_key(src_enclave_id: sgx_enclave_id_t, dest_enclave_id: sgx_enclave_id_t) -> Option<sgx_key_128bit_t> {
+    let mut pool = get_session_pool().lock().unwrap();
+    pool.get_mut(&(src_enclave_id, dest_enclave_id)).map(|session| {
+        session.last_used = SystemTime::now();
+        session.dh_aek.key
+    })
+}
+
+/// Insert an already-negotiated key into the warm pool under (src, dest).
+/// A responder learns its key from the DH exchange rather than through
+/// `create_session`; registering it here lets the responder drive the
+/// send paths (which look keys up by pair) for its reply direction.
+pub fn register_session_key(src_enclave_id: sgx_enclave_id_t, dest_enclave_id: sgx_enclave_id_t, key: &sgx_key_128bit_t) {
+    let mut pool = get_session_pool().lock().unwrap();
+    if let Some(session) = pool.get_mut(&(src_enclave_id, dest_enclave_id)) {
+        session.last_used = SystemTime::now();
+        return;
+    }
+    let mut dh_aek = sgx_align_key_128bit_t::default();
+    dh_aek.key = *key;
+    pool.insert((src_enclave_id, dest_enclave_id), PooledSession {
+        dh_aek: dh_aek,
+        refcount: 1,
+        last_used: SystemTime::now(),
+    });
+}
+
 fn session_request_safe(src_enclave_id: sgx_enclave_id_t, dh_msg1: &mut sgx_dh_msg1_t, session_ptr: &mut usize) -> ATTESTATION_STATUS {
 
     let mut responder = SgxDhResponder::init_session();
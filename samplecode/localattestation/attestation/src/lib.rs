@@ -26,6 +26,8 @@
 #[macro_use]
 extern crate sgx_types;
 extern crate sgx_tdh;
+extern crate sgx_tcrypto;
+extern crate sgx_tseal;
 #[cfg(not(target_env = "sgx"))]
 extern crate sgx_tstd as std;
 extern crate sgx_trts;
@@ -38,3 +40,9 @@ pub use self::types::*;
 
 pub mod func;
 pub use self::func::*;
+
+pub mod bus;
+pub use self::bus::*;
+
+pub mod cache;
+pub use self::cache::*;
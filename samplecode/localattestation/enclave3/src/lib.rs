@@ -24,10 +24,19 @@
 extern crate sgx_types;
 use sgx_types::*;
 
+extern crate sgx_trts;
+use sgx_trts::trts::{rsgx_raw_is_outside_enclave, rsgx_lfence};
+
+#[cfg(not(target_env = "sgx"))]
+extern crate sgx_tstd as std;
+use std::mem;
+use std::vec::Vec;
+
 extern crate attestation;
 use attestation::types::*;
 use attestation::err::*;
 use attestation::func::*;
+use attestation::bus::*;
 
 fn verify_peer_enclave_trust(peer_enclave_identity: &sgx_dh_session_enclave_identity_t )-> u32 {
 
@@ -56,4 +65,28 @@ pub extern "C" fn test_create_session(src_enclave_id: sgx_enclave_id_t, dest_enc
 #[allow(unused_variables)]
 pub extern "C" fn test_close_session(src_enclave_id: sgx_enclave_id_t, dest_enclave_id: sgx_enclave_id_t) -> u32 {
     close_session(src_enclave_id, dest_enclave_id) as u32
+}
+
+#[no_mangle]
+pub extern "C" fn test_send_message(src_enclave_id: sgx_enclave_id_t, dest_enclave_id: sgx_enclave_id_t) -> u32 {
+    let message = b"ping across the shared-memory bus";
+    bus_send(src_enclave_id, dest_enclave_id, message) as u32
+}
+
+#[no_mangle]
+pub extern "C" fn test_recv_message(src_enclave_id: sgx_enclave_id_t, dest_enclave_id: sgx_enclave_id_t, session_ptr: *mut usize) -> u32 {
+
+    if rsgx_raw_is_outside_enclave(session_ptr as * const u8, mem::size_of::<DhSessionInfo>()) {
+        return ATTESTATION_STATUS::INVALID_PARAMETER as u32;
+    }
+    rsgx_lfence();
+
+    let session_info = unsafe { &*(session_ptr as *const DhSessionInfo) };
+    let dh_aek = match session_info.session.session_status {
+        DhSessionStatus::Active(ref dh_aek) => *dh_aek,
+        _ => return ATTESTATION_STATUS::INVALID_SESSION as u32,
+    };
+
+    let mut message: Vec<u8> = Vec::new();
+    bus_recv(&dh_aek.key, src_enclave_id, dest_enclave_id, &mut message) as u32
 }
\ No newline at end of file
@@ -20,11 +20,137 @@ extern crate sgx_urts;
 use sgx_types::*;
 use sgx_urts::SgxEnclave;
 
+use std::fs::File;
+use std::io::{BufWriter, Write};
+use std::slice;
+use std::sync::atomic::{AtomicBool, AtomicU32, Ordering};
+use std::sync::Arc;
+use std::thread;
+use std::time::Duration;
+
 static ENCLAVE_FILE: &'static str = "enclave.signed.so";
+static LOG_FILE: &'static str = "enclave.log";
+
+// Shared-memory log ring; layout must match enclave/src/lib.rs.
+const LOG_RING_HEADER_SIZE: usize = 64;
+const LOG_SLOT_SIZE: usize = 256;
+const LOG_RING_SLOTS: usize = 1024;
+
+const LOG_KIND_TEXT: u8 = 0;
+const LOG_KIND_BINARY: u8 = 1;
+
+// Same message catalog the enclave compiles against.
+#[allow(dead_code)]
+mod log_catalog {
+    include!("../../enclave/src/log_catalog.rs");
+}
+use log_catalog::LOG_CATALOG;
+
+const LOG_LEVEL_NAMES: [&str; 6] = ["", "ERROR", "WARN", "INFO", "DEBUG", "TRACE"];
 
 extern {
     fn say_something(eid: sgx_enclave_id_t, retval: *mut sgx_status_t,
                      some_string: *const u8, len: usize) -> sgx_status_t;
+    fn init_log_ring(eid: sgx_enclave_id_t, retval: *mut sgx_status_t,
+                     ring: *mut u8, slots: usize) -> sgx_status_t;
+    fn get_log_ring_dropped(eid: sgx_enclave_id_t, retval: *mut u64) -> sgx_status_t;
+}
+
+// Expand a binary record against the catalog: level byte, message id,
+// argument count, then tagged raw values. All string formatting
+// deferred from the enclave happens here. The record crossed untrusted
+// memory, so decoding never indexes past the payload; a malformed
+// record comes out as a marker line instead of a panic.
+fn format_binary(payload: &[u8]) -> String {
+    fn arg_to_string(payload: &[u8], off: &mut usize) -> Option<String> {
+        let tag = *payload.get(*off)?;
+        *off += 1;
+        if tag == 4 {
+            let len = *payload.get(*off)? as usize;
+            *off += 1;
+            let bytes = payload.get(*off..*off + len)?;
+            *off += len;
+            return Some(String::from_utf8_lossy(bytes).into_owned());
+        }
+        let bytes = payload.get(*off..*off + 8)?;
+        *off += 8;
+        let mut word = [0u8; 8];
+        word.copy_from_slice(bytes);
+        let word = u64::from_le_bytes(word);
+        match tag {
+            1 => Some(word.to_string()),
+            2 => Some((word as i64).to_string()),
+            3 => Some(f64::from_bits(word).to_string()),
+            _ => None,
+        }
+    }
+
+    let decode = |payload: &[u8]| -> Option<String> {
+        let level = *payload.get(0)? as usize;
+        let mut id = [0u8; 4];
+        id.copy_from_slice(payload.get(1..5)?);
+        let id = u32::from_le_bytes(id) as usize;
+        let nargs = *payload.get(5)? as usize;
+        let fmt = *LOG_CATALOG.get(id)?;
+        let mut off = 6;
+        let mut out = String::new();
+        out.push_str(LOG_LEVEL_NAMES.get(level).unwrap_or(&"?????"));
+        out.push(' ');
+        let mut pieces = fmt.split("{}");
+        out.push_str(pieces.next().unwrap_or(""));
+        for (i, piece) in pieces.enumerate() {
+            if i < nargs {
+                out.push_str(&arg_to_string(payload, &mut off)?);
+            } else {
+                out.push_str("{}");
+            }
+            out.push_str(piece);
+        }
+        Some(out)
+    };
+
+    decode(payload).unwrap_or_else(|| String::from("<malformed log record>"))
+}
+
+// Consume ready slots in order, batching lines through a BufWriter and
+// flushing whenever the ring runs dry. Exits once the ring is empty and
+// the stop flag is set, so no line logged before shutdown is lost.
+fn drain_log_ring(base: usize, stop: Arc<AtomicBool>) {
+    let file = File::create(LOG_FILE).expect("cannot create log file");
+    let mut writer = BufWriter::new(file);
+    let tail_atomic = unsafe { &*(base as *const AtomicU32) };
+    let mut tail: u32 = 0;
+    loop {
+        let slot = base + LOG_RING_HEADER_SIZE
+            + (tail as usize & (LOG_RING_SLOTS - 1)) * LOG_SLOT_SIZE;
+        let ready = unsafe { (*(slot as *const AtomicU32)).load(Ordering::Acquire) };
+        if ready == 0 {
+            let _ = writer.flush();
+            if stop.load(Ordering::Relaxed) {
+                break;
+            }
+            thread::sleep(Duration::from_millis(1));
+            continue;
+        }
+        let len = ((ready - 1) as usize).min(LOG_SLOT_SIZE - 5);
+        let kind = unsafe { *((slot + 4) as *const u8) };
+        let payload = unsafe { slice::from_raw_parts((slot + 5) as *const u8, len) };
+        match kind {
+            LOG_KIND_TEXT => {
+                let _ = writer.write_all(payload);
+            }
+            LOG_KIND_BINARY => {
+                let _ = writer.write_all(format_binary(payload).as_bytes());
+            }
+            _ => {
+                let _ = writer.write_all(b"<unknown log record kind>");
+            }
+        }
+        let _ = writer.write_all(b"\n");
+        unsafe { (*(slot as *const AtomicU32)).store(0, Ordering::Release) };
+        tail = tail.wrapping_add(1);
+        tail_atomic.store(tail, Ordering::Release);
+    }
 }
 
 fn init_enclave() -> SgxResult<SgxEnclave> {
@@ -54,9 +180,30 @@ fn main() {
         },
     };
 
-    let input_string = String::from("This is a normal world string passed into Enclave!\n");
+    // Shared-memory logging: the enclave formats into this ring, the
+    // drainer thread batches the lines into LOG_FILE.
+    let mut ring = vec![0u8; LOG_RING_HEADER_SIZE + LOG_RING_SLOTS * LOG_SLOT_SIZE];
+    let ring_base = ring.as_mut_ptr() as usize;
 
     let mut retval = sgx_status_t::SGX_SUCCESS;
+    let result = unsafe {
+        init_log_ring(enclave.geteid(), &mut retval, ring.as_mut_ptr(), LOG_RING_SLOTS)
+    };
+    match (result, retval) {
+        (sgx_status_t::SGX_SUCCESS, sgx_status_t::SGX_SUCCESS) => {},
+        _ => {
+            println!("[-] init_log_ring failed {} {}!", result.as_str(), retval.as_str());
+            return;
+        }
+    }
+
+    let stop = Arc::new(AtomicBool::new(false));
+    let drainer = {
+        let stop = stop.clone();
+        thread::spawn(move || drain_log_ring(ring_base, stop))
+    };
+
+    let input_string = String::from("This is a normal world string passed into Enclave!\n");
 
     let result = unsafe {
         say_something(enclave.geteid(),
@@ -75,5 +222,20 @@ fn main() {
 
     println!("[+] say_something success...");
 
+    stop.store(true, Ordering::Relaxed);
+    drainer.join().unwrap();
+
+    let mut dropped: u64 = 0;
+    let result = unsafe { get_log_ring_dropped(enclave.geteid(), &mut dropped) };
+    match result {
+        sgx_status_t::SGX_SUCCESS => {
+            println!("[+] log lines written to {}, {} dropped on overflow", LOG_FILE, dropped);
+        },
+        _ => {
+            println!("[-] get_log_ring_dropped failed {}!", result.as_str());
+        }
+    }
+    drop(ring);
+
     enclave.destroy();
 }
@@ -22,12 +22,16 @@
 #![cfg_attr(target_env = "sgx", feature(rustc_private))]
 
 extern crate sgx_types;
+extern crate sgx_trts;
 #[cfg(not(target_env = "sgx"))]
 #[macro_use]
 extern crate sgx_tstd as std;
 
 use sgx_types::*;
+use sgx_trts::trts::rsgx_raw_is_outside_enclave;
+use std::ptr;
 use std::string::String;
+use std::sync::atomic::{AtomicU32, AtomicU64, AtomicUsize, Ordering};
 use std::vec::Vec;
 //use std::io::{self, Write};
 use std::slice;
@@ -35,10 +39,179 @@ use std::slice;
 #[macro_use] extern crate log;
 extern crate env_logger;
 
+#[allow(dead_code)]
+mod log_catalog;
+use log_catalog::{LOG_MSG_ECALL_DONE, LOG_MSG_ECALL_ENTER};
+
+// Shared-memory log ring. Each log line is formatted in the enclave and
+// memcpy'd into a slot of an untrusted ring the app allocated; an
+// untrusted thread batches the lines to disk. No ocall per line.
+//
+// Slot layout: a u32 ready word (0 = empty, otherwise payload length
+// + 1), a kind byte (text or binary record) and the payload. The
+// header is a cache line holding the consumer's tail cursor. The
+// producer cursor and the dropped-line counter stay in trusted memory:
+// the host can at worst clobber line bytes, never make the enclave
+// write outside the ring.
+const LOG_RING_HEADER_SIZE: usize = 64;
+const LOG_SLOT_SIZE: usize = 256;
+const LOG_LINE_MAX: usize = LOG_SLOT_SIZE - 5;
+
+const LOG_KIND_TEXT: u8 = 0;
+const LOG_KIND_BINARY: u8 = 1;
+
+static RING_BASE: AtomicUsize = AtomicUsize::new(0);
+static RING_SLOTS: AtomicUsize = AtomicUsize::new(0);
+static RING_HEAD: AtomicU32 = AtomicU32::new(0);
+static RING_DROPPED: AtomicU64 = AtomicU64::new(0);
+
+fn ring_push(kind: u8, payload: &[u8]) {
+    let base = RING_BASE.load(Ordering::Relaxed);
+    if base == 0 {
+        return;
+    }
+    let slots = RING_SLOTS.load(Ordering::Relaxed);
+    let tail = unsafe { &*(base as *const AtomicU32) };
+    loop {
+        let head = RING_HEAD.load(Ordering::Relaxed);
+        if head.wrapping_sub(tail.load(Ordering::Acquire)) as usize >= slots {
+            RING_DROPPED.fetch_add(1, Ordering::Relaxed);
+            return;
+        }
+        if RING_HEAD.compare_and_swap(head, head.wrapping_add(1), Ordering::Relaxed) == head {
+            let slot = base
+                + LOG_RING_HEADER_SIZE
+                + (head as usize & (slots - 1)) * LOG_SLOT_SIZE;
+            let len = payload.len().min(LOG_LINE_MAX);
+            unsafe {
+                *((slot + 4) as *mut u8) = kind;
+                ptr::copy_nonoverlapping(payload.as_ptr(), (slot + 5) as *mut u8, len);
+                (*(slot as *const AtomicU32)).store(len as u32 + 1, Ordering::Release);
+            }
+            return;
+        }
+    }
+}
+
+// Binary structured logging: a record is the log level, a message id
+// from log_catalog.rs and the raw argument values; the untrusted
+// drainer does all string formatting. Argument encoding: a tag byte
+// (1 u64, 2 i64, 3 f64, 4 str), then 8 little-endian payload bytes, or
+// a length byte plus the bytes for str. Arguments that do not fit the
+// slot are dropped and the recorded argument count lowered to match.
+pub enum SlogArg<'a> {
+    U(u64),
+    I(i64),
+    F(f64),
+    S(&'a str),
+}
+
+impl<'a> From<u64> for SlogArg<'a> { fn from(v: u64) -> Self { SlogArg::U(v) } }
+impl<'a> From<u32> for SlogArg<'a> { fn from(v: u32) -> Self { SlogArg::U(v as u64) } }
+impl<'a> From<usize> for SlogArg<'a> { fn from(v: usize) -> Self { SlogArg::U(v as u64) } }
+impl<'a> From<i64> for SlogArg<'a> { fn from(v: i64) -> Self { SlogArg::I(v) } }
+impl<'a> From<i32> for SlogArg<'a> { fn from(v: i32) -> Self { SlogArg::I(v as i64) } }
+impl<'a> From<f64> for SlogArg<'a> { fn from(v: f64) -> Self { SlogArg::F(v) } }
+impl<'a> From<&'a str> for SlogArg<'a> { fn from(v: &'a str) -> Self { SlogArg::S(v) } }
+
+pub fn slog(level: log::Level, msg: u32, args: &[SlogArg]) {
+    if level > log::max_level() {
+        return;
+    }
+    let mut buf = [0u8; LOG_LINE_MAX];
+    buf[0] = level as u8;
+    buf[1..5].copy_from_slice(&msg.to_le_bytes());
+    let mut off = 6;
+    let mut nargs = 0u8;
+    for arg in args {
+        let (tag, word, bytes): (u8, u64, &[u8]) = match *arg {
+            SlogArg::U(v) => (1, v, &[]),
+            SlogArg::I(v) => (2, v as u64, &[]),
+            SlogArg::F(v) => (3, v.to_bits(), &[]),
+            SlogArg::S(s) => (4, 0, s.as_bytes()),
+        };
+        if tag == 4 {
+            let len = bytes.len().min(255);
+            if off + 2 + len > LOG_LINE_MAX {
+                break;
+            }
+            buf[off] = tag;
+            buf[off + 1] = len as u8;
+            buf[off + 2..off + 2 + len].copy_from_slice(&bytes[..len]);
+            off += 2 + len;
+        } else {
+            if off + 9 > LOG_LINE_MAX {
+                break;
+            }
+            buf[off] = tag;
+            buf[off + 1..off + 9].copy_from_slice(&word.to_le_bytes());
+            off += 9;
+        }
+        nargs += 1;
+    }
+    buf[5] = nargs;
+    ring_push(LOG_KIND_BINARY, &buf[..off]);
+}
+
+macro_rules! slog {
+    ($level:expr, $msg:expr $(, $arg:expr)*) => {
+        slog($level, $msg, &[$(SlogArg::from($arg)),*])
+    };
+}
+
+struct RingLogger;
+
+impl log::Log for RingLogger {
+    fn enabled(&self, metadata: &log::Metadata) -> bool {
+        metadata.level() <= log::max_level()
+    }
+
+    fn log(&self, record: &log::Record) {
+        if !self.enabled(record.metadata()) {
+            return;
+        }
+        let line = format!("{:<5} {} {}", record.level(), record.target(), record.args());
+        ring_push(LOG_KIND_TEXT, line.as_bytes());
+    }
+
+    fn flush(&self) {}
+}
+
+static RING_LOGGER: RingLogger = RingLogger;
+
+#[no_mangle]
+pub extern "C" fn init_log_ring(ring: *mut u8, slots: usize) -> sgx_status_t {
+    if ring.is_null() || slots < 2 || !slots.is_power_of_two() {
+        return sgx_status_t::SGX_ERROR_INVALID_PARAMETER;
+    }
+    let size = LOG_RING_HEADER_SIZE + slots * LOG_SLOT_SIZE;
+    if !rsgx_raw_is_outside_enclave(ring, size) {
+        return sgx_status_t::SGX_ERROR_INVALID_PARAMETER;
+    }
+    RING_SLOTS.store(slots, Ordering::Relaxed);
+    RING_BASE.store(ring as usize, Ordering::Relaxed);
+    if log::set_logger(&RING_LOGGER).is_ok() {
+        log::set_max_level(log::LevelFilter::Trace);
+    }
+    sgx_status_t::SGX_SUCCESS
+}
+
+#[no_mangle]
+pub extern "C" fn get_log_ring_dropped() -> u64 {
+    RING_DROPPED.load(Ordering::Relaxed)
+}
+
 #[no_mangle]
 pub extern "C" fn say_something(some_string: *const u8, some_len: usize) -> sgx_status_t {
 
-    env_logger::init();
+    // Without the shared ring, fall back to ocall-backed logging.
+    if RING_BASE.load(Ordering::Relaxed) == 0 {
+        env_logger::init();
+    }
+
+    // Structured record: no in-enclave formatting, the drainer expands
+    // the message id against the catalog.
+    slog!(log::Level::Info, LOG_MSG_ECALL_ENTER, some_len);
 
     let str_slice = unsafe { slice::from_raw_parts(some_string, some_len) };
     //let _ = io::stdout().write(str_slice);
@@ -66,6 +239,7 @@ pub extern "C" fn say_something(some_string: *const u8, some_len: usize) -> sgx_
     // Ocall to normal world for output
     //println!("{}", &hello_string);
     trace!("{}", hello_string);
+    slog!(log::Level::Trace, LOG_MSG_ECALL_DONE, hello_string.len(), hello_string.as_str());
 
     sgx_status_t::SGX_SUCCESS
 }
@@ -0,0 +1,29 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License..
+
+// Message catalog for binary structured logging. The enclave emits
+// only the message id and raw argument values; the app include!s this
+// same file so the drainer can recover the format string. Arguments
+// substitute the "{}" markers in order.
+
+pub const LOG_MSG_ECALL_ENTER: u32 = 0;
+pub const LOG_MSG_ECALL_DONE: u32 = 1;
+
+pub const LOG_CATALOG: [&str; 2] = [
+    "say_something entered, input length {}",
+    "say_something done, built string of {} chars: {}",
+];
@@ -36,6 +36,8 @@ extern crate sgx_rand as rand;
 extern crate serde;
 extern crate serde_json;
 
+mod minibatch;
+
 use rusty_machine::linalg::{Matrix, BaseMatrix};
 use rusty_machine::learning::k_means::{KMeansClassifier, KPlusPlus};
 use rusty_machine::learning::UnSupModel;
@@ -90,6 +92,7 @@ fn sample_main() -> sgx_status_t {
     kmeans_sample();
     nn_sample();
     iris_sample();
+    minibatch::run_parallel_training();
 
     sgx_status_t::SGX_SUCCESS
 }
@@ -38,6 +38,10 @@ extern {
         socket_fd: c_int, sign_type: sgx_quote_sign_type_t) -> sgx_status_t;
     fn run_client(eid: sgx_enclave_id_t, retval: *mut sgx_status_t,
         socket_fd: c_int, sign_type: sgx_quote_sign_type_t) -> sgx_status_t;
+    fn client_prewarm(eid: sgx_enclave_id_t, retval: *mut sgx_status_t,
+        socket_fd: c_int, sign_type: sgx_quote_sign_type_t) -> sgx_status_t;
+    fn client_pool_size(eid: sgx_enclave_id_t, retval: *mut u64) -> sgx_status_t;
+    fn run_client_pooled(eid: sgx_enclave_id_t, retval: *mut sgx_status_t) -> sgx_status_t;
 }
 
 #[no_mangle]
@@ -154,18 +158,100 @@ enum Mode {
     Server,
 }
 
+fn pool_level(eid: sgx_enclave_id_t) -> u64 {
+    let mut level: u64 = 0;
+    let result = unsafe { client_pool_size(eid, &mut level) };
+    assert_eq!(result, sgx_status_t::SGX_SUCCESS);
+    level
+}
+
+// Speculative pre-establishment: a background thread keeps `target`
+// mutually attested sessions parked in the enclave, so the request
+// below finds a ready session and pays neither the RA exchange nor the
+// handshake. With --pool 0 the old on-demand path runs instead.
+fn run_client_with_pool(eid: sgx_enclave_id_t, sign_type: sgx_quote_sign_type_t, target: u64) {
+    use std::sync::Arc;
+    use std::sync::atomic::{AtomicBool, Ordering};
+    use std::time::{Duration, Instant};
+
+    let done = Arc::new(AtomicBool::new(false));
+    let replenisher = {
+        let done = done.clone();
+        std::thread::spawn(move || {
+            while !done.load(Ordering::Acquire) {
+                if pool_level(eid) >= target {
+                    std::thread::sleep(Duration::from_millis(50));
+                    continue;
+                }
+                let socket = match TcpStream::connect("localhost:3443") {
+                    Ok(socket) => socket,
+                    Err(e) => {
+                        println!("[-] pool connect failed: {:?}", e);
+                        std::thread::sleep(Duration::from_millis(500));
+                        continue;
+                    }
+                };
+                let mut retval = sgx_status_t::SGX_SUCCESS;
+                // the parked session owns the descriptor; hand it over
+                let result = unsafe {
+                    client_prewarm(eid, &mut retval, socket.into_raw_fd(), sign_type)
+                };
+                if result != sgx_status_t::SGX_SUCCESS || retval != sgx_status_t::SGX_SUCCESS {
+                    println!("[-] prewarm failed: {} / {}", result.as_str(), retval.as_str());
+                    std::thread::sleep(Duration::from_millis(500));
+                }
+            }
+        })
+    };
+
+    // wait for the pool to fill - in a real service this is enclave
+    // startup time, long before the first request arrives
+    while pool_level(eid) < target {
+        std::thread::sleep(Duration::from_millis(10));
+    }
+    println!("[+] {} sessions ready", target);
+
+    let start = Instant::now();
+    let mut retval = sgx_status_t::SGX_SUCCESS;
+    let result = unsafe { run_client_pooled(eid, &mut retval) };
+    let elapsed = start.elapsed();
+    match (result, retval) {
+        (sgx_status_t::SGX_SUCCESS, sgx_status_t::SGX_SUCCESS) => {
+            println!("ECALL success! (pooled request took {:?})", elapsed);
+        }
+        (sgx_status_t::SGX_SUCCESS, sgx_status_t::SGX_ERROR_SERVICE_UNAVAILABLE) => {
+            // pool drained; fall back to on-demand establishment
+            println!("[-] pool empty, falling back to on-demand");
+            let socket = TcpStream::connect("localhost:3443").unwrap();
+            let result = unsafe {
+                run_client(eid, &mut retval, socket.as_raw_fd(), sign_type)
+            };
+            assert_eq!(result, sgx_status_t::SGX_SUCCESS);
+        }
+        _ => println!("[-] ECALL Enclave Failed {} / {}!", result.as_str(), retval.as_str()),
+    }
+
+    done.store(true, Ordering::Release);
+    replenisher.join().unwrap();
+}
+
 fn main() {
     let mut mode:Mode = Mode::Server;
     let mut args: Vec<_> = env::args().collect();
     let mut sign_type = sgx_quote_sign_type_t::SGX_LINKABLE_SIGNATURE;
+    let mut pool_target: u64 = 0;
     args.remove(0);
     while !args.is_empty() {
         match args.remove(0).as_ref() {
             "--client" => mode = Mode::Client,
             "--server" => mode = Mode::Server,
             "--unlink" => sign_type = sgx_quote_sign_type_t::SGX_UNLINKABLE_SIGNATURE,
+            "--pool" => {
+                pool_target = args.remove(0).parse()
+                    .expect("--pool takes the number of sessions to keep ready");
+            }
             _ => {
-                panic!("Only --client/server/unlink is accepted");
+                panic!("Only --client/server/unlink/pool is accepted");
             }
         }
     }
@@ -184,43 +270,49 @@ fn main() {
     match mode {
         Mode::Server => {
             println!("Running as server...");
+            // serve connections until killed; prewarmed client sessions
+            // mean several handshakes arrive before any request
             let listener = TcpListener::bind("0.0.0.0:3443").unwrap();
-            //loop{
-            match listener.accept() {
-                Ok((socket, addr)) => {
-                    println!("new client from {:?}", addr);
-                    let mut retval = sgx_status_t::SGX_SUCCESS;
-                    let result = unsafe {
-                        run_server(enclave.geteid(), &mut retval, socket.as_raw_fd(), sign_type)
-                    };
-                    match result {
-                        sgx_status_t::SGX_SUCCESS => {
-                            println!("ECALL success!");
-                        },
-                        _ => {
-                            println!("[-] ECALL Enclave Failed {}!", result.as_str());
-                            return;
+            for socket in listener.incoming() {
+                match socket {
+                    Ok(socket) => {
+                        println!("new client from {:?}", socket.peer_addr());
+                        let mut retval = sgx_status_t::SGX_SUCCESS;
+                        let result = unsafe {
+                            run_server(enclave.geteid(), &mut retval, socket.as_raw_fd(), sign_type)
+                        };
+                        match result {
+                            sgx_status_t::SGX_SUCCESS => {
+                                println!("ECALL success!");
+                            },
+                            _ => {
+                                println!("[-] ECALL Enclave Failed {}!", result.as_str());
+                                return;
+                            }
                         }
                     }
+                    Err(e) => println!("couldn't get client: {:?}", e),
                 }
-                Err(e) => println!("couldn't get client: {:?}", e),
             }
-            //} //loop
         }
         Mode::Client => {
             println!("Running as client...");
-            let socket = TcpStream::connect("localhost:3443").unwrap();
-            let mut retval = sgx_status_t::SGX_SUCCESS;
-            let result = unsafe {
-                run_client(enclave.geteid(), &mut retval, socket.as_raw_fd(), sign_type)
-            };
-            match result {
-                sgx_status_t::SGX_SUCCESS => {
-                    println!("ECALL success!");
-                },
-                _ => {
-                    println!("[-] ECALL Enclave Failed {}!", result.as_str());
-                    return;
+            if pool_target > 0 {
+                run_client_with_pool(enclave.geteid(), sign_type, pool_target);
+            } else {
+                let socket = TcpStream::connect("localhost:3443").unwrap();
+                let mut retval = sgx_status_t::SGX_SUCCESS;
+                let result = unsafe {
+                    run_client(enclave.geteid(), &mut retval, socket.as_raw_fd(), sign_type)
+                };
+                match result {
+                    sgx_status_t::SGX_SUCCESS => {
+                        println!("ECALL success!");
+                    },
+                    _ => {
+                        println!("[-] ECALL Enclave Failed {}!", result.as_str());
+                        return;
+                    }
                 }
             }
         }
@@ -50,7 +50,7 @@ use sgx_tcrypto::*;
 use sgx_rand::*;
 
 use std::prelude::v1::*;
-use std::sync::Arc;
+use std::sync::{Arc, Once, SgxMutex};
 use std::net::TcpStream;
 use std::string::String;
 use std::io;
@@ -579,10 +579,10 @@ impl rustls::ServerCertVerifier for ServerAuth {
     }
 }
 
-#[no_mangle]
-pub extern "C" fn run_server(socket_fd : c_int, sign_type: sgx_quote_sign_type_t) -> sgx_status_t {
-    let _ = backtrace::enable_backtrace("enclave.signed.so", PrintFormat::Short);
-
+// Builds the server identity: one RA round trip, one attested cert.
+// Factored out of run_server so the result can be cached across
+// connections.
+fn make_server_config(sign_type: sgx_quote_sign_type_t) -> Result<rustls::ServerConfig, sgx_status_t> {
     // Generate Keypair
     let ecc_handle = SgxEccHandle::new();
     let _result = ecc_handle.open();
@@ -592,7 +592,7 @@ pub extern "C" fn run_server(socket_fd : c_int, sign_type: sgx_quote_sign_type_t
         Ok(r) => r,
         Err(e) => {
             println!("Error in create_attestation_report: {:?}", e);
-            return e;
+            return Err(e);
         }
     };
 
@@ -601,7 +601,7 @@ pub extern "C" fn run_server(socket_fd : c_int, sign_type: sgx_quote_sign_type_t
         Ok(r) => r,
         Err(e) => {
             println!("Error in gen_ecc_cert: {:?}", e);
-            return e;
+            return Err(e);
         }
     };
     let _result = ecc_handle.close();
@@ -614,7 +614,19 @@ pub extern "C" fn run_server(socket_fd : c_int, sign_type: sgx_quote_sign_type_t
 
     cfg.set_single_cert_with_ocsp_and_sct(certs, privkey, vec![], vec![]).unwrap();
 
-    let mut sess = rustls::ServerSession::new(&Arc::new(cfg));
+    Ok(cfg)
+}
+
+#[no_mangle]
+pub extern "C" fn run_server(socket_fd : c_int, sign_type: sgx_quote_sign_type_t) -> sgx_status_t {
+    let _ = backtrace::enable_backtrace("enclave.signed.so", PrintFormat::Short);
+
+    let cfg = match cached_server_config(sign_type) {
+        Ok(cfg) => cfg,
+        Err(e) => return e,
+    };
+
+    let mut sess = rustls::ServerSession::new(&cfg);
     let mut conn = TcpStream::new(socket_fd).unwrap();
 
     let mut tls = rustls::Stream::new(&mut sess, &mut conn);
@@ -633,10 +645,9 @@ pub extern "C" fn run_server(socket_fd : c_int, sign_type: sgx_quote_sign_type_t
 }
 
 
-#[no_mangle]
-pub extern "C" fn run_client(socket_fd : c_int, sign_type: sgx_quote_sign_type_t) -> sgx_status_t {
-    let _ = backtrace::enable_backtrace("enclave.signed.so", PrintFormat::Short);
-
+// Client identity: same shape as the server side, cached for the same
+// reason - the RA exchange belongs to the enclave, not the connection.
+fn make_client_config(sign_type: sgx_quote_sign_type_t) -> Result<rustls::ClientConfig, sgx_status_t> {
     // Generate Keypair
     let ecc_handle = SgxEccHandle::new();
     ecc_handle.open().unwrap();
@@ -646,7 +657,7 @@ pub extern "C" fn run_client(socket_fd : c_int, sign_type: sgx_quote_sign_type_t
         Ok(r) => r,
         Err(e) => {
             println!("Error in create_attestation_report: {:?}", e);
-            return e;
+            return Err(e);
         }
     };
 
@@ -656,7 +667,7 @@ pub extern "C" fn run_client(socket_fd : c_int, sign_type: sgx_quote_sign_type_t
         Ok(r) => r,
         Err(e) => {
             println!("Error in gen_ecc_cert: {:?}", e);
-            return e;
+            return Err(e);
         }
     };
     ecc_handle.close().unwrap();
@@ -672,10 +683,141 @@ pub extern "C" fn run_client(socket_fd : c_int, sign_type: sgx_quote_sign_type_t
     cfg.versions.clear();
     cfg.versions.push(rustls::ProtocolVersion::TLSv1_2);
 
+    Ok(cfg)
+}
+
+#[no_mangle]
+pub extern "C" fn run_client(socket_fd : c_int, sign_type: sgx_quote_sign_type_t) -> sgx_status_t {
+    let _ = backtrace::enable_backtrace("enclave.signed.so", PrintFormat::Short);
+
+    let cfg = match cached_client_config(sign_type) {
+        Ok(cfg) => cfg,
+        Err(e) => return e,
+    };
+
+    let dns_name = webpki::DNSNameRef::try_from_ascii_str("localhost").unwrap();
+    let mut sess = rustls::ClientSession::new(&cfg, dns_name);
+    let mut conn = TcpStream::new(socket_fd).unwrap();
+
+    let mut tls = rustls::Stream::new(&mut sess, &mut conn);
+
+    tls.write("hello".as_bytes()).unwrap();
+
+    let mut plaintext = Vec::new();
+    match tls.read_to_end(&mut plaintext) {
+        Ok(_) => {
+            println!("Server replied: {}", str::from_utf8(&plaintext).unwrap());
+        }
+        Err(ref err) if err.kind() == io::ErrorKind::ConnectionAborted => {
+            println!("EOF (tls)");
+        }
+        Err(e) => println!("Error in read_to_end: {:?}", e),
+    }
+
+    sgx_status_t::SGX_SUCCESS
+}
+
+// ---- speculative session pre-establishment ----
+//
+// On-demand establishment puts the whole RA+DH exchange (IAS round
+// trip, quoting, TLS handshake) on the first request's critical path.
+// The state below lets the app keep attested sessions ready: the RA
+// configs are built once per enclave, and client_prewarm completes the
+// mutually attested handshake ahead of time and parks the live session
+// in a pool for run_client_pooled to consume. First-request latency
+// then equals steady-state latency, with the app replenishing the pool
+// in the background.
+
+struct RaState {
+    client_cfg: SgxMutex<Option<Arc<rustls::ClientConfig>>>,
+    server_cfg: SgxMutex<Option<Arc<rustls::ServerConfig>>>,
+    pool: SgxMutex<Vec<(rustls::ClientSession, TcpStream)>>,
+}
+
+fn ra_state() -> &'static RaState {
+    static INIT: Once = Once::new();
+    static mut STATE: Option<RaState> = None;
+    unsafe {
+        INIT.call_once(|| {
+            STATE = Some(RaState {
+                client_cfg: SgxMutex::new(None),
+                server_cfg: SgxMutex::new(None),
+                pool: SgxMutex::new(Vec::new()),
+            });
+        });
+        STATE.as_ref().unwrap()
+    }
+}
+
+fn cached_client_config(sign_type: sgx_quote_sign_type_t) -> Result<Arc<rustls::ClientConfig>, sgx_status_t> {
+    let mut slot = ra_state().client_cfg.lock().unwrap();
+    if let Some(cfg) = slot.as_ref() {
+        return Ok(cfg.clone());
+    }
+    let cfg = Arc::new(make_client_config(sign_type)?);
+    *slot = Some(cfg.clone());
+    Ok(cfg)
+}
+
+fn cached_server_config(sign_type: sgx_quote_sign_type_t) -> Result<Arc<rustls::ServerConfig>, sgx_status_t> {
+    let mut slot = ra_state().server_cfg.lock().unwrap();
+    if let Some(cfg) = slot.as_ref() {
+        return Ok(cfg.clone());
+    }
+    let cfg = Arc::new(make_server_config(sign_type)?);
+    *slot = Some(cfg.clone());
+    Ok(cfg)
+}
+
+/// Completes the mutually attested handshake on an already connected
+/// socket and parks the ready session. Called by the app's replenisher
+/// thread, never on a request's critical path. The enclave takes
+/// ownership of the fd: the app must pass a descriptor it will not
+/// close itself.
+#[no_mangle]
+pub extern "C" fn client_prewarm(socket_fd : c_int, sign_type: sgx_quote_sign_type_t) -> sgx_status_t {
+    let _ = backtrace::enable_backtrace("enclave.signed.so", PrintFormat::Short);
+    use rustls::Session;
+
+    let cfg = match cached_client_config(sign_type) {
+        Ok(cfg) => cfg,
+        Err(e) => return e,
+    };
+
     let dns_name = webpki::DNSNameRef::try_from_ascii_str("localhost").unwrap();
-    let mut sess = rustls::ClientSession::new(&Arc::new(cfg), dns_name);
+    let mut sess = rustls::ClientSession::new(&cfg, dns_name);
     let mut conn = TcpStream::new(socket_fd).unwrap();
 
+    while sess.is_handshaking() {
+        if let Err(e) = sess.complete_io(&mut conn) {
+            println!("Error in prewarm handshake: {:?}", e);
+            return sgx_status_t::SGX_ERROR_UNEXPECTED;
+        }
+    }
+
+    ra_state().pool.lock().unwrap().push((sess, conn));
+    sgx_status_t::SGX_SUCCESS
+}
+
+/// Number of ready sessions; the app replenishes below its target.
+#[no_mangle]
+pub extern "C" fn client_pool_size() -> u64 {
+    ra_state().pool.lock().unwrap().len() as u64
+}
+
+/// Like run_client, but over a pre-established session: no RA, no
+/// handshake, just the request. Returns SGX_ERROR_SERVICE_UNAVAILABLE
+/// when the pool is empty so the app can fall back to on-demand
+/// establishment.
+#[no_mangle]
+pub extern "C" fn run_client_pooled() -> sgx_status_t {
+    let _ = backtrace::enable_backtrace("enclave.signed.so", PrintFormat::Short);
+
+    let (mut sess, mut conn) = match ra_state().pool.lock().unwrap().pop() {
+        Some(ready) => ready,
+        None => return sgx_status_t::SGX_ERROR_SERVICE_UNAVAILABLE,
+    };
+
     let mut tls = rustls::Stream::new(&mut sess, &mut conn);
 
     tls.write("hello".as_bytes()).unwrap();
@@ -0,0 +1,137 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License..
+
+//! Receive into a persistent untrusted ring instead of per-call
+//! temporaries.
+//!
+//! `std::net` reads land in sgx_libc's `recv`, which allocates an
+//! untrusted staging buffer per call (`sgx_ocalloc`/`malloc`), has the
+//! kernel fill it, copies into the enclave and frees it. The copy into
+//! EPC is the one crossing that cannot go away, but the per-call
+//! allocate/free churn and the blind full-size copy can:
+//! [`ZeroCopyReceiver`] maps one untrusted ring at setup, hands its
+//! pages straight to the kernel on every receive, and lets the parser
+//! decide - from a peek at the header - how much of the frame is worth
+//! the checked copy into the enclave at all. A filtering parser at NIC
+//! rates copies headers, not payloads.
+//!
+//! Everything in the ring is attacker-writable between the peek and
+//! the copy; treat peeked bytes as hints (sizes to validate, tags to
+//! switch on) and only trust data after it has been copied in.
+
+use sgx_trts::libc::{self, c_int, c_void, ssize_t};
+use sgx_trts::libc::ocall;
+use sgx_trts::trts::rsgx_raw_is_outside_enclave;
+use sgx_types::sgx_status_t;
+use std::io;
+use std::ptr;
+
+/// A fixed untrusted receive ring shared with the kernel.
+pub struct ZeroCopyReceiver {
+    ring: *mut u8,
+    capacity: usize,
+    /// Bytes of the last receive, the window `peek`/`copy_out` see.
+    filled: usize,
+}
+
+impl ZeroCopyReceiver {
+    /// Allocates `capacity` bytes of untrusted memory once, verified
+    /// to lie fully outside the enclave.
+    pub fn new(capacity: usize) -> io::Result<ZeroCopyReceiver> {
+        if capacity == 0 {
+            return Err(io::Error::from_raw_os_error(libc::EINVAL));
+        }
+        let ring = unsafe { ocall::malloc(capacity) as *mut u8 };
+        if ring.is_null() || !rsgx_raw_is_outside_enclave(ring, capacity) {
+            return Err(io::Error::from_raw_os_error(libc::ENOMEM));
+        }
+        Ok(ZeroCopyReceiver {
+            ring,
+            capacity,
+            filled: 0,
+        })
+    }
+
+    /// Receives into the ring - the kernel writes the shared pages
+    /// directly, no staging buffer, no allocation - and returns the
+    /// byte count. A return of 0 is orderly shutdown, as with `recv`.
+    pub fn fill(&mut self, sockfd: c_int, flags: c_int) -> io::Result<usize> {
+        let mut result: ssize_t = 0;
+        let mut error: c_int = 0;
+        let status = unsafe {
+            ocall::u_recv_ocall(
+                &mut result as *mut ssize_t,
+                &mut error as *mut c_int,
+                sockfd,
+                self.ring as *mut c_void,
+                self.capacity,
+                flags,
+            )
+        };
+
+        if status != sgx_status_t::SGX_SUCCESS {
+            return Err(io::Error::from_raw_os_error(libc::ESGX));
+        }
+        if result == -1 {
+            return Err(io::Error::from_raw_os_error(error));
+        }
+        let nread = result as usize;
+        if nread > self.capacity {
+            // host lied about the count; nothing in the ring is usable
+            return Err(io::Error::from_raw_os_error(libc::ESGX));
+        }
+        self.filled = nread;
+        Ok(nread)
+    }
+
+    /// Bytes of the last receive.
+    pub fn filled(&self) -> usize {
+        self.filled
+    }
+
+    /// Peeks one byte of the ring without copying the frame in. The
+    /// value is untrusted and may change under the enclave; use it to
+    /// decide what to copy, never as data.
+    pub fn peek(&self, offset: usize) -> Option<u8> {
+        if offset >= self.filled {
+            return None;
+        }
+        Some(unsafe { ptr::read_volatile(self.ring.add(offset)) })
+    }
+
+    /// The checked copy: moves `dst.len()` bytes starting at `offset`
+    /// from the ring into the enclave. Bounds are checked against the
+    /// last receive; this is the single EPC crossing of the path.
+    pub fn copy_out(&self, offset: usize, dst: &mut [u8]) -> io::Result<()> {
+        let end = offset
+            .checked_add(dst.len())
+            .ok_or_else(|| io::Error::from_raw_os_error(libc::EINVAL))?;
+        if end > self.filled {
+            return Err(io::Error::from_raw_os_error(libc::EINVAL));
+        }
+        unsafe {
+            ptr::copy_nonoverlapping(self.ring.add(offset), dst.as_mut_ptr(), dst.len());
+        }
+        Ok(())
+    }
+}
+
+impl Drop for ZeroCopyReceiver {
+    fn drop(&mut self) {
+        unsafe { ocall::free(self.ring as *mut c_void) };
+    }
+}
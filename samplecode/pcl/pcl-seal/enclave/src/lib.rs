@@ -624,6 +624,25 @@ pub extern "C" fn key_provision(socket_fd : c_int, sign_type: sgx_quote_sign_typ
 
 }
 
+// The provisioned key lives in an SgxFile, which the protected FS binds
+// to this platform and signer, so its presence means a restart can
+// fast-path through local unsealing instead of repeating the whole
+// RA + TLS provisioning handshake.
+#[no_mangle]
+pub extern "C"
+fn has_provisioned_key() -> i32 {
+    match SgxFile::open(KEYFILE) {
+        Ok(mut f) => {
+            let mut keyvec: Vec<u8> = Vec::new();
+            match f.read_to_end(&mut keyvec) {
+                Ok(SGX_AESGCM_KEY_SIZE) => 1,
+                _ => 0,
+            }
+        }
+        Err(_) => 0,
+    }
+}
+
 #[no_mangle]
 pub extern "C"
 fn get_sealed_pcl_key_len() -> u32 {
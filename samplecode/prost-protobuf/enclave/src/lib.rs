@@ -40,6 +40,56 @@ mod person {
     include!(concat!(env!("OUT_DIR"), "/person.rs"));
 }
 
+// Streaming decode: walks the wire format with prost's low-level encoding
+// helpers and hands each top-level field to the closure, without building the
+// owned message tree. For multi-MB snapshots this keeps peak EPC usage at the
+// input buffer instead of input plus the decoded tree.
+fn visit_fields<F>(mut buf: &[u8], mut visit: F) -> Result<(), prost::DecodeError>
+where
+    F: FnMut(u32, prost::encoding::WireType, &[u8]),
+{
+    use bytes::Buf;
+    use prost::encoding::{decode_key, decode_varint, WireType};
+
+    while buf.has_remaining() {
+        let (tag, wire_type) = decode_key(&mut buf)?;
+        match wire_type {
+            WireType::Varint => {
+                let start = buf;
+                let len = start.len() - {
+                    decode_varint(&mut buf)?;
+                    buf.len()
+                };
+                visit(tag, wire_type, &start[..len]);
+            }
+            WireType::SixtyFourBit => {
+                if buf.remaining() < 8 {
+                    return Err(prost::DecodeError::new("buffer underflow"));
+                }
+                visit(tag, wire_type, &buf[..8]);
+                buf.advance(8);
+            }
+            WireType::ThirtyTwoBit => {
+                if buf.remaining() < 4 {
+                    return Err(prost::DecodeError::new("buffer underflow"));
+                }
+                visit(tag, wire_type, &buf[..4]);
+                buf.advance(4);
+            }
+            WireType::LengthDelimited => {
+                let len = decode_varint(&mut buf)? as usize;
+                if buf.remaining() < len {
+                    return Err(prost::DecodeError::new("buffer underflow"));
+                }
+                visit(tag, wire_type, &buf[..len]);
+                buf.advance(len);
+            }
+            _ => return Err(prost::DecodeError::new("unexpected group")),
+        }
+    }
+    Ok(())
+}
+
 #[no_mangle]
 pub extern "C" fn say_something(some_string: *const u8, some_len: usize) -> sgx_status_t {
     let person_slice = unsafe { slice::from_raw_parts(some_string, some_len) };
@@ -51,6 +101,12 @@ pub extern "C" fn say_something(some_string: *const u8, some_len: usize) -> sgx_
         the_one.email);
     println!("{:?}", the_one);
 
+    // same buffer again, streamed field-by-field with no owned tree
+    visit_fields(person_slice, |tag, wire_type, raw| {
+        println!("streaming field {} ({:?}): {} raw bytes", tag, wire_type, raw.len());
+    })
+    .unwrap();
+
     let ts = Timestamp { seconds: 0x1234, nanos: 0x5678 };
     println!("well known types ts = {:?}", ts);
 
@@ -33,6 +33,7 @@ use std::slice;
 
 extern crate protobuf;
 mod person;
+mod streaming;
 use person::Person;
 use protobuf::hex::decode_hex;
 use protobuf::parse_from_bytes;
@@ -48,5 +49,10 @@ pub extern "C" fn say_something(some_string: *const u8, some_len: usize) -> sgx_
 
     println!("\nname: {}, id: 0x{:08X}, email at: {}", parsed.get_name(), parsed.get_id(), parsed.get_email() );
 
+    // same message again, but decoded field-by-field with borrowed strings --
+    // no per-field heap allocation, memory stays bounded by the input buffer
+    let view = streaming::PersonView::parse(&decoded).unwrap();
+    println!("streaming view: name: {}, id: 0x{:08X}, email at: {}", view.name, view.id, view.email);
+
     sgx_status_t::SGX_SUCCESS
 }
@@ -0,0 +1,134 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License..
+
+//! Streaming decode of the protobuf wire format.
+//!
+//! `parse_from_bytes` materializes the whole message tree in EPC, which for
+//! large snapshots peaks at a multiple of the encoded size and triggers
+//! paging. This module walks the wire format field by field instead and hands
+//! each field to a visitor; length-delimited fields are borrowed straight out
+//! of the input buffer, so the input acts as the arena and decode allocates
+//! nothing per field.
+
+use std::str;
+
+#[derive(Debug)]
+pub enum WireValue<'a> {
+    Varint(u64),
+    Fixed64(u64),
+    Fixed32(u32),
+    /// Borrows from the input buffer; copy only what must outlive the visit.
+    Bytes(&'a [u8]),
+}
+
+pub trait FieldVisitor<'a> {
+    fn field(&mut self, number: u32, value: WireValue<'a>) -> Result<(), &'static str>;
+}
+
+fn read_varint(buf: &[u8], pos: &mut usize) -> Result<u64, &'static str> {
+    let mut value: u64 = 0;
+    let mut shift = 0;
+    loop {
+        let byte = *buf.get(*pos).ok_or("truncated varint")?;
+        *pos += 1;
+        if shift == 63 && byte > 1 {
+            return Err("varint overflow");
+        }
+        value |= u64::from(byte & 0x7F) << shift;
+        if byte & 0x80 == 0 {
+            return Ok(value);
+        }
+        shift += 7;
+    }
+}
+
+/// Walks every top-level field of `buf` in one pass, calling the visitor for
+/// each. Unknown field numbers are the visitor's business; unknown wire types
+/// are a malformed message.
+pub fn visit_fields<'a, V: FieldVisitor<'a>>(
+    buf: &'a [u8],
+    visitor: &mut V,
+) -> Result<(), &'static str> {
+    let mut pos = 0;
+    while pos < buf.len() {
+        let key = read_varint(buf, &mut pos)?;
+        let number = (key >> 3) as u32;
+        if number == 0 {
+            return Err("field number 0");
+        }
+        let value = match key & 7 {
+            0 => WireValue::Varint(read_varint(buf, &mut pos)?),
+            1 => {
+                let end = pos.checked_add(8).filter(|e| *e <= buf.len()).ok_or("truncated fixed64")?;
+                let mut v = [0u8; 8];
+                v.copy_from_slice(&buf[pos..end]);
+                pos = end;
+                WireValue::Fixed64(u64::from_le_bytes(v))
+            }
+            2 => {
+                let len = read_varint(buf, &mut pos)? as usize;
+                let end = pos.checked_add(len).filter(|e| *e <= buf.len()).ok_or("truncated bytes")?;
+                let v = &buf[pos..end];
+                pos = end;
+                WireValue::Bytes(v)
+            }
+            5 => {
+                let end = pos.checked_add(4).filter(|e| *e <= buf.len()).ok_or("truncated fixed32")?;
+                let mut v = [0u8; 4];
+                v.copy_from_slice(&buf[pos..end]);
+                pos = end;
+                WireValue::Fixed32(u32::from_le_bytes(v))
+            }
+            _ => return Err("unsupported wire type"),
+        };
+        visitor.field(number, value)?;
+    }
+    Ok(())
+}
+
+/// Zero-copy view of a `Person` message; string fields borrow the input
+/// buffer instead of owning heap copies.
+#[derive(Default, Debug)]
+pub struct PersonView<'a> {
+    pub name: &'a str,
+    pub id: i32,
+    pub email: &'a str,
+}
+
+impl<'a> FieldVisitor<'a> for PersonView<'a> {
+    fn field(&mut self, number: u32, value: WireValue<'a>) -> Result<(), &'static str> {
+        match (number, value) {
+            (1, WireValue::Bytes(v)) => {
+                self.name = str::from_utf8(v).map_err(|_| "name is not utf-8")?;
+            }
+            (2, WireValue::Varint(v)) => self.id = v as i32,
+            (3, WireValue::Bytes(v)) => {
+                self.email = str::from_utf8(v).map_err(|_| "email is not utf-8")?;
+            }
+            _ => {} // unknown fields are skipped, same as the tree decoder
+        }
+        Ok(())
+    }
+}
+
+impl<'a> PersonView<'a> {
+    pub fn parse(buf: &'a [u8]) -> Result<PersonView<'a>, &'static str> {
+        let mut view = PersonView::default();
+        visit_fields(buf, &mut view)?;
+        Ok(view)
+    }
+}
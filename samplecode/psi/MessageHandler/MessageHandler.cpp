@@ -16,6 +16,7 @@
 // under the License..
 
 #include "MessageHandler.h"
+#include "BufferPool.h"
 
 using namespace util;
 
@@ -31,7 +32,7 @@ MessageHandler::~MessageHandler() {
 int MessageHandler::init() {
     this->nm->Init();
     this->nm->connectCallbackHandler([this](string v, int type) {
-        return this->incomingHandler(v, type);
+        return this->incomingHandler(std::move(v), type);
     });
 }
 
@@ -149,7 +150,7 @@ string MessageHandler::generateMSG1() {
 }
 
 
-void MessageHandler::assembleMSG2(Messages::MessageMSG2 msg, sgx_ra_msg2_t **pp_msg2) {
+void MessageHandler::assembleMSG2(const Messages::MessageMSG2 &msg, sgx_ra_msg2_t **pp_msg2) {
     uint32_t size = msg.size();
 
     sgx_ra_msg2_t *p_msg2 = NULL;
@@ -198,7 +199,7 @@ void MessageHandler::assembleMSG2(Messages::MessageMSG2 msg, sgx_ra_msg2_t **pp_
 }
 
 
-string MessageHandler::handleMSG2(Messages::MessageMSG2 msg) {
+string MessageHandler::handleMSG2(const Messages::MessageMSG2 &msg) {
     Log("Received MSG2");
 
     uint32_t size = msg.size();
@@ -263,7 +264,7 @@ string MessageHandler::handleMSG2(Messages::MessageMSG2 msg) {
 }
 
 
-void MessageHandler::assembleAttestationMSG(Messages::AttestationMessage msg, ra_samp_response_header_t **pp_att_msg) {
+void MessageHandler::assembleAttestationMSG(const Messages::AttestationMessage &msg, ra_samp_response_header_t **pp_att_msg) {
     sample_ra_att_result_msg_t *p_att_result_msg = NULL;
     ra_samp_response_header_t* p_att_result_msg_full = NULL;
 
@@ -334,7 +335,7 @@ string MessageHandler::generateAttestationFailed(uint32_t id, sgx_ra_context_t c
     return nm->serialize(msg);
 }
 
-string MessageHandler::handleAttestationResult(Messages::AttestationMessage msg) {
+string MessageHandler::handleAttestationResult(const Messages::AttestationMessage &msg) {
     Log("Received Attestation result");
 
     ra_samp_response_header_t *p_att_result_msg_full = NULL;
@@ -420,7 +421,7 @@ string MessageHandler::handleAttestationResult(Messages::AttestationMessage msg)
 }
 
 
-string MessageHandler::handleMSG0(Messages::MessageMsg0 msg) {
+string MessageHandler::handleMSG0(const Messages::MessageMsg0 &msg) {
     Log("MSG0 response received");
 
     if (msg.status() == TYPE_OK) {
@@ -448,7 +449,7 @@ string MessageHandler::createInitMsg(int type, string msg) {
     return nm->serialize(init_msg);
 }
 
-string MessageHandler::handlePsiHashData(Messages::MessagePsiHashData msg) {
+string MessageHandler::handlePsiHashData(const Messages::MessagePsiHashData &msg) {
     Log("[PSI] Received hash data");
 
     uint8_t mac[SGX_MAC_SIZE] = {0};
@@ -461,8 +462,11 @@ string MessageHandler::handlePsiHashData(Messages::MessagePsiHashData msg) {
         mac[i] = (uint8_t)msg.mac(i);
     }
 
+    // Copy through the raw repeated field; the per-index accessor costs a
+    // bounds check per byte, which shows up at the larger chunk size.
+    const uint32_t* words = msg.data().data();
     for (int i = 0; i < data_size; i++) {
-        data[i] = (uint8_t)msg.data(i);
+        data[i] = (uint8_t)words[i];
     }
 
     sgx_status_t status;
@@ -491,7 +495,7 @@ string MessageHandler::handlePsiHashData(Messages::MessagePsiHashData msg) {
     return nm->serialize(result);
 }
 
-string MessageHandler::handlePsiHashDataFinished(Messages::MessagePsiHashDataFinished msg, bool* again) {
+string MessageHandler::handlePsiHashDataFinished(const Messages::MessagePsiHashDataFinished &msg, bool* again) {
 
     sgx_ra_context_t context = msg.context();
     uint32_t id = msg.id();
@@ -575,9 +579,8 @@ string MessageHandler::handlePsiHashDataFinished(Messages::MessagePsiHashDataFin
     return nm->serialize(intersect);
 }
 
-vector<string> MessageHandler::incomingHandler(string v, int type) {
-    vector<string> res;
-    string s;
+MessageEnvelope MessageHandler::incomingHandler(string v, int type) {
+    MessageEnvelope envelope;
     bool ret;
 
     switch (type) {
@@ -585,8 +588,8 @@ vector<string> MessageHandler::incomingHandler(string v, int type) {
         Messages::InitialMessage init_msg;
         ret = init_msg.ParseFromString(v);
         if (ret && init_msg.type() == RA_VERIFICATION) {
-            s = this->handleVerification();
-            res.push_back(to_string(RA_MSG0));
+            envelope.type = RA_MSG0;
+            envelope.payload = this->handleVerification();
         }
     }
     break;
@@ -594,8 +597,8 @@ vector<string> MessageHandler::incomingHandler(string v, int type) {
         Messages::MessageMsg0 msg0;
         ret = msg0.ParseFromString(v);
         if (ret && (msg0.type() == RA_MSG0)) {
-            s = this->handleMSG0(msg0);
-            res.push_back(to_string(RA_MSG1));
+            envelope.type = RA_MSG1;
+            envelope.payload = this->handleMSG0(msg0);
         }
     }
     break;
@@ -603,8 +606,8 @@ vector<string> MessageHandler::incomingHandler(string v, int type) {
         Messages::MessageMSG2 msg2;
         ret = msg2.ParseFromString(v);
         if (ret && (msg2.type() == RA_MSG2)) {
-            s = this->handleMSG2(msg2);
-            res.push_back(to_string(RA_MSG3));
+            envelope.type = RA_MSG3;
+            envelope.payload = this->handleMSG2(msg2);
         }
     }
     break;
@@ -612,8 +615,8 @@ vector<string> MessageHandler::incomingHandler(string v, int type) {
         Messages::AttestationMessage att_msg;
         ret = att_msg.ParseFromString(v);
         if (ret && att_msg.type() == RA_ATT_RESULT) {
-            s = this->handleAttestationResult(att_msg);
-            res.push_back(to_string(RA_PSI_SLAT));
+            envelope.type = RA_PSI_SLAT;
+            envelope.payload = this->handleAttestationResult(att_msg);
         }
     }
     break;
@@ -621,8 +624,8 @@ vector<string> MessageHandler::incomingHandler(string v, int type) {
         Messages::MessagePsiHashData data_msg;
         ret = data_msg.ParseFromString(v);
         if (ret && data_msg.type() == RA_PSI_HASHDATA) {
-            s = this->handlePsiHashData(data_msg);
-            res.push_back(to_string(RA_PSI_RESULT));
+            envelope.type = RA_PSI_RESULT;
+            envelope.payload = this->handlePsiHashData(data_msg);
         }
     }
     break;
@@ -631,12 +634,8 @@ vector<string> MessageHandler::incomingHandler(string v, int type) {
         ret = finish_msg.ParseFromString(v);
         if (ret && finish_msg.type() == RA_PSI_HASHDATA_FINISHED) {
             bool again = false;
-            s = this->handlePsiHashDataFinished(finish_msg, &again);
-            if (again) {
-                res.push_back(to_string(RA_PSI_RESULT));
-            } else {
-                res.push_back(to_string(RA_PSI_INTERSECT));
-            }
+            envelope.payload = this->handlePsiHashDataFinished(finish_msg, &again);
+            envelope.type = again ? RA_PSI_RESULT : RA_PSI_INTERSECT;
         }
     }
     break;
@@ -645,7 +644,9 @@ vector<string> MessageHandler::incomingHandler(string v, int type) {
         break;
     }
 
-    res.push_back(s);
+    // The parse is done with the incoming bytes; give the pooled read
+    // buffer back for the next message.
+    BufferPool::reclaim(std::move(v));
 
-    return res;
+    return envelope;
 }
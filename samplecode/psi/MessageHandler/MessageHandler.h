@@ -45,25 +45,25 @@ public:
     sgx_ra_msg3_t* getMSG3();
     int init();
     void start();
-    vector<string> incomingHandler(string v, int type);
+    MessageEnvelope incomingHandler(string v, int type);
 
 private:
     sgx_status_t initEnclave();
     uint32_t getExtendedEPID_GID();
 
-    void assembleAttestationMSG(Messages::AttestationMessage msg, ra_samp_response_header_t **pp_att_msg);
-    string handleAttestationResult(Messages::AttestationMessage msg);
-    void assembleMSG2(Messages::MessageMSG2 msg, sgx_ra_msg2_t **pp_msg2);
-    string handleMSG2(Messages::MessageMSG2 msg);
-    string handleMSG0(Messages::MessageMsg0 msg);
+    void assembleAttestationMSG(const Messages::AttestationMessage &msg, ra_samp_response_header_t **pp_att_msg);
+    string handleAttestationResult(const Messages::AttestationMessage &msg);
+    void assembleMSG2(const Messages::MessageMSG2 &msg, sgx_ra_msg2_t **pp_msg2);
+    string handleMSG2(const Messages::MessageMSG2 &msg);
+    string handleMSG0(const Messages::MessageMsg0 &msg);
     string generateMSG1();
     string handleVerification();
     string generateMSG0();
     string createInitMsg(int type, string msg);
 
     string generateAttestationFailed(uint32_t id, sgx_ra_context_t context);
-    string handlePsiHashData(Messages::MessagePsiHashData msg);
-    string handlePsiHashDataFinished(Messages::MessagePsiHashDataFinished msg, bool* again);
+    string handlePsiHashData(const Messages::MessagePsiHashData &msg);
+    string handlePsiHashDataFinished(const Messages::MessagePsiHashDataFinished &msg, bool* again);
 
 protected:
     Enclave *enclave = NULL;
@@ -16,7 +16,9 @@
 // under the License..
 
 #include "AbstractNetworkOps.h"
+#include "BufferPool.h"
 #include <boost/lexical_cast.hpp>
+#include <boost/array.hpp>
 #include <boost/algorithm/string.hpp>
 
 using namespace util;
@@ -79,11 +81,13 @@ void AbstractNetworkOps::handle_read(const boost::system::error_code& error, siz
     if (this->read_state == MSG_HEADER) {
 
         this->read_state = MSG_BODY;
-        this->read_buffer_message = (char*) malloc(sizeof(char) * msg_size);
-        memset(this->read_buffer_message, '\0', sizeof(char) * msg_size);
+        // Read straight into a recycled size-classed buffer: no malloc
+        // per message and no staging copy before the parse stage.
+        this->read_message_body = BufferPool::acquire(msg_size);
+        this->read_message_body.resize(msg_size);
         boost::asio::async_read(
             socket_,
-            boost::asio::buffer(this->read_buffer_message, msg_size),
+            boost::asio::buffer(&this->read_message_body[0], msg_size),
             boost::bind(
                 &AbstractNetworkOps::handle_read,
                 this,
@@ -91,35 +95,35 @@ void AbstractNetworkOps::handle_read(const boost::system::error_code& error, siz
                 boost::asio::placeholders::bytes_transferred));
 
     } else if (this->read_state == MSG_BODY) {
-        process_read(this->read_buffer_message, msg_size, type);
+        process_read(type);
     }
 }
 
-void AbstractNetworkOps::send(vector<string> v) {
-    string type = v[0];
-    string msg = v[1];
-
-    if (msg.size() <= 0) {
+void AbstractNetworkOps::send(MessageEnvelope envelope) {
+    if (!envelope.hasResponse()) {
         this->saveCloseSocket();
         return;
     }
 
-    const char *msg_c = msg.c_str();
-    int msg_length = msg.size();
+    // Keep the payload alive in a member for the duration of the write and
+    // gather header + payload into one async_write. The hash batches shipped
+    // here run to several megabytes, so the old malloc/memcpy staging copy
+    // was the dominant per-send cost.
+    this->write_message = std::move(envelope.payload);
+    int msg_length = this->write_message.size();
 
-    string header = to_string(msg_length) + "@" + type;
+    string header = to_string(msg_length) + "@" + to_string(envelope.type);
     memset(this->write_buffer_header, '\0', 20);
     memcpy(this->write_buffer_header, header.c_str(), header.length());
 
-    this->write_buffer_message = (char*) malloc(sizeof(char) * msg_length);
-    memset(this->write_buffer_message, '\0', sizeof(char) * msg_length);
-    memcpy(this->write_buffer_message, msg_c, msg_length);
-    this->write_state = MSG_HEADER;
+    boost::array<boost::asio::const_buffer, 2> buffers = {{
+        boost::asio::buffer(this->write_buffer_header, 20),
+        boost::asio::buffer(this->write_message.data(), msg_length)
+    }};
 
     boost::asio::async_write(
         socket_,
-        boost::asio::buffer(this->write_buffer_header, 20),
-        boost::asio::transfer_at_least(20),
+        buffers,
         boost::bind(
             &AbstractNetworkOps::handle_write,
             this,
@@ -138,30 +142,11 @@ void AbstractNetworkOps::handle_write(const boost::system::error_code& error, si
         return;
     }
 
-    vector<string> header;
-    boost::split(header, this->write_buffer_header, boost::is_any_of("@"));
-
-    int msg_size = boost::lexical_cast<int>(header[0]);
-    int type = boost::lexical_cast<int>(header[1]);
-
-    if (this->write_state == MSG_HEADER) {
-
-        this->write_state = MSG_BODY;
-        boost::asio::async_write(
-            socket_,
-            boost::asio::buffer(this->write_buffer_message, msg_size),
-            boost::asio::transfer_at_least(msg_size),
-            boost::bind(
-                &AbstractNetworkOps::handle_write,
-                this,
-                boost::asio::placeholders::error,
-                boost::asio::placeholders::bytes_transferred));
-
-    } else if (this->write_state == MSG_BODY) {
-
-        free(this->write_buffer_message);
-        this->read();
-    }
+    // Return the payload buffer's storage to the pool for the next
+    // serialization instead of freeing it.
+    BufferPool::reclaim(std::move(this->write_message));
+    this->write_message.clear();
+    this->read();
 }
 
 void AbstractNetworkOps::setCallbackHandler(CallbackHandler cb) {
@@ -169,14 +154,14 @@ void AbstractNetworkOps::setCallbackHandler(CallbackHandler cb) {
 }
 
 
-void AbstractNetworkOps::process_read(char* buffer, int msg_size, int type) {
-    std::string str(reinterpret_cast<const char*>(buffer), msg_size);
-
-    free(buffer);
-    auto msg = this->callback_handler(str, type);
+void AbstractNetworkOps::process_read(int type) {
+    // Zero-copy handoff: the pooled read buffer moves into the handler,
+    // which reclaims its storage once the protobuf parse is done.
+    MessageEnvelope envelope = this->callback_handler(std::move(this->read_message_body), type);
+    this->read_message_body.clear();
 
-    if (msg.size() > 0 && msg[0].size() > 0) {
-        send(msg);
+    if (envelope.hasResponse()) {
+        send(std::move(envelope));
     } else {
         Log("Close connection");
         this->saveCloseSocket();
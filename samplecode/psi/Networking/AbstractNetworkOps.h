@@ -39,7 +39,20 @@ typedef enum _net_msg_state {
     MSG_BODY
 } net_msg_state;
 
-typedef function<vector<string>(string, int)> CallbackHandler;
+// One message hop: the outgoing wire type and its serialized payload.
+// Handlers return it by value, so routing a message allocates nothing
+// beyond the pooled payload storage - no stringified type tags, no
+// vector per hop. An envelope without a payload closes the session.
+struct MessageEnvelope {
+    int type = -1;
+    string payload;
+
+    bool hasResponse() const {
+        return type >= 0 && !payload.empty();
+    }
+};
+
+typedef function<MessageEnvelope(string, int)> CallbackHandler;
 
 class AbstractNetworkOps {
 
@@ -59,19 +72,18 @@ protected:
     enum { max_length = 1024 };
 
     char read_buffer_header[20];
-    char* read_buffer_message;
+    string read_message_body;
     net_msg_state read_state;
 
     char write_buffer_header[20];
-    char* write_buffer_message;
-    net_msg_state write_state;
+    string write_message;
 
     CallbackHandler callback_handler = NULL;
 
 protected:
     void read();
-    void send(vector<string>);
-    void process_read(char* buffer, int size, int type);
+    void send(MessageEnvelope envelope);
+    void process_read(int type);
 
 private:
     void saveCloseSocket();
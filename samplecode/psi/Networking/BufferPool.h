@@ -0,0 +1,110 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License..
+
+#ifndef BUFFERPOOL_H
+#define BUFFERPOOL_H
+
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Recycles message payload buffers so steady-state traffic reuses a
+// few grown strings instead of allocating and freeing one per message.
+// Buffers travel by move in both directions: acquire() ->
+// SerializeToArray target -> send() -> reclaim() in the write
+// completion handler, and acquire(size) -> async_read target ->
+// incomingHandler -> reclaim() after the protobuf parse.
+class BufferPool {
+
+    enum { max_pooled = 8 };
+
+public:
+    static std::string acquire() {
+        std::lock_guard<std::mutex> guard(lock());
+        std::vector<std::string>& buffers = pool();
+        if (buffers.empty()) {
+            return std::string();
+        }
+        std::string buffer = std::move(buffers.back());
+        buffers.pop_back();
+        buffer.clear();
+        return buffer;
+    }
+
+    // Acquire with a capacity hint, rounded up to a power-of-two size
+    // class. A session whose message sizes wobble around one class
+    // settles on a single recycled buffer instead of reallocating on
+    // every small variation. Prefers the smallest pooled buffer that
+    // already fits so large buffers stay available for large reads.
+    static std::string acquire(std::size_t reserve) {
+        std::size_t wanted = size_class(reserve);
+        {
+            std::lock_guard<std::mutex> guard(lock());
+            std::vector<std::string>& buffers = pool();
+            std::size_t best = buffers.size();
+            for (std::size_t i = 0; i < buffers.size(); i++) {
+                if (buffers[i].capacity() >= wanted &&
+                        (best == buffers.size() || buffers[i].capacity() < buffers[best].capacity())) {
+                    best = i;
+                }
+            }
+            if (best != buffers.size()) {
+                std::string buffer = std::move(buffers[best]);
+                buffers.erase(buffers.begin() + best);
+                buffer.clear();
+                return buffer;
+            }
+        }
+        std::string buffer;
+        buffer.reserve(wanted);
+        return buffer;
+    }
+
+    static void reclaim(std::string&& buffer) {
+        if (buffer.capacity() == 0) {
+            return;
+        }
+        std::lock_guard<std::mutex> guard(lock());
+        std::vector<std::string>& buffers = pool();
+        if (buffers.size() < max_pooled) {
+            buffers.push_back(std::move(buffer));
+        }
+    }
+
+private:
+    static std::size_t size_class(std::size_t n) {
+        std::size_t c = 512;
+        while (c < n) {
+            c <<= 1;
+        }
+        return c;
+    }
+
+    static std::vector<std::string>& pool() {
+        static std::vector<std::string> buffers;
+        return buffers;
+    }
+
+    static std::mutex& lock() {
+        static std::mutex mutex;
+        return mutex;
+    }
+
+};
+
+#endif
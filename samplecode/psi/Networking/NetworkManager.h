@@ -22,6 +22,7 @@
 #include "Client.h"
 #include "LogBase.h"
 #include "Network_def.h"
+#include "BufferPool.h"
 
 #include <string>
 #include <stdio.h>
@@ -46,14 +47,21 @@ public:
     void setPort(int port);
     void printMsg(bool send, const char* msg);
 
+    // Serialize into a pooled buffer with SerializeToArray rather than a
+    // fresh string per message; the buffer's capacity comes back through
+    // BufferPool when the write completes, so steady-state traffic
+    // serializes without allocating.
     template <typename T>
-    string serialize(T msg) {
-        string s;
-        if (msg.SerializeToString(&s)) {
+    string serialize(const T &msg) {
+        string s = BufferPool::acquire();
+        int size = msg.ByteSize();
+        s.resize(size);
+        if (size == 0 || msg.SerializeToArray(&s[0], size)) {
             //Log("Serialization successful");
             return s;
         } else {
             Log("Serialization failed", log::error);
+            BufferPool::reclaim(std::move(s));
             return "";
         }
     }
@@ -21,9 +21,23 @@ NetworkManagerServer* NetworkManagerServer::instance = NULL;
 
 NetworkManagerServer::NetworkManagerServer() {}
 
+// Shared by Init (acceptor count) and startService (thread count): one
+// SO_REUSEPORT listener per event-loop thread, so a reconnect spike is
+// spread across independent accept chains instead of queueing behind
+// one acceptor.
+static unsigned int worker_threads() {
+    unsigned int workers = boost::thread::hardware_concurrency();
+    if (workers < 2) {
+        workers = 2;
+    } else if (workers > 8) {
+        workers = 8;
+    }
+    return workers;
+}
+
 
 void NetworkManagerServer::Init() {
-    this->server = new Server(this->io_service, this->port);
+    this->server = new Server(this->io_service, this->port, worker_threads());
 }
 
 
@@ -39,7 +53,20 @@ NetworkManagerServer* NetworkManagerServer::getInstance(int port) {
 
 void NetworkManagerServer::startService() {
     this->server->start_accept();
+
+    // Run the io_service on a small pool so TLS handshakes and per-session
+    // protobuf work for different clients proceed in parallel instead of
+    // serializing behind one event loop thread. Handlers for a single
+    // session never run concurrently because each session only has one
+    // outstanding async operation at a time.
+    unsigned int workers = worker_threads();
+
+    boost::thread_group pool;
+    for (unsigned int i = 1; i < workers; i++) {
+        pool.create_thread(boost::bind(&boost::asio::io_service::run, &this->io_service));
+    }
     this->io_service.run();
+    pool.join_all();
 }
 
 
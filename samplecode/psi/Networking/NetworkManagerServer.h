@@ -17,6 +17,8 @@
 
 #include "NetworkManager.h"
 
+#include <boost/thread.hpp>
+
 class NetworkManagerServer : public NetworkManager {
 
 public:
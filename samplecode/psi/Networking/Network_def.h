@@ -59,7 +59,12 @@ typedef struct _ra_samp_response_header_t {
 } ra_samp_response_header_t;
 
 #define SALT_SIZE 32
-#define PSI_HASH_DATA_COUNT 32
+// Hashes per MessagePsiHashData chunk. The upload runs lock-step
+// (chunk -> enclave ingest -> ack), so each chunk costs a network round
+// trip, one AES-GCM pass and one ecall; 4096 hashes (128KB plaintext)
+// keeps buffering bounded while the enclave ingests one chunk as the
+// next one is encrypted and shipped.
+#define PSI_HASH_DATA_COUNT 4096
 
 #pragma pack()
 
@@ -18,10 +18,11 @@
 #include "Server.h"
 #include "../GeneralSettings.h"
 
+#include <sys/socket.h>
+
 using namespace util;
 
-Server::Server(boost::asio::io_service& io_service, int port) : io_service_(io_service), acceptor_(io_service,
-            boost::asio::ip::tcp::endpoint(boost::asio::ip::tcp::v4(), port)),
+Server::Server(boost::asio::io_service& io_service, int port, int num_acceptors) : io_service_(io_service),
     context_(boost::asio::ssl::context::sslv23) {
 
     this->context_.set_options(boost::asio::ssl::context::default_workarounds
@@ -31,8 +32,34 @@ Server::Server(boost::asio::io_service& io_service, int port) : io_service_(io_s
     this->context_.use_certificate_chain_file(Settings::server_crt);
     this->context_.use_private_key_file(Settings::server_key, boost::asio::ssl::context::pem);
 
+    if (num_acceptors < 1) {
+        num_acceptors = 1;
+    }
+#ifndef SO_REUSEPORT
+    // Without SO_REUSEPORT a second bind to the port fails; fall back
+    // to the single acceptor.
+    num_acceptors = 1;
+#endif
+
+    boost::asio::ip::tcp::endpoint endpoint(boost::asio::ip::tcp::v4(), port);
+    for (int i = 0; i < num_acceptors; i++) {
+        std::unique_ptr<boost::asio::ip::tcp::acceptor> acceptor(
+            new boost::asio::ip::tcp::acceptor(io_service));
+        acceptor->open(endpoint.protocol());
+        acceptor->set_option(boost::asio::ip::tcp::acceptor::reuse_address(true));
+#ifdef SO_REUSEPORT
+        if (num_acceptors > 1) {
+            typedef boost::asio::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT> reuse_port;
+            acceptor->set_option(reuse_port(true));
+        }
+#endif
+        acceptor->bind(endpoint);
+        acceptor->listen(boost::asio::socket_base::max_connections);
+        this->acceptors_.push_back(std::move(acceptor));
+    }
+
     Log("Certificate \"" + Settings::server_crt + "\" set");
-    Log("Server running on port: %d", port);
+    Log("Server running on port: %d with %d acceptor(s)", port, num_acceptors);
 }
 
 
@@ -40,13 +67,23 @@ Server::~Server() {}
 
 
 void Server::start_accept() {
+    for (size_t i = 0; i < this->acceptors_.size(); i++) {
+        start_accept_on(i);
+    }
+}
+
+
+void Server::start_accept_on(size_t acceptor_index) {
     Session *new_session = new Session(io_service_, context_);
     new_session->setCallbackHandler(this->callback_handler);
-    acceptor_.async_accept(new_session->socket(), boost::bind(&Server::handle_accept, this, new_session, boost::asio::placeholders::error));
+    acceptors_[acceptor_index]->async_accept(
+        new_session->socket(),
+        boost::bind(&Server::handle_accept, this, new_session, acceptor_index,
+                    boost::asio::placeholders::error));
 }
 
 
-void Server::handle_accept(Session* new_session, const boost::system::error_code& error) {
+void Server::handle_accept(Session* new_session, size_t acceptor_index, const boost::system::error_code& error) {
     if (!error) {
         Log("New accept request, starting new session");
         new_session->start();
@@ -54,7 +91,7 @@ void Server::handle_accept(Session* new_session, const boost::system::error_code
         delete new_session;
     }
 
-    start_accept();
+    start_accept_on(acceptor_index);
 }
 
 void Server::connectCallbackHandler(CallbackHandler cb) {
@@ -16,6 +16,7 @@
 // under the License..
 
 #include "MessageManager.h"
+#include "BufferPool.h"
 #include "../GeneralSettings.h"
 
 #include  <iomanip>
@@ -50,7 +51,7 @@ int MessageManager::init(string path) {
 
     this->nm->Init();
     this->nm->connectCallbackHandler([this](string v, int type) {
-        return this->incomingHandler(v, type);
+        return this->incomingHandler(std::move(v), type);
     });
 }
 
@@ -59,7 +60,7 @@ void MessageManager::start() {
     Log("[PSI] PSI done");
 }
 
-string MessageManager::handleMSG0(Messages::MessageMsg0 msg) {
+string MessageManager::handleMSG0(Messages::MessageMsg0 &msg) {
     Log("MSG0 received");
 
     uint32_t extended_epid_group_id = msg.epid();
@@ -73,10 +74,11 @@ string MessageManager::handleMSG0(Messages::MessageMsg0 msg) {
     return nm->serialize(msg);
 }
 
-string MessageManager::handleMSG1(Messages::MessageMSG1 msg1) {
+string MessageManager::handleMSG1(Messages::MessageMSG1 &msg1) {
     Log("MSG1 received");
 
-    Messages::MessageMSG2 msg2;
+    Messages::MessageMSG2 &msg2 = this->pool_msg2;
+    msg2.Clear();
     msg2.set_type(RA_MSG2);
     msg2.set_context(msg1.context());
 
@@ -92,10 +94,11 @@ string MessageManager::handleMSG1(Messages::MessageMSG1 msg1) {
     return "";
 }
 
-string MessageManager::handleMSG3(Messages::MessageMSG3 msg) {
+string MessageManager::handleMSG3(Messages::MessageMSG3 &msg) {
     Log("MSG3 received");
 
-    Messages::AttestationMessage att_msg;
+    Messages::AttestationMessage &att_msg = this->pool_att_msg;
+    att_msg.Clear();
     att_msg.set_type(RA_ATT_RESULT);
     att_msg.set_context(msg.context());
 
@@ -111,7 +114,7 @@ string MessageManager::handleMSG3(Messages::MessageMSG3 msg) {
     return "";
 }
 
-string MessageManager::handleAppAttOk(Messages::MessagePsiSalt msg) {
+string MessageManager::handleAppAttOk(Messages::MessagePsiSalt &msg) {
     Log("APP attestation result received");
 
     if (msg.state() == 0) {
@@ -122,7 +125,8 @@ string MessageManager::handleAppAttOk(Messages::MessagePsiSalt msg) {
         return "";
     }
 
-    Messages::MessagePsiHashData hash_data;
+    Messages::MessagePsiHashData &hash_data = this->pool_hash_data;
+    hash_data.Clear();
     hash_data.set_type(RA_PSI_HASHDATA);
     hash_data.set_context(msg.context());
     hash_data.set_id(msg.id());
@@ -139,12 +143,13 @@ string MessageManager::handleAppAttOk(Messages::MessagePsiSalt msg) {
     return "";
 }
 
-string MessageManager::handleHashData(Messages::MessagePsiResult msg, bool* finished) {
+string MessageManager::handleHashData(Messages::MessagePsiResult &msg, bool* finished) {
 
     if (this->sp->sp_psi_is_finish_get_data()) {
         Log("[PSI] Send hash data finished");
 
-        Messages::MessagePsiHashDataFinished finish;
+        Messages::MessagePsiHashDataFinished &finish = this->pool_finished;
+        finish.Clear();
         finish.set_type(RA_PSI_HASHDATA_FINISHED);
         finish.set_size(sizeof(uint32_t));
         finish.set_context(msg.context());
@@ -155,7 +160,8 @@ string MessageManager::handleHashData(Messages::MessagePsiResult msg, bool* fini
         return nm->serialize(finish);
 
     } else {
-        Messages::MessagePsiHashData hash_data;
+        Messages::MessagePsiHashData &hash_data = this->pool_hash_data;
+        hash_data.Clear();
         hash_data.set_type(RA_PSI_HASHDATA);
         hash_data.set_context(msg.context());
         hash_data.set_id(msg.id());
@@ -173,7 +179,7 @@ string MessageManager::handleHashData(Messages::MessagePsiResult msg, bool* fini
     return "";
 }
 
-string MessageManager::handleHashIntersect(Messages::MessagePsiIntersect msg) {
+string MessageManager::handleHashIntersect(Messages::MessagePsiIntersect &msg) {
     Log("[PSI] Intersect done, show result");
 
     this->sp->sp_psi_intersect(msg);
@@ -198,79 +204,63 @@ string MessageManager::createInitMsg(int type, string msg) {
     return nm->serialize(init_msg);
 }
 
-vector<string> MessageManager::incomingHandler(string v, int type) {
-    vector<string> res;
+MessageEnvelope MessageManager::incomingHandler(string v, int type) {
+    MessageEnvelope envelope;
 
     if (!v.empty()) {
-        string s;
-        bool ret;
-
+        // Typed dispatch on the wire header: every hop parses into a
+        // pooled envelope and tags the response with its enum type, so
+        // routing a message neither compares strings nor allocates.
         switch (type) {
         case RA_MSG0: {
-            Messages::MessageMsg0 msg0;
-            ret = msg0.ParseFromString(v);
-            if (ret && (msg0.type() == RA_MSG0)) {
-                s = this->handleMSG0(msg0);
-                res.push_back(to_string(RA_MSG0));
+            pool_msg0.Clear();
+            if (pool_msg0.ParseFromString(v) && (pool_msg0.type() == RA_MSG0)) {
+                envelope.type = RA_MSG0;
+                envelope.payload = this->handleMSG0(pool_msg0);
             }
         }
         break;
         case RA_MSG1: {
-            Messages::MessageMSG1 msg1;
-            ret = msg1.ParseFromString(v);
-            if (ret && (msg1.type() == RA_MSG1)) {
-                s = this->handleMSG1(msg1);
-                res.push_back(to_string(RA_MSG2));
+            pool_msg1.Clear();
+            if (pool_msg1.ParseFromString(v) && (pool_msg1.type() == RA_MSG1)) {
+                envelope.type = RA_MSG2;
+                envelope.payload = this->handleMSG1(pool_msg1);
             }
         }
         break;
         case RA_MSG3: {
-            Messages::MessageMSG3 msg3;
-            ret = msg3.ParseFromString(v);
-            if (ret && (msg3.type() == RA_MSG3)) {
-                s = this->handleMSG3(msg3);
-                res.push_back(to_string(RA_ATT_RESULT));
+            pool_msg3.Clear();
+            if (pool_msg3.ParseFromString(v) && (pool_msg3.type() == RA_MSG3)) {
+                envelope.type = RA_ATT_RESULT;
+                envelope.payload = this->handleMSG3(pool_msg3);
             }
         }
         break;
         case RA_PSI_SLAT: {
-            Messages::MessagePsiSalt att_ok_msg;
-            ret = att_ok_msg.ParseFromString(v);
-            if (ret) {
-                if (att_ok_msg.type() == RA_PSI_SLAT) {
-                    s = this->handleAppAttOk(att_ok_msg);
-                    res.push_back(to_string(RA_PSI_HASHDATA));
-                }
+            pool_salt.Clear();
+            if (pool_salt.ParseFromString(v) && (pool_salt.type() == RA_PSI_SLAT)) {
+                envelope.type = RA_PSI_HASHDATA;
+                envelope.payload = this->handleAppAttOk(pool_salt);
             }
         }
         break;
         case RA_PSI_RESULT: {
-            Messages::MessagePsiResult msg;
-            ret = msg.ParseFromString(v);
-            if (ret) {
-                if (msg.type() == RA_PSI_RESULT) {
-                    if (msg.state() == 1) {
-                        //no intersect result, send finished again.
-                        sleep(1);
-                    }
-                    bool finished = false;
-                    s = this->handleHashData(msg, &finished);
-                    if (finished) {
-                        res.push_back(to_string(RA_PSI_HASHDATA_FINISHED));
-                    } else {
-                        res.push_back(to_string(RA_PSI_HASHDATA));
-                    }
+            pool_result.Clear();
+            if (pool_result.ParseFromString(v) && (pool_result.type() == RA_PSI_RESULT)) {
+                if (pool_result.state() == 1) {
+                    //no intersect result, send finished again.
+                    sleep(1);
                 }
+                bool finished = false;
+                envelope.payload = this->handleHashData(pool_result, &finished);
+                envelope.type = finished ? RA_PSI_HASHDATA_FINISHED : RA_PSI_HASHDATA;
             }
         }
         break;
         case RA_PSI_INTERSECT: {
-            Messages::MessagePsiIntersect inter_msg;
-            ret = inter_msg.ParseFromString(v);
-            if (ret) {
-                if (inter_msg.type() == RA_PSI_INTERSECT) {
-                    s = this->handleHashIntersect(inter_msg);
-                }
+            pool_intersect.Clear();
+            if (pool_intersect.ParseFromString(v) && (pool_intersect.type() == RA_PSI_INTERSECT)) {
+                this->handleHashIntersect(pool_intersect);
             }
         }
         break;
@@ -279,11 +269,13 @@ vector<string> MessageManager::incomingHandler(string v, int type) {
             break;
         }
 
-        res.push_back(s);
+        // The parse is done with the incoming bytes; give the pooled
+        // read buffer back for the next message.
+        BufferPool::reclaim(std::move(v));
     } else { 	//after handshake
-        res.push_back(to_string(RA_VERIFICATION));
-        res.push_back(this->prepareVerificationRequest());
+        envelope.type = RA_VERIFICATION;
+        envelope.payload = this->prepareVerificationRequest();
     }
 
-    return res;
+    return envelope;
 }
@@ -37,26 +37,41 @@ public:
     static MessageManager* getInstance();
     virtual ~MessageManager();
     int init(string path);
-    vector<string> incomingHandler(string v, int type);
+    MessageEnvelope incomingHandler(string v, int type);
     void start();
 
 private:
     MessageManager();
     string prepareVerificationRequest();
-    string handleMSG0(Messages::MessageMsg0 m);
-    string handleMSG1(Messages::MessageMSG1 msg);
-    string handleMSG3(Messages::MessageMSG3 msg);
+    string handleMSG0(Messages::MessageMsg0 &m);
+    string handleMSG1(Messages::MessageMSG1 &msg);
+    string handleMSG3(Messages::MessageMSG3 &msg);
     string createInitMsg(int type, string msg);
-    string handleAppAttOk(Messages::MessagePsiSalt msg);
+    string handleAppAttOk(Messages::MessagePsiSalt &msg);
 
-    string handleHashData(Messages::MessagePsiResult msg, bool* finished);
-    string handleHashIntersect(Messages::MessagePsiIntersect msg);
+    string handleHashData(Messages::MessagePsiResult &msg, bool* finished);
+    string handleHashIntersect(Messages::MessagePsiIntersect &msg);
 
 private:
     static MessageManager* instance;
     NetworkManagerClient *nm = NULL;
     PSIWorker *sp = NULL;
     WebService *ws = NULL;
+
+    // Pooled message envelopes: every protocol hop parses into and
+    // replies from these, cleared between uses, instead of
+    // constructing protobuf objects per message. The manager is
+    // driven by a single io_service thread, so no locking is needed.
+    Messages::MessageMsg0 pool_msg0;
+    Messages::MessageMSG1 pool_msg1;
+    Messages::MessageMSG3 pool_msg3;
+    Messages::MessagePsiSalt pool_salt;
+    Messages::MessagePsiResult pool_result;
+    Messages::MessagePsiIntersect pool_intersect;
+    Messages::MessageMSG2 pool_msg2;
+    Messages::AttestationMessage pool_att_msg;
+    Messages::MessagePsiHashData pool_hash_data;
+    Messages::MessagePsiHashDataFinished pool_finished;
 };
 
 #endif
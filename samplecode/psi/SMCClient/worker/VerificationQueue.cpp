@@ -0,0 +1,191 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License..
+
+#include "VerificationQueue.h"
+#include "UtilityFunctions.h"
+#include "LogBase.h"
+
+#include <chrono>
+#include <string.h>
+#include <stdio.h>
+
+using namespace util;
+using namespace std;
+
+/* Batch up to this many quotes per verifier pass. */
+static const size_t VERIFY_BATCH_MAX = 8;
+/* How long a lone quote may wait for company before it is flushed. */
+static const int VERIFY_FLUSH_MS = 20;
+
+/* The same acceptance policy the msg3 handler applies to a report. */
+static bool report_admissible(const ias_att_report_t &report) {
+    return (IAS_QUOTE_OK == report.status ||
+            IAS_QUOTE_GROUP_OUT_OF_DATE == report.status ||
+            IAS_QUOTE_CONFIGURATION_NEEDED == report.status) &&
+           IAS_PSE_OK == report.pse_status;
+}
+
+VerificationQueue::VerificationQueue(WebService *ws) : ws(ws) {
+    this->verifier = thread(&VerificationQueue::VerifierLoop, this);
+}
+
+VerificationQueue::~VerificationQueue() {
+    {
+        lock_guard<mutex> guard(lock);
+        stopping = true;
+    }
+    pending_ready.notify_all();
+    verifier.join();
+}
+
+uint64_t VerificationQueue::submit(const uint8_t *quote, size_t quote_size,
+                                   const uint8_t *pse_manifest, size_t manifest_size,
+                                   bool background) {
+    Pending entry;
+    entry.background = background;
+    entry.quote.assign(quote, quote + quote_size);
+    entry.manifest.assign(pse_manifest, pse_manifest + manifest_size);
+
+    uint64_t ticket;
+    {
+        lock_guard<mutex> guard(lock);
+        ticket = next_ticket++;
+        entry.ticket = ticket;
+        pending.push_back(move(entry));
+    }
+    pending_ready.notify_one();
+
+    return ticket;
+}
+
+int VerificationQueue::wait(uint64_t ticket, ias_att_report_t *report) {
+    unique_lock<mutex> guard(lock);
+    outcome_ready.wait(guard, [this, ticket] {
+        return outcomes.count(ticket) != 0;
+    });
+
+    Outcome outcome = outcomes[ticket];
+    outcomes.erase(ticket);
+
+    if (outcome.ret == 0 && report != NULL) {
+        *report = outcome.report;
+    }
+
+    return outcome.ret;
+}
+
+bool VerificationQueue::lookup_known(const string &identity, ias_att_report_t *report) {
+    lock_guard<mutex> guard(lock);
+
+    auto it = known.find(identity);
+    if (it == known.end()) {
+        return false;
+    }
+
+    if (report != NULL) {
+        *report = it->second;
+    }
+
+    return true;
+}
+
+string VerificationQueue::quote_identity(const sgx_quote_t *quote) {
+    string identity = ByteArrayToString(quote->report_body.mr_enclave.m, SGX_HASH_SIZE);
+    identity += ByteArrayToString(quote->report_body.mr_signer.m, SGX_HASH_SIZE);
+
+    char svn[32];
+    snprintf(svn, sizeof(svn), ":%u:%u",
+             quote->report_body.isv_prod_id, quote->report_body.isv_svn);
+
+    return identity + svn;
+}
+
+void VerificationQueue::VerifierLoop() {
+    unique_lock<mutex> guard(lock);
+
+    while (true) {
+        pending_ready.wait(guard, [this] {
+            return stopping || !pending.empty();
+        });
+
+        if (pending.empty()) {
+            // only reachable when stopping: queued work drains first
+            return;
+        }
+
+        // Let a reconnect burst pile up behind the first arrival, but
+        // never hold a lone quote longer than the flush window.
+        pending_ready.wait_for(guard, chrono::milliseconds(VERIFY_FLUSH_MS), [this] {
+            return stopping || pending.size() >= VERIFY_BATCH_MAX;
+        });
+
+        vector<Pending> batch;
+        while (!pending.empty() && batch.size() < VERIFY_BATCH_MAX) {
+            batch.push_back(move(pending.front()));
+            pending.pop_front();
+        }
+        guard.unlock();
+
+        vector<uint8_t*> quotes;
+        vector<uint8_t*> manifests;
+        for (auto &entry : batch) {
+            quotes.push_back(entry.quote.data());
+            manifests.push_back(entry.manifest.data());
+        }
+
+        vector<ias_att_report_t> reports;
+        int batch_ret = ias_verify_attestation_evidence_batch(quotes, manifests, &reports, ws);
+
+        for (size_t i = 0; i < batch.size(); i++) {
+            int ret = batch_ret;
+            ias_att_report_t report = {0};
+
+            if (batch_ret == 0) {
+                report = reports[i];
+            } else {
+                // The batch call reports one verdict for all entries;
+                // retry one by one so a single bad quote cannot fail
+                // its neighbours' admission.
+                ret = ias_verify_attestation_evidence(batch[i].quote.data(),
+                                                      batch[i].manifest.data(),
+                                                      &report, ws);
+            }
+
+            string identity = quote_identity((const sgx_quote_t *)batch[i].quote.data());
+
+            guard.lock();
+            if (ret == 0 && report_admissible(report)) {
+                known[identity] = report;
+            } else if (known.erase(identity) != 0) {
+                // a re-check of an optimistically admitted worker came
+                // back bad; it verifies the slow way from now on
+                Log("Evicting worker %s after failed re-verification", identity, log::error);
+            }
+
+            if (!batch[i].background) {
+                Outcome outcome;
+                outcome.ret = ret;
+                outcome.report = report;
+                outcomes[batch[i].ticket] = outcome;
+            }
+            guard.unlock();
+        }
+
+        outcome_ready.notify_all();
+        guard.lock();
+    }
+}
@@ -0,0 +1,98 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License..
+
+#ifndef VERIFICATION_QUEUE_H
+#define VERIFICATION_QUEUE_H
+
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "sgx_key_exchange.h"
+#include "ias_ra.h"
+
+/* Deferred attestation evidence verification.
+ *
+ * Verifying each worker's evidence inline serializes the accept path
+ * behind asymmetric crypto and an IAS exchange per connection; during a
+ * fleet-wide reconnect every worker pays that latency back to back.
+ * Evidence is instead submitted to a background verifier that drains
+ * pending entries through ias_verify_attestation_evidence_batch, so the
+ * per-quote ECC context and signing setup are amortized across whatever
+ * piled up.
+ *
+ * Workers that verified successfully before are admitted optimistically:
+ * lookup_known() hands back the cached verdict immediately while the
+ * fresh evidence still goes through the batch, and a failed re-check
+ * evicts the identity so the next reconnect blocks on a full verify. */
+class VerificationQueue {
+
+public:
+    VerificationQueue(WebService *ws);
+    ~VerificationQueue();
+
+    /* Queue evidence for batched verification; returns a ticket for
+     * wait(). A background submission keeps no outcome around - the
+     * verdict only feeds the known-worker cache. */
+    uint64_t submit(const uint8_t *quote, size_t quote_size,
+                    const uint8_t *pse_manifest, size_t manifest_size,
+                    bool background = false);
+
+    /* Block until the ticket's verification finished. Returns the
+     * verification result and fills the report on success. */
+    int wait(uint64_t ticket, ias_att_report_t *report);
+
+    /* Cached verdict from the identity's last successful verification,
+     * or false if the worker is unknown (or was evicted). */
+    bool lookup_known(const std::string &identity, ias_att_report_t *report);
+
+    /* Stable key for a worker: the enclave identity fields of its quote. */
+    static std::string quote_identity(const sgx_quote_t *quote);
+
+private:
+    struct Pending {
+        uint64_t ticket;
+        bool background;
+        std::vector<uint8_t> quote;
+        std::vector<uint8_t> manifest;
+    };
+
+    struct Outcome {
+        int ret;
+        ias_att_report_t report;
+    };
+
+    void VerifierLoop();
+
+    WebService *ws = NULL;
+    std::thread verifier;
+    bool stopping = false;
+
+    std::mutex lock;
+    std::condition_variable pending_ready;
+    std::condition_variable outcome_ready;
+    std::deque<Pending> pending;
+    std::map<uint64_t, Outcome> outcomes;
+    std::map<std::string, ias_att_report_t> known;
+    uint64_t next_ticket = 1;
+};
+
+#endif
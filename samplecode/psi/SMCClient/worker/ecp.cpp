@@ -17,6 +17,9 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <mutex>
+#include <thread>
+#include <vector>
 #include "ecp.h"
 
 #include "sample_libcrypto.h"
@@ -24,6 +27,83 @@
 
 #define MAC_KEY_SIZE       16
 
+// Ephemeral ECDH key pairs kept ready for the handshake path. Generating a
+// pair is a fixed-base scalar multiplication - the expensive half of each
+// key exchange - and does not depend on the peer, so a background thread
+// computes them ahead of time and sp_ra_proc_msg1_req just pops one.
+#define EC_KEYPAIR_POOL_DEPTH 32
+
+typedef struct _ec_keypair_t {
+    sample_ec256_private_t priv;
+    sample_ec256_public_t pub;
+} ec_keypair_t;
+
+static std::vector<ec_keypair_t> g_keypair_pool;
+static std::mutex g_keypair_pool_mutex;
+static std::once_flag g_keypair_pool_once;
+
+static void keypair_pool_refill_loop() {
+    sample_ecc_state_handle_t ecc_state = NULL;
+
+    if (sample_ecc256_open_context(&ecc_state) != SAMPLE_SUCCESS) {
+        return;
+    }
+
+    while (true) {
+        {
+            std::lock_guard<std::mutex> lock(g_keypair_pool_mutex);
+            if (g_keypair_pool.size() >= EC_KEYPAIR_POOL_DEPTH) {
+                break;
+            }
+        }
+
+        ec_keypair_t pair;
+        if (sample_ecc256_create_key_pair(&pair.priv, &pair.pub, ecc_state) != SAMPLE_SUCCESS) {
+            break;
+        }
+
+        std::lock_guard<std::mutex> lock(g_keypair_pool_mutex);
+        g_keypair_pool.push_back(pair);
+        memset(&pair, 0, sizeof(pair));
+    }
+
+    sample_ecc256_close_context(ecc_state);
+}
+
+int ec_keypair_pool_get(sample_ec256_private_t *priv, sample_ec256_public_t *pub) {
+    std::call_once(g_keypair_pool_once, [] {
+        std::thread(keypair_pool_refill_loop).detach();
+    });
+
+    {
+        std::lock_guard<std::mutex> lock(g_keypair_pool_mutex);
+        if (!g_keypair_pool.empty()) {
+            ec_keypair_t &pair = g_keypair_pool.back();
+            memcpy(priv, &pair.priv, sizeof(*priv));
+            memcpy(pub, &pair.pub, sizeof(*pub));
+            memset(&pair, 0, sizeof(pair));
+            g_keypair_pool.pop_back();
+
+            // Top the pool back up for the next handshake burst.
+            if (g_keypair_pool.empty()) {
+                std::thread(keypair_pool_refill_loop).detach();
+            }
+            return 0;
+        }
+    }
+
+    // Pool drained (or refill thread not done yet): generate inline.
+    sample_ecc_state_handle_t ecc_state = NULL;
+    if (sample_ecc256_open_context(&ecc_state) != SAMPLE_SUCCESS) {
+        return -1;
+    }
+
+    sample_status_t ret = sample_ecc256_create_key_pair(priv, pub, ecc_state);
+    sample_ecc256_close_context(ecc_state);
+
+    return ret == SAMPLE_SUCCESS ? 0 : -1;
+}
+
 errno_t memcpy_s(
     void *dest,
     size_t numberOfElements,
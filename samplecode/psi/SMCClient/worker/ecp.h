@@ -22,6 +22,7 @@
 #include <stdlib.h>
 
 #include "remote_attestation_result.h"
+#include "sample_libcrypto.h"
 
 #ifndef SAMPLE_FEBITSIZE
 #define SAMPLE_FEBITSIZE                    256
@@ -53,6 +54,12 @@ typedef int errno_t;
 errno_t memcpy_s(void *dest, size_t numberOfElements, const void *src,
                  size_t count);
 
+/* Pop a pregenerated ephemeral ECDH key pair. The fixed-base b*G scalar
+ * multiplications are computed ahead of time by a background thread, so the
+ * handshake path only pays for the variable-base shared-secret multiply.
+ * Falls back to generating inline when the pool is empty. */
+int ec_keypair_pool_get(sample_ec256_private_t *priv, sample_ec256_public_t *pub);
+
 
 #ifdef SUPPLIED_KEY_DERIVATION
 
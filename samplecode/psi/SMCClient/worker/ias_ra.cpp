@@ -70,33 +70,14 @@ static const sample_ec256_private_t g_rk_priv_key = {
 };
 
 
-// Simulates the attestation server function for verifying the quote produce by
-// the ISV enclave. It doesn't decrypt or verify the quote in
-// the simulation.  Just produces the attestaion verification
-// report with the platform info blob.
-//
-// @param p_isv_quote Pointer to the quote generated by the ISV
-//                    enclave.
-// @param pse_manifest Pointer to the PSE manifest if used.
-// @param p_attestation_verification_report Pointer the outputed
-//                                          verification report.
-//
-// @return int
-
-int ias_verify_attestation_evidence(
-    uint8_t *p_isv_quote,
-    uint8_t* pse_manifest,
+// Shared tail of the verification: translate the IAS response into the
+// report structure and sign the platform info blob with the supplied ECC
+// context, so batch callers can reuse one context across many quotes.
+static int ias_fill_report(
+    const vector<pair<string, string>> &result,
     ias_att_report_t* p_attestation_verification_report,
-    WebService *ws) {
+    sample_ecc_state_handle_t ecc_state) {
     int ret = 0;
-    sample_ecc_state_handle_t ecc_state = NULL;
-
-    vector<pair<string, string>> result;
-    bool error = ws->verifyQuote(p_isv_quote, pse_manifest, NULL, &result);
-
-    if (error || (NULL == p_isv_quote) || (NULL == p_attestation_verification_report)) {
-        return -1;
-    }
 
     string report_id;
     uintmax_t test;
@@ -155,36 +136,21 @@ int ias_verify_attestation_evidence(
     memset(p_attestation_verification_report->info_blob.latest_psda_svn, 0, PSDA_SVN_SIZE);
     memset(p_attestation_verification_report->info_blob.performance_rekey_gid, 0, GID_SIZE);
 
-    // Generate the Service providers ECCDH key pair.
-    do {
-        ret = sample_ecc256_open_context(&ecc_state);
-        if (SAMPLE_SUCCESS != ret) {
-            Log("Error, cannot get ECC context", log::error);
-            ret = -1;
-            break;
-        }
-        // Sign
-        ret = sample_ecdsa_sign((uint8_t *)&p_attestation_verification_report->info_blob.sample_epid_group_status,
-                                sizeof(ias_platform_info_blob_t) - sizeof(sample_ec_sign256_t),
-                                (sample_ec256_private_t *)&g_rk_priv_key,
-                                (sample_ec256_signature_t *)&p_attestation_verification_report->info_blob.signature,
-                                ecc_state);
-
-        if (SAMPLE_SUCCESS != ret) {
-            Log("Error, sign ga_gb fail", log::error);
-            ret = SP_INTERNAL_ERROR;
-            break;
-        }
-
-        SWAP_ENDIAN_32B(p_attestation_verification_report->info_blob.signature.x);
-        SWAP_ENDIAN_32B(p_attestation_verification_report->info_blob.signature.y);
+    // Sign
+    ret = sample_ecdsa_sign((uint8_t *)&p_attestation_verification_report->info_blob.sample_epid_group_status,
+                            sizeof(ias_platform_info_blob_t) - sizeof(sample_ec_sign256_t),
+                            (sample_ec256_private_t *)&g_rk_priv_key,
+                            (sample_ec256_signature_t *)&p_attestation_verification_report->info_blob.signature,
+                            ecc_state);
 
-    } while (0);
-
-    if (ecc_state) {
-        sample_ecc256_close_context(ecc_state);
+    if (SAMPLE_SUCCESS != ret) {
+        Log("Error, sign ga_gb fail", log::error);
+        return SP_INTERNAL_ERROR;
     }
 
+    SWAP_ENDIAN_32B(p_attestation_verification_report->info_blob.signature.x);
+    SWAP_ENDIAN_32B(p_attestation_verification_report->info_blob.signature.y);
+
     p_attestation_verification_report->pse_status = IAS_PSE_OK;
 
     // For now, don't simulate the policy reports.
@@ -193,3 +159,91 @@ int ias_verify_attestation_evidence(
     return ret;
 }
 
+
+// Simulates the attestation server function for verifying the quote produce by
+// the ISV enclave. It doesn't decrypt or verify the quote in
+// the simulation.  Just produces the attestaion verification
+// report with the platform info blob.
+//
+// @param p_isv_quote Pointer to the quote generated by the ISV
+//                    enclave.
+// @param pse_manifest Pointer to the PSE manifest if used.
+// @param p_attestation_verification_report Pointer the outputed
+//                                          verification report.
+//
+// @return int
+
+int ias_verify_attestation_evidence(
+    uint8_t *p_isv_quote,
+    uint8_t* pse_manifest,
+    ias_att_report_t* p_attestation_verification_report,
+    WebService *ws) {
+    int ret = 0;
+    sample_ecc_state_handle_t ecc_state = NULL;
+
+    vector<pair<string, string>> result;
+    bool error = ws->verifyQuote(p_isv_quote, pse_manifest, NULL, &result);
+
+    if (error || (NULL == p_isv_quote) || (NULL == p_attestation_verification_report)) {
+        return -1;
+    }
+
+    ret = sample_ecc256_open_context(&ecc_state);
+    if (SAMPLE_SUCCESS != ret) {
+        Log("Error, cannot get ECC context", log::error);
+        return -1;
+    }
+
+    ret = ias_fill_report(result, p_attestation_verification_report, ecc_state);
+
+    sample_ecc256_close_context(ecc_state);
+
+    return ret;
+}
+
+
+int ias_verify_attestation_evidence_batch(
+    const vector<uint8_t*> &quotes,
+    const vector<uint8_t*> &pse_manifests,
+    vector<ias_att_report_t> *reports,
+    WebService *ws) {
+    int ret = 0;
+    sample_ecc_state_handle_t ecc_state = NULL;
+
+    if (reports == NULL || quotes.size() != pse_manifests.size()) {
+        return -1;
+    }
+
+    // One ECC context serves the whole batch; opening and closing it per
+    // quote is pure overhead when a fleet attests at once.
+    ret = sample_ecc256_open_context(&ecc_state);
+    if (SAMPLE_SUCCESS != ret) {
+        Log("Error, cannot get ECC context", log::error);
+        return -1;
+    }
+
+    reports->resize(quotes.size());
+
+    for (size_t i = 0; i < quotes.size(); i++) {
+        ias_att_report_t *report = &(*reports)[i];
+        memset(report, 0, sizeof(*report));
+
+        vector<pair<string, string>> result;
+        bool error = ws->verifyQuote(quotes[i], pse_manifests[i], NULL, &result);
+
+        if (error || quotes[i] == NULL) {
+            ret = -1;
+            continue;
+        }
+
+        int fill_ret = ias_fill_report(result, report, ecc_state);
+        if (fill_ret != 0) {
+            ret = fill_ret;
+        }
+    }
+
+    sample_ecc256_close_context(ecc_state);
+
+    return ret;
+}
+
@@ -24,6 +24,10 @@
 #include "LogBase.h"
 #include "WebService.h"
 
+#ifdef __cplusplus
+#include <vector>
+#endif
+
 using namespace util;
 
 typedef enum {
@@ -150,6 +154,16 @@ int ias_verify_attestation_evidence(uint8_t* p_isv_quote, uint8_t* pse_manifest,
 
 #ifdef  __cplusplus
 }
+
+/* Verify a batch of evidence blobs in one call, sharing a single ECC
+ * context and report-key signing setup across the whole batch instead of
+ * recreating them per quote. Entries in the output vector line up with the
+ * input; each element's return convention matches the single-quote call. */
+int ias_verify_attestation_evidence_batch(
+    const std::vector<uint8_t*> &quotes,
+    const std::vector<uint8_t*> &pse_manifests,
+    std::vector<ias_att_report_t> *reports,
+    WebService *ws);
 #endif
 
 #endif
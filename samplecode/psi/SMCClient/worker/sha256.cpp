@@ -40,3 +40,137 @@ int Sha256::hash(sample_sha256_hash_t* report_data) {
 
     return 0;
 }
+
+#include <immintrin.h>
+#include <cpuid.h>
+#include <string.h>
+#include <stdlib.h>
+
+// SHA-NI one-shot path for the bulk PSI hashing loop. The streaming
+// sample_libcrypto context stays as the fallback for CPUs without the
+// SHA extensions.
+static bool cpuHasShaNi() {
+    static int cached = -1;
+    if (cached < 0) {
+        unsigned int eax, ebx, ecx, edx;
+        cached = 0;
+        if (__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) {
+            cached = (ebx >> 29) & 1;
+        }
+    }
+    return cached == 1;
+}
+
+__attribute__((target("sha,sse4.1,ssse3")))
+static void sha256NiCompress(uint32_t state[8], const uint8_t *data, size_t blocks) {
+    static const uint32_t K[64] = {
+        0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+        0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+        0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+        0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+        0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+        0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+        0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+        0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+        0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+        0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+        0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+        0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+        0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+        0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+        0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+        0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+    };
+    const __m128i MASK = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+    __m128i TMP = _mm_loadu_si128((const __m128i *)&state[0]);
+    __m128i STATE1 = _mm_loadu_si128((const __m128i *)&state[4]);
+    TMP = _mm_shuffle_epi32(TMP, 0xB1);                  /* CDAB */
+    STATE1 = _mm_shuffle_epi32(STATE1, 0x1B);            /* EFGH */
+    __m128i STATE0 = _mm_alignr_epi8(TMP, STATE1, 8);    /* ABEF */
+    STATE1 = _mm_blend_epi16(STATE1, TMP, 0xF0);         /* CDGH */
+
+    while (blocks--) {
+        __m128i abefSave = STATE0;
+        __m128i cdghSave = STATE1;
+        __m128i msgs[4];
+
+        for (int i = 0; i < 4; i++) {
+            msgs[i] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(data + 16 * i)), MASK);
+        }
+        // Four rounds per iteration; the message-schedule helpers run for
+        // the group ranges the SHA-NI dataflow requires (msg2: 3..14,
+        // msg1: 1..12).
+        for (int i = 0; i < 16; i++) {
+            __m128i msg = _mm_add_epi32(msgs[i & 3], _mm_loadu_si128((const __m128i *)&K[4 * i]));
+            STATE1 = _mm_sha256rnds2_epu32(STATE1, STATE0, msg);
+            if (i >= 3 && i <= 14) {
+                __m128i tmp = _mm_alignr_epi8(msgs[i & 3], msgs[(i + 3) & 3], 4);
+                msgs[(i + 1) & 3] = _mm_add_epi32(msgs[(i + 1) & 3], tmp);
+                msgs[(i + 1) & 3] = _mm_sha256msg2_epu32(msgs[(i + 1) & 3], msgs[i & 3]);
+            }
+            msg = _mm_shuffle_epi32(msg, 0x0E);
+            STATE0 = _mm_sha256rnds2_epu32(STATE0, STATE1, msg);
+            if (i >= 1 && i <= 12) {
+                msgs[(i + 3) & 3] = _mm_sha256msg1_epu32(msgs[(i + 3) & 3], msgs[i & 3]);
+            }
+        }
+        STATE0 = _mm_add_epi32(STATE0, abefSave);
+        STATE1 = _mm_add_epi32(STATE1, cdghSave);
+        data += 64;
+    }
+
+    TMP = _mm_shuffle_epi32(STATE0, 0x1B);               /* FEBA */
+    STATE1 = _mm_shuffle_epi32(STATE1, 0xB1);            /* DCHG */
+    STATE0 = _mm_blend_epi16(TMP, STATE1, 0xF0);         /* DCBA */
+    STATE1 = _mm_alignr_epi8(STATE1, TMP, 8);            /* HGFE */
+    _mm_storeu_si128((__m128i *)&state[0], STATE0);
+    _mm_storeu_si128((__m128i *)&state[4], STATE1);
+}
+
+static int sha256NiDigest(const uint8_t *data, size_t data_len,
+                          const uint8_t *salt, size_t salt_len,
+                          uint8_t out[32]) {
+    uint32_t state[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+        0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+    size_t total = data_len + salt_len;
+    size_t padded = ((total + 8) / 64 + 1) * 64;
+    uint8_t *buf = (uint8_t *)calloc(1, padded);
+    if (buf == NULL) {
+        return -1;
+    }
+    memcpy(buf, data, data_len);
+    memcpy(buf + data_len, salt, salt_len);
+    buf[total] = 0x80;
+    uint64_t bits = (uint64_t)total * 8;
+    for (int i = 0; i < 8; i++) {
+        buf[padded - 1 - i] = (uint8_t)(bits >> (8 * i));
+    }
+    sha256NiCompress(state, buf, padded / 64);
+    free(buf);
+    for (int i = 0; i < 8; i++) {
+        out[4 * i] = (uint8_t)(state[i] >> 24);
+        out[4 * i + 1] = (uint8_t)(state[i] >> 16);
+        out[4 * i + 2] = (uint8_t)(state[i] >> 8);
+        out[4 * i + 3] = (uint8_t)state[i];
+    }
+    return 0;
+}
+
+int Sha256::digest(const uint8_t *data, size_t data_len,
+                   const uint8_t *salt, size_t salt_len,
+                   sample_sha256_hash_t *out) {
+    if (cpuHasShaNi()) {
+        return sha256NiDigest(data, data_len, salt, salt_len, (uint8_t *)out);
+    }
+    Sha256 sha256;
+    if (sha256.update((uint8_t *)data, data_len) != 0) {
+        return -1;
+    }
+    if (salt_len > 0 && sha256.update((uint8_t *)salt, salt_len) != 0) {
+        return -1;
+    }
+    return sha256.hash(out);
+}
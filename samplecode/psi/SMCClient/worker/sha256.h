@@ -19,6 +19,12 @@ public:
     int update(uint8_t* data, uint32_t size);
     int hash(sample_sha256_hash_t* report_data);
 
+    // One-shot hash of data||salt, using the CPU SHA extensions when
+    // available and the streaming sample_libcrypto context otherwise.
+    static int digest(const uint8_t *data, size_t data_len,
+                      const uint8_t *salt, size_t salt_len,
+                      sample_sha256_hash_t *out);
+
 private:
     sample_sha_state_handle_t sha_handle;
 };
@@ -455,11 +455,21 @@ fn obinary_search(b: &Vec<[u8; SGX_HASH_SIZE]>, target: &[u8; SGX_HASH_SIZE], v2
     ret
 }
 
+// Hashes are compared eight bytes at a time: loading a big-endian word is
+// data-independent, so the access pattern stays oblivious while the omov
+// chains shrink from SGX_HASH_SIZE steps to SGX_HASH_SIZE / 8.
+#[inline]
+fn word_be(h: &[u8; SGX_HASH_SIZE], i: usize) -> u64 {
+    let mut w = [0_u8; 8];
+    w.copy_from_slice(&h[i * 8..i * 8 + 8]);
+    u64::from_be_bytes(w)
+}
+
 fn eq(a: &[u8; SGX_HASH_SIZE], b: &[u8; SGX_HASH_SIZE]) -> isize {
 
     let mut ret: isize = 1;
-    for i in 0..SGX_HASH_SIZE {
-        let hit = oequal(a[i] as usize, b[i] as usize);
+    for i in 0..SGX_HASH_SIZE / 8 {
+        let hit = oequal(word_be(a, i) as usize, word_be(b, i) as usize);
         ret = omov(hit as isize, ret, 0);
     }
     ret
@@ -468,10 +478,12 @@ fn eq(a: &[u8; SGX_HASH_SIZE], b: &[u8; SGX_HASH_SIZE]) -> isize {
 fn le(a: &[u8; SGX_HASH_SIZE], b: &[u8; SGX_HASH_SIZE]) -> isize {
 
     let mut ret: isize = 0;
-    for i in 0..SGX_HASH_SIZE {
+    for i in 0..SGX_HASH_SIZE / 8 {
 
-        let hit = oequal(a[i] as usize, b[i] as usize);
-        let be = ob(a[i] as usize, b[i] as usize);
+        let x = word_be(a, i) as usize;
+        let y = word_be(b, i) as usize;
+        let hit = oequal(x, y);
+        let be = ob(x, y);
         let cmp = omov(hit as isize, 0, omov(be as isize, -1, 1));
         ret = omov(ret, ret, cmp)
     }
@@ -481,10 +493,12 @@ fn le(a: &[u8; SGX_HASH_SIZE], b: &[u8; SGX_HASH_SIZE]) -> isize {
 fn ge(a: &[u8; SGX_HASH_SIZE], b: &[u8; SGX_HASH_SIZE]) -> isize {
 
     let mut ret: isize = 0;
-    for i in 0..SGX_HASH_SIZE {
+    for i in 0..SGX_HASH_SIZE / 8 {
 
-        let hit = oequal(a[i] as usize, b[i] as usize);
-        let ae = oa(a[i] as usize, b[i] as usize);
+        let x = word_be(a, i) as usize;
+        let y = word_be(b, i) as usize;
+        let hit = oequal(x, y);
+        let ae = oa(x, y);
         let cmp = omov(hit as isize, 0, omov(ae as isize, 1, -1));
         ret = omov(ret, ret, cmp)
     }
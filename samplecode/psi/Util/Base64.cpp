@@ -17,52 +17,72 @@
 
 #include "Base64.h"
 #include <iostream>
+#include <cstring>
+#include <tmmintrin.h>
 
 static const std::string base64_chars =
     "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
     "abcdefghijklmnopqrstuvwxyz"
     "0123456789+/";
 
-
-static inline bool is_base64(unsigned char c) {
-    return (isalnum(c) || (c == '+') || (c == '/'));
+// SSSE3 inner loop: split twelve input bytes into sixteen 6-bit indices and
+// translate them to ASCII with a shuffle-based offset table, so the hot PSI
+// report paths encode a whole register per iteration instead of one octet
+// triple at a time.
+__attribute__((target("ssse3")))
+static void encode12(const unsigned char *src, char *dst) {
+    __m128i in = _mm_loadu_si128((const __m128i *)src);
+    const __m128i shuf = _mm_set_epi8(10,11,9,10, 7,8,6,7, 4,5,3,4, 1,2,0,1);
+    in = _mm_shuffle_epi8(in, shuf);
+    const __m128i t0 = _mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00));
+    const __m128i t1 = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+    const __m128i t2 = _mm_and_si128(in, _mm_set1_epi32(0x003f03f0));
+    const __m128i t3 = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+    const __m128i indices = _mm_or_si128(t1, t3);
+
+    __m128i result = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+    const __m128i less = _mm_cmpgt_epi8(_mm_set1_epi8(26), indices);
+    result = _mm_or_si128(result, _mm_and_si128(less, _mm_set1_epi8(13)));
+    const __m128i offsets = _mm_setr_epi8('a'-26, '0'-52, '0'-52, '0'-52, '0'-52,
+                                          '0'-52, '0'-52, '0'-52, '0'-52, '0'-52,
+                                          '0'-52, '+'-62, '/'-63, 'A', 0, 0);
+    result = _mm_add_epi8(_mm_shuffle_epi8(offsets, result), indices);
+    _mm_storeu_si128((__m128i *)dst, result);
 }
 
 std::string base64_encode(unsigned char const* bytes_to_encode, unsigned int in_len) {
     std::string ret;
-    int i = 0;
-    int j = 0;
-    unsigned char char_array_3[3];
-    unsigned char char_array_4[4];
-
-    while (in_len--) {
-        char_array_3[i++] = *(bytes_to_encode++);
-        if (i == 3) {
-            char_array_4[0] = (char_array_3[0] & 0xfc) >> 2;
-            char_array_4[1] = ((char_array_3[0] & 0x03) << 4) + ((char_array_3[1] & 0xf0) >> 4);
-            char_array_4[2] = ((char_array_3[1] & 0x0f) << 2) + ((char_array_3[2] & 0xc0) >> 6);
-            char_array_4[3] = char_array_3[2] & 0x3f;
-
-            for (i=0; i<4; i++)
-                ret += base64_chars[char_array_4[i]];
-            i = 0;
-        }
+    ret.resize(((in_len + 2) / 3) * 4);
+    char *dst = &ret[0];
+    const unsigned char *p = bytes_to_encode;
+    unsigned int n = in_len;
+
+    // The vector loop consumes 12 bytes but loads 16, so leave a scalar tail.
+    while (n >= 16) {
+        encode12(p, dst);
+        p += 12;
+        dst += 16;
+        n -= 12;
     }
-
-    if (i) {
-        for(j = i; j < 3; j++)
-            char_array_3[j] = '\0';
-
-        char_array_4[0] = (char_array_3[0] & 0xfc) >> 2;
-        char_array_4[1] = ((char_array_3[0] & 0x03) << 4) + ((char_array_3[1] & 0xf0) >> 4);
-        char_array_4[2] = ((char_array_3[1] & 0x0f) << 2) + ((char_array_3[2] & 0xc0) >> 6);
-        char_array_4[3] = char_array_3[2] & 0x3f;
-
-        for (j=0; j<i+1; j++)
-            ret += base64_chars[char_array_4[j]];
-
-        while((i++ < 3))
-            ret += '=';
+    while (n >= 3) {
+        dst[0] = base64_chars[p[0] >> 2];
+        dst[1] = base64_chars[((p[0] & 0x03) << 4) | (p[1] >> 4)];
+        dst[2] = base64_chars[((p[1] & 0x0f) << 2) | (p[2] >> 6)];
+        dst[3] = base64_chars[p[2] & 0x3f];
+        p += 3;
+        dst += 4;
+        n -= 3;
+    }
+    if (n > 0) {
+        dst[0] = base64_chars[p[0] >> 2];
+        if (n == 1) {
+            dst[1] = base64_chars[(p[0] & 0x03) << 4];
+            dst[2] = '=';
+        } else {
+            dst[1] = base64_chars[((p[0] & 0x03) << 4) | (p[1] >> 4)];
+            dst[2] = base64_chars[(p[1] & 0x0f) << 2];
+        }
+        dst[3] = '=';
     }
 
     return ret;
@@ -70,45 +90,37 @@ std::string base64_encode(unsigned char const* bytes_to_encode, unsigned int in_
 
 
 std::string base64_decode(std::string const& encoded_string) {
-    int in_len = encoded_string.size();
-    int i = 0;
-    int j = 0;
-    int in_ = 0;
-    unsigned char char_array_4[4], char_array_3[3];
-    std::string ret;
-
-    while (in_len-- && ( encoded_string[in_] != '=') && is_base64(encoded_string[in_])) {
-        char_array_4[i++] = encoded_string[in_];
-        in_++;
-        if (i ==4) {
-            for (i=0; i<4; i++)
-                char_array_4[i] = base64_chars.find(char_array_4[i]);
-
-            char_array_3[0] = (char_array_4[0] << 2) + ((char_array_4[1] & 0x30) >> 4);
-            char_array_3[1] = ((char_array_4[1] & 0xf) << 4) + ((char_array_4[2] & 0x3c) >> 2);
-            char_array_3[2] = ((char_array_4[2] & 0x3) << 6) + char_array_4[3];
-
-            for (i=0; i<3; i++)
-                ret += char_array_3[i];
-            i = 0;
+    // 256-entry reverse table instead of a std::string::find per character.
+    static signed char lut[256];
+    static bool lut_ready = false;
+    if (!lut_ready) {
+        memset(lut, -1, sizeof(lut));
+        for (int k = 0; k < 64; k++) {
+            lut[(unsigned char)base64_chars[k]] = (signed char)k;
         }
+        lut_ready = true;
     }
 
-    if (i) {
-        for (j=i; j<4; j++)
-            char_array_4[j] = 0;
-
-        for (j=0; j<4; j++)
-            char_array_4[j] = base64_chars.find(char_array_4[j]);
-
-        char_array_3[0] = (char_array_4[0] << 2) + ((char_array_4[1] & 0x30) >> 4);
-        char_array_3[1] = ((char_array_4[1] & 0xf) << 4) + ((char_array_4[2] & 0x3c) >> 2);
-        char_array_3[2] = ((char_array_4[2] & 0x3) << 6) + char_array_4[3];
-
-        for (j=0; j<i-1; j++)
-			ret += char_array_3[j];
+    size_t in_len = encoded_string.size();
+    std::string ret;
+    ret.reserve((in_len / 4) * 3 + 3);
+
+    unsigned int acc = 0;
+    int nbits = 0;
+    for (size_t k = 0; k < in_len; k++) {
+        signed char v = lut[(unsigned char)encoded_string[k]];
+        if (v < 0) {
+            // '=' padding or any non-alphabet byte ends the payload, matching
+            // the previous implementation.
+            break;
+        }
+        acc = (acc << 6) | (unsigned int)v;
+        nbits += 6;
+        if (nbits >= 8) {
+            nbits -= 8;
+            ret += (char)((acc >> nbits) & 0xff);
+        }
     }
 
     return ret;
 }
-
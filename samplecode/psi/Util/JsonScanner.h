@@ -0,0 +1,275 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License..
+
+#ifndef JSONSCANNER_H
+#define JSONSCANNER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// Flat-field extractor for IAS report bodies, simdjson-style: a SIMD
+// pass over the whole payload builds a structural index of string
+// boundaries (16 bytes per compare on SSE2), and field lookup then
+// walks that index instead of re-scanning 100KB of base64 through a
+// DOM parser. Only what verdict extraction needs is supported:
+// top-level fields of a JSON object, returned as text.
+class JsonScanner {
+
+public:
+    explicit JsonScanner(const std::string& json) : json_(json), ok_(false) {
+        indexQuotes();
+        if (quotes_.size() % 2 == 0) {
+            collectFields();
+        }
+    }
+
+    // False when the payload was not an object or its quotes did not
+    // pair up; get() then always returns the fallback.
+    bool ok() const {
+        return ok_;
+    }
+
+    // The top-level field named `key` as text: string values come back
+    // without their quotes (common escapes resolved), numbers and
+    // literals verbatim. Missing fields yield `fallback`.
+    std::string get(const std::string& key, const std::string& fallback = std::string()) const {
+        for (size_t i = 0; i < fields_.size(); i++) {
+            const Field& f = fields_[i];
+            if (f.key_len == key.size() &&
+                    json_.compare(f.key_begin, f.key_len, key) == 0) {
+                if (f.quoted) {
+                    return unescape(f.val_begin, f.val_len);
+                }
+                return json_.substr(f.val_begin, f.val_len);
+            }
+        }
+        return fallback;
+    }
+
+private:
+    struct Field {
+        size_t key_begin;
+        size_t key_len;
+        size_t val_begin;
+        size_t val_len;
+        bool quoted;
+    };
+
+    // Stage 1: positions of all unescaped quotes. The SIMD pass finds
+    // quote candidates 16 bytes at a time; the (rare) escape check runs
+    // scalar only at candidate positions.
+    void indexQuotes() {
+        const char* data = json_.data();
+        size_t len = json_.size();
+        size_t pos = 0;
+
+#ifdef __SSE2__
+        const __m128i quote = _mm_set1_epi8('"');
+        while (pos + 16 <= len) {
+            __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+            unsigned mask = _mm_movemask_epi8(_mm_cmpeq_epi8(block, quote));
+            while (mask != 0) {
+                unsigned bit = mask & (~mask + 1);
+                size_t at = pos + trailingZeros(bit);
+                if (!isEscaped(at)) {
+                    quotes_.push_back(at);
+                }
+                mask &= mask - 1;
+            }
+            pos += 16;
+        }
+#endif
+        for (; pos < len; pos++) {
+            if (data[pos] == '"' && !isEscaped(pos)) {
+                quotes_.push_back(pos);
+            }
+        }
+    }
+
+    static unsigned trailingZeros(unsigned bit) {
+        unsigned n = 0;
+        while ((bit & 1) == 0) {
+            bit >>= 1;
+            n++;
+        }
+        return n;
+    }
+
+    bool isEscaped(size_t at) const {
+        size_t backslashes = 0;
+        while (at > backslashes && json_[at - backslashes - 1] == '\\') {
+            backslashes++;
+        }
+        return (backslashes & 1) != 0;
+    }
+
+    // Stage 2: pair the quotes into strings and walk the gaps between
+    // them tracking nesting depth, recording key/value spans for every
+    // depth-one field.
+    void collectFields() {
+        size_t len = json_.size();
+        size_t depth = 0;
+        size_t cursor = 0;
+        size_t next_quote = 0;
+        bool seen_root = false;
+
+        while (cursor < len) {
+            if (next_quote < quotes_.size() && cursor == quotes_[next_quote]) {
+                if (depth == 1) {
+                    if (!takeField(&cursor, &next_quote)) {
+                        return;
+                    }
+                } else {
+                    // A string nested below the top level; skip it
+                    // whole, field-less.
+                    if (next_quote + 1 >= quotes_.size()) {
+                        return;
+                    }
+                    cursor = quotes_[next_quote + 1] + 1;
+                    next_quote += 2;
+                }
+                continue;
+            }
+
+            char c = json_[cursor];
+            if (c == '{' || c == '[') {
+                if (depth == 0) {
+                    if (c != '{') {
+                        return;
+                    }
+                    seen_root = true;
+                }
+                depth++;
+                cursor++;
+            } else if (c == '}' || c == ']') {
+                if (depth > 0) {
+                    depth--;
+                }
+                cursor++;
+            } else {
+                cursor++;
+            }
+        }
+
+        ok_ = seen_root && depth == 0;
+    }
+
+    size_t skipSpaces(size_t at) const {
+        while (at < json_.size() && (json_[at] == ' ' || json_[at] == '\t' ||
+                                     json_[at] == '\n' || json_[at] == '\r')) {
+            at++;
+        }
+        return at;
+    }
+
+    // Consume one `"key": value` pair starting at an opening quote.
+    bool takeField(size_t* cursor, size_t* next_quote) {
+        if (*next_quote + 1 >= quotes_.size()) {
+            return false;
+        }
+        size_t key_open = quotes_[*next_quote];
+        size_t key_close = quotes_[*next_quote + 1];
+        *next_quote += 2;
+
+        size_t at = skipSpaces(key_close + 1);
+        if (at >= json_.size() || json_[at] != ':') {
+            // A bare string (array element at depth 1); not a field.
+            *cursor = key_close + 1;
+            return true;
+        }
+        at = skipSpaces(at + 1);
+        if (at >= json_.size()) {
+            return false;
+        }
+
+        Field f;
+        f.key_begin = key_open + 1;
+        f.key_len = key_close - key_open - 1;
+
+        char c = json_[at];
+        if (c == '"') {
+            if (*next_quote + 1 >= quotes_.size() || quotes_[*next_quote] != at) {
+                return false;
+            }
+            f.val_begin = at + 1;
+            f.val_len = quotes_[*next_quote + 1] - at - 1;
+            f.quoted = true;
+            *cursor = quotes_[*next_quote + 1] + 1;
+            *next_quote += 2;
+        } else if (c == '{' || c == '[') {
+            // Nested value: leave it for the depth walk in the caller,
+            // which skips it field-less.
+            *cursor = at;
+            return true;
+        } else {
+            size_t end = at;
+            while (end < json_.size() && json_[end] != ',' &&
+                   json_[end] != '}' && json_[end] != ']') {
+                end++;
+            }
+            size_t trimmed = end;
+            while (trimmed > at && (json_[trimmed - 1] == ' ' || json_[trimmed - 1] == '\t' ||
+                                    json_[trimmed - 1] == '\n' || json_[trimmed - 1] == '\r')) {
+                trimmed--;
+            }
+            f.val_begin = at;
+            f.val_len = trimmed - at;
+            f.quoted = false;
+            *cursor = end;
+        }
+
+        fields_.push_back(f);
+        return true;
+    }
+
+    std::string unescape(size_t begin, size_t len) const {
+        std::string out;
+        out.reserve(len);
+        for (size_t i = 0; i < len; i++) {
+            char c = json_[begin + i];
+            if (c == '\\' && i + 1 < len) {
+                char next = json_[begin + i + 1];
+                switch (next) {
+                case '"': out.push_back('"'); i++; continue;
+                case '\\': out.push_back('\\'); i++; continue;
+                case '/': out.push_back('/'); i++; continue;
+                case 'n': out.push_back('\n'); i++; continue;
+                case 't': out.push_back('\t'); i++; continue;
+                case 'r': out.push_back('\r'); i++; continue;
+                default: break;
+                }
+            }
+            out.push_back(c);
+        }
+        return out;
+    }
+
+private:
+    const std::string& json_;
+    std::vector<size_t> quotes_;
+    std::vector<Field> fields_;
+    bool ok_;
+};
+
+#endif
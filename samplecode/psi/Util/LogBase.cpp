@@ -43,26 +43,93 @@ LogBase::LogBase() {
 
     root.setPriority(log4cpp::Priority::INFO);
     root.addAppender(this->appender);
+
+    this->writer = std::thread(&LogBase::WriterLoop, this);
 }
 
 
-LogBase::~LogBase() {}
+LogBase::~LogBase() {
+    {
+        std::unique_lock<std::mutex> guard(queue_lock);
+        stopping = true;
+    }
+    queue_ready.notify_all();
+    if (writer.joinable()) {
+        writer.join();
+    }
+}
 
 
 void LogBase::Log(const log::Fmt& msg, log::Severity s) {
-    if (IsEnabled(s) && !IsEnabled(log::timer)) {
-        switch (s) {
-        case log::info:
-            root.info(msg.str());
-            break;
-        case log::error:
-            root.error(msg.str());
-            break;
-        case log::warning:
-            root.warn(msg.str());
-            break;
+    if (ShouldLog(s)) {
+        // Format on the caller (the arguments are references into its
+        // frame), hand the I/O to the writer thread.
+        Enqueue(s, msg.str());
+    }
+}
+
+
+void LogBase::Enqueue(log::Severity s, std::string&& line) {
+    {
+        std::unique_lock<std::mutex> guard(queue_lock);
+        if (queue.size() >= max_queued) {
+            // Never let logging stall the request path: drop and count.
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
         }
+        queue.emplace_back(s, std::move(line));
     }
+    queue_ready.notify_one();
+}
+
+
+void LogBase::WriterLoop() {
+    std::unique_lock<std::mutex> guard(queue_lock);
+    while (true) {
+        if (queue.empty()) {
+            if (stopping) {
+                return;
+            }
+            queue_drained.notify_all();
+            queue_ready.wait(guard);
+            continue;
+        }
+        std::pair<log::Severity, std::string> entry = std::move(queue.front());
+        queue.pop_front();
+        guard.unlock();
+        WriteOut(entry.first, entry.second);
+        guard.lock();
+    }
+}
+
+
+void LogBase::WriteOut(log::Severity s, const std::string& line) {
+    switch (s) {
+    case log::info:
+        root.info(line);
+        break;
+    case log::error:
+        root.error(line);
+        break;
+    case log::warning:
+        root.warn(line);
+        break;
+    default:
+        break;
+    }
+}
+
+
+void LogBase::Flush() {
+    std::unique_lock<std::mutex> guard(queue_lock);
+    while (!queue.empty()) {
+        queue_drained.wait(guard);
+    }
+}
+
+
+uint64_t LogBase::Dropped() const {
+    return dropped.load(std::memory_order_relaxed);
 }
 
 
@@ -88,6 +155,11 @@ bool LogBase::IsEnabled( log::Severity s ) const {
 }
 
 
+bool LogBase::ShouldLog(log::Severity s) const {
+    return IsEnabled(s) && !IsEnabled(log::timer);
+}
+
+
 void Log(const string& str, log::Severity s) {
     LogBase::Inst()->Log(log::Fmt(str), s);
 }
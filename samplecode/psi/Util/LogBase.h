@@ -27,10 +27,16 @@
 #include <log4cpp/Priority.hh>
 
 #include <boost/format.hpp>
-#include <memory>
+#include <atomic>
 #include <bitset>
+#include <condition_variable>
+#include <deque>
+#include <memory>
 #include <mutex>
 #include <string>
+#include <thread>
+#include <utility>
+#include <vector>
 
 using namespace std;
 
@@ -57,11 +63,21 @@ public:
     void Log(const log::Fmt& msg, log::Severity s = log::info);
     bool Enable(log::Severity s, bool enable = true);
     bool IsEnabled(log::Severity s) const;
+    // The gate the formatting templates use: true when a message of
+    // this severity would actually be written.
+    bool ShouldLog(log::Severity s) const;
     void DisableAll(bool b);
+    // Block until every queued message has reached the appender.
+    void Flush();
+    // Messages dropped because the queue was full.
+    uint64_t Dropped() const;
     virtual ~LogBase();
 
 private:
     LogBase();
+    void Enqueue(log::Severity s, std::string&& line);
+    void WriterLoop();
+    void WriteOut(log::Severity s, const std::string& line);
 
 private:
     std::bitset<log::severity_count> m_enabled;
@@ -69,6 +85,17 @@ private:
     log4cpp::Appender *appender;
     log4cpp::Category &root = log4cpp::Category::getRoot();
 
+    // Bounded MPSC queue drained by one background writer, so the
+    // request path pays a lock-and-push instead of synchronous I/O.
+    enum { max_queued = 8192 };
+    std::deque<std::pair<log::Severity, std::string>> queue;
+    mutable std::mutex queue_lock;
+    std::condition_variable queue_ready;
+    std::condition_variable queue_drained;
+    std::thread writer;
+    bool stopping = false;
+    std::atomic<uint64_t> dropped { 0 };
+
     struct timespec start;
     vector<pair<string, string>> measurements;
 };
@@ -76,31 +103,59 @@ private:
 void Log(const std::string& str, log::Severity s = log::info);
 void DisableAllLogs(bool b);
 
+// Every formatting template checks the severity gate before touching
+// boost::format, so a suppressed-level call costs the check and
+// nothing else.
 template <typename P1>
 void Log(const std::string& fmt, const P1& p1, log::Severity s = log::info) {
+    if (!LogBase::Inst()->ShouldLog(s)) {
+        return;
+    }
     LogBase::Inst()->Log(log::Fmt(fmt) % p1, s);
 }
 
 template <typename P1, typename P2>
 void Log(const std::string& fmt, const P1& p1, const P2& p2, log::Severity s = log::info) {
+    if (!LogBase::Inst()->ShouldLog(s)) {
+        return;
+    }
     LogBase::Inst()->Log( log::Fmt(fmt) % p1 % p2, s ) ;
 }
 
 template <typename P1, typename P2, typename P3>
 void Log(const std::string& fmt, const P1& p1, const P2& p2, const P3& p3, log::Severity s = log::info) {
+    if (!LogBase::Inst()->ShouldLog(s)) {
+        return;
+    }
     LogBase::Inst()->Log(log::Fmt(fmt) % p1 % p2 % p3, s);
 }
 
 template <typename P1, typename P2, typename P3, typename P4>
 void Log(const std::string& fmt, const P1& p1, const P2& p2, const P3& p3, const P4& p4, log::Severity s = log::info) {
+    if (!LogBase::Inst()->ShouldLog(s)) {
+        return;
+    }
     LogBase::Inst()->Log(log::Fmt(fmt) % p1 % p2 % p3 % p4, s);
 }
 
 template <typename P1, typename P2, typename P3, typename P4, typename P5>
 void Log(const std::string& fmt, const P1& p1, const P2& p2, const P3& p3, const P4& p4, const P5& p5, log::Severity s = log::info) {
+    if (!LogBase::Inst()->ShouldLog(s)) {
+        return;
+    }
     LogBase::Inst()->Log(log::Fmt(fmt) % p1 % p2 % p3 % p4 % p5, s);
 }
 
+// Fully lazy call site: arguments are not even evaluated when the
+// severity is suppressed. Use where an argument is itself expensive
+// (hex dumps, remote_endpoint lookups).
+#define LOG_LAZY(s, ...)                                \
+    do {                                                \
+        if (util::LogBase::Inst()->ShouldLog(s)) {      \
+            util::Log(__VA_ARGS__, s);                  \
+        }                                               \
+    } while (0)
+
 }
 
 #endif
@@ -16,6 +16,7 @@
 // under the License..
 
 #include "WebService.h"
+#include "JsonScanner.h"
 #include "../GeneralSettings.h"
 
 WebService* WebService::instance = NULL;
@@ -23,8 +24,8 @@ WebService* WebService::instance = NULL;
 WebService::WebService() {}
 
 WebService::~WebService() {
-    if (curl)
-        curl_easy_cleanup(curl);
+    for (auto handle : handle_pool)
+        curl_easy_cleanup(handle);
 }
 
 
@@ -40,42 +41,74 @@ WebService* WebService::getInstance() {
 void WebService::init() {
     curl_global_init(CURL_GLOBAL_DEFAULT);
 
-    curl = curl_easy_init();
+    for (int i = 0; i < IAS_CONNECTION_POOL_SIZE; i++) {
+        CURL *handle = createHandle();
+        if (handle == NULL) {
+            Log("Curl init error", log::error);
+            break;
+        }
+        handle_pool.push_back(handle);
+    }
 
-    if (curl) {
-        Log("Curl initialized successfully");
-//		curl_easy_setopt( curl, CURLOPT_VERBOSE, 1L );
-        curl_easy_setopt( curl, CURLOPT_SSLCERTTYPE, "PEM");
-        curl_easy_setopt( curl, CURLOPT_SSLCERT, Settings::ias_crt);
-        curl_easy_setopt( curl, CURLOPT_USE_SSL, CURLUSESSL_ALL);
-        curl_easy_setopt( curl, CURLOPT_SSLVERSION, CURL_SSLVERSION_TLSv1_2);
-        curl_easy_setopt( curl, CURLOPT_NOPROGRESS, 1L);
-    } else
-        Log("Curl init error", log::error);
+    if (!handle_pool.empty())
+        Log("Curl initialized successfully, %d pooled IAS connections", (int)handle_pool.size());
+}
+
+
+CURL* WebService::createHandle() {
+    CURL *handle = curl_easy_init();
+
+    if (handle) {
+//		curl_easy_setopt( handle, CURLOPT_VERBOSE, 1L );
+        curl_easy_setopt( handle, CURLOPT_SSLCERTTYPE, "PEM");
+        curl_easy_setopt( handle, CURLOPT_SSLCERT, Settings::ias_crt);
+        curl_easy_setopt( handle, CURLOPT_USE_SSL, CURLUSESSL_ALL);
+        curl_easy_setopt( handle, CURLOPT_SSLVERSION, CURL_SSLVERSION_TLSv1_2);
+        curl_easy_setopt( handle, CURLOPT_NOPROGRESS, 1L);
+        curl_easy_setopt( handle, CURLOPT_TCP_KEEPALIVE, 1L);
+    }
+
+    return handle;
+}
+
+
+CURL* WebService::acquireHandle() {
+    unique_lock<mutex> lock(pool_mutex);
+    pool_cv.wait(lock, [this] { return !handle_pool.empty(); });
+
+    CURL *handle = handle_pool.back();
+    handle_pool.pop_back();
+    return handle;
+}
+
+
+void WebService::releaseHandle(CURL *handle) {
+    {
+        lock_guard<mutex> lock(pool_mutex);
+        handle_pool.push_back(handle);
+    }
+    pool_cv.notify_one();
 }
 
 
 vector<pair<string, string>> WebService::parseJSONfromIAS(string json) {
-    Json::Value root;
-    Json::Reader reader;
-    bool parsingSuccessful = reader.parse(json.c_str(), root);
+    // The report body is mostly one large base64 quote; the structural
+    // scanner indexes it in one SIMD pass and pulls the four verdict
+    // fields from the index instead of building a DOM around 100KB of
+    // payload.
+    JsonScanner scanner(json);
 
-    if (!parsingSuccessful) {
+    if (!scanner.ok()) {
         Log("Failed to parse JSON string from IAS", log::error);
         return vector<pair<string, string>>();
     }
 
     vector<pair<string,string>> values;
 
-    string id = root.get("id", "UTF-8" ).asString();
-    string timestamp = root.get("timestamp", "UTF-8" ).asString();
-    string epidPseudonym = root.get("epidPseudonym", "UTF-8" ).asString();
-    string isvEnclaveQuoteStatus = root.get("isvEnclaveQuoteStatus", "UTF-8" ).asString();
-
-    values.push_back({"id", id});
-    values.push_back({"timestamp", timestamp});
-    values.push_back({"epidPseudonym", epidPseudonym});
-    values.push_back({"isvEnclaveQuoteStatus", isvEnclaveQuoteStatus});
+    values.push_back({"id", scanner.get("id", "UTF-8")});
+    values.push_back({"timestamp", scanner.get("timestamp", "UTF-8")});
+    values.push_back({"epidPseudonym", scanner.get("epidPseudonym", "UTF-8")});
+    values.push_back({"isvEnclaveQuoteStatus", scanner.get("isvEnclaveQuoteStatus", "UTF-8")});
 
     return values;
 }
@@ -158,24 +191,34 @@ bool WebService::sendToIAS(string url,
                            ias_response_header_t *response_header) {
 
     CURLcode res = CURLE_OK;
+    CURL *handle = acquireHandle();
 
-    curl_easy_setopt( curl, CURLOPT_URL, url.c_str());
+    curl_easy_setopt( handle, CURLOPT_URL, url.c_str());
     Log("sending url: %s", url.c_str());
 
     if (headers) {
-        curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
-        curl_easy_setopt(curl, CURLOPT_POSTFIELDS, payload.c_str());
+        curl_easy_setopt(handle, CURLOPT_HTTPHEADER, headers);
+        curl_easy_setopt(handle, CURLOPT_POSTFIELDS, payload.c_str());
+    } else {
+        curl_easy_setopt(handle, CURLOPT_HTTPGET, 1L);
     }
 
     ias_response_container->p_response = (char*) malloc(1);
     ias_response_container->size = 0;
 
-    curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, ias_response_header_parser);
-    curl_easy_setopt(curl, CURLOPT_HEADERDATA, response_header);
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, ias_reponse_body_handler);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, ias_response_container);
+    curl_easy_setopt(handle, CURLOPT_HEADERFUNCTION, ias_response_header_parser);
+    curl_easy_setopt(handle, CURLOPT_HEADERDATA, response_header);
+    curl_easy_setopt(handle, CURLOPT_WRITEFUNCTION, ias_reponse_body_handler);
+    curl_easy_setopt(handle, CURLOPT_WRITEDATA, ias_response_container);
+
+    res = curl_easy_perform(handle);
+
+    // Clear per-request state before the handle goes back to the pool; the
+    // connection itself stays open for the next verification.
+    curl_easy_setopt(handle, CURLOPT_HTTPHEADER, NULL);
+    curl_easy_setopt(handle, CURLOPT_POSTFIELDS, NULL);
+    releaseHandle(handle);
 
-    res = curl_easy_perform(curl);
     if (res != CURLE_OK) {
         Log("Curl cert file: %s", Settings::ias_crt);
         Log("curl_easy_perform() failed: %s", curl_easy_strerror(res));
@@ -26,6 +26,9 @@
 #include <curl/curl.h>
 #include <jsoncpp/json/json.h>
 #include <iostream>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
 
 #include "LogBase.h"
 #include "UtilityFunctions.h"
@@ -81,9 +84,22 @@ private:
     string createJSONforIAS(uint8_t *quote, uint8_t *pseManifest, uint8_t *nonce);
     vector<pair<string, string>> parseJSONfromIAS(string json);
 
+    CURL* createHandle();
+    CURL* acquireHandle();
+    void releaseHandle(CURL *handle);
+
 private:
     static WebService* instance;
-    CURL *curl;
+
+    // Pool of configured easy handles. Reusing a handle lets libcurl keep
+    // its TLS connection to IAS warm, so concurrent attestations pay the
+    // handshake once per pooled connection instead of once per request.
+    vector<CURL*> handle_pool;
+    mutex pool_mutex;
+    condition_variable pool_cv;
 };
 
+// Warm IAS connections held open; bounds concurrent verifications in flight.
+#define IAS_CONNECTION_POOL_SIZE 4
+
 #endif
@@ -16,6 +16,7 @@
 // under the License..
 
 #include "AbstractNetworkOps.h"
+#include "WorkerPool.h"
 #include <boost/lexical_cast.hpp>
 #include <boost/algorithm/string.hpp>
 
@@ -117,13 +118,19 @@ void AbstractNetworkOps::process_read(char* buffer, int msg_size, int type) {
 
     free(buffer);
 
-    auto msg = this->callback_handler(str, type);
+    // Hand the message to a worker thread; quote verification can spend
+    // hundreds of milliseconds in IAS round trips and must not stall the
+    // io_service thread. Each session has at most one message in flight,
+    // so per-session ordering is unaffected.
+    WorkerPool::getInstance()->submit([this, str, type] {
+        auto msg = this->callback_handler(str, type);
 
-    if (msg.size() > 0 && msg[0].size() > 0) {
-        Log("Send to client");
-        send(msg);
-    } else {
-        Log("Close connection");
-        this->saveCloseSocket();
-    }
+        if (msg.size() > 0 && msg[0].size() > 0) {
+            Log("Send to client");
+            send(msg);
+        } else {
+            Log("Close connection");
+            this->saveCloseSocket();
+        }
+    });
 }
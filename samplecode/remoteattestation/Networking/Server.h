@@ -23,6 +23,8 @@
 
 #include <cstdlib>
 #include <iostream>
+#include <memory>
+#include <vector>
 #include <boost/bind.hpp>
 #include <boost/asio.hpp>
 #include <boost/asio/ssl.hpp>
@@ -33,16 +35,24 @@ class Server {
     typedef boost::asio::ssl::stream<boost::asio::ip::tcp::socket> ssl_socket;
 
 public:
-    Server(boost::asio::io_service& io_service, int port);
+    // num_acceptors > 1 binds that many listening sockets to the same
+    // port with SO_REUSEPORT, so the kernel spreads incoming
+    // connections across independent accept chains instead of queueing
+    // a reconnect spike behind one acceptor. Needs a multi-threaded
+    // io_service run to pay off.
+    Server(boost::asio::io_service& io_service, int port, int num_acceptors = 1);
     virtual ~Server();
     std::string get_password() const;
-    void handle_accept(Session* new_session, const boost::system::error_code& error);
+    void handle_accept(Session* new_session, size_t acceptor_index, const boost::system::error_code& error);
     void start_accept();
     void connectCallbackHandler(CallbackHandler cb);
 
+private:
+    void start_accept_on(size_t acceptor_index);
+
 private:
     boost::asio::io_service& io_service_;
-    boost::asio::ip::tcp::acceptor acceptor_;
+    std::vector<std::unique_ptr<boost::asio::ip::tcp::acceptor>> acceptors_;
     boost::asio::ssl::context context_;
     CallbackHandler callback_handler;
 };
@@ -0,0 +1,74 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License..
+
+#include "WorkerPool.h"
+
+WorkerPool* WorkerPool::instance = NULL;
+
+WorkerPool* WorkerPool::getInstance() {
+    if (instance == NULL) {
+        instance = new WorkerPool(WORKER_POOL_SIZE);
+    }
+
+    return instance;
+}
+
+WorkerPool::WorkerPool(int thread_count) {
+    for (int i = 0; i < thread_count; i++) {
+        workers.emplace_back(&WorkerPool::workerLoop, this);
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        lock_guard<mutex> lock(queue_mutex);
+        stopping = true;
+    }
+    queue_cv.notify_all();
+
+    for (auto &worker : workers) {
+        worker.join();
+    }
+}
+
+void WorkerPool::submit(function<void()> task) {
+    {
+        lock_guard<mutex> lock(queue_mutex);
+        tasks.push(move(task));
+    }
+    queue_cv.notify_one();
+}
+
+void WorkerPool::workerLoop() {
+    while (true) {
+        function<void()> task;
+
+        {
+            unique_lock<mutex> lock(queue_mutex);
+            queue_cv.wait(lock, [this] { return stopping || !tasks.empty(); });
+
+            if (stopping && tasks.empty()) {
+                return;
+            }
+
+            task = move(tasks.front());
+            tasks.pop();
+        }
+
+        task();
+    }
+}
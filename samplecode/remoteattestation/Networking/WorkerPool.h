@@ -0,0 +1,61 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License..
+
+#ifndef WORKERPOOL_H
+#define WORKERPOOL_H
+
+#include <functional>
+#include <queue>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+using namespace std;
+
+// Fixed pool of worker threads fed from a multi-producer queue. Message
+// processing - in particular quote verification with its IAS round trips -
+// runs here instead of on the io_service thread, so the acceptor keeps
+// servicing new connections while verifications for other clients are in
+// flight.
+class WorkerPool {
+
+public:
+    static WorkerPool* getInstance();
+    ~WorkerPool();
+
+    void submit(function<void()> task);
+
+private:
+    WorkerPool(int thread_count);
+    void workerLoop();
+
+private:
+    static WorkerPool* instance;
+
+    vector<thread> workers;
+    queue<function<void()>> tasks;
+    mutex queue_mutex;
+    condition_variable queue_cv;
+    bool stopping = false;
+};
+
+// Enough to keep ~50 verifications/sec in flight when each one spends most
+// of its time waiting on IAS.
+#define WORKER_POOL_SIZE 8
+
+#endif
@@ -19,6 +19,8 @@
 #include "sample_libcrypto.h"
 #include "../GeneralSettings.h"
 
+#include <future>
+
 // This is the private EC key of SP, the corresponding public EC key is
 // hard coded in isv_enclave. It is based on NIST P-256 curve.
 static const sample_ec256_private_t g_sp_priv_key = {
@@ -30,6 +32,8 @@ static const sample_ec256_private_t g_sp_priv_key = {
     }
 };
 
+map<string, ias_report_cache_entry_t> ServiceProvider::attestation_cache;
+
 ServiceProvider::ServiceProvider(WebService *ws) : ws(ws) {}
 
 ServiceProvider::~ServiceProvider() {}
@@ -350,7 +354,40 @@ int ServiceProvider::sp_ra_proc_msg3_req(Messages::MessageMSG3 msg, Messages::At
         return -1;
     }
 
+    ias_att_report_t attestation_report = {0};
+    bool ias_cached = false;
+    std::future<int> ias_result;
+    string platform_key;
+
     do {
+        p_quote = (sgx_quote_t *) p_msg3->quote;
+
+        // Kick off the IAS round trip (or serve the verdict from cache)
+        // before the local checks run: the HTTP request to the
+        // attestation server dominates msg3 latency, so it overlaps
+        // with the CMAC and report_data verification instead of
+        // following them. The verdict is only consumed after those
+        // checks pass; if one fails, the future's destructor waits out
+        // the in-flight request on the error path.
+        platform_key = ByteArrayToString((uint8_t*)&p_quote->epid_group_id, sizeof(p_quote->epid_group_id))
+                     + ByteArrayToString(p_quote->basename.name, sizeof(p_quote->basename.name))
+                     + ByteArrayToString(p_quote->report_body.mr_enclave.m, SGX_HASH_SIZE)
+                     + ByteArrayToString(p_quote->report_body.mr_signer.m, SGX_HASH_SIZE)
+                     + to_string(p_quote->report_body.isv_prod_id)
+                     + to_string(p_quote->report_body.isv_svn);
+
+        auto cached = attestation_cache.find(platform_key);
+        if (cached != attestation_cache.end() &&
+                time(NULL) - cached->second.verified_at < ATTESTATION_CACHE_TTL_SECONDS) {
+            attestation_report = cached->second.report;
+            ias_cached = true;
+            Log("IAS verdict for this platform served from cache");
+        } else {
+            ias_result = std::async(std::launch::async, [this, p_msg3, &attestation_report]() {
+                return ias_verify_attestation_evidence(p_msg3->quote, p_msg3->ps_sec_prop.sgx_ps_sec_prop_desc, &attestation_report, ws);
+            });
+        }
+
         // Compare g_a in message 3 with local g_a.
         if (memcmp(&g_sp_db.g_a, &p_msg3->g_a, sizeof(sgx_ec256_public_t))) {
             Log("Error, g_a is not same", log::error);
@@ -385,9 +422,6 @@ int ServiceProvider::sp_ra_proc_msg3_req(Messages::MessageMSG3 msg, Messages::At
             break;
         }
 
-        p_quote = (sgx_quote_t *) p_msg3->quote;
-
-
         // Verify the report_data in the Quote matches the expected value.
         // The first 32 bytes of report_data are SHA256 HASH of {ga|gb|vk}.
         // The second 32 bytes of report_data are set to zero.
@@ -432,13 +466,21 @@ int ServiceProvider::sp_ra_proc_msg3_req(Messages::MessageMSG3 msg, Messages::At
             break;
         }
 
-        // Verify quote with attestation server.
-        ias_att_report_t attestation_report = {0};
-        ret = ias_verify_attestation_evidence(p_msg3->quote, p_msg3->ps_sec_prop.sgx_ps_sec_prop_desc, &attestation_report, ws);
+        // Local checks passed; join the IAS round trip started above
+        // and adopt its verdict. Only a freshly fetched verdict enters
+        // the cache.
+        if (!ias_cached) {
+            ret = ias_result.get();
 
-        if (0 != ret) {
-            ret = SP_IAS_FAILED;
-            break;
+            if (0 != ret) {
+                ret = SP_IAS_FAILED;
+                break;
+            }
+
+            ias_report_cache_entry_t entry;
+            entry.report = attestation_report;
+            entry.verified_at = time(NULL);
+            attestation_cache[platform_key] = entry;
         }
 
         Log("Attestation Report:");
@@ -27,6 +27,7 @@
 #include <time.h>
 #include <string.h>
 #include <iostream>
+#include <map>
 
 #include "Messages.pb.h"
 #include "UtilityFunctions.h"
@@ -44,6 +45,11 @@ using namespace std;
 #define DH_SHARED_KEY_LEN 32
 #define SAMPLE_SP_IV_SIZE 12
 
+// How long a verified IAS verdict for a platform stays valid. Clients
+// reconnect on every deploy; within this window a platform attested
+// moments ago skips the IAS round trip and goes straight to key exchange.
+#define ATTESTATION_CACHE_TTL_SECONDS 300
+
 
 enum sp_ra_msg_status_t {
     SP_OK,
@@ -57,6 +63,11 @@ enum sp_ra_msg_status_t {
     SP_RETRIEVE_SIGRL_ERROR
 };
 
+typedef struct _ias_report_cache_entry_t {
+    ias_att_report_t report;
+    time_t verified_at;
+} ias_report_cache_entry_t;
+
 typedef struct _sp_db_item_t {
     sgx_ec256_public_t       	g_a;
     sgx_ec256_public_t       	g_b;
@@ -87,6 +98,10 @@ private:
     sp_db_item_t g_sp_db;
     const uint16_t AES_CMAC_KDF_ID = 0x0001;
     uint8_t validation_result[MAX_VERIFICATION_RESULT];
+
+    // Process-wide: a ServiceProvider is recreated per connection, but the
+    // IAS verdict belongs to the platform, not the session.
+    static map<string, ias_report_cache_entry_t> attestation_cache;
 };
 
 #endif
@@ -16,6 +16,7 @@
 // under the License..
 
 #include "WebService.h"
+#include "JsonScanner.h"
 #include "../GeneralSettings.h"
 
 WebService* WebService::instance = NULL;
@@ -56,26 +57,23 @@ void WebService::init() {
 
 
 vector<pair<string, string>> WebService::parseJSONfromIAS(string json) {
-    Json::Value root;
-    Json::Reader reader;
-    bool parsingSuccessful = reader.parse(json.c_str(), root);
+    // The report body is mostly one large base64 quote; the structural
+    // scanner indexes it in one SIMD pass and pulls the four verdict
+    // fields from the index instead of building a DOM around 100KB of
+    // payload.
+    JsonScanner scanner(json);
 
-    if (!parsingSuccessful) {
+    if (!scanner.ok()) {
         Log("Failed to parse JSON string from IAS", log::error);
         return vector<pair<string, string>>();
     }
 
     vector<pair<string,string>> values;
 
-    string id = root.get("id", "UTF-8" ).asString();
-    string timestamp = root.get("timestamp", "UTF-8" ).asString();
-    string epidPseudonym = root.get("epidPseudonym", "UTF-8" ).asString();
-    string isvEnclaveQuoteStatus = root.get("isvEnclaveQuoteStatus", "UTF-8" ).asString();
-
-    values.push_back({"id", id});
-    values.push_back({"timestamp", timestamp});
-    values.push_back({"epidPseudonym", epidPseudonym});
-    values.push_back({"isvEnclaveQuoteStatus", isvEnclaveQuoteStatus});
+    values.push_back({"id", scanner.get("id", "UTF-8")});
+    values.push_back({"timestamp", scanner.get("timestamp", "UTF-8")});
+    values.push_back({"epidPseudonym", scanner.get("epidPseudonym", "UTF-8")});
+    values.push_back({"isvEnclaveQuoteStatus", scanner.get("isvEnclaveQuoteStatus", "UTF-8")});
 
     return values;
 }
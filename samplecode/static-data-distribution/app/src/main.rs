@@ -41,6 +41,94 @@ extern "C" {
         key_ptr: *const u8,
         len: usize,
     ) -> sgx_status_t;
+    fn put_chunk(
+        eid: sgx_enclave_id_t,
+        retval: *mut sgx_status_t,
+        data: *const u8,
+        len: usize,
+        hash: *mut u8,
+    ) -> sgx_status_t;
+    fn have_chunk(
+        eid: sgx_enclave_id_t,
+        retval: *mut i32,
+        hash: *const u8,
+    ) -> sgx_status_t;
+    fn install_from_manifest(
+        eid: sgx_enclave_id_t,
+        retval: *mut sgx_status_t,
+        manifest: *const u8,
+        len: usize,
+    ) -> sgx_status_t;
+}
+
+const CHUNK_SIZE: usize = 4096;
+
+fn hex_string(hash: &[u8; 32]) -> String {
+    hash.iter().map(|b| format!("{:02x}", b)).collect()
+}
+
+// Distribute one payload version: chunks the enclave already holds (by
+// hash) are skipped, new chunks are delivered and sealed, and the
+// enclave installs the result from the manifest alone. `known` maps
+// chunk bytes to the hash reported by the enclave on first delivery, so
+// a version bump only ships the chunks that actually changed.
+fn distribute(
+    enclave: &SgxEnclave,
+    payload: &[u8],
+    known: &mut std::collections::HashMap<Vec<u8>, [u8; 32]>,
+) {
+    let mut manifest: Vec<String> = Vec::new();
+    let mut sent = 0;
+    let mut total = 0;
+
+    for chunk in payload.chunks(CHUNK_SIZE) {
+        total += 1;
+
+        if let Some(hash) = known.get(chunk) {
+            let mut cached: i32 = 0;
+            let result = unsafe { have_chunk(enclave.geteid(), &mut cached, hash.as_ptr()) };
+            if result == sgx_status_t::SGX_SUCCESS && cached != 0 {
+                manifest.push(hex_string(hash));
+                continue;
+            }
+        }
+
+        let mut retval = sgx_status_t::SGX_SUCCESS;
+        let mut hash = [0_u8; 32];
+        let result = unsafe {
+            put_chunk(
+                enclave.geteid(),
+                &mut retval,
+                chunk.as_ptr(),
+                chunk.len(),
+                hash.as_mut_ptr(),
+            )
+        };
+        if result != sgx_status_t::SGX_SUCCESS || retval != sgx_status_t::SGX_SUCCESS {
+            println!("[-] put_chunk failed {} {}!", result.as_str(), retval.as_str());
+            return;
+        }
+        known.insert(chunk.to_vec(), hash);
+        manifest.push(hex_string(&hash));
+        sent += 1;
+    }
+
+    let manifest_json = serde_json::to_string(&manifest).unwrap();
+    let mut retval = sgx_status_t::SGX_SUCCESS;
+    let result = unsafe {
+        install_from_manifest(
+            enclave.geteid(),
+            &mut retval,
+            manifest_json.as_ptr(),
+            manifest_json.len(),
+        )
+    };
+    if result != sgx_status_t::SGX_SUCCESS || retval != sgx_status_t::SGX_SUCCESS {
+        println!("[-] install_from_manifest failed {} {}!", result.as_str(), retval.as_str());
+        return;
+    }
+
+    println!("[+] distributed {} of {} chunks ({} skipped as cached)", sent, total, total - sent);
 }
 
 fn init_enclave() -> SgxResult<SgxEnclave> {
@@ -148,5 +236,21 @@ fn main() {
 
     println!("[+] say_something success...");
 
+    // Step 4: Distribute a payload through the content-addressable
+    // chunk cache, then bump its version. Only the chunks touched by
+    // the edit travel again; the rest are referenced by hash in the
+    // manifest and served from the enclave's sealed cache.
+    let mut known = std::collections::HashMap::new();
+
+    let v1 = "static data v1 ".repeat(4000).into_bytes();
+    println!("[+] distributing payload v1 ({} bytes)", v1.len());
+    distribute(&enclave, &v1, &mut known);
+
+    let mut v2 = v1.clone();
+    let last = v2.len() - 1;
+    v2[last] ^= 0xff;
+    println!("[+] distributing payload v2 (1 byte changed)");
+    distribute(&enclave, &v2, &mut known);
+
     enclave.destroy();
 }
@@ -24,6 +24,7 @@ extern crate sgx_types;
 #[cfg(not(target_env = "sgx"))]
 #[macro_use]
 extern crate sgx_tstd as std;
+extern crate sgx_tcrypto;
 extern crate serde_json;
 extern crate sgx_crypto_helper;
 
@@ -39,6 +40,22 @@ use std::vec::Vec;
 
 use sgx_crypto_helper::RsaKeyPair;
 use sgx_crypto_helper::rsa3072::Rsa3072KeyPair;
+use sgx_tcrypto::rsgx_sha256_slice;
+
+/// Chunks of the distributed payload live in the protected filesystem,
+/// one file per chunk, named by the SHA-256 of the chunk's content.
+/// SgxFile seals them with a machine-bound key, so the cache survives
+/// enclave restarts but never leaves this platform in the clear.
+const CHUNK_FILE_PREFIX: &'static str = "chunk_";
+
+fn chunk_file_name(hash: &sgx_sha256_hash_t) -> String {
+    let mut name = String::from(CHUNK_FILE_PREFIX);
+    for b in hash.iter() {
+        name.push_str(&format!("{:02x}", b));
+    }
+    name.push_str(".bin");
+    name
+}
 
 #[no_mangle]
 pub extern "C" fn say_something(some_string: *const u8, some_len: usize) -> sgx_status_t {
@@ -112,6 +129,111 @@ pub extern "C" fn say_something(some_string: *const u8, some_len: usize) -> sgx_
     sgx_status_t::SGX_SUCCESS
 }
 
+/// Ingest one chunk into the content-addressable cache. The enclave
+/// hashes the bytes itself, seals them under that hash and reports the
+/// hash back, so the distributor can reference the chunk in later
+/// manifests without ever re-sending it. Re-delivering a chunk that is
+/// already cached is a no-op.
+#[no_mangle]
+pub extern "C" fn put_chunk(data: *const u8, len: usize, hash_out: *mut u8) -> sgx_status_t {
+    let chunk = unsafe { slice::from_raw_parts(data, len) };
+
+    let hash = match rsgx_sha256_slice(chunk) {
+        Ok(h) => h,
+        Err(x) => return x,
+    };
+
+    let name = chunk_file_name(&hash);
+    if SgxFile::open(&name).is_err() {
+        match SgxFile::create(&name) {
+            Ok(mut f) => {
+                if let Err(x) = f.write_all(chunk) {
+                    println!("SgxFile write chunk failed! {}", x);
+                    return sgx_status_t::SGX_ERROR_UNEXPECTED;
+                }
+            }
+            Err(x) => {
+                println!("SgxFile create chunk file {} error {}", name, x);
+                return sgx_status_t::SGX_ERROR_UNEXPECTED;
+            }
+        }
+    }
+
+    unsafe { std::ptr::copy_nonoverlapping(hash.as_ptr(), hash_out, hash.len()) };
+    sgx_status_t::SGX_SUCCESS
+}
+
+/// Answer whether a chunk with this hash is already in the sealed
+/// cache, so the distributor can skip the transfer entirely.
+#[no_mangle]
+pub extern "C" fn have_chunk(hash: *const u8) -> i32 {
+    let mut h: sgx_sha256_hash_t = [0; SGX_SHA256_HASH_SIZE];
+    unsafe { std::ptr::copy_nonoverlapping(hash, h.as_mut_ptr(), h.len()) };
+
+    SgxFile::open(&chunk_file_name(&h)).is_ok() as i32
+}
+
+/// Install a payload described by a manifest of chunk hashes. Every
+/// chunk is loaded from the sealed cache and re-hashed before use, so a
+/// manifest can only ever assemble bytes the enclave has verified --
+/// the distribution step shrinks to the manifest plus whatever chunks
+/// were genuinely new.
+#[no_mangle]
+pub extern "C" fn install_from_manifest(manifest_ptr: *const u8, manifest_len: usize) -> sgx_status_t {
+    let manifest_slice = unsafe { slice::from_raw_parts(manifest_ptr, manifest_len) };
+    let manifest_str = match std::str::from_utf8(manifest_slice) {
+        Ok(s) => s,
+        Err(_) => return sgx_status_t::SGX_ERROR_INVALID_PARAMETER,
+    };
+    let hashes: Vec<String> = match serde_json::from_str(manifest_str) {
+        Ok(v) => v,
+        Err(x) => {
+            println!("Manifest parse failed {}", x);
+            return sgx_status_t::SGX_ERROR_INVALID_PARAMETER;
+        }
+    };
+
+    let mut payload: Vec<u8> = Vec::new();
+    for hex in &hashes {
+        let mut expected: sgx_sha256_hash_t = [0; SGX_SHA256_HASH_SIZE];
+        if hex.len() != 2 * SGX_SHA256_HASH_SIZE {
+            return sgx_status_t::SGX_ERROR_INVALID_PARAMETER;
+        }
+        for (i, byte) in expected.iter_mut().enumerate() {
+            *byte = match u8::from_str_radix(&hex[2 * i..2 * i + 2], 16) {
+                Ok(b) => b,
+                Err(_) => return sgx_status_t::SGX_ERROR_INVALID_PARAMETER,
+            };
+        }
+
+        let mut chunk: Vec<u8> = Vec::new();
+        match SgxFile::open(&chunk_file_name(&expected)) {
+            Ok(mut f) => {
+                if let Err(x) = f.read_to_end(&mut chunk) {
+                    println!("Read chunk {} failed {}", hex, x);
+                    return sgx_status_t::SGX_ERROR_UNEXPECTED;
+                }
+            }
+            Err(_) => {
+                println!("Manifest references missing chunk {}", hex);
+                return sgx_status_t::SGX_ERROR_INVALID_PARAMETER;
+            }
+        }
+
+        match rsgx_sha256_slice(&chunk) {
+            Ok(actual) if actual == expected => payload.extend_from_slice(&chunk),
+            Ok(_) => {
+                println!("Chunk {} failed verification", hex);
+                return sgx_status_t::SGX_ERROR_MAC_MISMATCH;
+            }
+            Err(x) => return x,
+        }
+    }
+
+    println!("Installed payload: {} chunks, {} bytes", hashes.len(), payload.len());
+    sgx_status_t::SGX_SUCCESS
+}
+
 #[no_mangle]
 pub extern "C" fn fake_provisioning(key_ptr: *const u8, some_len: usize) -> sgx_status_t {
     let key_slice = unsafe { slice::from_raw_parts(key_ptr, some_len) };
@@ -23,6 +23,7 @@
 
 extern crate sgx_types;
 #[cfg(not(target_env = "sgx"))]
+#[macro_use]
 extern crate sgx_tstd as std;
 
 use sgx_types::*;
@@ -31,6 +32,8 @@ extern "C"{
     // OCALLS
     pub fn ocall_empty () -> sgx_status_t;
     pub fn ocall_empty_switchless () -> sgx_status_t;
+    pub fn ocall_arg (buf: * const u8, len: usize) -> sgx_status_t;
+    pub fn ocall_arg_switchless (buf: * const u8, len: usize) -> sgx_status_t;
 }
 
 #[no_mangle]
@@ -56,3 +59,38 @@ fn ecall_empty(){
 pub extern "C"
 fn ecall_empty_switchless() {
 }
+
+#[no_mangle]
+pub extern "C"
+fn ecall_arg(buf : * const u8, len : usize) {
+    // Touch the marshalled copy so the bridge cannot elide it.
+    if !buf.is_null() && len > 0 {
+        let _ = unsafe { core::ptr::read_volatile(buf) };
+    }
+}
+
+#[no_mangle]
+pub extern "C"
+fn ecall_arg_switchless(buf : * const u8, len : usize) {
+    if !buf.is_null() && len > 0 {
+        let _ = unsafe { core::ptr::read_volatile(buf) };
+    }
+}
+
+#[no_mangle]
+pub extern "C"
+fn ecall_repeat_ocalls_arg(nrepeats : u64, use_switchless : i32, len : usize) {
+
+    let buf = vec![0_u8; len];
+
+    if use_switchless == 0 {
+        for _ in 0..nrepeats {
+            unsafe {ocall_arg(buf.as_ptr(), buf.len());}
+        }
+    }
+    else {
+        for _ in 0..nrepeats {
+            unsafe {ocall_arg_switchless(buf.as_ptr(), buf.len());}
+        }
+    }
+}
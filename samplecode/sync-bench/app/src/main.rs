@@ -0,0 +1,166 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License..
+
+extern crate sgx_types;
+extern crate sgx_urts;
+use sgx_types::*;
+use sgx_urts::SgxEnclave;
+
+static ENCLAVE_FILE: &'static str = "enclave.signed.so";
+
+extern {
+    fn sb_setup(eid: sgx_enclave_id_t, retval: *mut sgx_status_t,
+                mode: u64, participants: u64, rounds: u64) -> sgx_status_t;
+    fn sb_worker(eid: sgx_enclave_id_t, retval: *mut sgx_status_t,
+                 role: u64, id: u64) -> sgx_status_t;
+    fn sb_report(eid: sgx_enclave_id_t, retval: *mut sgx_status_t) -> sgx_status_t;
+}
+
+const MODE_QUEUE: u64 = 1;
+const MODE_BROADCAST: u64 = 2;
+const MODE_HANDOFF: u64 = 3;
+const MODE_DOORBELL: u64 = 4;
+
+const ROUNDS: u64 = 100_000;
+
+fn ecall_setup(eid: sgx_enclave_id_t, mode: u64, participants: u64, rounds: u64) -> bool {
+    let mut retval = sgx_status_t::SGX_SUCCESS;
+    let result = unsafe { sb_setup(eid, &mut retval, mode, participants, rounds) };
+    if result != sgx_status_t::SGX_SUCCESS || retval != sgx_status_t::SGX_SUCCESS {
+        println!("[-] sb_setup failed: {} / {}", result.as_str(), retval.as_str());
+        return false;
+    }
+    true
+}
+
+// Enters one TCS per (role, id) pair and joins them all; returns the
+// wall-clock seconds the whole cohort took.
+fn run_workers(eid: sgx_enclave_id_t, roles: Vec<(u64, u64)>) -> f64 {
+    let start = std::time::Instant::now();
+    let handles: Vec<std::thread::JoinHandle<()>> = roles
+        .into_iter()
+        .map(|(role, id)| {
+            std::thread::spawn(move || {
+                let mut retval = sgx_status_t::SGX_SUCCESS;
+                let result = unsafe { sb_worker(eid, &mut retval, role, id) };
+                assert_eq!(result, sgx_status_t::SGX_SUCCESS);
+                assert_eq!(retval, sgx_status_t::SGX_SUCCESS);
+            })
+        })
+        .collect();
+    for handle in handles {
+        handle.join().unwrap();
+    }
+    let elapsed = start.elapsed();
+    elapsed.as_secs() as f64 + f64::from(elapsed.subsec_nanos()) * 1e-9
+}
+
+fn report(eid: sgx_enclave_id_t) {
+    let mut retval = sgx_status_t::SGX_SUCCESS;
+    let result = unsafe { sb_report(eid, &mut retval) };
+    assert_eq!(result, sgx_status_t::SGX_SUCCESS);
+}
+
+fn bench_queue(eid: sgx_enclave_id_t) {
+    println!("[+] producer/consumer, {} rounds per producer", ROUNDS);
+    // the enclave has 16 TCSs; pairs beyond 4 would just queue on entry
+    for &pairs in [1_u64, 2, 4].iter() {
+        if !ecall_setup(eid, MODE_QUEUE, pairs, ROUNDS) {
+            return;
+        }
+        let mut roles = Vec::new();
+        for id in 0..pairs {
+            roles.push((0, id));
+            roles.push((1, id));
+        }
+        let secs = run_workers(eid, roles);
+        println!("  {}p/{}c: {:.0} items/s", pairs, pairs, (pairs * ROUNDS) as f64 / secs);
+        report(eid);
+    }
+}
+
+fn bench_broadcast(eid: sgx_enclave_id_t) {
+    let rounds = ROUNDS / 10;
+    println!("[+] condvar broadcast, {} rounds", rounds);
+    for &waiters in [2_u64, 4, 8].iter() {
+        if !ecall_setup(eid, MODE_BROADCAST, waiters, rounds) {
+            return;
+        }
+        let mut roles = vec![(0, 0)];
+        for id in 0..waiters {
+            roles.push((1, id));
+        }
+        let secs = run_workers(eid, roles);
+        println!("  {} waiters: {:.0} broadcasts/s", waiters, rounds as f64 / secs);
+        report(eid);
+    }
+}
+
+fn bench_handoff(eid: sgx_enclave_id_t) {
+    println!("[+] lock handoff, {} rounds", ROUNDS);
+    if !ecall_setup(eid, MODE_HANDOFF, 2, ROUNDS) {
+        return;
+    }
+    let secs = run_workers(eid, vec![(0, 0), (0, 1)]);
+    println!("  pair: {:.0} handoffs/s", (2 * ROUNDS) as f64 / secs);
+    report(eid);
+}
+
+fn bench_doorbell(eid: sgx_enclave_id_t) {
+    println!("[+] doorbell channel, {} messages", ROUNDS);
+    if !ecall_setup(eid, MODE_DOORBELL, 2, ROUNDS) {
+        return;
+    }
+    let secs = run_workers(eid, vec![(0, 0), (1, 0)]);
+    println!("  1p/1c: {:.0} msgs/s", ROUNDS as f64 / secs);
+    report(eid);
+}
+
+fn init_enclave() -> SgxResult<SgxEnclave> {
+    let mut launch_token: sgx_launch_token_t = [0; 1024];
+    let mut launch_token_updated: i32 = 0;
+    // call sgx_create_enclave to initialize an enclave instance
+    // Debug Support: set 2nd parameter to 1
+    let debug = 1;
+    let mut misc_attr = sgx_misc_attribute_t {secs_attr: sgx_attributes_t { flags:0, xfrm:0}, misc_select:0};
+    SgxEnclave::create(ENCLAVE_FILE,
+                       debug,
+                       &mut launch_token,
+                       &mut launch_token_updated,
+                       &mut misc_attr)
+}
+
+fn main() {
+
+    let enclave = match init_enclave() {
+        Ok(r) => {
+            println!("[+] Init Enclave Successful {}!", r.geteid());
+            r
+        },
+        Err(x) => {
+            println!("[-] Init Enclave Failed {}!", x.as_str());
+            return;
+        },
+    };
+
+    bench_queue(enclave.geteid());
+    bench_broadcast(enclave.geteid());
+    bench_handoff(enclave.geteid());
+    bench_doorbell(enclave.geteid());
+
+    enclave.destroy();
+}
@@ -0,0 +1,332 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License..
+
+//! Benchmark enclave for the event/synchronization layer.
+//!
+//! Every wait and wake in sgx_tstd's sync primitives bottoms out in the
+//! per-TCS event ocalls of sgx_ustdc/event.c, so changes to that layer
+//! move every mutex, condvar and channel in the tree. This enclave
+//! gives those paths numbers: the app enters one TCS per participant
+//! (`sb_worker`), the participants run one of four contention shapes,
+//! and `sb_report` prints latency percentiles from wait-free histograms
+//! so measuring does not perturb what is measured.
+//!
+//! Modes: 1 bounded-queue producer/consumer (enqueue-to-dequeue
+//! latency), 2 condvar broadcast to N waiters (per-waiter wake latency
+//! and full-quorum latency), 3 mutex+condvar handoff between two
+//! threads (one-way handoff latency), 4 untrusted-channel doorbell
+//! (send-to-recv latency through the parked-consumer wake path).
+//!
+//! Timestamps come from the ocall clock, which itself costs an enclave
+//! transition (~1us); the measured latencies carry that overhead
+//! uniformly, which is fine for comparing before/after a change to the
+//! event layer.
+
+#![crate_name = "syncbenchenclave"]
+#![crate_type = "staticlib"]
+
+#![cfg_attr(not(target_env = "sgx"), no_std)]
+#![cfg_attr(target_env = "sgx", feature(rustc_private))]
+
+extern crate sgx_types;
+#[cfg(not(target_env = "sgx"))]
+#[macro_use]
+extern crate sgx_tstd as std;
+
+use sgx_types::*;
+use std::collections::VecDeque;
+use std::metrics::Histogram;
+use std::sync::atomic::{AtomicU64, Ordering};
+use std::sync::{untrusted_channel, SgxCondvar, SgxMutex, UntrustedReceiver, UntrustedSender};
+use std::time::Instant;
+use std::untrusted::time::InstantEx;
+
+const MODE_QUEUE: u64 = 1;
+const MODE_BROADCAST: u64 = 2;
+const MODE_HANDOFF: u64 = 3;
+const MODE_DOORBELL: u64 = 4;
+
+const QUEUE_CAPACITY: usize = 256;
+const DOORBELL_SLOTS: usize = 1024;
+const DOORBELL_SLOT_SIZE: usize = 64;
+
+// One histogram per measured edge. Wait-free striped recording
+// (std::metrics), so participants never serialize on the bookkeeping.
+static QUEUE_LAT: Histogram = Histogram::new();
+static WAKE_LAT: Histogram = Histogram::new();
+static QUORUM_LAT: Histogram = Histogram::new();
+static HANDOFF_LAT: Histogram = Histogram::new();
+static DOORBELL_LAT: Histogram = Histogram::new();
+
+struct BenchState {
+    mode: u64,
+    participants: u64,
+    rounds: u64,
+    base: Instant,
+
+    // mode 1: bounded queue of send timestamps
+    queue: SgxMutex<VecDeque<u64>>,
+    not_empty: SgxCondvar,
+    not_full: SgxCondvar,
+    producers_done: AtomicU64,
+
+    // mode 2: generation broadcast with ack quorum
+    gen: SgxMutex<u64>,
+    gen_cv: SgxCondvar,
+    stamp: AtomicU64,
+    acks: AtomicU64,
+    ack_lock: SgxMutex<()>,
+    ack_cv: SgxCondvar,
+
+    // mode 3: whose turn it is to run
+    turn: SgxMutex<u64>,
+    turn_cv: SgxCondvar,
+
+    // mode 4: untrusted ring with doorbell wake
+    sender: SgxMutex<Option<UntrustedSender>>,
+    receiver: SgxMutex<Option<UntrustedReceiver>>,
+}
+
+impl BenchState {
+    fn nanos(&self) -> u64 {
+        let d = self.base.elapsed();
+        d.as_secs().saturating_mul(1_000_000_000) + u64::from(d.subsec_nanos())
+    }
+}
+
+// Replaced wholesale by each sb_setup. The app orchestrates strictly:
+// setup, then the workers, then the report, with no overlap between
+// runs, so there is never a reader while this is written.
+static mut STATE: Option<BenchState> = None;
+
+fn state() -> &'static BenchState {
+    unsafe { STATE.as_ref().expect("sb_setup not called") }
+}
+
+#[no_mangle]
+pub extern "C" fn sb_setup(mode: u64, participants: u64, rounds: u64) -> sgx_status_t {
+    if !(MODE_QUEUE..=MODE_DOORBELL).contains(&mode) || participants == 0 || rounds == 0 {
+        return sgx_status_t::SGX_ERROR_INVALID_PARAMETER;
+    }
+
+    QUEUE_LAT.clear();
+    WAKE_LAT.clear();
+    QUORUM_LAT.clear();
+    HANDOFF_LAT.clear();
+    DOORBELL_LAT.clear();
+
+    let (sender, receiver) = if mode == MODE_DOORBELL {
+        match untrusted_channel(DOORBELL_SLOTS, DOORBELL_SLOT_SIZE) {
+            Ok((tx, rx)) => (Some(tx), Some(rx)),
+            Err(e) => {
+                println!("[-] doorbell channel setup failed: {}", e);
+                return sgx_status_t::SGX_ERROR_UNEXPECTED;
+            }
+        }
+    } else {
+        (None, None)
+    };
+
+    unsafe {
+        STATE = Some(BenchState {
+            mode,
+            participants,
+            rounds,
+            base: Instant::now(),
+            queue: SgxMutex::new(VecDeque::with_capacity(QUEUE_CAPACITY)),
+            not_empty: SgxCondvar::new(),
+            not_full: SgxCondvar::new(),
+            producers_done: AtomicU64::new(0),
+            gen: SgxMutex::new(0),
+            gen_cv: SgxCondvar::new(),
+            stamp: AtomicU64::new(0),
+            acks: AtomicU64::new(0),
+            ack_lock: SgxMutex::new(()),
+            ack_cv: SgxCondvar::new(),
+            turn: SgxMutex::new(0),
+            turn_cv: SgxCondvar::new(),
+            sender: SgxMutex::new(sender),
+            receiver: SgxMutex::new(receiver),
+        });
+    }
+    sgx_status_t::SGX_SUCCESS
+}
+
+// mode 1, role 0: push `rounds` timestamps through the bounded queue
+fn run_producer(st: &'static BenchState) {
+    for _ in 0..st.rounds {
+        let mut q = st.queue.lock().unwrap();
+        while q.len() >= QUEUE_CAPACITY {
+            q = st.not_full.wait(q).unwrap();
+        }
+        q.push_back(st.nanos());
+        drop(q);
+        st.not_empty.signal();
+    }
+    if st.producers_done.fetch_add(1, Ordering::AcqRel) + 1 == st.participants {
+        // last producer out wakes any consumer still parked on an
+        // empty queue so it can observe completion
+        st.not_empty.broadcast();
+    }
+}
+
+// mode 1, role 1: drain until every producer has finished and the
+// queue is empty, recording enqueue-to-dequeue latency
+fn run_consumer(st: &'static BenchState) {
+    loop {
+        let mut q = st.queue.lock().unwrap();
+        while q.is_empty() {
+            if st.producers_done.load(Ordering::Acquire) == st.participants {
+                return;
+            }
+            q = st.not_empty.wait(q).unwrap();
+        }
+        let sent = q.pop_front().unwrap();
+        drop(q);
+        st.not_full.signal();
+        QUEUE_LAT.observe(st.nanos().saturating_sub(sent));
+    }
+}
+
+// mode 2, role 0: bump the generation, broadcast, wait for the ack
+// quorum, record how long the full fan-out took
+fn run_broadcaster(st: &'static BenchState) {
+    for _ in 0..st.rounds {
+        st.acks.store(0, Ordering::Release);
+        let before = st.nanos();
+        st.stamp.store(before, Ordering::Release);
+        {
+            let mut g = st.gen.lock().unwrap();
+            *g += 1;
+        }
+        st.gen_cv.broadcast();
+
+        let mut guard = st.ack_lock.lock().unwrap();
+        while st.acks.load(Ordering::Acquire) < st.participants {
+            guard = st.ack_cv.wait(guard).unwrap();
+        }
+        drop(guard);
+        QUORUM_LAT.observe(st.nanos().saturating_sub(before));
+    }
+}
+
+// mode 2, role 1: wait for each generation, record own wake latency,
+// ack. The broadcaster waits for the full quorum before the next
+// round, so no waiter can miss a generation.
+fn run_broadcast_waiter(st: &'static BenchState) {
+    let mut seen = 0_u64;
+    for _ in 0..st.rounds {
+        let mut g = st.gen.lock().unwrap();
+        while *g <= seen {
+            g = st.gen_cv.wait(g).unwrap();
+        }
+        seen = *g;
+        drop(g);
+        WAKE_LAT.observe(st.nanos().saturating_sub(st.stamp.load(Ordering::Acquire)));
+
+        let _guard = st.ack_lock.lock().unwrap();
+        st.acks.fetch_add(1, Ordering::AcqRel);
+        st.ack_cv.signal();
+    }
+}
+
+// mode 3: two threads hand the turn back and forth; each records the
+// latency from the partner's signal to its own wake-up
+fn run_handoff(st: &'static BenchState, id: u64) {
+    for _ in 0..st.rounds {
+        let mut turn = st.turn.lock().unwrap();
+        while *turn % 2 != id {
+            turn = st.turn_cv.wait(turn).unwrap();
+        }
+        let handed = st.stamp.swap(0, Ordering::AcqRel);
+        if handed != 0 {
+            HANDOFF_LAT.observe(st.nanos().saturating_sub(handed));
+        }
+        st.stamp.store(st.nanos(), Ordering::Release);
+        *turn += 1;
+        drop(turn);
+        st.turn_cv.signal();
+    }
+}
+
+// mode 4, role 0: send timestamps through the untrusted ring; a parked
+// receiver is woken through the doorbell event
+fn run_doorbell_sender(st: &'static BenchState) {
+    let tx = st.sender.lock().unwrap().take().expect("sender already taken");
+    for _ in 0..st.rounds {
+        let stamp = st.nanos().to_le_bytes();
+        if let Err(e) = tx.send(&stamp) {
+            println!("[-] doorbell send failed: {}", e);
+            break;
+        }
+    }
+    tx.close();
+}
+
+// mode 4, role 1: receive until the sender closes, recording
+// send-to-recv latency
+fn run_doorbell_receiver(st: &'static BenchState) {
+    let mut rx = st.receiver.lock().unwrap().take().expect("receiver already taken");
+    while let Some(msg) = rx.recv() {
+        if msg.len() == 8 {
+            let mut bytes = [0_u8; 8];
+            bytes.copy_from_slice(&msg);
+            DOORBELL_LAT.observe(st.nanos().saturating_sub(u64::from_le_bytes(bytes)));
+        }
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn sb_worker(role: u64, id: u64) -> sgx_status_t {
+    let st = state();
+    match (st.mode, role) {
+        (MODE_QUEUE, 0) => run_producer(st),
+        (MODE_QUEUE, 1) => run_consumer(st),
+        (MODE_BROADCAST, 0) => run_broadcaster(st),
+        (MODE_BROADCAST, 1) => run_broadcast_waiter(st),
+        (MODE_HANDOFF, _) => run_handoff(st, id),
+        (MODE_DOORBELL, 0) => run_doorbell_sender(st),
+        (MODE_DOORBELL, 1) => run_doorbell_receiver(st),
+        _ => return sgx_status_t::SGX_ERROR_INVALID_PARAMETER,
+    }
+    sgx_status_t::SGX_SUCCESS
+}
+
+fn print_histogram(name: &str, hist: &Histogram) {
+    let count = hist.count();
+    if count == 0 {
+        return;
+    }
+    println!(
+        "    {:<16} n={:<9} avg={:>8}ns p50<{:>8}ns p99<{:>8}ns",
+        name,
+        count,
+        hist.sum() / count,
+        hist.quantile(0.50).unwrap_or(0),
+        hist.quantile(0.99).unwrap_or(0)
+    );
+}
+
+#[no_mangle]
+pub extern "C" fn sb_report() -> sgx_status_t {
+    print_histogram("enq-to-deq", &QUEUE_LAT);
+    print_histogram("waiter-wake", &WAKE_LAT);
+    print_histogram("full-quorum", &QUORUM_LAT);
+    print_histogram("handoff", &HANDOFF_LAT);
+    print_histogram("doorbell", &DOORBELL_LAT);
+    sgx_status_t::SGX_SUCCESS
+}
@@ -25,6 +25,31 @@ static ENCLAVE_FILE: &'static str = "enclave.signed.so";
 extern {
     fn say_something(eid: sgx_enclave_id_t, retval: *mut sgx_status_t,
                      some_string: *const u8, len: usize) -> sgx_status_t;
+    fn bench_small_churn(eid: sgx_enclave_id_t, retval: *mut u64) -> sgx_status_t;
+    fn bench_large_transient(eid: sgx_enclave_id_t, retval: *mut u64) -> sgx_status_t;
+    fn bench_xthread_initialize(eid: sgx_enclave_id_t) -> sgx_status_t;
+    fn bench_xthread_producer(eid: sgx_enclave_id_t) -> sgx_status_t;
+    fn bench_xthread_consumer(eid: sgx_enclave_id_t, retval: *mut u64) -> sgx_status_t;
+    fn bench_xthread_uninitialize(eid: sgx_enclave_id_t) -> sgx_status_t;
+}
+
+/// Resident set size of the whole process in KiB, which includes the
+/// enclave's committed EPC pages. Sampled after each phase so allocator
+/// fragmentation shows up as retained memory.
+fn rss_kb() -> u64 {
+    std::fs::read_to_string("/proc/self/status")
+        .ok()
+        .and_then(|status| {
+            status.lines()
+                .find(|line| line.starts_with("VmRSS:"))
+                .and_then(|line| line.split_whitespace().nth(1))
+                .and_then(|kb| kb.parse().ok())
+        })
+        .unwrap_or(0)
+}
+
+fn report(phase: &str, ops_per_sec: u64) {
+    println!("{:<24} {:>12} ops/sec {:>10} KiB RSS", phase, ops_per_sec, rss_kb());
 }
 
 fn init_enclave() -> SgxResult<SgxEnclave> {
@@ -75,5 +100,36 @@ fn main() {
 
     println!("[+] say_something success...");
 
+    let eid = enclave.geteid();
+
+    let mut ops = 0_u64;
+    let result = unsafe { bench_small_churn(eid, &mut ops) };
+    if result != sgx_status_t::SGX_SUCCESS {
+        println!("[-] ECALL Enclave Failed {}!", result.as_str());
+        return;
+    }
+    report("small-object churn", ops);
+
+    let result = unsafe { bench_large_transient(eid, &mut ops) };
+    if result != sgx_status_t::SGX_SUCCESS {
+        println!("[-] ECALL Enclave Failed {}!", result.as_str());
+        return;
+    }
+    report("large transient buffers", ops);
+
+    unsafe { bench_xthread_initialize(eid); }
+    let producer = std::thread::spawn(move || {
+        unsafe { bench_xthread_producer(eid); }
+    });
+    let consumer = std::thread::spawn(move || {
+        let mut ops = 0_u64;
+        unsafe { bench_xthread_consumer(eid, &mut ops); }
+        ops
+    });
+    producer.join().unwrap();
+    let ops = consumer.join().unwrap();
+    unsafe { bench_xthread_uninitialize(eid); }
+    report("cross-thread frees", ops);
+
     enclave.destroy();
 }
@@ -27,13 +27,23 @@ extern crate sgx_types;
 extern crate sgx_tstd as std;
 
 use sgx_types::*;
+use std::boxed::Box;
+use std::collections::VecDeque;
 use std::string::String;
+use std::sync::{SgxMutex, SgxCondvar};
+use std::sync::atomic::{AtomicPtr, Ordering};
 use std::vec::Vec;
 use std::io::{self, Write};
 use std::slice;
 use std::time::*;
 use std::untrusted::time::SystemTimeEx;
 
+const SMALL_CHURN_SLOTS: usize = 4096;
+const SMALL_CHURN_OPS: u64     = 2_000_000;
+const LARGE_OPS: u64           = 2_000;
+const XTHREAD_BUFFERS: u64     = 500_000;
+const XTHREAD_QUEUE_DEPTH: usize = 1024;
+
 fn recursive_memory_func(x: u64, multiplier: u64) -> u64 {
     let v: Vec<u64> = Vec::with_capacity((x * multiplier) as usize);
     let p: u64 = v.as_ptr() as u64;
@@ -94,3 +104,146 @@ pub extern "C" fn say_something(some_string: *const u8, some_len: usize) -> sgx_
 
     sgx_status_t::SGX_SUCCESS
 }
+
+fn lcg(state: &mut u64) -> u64 {
+    *state = state.wrapping_mul(6364136223846793005).wrapping_add(1442695040888963407);
+    *state >> 33
+}
+
+fn ops_per_sec(ops: u64, elapsed: Duration) -> u64 {
+    let nanos = elapsed.as_nanos() as u64;
+    if nanos == 0 { 0 } else { ops.saturating_mul(1_000_000_000) / nanos }
+}
+
+/// Small-object churn: a fixed working set of slots, each op frees one
+/// randomly chosen small buffer and allocates a replacement of a random
+/// size. This is the allocation profile of request handlers.
+#[no_mangle]
+pub extern "C" fn bench_small_churn() -> u64 {
+
+    let mut rng = 0x5eed_5eed_u64;
+    let mut slots: Vec<Vec<u8>> = (0..SMALL_CHURN_SLOTS)
+        .map(|_| vec![0_u8; 16 + (lcg(&mut rng) % 240) as usize])
+        .collect();
+
+    let now = SystemTime::now();
+    for _ in 0..SMALL_CHURN_OPS {
+        let slot = (lcg(&mut rng) as usize) % SMALL_CHURN_SLOTS;
+        let size = 16 + (lcg(&mut rng) % 240) as usize;
+        slots[slot] = vec![slot as u8; size];
+    }
+    let elapsed = now.elapsed().unwrap();
+
+    // Keep the working set observable so the loop is not optimized away.
+    let checksum: u64 = slots.iter().map(|v| v[0] as u64 + v.len() as u64).sum();
+    println!("small churn checksum = {}", checksum);
+
+    ops_per_sec(SMALL_CHURN_OPS, elapsed)
+}
+
+/// Large transient buffers: allocate, touch and free 1-8 MiB buffers,
+/// the profile of staging areas for sealed blobs or file chunks.
+#[no_mangle]
+pub extern "C" fn bench_large_transient() -> u64 {
+
+    let mut rng = 0x1a46_ebaf_u64;
+    let mut checksum = 0_u64;
+
+    let now = SystemTime::now();
+    for _ in 0..LARGE_OPS {
+        let size = (1 + (lcg(&mut rng) % 8) as usize) * 1024 * 1024;
+        let buffer = vec![0xa5_u8; size];
+        checksum += buffer[size / 2] as u64;
+    }
+    let elapsed = now.elapsed().unwrap();
+
+    println!("large transient checksum = {}", checksum);
+    ops_per_sec(LARGE_OPS, elapsed)
+}
+
+/// Bounded queue of buffers handed from the producer thread to the
+/// consumer thread, which drops them. Every free lands on a different
+/// thread than its malloc, the worst case for thread-caching allocators.
+struct XThreadQueue {
+    queue: SgxMutex<VecDeque<Vec<u8>>>,
+    more: SgxCondvar,
+    less: SgxCondvar,
+}
+
+static GLOBAL_XTHREAD_QUEUE: AtomicPtr<()> = AtomicPtr::new(0 as * mut ());
+
+fn get_ref_xthread_queue() -> Option<&'static XThreadQueue>
+{
+    let ptr = GLOBAL_XTHREAD_QUEUE.load(Ordering::SeqCst) as * mut XThreadQueue;
+    if ptr.is_null() {
+        None
+    } else {
+        Some(unsafe { &* ptr })
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn bench_xthread_initialize() {
+
+    let queue = Box::new(XThreadQueue {
+        queue: SgxMutex::new(VecDeque::with_capacity(XTHREAD_QUEUE_DEPTH)),
+        more: SgxCondvar::new(),
+        less: SgxCondvar::new(),
+    });
+    GLOBAL_XTHREAD_QUEUE.store(Box::into_raw(queue) as * mut (), Ordering::SeqCst);
+}
+
+#[no_mangle]
+pub extern "C" fn bench_xthread_uninitialize() {
+
+    let ptr = GLOBAL_XTHREAD_QUEUE.swap(0 as * mut (), Ordering::SeqCst) as * mut XThreadQueue;
+    if ptr.is_null() {
+       return;
+    }
+    let _ = unsafe { Box::from_raw(ptr) };
+}
+
+#[no_mangle]
+pub extern "C" fn bench_xthread_producer() {
+
+    let mut rng = 0xfeed_u64;
+    let shared = get_ref_xthread_queue().unwrap();
+
+    for _ in 0..XTHREAD_BUFFERS {
+        let size = 16 + (lcg(&mut rng) % 240) as usize;
+        let buffer = vec![0x5a_u8; size];
+
+        let mut guard = shared.queue.lock().unwrap();
+        while guard.len() >= XTHREAD_QUEUE_DEPTH {
+            guard = shared.less.wait(guard).unwrap();
+        }
+        guard.push_back(buffer);
+        let _ = shared.more.signal();
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn bench_xthread_consumer() -> u64 {
+
+    let shared = get_ref_xthread_queue().unwrap();
+    let mut checksum = 0_u64;
+
+    let now = SystemTime::now();
+    for _ in 0..XTHREAD_BUFFERS {
+        let buffer;
+        {
+            let mut guard = shared.queue.lock().unwrap();
+            while guard.is_empty() {
+                guard = shared.more.wait(guard).unwrap();
+            }
+            buffer = guard.pop_front().unwrap();
+            let _ = shared.less.signal();
+        }
+        checksum += buffer.len() as u64;
+        // buffer dropped here: a cross-thread free.
+    }
+    let elapsed = now.elapsed().unwrap();
+
+    println!("cross-thread checksum = {}", checksum);
+    ops_per_sec(XTHREAD_BUFFERS, elapsed)
+}
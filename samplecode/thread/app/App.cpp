@@ -166,6 +166,8 @@ int SGX_CDECL main(int argc, char *argv[])
 
     ecall_thread_functions();
 
+    ecall_thread_pool_functions();
+
     /* Destroy the enclave */
     sgx_destroy_enclave(global_eid);
 
@@ -43,6 +43,7 @@ extern "C" {
 #endif
 
 void ecall_thread_functions(void);
+void ecall_thread_pool_functions(void);
 
 #if defined(__cplusplus)
 }
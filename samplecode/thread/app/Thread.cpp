@@ -85,3 +85,42 @@ void ecall_thread_functions(void)
 
     data_uninit();
 }
+
+#define POOL_WORKERS 4
+
+void pool_worker(size_t worker_id)
+{
+    sgx_status_t ret = SGX_ERROR_UNEXPECTED;
+    ret = ecall_pool_worker(global_eid, worker_id);
+    if (ret != SGX_SUCCESS)
+        abort();
+}
+
+/* ecall_thread_pool_functions:
+ *   Drives the work-stealing pool: tasks are dealt in imbalanced static
+ *   blocks and the per-worker counts printed by the enclave show how
+ *   stealing levels the load.
+ */
+void ecall_thread_pool_functions(void)
+{
+    sgx_status_t ret = SGX_ERROR_UNEXPECTED;
+    uint64_t checksum = 0;
+
+    ret = ecall_pool_initialize(global_eid, POOL_WORKERS);
+    if (ret != SGX_SUCCESS)
+        abort();
+
+    printf("Info: executing work-stealing pool, please wait...  \n");
+
+    thread workers[POOL_WORKERS];
+    for (size_t i = 0; i < POOL_WORKERS; i++)
+        workers[i] = thread(pool_worker, i);
+    for (size_t i = 0; i < POOL_WORKERS; i++)
+        workers[i].join();
+
+    ret = ecall_pool_uninitialize(global_eid, &checksum);
+    if (ret != SGX_SUCCESS)
+        abort();
+
+    printf("Info: work-stealing pool finish, checksum %lu...  \n", (unsigned long)checksum);
+}
@@ -22,15 +22,21 @@
 #![cfg_attr(target_env = "sgx", feature(rustc_private))]
 
 #[cfg(not(target_env = "sgx"))]
+#[macro_use]
 extern crate sgx_tstd as std;
 
 use std::sync::{SgxMutex, SgxCondvar};
-use std::sync::atomic::{AtomicPtr, Ordering};
+use std::sync::{work_steal_deque, SgxWorker, SgxStealer, Steal};
+use std::sync::atomic::{AtomicPtr, AtomicUsize, AtomicU64, Ordering};
 use std::boxed::Box;
+use std::vec::Vec;
 
 const BUFFER_SIZE: usize      = 50;
 const LOOPS_PER_THREAD: usize = 500;
 
+const POOL_TASKS: usize     = 512;
+const DEQUE_CAPACITY: usize = POOL_TASKS;
+
 struct CondBuffer{
     buf: [usize; BUFFER_SIZE],
     occupied: i32,
@@ -103,6 +109,145 @@ pub extern "C" fn ecall_producer() {
     }
 }
 
+/// A task weighs every number in [start, end) by its Collatz stopping
+/// time, so task cost varies wildly with the range it covers.
+type Task = (u64, u64);
+
+struct ThreadPool {
+    /// One deque owner per worker; the slot is emptied by the first (and
+    /// only) ecall that runs that worker id.
+    workers: Vec<SgxMutex<Option<SgxWorker<Task>>>>,
+    stealers: Vec<SgxStealer<Task>>,
+    remaining: AtomicUsize,
+    result: AtomicU64,
+}
+
+static GLOBAL_THREAD_POOL: AtomicPtr<()> = AtomicPtr::new(0 as * mut ());
+
+fn get_ref_thread_pool() -> Option<&'static ThreadPool>
+{
+    let ptr = GLOBAL_THREAD_POOL.load(Ordering::SeqCst) as * mut ThreadPool;
+    if ptr.is_null() {
+        None
+    } else {
+        Some(unsafe { &* ptr })
+    }
+}
+
+fn collatz_steps(mut n: u64) -> u64 {
+    let mut steps = 0;
+    while n > 1 {
+        n = if n % 2 == 0 { n / 2 } else { 3 * n + 1 };
+        steps += 1;
+    }
+    steps
+}
+
+fn run_task(task: Task) -> u64 {
+    let (start, end) = task;
+    let mut total = 0;
+    for n in start..end {
+        total += collatz_steps(n);
+    }
+    total
+}
+
+#[no_mangle]
+pub extern "C" fn ecall_pool_initialize(worker_count: usize) {
+
+    if worker_count == 0 || worker_count > POOL_TASKS {
+        return;
+    }
+
+    let mut workers = Vec::with_capacity(worker_count);
+    let mut stealers = Vec::with_capacity(worker_count);
+    for _ in 0..worker_count {
+        let (worker, stealer) = work_steal_deque::<Task>(DEQUE_CAPACITY);
+        workers.push(SgxMutex::new(Some(worker)));
+        stealers.push(stealer);
+    }
+
+    // Deal tasks the way a static partitioner would: contiguous blocks of
+    // equal count. Task widths grow with the index, so the last block is
+    // far heavier than the first and only stealing evens the load out.
+    let tasks_per_worker = POOL_TASKS / worker_count;
+    let mut next = 1_u64;
+    for (index, slot) in workers.iter().enumerate().take(worker_count) {
+        let owner = slot.lock().unwrap();
+        let worker = owner.as_ref().unwrap();
+        for task in 0..tasks_per_worker {
+            let width = ((index * tasks_per_worker + task) as u64 + 1) * 8;
+            let _ = worker.push((next, next + width));
+            next += width;
+        }
+    }
+
+    let pool = Box::new(ThreadPool {
+        workers,
+        stealers,
+        remaining: AtomicUsize::new(worker_count * tasks_per_worker),
+        result: AtomicU64::new(0),
+    });
+    GLOBAL_THREAD_POOL.store(Box::into_raw(pool) as * mut (), Ordering::SeqCst);
+}
+
+#[no_mangle]
+pub extern "C" fn ecall_pool_worker(worker_id: usize) {
+
+    let pool = get_ref_thread_pool().unwrap();
+    if worker_id >= pool.workers.len() {
+        return;
+    }
+
+    let worker = match pool.workers[worker_id].lock().unwrap().take() {
+        Some(worker) => worker,
+        None => return,
+    };
+
+    let mut done = 0_u64;
+    let mut total = 0_u64;
+    while pool.remaining.load(Ordering::Acquire) > 0 {
+        let task = worker.pop().or_else(|| {
+            // Own deque is dry: go steal, starting past our own slot so the
+            // victims are spread out.
+            for offset in 1..pool.stealers.len() {
+                let victim = (worker_id + offset) % pool.stealers.len();
+                loop {
+                    match pool.stealers[victim].steal() {
+                        Steal::Success(task) => return Some(task),
+                        Steal::Retry => continue,
+                        Steal::Empty => break,
+                    }
+                }
+            }
+            None
+        });
+
+        match task {
+            Some(task) => {
+                total += run_task(task);
+                done += 1;
+                pool.remaining.fetch_sub(1, Ordering::Release);
+            }
+            None => core::hint::spin_loop(),
+        }
+    }
+
+    pool.result.fetch_add(total, Ordering::Relaxed);
+    println!("worker {} ran {} tasks", worker_id, done);
+}
+
+#[no_mangle]
+pub extern "C" fn ecall_pool_uninitialize() -> u64 {
+
+    let ptr = GLOBAL_THREAD_POOL.swap(0 as * mut (), Ordering::SeqCst) as * mut ThreadPool;
+    if ptr.is_null() {
+       return 0;
+    }
+    let pool = unsafe { Box::from_raw(ptr) };
+    pool.result.load(Ordering::Relaxed)
+}
+
 #[no_mangle]
 pub extern "C" fn ecall_consumer() {
 
@@ -50,14 +50,24 @@ use std::sync::{Arc, SgxMutex, SgxRwLock};
 use std::net::TcpStream;
 use std::collections::HashMap;
 use std::sync::atomic::{AtomicUsize, AtomicPtr, Ordering};
+use std::time::{Duration, Instant};
 
 extern crate webpki;
 extern crate rustls;
 use rustls::Session;
 
+// Nagle-like record coalescing, mirroring the tlsserver enclave: buffer
+// application data until a full 16KB record (the TLS plaintext maximum)
+// is available or the partial record has aged past the timer, so the
+// per-record AES-GCM overhead is paid on bulk-sized records.
+const COALESCE_RECORD_SIZE: usize = 16 * 1024;
+const COALESCE_DELAY: Duration = Duration::from_micros(500);
+
 pub struct TlsClient {
     socket: TcpStream,
     tls_session:  rustls::ClientSession,
+    pending: Vec<u8>,
+    pending_since: Option<Instant>,
 }
 
 static GLOBAL_CONTEXT_COUNT: AtomicUsize = AtomicUsize::new(0);
@@ -72,7 +82,9 @@ impl TlsClient {
     fn new(fd: c_int, hostname: &str, cfg: Arc<rustls::ClientConfig>) -> TlsClient {
         TlsClient {
             socket: TcpStream::new(fd).unwrap(),
-            tls_session: rustls::ClientSession::new(&cfg, webpki::DNSNameRef::try_from_ascii_str(hostname).unwrap())
+            tls_session: rustls::ClientSession::new(&cfg, webpki::DNSNameRef::try_from_ascii_str(hostname).unwrap()),
+            pending: Vec::new(),
+            pending_since: None,
         }
     }
 
@@ -120,11 +132,38 @@ impl TlsClient {
     //     !self.tls_session.is_handshaking()
     // }
 
-    fn write(&mut self, plaintext: &[u8]) -> c_int{
-        self.tls_session.write(plaintext).unwrap() as c_int
+    fn write(&mut self, plaintext: &[u8]) -> c_int {
+        if self.pending.is_empty() && !plaintext.is_empty() {
+            self.pending_since = Some(Instant::now());
+        }
+        self.pending.extend_from_slice(plaintext);
+        while self.pending.len() >= COALESCE_RECORD_SIZE {
+            let rest = self.pending.split_off(COALESCE_RECORD_SIZE);
+            self.tls_session.write_all(&self.pending).unwrap();
+            self.pending = rest;
+        }
+        if self.pending.is_empty() {
+            self.pending_since = None;
+        }
+        plaintext.len() as c_int
+    }
+
+    fn flush_pending(&mut self) {
+        if !self.pending.is_empty() {
+            self.tls_session.write_all(&self.pending).unwrap();
+            self.pending.clear();
+        }
+        self.pending_since = None;
+    }
+
+    fn pending_expired(&self) -> bool {
+        self.pending_since.map_or(false, |t| t.elapsed() >= COALESCE_DELAY)
     }
 
     fn do_write(&mut self) {
+        if self.pending_expired() {
+            self.flush_pending();
+        }
         self.tls_session.write_tls(&mut self.socket).unwrap();
     }
 }
@@ -233,6 +272,10 @@ fn make_config(cert: &str) -> Arc<rustls::ClientConfig> {
     let persist = Arc::new(PersistCache::new(&cache));
     config.set_persistence(persist);
 
+    // offer early data on resumed TLS 1.3 connections; the server
+    // bounds how much it will accept and may reject it entirely
+    config.enable_early_data = true;
+
     Arc::new(config)
 }
 
@@ -370,7 +413,7 @@ pub extern "C" fn tls_client_wants_read(session_id: usize)  -> c_int {
 pub extern "C" fn tls_client_wants_write(session_id: usize)  -> c_int {
     if let Some(session_ptr) = Sessions::get_session(session_id) {
         let session= unsafe { &mut *session_ptr };
-        let result = session.tls_session.wants_write() as c_int;
+        let result = (session.tls_session.wants_write() || session.pending_expired()) as c_int;
         result
     } else { -1 }
 }
@@ -47,14 +47,31 @@ use std::sync::{Arc, SgxRwLock};
 use std::net::TcpStream;
 use std::collections::HashMap;
 use std::sync::atomic::{AtomicUsize, AtomicPtr, Ordering};
+use std::time::{Duration, Instant};
 
+extern crate sgx_tcrypto;
+extern crate sgx_tseal;
 extern crate webpki;
 extern crate rustls;
-use rustls::{Session, NoClientAuth};
+use sgx_tcrypto::{rsgx_rijndael128GCM_decrypt, rsgx_rijndael128GCM_encrypt};
+use sgx_trts::trts::rsgx_read_rand;
+use sgx_tseal::SgxSealedData;
+use rustls::{Session, NoClientAuth, ProducesTickets};
+
+// Record coalescing: small application writes are buffered in the
+// enclave and cut into full-size records, so each AES-GCM seal (and the
+// transition that drains it) amortizes over 16KB of plaintext instead of
+// a few bytes. TLS caps record plaintext at 16KB, so that is the largest
+// record the peer will accept; the timer bounds how long a partial
+// record may sit in the buffer, Nagle-style.
+const COALESCE_RECORD_SIZE: usize = 16 * 1024;
+const COALESCE_DELAY: Duration = Duration::from_micros(500);
 
 pub struct TlsServer {
     socket: TcpStream,
     tls_session: rustls::ServerSession,
+    pending: Vec<u8>,
+    pending_since: Option<Instant>,
 }
 
 static GLOBAL_CONTEXT_COUNT: AtomicUsize = AtomicUsize::new(0);
@@ -69,7 +86,9 @@ impl TlsServer {
     fn new(fd: c_int, cfg: Arc<rustls::ServerConfig>) -> TlsServer {
         TlsServer {
             socket: TcpStream::new(fd).unwrap(),
-            tls_session: rustls::ServerSession::new(&cfg)
+            tls_session: rustls::ServerSession::new(&cfg),
+            pending: Vec::new(),
+            pending_since: None,
         }
     }
 
@@ -120,11 +139,40 @@ impl TlsServer {
     //     !self.tls_session.is_handshaking()
     // }
 
-    fn write(&mut self, plaintext: &[u8]) -> c_int{
-        self.tls_session.write(plaintext).unwrap() as c_int
+    fn write(&mut self, plaintext: &[u8]) -> c_int {
+        if self.pending.is_empty() && !plaintext.is_empty() {
+            self.pending_since = Some(Instant::now());
+        }
+        self.pending.extend_from_slice(plaintext);
+        // hand rustls only full-size records; the tail waits for more
+        // data or for the timer
+        while self.pending.len() >= COALESCE_RECORD_SIZE {
+            let rest = self.pending.split_off(COALESCE_RECORD_SIZE);
+            self.tls_session.write_all(&self.pending).unwrap();
+            self.pending = rest;
+        }
+        if self.pending.is_empty() {
+            self.pending_since = None;
+        }
+        plaintext.len() as c_int
+    }
+
+    fn flush_pending(&mut self) {
+        if !self.pending.is_empty() {
+            self.tls_session.write_all(&self.pending).unwrap();
+            self.pending.clear();
+        }
+        self.pending_since = None;
+    }
+
+    fn pending_expired(&self) -> bool {
+        self.pending_since.map_or(false, |t| t.elapsed() >= COALESCE_DELAY)
     }
 
     fn do_write(&mut self) {
+        if self.pending_expired() {
+            self.flush_pending();
+        }
         self.tls_session.write_tls(&mut self.socket).unwrap();
     }
 }
@@ -161,6 +209,117 @@ fn load_private_key(filename: &str) -> rustls::PrivateKey {
     }
 }
 
+// Session tickets let a reconnecting client resume with symmetric
+// crypto only, skipping the full handshake that costs ~3x as much
+// inside the enclave as outside. The ticket key is sealed to disk
+// (MRSIGNER policy) so resumption survives enclave restarts without
+// the key ever leaving the enclave in the clear.
+const TICKET_KEY_FILE: &str = "ticket_key.sealed";
+const TICKET_LIFETIME_SECS: u32 = 6 * 60 * 60;
+const TICKET_NONCE_LEN: usize = 12;
+// 0-RTT budget per resumed connection; early data is replayable, so
+// servers must only apply it to idempotent requests
+const MAX_EARLY_DATA_SIZE: u32 = 16 * 1024;
+
+struct SealedTicketer {
+    key: sgx_aes_gcm_128bit_key_t,
+}
+
+impl SealedTicketer {
+    fn load_or_create() -> SealedTicketer {
+        if let Some(key) = SealedTicketer::load_sealed_key() {
+            return SealedTicketer { key };
+        }
+
+        let mut key = sgx_aes_gcm_128bit_key_t::default();
+        rsgx_read_rand(&mut key).expect("cannot draw ticket key");
+        SealedTicketer::store_sealed_key(&key);
+        SealedTicketer { key }
+    }
+
+    fn load_sealed_key() -> Option<sgx_aes_gcm_128bit_key_t> {
+        let mut sealed = fs::read(TICKET_KEY_FILE).ok()?;
+        let sealed_data = unsafe {
+            SgxSealedData::<[u8]>::from_raw_sealed_data_t(
+                sealed.as_mut_ptr() as *mut sgx_sealed_data_t,
+                sealed.len() as u32,
+            )
+        }?;
+        let unsealed = sealed_data.unseal_data().ok()?;
+        let plain = unsealed.get_decrypt_txt();
+        if plain.len() != SGX_AESGCM_KEY_SIZE {
+            return None;
+        }
+        let mut key = sgx_aes_gcm_128bit_key_t::default();
+        key.copy_from_slice(plain);
+        Some(key)
+    }
+
+    fn store_sealed_key(key: &sgx_aes_gcm_128bit_key_t) {
+        let aad: [u8; 0] = [0_u8; 0];
+        let sealed_data = match SgxSealedData::<[u8]>::seal_data(&aad, &key[..]) {
+            Ok(x) => x,
+            Err(_) => return,
+        };
+        let raw_size =
+            SgxSealedData::<[u8]>::calc_raw_sealed_data_size(0, SGX_AESGCM_KEY_SIZE as u32);
+        let mut sealed: Vec<u8> = vec![0; raw_size as usize];
+        let opt = unsafe {
+            sealed_data
+                .to_raw_sealed_data_t(sealed.as_mut_ptr() as *mut sgx_sealed_data_t, raw_size)
+        };
+        if opt.is_some() {
+            if fs::write(TICKET_KEY_FILE, &sealed).is_err() {
+                println!("Warning: cannot persist sealed ticket key; \
+                          resumption will not survive restart");
+            }
+        }
+    }
+}
+
+impl ProducesTickets for SealedTicketer {
+    fn enabled(&self) -> bool {
+        true
+    }
+
+    fn get_lifetime(&self) -> u32 {
+        TICKET_LIFETIME_SECS
+    }
+
+    // ticket = nonce || ciphertext || tag, AES-128-GCM under the
+    // sealed key with a fresh random nonce per ticket
+    fn encrypt(&self, plain: &[u8]) -> Option<Vec<u8>> {
+        let mut nonce = [0_u8; TICKET_NONCE_LEN];
+        rsgx_read_rand(&mut nonce).ok()?;
+
+        let mut cipher: Vec<u8> = vec![0; plain.len()];
+        let mut tag = sgx_aes_gcm_128bit_tag_t::default();
+        rsgx_rijndael128GCM_encrypt(&self.key, plain, &nonce, &[], &mut cipher, &mut tag)
+            .ok()?;
+
+        let mut ticket = Vec::with_capacity(TICKET_NONCE_LEN + cipher.len() + tag.len());
+        ticket.extend_from_slice(&nonce);
+        ticket.extend_from_slice(&cipher);
+        ticket.extend_from_slice(&tag);
+        Some(ticket)
+    }
+
+    fn decrypt(&self, cipher: &[u8]) -> Option<Vec<u8>> {
+        if cipher.len() < TICKET_NONCE_LEN + SGX_AESGCM_MAC_SIZE {
+            return None;
+        }
+        let (nonce, rest) = cipher.split_at(TICKET_NONCE_LEN);
+        let (payload, tag_bytes) = rest.split_at(rest.len() - SGX_AESGCM_MAC_SIZE);
+        let mut tag = sgx_aes_gcm_128bit_tag_t::default();
+        tag.copy_from_slice(tag_bytes);
+
+        let mut plain: Vec<u8> = vec![0; payload.len()];
+        rsgx_rijndael128GCM_decrypt(&self.key, payload, nonce, &[], &tag, &mut plain)
+            .ok()?;
+        Some(plain)
+    }
+}
+
 fn make_config(cert: &str, key: &str) -> Arc<rustls::ServerConfig> {
 
     let mut config = rustls::ServerConfig::new(NoClientAuth::new());
@@ -169,6 +328,15 @@ fn make_config(cert: &str, key: &str) -> Arc<rustls::ServerConfig> {
     let privkey = load_private_key(key);
     config.set_single_cert_with_ocsp_and_sct(certs, privkey, vec![], vec![]).unwrap();
 
+    // session resumption: tickets for stateless resumption across
+    // restarts (key sealed on disk), plus an in-memory session-id
+    // cache for clients that do not support tickets
+    config.ticketer = Arc::new(SealedTicketer::load_or_create());
+    config.set_persistence(rustls::ServerSessionMemoryCache::new(1024));
+    // TLS 1.3 0-RTT: resumed clients may send early data; the
+    // application must treat it as replayable
+    config.max_early_data_size = MAX_EARLY_DATA_SIZE;
+
     Arc::new(config)
 }
 
@@ -306,7 +474,8 @@ pub extern "C" fn tls_server_wants_read(session_id: usize) -> c_int {
 pub extern "C" fn tls_server_wants_write(session_id: usize)  -> c_int {
     if let Some(session_ptr) = Sessions::get_session(session_id) {
         let session = unsafe { &mut *(session_ptr) };
-        let result = session.tls_session.wants_write() as c_int;
+        // a partial record past its timer also needs a write_tls pass
+        let result = (session.tls_session.wants_write() || session.pending_expired()) as c_int;
         result
     } else { -1 }
 }
@@ -320,6 +489,7 @@ pub extern "C" fn tls_server_close(session_id: usize) {
 pub extern "C" fn tls_server_send_close(session_id: usize) {
     if let Some(session_ptr) = Sessions::get_session(session_id) {
         let session = unsafe { &mut *session_ptr };
+        session.flush_pending();
         session.tls_session.send_close_notify();
     }
 }
@@ -19,6 +19,7 @@ use std::net::TcpStream;
 
 mod cert;
 mod pib;
+mod rounds;
 
 const SERVERADDR: &str = "localhost:3443";
 const VERIFYMSADDR: &str = "localhost:3444";
@@ -127,14 +128,40 @@ fn main() {
 
     tls.write_all(b"hello").unwrap();
 
-    let mut plaintext = Vec::new();
-    match tls.read_to_end(&mut plaintext) {
+    let mut greeting = [0u8; 10];
+    match tls.read_exact(&mut greeting) {
         Ok(_) => {
-            println!("Server replied: {}", str::from_utf8(&plaintext).unwrap());
+            println!("Server replied: {}", str::from_utf8(&greeting).unwrap());
         }
-        Err(ref err) if err.kind() == io::ErrorKind::ConnectionAborted => {
-            println!("EOF (tls)");
+        Err(e) => {
+            println!("Error in read_exact: {:?}", e);
+            return;
         }
-        Err(e) => println!("Error in read_to_end: {:?}", e),
     }
+
+    // Batched protocol round: queue every independent query of the
+    // round, then flush them as one frame. N messages, one round trip.
+    const QUERY_COUNT: usize = 1024;
+    const QUERY_LEN: usize = 16;
+
+    let mut batcher = rounds::RoundBatcher::new();
+    let mut queries: Vec<Vec<u8>> = Vec::with_capacity(QUERY_COUNT);
+    for i in 0..QUERY_COUNT {
+        let query: Vec<u8> = (0..QUERY_LEN).map(|j| (i * 31 + j * 7) as u8).collect();
+        batcher.push(&query);
+        queries.push(query);
+    }
+    let sent = batcher.flush(&mut tls).unwrap();
+    println!("batched round: {} queries sent in one frame", sent);
+
+    let answers = rounds::read_round(&mut tls).unwrap();
+    println!("batched round: {} answers received in one frame", answers.len());
+
+    assert_eq!(answers.len(), queries.len());
+    for (i, (query, answer)) in queries.iter().zip(answers.iter()).enumerate() {
+        let pad = (i as u8).wrapping_mul(0x9d).wrapping_add(0x3b);
+        let expected: Vec<u8> = query.iter().map(|b| b ^ pad).collect();
+        assert_eq!(answer, &expected, "answer {} mismatch", i);
+    }
+    println!("batched round verified: {} messages for one round trip", QUERY_COUNT);
 }
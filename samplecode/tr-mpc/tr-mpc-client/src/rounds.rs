@@ -0,0 +1,94 @@
+//! Round batching for the MPC message exchange.
+//!
+//! Protocol messages that do not depend on each other (per-gate OT
+//! queries, garbled-table chunks, label transfers) must not each pay a
+//! network round trip: over a WAN the round trips, not the crypto,
+//! bound throughput. A RoundBatcher accumulates every independent
+//! message of a round and flushes them as one length-prefixed frame
+//! with a single write, so one round trip carries the whole round
+//! regardless of message count.
+//!
+//! Frame layout, all little endian: u32 message count, u32 payload
+//! length, then each message as u32 length plus bytes.
+
+use std::io::{self, Read, Write};
+use std::prelude::v1::*;
+
+/// Upper bound on one frame; a peer announcing more than this is
+/// treated as malformed rather than allocated.
+const MAX_FRAME_BYTES: u32 = 64 * 1024 * 1024;
+
+pub struct RoundBatcher {
+    payload: Vec<u8>,
+    count: u32,
+}
+
+impl RoundBatcher {
+    pub fn new() -> RoundBatcher {
+        RoundBatcher {
+            payload: Vec::new(),
+            count: 0,
+        }
+    }
+
+    /// Queue one message for the current round.
+    pub fn push(&mut self, msg: &[u8]) {
+        self.payload.extend_from_slice(&(msg.len() as u32).to_le_bytes());
+        self.payload.extend_from_slice(msg);
+        self.count += 1;
+    }
+
+    pub fn message_count(&self) -> u32 {
+        self.count
+    }
+
+    /// Send the whole round as one frame and reset the batcher.
+    /// Returns the number of messages flushed.
+    pub fn flush<W: Write>(&mut self, writer: &mut W) -> io::Result<u32> {
+        let mut frame = Vec::with_capacity(8 + self.payload.len());
+        frame.extend_from_slice(&self.count.to_le_bytes());
+        frame.extend_from_slice(&(self.payload.len() as u32).to_le_bytes());
+        frame.extend_from_slice(&self.payload);
+        writer.write_all(&frame)?;
+
+        let flushed = self.count;
+        self.payload.clear();
+        self.count = 0;
+        Ok(flushed)
+    }
+}
+
+/// Read one round frame and split it back into messages.
+pub fn read_round<R: Read>(reader: &mut R) -> io::Result<Vec<Vec<u8>>> {
+    let mut header = [0u8; 8];
+    reader.read_exact(&mut header)?;
+    let count = u32::from_le_bytes([header[0], header[1], header[2], header[3]]);
+    let payload_len = u32::from_le_bytes([header[4], header[5], header[6], header[7]]);
+    if payload_len > MAX_FRAME_BYTES {
+        return Err(io::Error::new(io::ErrorKind::InvalidData, "oversized round frame"));
+    }
+
+    let mut payload = vec![0u8; payload_len as usize];
+    reader.read_exact(&mut payload)?;
+
+    let mut messages = Vec::with_capacity(count as usize);
+    let mut offset = 0usize;
+    for _ in 0..count {
+        if offset + 4 > payload.len() {
+            return Err(io::Error::new(io::ErrorKind::InvalidData, "truncated round frame"));
+        }
+        let len = u32::from_le_bytes([
+            payload[offset],
+            payload[offset + 1],
+            payload[offset + 2],
+            payload[offset + 3],
+        ]) as usize;
+        offset += 4;
+        if offset + len > payload.len() {
+            return Err(io::Error::new(io::ErrorKind::InvalidData, "truncated round frame"));
+        }
+        messages.push(payload[offset..offset + len].to_vec());
+        offset += len;
+    }
+    Ok(messages)
+}
@@ -168,25 +168,30 @@ fn main() {
     };
 
     println!("Running as server...");
+    // The first connection pays the full RA protocol; every further one
+    // inside the credential epoch is a plain TLS handshake against the
+    // cached attested certificate. Stop with Ctrl-C.
     let listener = TcpListener::bind("0.0.0.0:3443").unwrap();
-    match listener.accept() {
-        Ok((socket, addr)) => {
-            println!("new client from {:?}", addr);
-            let mut retval = sgx_status_t::SGX_SUCCESS;
-            let result = unsafe {
-                run_server(enclave.geteid(), &mut retval, socket.as_raw_fd(), sign_type)
-            };
-            match result {
-                sgx_status_t::SGX_SUCCESS => {
-                    println!("ECALL success!");
-                },
-                _ => {
-                    println!("[-] ECALL Enclave Failed {}!", result.as_str());
-                    return;
+    for stream in listener.incoming() {
+        match stream {
+            Ok(socket) => {
+                println!("new client from {:?}", socket.peer_addr());
+                let mut retval = sgx_status_t::SGX_SUCCESS;
+                let result = unsafe {
+                    run_server(enclave.geteid(), &mut retval, socket.as_raw_fd(), sign_type)
+                };
+                match result {
+                    sgx_status_t::SGX_SUCCESS => {
+                        println!("ECALL success!");
+                    },
+                    _ => {
+                        println!("[-] ECALL Enclave Failed {}!", result.as_str());
+                        break;
+                    }
                 }
             }
+            Err(e) => println!("couldn't get client: {:?}", e),
         }
-        Err(e) => println!("couldn't get client: {:?}", e),
     }
 
     println!("[+] Done!");
@@ -0,0 +1,166 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License..
+
+//! Credit-based flow control and buffer accounting for the attested
+//! channels.
+//!
+//! Reading "whatever the peer sends" buffers at the peer's pace in
+//! enclave memory, and EPC is the one resource a thousand slow or
+//! malicious consumers can exhaust from outside: once receive buffers
+//! outgrow the EPC the whole enclave pays EWB paging on every touch.
+//! The accounting here caps that. A global [`ChannelAccounting`] holds
+//! the EPC budget for all connection buffers; each accepted connection
+//! registers and receives a credit line, every buffered byte is charged
+//! against both the line and the budget before it is read off the
+//! session, and consuming bytes repays the credits.
+//!
+//! The credit return path is deliberately not a wire protocol: the
+//! enclave simply stops reading when a connection is out of credit, the
+//! TCP window closes, and the peer blocks. That keeps the three
+//! client implementations shipping with this sample untouched while
+//! giving the server the only guarantee that matters here - in-enclave
+//! buffering is bounded no matter how many peers connect or how slowly
+//! they drain.
+
+use std::io::Read;
+use std::sync::{Once, SgxMutex};
+use std::vec::Vec;
+
+/// Total EPC the server lends to connection buffers. Well under the
+/// heap configured in Enclave.config.xml so normal allocation never
+/// competes with buffering.
+pub const GLOBAL_BUFFER_BUDGET: usize = 4 * 1024 * 1024;
+/// Credit line per connection: the most one peer can hold buffered.
+pub const PER_CONN_CREDIT: usize = 64 * 1024;
+
+pub struct ChannelAccounting {
+    /// Bytes currently buffered across every live connection.
+    used: usize,
+    /// Live registered connections, for admission and stats.
+    connections: usize,
+}
+
+impl ChannelAccounting {
+    pub fn global() -> &'static SgxMutex<ChannelAccounting> {
+        static INIT: Once = Once::new();
+        static mut ACCT: Option<SgxMutex<ChannelAccounting>> = None;
+        unsafe {
+            INIT.call_once(|| {
+                ACCT = Some(SgxMutex::new(ChannelAccounting {
+                    used: 0,
+                    connections: 0,
+                }));
+            });
+            ACCT.as_ref().unwrap()
+        }
+    }
+
+    /// Admits a connection if a full credit line still fits in the
+    /// budget, i.e. admitted connections can never overdraw it in
+    /// aggregate. Returns None when the enclave is at capacity; the
+    /// caller should refuse the connection rather than buffer for it.
+    pub fn register() -> Option<ConnBudget> {
+        let mut acct = ChannelAccounting::global().lock().unwrap();
+        if (acct.connections + 1).saturating_mul(PER_CONN_CREDIT) > GLOBAL_BUFFER_BUDGET {
+            return None;
+        }
+        acct.connections += 1;
+        Some(ConnBudget { credits: PER_CONN_CREDIT })
+    }
+
+    /// (buffered bytes, live connections) - for operator visibility.
+    pub fn stats() -> (usize, usize) {
+        let acct = ChannelAccounting::global().lock().unwrap();
+        (acct.used, acct.connections)
+    }
+}
+
+/// One connection's credit line. Charging moves credits to buffered
+/// bytes; repaying (the application consumed them) moves them back.
+/// Dropping the budget returns everything, so a connection can never
+/// leak accounted bytes past its lifetime.
+pub struct ConnBudget {
+    credits: usize,
+}
+
+impl ConnBudget {
+    fn charge(&mut self, n: usize) -> bool {
+        if n > self.credits {
+            return false;
+        }
+        let mut acct = ChannelAccounting::global().lock().unwrap();
+        if acct.used + n > GLOBAL_BUFFER_BUDGET {
+            return false;
+        }
+        acct.used += n;
+        self.credits -= n;
+        true
+    }
+
+    pub fn repay(&mut self, n: usize) {
+        let n = n.min(PER_CONN_CREDIT - self.credits);
+        ChannelAccounting::global().lock().unwrap().used -= n;
+        self.credits += n;
+    }
+
+    pub fn available(&self) -> usize {
+        self.credits
+    }
+
+    /// Reads from `stream` until the message is complete (`done` says
+    /// so), the peer closes, or the credit line is exhausted. Every
+    /// byte lands in the returned buffer only after being charged, so
+    /// the buffer can never outgrow the connection's line nor push the
+    /// global accounting past the budget. Running out of credit is not
+    /// an error: the caller gets what fit, the unread rest stays in the
+    /// kernel socket buffer outside the enclave, and the closing TCP
+    /// window is the credit-exhausted signal to the peer.
+    pub fn read_bounded<S, F>(&mut self, stream: &mut S, done: F) -> std::io::Result<Vec<u8>>
+    where
+        S: Read,
+        F: Fn(&[u8]) -> bool,
+    {
+        let mut buf = Vec::new();
+        let mut chunk = [0_u8; 1024];
+        loop {
+            if self.available() == 0 || done(&buf) {
+                return Ok(buf);
+            }
+            let want = self.available().min(chunk.len());
+            let n = match stream.read(&mut chunk[..want]) {
+                Ok(0) => return Ok(buf),
+                Ok(n) => n,
+                Err(e) => return Err(e),
+            };
+            if !self.charge(n) {
+                // global budget exhausted by other connections; stop
+                // buffering and let the caller work with what it has
+                return Ok(buf);
+            }
+            buf.extend_from_slice(&chunk[..n]);
+        }
+    }
+}
+
+impl Drop for ConnBudget {
+    fn drop(&mut self) {
+        let outstanding = PER_CONN_CREDIT - self.credits;
+        let mut acct = ChannelAccounting::global().lock().unwrap();
+        acct.used -= outstanding;
+        acct.connections -= 1;
+    }
+}
@@ -48,17 +48,20 @@ use sgx_tcrypto::*;
 use sgx_rand::*;
 
 use std::prelude::v1::*;
-use std::sync::Arc;
+use std::sync::{Arc, Once, SgxMutex};
 use std::net::TcpStream;
 use std::string::String;
 use std::ptr;
 use std::str;
 use std::io::{Write, Read, BufReader};
+use std::time::SystemTime;
 use std::untrusted::fs;
+use std::untrusted::time::SystemTimeEx;
 use std::vec::Vec;
 use itertools::Itertools;
 
 mod cert;
+mod flow;
 mod hex;
 
 pub const DEV_HOSTNAME:&'static str = "api.trustedservices.intel.com";
@@ -66,6 +69,12 @@ pub const SIGRL_SUFFIX:&'static str = "/sgx/dev/attestation/v3/sigrl/";
 pub const REPORT_SUFFIX:&'static str = "/sgx/dev/attestation/v3/report";
 pub const CERTEXPIRYDAYS: i64 = 90i64;
 
+// How long one attested credential serves new connections before the
+// RA protocol is re-run. Comfortably inside both the certificate
+// validity window above and what a verifier accepts as a fresh IAS
+// report timestamp.
+pub const CRED_EPOCH_SECS: u64 = 24 * 60 * 60;
+
 extern "C" {
     pub fn ocall_sgx_init_quote ( ret_val : *mut sgx_status_t,
                   ret_ti  : *mut sgx_target_info_t,
@@ -498,30 +507,74 @@ fn get_ias_api_key() -> String {
     key.trim_end().to_owned()
 }
 
-#[no_mangle]
-pub extern "C" fn run_server(socket_fd : c_int, sign_type: sgx_quote_sign_type_t) -> sgx_status_t {
+// The attested credential generated once per epoch: a fresh key pair
+// bound to a quote through the IAS report embedded in the certificate.
+struct AttestedCred {
+    key_der: Vec<u8>,
+    cert_der: Vec<u8>,
+    created: SystemTime,
+}
+
+static CRED_INIT: Once = Once::new();
+static mut CRED_CACHE: Option<SgxMutex<Option<AttestedCred>>> = None;
+
+fn cred_cache() -> &'static SgxMutex<Option<AttestedCred>> {
+    unsafe {
+        CRED_INIT.call_once(|| {
+            CRED_CACHE = Some(SgxMutex::new(None));
+        });
+        CRED_CACHE.as_ref().unwrap()
+    }
+}
+
+// Every connection used to pay the whole RA protocol (quote generation
+// plus two IAS round trips). The credential it produces stays valid far
+// longer than one handshake, so generate it once, cache it in enclave
+// memory and let every connection inside the epoch do plain TLS with
+// the cached certificate. The lock also serializes refresh: one thread
+// re-attests while the others wait for the new credential.
+fn get_attested_credentials(sign_type: sgx_quote_sign_type_t) -> Result<(Vec<u8>, Vec<u8>), sgx_status_t> {
+    let mut cache = cred_cache().lock().unwrap();
+    if let Some(ref cred) = *cache {
+        let fresh = SystemTime::now()
+            .duration_since(cred.created)
+            .map(|age| age.as_secs() < CRED_EPOCH_SECS)
+            .unwrap_or(false);
+        if fresh {
+            println!("Reusing attested credentials, no RA needed");
+            return Ok((cred.key_der.clone(), cred.cert_der.clone()));
+        }
+    }
+
     // Generate Keypair
     let ecc_handle = SgxEccHandle::new();
     let _result = ecc_handle.open();
     let (prv_k, pub_k) = ecc_handle.create_key_pair().unwrap();
 
-    let (attn_report, sig, cert) = match create_attestation_report(&pub_k, sign_type) {
-        Ok(r) => r,
-        Err(e) => {
-            println!("Error in create_attestation_report: {:?}", e);
-            return e;
-        }
-    };
+    let (attn_report, sig, cert) = create_attestation_report(&pub_k, sign_type)?;
 
     let payload = attn_report + "|" + &sig + "|" + &cert;
-    let (key_der, cert_der) = match cert::gen_ecc_cert(payload, &prv_k, &pub_k, &ecc_handle) {
+    let (key_der, cert_der) = cert::gen_ecc_cert(payload, &prv_k, &pub_k, &ecc_handle)?;
+    let _result = ecc_handle.close();
+
+    *cache = Some(AttestedCred {
+        key_der: key_der.clone(),
+        cert_der: cert_der.clone(),
+        created: SystemTime::now(),
+    });
+
+    Ok((key_der, cert_der))
+}
+
+#[no_mangle]
+pub extern "C" fn run_server(socket_fd : c_int, sign_type: sgx_quote_sign_type_t) -> sgx_status_t {
+    let (key_der, cert_der) = match get_attested_credentials(sign_type) {
         Ok(r) => r,
         Err(e) => {
-            println!("Error in gen_ecc_cert: {:?}", e);
+            println!("Error in get_attested_credentials: {:?}", e);
             return e;
         }
     };
-    let _result = ecc_handle.close();
 
     let root_ca_bin = include_bytes!("../../../cert/ca.crt");
     let mut ca_reader = BufReader::new(&root_ca_bin[..]);
@@ -538,20 +591,39 @@ pub extern "C" fn run_server(socket_fd : c_int, sign_type: sgx_quote_sign_type_t
 
     cfg.set_single_cert_with_ocsp_and_sct(certs, privkey, vec![], vec![]).unwrap();
 
+    // Admission control first: if every admitted connection drawing
+    // its full credit line would overrun the EPC budget, refuse now
+    // instead of buffering for a peer we cannot afford.
+    let mut budget = match flow::ChannelAccounting::register() {
+        Some(budget) => budget,
+        None => {
+            let (used, conns) = flow::ChannelAccounting::stats();
+            println!("[-] refusing connection: {} buffered bytes over {} connections", used, conns);
+            return sgx_status_t::SGX_ERROR_OUT_OF_EPC;
+        }
+    };
+
     let mut sess = rustls::ServerSession::new(&Arc::new(cfg));
     let mut conn = TcpStream::new(socket_fd).unwrap();
 
     let mut tls = rustls::Stream::new(&mut sess, &mut conn);
-    let mut plaintext = [0u8;1024]; //Vec::new();
-    match tls.read(&mut plaintext) {
-        Ok(_) => println!("Client said: {}", str::from_utf8(&plaintext).unwrap()),
+    // Every buffered byte is charged against this connection's credit
+    // line before it enters the enclave; a slow or hostile client can
+    // hold at most PER_CONN_CREDIT in EPC, and unread bytes wait in the
+    // kernel socket buffer outside.
+    let plaintext = match budget.read_bounded(&mut tls, |buf| !buf.is_empty()) {
+        Ok(buf) => buf,
         Err(e) => {
-            println!("Error in read_to_end: {:?}", e);
+            println!("Error in read_bounded: {:?}", e);
             panic!("");
         }
     };
+    println!("Client said: {}", str::from_utf8(&plaintext).unwrap_or("<non-utf8>"));
 
     tls.write("hello back".as_bytes()).unwrap();
 
+    // message consumed; return the credits before the budget drops
+    budget.repay(plaintext.len());
+
     sgx_status_t::SGX_SUCCESS
 }
@@ -22,6 +22,8 @@
 #![cfg_attr(target_env = "sgx", feature(rustc_private))]
 
 extern crate sgx_types;
+extern crate sgx_tcrypto;
+extern crate sgx_tseal;
 #[cfg(not(target_env = "sgx"))]
 #[macro_use]
 extern crate sgx_tstd as std;
@@ -29,9 +31,13 @@ extern crate sgx_tstd as std;
 #[macro_use]
 extern crate lazy_static;
 
+mod mcache;
+
 use std::prelude::v1::*;
 use std::sync::SgxMutex;
 use std::ptr;
+use std::ffi::CStr;
+use std::os::raw::c_char;
 
 extern crate wasmi;
 extern crate sgxwasm;
@@ -41,7 +47,7 @@ use sgxwasm::{SpecDriver, boundary_value_to_runtime_value, result_covert};
 use sgx_types::*;
 use std::slice;
 
-use wasmi::{ModuleInstance, ImportsBuilder, RuntimeValue, Error as InterpreterError, Module};
+use wasmi::{ModuleInstance, ImportsBuilder, RuntimeValue, Error as InterpreterError};
 
 extern crate serde;
 extern crate serde_json;
@@ -98,28 +104,26 @@ fn wasm_get(module : Option<String>, field : String)
      Ok(Some(global.get()))
 }
 
-fn try_load_module(wasm: &[u8]) -> Result<Module, InterpreterError> {
-    wasmi::Module::from_buffer(wasm).map_err(|e| InterpreterError::Instantiation(format!("Module::from_buffer error {:?}", e)))
-}
-
 fn wasm_try_load(wasm: Vec<u8>) -> Result<(), InterpreterError> {
     let ref mut spec_driver = SPECDRIVER.lock().unwrap();
-    let module = try_load_module(&wasm[..])?;
-    let instance = ModuleInstance::new(&module, &ImportsBuilder::default())?;
-    instance
-        .run_start(spec_driver.spec_module())
-        .map_err(|trap| InterpreterError::Instantiation(format!("ModuleInstance::run_start error on {:?}", trap)))?;
-    Ok(())
+    mcache::with_module(&wasm[..], |module| {
+        let instance = ModuleInstance::new(module, &ImportsBuilder::default())?;
+        instance
+            .run_start(spec_driver.spec_module())
+            .map_err(|trap| InterpreterError::Instantiation(format!("ModuleInstance::run_start error on {:?}", trap)))?;
+        Ok(())
+    })
 }
 
 fn wasm_load_module(name: Option<String>, module: Vec<u8>)
                     -> Result<(), InterpreterError> {
     let ref mut spec_driver = SPECDRIVER.lock().unwrap();
-    let module = try_load_module(&module[..])?;
-    let instance = ModuleInstance::new(&module, &**spec_driver)
-        .map_err(|e| InterpreterError::Instantiation(format!("ModuleInstance::new error on {:?}", e)))?
-        .run_start(spec_driver.spec_module())
-        .map_err(|trap| InterpreterError::Instantiation(format!("ModuleInstance::run_start error on {:?}", trap)))?;
+    let instance = mcache::with_module(&module[..], |module| {
+        ModuleInstance::new(module, &**spec_driver)
+            .map_err(|e| InterpreterError::Instantiation(format!("ModuleInstance::new error on {:?}", e)))?
+            .run_start(spec_driver.spec_module())
+            .map_err(|trap| InterpreterError::Instantiation(format!("ModuleInstance::run_start error on {:?}", trap)))
+    })?;
 
     spec_driver.add_module(name, instance.clone());
 
@@ -227,3 +231,68 @@ fn sgxwasm_run_action(req_bin : *const u8, req_length: usize,
     }
 }
 
+/// Validate and translate a module, keep it in the in-memory cache and
+/// seal the artifact to disk so later enclave runs can reload it
+/// without going back to the untrusted module supplier.
+#[no_mangle]
+pub extern "C"
+fn sgxwasm_cache_store(name: *const c_char, wasm: *const u8, wasm_len: usize) -> sgx_status_t {
+    if name.is_null() || wasm.is_null() {
+        return sgx_status_t::SGX_ERROR_INVALID_PARAMETER;
+    }
+    let name = match unsafe { CStr::from_ptr(name).to_str() } {
+        Ok(n) => n,
+        Err(_) => return sgx_status_t::SGX_ERROR_INVALID_PARAMETER,
+    };
+    let wasm = unsafe { slice::from_raw_parts(wasm, wasm_len) };
+
+    // reject invalid modules before anything reaches disk
+    if let Err(e) = mcache::with_module(wasm, |_| Ok(())) {
+        println!("cache_store: module rejected: {:?}", e);
+        return sgx_status_t::SGX_ERROR_WASM_LOAD_MODULE_ERROR;
+    }
+
+    match mcache::seal_to_file(name, wasm) {
+        Ok(()) => sgx_status_t::SGX_SUCCESS,
+        Err(e) => {
+            println!("cache_store: {}", e);
+            sgx_status_t::SGX_ERROR_UNEXPECTED
+        }
+    }
+}
+
+/// Reload a sealed module artifact and instantiate it under its name,
+/// replacing the cold-start path of fetching and re-trusting the
+/// module from outside.
+#[no_mangle]
+pub extern "C"
+fn sgxwasm_cache_load(name: *const c_char) -> sgx_status_t {
+    if name.is_null() {
+        return sgx_status_t::SGX_ERROR_INVALID_PARAMETER;
+    }
+    let name = match unsafe { CStr::from_ptr(name).to_str() } {
+        Ok(n) => n,
+        Err(_) => return sgx_status_t::SGX_ERROR_INVALID_PARAMETER,
+    };
+
+    let wasm = match mcache::load_sealed_file(name) {
+        Ok(wasm) => wasm,
+        Err(e) => {
+            println!("cache_load: {}", e);
+            return sgx_status_t::SGX_ERROR_UNEXPECTED;
+        }
+    };
+
+    match wasm_load_module(Some(name.to_string()), wasm) {
+        Ok(()) => {
+            let (translations, hits) = mcache::stats();
+            println!("module cache: {} translations, {} hits", translations, hits);
+            sgx_status_t::SGX_SUCCESS
+        }
+        Err(e) => {
+            println!("cache_load: instantiation failed: {:?}", e);
+            sgx_status_t::SGX_ERROR_WASM_LOAD_MODULE_ERROR
+        }
+    }
+}
+
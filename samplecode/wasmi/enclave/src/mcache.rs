@@ -0,0 +1,141 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License..
+
+//! Module translation cache with sealed on-disk artifacts.
+//!
+//! Validating and translating a WASM module is the dominant cold-start
+//! cost of this enclave. Two layers cut it down:
+//!
+//! * an in-memory cache of translated `wasmi::Module`s keyed by the
+//!   SHA-256 of the bytecode, so loading the same module again within
+//!   one enclave lifetime skips parsing, validation and translation
+//!   entirely;
+//! * a sealed artifact per named module, so a restarted enclave gets
+//!   its module back with one file read plus the seal integrity check
+//!   instead of a round trip to whoever supplies modules.
+//!
+//! This wasmi fork cannot serialize its translated representation, so
+//! the sealed artifact stores the bytecode and warm starts still pay
+//! one translation to refill the in-memory cache; what they no longer
+//! pay is re-fetching and re-trusting the module from outside.
+
+use sgx_tcrypto::rsgx_sha256_slice;
+use sgx_tseal::SgxSealedData;
+use sgx_types::sgx_sealed_data_t;
+use std::collections::HashMap;
+use std::io::{Read, Write};
+use std::prelude::v1::*;
+use std::sync::atomic::{AtomicUsize, Ordering};
+use std::sync::SgxMutex;
+use std::untrusted::fs;
+use wasmi::{Error as InterpreterError, Module};
+
+lazy_static! {
+    static ref MODULE_CACHE: SgxMutex<HashMap<[u8; 32], Module>> = SgxMutex::new(HashMap::new());
+}
+
+static TRANSLATIONS: AtomicUsize = AtomicUsize::new(0);
+static CACHE_HITS: AtomicUsize = AtomicUsize::new(0);
+
+fn translate(wasm: &[u8]) -> Result<Module, InterpreterError> {
+    TRANSLATIONS.fetch_add(1, Ordering::Relaxed);
+    Module::from_buffer(wasm)
+        .map_err(|e| InterpreterError::Instantiation(format!("Module::from_buffer error {:?}", e)))
+}
+
+/// Run `f` against the translated form of `wasm`, translating only if
+/// the bytecode has not been seen before.
+pub fn with_module<F, R>(wasm: &[u8], f: F) -> Result<R, InterpreterError>
+where
+    F: FnOnce(&Module) -> Result<R, InterpreterError>,
+{
+    let digest = match rsgx_sha256_slice(wasm) {
+        Ok(hash) => hash,
+        // hashing failed: fall back to an uncached translation
+        Err(_) => return f(&translate(wasm)?),
+    };
+
+    let mut cache = MODULE_CACHE.lock().unwrap();
+    if !cache.contains_key(&digest) {
+        let module = translate(wasm)?;
+        cache.insert(digest, module);
+    } else {
+        CACHE_HITS.fetch_add(1, Ordering::Relaxed);
+    }
+    f(cache.get(&digest).unwrap())
+}
+
+pub fn stats() -> (usize, usize) {
+    (
+        TRANSLATIONS.load(Ordering::Relaxed),
+        CACHE_HITS.load(Ordering::Relaxed),
+    )
+}
+
+fn artifact_path(name: &str) -> String {
+    format!("{}.wasm.sealed", name)
+}
+
+/// Seal the validated bytecode of a named module to disk. The module
+/// name goes into the additional authenticated data, so an artifact
+/// cannot be replayed under another name.
+pub fn seal_to_file(name: &str, wasm: &[u8]) -> Result<(), String> {
+    let aad = name.as_bytes().to_vec();
+    let sealed_data = SgxSealedData::<[u8]>::seal_data(&aad, wasm)
+        .map_err(|e| format!("seal_data failed: {}", e.as_str()))?;
+
+    let sealed_len = SgxSealedData::<[u8]>::calc_raw_sealed_data_size(aad.len() as u32, wasm.len() as u32);
+    let mut sealed_log: Vec<u8> = vec![0_u8; sealed_len as usize];
+    unsafe {
+        sealed_data
+            .to_raw_sealed_data_t(sealed_log.as_mut_ptr() as *mut sgx_sealed_data_t, sealed_len)
+            .ok_or_else(|| String::from("to_raw_sealed_data_t failed"))?;
+    }
+
+    let mut file = fs::File::create(artifact_path(name))
+        .map_err(|e| format!("cannot create artifact: {}", e))?;
+    file.write_all(&sealed_log)
+        .map_err(|e| format!("cannot write artifact: {}", e))
+}
+
+/// Load and unseal the artifact for a named module. The seal MAC
+/// provides the integrity check; a tampered or cross-named artifact
+/// fails here.
+pub fn load_sealed_file(name: &str) -> Result<Vec<u8>, String> {
+    let mut file = fs::File::open(artifact_path(name))
+        .map_err(|e| format!("cannot open artifact: {}", e))?;
+    let mut sealed_log = Vec::new();
+    file.read_to_end(&mut sealed_log)
+        .map_err(|e| format!("cannot read artifact: {}", e))?;
+
+    let sealed_data = unsafe {
+        SgxSealedData::<[u8]>::from_raw_sealed_data_t(
+            sealed_log.as_mut_ptr() as *mut sgx_sealed_data_t,
+            sealed_log.len() as u32,
+        )
+    }
+    .ok_or_else(|| String::from("malformed sealed artifact"))?;
+
+    let unsealed_data = sealed_data
+        .unseal_data()
+        .map_err(|e| format!("unseal failed: {}", e.as_str()))?;
+
+    if unsealed_data.get_additional_txt() != name.as_bytes() {
+        return Err(String::from("artifact was sealed for a different module name"));
+    }
+    Ok(unsealed_data.get_decrypt_txt().to_vec())
+}
@@ -39,6 +39,8 @@ use inflate::inflate_bytes_zlib;
 use libflate::zlib::Encoder;
 use std::io::Write;
 
+mod stream;
+
 lazy_static! {
     static ref HELLOSTR : String = String::from("This is a global rust String init by lazy_static!");
 }
@@ -60,6 +62,8 @@ fn zlib_sample() -> sgx_status_t {
     let decoded_string = from_utf8(&decoded[..]);
     println!("After zlib decompress: {:?}", decoded_string.unwrap());
 
+    stream::run_streaming_pipeline();
+
     sgx_status_t::SGX_SUCCESS
 }
 
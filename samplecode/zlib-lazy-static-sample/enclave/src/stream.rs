@@ -0,0 +1,208 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License..
+
+//! Streaming compression pipeline.
+//!
+//! The one-shot path compresses a whole buffer and only then hands the
+//! result out, so the enclave alternates between pure compute and pure
+//! output. Here the input is cut into chunks and a worker TCS
+//! compresses chunk i+1 while the main TCS pushes chunk i out through
+//! an ocall, overlapping compute with exit latency. Output buffers
+//! travel in a small ring between the two threads so steady state does
+//! no allocation. An autotuner picks the encoder level by measuring
+//! throughput against ratio on the first chunk, since audit-log
+//! ingestion must keep up with the producer before it optimizes size.
+
+use std::prelude::v1::*;
+use std::sync::mpsc;
+use std::sync::Arc;
+use std::thread;
+use std::time::SystemTime;
+use std::untrusted::time::SystemTimeEx;
+use std::io::Write;
+
+use libflate::lz77::DefaultLz77Encoder;
+use libflate::zlib::{EncodeOptions, Encoder};
+
+extern "C" {
+    fn ocall_zlib_output(data: *const u8, len: usize) -> sgx_types::sgx_status_t;
+}
+
+const CHUNK_SIZE: usize = 256 * 1024;
+/// Buffers circulating between the worker and the output thread. Two
+/// would suffice for overlap; a couple more absorb ocall jitter.
+const RING_DEPTH: usize = 4;
+/// Levels slower than this on the tuning chunk are rejected no matter
+/// how well they compress.
+const MIN_MB_PER_S: f64 = 30.0;
+
+/// Encoder levels exposed by libflate, ordered fastest first. libflate
+/// has no zlib-style preset dictionaries, so the "dictionary" the ring
+/// recycles is the output buffer, not an LZ77 window seed.
+#[derive(Clone, Copy, PartialEq)]
+pub enum Level {
+    /// Stored blocks, no matching.
+    Store,
+    /// Small LZ77 window with fixed Huffman codes.
+    Fast,
+    /// Full window with dynamic Huffman codes (libflate default).
+    Balanced,
+}
+
+impl Level {
+    fn name(&self) -> &'static str {
+        match *self {
+            Level::Store => "store",
+            Level::Fast => "fast",
+            Level::Balanced => "balanced",
+        }
+    }
+}
+
+/// Compress one chunk into `out`, reusing its capacity. Takes and
+/// returns the buffer because the encoder owns its writer.
+fn compress_chunk(input: &[u8], level: Level, mut out: Vec<u8>) -> Vec<u8> {
+    out.clear();
+    let options = match level {
+        Level::Store => EncodeOptions::new().no_compression(),
+        Level::Fast => {
+            EncodeOptions::with_lz77(DefaultLz77Encoder::with_window_size(1024))
+                .fixed_huffman_codes()
+        }
+        Level::Balanced => EncodeOptions::new(),
+    };
+    let mut encoder = Encoder::with_options(out, options).unwrap();
+    encoder.write_all(input).unwrap();
+    encoder.finish().into_result().unwrap()
+}
+
+fn elapsed_secs(begin: &SystemTime) -> f64 {
+    let elapsed = begin.elapsed().unwrap();
+    elapsed.as_secs() as f64 + f64::from(elapsed.subsec_nanos()) * 1e-9
+}
+
+/// Try each level on one chunk and keep the best ratio among levels
+/// fast enough to sustain the ingestion rate. Falls back to the
+/// fastest level if nothing makes the floor.
+fn autotune(sample: &[u8]) -> Level {
+    let mut choice = Level::Store;
+    let mut best_ratio = f64::INFINITY;
+    for &level in [Level::Store, Level::Fast, Level::Balanced].iter() {
+        let begin = SystemTime::now();
+        let out = compress_chunk(sample, level, Vec::new());
+        let secs = elapsed_secs(&begin);
+        let mb_per_s = sample.len() as f64 / secs / (1024.0 * 1024.0);
+        let ratio = out.len() as f64 / sample.len() as f64;
+        println!("autotune {:>8}: {:6.1} MB/s, ratio {:.3}",
+                 level.name(), mb_per_s, ratio);
+        if mb_per_s >= MIN_MB_PER_S && ratio < best_ratio {
+            best_ratio = ratio;
+            choice = level;
+        }
+    }
+    println!("autotune picked: {}", choice.name());
+    choice
+}
+
+/// Synthetic audit-log records: textual, repetitive field names,
+/// varying values. Deterministic so runs are comparable.
+fn generate_log(len: usize) -> Vec<u8> {
+    let mut data = Vec::with_capacity(len + 128);
+    let mut seq: u64 = 0;
+    while data.len() < len {
+        let line = format!(
+            "ts=172493{:04} session={:04x} uid={} verb={} object=/var/enclave/audit/seg{:03} status=ok\n",
+            seq % 10000,
+            (seq * 2654435761) & 0xffff,
+            1000 + (seq % 16),
+            ["open", "read", "write", "seal", "close"][(seq % 5) as usize],
+            seq % 512);
+        data.extend_from_slice(line.as_bytes());
+        seq += 1;
+    }
+    data.truncate(len);
+    data
+}
+
+fn emit(chunk: &[u8]) {
+    unsafe {
+        ocall_zlib_output(chunk.as_ptr(), chunk.len());
+    }
+}
+
+/// Baseline: compress everything, then emit everything.
+fn one_shot(data: &[u8], level: Level) -> (f64, usize) {
+    let begin = SystemTime::now();
+    let mut compressed_len = 0;
+    for chunk in data.chunks(CHUNK_SIZE) {
+        let out = compress_chunk(chunk, level, Vec::new());
+        compressed_len += out.len();
+        emit(&out);
+    }
+    (elapsed_secs(&begin), compressed_len)
+}
+
+/// Overlapped: a worker TCS compresses ahead while this TCS drains
+/// finished chunks through the output ocall. The `empty` channel
+/// returns drained buffers to the worker, forming the reuse ring.
+fn pipelined(data: &Arc<Vec<u8>>, level: Level) -> (f64, usize) {
+    let (full_tx, full_rx) = mpsc::channel::<Vec<u8>>();
+    let (empty_tx, empty_rx) = mpsc::channel::<Vec<u8>>();
+    for _ in 0..RING_DEPTH {
+        empty_tx.send(Vec::with_capacity(CHUNK_SIZE)).unwrap();
+    }
+
+    let begin = SystemTime::now();
+    let input = data.clone();
+    let worker = thread::spawn(move || {
+        for chunk in input.chunks(CHUNK_SIZE) {
+            let buf = empty_rx.recv().unwrap();
+            full_tx.send(compress_chunk(chunk, level, buf)).unwrap();
+        }
+        // Dropping full_tx ends the drain loop below.
+    });
+
+    let mut compressed_len = 0;
+    while let Ok(out) = full_rx.recv() {
+        compressed_len += out.len();
+        emit(&out);
+        // Ignore failure: the worker is gone once all chunks are sent.
+        let _ = empty_tx.send(out);
+    }
+    worker.join().unwrap();
+    (elapsed_secs(&begin), compressed_len)
+}
+
+pub fn run_streaming_pipeline() {
+    const LOG_LEN: usize = 16 * 1024 * 1024;
+
+    println!("streaming pipeline: {} MB of audit log, {} KB chunks",
+             LOG_LEN / (1024 * 1024), CHUNK_SIZE / 1024);
+
+    let data = Arc::new(generate_log(LOG_LEN));
+    let level = autotune(&data[..CHUNK_SIZE]);
+
+    let (secs, compressed_len) = one_shot(&data, level);
+    let base_mb_per_s = data.len() as f64 / secs / (1024.0 * 1024.0);
+    println!("one-shot : {:.3}s, {:6.1} MB/s, {} compressed bytes",
+             secs, base_mb_per_s, compressed_len);
+
+    let (secs, compressed_len) = pipelined(&data, level);
+    let mb_per_s = data.len() as f64 / secs / (1024.0 * 1024.0);
+    println!("pipelined: {:.3}s, {:6.1} MB/s, {} compressed bytes ({:.2}x)",
+             secs, mb_per_s, compressed_len, mb_per_s / base_mb_per_s);
+}
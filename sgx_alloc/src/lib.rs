@@ -32,6 +32,7 @@
 #![feature(core_intrinsics)]
 #![feature(nonnull_slice_from_raw_parts)]
 #![feature(slice_ptr_get)]
+#![feature(thread_local)]
 
 extern crate alloc;
 
@@ -40,4 +41,8 @@ pub use system::System;
 
 pub mod alignalloc;
 pub mod alignbox;
+pub mod arena;
 pub mod rsrvmem;
+pub mod span;
+pub mod stats;
+pub mod tcache;
@@ -0,0 +1,238 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License..
+
+//! Size-class spans with segregated metadata.
+//!
+//! The tlibc heap interleaves boundary tags with user data, so an
+//! allocation-heavy phase drags header cache lines through the EPC
+//! alongside every object it touches, and a hot span is never a clean
+//! run of pages. A [`SpanAlloc`] instead carves page-aligned spans into
+//! equal-size objects and keeps every piece of bookkeeping - the free
+//! bitmap, occupancy counts, the address lookup - in ordinary heap
+//! structures away from the spans themselves. Object pages hold objects
+//! only: allocation-phase cache misses land on data the caller was
+//! going to touch anyway, and when the EPC pages a cold span out (EWB),
+//! it evicts pure user data without taking allocator metadata with it.
+//!
+//! Like [`Arena`](crate::arena::Arena), a `SpanAlloc` is a value, not a
+//! global: it is not `Sync`, so give each worker its own, or wrap one
+//! in the application's lock of choice. Objects must be freed with the
+//! size they were allocated with, as with `Layout`-based deallocation.
+
+use alloc::collections::BTreeMap;
+use alloc::vec::Vec;
+use core::ffi::c_void;
+use core::ptr;
+use crate::system::libc;
+
+const PAGE_SIZE: usize = 4096;
+
+/// Bytes per span; a whole number of EPC pages so spans page in and
+/// out as clean runs.
+pub const SPAN_SIZE: usize = 64 * 1024;
+
+/// Smallest size class.
+pub const MIN_CLASS_SIZE: usize = 64;
+/// Largest request served from spans; bigger requests should go to the
+/// plain heap.
+pub const MAX_CLASS_SIZE: usize = 8192;
+
+// Classes 64, 128, ..., 8192.
+const CLASSES: usize = 8;
+// Largest objects-per-span: SPAN_SIZE / MIN_CLASS_SIZE = 1024 bits.
+const BITMAP_WORDS: usize = SPAN_SIZE / MIN_CLASS_SIZE / 64;
+
+// All Span fields live in this struct on the ordinary heap; the span's
+// pages themselves are never written by the allocator.
+struct Span {
+    base: *mut u8,
+    class: usize,
+    objects: usize,
+    live: usize,
+    bitmap: [u64; BITMAP_WORDS], // set bit = slot in use
+}
+
+pub struct SpanAlloc {
+    spans: Vec<Span>,
+    // span indices with at least one free slot, per class
+    partial: [Vec<usize>; CLASSES],
+    // span base address -> index into `spans`, for dealloc lookup
+    by_base: BTreeMap<usize, usize>,
+}
+
+#[inline]
+fn class_of(size: usize) -> Option<(usize, usize)> {
+    if size == 0 || size > MAX_CLASS_SIZE {
+        return None;
+    }
+    let class_size = size.next_power_of_two().max(MIN_CLASS_SIZE);
+    let class = (class_size / MIN_CLASS_SIZE).trailing_zeros() as usize;
+    Some((class, class_size))
+}
+
+impl SpanAlloc {
+    pub fn new() -> SpanAlloc {
+        SpanAlloc {
+            spans: Vec::new(),
+            partial: Default::default(),
+            by_base: BTreeMap::new(),
+        }
+    }
+
+    /// Bytes currently held in spans (capacity, not live objects).
+    pub fn capacity(&self) -> usize {
+        self.spans.len() * SPAN_SIZE
+    }
+
+    /// Allocate `size` bytes. Returns null when `size` is out of the
+    /// class range or a new span cannot be taken from the heap; the
+    /// caller should then use its normal path.
+    pub fn alloc(&mut self, size: usize) -> *mut u8 {
+        let (class, class_size) = match class_of(size) {
+            Some(c) => c,
+            None => return ptr::null_mut(),
+        };
+
+        let idx = match self.partial[class].last() {
+            Some(&idx) => idx,
+            None => match self.grow(class, class_size) {
+                Some(idx) => idx,
+                None => return ptr::null_mut(),
+            },
+        };
+
+        let span = &mut self.spans[idx];
+        let slot = span
+            .bitmap
+            .iter()
+            .enumerate()
+            .find_map(|(w, &bits)| {
+                if bits != u64::MAX {
+                    Some(w * 64 + (!bits).trailing_zeros() as usize)
+                } else {
+                    None
+                }
+            })
+            .filter(|&slot| slot < span.objects);
+        let slot = match slot {
+            Some(s) => s,
+            None => return ptr::null_mut(), // partial list out of sync; should not happen
+        };
+
+        span.bitmap[slot / 64] |= 1 << (slot % 64);
+        span.live += 1;
+        if span.live == span.objects {
+            self.partial[class].pop();
+        }
+        unsafe { span.base.add(slot * class_size) }
+    }
+
+    /// Free an object previously returned by [`alloc`] with the same
+    /// `size`. Freeing a pointer this allocator did not hand out is a
+    /// logic error and is ignored.
+    ///
+    /// [`alloc`]: SpanAlloc::alloc
+    pub fn dealloc(&mut self, p: *mut u8, size: usize) {
+        let (class, class_size) = match class_of(size) {
+            Some(c) => c,
+            None => return,
+        };
+        let addr = p as usize;
+        let idx = match self.by_base.range(..=addr).next_back() {
+            Some((&base, &idx)) if addr < base + SPAN_SIZE => idx,
+            _ => return,
+        };
+        let span = &mut self.spans[idx];
+        if span.class != class {
+            return;
+        }
+        let offset = addr - span.base as usize;
+        if offset % class_size != 0 {
+            return;
+        }
+        let slot = offset / class_size;
+        let mask = 1_u64 << (slot % 64);
+        if span.bitmap[slot / 64] & mask == 0 {
+            return; // double free
+        }
+        span.bitmap[slot / 64] &= !mask;
+        span.live -= 1;
+        if span.live + 1 == span.objects {
+            self.partial[class].push(idx);
+        }
+    }
+
+    /// Return every fully-free span to the heap. Spans with any live
+    /// object are kept; this is the EWB-friendly trim point for phases
+    /// that have drained.
+    pub fn trim(&mut self) {
+        let mut idx = 0;
+        while idx < self.spans.len() {
+            if self.spans[idx].live != 0 {
+                idx += 1;
+                continue;
+            }
+            let span = self.spans.swap_remove(idx);
+            self.by_base.remove(&(span.base as usize));
+            for list in self.partial.iter_mut() {
+                list.retain(|&i| i != idx && i != self.spans.len());
+            }
+            // the span that was swapped into `idx` changed index
+            if idx < self.spans.len() {
+                let moved_base = self.spans[idx].base as usize;
+                self.by_base.insert(moved_base, idx);
+                let moved_class = self.spans[idx].class;
+                if self.spans[idx].live < self.spans[idx].objects {
+                    self.partial[moved_class].push(idx);
+                }
+            }
+            unsafe { libc::free(span.base as *mut c_void) };
+        }
+    }
+
+    fn grow(&mut self, class: usize, class_size: usize) -> Option<usize> {
+        let base = unsafe { libc::memalign(PAGE_SIZE, SPAN_SIZE) as *mut u8 };
+        if base.is_null() {
+            return None;
+        }
+        let idx = self.spans.len();
+        self.spans.push(Span {
+            base,
+            class,
+            objects: SPAN_SIZE / class_size,
+            live: 0,
+            bitmap: [0; BITMAP_WORDS],
+        });
+        self.by_base.insert(base as usize, idx);
+        self.partial[class].push(idx);
+        Some(idx)
+    }
+}
+
+impl Default for SpanAlloc {
+    fn default() -> SpanAlloc {
+        SpanAlloc::new()
+    }
+}
+
+impl Drop for SpanAlloc {
+    fn drop(&mut self) {
+        for span in self.spans.drain(..) {
+            unsafe { libc::free(span.base as *mut c_void) };
+        }
+    }
+}
@@ -0,0 +1,241 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License..
+
+//! Allocator statistics for the in-enclave heap.
+//!
+//! EPC exhaustion used to announce itself only by killing the service;
+//! this module gives the enclave a live view of its own heap instead.
+//! When enabled, every allocation through [`System`](crate::System)
+//! updates bytes-in-use, a peak watermark and a power-of-two size-class
+//! histogram, all with relaxed atomics on the hot path and nothing at
+//! all when disabled. [`snapshot`] copies the counters into a plain
+//! `repr(C)` struct, so an application ecall can hand them out of the
+//! enclave verbatim.
+//!
+//! Call-site attribution is sampled through an application-provided
+//! hook ([`set_sample_hook`]): every `interval`-th allocation invokes
+//! it with the request size, and the hook typically captures a raw
+//! backtrace. The hook lives on the application side because sgx_alloc
+//! sits below sgx_backtrace in the crate graph and cannot call it
+//! directly.
+//!
+//! Enabling mid-run is allowed; frees of allocations made while
+//! disabled then underflow bytes-in-use, which saturates at zero, so
+//! the gauge converges as old allocations drain.
+
+use core::mem;
+use core::sync::atomic::{AtomicBool, AtomicU64, AtomicUsize, Ordering};
+
+/// Number of power-of-two size classes; class `i` covers sizes in
+/// `(2^(i-1), 2^i]`, with the last class absorbing everything larger.
+pub const NUM_SIZE_CLASSES: usize = 32;
+
+/// A point-in-time copy of the allocator counters, laid out for
+/// crossing the enclave boundary through an application ecall.
+#[repr(C)]
+#[derive(Clone, Copy)]
+pub struct AllocStats {
+    pub in_use_bytes: u64,
+    pub peak_bytes: u64,
+    pub alloc_count: u64,
+    pub dealloc_count: u64,
+    pub realloc_count: u64,
+    pub failed_count: u64,
+    pub class_allocs: [u64; NUM_SIZE_CLASSES],
+    pub class_frees: [u64; NUM_SIZE_CLASSES],
+}
+
+/// Signature of the sampled call-site attribution hook. Invoked with
+/// the size of the sampled allocation request; must not allocate more
+/// than it can afford to re-enter on.
+pub type AllocSampleHook = fn(size: usize);
+
+static ENABLED: AtomicBool = AtomicBool::new(false);
+static IN_USE: AtomicUsize = AtomicUsize::new(0);
+static PEAK: AtomicUsize = AtomicUsize::new(0);
+static ALLOC_COUNT: AtomicU64 = AtomicU64::new(0);
+static DEALLOC_COUNT: AtomicU64 = AtomicU64::new(0);
+static REALLOC_COUNT: AtomicU64 = AtomicU64::new(0);
+static FAILED_COUNT: AtomicU64 = AtomicU64::new(0);
+
+const COUNTER_INIT: AtomicU64 = AtomicU64::new(0);
+static CLASS_ALLOCS: [AtomicU64; NUM_SIZE_CLASSES] = [
+    COUNTER_INIT, COUNTER_INIT, COUNTER_INIT, COUNTER_INIT,
+    COUNTER_INIT, COUNTER_INIT, COUNTER_INIT, COUNTER_INIT,
+    COUNTER_INIT, COUNTER_INIT, COUNTER_INIT, COUNTER_INIT,
+    COUNTER_INIT, COUNTER_INIT, COUNTER_INIT, COUNTER_INIT,
+    COUNTER_INIT, COUNTER_INIT, COUNTER_INIT, COUNTER_INIT,
+    COUNTER_INIT, COUNTER_INIT, COUNTER_INIT, COUNTER_INIT,
+    COUNTER_INIT, COUNTER_INIT, COUNTER_INIT, COUNTER_INIT,
+    COUNTER_INIT, COUNTER_INIT, COUNTER_INIT, COUNTER_INIT,
+];
+static CLASS_FREES: [AtomicU64; NUM_SIZE_CLASSES] = [
+    COUNTER_INIT, COUNTER_INIT, COUNTER_INIT, COUNTER_INIT,
+    COUNTER_INIT, COUNTER_INIT, COUNTER_INIT, COUNTER_INIT,
+    COUNTER_INIT, COUNTER_INIT, COUNTER_INIT, COUNTER_INIT,
+    COUNTER_INIT, COUNTER_INIT, COUNTER_INIT, COUNTER_INIT,
+    COUNTER_INIT, COUNTER_INIT, COUNTER_INIT, COUNTER_INIT,
+    COUNTER_INIT, COUNTER_INIT, COUNTER_INIT, COUNTER_INIT,
+    COUNTER_INIT, COUNTER_INIT, COUNTER_INIT, COUNTER_INIT,
+    COUNTER_INIT, COUNTER_INIT, COUNTER_INIT, COUNTER_INIT,
+];
+
+static SAMPLE_INTERVAL: AtomicUsize = AtomicUsize::new(0);
+static SAMPLE_COUNTDOWN: AtomicUsize = AtomicUsize::new(0);
+static SAMPLE_HOOK: AtomicUsize = AtomicUsize::new(0);
+
+#[inline]
+fn size_class(size: usize) -> usize {
+    if size <= 1 {
+        return 0;
+    }
+    let class = mem::size_of::<usize>() * 8 - (size - 1).leading_zeros() as usize;
+    if class < NUM_SIZE_CLASSES {
+        class
+    } else {
+        NUM_SIZE_CLASSES - 1
+    }
+}
+
+/// Turn recording on or off. Off (the default) costs one relaxed load
+/// per allocator call.
+pub fn enable(on: bool) {
+    ENABLED.store(on, Ordering::Relaxed);
+}
+
+/// Install (or clear, with `None`) the sampled call-site hook: every
+/// `interval`-th recorded allocation invokes it. An interval of zero
+/// disables sampling.
+pub fn set_sample_hook(interval: usize, hook: Option<AllocSampleHook>) {
+    match hook {
+        Some(f) => {
+            SAMPLE_HOOK.store(f as usize, Ordering::Relaxed);
+            SAMPLE_COUNTDOWN.store(interval, Ordering::Relaxed);
+            SAMPLE_INTERVAL.store(interval, Ordering::Relaxed);
+        }
+        None => {
+            SAMPLE_INTERVAL.store(0, Ordering::Relaxed);
+            SAMPLE_HOOK.store(0, Ordering::Relaxed);
+        }
+    }
+}
+
+/// Copy the current counters. The copy is not atomic as a whole; each
+/// field is a consistent relaxed read.
+pub fn snapshot() -> AllocStats {
+    let mut stats = AllocStats {
+        in_use_bytes: IN_USE.load(Ordering::Relaxed) as u64,
+        peak_bytes: PEAK.load(Ordering::Relaxed) as u64,
+        alloc_count: ALLOC_COUNT.load(Ordering::Relaxed),
+        dealloc_count: DEALLOC_COUNT.load(Ordering::Relaxed),
+        realloc_count: REALLOC_COUNT.load(Ordering::Relaxed),
+        failed_count: FAILED_COUNT.load(Ordering::Relaxed),
+        class_allocs: [0; NUM_SIZE_CLASSES],
+        class_frees: [0; NUM_SIZE_CLASSES],
+    };
+    for i in 0..NUM_SIZE_CLASSES {
+        stats.class_allocs[i] = CLASS_ALLOCS[i].load(Ordering::Relaxed);
+        stats.class_frees[i] = CLASS_FREES[i].load(Ordering::Relaxed);
+    }
+    stats
+}
+
+/// Zero every counter, including the peak watermark.
+pub fn reset() {
+    IN_USE.store(0, Ordering::Relaxed);
+    PEAK.store(0, Ordering::Relaxed);
+    ALLOC_COUNT.store(0, Ordering::Relaxed);
+    DEALLOC_COUNT.store(0, Ordering::Relaxed);
+    REALLOC_COUNT.store(0, Ordering::Relaxed);
+    FAILED_COUNT.store(0, Ordering::Relaxed);
+    for i in 0..NUM_SIZE_CLASSES {
+        CLASS_ALLOCS[i].store(0, Ordering::Relaxed);
+        CLASS_FREES[i].store(0, Ordering::Relaxed);
+    }
+}
+
+#[inline]
+fn charge(size: usize) {
+    let in_use = IN_USE.fetch_add(size, Ordering::Relaxed) + size;
+    PEAK.fetch_max(in_use, Ordering::Relaxed);
+}
+
+#[inline]
+fn discharge(size: usize) {
+    let _ = IN_USE.fetch_update(Ordering::Relaxed, Ordering::Relaxed, |v| {
+        Some(v.saturating_sub(size))
+    });
+}
+
+#[inline]
+fn maybe_sample(size: usize) {
+    let interval = SAMPLE_INTERVAL.load(Ordering::Relaxed);
+    if interval == 0 {
+        return;
+    }
+    if SAMPLE_COUNTDOWN.fetch_sub(1, Ordering::Relaxed) != 1 {
+        return;
+    }
+    SAMPLE_COUNTDOWN.store(interval, Ordering::Relaxed);
+    let hook = SAMPLE_HOOK.load(Ordering::Relaxed);
+    if hook != 0 {
+        let hook: AllocSampleHook = unsafe { mem::transmute(hook) };
+        hook(size);
+    }
+}
+
+#[inline]
+pub(crate) fn record_alloc(size: usize, ok: bool) {
+    if !ENABLED.load(Ordering::Relaxed) {
+        return;
+    }
+    if !ok {
+        FAILED_COUNT.fetch_add(1, Ordering::Relaxed);
+        return;
+    }
+    ALLOC_COUNT.fetch_add(1, Ordering::Relaxed);
+    CLASS_ALLOCS[size_class(size)].fetch_add(1, Ordering::Relaxed);
+    charge(size);
+    maybe_sample(size);
+}
+
+#[inline]
+pub(crate) fn record_dealloc(size: usize) {
+    if !ENABLED.load(Ordering::Relaxed) {
+        return;
+    }
+    DEALLOC_COUNT.fetch_add(1, Ordering::Relaxed);
+    CLASS_FREES[size_class(size)].fetch_add(1, Ordering::Relaxed);
+    discharge(size);
+}
+
+#[inline]
+pub(crate) fn record_realloc(old_size: usize, new_size: usize, ok: bool) {
+    if !ENABLED.load(Ordering::Relaxed) {
+        return;
+    }
+    if !ok {
+        FAILED_COUNT.fetch_add(1, Ordering::Relaxed);
+        return;
+    }
+    REALLOC_COUNT.fetch_add(1, Ordering::Relaxed);
+    CLASS_FREES[size_class(old_size)].fetch_add(1, Ordering::Relaxed);
+    CLASS_ALLOCS[size_class(new_size)].fetch_add(1, Ordering::Relaxed);
+    discharge(old_size);
+    charge(new_size);
+    maybe_sample(new_size);
+}
@@ -254,18 +254,26 @@ mod platform {
     unsafe impl GlobalAlloc for System {
         #[inline]
         unsafe fn alloc(&self, layout: Layout) -> *mut u8 {
-            if layout.align() <= MIN_ALIGN && layout.align() <= layout.size() {
-                libc::malloc(layout.size()) as *mut u8
+            let ptr = if layout.align() <= MIN_ALIGN && layout.align() <= layout.size() {
+                match crate::tcache::alloc(layout.size()) {
+                    Some(p) => p,
+                    None => libc::malloc(layout.size()) as *mut u8,
+                }
             } else {
                 aligned_malloc(&layout)
-            }
+            };
+            crate::stats::record_alloc(layout.size(), !ptr.is_null());
+            ptr
         }
 
         #[inline]
         unsafe fn alloc_zeroed(&self, layout: Layout) -> *mut u8 {
             if layout.align() <= MIN_ALIGN && layout.align() <= layout.size() {
-                libc::calloc(layout.size(), 1) as *mut u8
+                let ptr = libc::calloc(layout.size(), 1) as *mut u8;
+                crate::stats::record_alloc(layout.size(), !ptr.is_null());
+                ptr
             } else {
+                // The nested GlobalAlloc::alloc records this request.
                 let ptr = GlobalAlloc::alloc(self, layout);
                 if !ptr.is_null() {
                     ptr::write_bytes(ptr, 0, layout.size());
@@ -275,15 +283,24 @@ mod platform {
         }
 
         #[inline]
-        unsafe fn dealloc(&self, ptr: *mut u8, _layout: Layout) {
-            libc::free(ptr as *mut c_void)
+        unsafe fn dealloc(&self, ptr: *mut u8, layout: Layout) {
+            if !(layout.align() <= MIN_ALIGN
+                && layout.align() <= layout.size()
+                && crate::tcache::dealloc(ptr, layout.size()))
+            {
+                libc::free(ptr as *mut c_void);
+            }
+            crate::stats::record_dealloc(layout.size());
         }
 
         #[inline]
         unsafe fn realloc(&self, ptr: *mut u8, layout: Layout, new_size: usize) -> *mut u8 {
             if layout.align() <= MIN_ALIGN && layout.align() <= new_size {
-                libc::realloc(ptr as *mut c_void, new_size) as *mut u8
+                let new_ptr = libc::realloc(ptr as *mut c_void, new_size) as *mut u8;
+                crate::stats::record_realloc(layout.size(), new_size, !new_ptr.is_null());
+                new_ptr
             } else {
+                // The fallback's alloc/dealloc pair records the move.
                 self.realloc_fallback(ptr, layout, new_size)
             }
         }
@@ -295,7 +312,7 @@ mod platform {
     }
 }
 
-mod libc {
+pub(crate) mod libc {
     use core::ffi::c_void;
     type size_t = usize;
     extern "C" {
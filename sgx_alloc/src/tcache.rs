@@ -0,0 +1,120 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License..
+
+//! Per-TCS front-end cache for small allocations.
+//!
+//! The tlibc heap serializes every allocation behind one lock, which
+//! multi-TCS services feel as soon as request handlers allocate in
+//! bursts. When enabled, small blocks recycle through a per-thread
+//! (`#[thread_local]`, i.e. per-TCS) free list keyed by power-of-two
+//! size class, so the steady-state malloc/free pairs of a request
+//! never touch the shared heap at all.
+//!
+//! Safety of reuse relies on provenance: a block is only pushed into a
+//! class list when its freed size equals the class size exactly, since
+//! only then is the underlying allocation guaranteed to be at least
+//! class-sized no matter when it was made. Requests between class
+//! sizes are still served from the cache (the cached block is larger),
+//! they just never repopulate it. Off by default; a thread that stops
+//! allocating can return its cached blocks with [`flush`]. TCSs are
+//! pooled and reused, so a populated cache is capital, not a leak.
+
+use core::ptr;
+use core::sync::atomic::{AtomicBool, Ordering};
+use crate::system::libc;
+
+/// Largest request served by the cache.
+pub const MAX_CACHED_SIZE: usize = 2048;
+
+// Classes 8, 16, 32, ..., 2048.
+const CLASSES: usize = 9;
+const SLOTS_PER_CLASS: usize = 32;
+
+static ENABLED: AtomicBool = AtomicBool::new(false);
+
+#[thread_local]
+static mut CACHE_SLOTS: [[*mut u8; SLOTS_PER_CLASS]; CLASSES] =
+    [[ptr::null_mut(); SLOTS_PER_CLASS]; CLASSES];
+#[thread_local]
+static mut CACHE_COUNTS: [usize; CLASSES] = [0; CLASSES];
+
+/// Turn the per-thread cache on or off. Turning it off strands blocks
+/// already cached by other threads until they call [`flush`].
+pub fn enable(on: bool) {
+    ENABLED.store(on, Ordering::Relaxed);
+}
+
+/// Return every block cached by the calling thread to the shared heap.
+pub fn flush() {
+    unsafe {
+        for class in 0..CLASSES {
+            while CACHE_COUNTS[class] > 0 {
+                CACHE_COUNTS[class] -= 1;
+                let p = CACHE_SLOTS[class][CACHE_COUNTS[class]];
+                libc::free(p as *mut core::ffi::c_void);
+            }
+        }
+    }
+}
+
+#[inline]
+fn class_of(size: usize) -> (usize, usize) {
+    if size <= 8 {
+        return (0, 8);
+    }
+    let log = core::mem::size_of::<usize>() * 8 - (size - 1).leading_zeros() as usize;
+    (log - 3, 1 << log)
+}
+
+/// Serve a small request from the calling thread's cache, falling back
+/// to a class-sized block from the shared heap so the block can later
+/// repopulate the cache. Returns `None` when the cache does not apply
+/// and the caller should take its normal path.
+#[inline]
+pub(crate) unsafe fn alloc(size: usize) -> Option<*mut u8> {
+    if size == 0 || size > MAX_CACHED_SIZE || !ENABLED.load(Ordering::Relaxed) {
+        return None;
+    }
+    let (class, class_size) = class_of(size);
+    if CACHE_COUNTS[class] > 0 {
+        CACHE_COUNTS[class] -= 1;
+        return Some(CACHE_SLOTS[class][CACHE_COUNTS[class]]);
+    }
+    let p = libc::malloc(class_size) as *mut u8;
+    if p.is_null() {
+        None
+    } else {
+        Some(p)
+    }
+}
+
+/// Try to cache a freed block. Returns `false` when the block must be
+/// freed normally: cache off, size out of range, unknown provenance
+/// (freed size is not an exact class size) or class list full.
+#[inline]
+pub(crate) unsafe fn dealloc(p: *mut u8, size: usize) -> bool {
+    if size == 0 || size > MAX_CACHED_SIZE || !ENABLED.load(Ordering::Relaxed) {
+        return false;
+    }
+    let (class, class_size) = class_of(size);
+    if size != class_size || CACHE_COUNTS[class] >= SLOTS_PER_CLASS {
+        return false;
+    }
+    CACHE_SLOTS[class][CACHE_COUNTS[class]] = p;
+    CACHE_COUNTS[class] += 1;
+    true
+}
@@ -17,11 +17,39 @@
 
 use crate::PrintFmt;
 use crate::{resolve, resolve_frame, trace, BacktraceFmt, Symbol, SymbolName};
+use std::collections::HashMap;
 use std::path::{Path, PathBuf};
 use std::prelude::v1::*;
+use std::sync::{Once, SgxMutex};
 use core::ffi::c_void;
 use core::fmt;
 
+// Cache of resolved symbols keyed by instruction pointer. Error
+// telemetry resolves the same handful of frames over and over; a hit
+// skips both the symbol table walk and the demangling pass. Bounded so
+// a pathological address stream cannot grow it without limit.
+const SYMBOL_CACHE_MAX: usize = 4096;
+
+static SYMBOL_CACHE_INIT: Once = Once::new();
+static mut SYMBOL_CACHE: Option<SgxMutex<HashMap<usize, Vec<BacktraceSymbol>>>> = None;
+
+fn symbol_cache() -> &'static SgxMutex<HashMap<usize, Vec<BacktraceSymbol>>> {
+    unsafe {
+        SYMBOL_CACHE_INIT.call_once(|| {
+            SYMBOL_CACHE = Some(SgxMutex::new(HashMap::new()));
+        });
+        SYMBOL_CACHE.as_ref().unwrap()
+    }
+}
+
+/// Clears the address-keyed cache of resolved symbols, releasing its
+/// memory. Resolution transparently repopulates it.
+pub fn clear_resolved_symbol_cache() {
+    if let Ok(mut cache) = symbol_cache().lock() {
+        cache.clear();
+    }
+}
+
 /// Representation of an owned and self-contained backtrace.
 ///
 /// This structure can be used to capture a backtrace at various points in a
@@ -170,6 +198,47 @@ impl Backtrace {
         Self::create(Self::new_unresolved as usize)
     }
 
+    /// Captures raw program counters only, without the global trace
+    /// lock and without retaining unwinder frame state.
+    ///
+    /// This is the cheapest capture this crate offers and is intended
+    /// for high-volume contextual backtraces on error paths: collection
+    /// is a plain stack walk storing one address per frame. Symbol
+    /// names appear once `resolve` is called, which symbolizes by
+    /// address and hits the resolved-symbol cache for repeat frames.
+    ///
+    /// # Required features
+    ///
+    /// This function requires the `std` feature of the `backtrace` crate to be
+    /// enabled, and the `std` feature is enabled by default.
+    #[inline(never)] // want to make sure there's a frame here to remove
+    pub fn new_raw() -> Backtrace {
+        let ip = Self::new_raw as usize;
+        let mut frames = Vec::with_capacity(32);
+        let mut actual_start_index = None;
+        // Walking only the calling thread's own stack is safe without
+        // the crate lock.
+        unsafe {
+            crate::trace_unsynchronized(|frame| {
+                frames.push(BacktraceFrame {
+                    frame: Frame::Deserialized {
+                        ip: frame.ip() as usize,
+                        symbol_address: frame.symbol_address() as usize,
+                    },
+                    symbols: None,
+                });
+                if frame.symbol_address() as usize == ip && actual_start_index.is_none() {
+                    actual_start_index = Some(frames.len());
+                }
+                true
+            });
+        }
+        Backtrace {
+            frames,
+            actual_start_index: actual_start_index.unwrap_or(0),
+        }
+    }
+
     fn create(ip: usize) -> Backtrace {
         let mut frames = Vec::new();
         let mut actual_start_index = None;
@@ -217,6 +286,13 @@ impl Backtrace {
     /// enabled, and the `std` feature is enabled by default.
     pub fn resolve(&mut self) {
         for frame in self.frames.iter_mut().filter(|f| f.symbols.is_none()) {
+            let ip = frame.frame.ip() as usize;
+            if let Ok(cache) = symbol_cache().lock() {
+                if let Some(symbols) = cache.get(&ip) {
+                    frame.symbols = Some(symbols.clone());
+                    continue;
+                }
+            }
             let mut symbols = Vec::new();
             {
                 let sym = |symbol: &Symbol| {
@@ -234,6 +310,11 @@ impl Backtrace {
                     }
                 }
             }
+            if let Ok(mut cache) = symbol_cache().lock() {
+                if cache.len() < SYMBOL_CACHE_MAX {
+                    cache.insert(ip, symbols.clone());
+                }
+            }
             frame.symbols = Some(symbols);
         }
     }
@@ -130,8 +130,9 @@ cfg_if! {
     if #[cfg(feature = "std")] {
         pub use crate::backtrace::trace;
         pub use crate::symbolize::{resolve, resolve_frame};
-        pub use crate::capture::{Backtrace, BacktraceFrame, BacktraceSymbol};
+        pub use crate::capture::{clear_resolved_symbol_cache, Backtrace, BacktraceFrame, BacktraceSymbol};
         mod capture;
+        pub mod profiler;
     }
 }
 
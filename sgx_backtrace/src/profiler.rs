@@ -0,0 +1,258 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License..
+
+//! A sampling profiler for production enclaves.
+//!
+//! An interrupt (AEX) that kicks a thread out of the enclave cannot hand
+//! the interrupted enclave stack to a host-side handler, and the signal
+//! ecall that follows runs on a fresh TCS, so a conventional SIGPROF
+//! profiler only ever sees its own delivery frames. This module instead
+//! samples cooperatively: worker threads drop [`maybe_sample`] at natural
+//! safepoints (request loop headers, batch boundaries), and the call is
+//! two relaxed loads plus a coarse-clock read -- transition-free -- until
+//! the sampling deadline passes. When it does, the calling thread walks
+//! its own stack with the crate's unwinder and publishes the frames into
+//! a preallocated lock-free ring.
+//!
+//! Samples carry raw instruction pointers; symbolize offline against the
+//! signed enclave image. [`dump_folded`] emits collapsed stacks in the
+//! `frame;frame;frame count` form flamegraph tooling consumes.
+//!
+//! ```no_run
+//! sgx_backtrace::profiler::start(10, 4096);
+//! loop {
+//!     sgx_backtrace::profiler::maybe_sample();
+//!     // handle one request ...
+//! }
+//! ```
+
+use alloc::boxed::Box;
+use alloc::collections::BTreeMap;
+use alloc::vec::Vec;
+use core::mem;
+use core::ptr;
+use core::sync::atomic::{AtomicBool, AtomicPtr, AtomicU64, AtomicUsize, Ordering};
+use sgx_libc::ocall::clock_gettime_coarse;
+use sgx_libc::{timespec, CLOCK_MONOTONIC};
+use std::string::String;
+
+/// Deepest stack recorded per sample; deeper frames are truncated.
+pub const MAX_FRAMES: usize = 32;
+
+const DEFAULT_RING_SLOTS: usize = 4096;
+
+/// One captured stack sample. `frames[..depth]` holds instruction
+/// pointers ordered leaf-first.
+#[derive(Clone, Copy)]
+pub struct Sample {
+    pub timestamp_ns: u64,
+    pub thread: usize,
+    pub depth: usize,
+    pub frames: [usize; MAX_FRAMES],
+}
+
+static ENABLED: AtomicBool = AtomicBool::new(false);
+static INTERVAL_NS: AtomicU64 = AtomicU64::new(0);
+static NEXT_DEADLINE_NS: AtomicU64 = AtomicU64::new(0);
+static DROPPED: AtomicU64 = AtomicU64::new(0);
+
+// The ring is allocated once on the first `start` and never freed, so a
+// publishing thread can never race a reallocation. Slots are reserved
+// with a bounded CAS on `head`; `ready` flags let the drainer wait out
+// a publisher that reserved a slot but has not finished writing it.
+static RING: AtomicPtr<Sample> = AtomicPtr::new(ptr::null_mut());
+static RING_READY: AtomicPtr<AtomicBool> = AtomicPtr::new(ptr::null_mut());
+static RING_CAP: AtomicUsize = AtomicUsize::new(0);
+static RING_HEAD: AtomicUsize = AtomicUsize::new(0);
+static RING_TAIL: AtomicUsize = AtomicUsize::new(0);
+static DRAINING: AtomicBool = AtomicBool::new(false);
+
+fn now_ns() -> u64 {
+    let mut tp: timespec = unsafe { mem::zeroed() };
+    if unsafe { clock_gettime_coarse(CLOCK_MONOTONIC, &mut tp) } != 0 {
+        return 0;
+    }
+    tp.tv_sec as u64 * 1_000_000_000 + tp.tv_nsec as u64
+}
+
+/// Start sampling: one sample is taken per `interval_ms` across all
+/// participating threads. `capacity` bounds the ring (rounded up to a
+/// power of two); it is allocated here, before sampling begins, and
+/// reused as-is by later `start` calls.
+pub fn start(interval_ms: u64, capacity: usize) {
+    if RING.load(Ordering::Acquire).is_null() {
+        let cap = if capacity == 0 {
+            DEFAULT_RING_SLOTS
+        } else {
+            capacity.next_power_of_two()
+        };
+        let mut slots: Vec<Sample> = Vec::with_capacity(cap);
+        slots.resize(
+            cap,
+            Sample {
+                timestamp_ns: 0,
+                thread: 0,
+                depth: 0,
+                frames: [0; MAX_FRAMES],
+            },
+        );
+        let mut ready: Vec<AtomicBool> = Vec::with_capacity(cap);
+        for _ in 0..cap {
+            ready.push(AtomicBool::new(false));
+        }
+        let slots = Box::leak(slots.into_boxed_slice());
+        let ready = Box::leak(ready.into_boxed_slice());
+        RING_READY.store(ready.as_mut_ptr(), Ordering::Release);
+        RING_CAP.store(cap, Ordering::Release);
+        RING.store(slots.as_mut_ptr(), Ordering::Release);
+    }
+    let interval = interval_ms.max(1) * 1_000_000;
+    INTERVAL_NS.store(interval, Ordering::Relaxed);
+    NEXT_DEADLINE_NS.store(now_ns() + interval, Ordering::Relaxed);
+    ENABLED.store(true, Ordering::Release);
+}
+
+/// Stop sampling. Already-collected samples stay in the ring for
+/// [`drain`] or [`dump_folded`].
+pub fn stop() {
+    ENABLED.store(false, Ordering::Release);
+}
+
+/// Samples dropped because the ring was full when they were captured.
+pub fn dropped() -> u64 {
+    DROPPED.load(Ordering::Relaxed)
+}
+
+/// The sampling safepoint. Nearly free while the deadline has not
+/// passed; at most one thread wins the deadline CAS per interval and
+/// pays for a stack walk. Returns `true` if this call took a sample.
+pub fn maybe_sample() -> bool {
+    if !ENABLED.load(Ordering::Relaxed) {
+        return false;
+    }
+    let now = now_ns();
+    let deadline = NEXT_DEADLINE_NS.load(Ordering::Relaxed);
+    if now < deadline {
+        return false;
+    }
+    let interval = INTERVAL_NS.load(Ordering::Relaxed);
+    if NEXT_DEADLINE_NS.compare_and_swap(deadline, now + interval, Ordering::Relaxed) != deadline {
+        // Another thread owns this interval's sample.
+        return false;
+    }
+    sample_now();
+    true
+}
+
+/// Capture the calling thread's stack unconditionally.
+pub fn sample_now() {
+    let ring = RING.load(Ordering::Acquire);
+    if ring.is_null() {
+        return;
+    }
+    let cap = RING_CAP.load(Ordering::Relaxed);
+    let ready = RING_READY.load(Ordering::Relaxed);
+
+    let mut sample = Sample {
+        timestamp_ns: now_ns(),
+        thread: std::thread::rsgx_thread_self() as usize,
+        depth: 0,
+        frames: [0; MAX_FRAMES],
+    };
+    // The unsynchronized walk keeps concurrent samplers from
+    // serializing on the crate lock; each thread only walks itself.
+    unsafe {
+        crate::trace_unsynchronized(|frame| {
+            if sample.depth < MAX_FRAMES {
+                sample.frames[sample.depth] = frame.ip() as usize;
+                sample.depth += 1;
+                true
+            } else {
+                false
+            }
+        });
+    }
+
+    let mut head;
+    loop {
+        head = RING_HEAD.load(Ordering::Acquire);
+        if head.wrapping_sub(RING_TAIL.load(Ordering::Acquire)) >= cap {
+            DROPPED.fetch_add(1, Ordering::Relaxed);
+            return;
+        }
+        if RING_HEAD.compare_and_swap(head, head.wrapping_add(1), Ordering::AcqRel) == head {
+            break;
+        }
+    }
+    unsafe {
+        ptr::write(ring.add(head & (cap - 1)), sample);
+        (*ready.add(head & (cap - 1))).store(true, Ordering::Release);
+    }
+}
+
+/// Consume every published sample, oldest first. One drainer runs at a
+/// time; a second concurrent call returns without yielding anything.
+pub fn drain<F: FnMut(&Sample)>(mut f: F) {
+    let ring = RING.load(Ordering::Acquire);
+    if ring.is_null() || DRAINING.compare_and_swap(false, true, Ordering::Acquire) {
+        return;
+    }
+    let cap = RING_CAP.load(Ordering::Relaxed);
+    let ready = RING_READY.load(Ordering::Relaxed);
+    loop {
+        let tail = RING_TAIL.load(Ordering::Relaxed);
+        if tail == RING_HEAD.load(Ordering::Acquire) {
+            break;
+        }
+        let slot_ready = unsafe { &*ready.add(tail & (cap - 1)) };
+        // The publisher reserved this slot but may still be writing it.
+        while !slot_ready.load(Ordering::Acquire) {
+            core::sync::atomic::spin_loop_hint();
+        }
+        let sample = unsafe { ptr::read(ring.add(tail & (cap - 1))) };
+        slot_ready.store(false, Ordering::Release);
+        RING_TAIL.store(tail.wrapping_add(1), Ordering::Release);
+        f(&sample);
+    }
+    DRAINING.store(false, Ordering::Release);
+}
+
+/// Drain the ring into collapsed-stack form: one line per distinct
+/// stack, root-first frames joined by `;`, a space, then the sample
+/// count. Frames are raw hex addresses for offline symbolization
+/// against the signed enclave image.
+pub fn dump_folded() -> String {
+    let mut stacks: BTreeMap<Vec<usize>, u64> = BTreeMap::new();
+    drain(|sample| {
+        let mut frames: Vec<usize> = sample.frames[..sample.depth].to_vec();
+        frames.reverse();
+        *stacks.entry(frames).or_insert(0) += 1;
+    });
+    let mut out = String::new();
+    for (frames, count) in stacks {
+        let mut first = true;
+        for ip in frames {
+            if !first {
+                out.push(';');
+            }
+            out.push_str(&format!("{:#x}", ip));
+            first = false;
+        }
+        out.push_str(&format!(" {}\n", count));
+    }
+    out
+}
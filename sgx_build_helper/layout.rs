@@ -0,0 +1,238 @@
+// Copyright 2015 The Rust Project Developers. See the COPYRIGHT
+// file at the top-level directory of this distribution and at
+// http://rust-lang.org/COPYRIGHT.
+//
+// Licensed under the Apache License, Version 2.0 <LICENSE-APACHE or
+// http://www.apache.org/licenses/LICENSE-2.0> or the MIT license
+// <LICENSE-MIT or http://opensource.org/licenses/MIT>, at your
+// option. This file may not be copied, modified, or distributed
+// except according to those terms.
+
+//! Profile-guided function layout for enclave images.
+//!
+//! Enclave code pages are pulled into EPC on first touch, so an image
+//! whose hot functions are scattered across the .text section faults in
+//! far more pages than the hot working set needs. This module turns a
+//! collapsed-stack profile (the `sgx_backtrace::profiler::dump_folded`
+//! output: hex frame addresses joined by `;`, a space, a sample count)
+//! into a link-time ordering that packs hot functions contiguously at
+//! the front of .text.
+//!
+//! Pipeline, typically run from an enclave's build.rs or a Makefile
+//! step:
+//!
+//! 1. [`SymbolTable::from_object`] reads the unstripped enclave .so via
+//!    `nm`.
+//! 2. [`rank_hot_functions`] resolves the profile's frame addresses
+//!    (minus the enclave load base the profile was taken at) to symbols
+//!    and ranks them by sample weight.
+//! 3. [`write_symbol_order_file`] emits one symbol per line for
+//!    `-Wl,--symbol-ordering-file=` (lld), or
+//!    [`write_hot_text_section_list`] emits the equivalent ordered
+//!    `*(.text.<sym>)` input-section list to splice into the enclave's
+//!    linker script ahead of its catch-all `*(.text*)` (GNU ld with
+//!    function sections, which rustc emits by default).
+//!
+//! The ordering is purely a layout hint: a stale or missing profile
+//! changes nothing but page-fault counts.
+
+use std::collections::HashMap;
+use std::fs;
+use std::path::Path;
+use std::process::Command;
+
+use crate::output;
+
+/// One function ranked by profile weight.
+#[derive(Clone, Debug)]
+pub struct HotFunction {
+    /// Mangled symbol name, as the linker wants it.
+    pub name: String,
+    /// Sample weight: the number of profile frames that landed in the
+    /// function.
+    pub weight: u64,
+    /// Symbol size in bytes, 0 when `nm` reported none.
+    pub size: u64,
+}
+
+/// Defined code symbols of an object, sorted by address for frame
+/// resolution.
+pub struct SymbolTable {
+    // (address, size, name), sorted by address.
+    symbols: Vec<(u64, u64, String)>,
+}
+
+impl SymbolTable {
+    /// Read the defined text symbols of `object` (the unstripped
+    /// enclave .so) with `nm -S`. Panics if `nm` cannot be run, like
+    /// the rest of the build helpers.
+    pub fn from_object(object: &Path) -> SymbolTable {
+        let listing = output(
+            Command::new("nm")
+                .arg("-S")
+                .arg("--defined-only")
+                .arg(object),
+        );
+        let mut symbols: Vec<(u64, u64, String)> = Vec::new();
+        for line in listing.lines() {
+            // "addr [size] type name"; only code symbols matter here.
+            let fields: Vec<&str> = line.split_whitespace().collect();
+            let (addr, size, kind, name) = match fields.len() {
+                4 => (fields[0], fields[1], fields[2], fields[3]),
+                3 => (fields[0], "0", fields[1], fields[2]),
+                _ => continue,
+            };
+            if !matches!(kind, "t" | "T" | "w" | "W") {
+                continue;
+            }
+            let addr = match u64::from_str_radix(addr, 16) {
+                Ok(addr) => addr,
+                Err(_) => continue,
+            };
+            let size = u64::from_str_radix(size, 16).unwrap_or(0);
+            symbols.push((addr, size, name.to_string()));
+        }
+        symbols.sort_by_key(|&(addr, _, _)| addr);
+        SymbolTable { symbols }
+    }
+
+    /// The symbol containing `addr`, by binary search. Symbols with a
+    /// size honor it; zero-sized symbols cover up to the next symbol.
+    pub fn resolve(&self, addr: u64) -> Option<(&str, u64)> {
+        let at = match self.symbols.binary_search_by_key(&addr, |&(a, _, _)| a) {
+            Ok(at) => at,
+            Err(0) => return None,
+            Err(at) => at - 1,
+        };
+        let (start, size, ref name) = self.symbols[at];
+        let end = if size > 0 {
+            start + size
+        } else {
+            self.symbols
+                .get(at + 1)
+                .map(|&(next, _, _)| next)
+                .unwrap_or(u64::MAX)
+        };
+        if addr < end {
+            Some((name, size))
+        } else {
+            None
+        }
+    }
+}
+
+/// Parse a collapsed-stack profile: per line, `;`-joined hex frame
+/// addresses (root-first), a space, a sample count. Lines that do not
+/// parse are skipped - profiles are advisory input.
+pub fn read_folded_profile(path: &Path) -> Vec<(Vec<u64>, u64)> {
+    let content = match fs::read_to_string(path) {
+        Ok(content) => content,
+        Err(_) => return Vec::new(),
+    };
+    let mut profile: Vec<(Vec<u64>, u64)> = Vec::new();
+    for line in content.lines() {
+        let (stack, count) = match line.rfind(' ') {
+            Some(at) => (&line[..at], &line[at + 1..]),
+            None => continue,
+        };
+        let count: u64 = match count.trim().parse() {
+            Ok(count) => count,
+            Err(_) => continue,
+        };
+        let mut frames: Vec<u64> = Vec::new();
+        let mut ok = true;
+        for frame in stack.split(';') {
+            let frame = frame.trim_start_matches("0x");
+            match u64::from_str_radix(frame, 16) {
+                Ok(addr) => frames.push(addr),
+                Err(_) => {
+                    ok = false;
+                    break;
+                }
+            }
+        }
+        if ok && !frames.is_empty() {
+            profile.push((frames, count));
+        }
+    }
+    profile
+}
+
+/// Rank functions by profile weight. Every frame of every stack counts
+/// - a function hot as a caller still belongs in the packed region -
+/// and `load_bias` (the enclave base address the profile was captured
+/// at) is subtracted before resolution. Returns functions in descending
+/// weight order.
+pub fn rank_hot_functions(
+    profile: &[(Vec<u64>, u64)],
+    symbols: &SymbolTable,
+    load_bias: u64,
+) -> Vec<HotFunction> {
+    let mut weights: HashMap<String, (u64, u64)> = HashMap::new();
+    for (frames, count) in profile {
+        for &frame in frames {
+            let addr = frame.wrapping_sub(load_bias);
+            if let Some((name, size)) = symbols.resolve(addr) {
+                let entry = weights.entry(name.to_string()).or_insert((0, size));
+                entry.0 += count;
+            }
+        }
+    }
+    let mut ranked: Vec<HotFunction> = weights
+        .into_iter()
+        .map(|(name, (weight, size))| HotFunction { name, weight, size })
+        .collect();
+    // Weight first; name as tie-break so the order file is stable
+    // across runs and does not dirty incremental links.
+    ranked.sort_by(|a, b| b.weight.cmp(&a.weight).then(a.name.cmp(&b.name)));
+    ranked
+}
+
+/// Write one symbol per line, hottest first, for
+/// `-Wl,--symbol-ordering-file=<path>` (lld).
+pub fn write_symbol_order_file(path: &Path, ranked: &[HotFunction]) {
+    let mut out = String::new();
+    for function in ranked {
+        out.push_str(&function.name);
+        out.push('\n');
+    }
+    t!(fs::write(path, out), path);
+}
+
+/// Write the ordered `*(.text.<sym>)` input-section list for GNU ld.
+/// Splice the file into the enclave linker script's text output section
+/// (an `INCLUDE` ahead of the catch-all `*(.text*)`); functions keep
+/// this order and everything unlisted follows as before. Requires the
+/// compiler to emit one section per function, which rustc does by
+/// default.
+pub fn write_hot_text_section_list(path: &Path, ranked: &[HotFunction]) {
+    let mut out = String::from(
+        "/* Profile-guided hot-function order; generated, do not edit. */\n",
+    );
+    for function in ranked {
+        out.push_str(&format!("*(.text.{})\n", function.name));
+    }
+    t!(fs::write(path, out), path);
+}
+
+/// The whole pipeline in one call, for build scripts: profile plus
+/// unstripped object in, both order files out. Returns the ranking for
+/// logging. A missing or empty profile yields empty files, leaving the
+/// link unchanged.
+pub fn emit_layout_files(
+    profile: &Path,
+    object: &Path,
+    load_bias: u64,
+    symbol_order: &Path,
+    section_list: &Path,
+) -> Vec<HotFunction> {
+    let samples = read_folded_profile(profile);
+    let ranked = if samples.is_empty() {
+        Vec::new()
+    } else {
+        rank_hot_functions(&samples, &SymbolTable::from_object(object), load_bias)
+    };
+    write_symbol_order_file(symbol_order, &ranked);
+    write_hot_text_section_list(section_list, &ranked);
+    ranked
+}
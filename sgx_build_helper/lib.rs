@@ -41,6 +41,8 @@ macro_rules! t {
     };
 }
 
+pub mod layout;
+
 // Because Cargo adds the compiler's dylib path to our library search path, llvm-config may
 // break: the dylib path for the compiler, as of this writing, contains a copy of the LLVM
 // shared library, which means that when our freshly built llvm-config goes to load it's
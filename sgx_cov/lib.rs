@@ -36,13 +36,12 @@ extern crate sgx_types;
 
 use lazy_static::lazy_static;
 use sgx_rand::Rng;
-use sgx_types::{c_char, c_int};
+use sgx_types::c_char;
 use std::ffi::CStr;
 use std::io::Write;
-use std::os::unix::io::{FromRawFd, IntoRawFd};
 use std::slice;
 use std::sync::{Once, SgxMutex};
-use std::untrusted::fs::{copy, File, OpenOptions};
+use std::untrusted::fs::{copy, File};
 
 static INIT: Once = Once::new();
 const GCOV_DATA_MAGIC: u32 = 0x6763_6461;
@@ -51,16 +50,39 @@ const GCOV_TAG_COUNTER_ARCS: u32 = 0x01a1_0000;
 const GCOV_TAG_OBJECT_SUMMARY: u32 = 0xa100_0000;
 const GCOV_TAG_PROGRAM_SUMMARY: u32 = 0xa300_0000;
 
+// One .gcda shard, staged entirely in enclave memory. The records used
+// to go through the untrusted fs as they were emitted - an ocall per
+// 4-byte word - which dominated writeout time on large test matrices
+// and skewed timing-sensitive runs. Now each shard is assembled in its
+// buffer and leaves the enclave as a single write at flush time.
+struct GcdaShard {
+    name: String,
+    version: u32,
+    buf: Vec<u8>,
+}
+
 lazy_static! {
-    static ref GCDA_FILE: SgxMutex<(c_int, u32)> = SgxMutex::new((-1, u32::MAX));
+    static ref CURRENT: SgxMutex<Option<GcdaShard>> = SgxMutex::new(None);
+    static ref PENDING: SgxMutex<Vec<GcdaShard>> = SgxMutex::new(Vec::new());
     static ref WROUT_FNS: SgxMutex<Vec<extern "C" fn()>> = SgxMutex::new(Vec::new());
     static ref RND: SgxMutex<u32> = SgxMutex::new(0);
 }
 
 pub fn cov_writeout() {
+    // counter emission fills PENDING without any ocalls ...
     for f in WROUT_FNS.lock().unwrap().iter() {
         f();
     }
+    // ... and every staged shard then hits the disk with one write.
+    // Shard files carry a per-run random suffix, so concurrent
+    // coverage-enabled enclaves never contend on a file and the
+    // matrix-wide .gcda set is merged offline (e.g. by grcov).
+    let mut pending = PENDING.lock().unwrap();
+    for shard in pending.drain(..) {
+        File::create(&shard.name)
+            .and_then(|mut file| file.write_all(&shard.buf))
+            .unwrap_or_else(|e| panic!("cov_writeout flush {} failed {:?}", shard.name, e));
+    }
 }
 
 #[no_mangle]
@@ -80,29 +102,22 @@ pub extern "C" fn llvm_gcov_init(
 
 #[no_mangle]
 pub extern "C" fn llvm_gcda_summary_info() {
-    GCDA_FILE
-        .lock()
-        .map_or_else(
-            |e| panic!("llvm_gcda_summary_info failed {:?}", e),
-            |tup| Ok((unsafe { File::from_raw_fd(tup.0) }, tup.1)),
-        )
-        .and_then(|(mut file, gcov_version)| {
-            if gcov_version >= 90 {
-                file.write_all(&GCOV_TAG_OBJECT_SUMMARY.to_le_bytes())?;
-                file.write_all(&(2 as u32).to_le_bytes())?;
-                file.write_all(&(1 as u32).to_le_bytes())?; // runs. we never merge so it's always 1
-                file.write_all(&(0 as u32).to_le_bytes())?; // sum_max
-            } else {
-                file.write_all(&GCOV_TAG_PROGRAM_SUMMARY.to_le_bytes())?;
-                file.write_all(&(3 as u32).to_le_bytes())?;
-                file.write_all(&(0 as u32).to_le_bytes())?;
-                file.write_all(&(0 as u32).to_le_bytes())?;
-                file.write_all(&(1 as u32).to_le_bytes())?; // runs. we never merge so it's always 1
-            }
-            let _ = file.into_raw_fd();
-            Ok(())
-        })
-        .unwrap_or_else(|e: std::io::Error| panic!("llvm_gcda_summary_info failed {:?}", e))
+    let mut current = CURRENT.lock().unwrap();
+    let shard = current
+        .as_mut()
+        .unwrap_or_else(|| panic!("llvm_gcda_summary_info called with no open shard"));
+    if shard.version >= 90 {
+        shard.buf.extend_from_slice(&GCOV_TAG_OBJECT_SUMMARY.to_le_bytes());
+        shard.buf.extend_from_slice(&(2 as u32).to_le_bytes());
+        shard.buf.extend_from_slice(&(1 as u32).to_le_bytes()); // runs. we never merge so it's always 1
+        shard.buf.extend_from_slice(&(0 as u32).to_le_bytes()); // sum_max
+    } else {
+        shard.buf.extend_from_slice(&GCOV_TAG_PROGRAM_SUMMARY.to_le_bytes());
+        shard.buf.extend_from_slice(&(3 as u32).to_le_bytes());
+        shard.buf.extend_from_slice(&(0 as u32).to_le_bytes());
+        shard.buf.extend_from_slice(&(0 as u32).to_le_bytes());
+        shard.buf.extend_from_slice(&(1 as u32).to_le_bytes()); // runs. we never merge so it's always 1
+    }
 }
 
 #[no_mangle]
@@ -111,52 +126,34 @@ pub extern "C" fn llvm_gcda_emit_arcs(num_counters: u32, counters: *const u64) {
     // so `counters` is no longer * mut u64
     let cnts = unsafe { slice::from_raw_parts(counters, num_counters as usize) };
 
-    GCDA_FILE
-        .lock()
-        .map_or_else(
-            |e| panic!("llvm_gcda_emit_arcs failed {:?}", e),
-            |tup| Ok(unsafe { File::from_raw_fd(tup.0) }),
-        )
-        .and_then(|mut file| {
-            file.write_all(&GCOV_TAG_COUNTER_ARCS.to_le_bytes())?;
-            let len: u32 = num_counters * 2;
-            file.write_all(&len.to_le_bytes())?;
-            for c in cnts {
-                file.write_all(&c.to_le_bytes())?;
-            }
-            let _ = file.into_raw_fd();
-            Ok(())
-        })
-        .unwrap_or_else(|e: std::io::Error| panic!("llvm_gcda_emit_arcs failed {:?}", e))
+    let mut current = CURRENT.lock().unwrap();
+    let shard = current
+        .as_mut()
+        .unwrap_or_else(|| panic!("llvm_gcda_emit_arcs called with no open shard"));
+    shard.buf.extend_from_slice(&GCOV_TAG_COUNTER_ARCS.to_le_bytes());
+    let len: u32 = num_counters * 2;
+    shard.buf.extend_from_slice(&len.to_le_bytes());
+    for c in cnts {
+        shard.buf.extend_from_slice(&c.to_le_bytes());
+    }
 }
 
 #[no_mangle]
 pub extern "C" fn llvm_gcda_emit_function(ident: u32, func_checksum: u32, cfg_checksum: u32) {
-    let mut len: u32 = 2;
-    let use_extra_checksum: bool = GCDA_FILE.lock().map(|tup| tup.1 >= 47).unwrap();
-
+    let mut current = CURRENT.lock().unwrap();
+    let shard = current
+        .as_mut()
+        .unwrap_or_else(|| panic!("llvm_gcda_emit_function called with no open shard"));
+    let use_extra_checksum = shard.version >= 47;
+    let len: u32 = if use_extra_checksum { 3 } else { 2 };
+
+    shard.buf.extend_from_slice(&GCOV_TAG_FUNCTION.to_le_bytes());
+    shard.buf.extend_from_slice(&len.to_le_bytes());
+    shard.buf.extend_from_slice(&ident.to_le_bytes());
+    shard.buf.extend_from_slice(&func_checksum.to_le_bytes());
     if use_extra_checksum {
-        len += 1;
+        shard.buf.extend_from_slice(&cfg_checksum.to_le_bytes());
     }
-
-    GCDA_FILE
-        .lock()
-        .map_or_else(
-            |e| panic!("llvm_gcda_emit_function failed {:?}", e),
-            |tup| Ok(unsafe { File::from_raw_fd(tup.0) }),
-        )
-        .and_then(|mut file| {
-            file.write_all(&GCOV_TAG_FUNCTION.to_le_bytes())?;
-            file.write_all(&len.to_le_bytes())?;
-            file.write_all(&ident.to_le_bytes())?;
-            file.write_all(&func_checksum.to_le_bytes())?;
-            if use_extra_checksum {
-                file.write_all(&cfg_checksum.to_le_bytes())?;
-            }
-            let _ = file.into_raw_fd();
-            Ok(())
-        })
-        .unwrap_or_else(|e: std::io::Error| panic!("llvm_gcda_emit_function failed {:?}", e))
 }
 
 #[no_mangle]
@@ -171,58 +168,44 @@ pub extern "C" fn llvm_gcda_start_file(orig_filename: *const c_char, version: u3
     let new_gcno_name = format!("{}.{:08x}.gcno", prefix, *rnd);
     let new_gcda_name = format!("{}.{:08x}.gcda", prefix, *rnd);
 
-    GCDA_FILE
-        .lock()
-        .map_or_else(
-            |e| panic!("llvm_gcda_emit_function failed {:?}", e),
-            |tup| Ok(tup),
-        )
-        .and_then(|mut tup| {
-            copy(orig_gcno_name, new_gcno_name)?;
-            let mut file = match OpenOptions::new()
-                .write(true)
-                .append(false)
-                .open(&new_gcda_name)
-            {
-                Ok(file) => file,
-                Err(_) => File::create(&new_gcda_name)?,
-            };
-
-            let c3: u8 = ((version >> 24) & 0x000000FF) as u8;
-            let c2: u8 = ((version >> 16) & 0x000000FF) as u8;
-            let c1: u8 = ((version >> 8) & 0x000000FF) as u8;
-            let parsed_gcov_version: u32 = if c3 >= 'A' as u8 {
-                ((c3 - 'A' as u8) as u32) * 100
-                    + ((c2 - '0' as u8) as u32) * 10
-                    + (c1 - '0' as u8) as u32
-            } else {
-                ((c3 - '0' as u8) as u32) * 10 + (c1 - '0' as u8) as u32
-            };
-
-            tup.1 = parsed_gcov_version;
-
-            file.write_all(&GCOV_DATA_MAGIC.to_le_bytes()).unwrap();
-            file.write_all(&version.to_le_bytes()).unwrap();
-            file.write_all(&checksum.to_le_bytes()).unwrap();
-
-            tup.0 = file.into_raw_fd();
-
-            Ok(())
-        })
-        .unwrap_or_else(|e: std::io::Error| panic!("llvm_gcda_start_file failed {:?}", e))
+    // the .gcno copy is the only file operation on the emission path;
+    // the .gcda itself is staged in memory until cov_writeout flushes
+    copy(orig_gcno_name, new_gcno_name)
+        .unwrap_or_else(|e| panic!("llvm_gcda_start_file failed {:?}", e));
+
+    let c3: u8 = ((version >> 24) & 0x000000FF) as u8;
+    let c2: u8 = ((version >> 16) & 0x000000FF) as u8;
+    let c1: u8 = ((version >> 8) & 0x000000FF) as u8;
+    let parsed_gcov_version: u32 = if c3 >= 'A' as u8 {
+        ((c3 - 'A' as u8) as u32) * 100
+            + ((c2 - '0' as u8) as u32) * 10
+            + (c1 - '0' as u8) as u32
+    } else {
+        ((c3 - '0' as u8) as u32) * 10 + (c1 - '0' as u8) as u32
+    };
+
+    let mut buf = Vec::with_capacity(4096);
+    buf.extend_from_slice(&GCOV_DATA_MAGIC.to_le_bytes());
+    buf.extend_from_slice(&version.to_le_bytes());
+    buf.extend_from_slice(&checksum.to_le_bytes());
+
+    *CURRENT.lock().unwrap() = Some(GcdaShard {
+        name: new_gcda_name,
+        version: parsed_gcov_version,
+        buf,
+    });
 }
 
 #[no_mangle]
 pub extern "C" fn llvm_gcda_end_file() {
-    if let Ok(ref tup) = GCDA_FILE.lock() {
-        let fd = &tup.0;
-        let mut file = unsafe { File::from_raw_fd(*fd) };
-        let eof: u64 = 0;
-        file.write_all(&eof.to_be_bytes()).unwrap();
-    // Let it drop
-    } else {
-        panic!("llvm_gcda_end_file failed!");
-    }
+    let mut shard = CURRENT
+        .lock()
+        .unwrap()
+        .take()
+        .unwrap_or_else(|| panic!("llvm_gcda_end_file called with no open shard"));
+    let eof: u64 = 0;
+    shard.buf.extend_from_slice(&eof.to_be_bytes());
+    PENDING.lock().unwrap().push(shard);
 }
 
 #[no_mangle]
@@ -0,0 +1,200 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License..
+
+//! A background RSA key-generation pool.
+//!
+//! Generating an RSA-3072 keypair inside the enclave blocks for
+//! seconds, which is ruinous on a provisioning ECALL's latency. The
+//! pool moves that cost off the request path: the application dedicates
+//! one worker TCS to an ECALL that runs [`worker_loop`], pre-generating
+//! keypairs into a bounded queue during idle time, and provisioning
+//! calls [`take`], which normally is a lock, a pop and an unlock.
+//!
+//! An empty pool never fails a request - `take` falls back to inline
+//! generation and counts the miss - so the pool is purely a latency
+//! optimization and [`stats`] tells you whether it is sized right: a
+//! growing miss count means the queue drains faster than one worker
+//! refills it.
+//!
+//! [`worker_loop`]: RsaKeyPool::worker_loop
+//! [`take`]: RsaKeyPool::take
+//! [`stats`]: RsaKeyPool::stats
+
+use crate::RsaKeyPair;
+use sgx_types::SgxResult;
+use std::collections::VecDeque;
+use std::sync::atomic::{AtomicBool, AtomicU64, Ordering};
+use std::sync::{Arc, SgxCondvar, SgxMutex};
+
+struct QueueState<K> {
+    keys: VecDeque<K>,
+    /// Keypairs being generated right now; reserving before the
+    /// (unlocked, slow) generation keeps several workers from
+    /// collectively overshooting the capacity.
+    pending: usize,
+}
+
+struct PoolShared<K> {
+    queue: SgxMutex<QueueState<K>>,
+    /// Signalled when a slot frees up and the worker should refill.
+    refill: SgxCondvar,
+    capacity: usize,
+    stop: AtomicBool,
+    generated: AtomicU64,
+    hits: AtomicU64,
+    misses: AtomicU64,
+}
+
+/// Point-in-time pool counters, for sizing the pool depth.
+#[derive(Copy, Clone, Debug, Default)]
+pub struct RsaKeyPoolStats {
+    /// Ready keypairs in the queue.
+    pub depth: usize,
+    /// Configured queue bound.
+    pub capacity: usize,
+    /// Keypairs generated by workers since creation.
+    pub generated: u64,
+    /// `take` calls served from the queue.
+    pub hits: u64,
+    /// `take` calls that found the queue empty and generated inline.
+    pub misses: u64,
+}
+
+/// A bounded queue of pre-generated RSA keypairs.
+///
+/// Cheap to clone; clones share the queue, so hand one clone to the
+/// worker ECALL and keep another on the request path.
+pub struct RsaKeyPool<K> {
+    inner: Arc<PoolShared<K>>,
+}
+
+impl<K> Clone for RsaKeyPool<K> {
+    fn clone(&self) -> Self {
+        RsaKeyPool { inner: self.inner.clone() }
+    }
+}
+
+impl<K: RsaKeyPair + Send + 'static> RsaKeyPool<K> {
+    /// Creates an empty pool bounded at `capacity` keypairs.
+    ///
+    /// The pool holds whole private keys; size it for latency cover
+    /// during request bursts, not for bulk - a dozen RSA-3072 keypairs
+    /// already rides out seconds of worker lag.
+    pub fn new(capacity: usize) -> RsaKeyPool<K> {
+        RsaKeyPool {
+            inner: Arc::new(PoolShared {
+                queue: SgxMutex::new(QueueState {
+                    keys: VecDeque::with_capacity(capacity),
+                    pending: 0,
+                }),
+                refill: SgxCondvar::new(),
+                capacity,
+                stop: AtomicBool::new(false),
+                generated: AtomicU64::new(0),
+                hits: AtomicU64::new(0),
+                misses: AtomicU64::new(0),
+            }),
+        }
+    }
+
+    /// Generates keypairs until the pool is full, then blocks until a
+    /// `take` frees a slot. Returns when [`shutdown`] is called or key
+    /// generation fails.
+    ///
+    /// Run this on a dedicated worker TCS: expose an ECALL that calls
+    /// it and invoke that ECALL from its own host thread. Generation
+    /// happens outside the queue lock, so `take` never waits behind it.
+    ///
+    /// [`shutdown`]: RsaKeyPool::shutdown
+    pub fn worker_loop(&self) -> SgxResult<()> {
+        let shared = &*self.inner;
+        loop {
+            {
+                let mut state = shared.queue.lock().unwrap();
+                while state.keys.len() + state.pending >= shared.capacity
+                    && !shared.stop.load(Ordering::Relaxed)
+                {
+                    state = shared.refill.wait(state).unwrap();
+                }
+                if shared.stop.load(Ordering::Relaxed) {
+                    return Ok(());
+                }
+                state.pending += 1;
+            }
+
+            let key = match K::new() {
+                Ok(key) => key,
+                Err(e) => {
+                    let mut state = shared.queue.lock().unwrap();
+                    state.pending -= 1;
+                    return Err(e);
+                }
+            };
+
+            let mut state = shared.queue.lock().unwrap();
+            state.pending -= 1;
+            state.keys.push_back(key);
+            shared.generated.fetch_add(1, Ordering::Relaxed);
+        }
+    }
+
+    /// Dequeues a ready keypair; falls back to generating one inline
+    /// (and counting a miss) when the pool is empty, so the caller
+    /// always gets a key.
+    pub fn take(&self) -> SgxResult<K> {
+        if let Some(key) = self.try_take() {
+            return Ok(key);
+        }
+        self.inner.misses.fetch_add(1, Ordering::Relaxed);
+        K::new()
+    }
+
+    /// Dequeues a ready keypair, or returns `None` when the pool is
+    /// empty. Never generates.
+    pub fn try_take(&self) -> Option<K> {
+        let shared = &*self.inner;
+        let key = shared.queue.lock().unwrap().keys.pop_front();
+        if key.is_some() {
+            shared.hits.fetch_add(1, Ordering::Relaxed);
+            shared.refill.notify_one();
+        }
+        key
+    }
+
+    /// Ready keypairs currently queued.
+    pub fn depth(&self) -> usize {
+        self.inner.queue.lock().unwrap().keys.len()
+    }
+
+    /// Snapshot of the pool counters.
+    pub fn stats(&self) -> RsaKeyPoolStats {
+        let shared = &*self.inner;
+        RsaKeyPoolStats {
+            depth: shared.queue.lock().unwrap().keys.len(),
+            capacity: shared.capacity,
+            generated: shared.generated.load(Ordering::Relaxed),
+            hits: shared.hits.load(Ordering::Relaxed),
+            misses: shared.misses.load(Ordering::Relaxed),
+        }
+    }
+
+    /// Stops every worker loop. Queued keypairs remain takeable.
+    pub fn shutdown(&self) {
+        self.inner.stop.store(true, Ordering::Relaxed);
+        self.inner.refill.broadcast();
+    }
+}
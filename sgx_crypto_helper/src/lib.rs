@@ -84,5 +84,7 @@ extern crate serde_big_array_sgx as serde_big_array;
 #[macro_use]
 extern crate serde_big_array;
 
+#[cfg(any(feature = "mesalock_sgx", target_env = "sgx"))]
+pub mod keypool;
 pub mod rsa2048;
 pub mod rsa3072;
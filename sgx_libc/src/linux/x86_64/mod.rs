@@ -491,6 +491,19 @@ s! {
         pub _pad: [c_int; 29],
         _align: [usize; 0],
     }
+
+    pub struct tls_crypto_info {
+        pub version: u16,
+        pub cipher_type: u16,
+    }
+
+    pub struct tls12_crypto_info_aes_gcm_128 {
+        pub info: tls_crypto_info,
+        pub iv: [c_uchar; TLS_CIPHER_AES_GCM_128_IV_SIZE],
+        pub key: [c_uchar; TLS_CIPHER_AES_GCM_128_KEY_SIZE],
+        pub salt: [c_uchar; TLS_CIPHER_AES_GCM_128_SALT_SIZE],
+        pub rec_seq: [c_uchar; TLS_CIPHER_AES_GCM_128_REC_SEQ_SIZE],
+    }
 }
 
 pub const AT_FDCWD: c_int = -100;
@@ -608,6 +621,9 @@ pub const PROT_EXEC: c_int = 4;
 
 pub const SOL_SOCKET: c_int = 1;
 
+pub const SCM_RIGHTS: c_int = 0x01;
+pub const SCM_CREDENTIALS: c_int = 0x02;
+
 pub const SO_REUSEADDR: c_int = 2;
 pub const SO_TYPE: c_int = 3;
 pub const SO_ERROR: c_int = 4;
@@ -746,6 +762,18 @@ pub const F_SEAL_SEAL: c_int = 0x0001;
 pub const F_SEAL_SHRINK: c_int = 0x0002;
 pub const F_SEAL_GROW: c_int = 0x0004;
 
+pub const POSIX_FADV_NORMAL: c_int = 0;
+pub const POSIX_FADV_RANDOM: c_int = 1;
+pub const POSIX_FADV_SEQUENTIAL: c_int = 2;
+pub const POSIX_FADV_WILLNEED: c_int = 3;
+pub const POSIX_FADV_DONTNEED: c_int = 4;
+pub const POSIX_FADV_NOREUSE: c_int = 5;
+
+pub const FALLOC_FL_KEEP_SIZE: c_int = 0x01;
+pub const FALLOC_FL_PUNCH_HOLE: c_int = 0x02;
+pub const FALLOC_FL_COLLAPSE_RANGE: c_int = 0x08;
+pub const FALLOC_FL_ZERO_RANGE: c_int = 0x10;
+
 pub const EXIT_FAILURE: c_int = 1;
 pub const EXIT_SUCCESS: c_int = 0;
 pub const EOF: c_int = -1;
@@ -932,6 +960,19 @@ pub const TCP_WINDOW_CLAMP: c_int = 10;
 pub const TCP_INFO: c_int = 11;
 pub const TCP_QUICKACK: c_int = 12;
 pub const TCP_CONGESTION: c_int = 13;
+pub const TCP_ULP: c_int = 31;
+
+// kernel TLS (linux/tls.h)
+pub const SOL_TLS: c_int = 282;
+pub const TLS_TX: c_int = 1;
+pub const TLS_RX: c_int = 2;
+pub const TLS_1_2_VERSION: u16 = 0x0303;
+pub const TLS_1_3_VERSION: u16 = 0x0304;
+pub const TLS_CIPHER_AES_GCM_128: u16 = 51;
+pub const TLS_CIPHER_AES_GCM_128_IV_SIZE: usize = 8;
+pub const TLS_CIPHER_AES_GCM_128_KEY_SIZE: usize = 16;
+pub const TLS_CIPHER_AES_GCM_128_SALT_SIZE: usize = 4;
+pub const TLS_CIPHER_AES_GCM_128_REC_SEQ_SIZE: usize = 8;
 
 pub const SO_DEBUG: c_int = 1;
 
@@ -1500,6 +1541,49 @@ pub unsafe fn CPU_EQUAL(set1: &cpu_set_t, set2: &cpu_set_t) -> bool {
     set1.bits == set2.bits
 }
 
+#[inline]
+fn CMSG_ALIGN(len: usize) -> usize {
+    (len + mem::size_of::<usize>() - 1) & !(mem::size_of::<usize>() - 1)
+}
+
+#[inline]
+pub unsafe fn CMSG_FIRSTHDR(mhdr: *const msghdr) -> *mut cmsghdr {
+    if (*mhdr).msg_controllen as usize >= mem::size_of::<cmsghdr>() {
+        (*mhdr).msg_control as *mut cmsghdr
+    } else {
+        ptr::null_mut()
+    }
+}
+
+#[inline]
+pub unsafe fn CMSG_NXTHDR(mhdr: *const msghdr, cmsg: *const cmsghdr) -> *mut cmsghdr {
+    if ((*cmsg).cmsg_len as usize) < mem::size_of::<cmsghdr>() {
+        return ptr::null_mut();
+    }
+    let next = (cmsg as usize + CMSG_ALIGN((*cmsg).cmsg_len as usize)) as *mut cmsghdr;
+    let max = (*mhdr).msg_control as usize + (*mhdr).msg_controllen as usize;
+    if (next as usize) + mem::size_of::<cmsghdr>() > max {
+        ptr::null_mut()
+    } else {
+        next
+    }
+}
+
+#[inline]
+pub unsafe fn CMSG_DATA(cmsg: *const cmsghdr) -> *mut c_uchar {
+    cmsg.offset(1) as *mut c_uchar
+}
+
+#[inline]
+pub fn CMSG_SPACE(length: c_uint) -> c_uint {
+    (CMSG_ALIGN(length as usize) + CMSG_ALIGN(mem::size_of::<cmsghdr>())) as c_uint
+}
+
+#[inline]
+pub fn CMSG_LEN(length: c_uint) -> c_uint {
+    (CMSG_ALIGN(mem::size_of::<cmsghdr>()) + length as usize) as c_uint
+}
+
 #[inline]
 unsafe fn __sigmask(sig: c_int) -> u64 {
     (1 as u64) << (((sig) - 1) % (8 * mem::size_of::<u64>()) as i32)
@@ -22,8 +22,49 @@ use alloc::vec::Vec;
 use alloc::boxed::Box;
 use core::ptr;
 use core::mem;
+use core::sync::atomic::{fence, spin_loop_hint, AtomicBool, AtomicPtr, AtomicU64, AtomicUsize, Ordering};
 
 const MAX_OCALL_ALLOC_SIZE: size_t = 0x4000; //16K
+
+const ARENA_MAX_SIZE: size_t = 0x0040_0000; //4M
+
+static ARENA_BUSY: AtomicBool = AtomicBool::new(false);
+static mut ARENA_BASE: *mut c_void = ptr::null_mut();
+static mut ARENA_CAP: size_t = 0;
+
+// Single-slot untrusted arena reused across ocalls whose buffers exceed
+// MAX_OCALL_ALLOC_SIZE. Steady-state large I/O then skips the
+// u_malloc_ocall/u_free_ocall round trip per operation; a second thread
+// marshalling concurrently (or an oversized request) falls back to the
+// plain untrusted malloc path.
+unsafe fn arena_acquire(size: size_t) -> *mut c_void {
+    if size > ARENA_MAX_SIZE ||
+       ARENA_BUSY.compare_and_swap(false, true, Ordering::Acquire) {
+        return malloc(size);
+    }
+    if ARENA_CAP < size {
+        if !ARENA_BASE.is_null() {
+            free(ARENA_BASE);
+        }
+        let cap = size.next_power_of_two();
+        ARENA_BASE = malloc(cap);
+        ARENA_CAP = if ARENA_BASE.is_null() { 0 } else { cap };
+    }
+    if ARENA_BASE.is_null() {
+        ARENA_BUSY.store(false, Ordering::Release);
+        return malloc(size);
+    }
+    ARENA_BASE
+}
+
+unsafe fn arena_release(p: *mut c_void) {
+    if !p.is_null() && p == ARENA_BASE && ARENA_BUSY.load(Ordering::Relaxed) {
+        ARENA_BUSY.store(false, Ordering::Release);
+    } else {
+        free(p);
+    }
+}
+
 extern "C" {
     // memory
     pub fn u_malloc_ocall(result: *mut *mut c_void, error: *mut c_int, size: size_t) -> sgx_status_t;
@@ -36,6 +77,12 @@ extern "C" {
                         flags: c_int,
                         fd: c_int,
                         offset: off_t) -> sgx_status_t;
+    pub fn u_mmap_placed_ocall(result: *mut *mut c_void,
+                               error: *mut c_int,
+                               length: size_t,
+                               prot: c_int,
+                               huge: c_int,
+                               numa_node: c_int) -> sgx_status_t;
     pub fn u_munmap_ocall(result: *mut c_int,
                           error: *mut c_int,
                           start: *mut c_void,
@@ -141,6 +188,9 @@ extern "C" {
     pub fn u_fdatasync_ocall(result: *mut c_int,
                              error: *mut c_int,
                              fd: c_int) -> sgx_status_t;
+    pub fn u_fsync_group_ocall(result: *mut c_int,
+                               error: *mut c_int,
+                               fd: c_int) -> sgx_status_t;
     pub fn u_fchmod_ocall(result: *mut c_int,
                           error: *mut c_int,
                           fd: c_int,
@@ -186,6 +236,11 @@ extern "C" {
                                dirp: *mut DIR,
                                entry: *mut dirent64,
                                dirresult: *mut *mut  dirent64) -> sgx_status_t;
+    pub fn u_readdir64_batch_ocall(result: *mut c_int,
+                                   dirp: *mut DIR,
+                                   entries: *mut dirent64,
+                                   count: size_t,
+                                   nread: *mut size_t) -> sgx_status_t;
     pub fn u_closedir_ocall(result: *mut c_int,
                             error: *mut c_int,
                             dirp: *mut DIR) -> sgx_status_t;
@@ -198,6 +253,18 @@ extern "C" {
                              pathname: *const c_char,
                              buf: *mut stat64,
                              flags: c_int) -> sgx_status_t;
+    pub fn u_fallocate64_ocall(result: *mut c_int,
+                               errno: *mut c_int,
+                               fd: c_int,
+                               mode: c_int,
+                               offset: off64_t,
+                               len: off64_t) -> sgx_status_t;
+    pub fn u_posix_fadvise_ocall(result: *mut c_int,
+                                 errno: *mut c_int,
+                                 fd: c_int,
+                                 offset: off64_t,
+                                 len: off64_t,
+                                 advice: c_int) -> sgx_status_t;
     // fd
     pub fn u_read_ocall(result: *mut ssize_t,
                         errno: *mut c_int,
@@ -243,6 +310,20 @@ extern "C" {
                              iov: *const iovec,
                              iovcnt: c_int,
                              offset: off64_t) -> sgx_status_t;
+    pub fn u_copy_file_range_ocall(result: *mut ssize_t,
+                                   errno: *mut c_int,
+                                   fd_in: c_int,
+                                   off_in: *mut i64,
+                                   fd_out: c_int,
+                                   off_out: *mut i64,
+                                   len: size_t,
+                                   flags: c_uint) -> sgx_status_t;
+    pub fn u_sendfile_ocall(result: *mut ssize_t,
+                            errno: *mut c_int,
+                            out_fd: c_int,
+                            in_fd: c_int,
+                            offset: *mut i64,
+                            count: size_t) -> sgx_status_t;
     pub fn u_fcntl_arg0_ocall(result: *mut c_int,
                               errno: *mut c_int,
                               fd: c_int,
@@ -269,6 +350,9 @@ extern "C" {
                                  errno: *mut c_int,
                                  clk_id: clockid_t,
                                  tp: *mut timespec) -> sgx_status_t;
+    pub fn u_time_page_ocall(result: *mut *mut c_void,
+                             error: *mut c_int,
+                             interval_ns: u64) -> sgx_status_t;
     // socket
     pub fn u_socket_ocall(result: *mut c_int,
                           errno: *mut c_int,
@@ -354,6 +438,21 @@ extern "C" {
                               optname: c_int,
                               optval: *const c_void,
                               optlen: socklen_t) -> sgx_status_t;
+    pub fn u_setsockopt_batch_ocall(result: *mut c_int,
+                                    errno: *mut c_int,
+                                    sockfd: c_int,
+                                    opts: *const sockopt_req_t,
+                                    nopts: size_t) -> sgx_status_t;
+    pub fn u_accept4_preset_ocall(result: *mut c_int,
+                                  errno: *mut c_int,
+                                  sockfd: c_int,
+                                  addr: *mut sockaddr,
+                                  addrlen_in: socklen_t,
+                                  addrlen_out: *mut socklen_t,
+                                  flags: c_int,
+                                  opts: *const sockopt_req_t,
+                                  nopts: size_t,
+                                  nopts_applied: *mut size_t) -> sgx_status_t;
     pub fn u_getsockopt_ocall(result: *mut c_int,
                               errno: *mut c_int,
                               sockfd: c_int,
@@ -378,6 +477,15 @@ extern "C" {
                             errno: *mut c_int,
                             sockfd: c_int,
                             how: c_int) -> sgx_status_t;
+    pub fn u_tls_ulp_enable_ocall(result: *mut c_int,
+                                  errno: *mut c_int,
+                                  sockfd: c_int) -> sgx_status_t;
+    pub fn u_tls_crypto_info_set_ocall(result: *mut c_int,
+                                       errno: *mut c_int,
+                                       sockfd: c_int,
+                                       direction: c_int,
+                                       crypto_info: *const c_void,
+                                       len: socklen_t) -> sgx_status_t;
     // net
     pub fn u_getaddrinfo_ocall(result: *mut c_int,
                                errno: *mut c_int,
@@ -385,6 +493,12 @@ extern "C" {
                                service: *const c_char,
                                hints: *const addrinfo,
                                res: *mut *mut addrinfo) -> sgx_status_t;
+    pub fn u_getaddrinfo_prefetch_ocall(result: *mut c_int,
+                                        errno: *mut c_int,
+                                        nodes: *const c_char,
+                                        nodes_len: size_t,
+                                        service: *const c_char,
+                                        hints: *const addrinfo) -> sgx_status_t;
     pub fn u_freeaddrinfo_ocall(res: *mut addrinfo) -> sgx_status_t;
     pub fn u_gai_strerror_ocall(result: *mut *const c_char, errcode: c_int) -> sgx_status_t;
     // async io
@@ -408,6 +522,21 @@ extern "C" {
                               events: *mut epoll_event,
                               maxevents: c_int,
                               timeout: c_int) -> sgx_status_t;
+    pub fn u_reactor_advance_ocall(result: *mut c_int,
+                                   error: *mut c_int,
+                                   epfd: c_int,
+                                   events: *mut epoll_event,
+                                   maxevents: c_int,
+                                   timeout: c_int,
+                                   wfds: *const c_int,
+                                   woffs: *const u64,
+                                   wlens: *const u64,
+                                   nwritten: *mut i64,
+                                   nwrites: size_t,
+                                   wbuf: *const c_void,
+                                   rbuf: *mut c_void,
+                                   chunk_size: size_t,
+                                   nreads: *mut i64) -> sgx_status_t;
     // sys
     pub fn u_sysconf_ocall(result: *mut c_long,
                            error: *mut c_int,
@@ -444,6 +573,11 @@ extern "C" {
                               error: *mut c_int,
                               rqtp: *const timespec,
                               rmtp: *mut timespec) -> sgx_status_t;
+    pub  fn u_get_cpu_topology_ocall(result: *mut c_long,
+                                     error: *mut c_int,
+                                     package_ids: *mut uint32_t,
+                                     l3_ids: *mut uint32_t,
+                                     count: size_t) -> sgx_status_t;
     //signal
     pub fn u_sigaction_ocall(result: *mut c_int,
                              error: *mut c_int,
@@ -523,6 +657,44 @@ pub unsafe fn mmap(start: *mut c_void,
     result
 }
 
+/// Hugepage request levels for mmap_placed.
+pub const MMAP_PLACED_HUGE_NONE: c_int = 0;
+pub const MMAP_PLACED_HUGE_THP: c_int = 1;
+pub const MMAP_PLACED_HUGE_TLB: c_int = 2;
+
+/// Anonymous untrusted staging buffer with page-size and NUMA
+/// placement: `huge` picks none/THP-advice/explicit hugetlb (explicit
+/// falls back to advice when the hugetlb pool is empty) and
+/// `numa_node` prefers allocation on one node, or -1 for the kernel
+/// default. Unmap with munmap. Placement is advisory; only the
+/// mapping itself can fail.
+pub unsafe fn mmap_placed(length: size_t, prot: c_int, huge: c_int, numa_node: c_int) -> *mut c_void {
+    let mut result: *mut c_void = ptr::null_mut();
+    let mut error: c_int = 0;
+    let status = u_mmap_placed_ocall(&mut result as *mut *mut c_void,
+                                     &mut error as *mut c_int,
+                                     length,
+                                     prot,
+                                     huge,
+                                     numa_node);
+
+    if status == sgx_status_t::SGX_SUCCESS {
+        if result as isize == -1 {
+            set_errno(error);
+        }
+    } else {
+        set_errno(ESGX);
+        result = -1 as isize as *mut c_void;
+    }
+
+    if sgx_is_outside_enclave(result, length) == 0 {
+        set_errno(ESGX);
+        result = -1 as isize as *mut c_void;
+    }
+
+    result
+}
+
 pub unsafe fn munmap(start: *mut c_void, length: size_t) -> c_int {
     let mut result: c_int = 0;
     let mut error: c_int = 0;
@@ -582,12 +754,51 @@ pub unsafe fn mprotect(addr: *mut c_void, length: size_t, prot: c_int) -> c_int
     result
 }
 
+// Memoized process-constant metadata. getpid, getuid and the
+// process-constant sysconf names answer from enclave memory after the
+// first ocall; library code asks for these thousands of times a second
+// and the answers cannot change under a running enclave. The cached
+// value sits in the low 32 bits with a present flag above it, so one
+// atomic carries both. metadata_cache_refresh() drops everything for
+// the fork-style cases where the process identity does change.
+const META_PRESENT: u64 = 1 << 32;
+
+static META_PID: AtomicU64 = AtomicU64::new(0);
+static META_UID: AtomicU64 = AtomicU64::new(0);
+
+const SYSCONF_CACHED_NAMES: [c_int; 4] = [
+    _SC_PAGESIZE,
+    _SC_CLK_TCK,
+    _SC_NPROCESSORS_CONF,
+    _SC_NPROCESSORS_ONLN,
+];
+const SYSCONF_SLOT_INIT: AtomicU64 = AtomicU64::new(0);
+static SYSCONF_VALUES: [AtomicU64; 4] = [
+    SYSCONF_SLOT_INIT, SYSCONF_SLOT_INIT, SYSCONF_SLOT_INIT, SYSCONF_SLOT_INIT,
+];
+static SYSCONF_PRESENT: AtomicUsize = AtomicUsize::new(0);
+
+/// Forget every memoized metadata value; the next call of each wrapper
+/// crosses the boundary again. For use after fork-like transitions and
+/// around CPU hot-plug if _SC_NPROCESSORS_ONLN must be re-observed.
+pub unsafe fn metadata_cache_refresh() {
+    META_PID.store(0, Ordering::Relaxed);
+    META_UID.store(0, Ordering::Relaxed);
+    SYSCONF_PRESENT.store(0, Ordering::Relaxed);
+}
+
 pub unsafe fn getuid() -> uid_t {
+    let cached = META_UID.load(Ordering::Relaxed);
+    if cached & META_PRESENT != 0 {
+        return cached as uid_t;
+    }
     let mut result: uid_t = 0;
     let status = u_getuid_ocall(&mut result as *mut uid_t);
     if status != sgx_status_t::SGX_SUCCESS {
          set_errno(ESGX);
          result = 0;
+    } else {
+        META_UID.store(META_PRESENT | result as u64, Ordering::Relaxed);
     }
     result
 }
@@ -602,7 +813,108 @@ pub unsafe fn environ() -> *const *const c_char {
     result
 }
 
+// Trusted snapshot of the process environment and working directory.
+// One u_environ_ocall populates the snapshot; getenv then resolves
+// in-enclave with a hash-screened scan instead of an ocall per read.
+// setenv/unsetenv/chdir invalidate, so the next read re-snapshots.
+// As with libc, a pointer returned by getenv is only valid until the
+// next environment modification.
+struct env_entry {
+    hash: u64,
+    key: Vec<u8>,
+    value: Box<[u8]>, // NUL-terminated
+}
+
+static ENV_CACHE_BUSY: AtomicBool = AtomicBool::new(false);
+static mut ENV_CACHE: Option<Vec<env_entry>> = None;
+static mut CWD_CACHE: Option<Box<[u8]>> = None; // NUL-terminated
+
+fn env_key_hash(key: &[u8]) -> u64 {
+    let mut hash: u64 = 0xcbf2_9ce4_8422_2325;
+    for &byte in key {
+        hash ^= u64::from(byte);
+        hash = hash.wrapping_mul(0x0000_0100_0000_01b3);
+    }
+    hash
+}
+
+unsafe fn env_cache_lock() {
+    while ENV_CACHE_BUSY.compare_and_swap(false, true, Ordering::Acquire) {
+        spin_loop_hint();
+    }
+}
+
+unsafe fn env_cache_unlock() {
+    ENV_CACHE_BUSY.store(false, Ordering::Release);
+}
+
+/// Build the snapshot from the untrusted environ block. Caller holds
+/// the cache lock. Returns false if the ocall yields no environment,
+/// in which case callers fall back to the per-read ocall.
+unsafe fn env_cache_populate() -> bool {
+    if ENV_CACHE.is_some() {
+        return true;
+    }
+    let mut envp = environ();
+    if envp.is_null() {
+        return false;
+    }
+
+    let mut entries: Vec<env_entry> = Vec::new();
+    while !(*envp).is_null() {
+        let bytes = slice::from_raw_parts(*envp as *const u8, strlen(*envp));
+        if let Some(eq) = bytes.iter().position(|&b| b == b'=') {
+            let key = bytes[..eq].to_vec();
+            let mut value = bytes[eq + 1..].to_vec();
+            value.push(0);
+            entries.push(env_entry {
+                hash: env_key_hash(&key),
+                key,
+                value: value.into_boxed_slice(),
+            });
+        }
+        envp = envp.add(1);
+    }
+    ENV_CACHE = Some(entries);
+    true
+}
+
+unsafe fn env_cache_invalidate() {
+    env_cache_lock();
+    ENV_CACHE = None;
+    env_cache_unlock();
+}
+
+unsafe fn cwd_cache_invalidate() {
+    env_cache_lock();
+    CWD_CACHE = None;
+    env_cache_unlock();
+}
+
 pub unsafe fn getenv(name: *const c_char) -> *const c_char {
+    if !name.is_null() {
+        let key = slice::from_raw_parts(name as *const u8, strlen(name));
+        let hash = env_key_hash(key);
+
+        env_cache_lock();
+        if env_cache_populate() {
+            let mut found: *const c_char = ptr::null();
+            if let Some(ref entries) = ENV_CACHE {
+                for entry in entries.iter() {
+                    if entry.hash == hash && entry.key[..] == *key {
+                        found = entry.value.as_ptr() as *const c_char;
+                        break;
+                    }
+                }
+            }
+            env_cache_unlock();
+            // The snapshot is authoritative between invalidations:
+            // absent means unset, no ocall needed to confirm.
+            return found;
+        }
+        env_cache_unlock();
+    }
+
     let mut result: *const c_char = ptr::null();
     let status = u_getenv_ocall(&mut result as *mut *const c_char, name);
 
@@ -624,6 +936,8 @@ pub unsafe fn setenv(name: *const c_char, value: *const c_char, overwrite: c_int
     if status == sgx_status_t::SGX_SUCCESS {
         if result == -1 {
             set_errno(error);
+        } else {
+            env_cache_invalidate();
         }
     } else {
         set_errno(ESGX);
@@ -642,6 +956,8 @@ pub unsafe fn unsetenv(name: *const c_char) -> c_int {
     if status == sgx_status_t::SGX_SUCCESS {
         if result == -1 {
             set_errno(error);
+        } else {
+            env_cache_invalidate();
         }
     } else {
         set_errno(ESGX);
@@ -651,6 +967,36 @@ pub unsafe fn unsetenv(name: *const c_char) -> c_int {
 }
 
 pub unsafe fn getcwd(buf: *mut c_char, size: size_t) -> *mut c_char {
+    // Serve repeat lookups from the snapshot; chdir invalidates it.
+    if !buf.is_null() && size > 0 {
+        env_cache_lock();
+        if CWD_CACHE.is_none() {
+            let mut scratch = vec![0_u8; PATH_MAX as usize];
+            let mut result: *mut c_char = ptr::null_mut();
+            let mut error: c_int = 0;
+            let status = u_getcwd_ocall(&mut result as *mut *mut c_char,
+                                        &mut error as *mut c_int,
+                                        scratch.as_mut_ptr() as *mut c_char,
+                                        scratch.len());
+            if status == sgx_status_t::SGX_SUCCESS && !result.is_null() {
+                let len = strlen(scratch.as_ptr() as *const c_char);
+                scratch.truncate(len + 1);
+                CWD_CACHE = Some(scratch.into_boxed_slice());
+            }
+        }
+        if let Some(ref cwd) = CWD_CACHE {
+            if cwd.len() <= size {
+                ptr::copy_nonoverlapping(cwd.as_ptr(), buf as *mut u8, cwd.len());
+                env_cache_unlock();
+                return buf;
+            }
+            env_cache_unlock();
+            set_errno(ERANGE);
+            return ptr::null_mut();
+        }
+        env_cache_unlock();
+    }
+
     let mut result: *mut c_char = ptr::null_mut();
     let mut error: c_int = 0;
     let status = u_getcwd_ocall(&mut result as *mut *mut c_char, &mut error as *mut c_int, buf, size);
@@ -674,6 +1020,8 @@ pub unsafe fn chdir(dir: *const c_char) -> c_int {
     if status == sgx_status_t::SGX_SUCCESS {
         if result == -1 {
             set_errno(error);
+        } else {
+            cwd_cache_invalidate();
         }
     } else {
         set_errno(ESGX);
@@ -758,14 +1106,212 @@ pub unsafe fn open(path: *const c_char, flags: c_int) -> c_int {
     result
 }
 
+// Per-ocall switchless eligibility accounting. Which ocalls get
+// transition_using_threads has so far been a hand-picked, permanently
+// stale decision. The hot file wrappers below record call count and
+// elapsed time against the coarse clock; in auto mode a slot
+// re-evaluates itself every OCALL_STATS_WINDOW calls and routes the
+// next window through its u_fs_* switchless twin when the recent
+// average is short (the call would not occupy an exit for long) and
+// the window filled quickly (there is enough traffic to keep a uworker
+// busy). Long or infrequent calls take the normal exit. The counters
+// are updated racily on purpose: a blurred window only delays a
+// promotion decision by one window. Routing is compiled in only with
+// the fs_switchless feature, since the u_fs_* proxies exist only when
+// the enclave imports sgx_fs_switchless.edl; without it, auto mode
+// still accounts but never reroutes.
+pub const OCALL_STATS_OFF: c_int = 0;
+pub const OCALL_STATS_RECORD: c_int = 1;
+pub const OCALL_STATS_AUTO: c_int = 2;
+
+pub const OCALL_STAT_OPEN64: usize = 0;
+pub const OCALL_STAT_CLOSE: usize = 1;
+pub const OCALL_STAT_READ: usize = 2;
+pub const OCALL_STAT_PREAD64: usize = 3;
+pub const OCALL_STAT_WRITE: usize = 4;
+pub const OCALL_STAT_PWRITE64: usize = 5;
+pub const OCALL_STAT_LSEEK64: usize = 6;
+pub const OCALL_STAT_FTRUNCATE64: usize = 7;
+pub const OCALL_STAT_FSTAT64: usize = 8;
+pub const OCALL_STAT_FSYNC: usize = 9;
+const OCALL_STAT_SLOTS: usize = 10;
+
+const OCALL_STATS_WINDOW: u64 = 256;
+const OCALL_SWITCHLESS_MAX_AVG_NS: u64 = 200_000;
+const OCALL_SWITCHLESS_WINDOW_SPAN_NS: u64 = 1_000_000_000;
+
+struct ocall_stat {
+    calls: AtomicU64,
+    total_ns: AtomicU64,
+    window_calls: AtomicU64,
+    window_ns: AtomicU64,
+    window_start_ns: AtomicU64,
+    switchless: AtomicBool,
+}
+
+const OCALL_STAT_INIT: ocall_stat = ocall_stat {
+    calls: AtomicU64::new(0),
+    total_ns: AtomicU64::new(0),
+    window_calls: AtomicU64::new(0),
+    window_ns: AtomicU64::new(0),
+    window_start_ns: AtomicU64::new(0),
+    switchless: AtomicBool::new(false),
+};
+
+static OCALL_STATS: [ocall_stat; OCALL_STAT_SLOTS] = [
+    OCALL_STAT_INIT, OCALL_STAT_INIT, OCALL_STAT_INIT, OCALL_STAT_INIT, OCALL_STAT_INIT,
+    OCALL_STAT_INIT, OCALL_STAT_INIT, OCALL_STAT_INIT, OCALL_STAT_INIT, OCALL_STAT_INIT,
+];
+static OCALL_STATS_MODE: AtomicUsize = AtomicUsize::new(OCALL_STATS_OFF as usize);
+
+#[cfg(feature = "fs_switchless")]
+extern "C" {
+    pub fn u_fs_open64_ocall(result: *mut c_int,
+                             error: *mut c_int,
+                             path: *const c_char,
+                             oflag: c_int,
+                             mode: c_int) -> sgx_status_t;
+    pub fn u_fs_close_ocall(result: *mut c_int, error: *mut c_int, fd: c_int) -> sgx_status_t;
+    pub fn u_fs_read_ocall(result: *mut ssize_t,
+                           error: *mut c_int,
+                           fd: c_int,
+                           buf: *mut c_void,
+                           count: size_t) -> sgx_status_t;
+    pub fn u_fs_pread64_ocall(result: *mut ssize_t,
+                              error: *mut c_int,
+                              fd: c_int,
+                              buf: *mut c_void,
+                              count: size_t,
+                              offset: off64_t) -> sgx_status_t;
+    pub fn u_fs_write_ocall(result: *mut ssize_t,
+                            error: *mut c_int,
+                            fd: c_int,
+                            buf: *const c_void,
+                            count: size_t) -> sgx_status_t;
+    pub fn u_fs_pwrite64_ocall(result: *mut ssize_t,
+                               error: *mut c_int,
+                               fd: c_int,
+                               buf: *const c_void,
+                               count: size_t,
+                               offset: off64_t) -> sgx_status_t;
+    pub fn u_fs_lseek64_ocall(result: *mut off64_t,
+                              error: *mut c_int,
+                              fd: c_int,
+                              offset: off64_t,
+                              whence: c_int) -> sgx_status_t;
+    pub fn u_fs_ftruncate64_ocall(result: *mut c_int,
+                                  error: *mut c_int,
+                                  fd: c_int,
+                                  length: off64_t) -> sgx_status_t;
+    pub fn u_fs_fstat64_ocall(result: *mut c_int,
+                              error: *mut c_int,
+                              fd: c_int,
+                              buf: *mut stat64) -> sgx_status_t;
+    pub fn u_fs_fsync_ocall(result: *mut c_int, error: *mut c_int, fd: c_int) -> sgx_status_t;
+}
+
+#[cfg(feature = "fs_switchless")]
+fn ocall_use_switchless(idx: usize) -> bool {
+    OCALL_STATS_MODE.load(Ordering::Relaxed) == OCALL_STATS_AUTO as usize
+        && OCALL_STATS[idx].switchless.load(Ordering::Relaxed)
+}
+
+macro_rules! ocall_dispatch {
+    ($idx:expr, $switchless:ident, $normal:ident, ($($arg:expr),* $(,)?)) => {{
+        #[cfg(feature = "fs_switchless")]
+        let status = if ocall_use_switchless($idx) {
+            $switchless($($arg),*)
+        } else {
+            $normal($($arg),*)
+        };
+        #[cfg(not(feature = "fs_switchless"))]
+        let status = {
+            let _ = $idx;
+            $normal($($arg),*)
+        };
+        status
+    }};
+}
+
+unsafe fn ocall_stats_begin() -> u64 {
+    if OCALL_STATS_MODE.load(Ordering::Relaxed) == OCALL_STATS_OFF as usize {
+        0
+    } else {
+        stat_cache_now_ns()
+    }
+}
+
+unsafe fn ocall_stats_end(idx: usize, start_ns: u64) {
+    let mode = OCALL_STATS_MODE.load(Ordering::Relaxed);
+    if mode == OCALL_STATS_OFF as usize || start_ns == 0 {
+        return;
+    }
+    let elapsed = stat_cache_now_ns().saturating_sub(start_ns);
+    let slot = &OCALL_STATS[idx];
+    slot.calls.fetch_add(1, Ordering::Relaxed);
+    slot.total_ns.fetch_add(elapsed, Ordering::Relaxed);
+    let wcalls = slot.window_calls.fetch_add(1, Ordering::Relaxed) + 1;
+    let wns = slot.window_ns.fetch_add(elapsed, Ordering::Relaxed) + elapsed;
+    if wcalls == 1 {
+        slot.window_start_ns.store(start_ns, Ordering::Relaxed);
+    }
+    if mode == OCALL_STATS_AUTO as usize && wcalls >= OCALL_STATS_WINDOW {
+        let span = (start_ns + elapsed)
+            .saturating_sub(slot.window_start_ns.load(Ordering::Relaxed));
+        let frequent = span <= OCALL_SWITCHLESS_WINDOW_SPAN_NS;
+        let short = wns / wcalls <= OCALL_SWITCHLESS_MAX_AVG_NS;
+        slot.switchless.store(frequent && short, Ordering::Relaxed);
+        slot.window_calls.store(0, Ordering::Relaxed);
+        slot.window_ns.store(0, Ordering::Relaxed);
+    }
+}
+
+pub unsafe fn ocall_stats_set_mode(mode: c_int) {
+    let mode = if mode == OCALL_STATS_RECORD || mode == OCALL_STATS_AUTO {
+        mode
+    } else {
+        OCALL_STATS_OFF
+    };
+    OCALL_STATS_MODE.store(mode as usize, Ordering::Relaxed);
+    if mode != OCALL_STATS_AUTO {
+        for slot in OCALL_STATS.iter() {
+            slot.switchless.store(false, Ordering::Relaxed);
+            slot.window_calls.store(0, Ordering::Relaxed);
+            slot.window_ns.store(0, Ordering::Relaxed);
+        }
+    }
+}
+
+pub unsafe fn ocall_stats_get(idx: size_t,
+                              calls: *mut u64,
+                              total_ns: *mut u64,
+                              switchless: *mut c_int) -> c_int {
+    if idx >= OCALL_STAT_SLOTS {
+        return -1;
+    }
+    let slot = &OCALL_STATS[idx];
+    if !calls.is_null() {
+        *calls = slot.calls.load(Ordering::Relaxed);
+    }
+    if !total_ns.is_null() {
+        *total_ns = slot.total_ns.load(Ordering::Relaxed);
+    }
+    if !switchless.is_null() {
+        *switchless = slot.switchless.load(Ordering::Relaxed) as c_int;
+    }
+    0
+}
+
 pub unsafe fn open64(path: *const c_char, oflag: c_int, mode: c_int) -> c_int {
     let mut result: c_int = 0;
     let mut error: c_int = 0;
-    let status = u_open64_ocall(&mut result as *mut c_int,
-                                &mut error as *mut c_int,
-                                path,
-                                oflag,
-                                mode);
+    let start_ns = ocall_stats_begin();
+    let status = ocall_dispatch!(OCALL_STAT_OPEN64, u_fs_open64_ocall, u_open64_ocall,
+                                 (&mut result as *mut c_int,
+                                  &mut error as *mut c_int,
+                                  path,
+                                  oflag,
+                                  mode));
 
     if status == sgx_status_t::SGX_SUCCESS {
         if result == -1 {
@@ -775,6 +1321,7 @@ pub unsafe fn open64(path: *const c_char, oflag: c_int, mode: c_int) -> c_int {
         set_errno(ESGX);
         result = -1;
     }
+    ocall_stats_end(OCALL_STAT_OPEN64, start_ns);
     result
 }
 
@@ -800,10 +1347,12 @@ pub unsafe fn fstat(fd: c_int, buf: *mut stat) -> c_int {
 pub unsafe fn fstat64(fd: c_int, buf: *mut stat64) -> c_int {
     let mut result: c_int = 0;
     let mut error: c_int = 0;
-    let status = u_fstat64_ocall(&mut result as *mut c_int,
-                                 &mut error as *mut c_int,
-                                 fd,
-                                 buf);
+    let start_ns = ocall_stats_begin();
+    let status = ocall_dispatch!(OCALL_STAT_FSTAT64, u_fs_fstat64_ocall, u_fstat64_ocall,
+                                 (&mut result as *mut c_int,
+                                  &mut error as *mut c_int,
+                                  fd,
+                                  buf));
 
     if status == sgx_status_t::SGX_SUCCESS {
         if result == -1 {
@@ -813,9 +1362,132 @@ pub unsafe fn fstat64(fd: c_int, buf: *mut stat64) -> c_int {
         set_errno(ESGX);
         result = -1;
     }
+    ocall_stats_end(OCALL_STAT_FSTAT64, start_ns);
     result
 }
 
+// Opt-in trusted cache of stat64/lstat64 results, keyed by path.
+// Path resolution re-stats the same components constantly; with the
+// cache on, a repeat lookup within the TTL is answered in-enclave.
+// unlink/rename/chmod invalidate the touched paths eagerly; the TTL
+// (checked against the coarse monotonic clock, itself transition-free)
+// bounds staleness from writers this layer cannot see, such as other
+// processes or fd-based mutation. Off by default because it trades
+// strict metadata freshness for transitions; enable via
+// stat_cache_enable on hot read-mostly paths.
+struct stat_cache_entry {
+    hash: u64,
+    lstat: bool,
+    path: Vec<u8>,
+    st: stat64,
+    expires_ns: u64,
+}
+
+const STAT_CACHE_TTL_NS: u64 = 1_000_000_000;
+const STAT_CACHE_MAX: usize = 128;
+
+static STAT_CACHE_ENABLED: AtomicBool = AtomicBool::new(false);
+static STAT_CACHE_BUSY: AtomicBool = AtomicBool::new(false);
+static mut STAT_CACHE: Option<Vec<stat_cache_entry>> = None;
+
+unsafe fn stat_cache_lock() {
+    while STAT_CACHE_BUSY.compare_and_swap(false, true, Ordering::Acquire) {
+        spin_loop_hint();
+    }
+}
+
+unsafe fn stat_cache_unlock() {
+    STAT_CACHE_BUSY.store(false, Ordering::Release);
+}
+
+pub unsafe fn stat_cache_enable(enable: c_int) {
+    stat_cache_lock();
+    STAT_CACHE_ENABLED.store(enable != 0, Ordering::Relaxed);
+    if enable == 0 {
+        STAT_CACHE = None;
+    }
+    stat_cache_unlock();
+}
+
+unsafe fn stat_cache_now_ns() -> u64 {
+    let mut tp: timespec = mem::zeroed();
+    if clock_gettime_coarse(CLOCK_MONOTONIC, &mut tp) != 0 {
+        return 0;
+    }
+    tp.tv_sec as u64 * 1_000_000_000 + tp.tv_nsec as u64
+}
+
+unsafe fn stat_cache_lookup(path: &[u8], lstat: bool, buf: *mut stat64) -> bool {
+    let hash = env_key_hash(path);
+    let now = stat_cache_now_ns();
+    let mut hit = false;
+    stat_cache_lock();
+    if let Some(ref entries) = STAT_CACHE {
+        for entry in entries.iter() {
+            if entry.hash == hash && entry.lstat == lstat && entry.path[..] == *path {
+                if now < entry.expires_ns {
+                    *buf = entry.st;
+                    hit = true;
+                }
+                break;
+            }
+        }
+    }
+    stat_cache_unlock();
+    hit
+}
+
+unsafe fn stat_cache_store(path: &[u8], lstat: bool, st: &stat64) {
+    let hash = env_key_hash(path);
+    let expires_ns = match stat_cache_now_ns() {
+        0 => 0, // no clock, entry is born expired
+        now => now + STAT_CACHE_TTL_NS,
+    };
+    stat_cache_lock();
+    let entries = STAT_CACHE.get_or_insert_with(Vec::new);
+    if let Some(entry) = entries
+        .iter_mut()
+        .find(|e| e.hash == hash && e.lstat == lstat && e.path[..] == *path)
+    {
+        entry.st = *st;
+        entry.expires_ns = expires_ns;
+    } else {
+        if entries.len() >= STAT_CACHE_MAX {
+            // Evict the entry closest to expiry.
+            if let Some(oldest) = entries
+                .iter()
+                .enumerate()
+                .min_by_key(|&(_, e)| e.expires_ns)
+                .map(|(i, _)| i)
+            {
+                entries.swap_remove(oldest);
+            }
+        }
+        entries.push(stat_cache_entry {
+            hash,
+            lstat,
+            path: path.to_vec(),
+            st: *st,
+            expires_ns,
+        });
+    }
+    stat_cache_unlock();
+}
+
+/// Drop both the stat and lstat entries for a path after a mutation.
+unsafe fn stat_cache_invalidate(path: *const c_char) {
+    if path.is_null() || !STAT_CACHE_ENABLED.load(Ordering::Relaxed) {
+        return;
+    }
+    let key = slice::from_raw_parts(path as *const u8, strlen(path));
+    let hash = env_key_hash(key);
+    stat_cache_lock();
+    if let Some(ref mut entries) = STAT_CACHE {
+        entries.retain(|e| e.hash != hash || e.path[..] != *key);
+    }
+    stat_cache_unlock();
+}
+
 pub unsafe fn stat(path: *const c_char, buf: *mut stat) -> c_int {
     let mut result: c_int = 0;
     let mut error: c_int = 0;
@@ -836,6 +1508,14 @@ pub unsafe fn stat(path: *const c_char, buf: *mut stat) -> c_int {
 }
 
 pub unsafe fn stat64(path: *const c_char, buf: *mut stat64) -> c_int {
+    let cached = STAT_CACHE_ENABLED.load(Ordering::Relaxed) && !path.is_null();
+    if cached {
+        let key = slice::from_raw_parts(path as *const u8, strlen(path));
+        if stat_cache_lookup(key, false, buf) {
+            return 0;
+        }
+    }
+
     let mut result: c_int = 0;
     let mut error: c_int = 0;
     let status = u_stat64_ocall(&mut result as *mut c_int,
@@ -846,6 +1526,9 @@ pub unsafe fn stat64(path: *const c_char, buf: *mut stat64) -> c_int {
     if status == sgx_status_t::SGX_SUCCESS {
         if result == -1 {
             set_errno(error);
+        } else if cached {
+            let key = slice::from_raw_parts(path as *const u8, strlen(path));
+            stat_cache_store(key, false, &*buf);
         }
     } else {
         set_errno(ESGX);
@@ -874,6 +1557,14 @@ pub unsafe fn lstat(path: *const c_char, buf: *mut stat) -> c_int {
 }
 
 pub unsafe fn lstat64(path: *const c_char, buf: *mut stat64) -> c_int {
+    let cached = STAT_CACHE_ENABLED.load(Ordering::Relaxed) && !path.is_null();
+    if cached {
+        let key = slice::from_raw_parts(path as *const u8, strlen(path));
+        if stat_cache_lookup(key, true, buf) {
+            return 0;
+        }
+    }
+
     let mut result: c_int = 0;
     let mut error: c_int = 0;
     let status = u_lstat64_ocall(&mut result as *mut c_int,
@@ -884,6 +1575,9 @@ pub unsafe fn lstat64(path: *const c_char, buf: *mut stat64) -> c_int {
     if status == sgx_status_t::SGX_SUCCESS {
         if result == -1 {
             set_errno(error);
+        } else if cached {
+            let key = slice::from_raw_parts(path as *const u8, strlen(path));
+            stat_cache_store(key, true, &*buf);
         }
     } else {
         set_errno(ESGX);
@@ -915,11 +1609,13 @@ pub unsafe fn lseek(fd: c_int, offset: off_t, whence: c_int) -> off_t {
 pub unsafe fn lseek64(fd: c_int, offset: off64_t, whence: c_int) -> off64_t {
     let mut result: off64_t = 0;
     let mut error: c_int = 0;
-    let status = u_lseek64_ocall(&mut result as *mut off64_t,
-                                 &mut error as *mut c_int,
-                                 fd,
-                                 offset,
-                                 whence);
+    let start_ns = ocall_stats_begin();
+    let status = ocall_dispatch!(OCALL_STAT_LSEEK64, u_fs_lseek64_ocall, u_lseek64_ocall,
+                                 (&mut result as *mut off64_t,
+                                  &mut error as *mut c_int,
+                                  fd,
+                                  offset,
+                                  whence));
 
     if status == sgx_status_t::SGX_SUCCESS {
         if result == -1 {
@@ -929,6 +1625,7 @@ pub unsafe fn lseek64(fd: c_int, offset: off64_t, whence: c_int) -> off64_t {
         set_errno(ESGX);
         result = -1;
     }
+    ocall_stats_end(OCALL_STAT_LSEEK64, start_ns);
     result
 }
 
@@ -951,13 +1648,62 @@ pub unsafe fn ftruncate(fd: c_int, length: off_t) -> c_int {
     result
 }
 
-pub unsafe fn ftruncate64(fd: c_int, length: off64_t) -> c_int {
+/// Preallocate (or punch/zero, per `mode`) a file extent, so an
+/// append-heavy writer grows into contiguous space instead of
+/// fragmenting extent by extent.
+pub unsafe fn fallocate64(fd: c_int, mode: c_int, offset: off64_t, len: off64_t) -> c_int {
     let mut result: c_int = 0;
     let mut error: c_int = 0;
-    let status = u_ftruncate64_ocall(&mut result as *mut c_int,
+    let status = u_fallocate64_ocall(&mut result as *mut c_int,
                                      &mut error as *mut c_int,
                                      fd,
-                                     length);
+                                     mode,
+                                     offset,
+                                     len);
+
+    if status == sgx_status_t::SGX_SUCCESS {
+        if result == -1 {
+            set_errno(error);
+        }
+    } else {
+        set_errno(ESGX);
+        result = -1;
+    }
+    result
+}
+
+/// Advise the kernel about the access pattern for a file range
+/// (POSIX_FADV_SEQUENTIAL, DONTNEED, ...). Follows posix_fadvise
+/// semantics: the error code is the return value, errno untouched.
+pub unsafe fn posix_fadvise64(fd: c_int, offset: off64_t, len: off64_t, advice: c_int) -> c_int {
+    let mut result: c_int = 0;
+    let mut error: c_int = 0;
+    let status = u_posix_fadvise_ocall(&mut result as *mut c_int,
+                                       &mut error as *mut c_int,
+                                       fd,
+                                       offset,
+                                       len,
+                                       advice);
+
+    if status == sgx_status_t::SGX_SUCCESS {
+        if result != 0 {
+            result = error;
+        }
+    } else {
+        result = ESGX;
+    }
+    result
+}
+
+pub unsafe fn ftruncate64(fd: c_int, length: off64_t) -> c_int {
+    let mut result: c_int = 0;
+    let mut error: c_int = 0;
+    let start_ns = ocall_stats_begin();
+    let status = ocall_dispatch!(OCALL_STAT_FTRUNCATE64, u_fs_ftruncate64_ocall, u_ftruncate64_ocall,
+                                 (&mut result as *mut c_int,
+                                  &mut error as *mut c_int,
+                                  fd,
+                                  length));
 
     if status == sgx_status_t::SGX_SUCCESS {
         if result == -1 {
@@ -967,6 +1713,7 @@ pub unsafe fn ftruncate64(fd: c_int, length: off64_t) -> c_int {
         set_errno(ESGX);
         result = -1;
     }
+    ocall_stats_end(OCALL_STAT_FTRUNCATE64, start_ns);
     result
 }
 
@@ -1011,9 +1758,11 @@ pub unsafe fn truncate64(path: *const c_char, length: off64_t) -> c_int {
 pub unsafe fn fsync(fd: c_int) -> c_int {
     let mut result: c_int = 0;
     let mut error: c_int = 0;
-    let status = u_fsync_ocall(&mut result as *mut c_int,
-                               &mut error as *mut c_int,
-                               fd);
+    let start_ns = ocall_stats_begin();
+    let status = ocall_dispatch!(OCALL_STAT_FSYNC, u_fs_fsync_ocall, u_fsync_ocall,
+                                 (&mut result as *mut c_int,
+                                  &mut error as *mut c_int,
+                                  fd));
 
     if status == sgx_status_t::SGX_SUCCESS {
         if result == -1 {
@@ -1023,6 +1772,7 @@ pub unsafe fn fsync(fd: c_int) -> c_int {
         set_errno(ESGX);
         result = -1;
     }
+    ocall_stats_end(OCALL_STAT_FSYNC, start_ns);
     result
 }
 
@@ -1044,6 +1794,28 @@ pub unsafe fn fdatasync(fd: c_int) -> c_int {
     result
 }
 
+/// Durability with group commit: concurrent callers on the same fd
+/// share one device flush (see u_fsync_group_ocall in
+/// sgx_ustdc/file.c). Semantically equivalent to fdatasync, but N
+/// threads syncing a hot log pay one flush instead of N.
+pub unsafe fn fsync_group(fd: c_int) -> c_int {
+    let mut result: c_int = 0;
+    let mut error: c_int = 0;
+    let status = u_fsync_group_ocall(&mut result as *mut c_int,
+                                     &mut error as *mut c_int,
+                                     fd);
+
+    if status == sgx_status_t::SGX_SUCCESS {
+        if result == -1 {
+            set_errno(error);
+        }
+    } else {
+        set_errno(ESGX);
+        result = -1;
+    }
+    result
+}
+
 pub unsafe fn fchmod(fd: c_int, mode: mode_t) -> c_int {
     let mut result: c_int = 0;
     let mut error: c_int = 0;
@@ -1073,6 +1845,8 @@ pub unsafe fn unlink(pathname: *const c_char) -> c_int {
     if status == sgx_status_t::SGX_SUCCESS {
         if result == -1 {
             set_errno(error);
+        } else {
+            stat_cache_invalidate(pathname);
         }
     } else {
         set_errno(ESGX);
@@ -1111,6 +1885,9 @@ pub unsafe fn rename(oldpath: *const c_char, newpath: *const c_char) -> c_int {
     if status == sgx_status_t::SGX_SUCCESS {
         if result == -1 {
             set_errno(error);
+        } else {
+            stat_cache_invalidate(oldpath);
+            stat_cache_invalidate(newpath);
         }
     } else {
         set_errno(ESGX);
@@ -1130,6 +1907,8 @@ pub unsafe fn chmod(path: *const c_char, mode: mode_t) -> c_int {
     if status == sgx_status_t::SGX_SUCCESS {
         if result == -1 {
             set_errno(error);
+        } else {
+            stat_cache_invalidate(path);
         }
     } else {
         set_errno(ESGX);
@@ -1271,7 +2050,27 @@ pub unsafe fn readdir64_r(dirp: *mut DIR,
     }
     result
 }
-                           
+
+/// Fill up to `count` entries in one transition. `*nread` reports how
+/// many are valid; fewer than `count` means end of stream or, when the
+/// return value is nonzero, an error after `*nread` valid entries.
+pub unsafe fn readdir64_batch(dirp: *mut DIR,
+                              entries: *mut dirent64,
+                              count: size_t,
+                              nread: *mut size_t) -> c_int {
+    let mut result: c_int = 0;
+    let status = u_readdir64_batch_ocall(&mut result as *mut c_int,
+                                         dirp,
+                                         entries,
+                                         count,
+                                         nread);
+    if status != sgx_status_t::SGX_SUCCESS {
+        *nread = 0;
+        result = ESGX;
+    }
+    result
+}
+
 pub unsafe fn closedir(dirp: *mut DIR) -> c_int {
     let mut result: c_int = 0;
     let mut error: c_int = 0;
@@ -1348,19 +2147,24 @@ pub unsafe fn read(fd: c_int, buf: *mut c_void, count: size_t) -> ssize_t {
     let tmp_buf = if count <= MAX_OCALL_ALLOC_SIZE {
         sgx_ocalloc(count)
     } else {
-        malloc(count)
+        arena_acquire(count)
     };
     if tmp_buf.is_null() {
         set_errno(ENOMEM );
         return -1;
     }
-    tmp_buf.write_bytes(0_u8, count);
+    // No pre-zeroing of the staging buffer: only the result-bounded
+    // prefix the host claims to have written is ever copied back, so
+    // stale staging bytes cannot reach the enclave buffer and the
+    // payload is touched once instead of twice.
 
-    let status = u_read_ocall(&mut result as *mut ssize_t,
-                              &mut error as *mut c_int,
-                              fd,
-                              tmp_buf,
-                              count);
+    let start_ns = ocall_stats_begin();
+    let status = ocall_dispatch!(OCALL_STAT_READ, u_fs_read_ocall, u_read_ocall,
+                                 (&mut result as *mut ssize_t,
+                                  &mut error as *mut c_int,
+                                  fd,
+                                  tmp_buf,
+                                  count));
 
     if status == sgx_status_t::SGX_SUCCESS {
         if result == -1 {
@@ -1370,14 +2174,23 @@ pub unsafe fn read(fd: c_int, buf: *mut c_void, count: size_t) -> ssize_t {
         set_errno(ESGX);
         result = -1;
     }
+    ocall_stats_end(OCALL_STAT_READ, start_ns);
 
     if result != -1 {
-        ptr::copy_nonoverlapping(tmp_buf as *const u8, buf as *mut u8, count);
+        let nread = result as usize;
+        if nread <= count {
+            if nread > 0 {
+                ptr::copy_nonoverlapping(tmp_buf as *const u8, buf as *mut u8, nread);
+            }
+        } else {
+            set_errno(ESGX);
+            result = -1;
+        }
     }
     if count <= MAX_OCALL_ALLOC_SIZE {
         sgx_ocfree();
     } else {
-        free(tmp_buf);
+        arena_release(tmp_buf);
     }
     result
 }
@@ -1398,20 +2211,21 @@ pub unsafe fn pread64(fd: c_int, buf: *mut c_void, count: size_t, offset: off64_
     let tmp_buf = if count <= MAX_OCALL_ALLOC_SIZE {
         sgx_ocalloc(count)
     } else {
-        malloc(count)
+        arena_acquire(count)
     };
     if tmp_buf.is_null() {
         set_errno(ENOMEM );
         return -1;
     }
-    tmp_buf.write_bytes(0_u8, count);
 
-    let status = u_pread64_ocall(&mut result as *mut ssize_t,
-                                 &mut error as *mut c_int,
-                                 fd,
-                                 tmp_buf,
-                                 count,
-                                 offset);
+    let start_ns = ocall_stats_begin();
+    let status = ocall_dispatch!(OCALL_STAT_PREAD64, u_fs_pread64_ocall, u_pread64_ocall,
+                                 (&mut result as *mut ssize_t,
+                                  &mut error as *mut c_int,
+                                  fd,
+                                  tmp_buf,
+                                  count,
+                                  offset));
 
     if status == sgx_status_t::SGX_SUCCESS {
         if result == -1 {
@@ -1421,14 +2235,23 @@ pub unsafe fn pread64(fd: c_int, buf: *mut c_void, count: size_t, offset: off64_
         set_errno(ESGX);
         result = -1;
     }
+    ocall_stats_end(OCALL_STAT_PREAD64, start_ns);
 
     if result != -1 {
-        ptr::copy_nonoverlapping(tmp_buf as *const u8, buf as *mut u8, count);
+        let nread = result as usize;
+        if nread <= count {
+            if nread > 0 {
+                ptr::copy_nonoverlapping(tmp_buf as *const u8, buf as *mut u8, nread);
+            }
+        } else {
+            set_errno(ESGX);
+            result = -1;
+        }
     }
     if count <= MAX_OCALL_ALLOC_SIZE {
         sgx_ocfree();
     } else {
-        free(tmp_buf);
+        arena_release(tmp_buf);
     }
     result
 }
@@ -1461,8 +2284,6 @@ pub unsafe fn readv(fd: c_int, iov: *const iovec, iovcnt: c_int) -> ssize_t {
         set_errno(ENOMEM );
         return -1;
     }
-    iobase.write_bytes(0_u8, iosize);
-
     let mut tmpiovec: Vec<iovec> = Vec::with_capacity(iovcnt as usize);
     ptr = iobase;
     for io in v {
@@ -1488,8 +2309,19 @@ pub unsafe fn readv(fd: c_int, iov: *const iovec, iovcnt: c_int) -> ssize_t {
     }
 
     if result != -1 {
-        for i in 0..v.len() {
-            ptr::copy_nonoverlapping(tmpiovec[i].iov_base as *const u8, v[i].iov_base as *mut u8, v[i].iov_len as usize);
+        let mut remaining = result as usize;
+        if remaining <= iosize {
+            for i in 0..v.len() {
+                if remaining == 0 {
+                    break;
+                }
+                let n = core::cmp::min(v[i].iov_len as usize, remaining);
+                ptr::copy_nonoverlapping(tmpiovec[i].iov_base as *const u8, v[i].iov_base as *mut u8, n);
+                remaining -= n;
+            }
+        } else {
+            set_errno(ESGX);
+            result = -1;
         }
     }
 
@@ -1525,8 +2357,6 @@ pub unsafe fn preadv64(fd: c_int, iov: *const iovec, iovcnt: c_int, offset: off6
         set_errno(ENOMEM );
         return -1;
     }
-    iobase.write_bytes(0_u8, iosize);
-
     let mut tmpiovec: Vec<iovec> = Vec::with_capacity(iovcnt as usize);
     ptr = iobase;
     for io in v {
@@ -1553,8 +2383,19 @@ pub unsafe fn preadv64(fd: c_int, iov: *const iovec, iovcnt: c_int, offset: off6
     }
 
     if result != -1 {
-        for i in 0..v.len() {
-            ptr::copy_nonoverlapping(tmpiovec[i].iov_base as *const u8, v[i].iov_base as *mut u8, v[i].iov_len as usize);
+        let mut remaining = result as usize;
+        if remaining <= iosize {
+            for i in 0..v.len() {
+                if remaining == 0 {
+                    break;
+                }
+                let n = core::cmp::min(v[i].iov_len as usize, remaining);
+                ptr::copy_nonoverlapping(tmpiovec[i].iov_base as *const u8, v[i].iov_base as *mut u8, n);
+                remaining -= n;
+            }
+        } else {
+            set_errno(ESGX);
+            result = -1;
         }
     }
 
@@ -1578,7 +2419,7 @@ pub unsafe fn write(fd: c_int, buf: *const c_void, count: size_t) -> ssize_t {
     let tmp_buf = if count <= MAX_OCALL_ALLOC_SIZE {
         sgx_ocalloc(count)
     } else {
-        malloc(count)
+        arena_acquire(count)
     };
     if tmp_buf.is_null() {
         set_errno(ENOMEM );
@@ -1586,11 +2427,13 @@ pub unsafe fn write(fd: c_int, buf: *const c_void, count: size_t) -> ssize_t {
     }
     ptr::copy_nonoverlapping(buf as *const u8, tmp_buf as *mut u8, count);
 
-    let status = u_write_ocall(&mut result as *mut ssize_t,
-                               &mut error as *mut c_int,
-                               fd,
-                               tmp_buf,
-                               count);
+    let start_ns = ocall_stats_begin();
+    let status = ocall_dispatch!(OCALL_STAT_WRITE, u_fs_write_ocall, u_write_ocall,
+                                 (&mut result as *mut ssize_t,
+                                  &mut error as *mut c_int,
+                                  fd,
+                                  tmp_buf,
+                                  count));
 
     if status == sgx_status_t::SGX_SUCCESS {
         if result == -1 {
@@ -1600,11 +2443,71 @@ pub unsafe fn write(fd: c_int, buf: *const c_void, count: size_t) -> ssize_t {
         set_errno(ESGX);
         result = -1;
     }
+    ocall_stats_end(OCALL_STAT_WRITE, start_ns);
 
     if count <= MAX_OCALL_ALLOC_SIZE {
         sgx_ocfree();
     } else {
-        free(tmp_buf);
+        arena_release(tmp_buf);
+    }
+    result
+}
+
+/// Move `len` bytes between two file offsets entirely in the kernel.
+/// No payload crosses the enclave boundary, so bulk relocation of
+/// plaintext files costs one transition per span instead of a
+/// read/write loop with two copies through enclave memory.
+pub unsafe fn copy_file_range(fd_in: c_int,
+                              off_in: *mut i64,
+                              fd_out: c_int,
+                              off_out: *mut i64,
+                              len: size_t,
+                              flags: c_uint) -> ssize_t {
+    let mut result: ssize_t = 0;
+    let mut error: c_int = 0;
+    let status = u_copy_file_range_ocall(&mut result as *mut ssize_t,
+                                         &mut error as *mut c_int,
+                                         fd_in,
+                                         off_in,
+                                         fd_out,
+                                         off_out,
+                                         len,
+                                         flags);
+
+    if status == sgx_status_t::SGX_SUCCESS {
+        if result == -1 {
+            set_errno(error);
+        }
+    } else {
+        set_errno(ESGX);
+        result = -1;
+    }
+    result
+}
+
+/// File-to-socket transfer in the kernel; same zero-boundary-crossing
+/// property as copy_file_range. `offset`, when non-null, is advanced
+/// by the bytes sent and the source fd position is left untouched.
+pub unsafe fn sendfile(out_fd: c_int,
+                       in_fd: c_int,
+                       offset: *mut i64,
+                       count: size_t) -> ssize_t {
+    let mut result: ssize_t = 0;
+    let mut error: c_int = 0;
+    let status = u_sendfile_ocall(&mut result as *mut ssize_t,
+                                  &mut error as *mut c_int,
+                                  out_fd,
+                                  in_fd,
+                                  offset,
+                                  count);
+
+    if status == sgx_status_t::SGX_SUCCESS {
+        if result == -1 {
+            set_errno(error);
+        }
+    } else {
+        set_errno(ESGX);
+        result = -1;
     }
     result
 }
@@ -1625,7 +2528,7 @@ pub unsafe fn pwrite64(fd: c_int, buf: *const c_void, count: size_t, offset: off
     let tmp_buf = if count <= MAX_OCALL_ALLOC_SIZE {
         sgx_ocalloc(count)
     } else {
-        malloc(count)
+        arena_acquire(count)
     };
     if tmp_buf.is_null() {
         set_errno(ENOMEM );
@@ -1633,12 +2536,14 @@ pub unsafe fn pwrite64(fd: c_int, buf: *const c_void, count: size_t, offset: off
     }
     ptr::copy_nonoverlapping(buf as *const u8, tmp_buf as *mut u8, count);
 
-    let status = u_pwrite64_ocall(&mut result as *mut ssize_t,
+    let start_ns = ocall_stats_begin();
+    let status = ocall_dispatch!(OCALL_STAT_PWRITE64, u_fs_pwrite64_ocall, u_pwrite64_ocall,
+                                 (&mut result as *mut ssize_t,
                                   &mut error as *mut c_int,
                                   fd,
                                   tmp_buf,
                                   count,
-                                  offset);
+                                  offset));
 
     if status == sgx_status_t::SGX_SUCCESS {
         if result == -1 {
@@ -1648,11 +2553,12 @@ pub unsafe fn pwrite64(fd: c_int, buf: *const c_void, count: size_t, offset: off
         set_errno(ESGX);
         result = -1;
     }
+    ocall_stats_end(OCALL_STAT_PWRITE64, start_ns);
 
     if count <= MAX_OCALL_ALLOC_SIZE {
         sgx_ocfree();
     } else {
-        free(tmp_buf);
+        arena_release(tmp_buf);
     }
     result
 }
@@ -1685,8 +2591,6 @@ pub unsafe fn writev(fd: c_int, iov: *const iovec, iovcnt: c_int) -> ssize_t {
         set_errno(ENOMEM );
         return -1;
     }
-    iobase.write_bytes(0_u8, iosize);
-
     let mut tmpiovec: Vec<iovec> = Vec::with_capacity(iovcnt as usize);
     ptr = iobase;
     for io in v {
@@ -1744,8 +2648,6 @@ pub unsafe fn pwritev64(fd: c_int, iov: *const iovec, iovcnt: c_int, offset: off
         set_errno(ENOMEM );
         return -1;
     }
-    iobase.write_bytes(0_u8, iosize);
-
     let mut tmpiovec: Vec<iovec> = Vec::with_capacity(iovcnt as usize);
     ptr = iobase;
     for io in v {
@@ -1857,9 +2759,11 @@ pub unsafe fn ioctl_arg1(fd: c_int, request: c_int, arg: *mut c_int) -> c_int {
 pub unsafe fn close(fd: c_int) -> c_int {
     let mut result: c_int = 0;
     let mut error: c_int = 0;
-    let status = u_close_ocall(&mut result as *mut c_int,
-                               &mut error as *mut c_int,
-                               fd);
+    let start_ns = ocall_stats_begin();
+    let status = ocall_dispatch!(OCALL_STAT_CLOSE, u_fs_close_ocall, u_close_ocall,
+                                 (&mut result as *mut c_int,
+                                  &mut error as *mut c_int,
+                                  fd));
 
     if status == sgx_status_t::SGX_SUCCESS {
         if result == -1 {
@@ -1869,6 +2773,7 @@ pub unsafe fn close(fd: c_int) -> c_int {
         set_errno(ESGX);
         result = -1;
     }
+    ocall_stats_end(OCALL_STAT_CLOSE, start_ns);
     result
 }
 
@@ -1891,6 +2796,88 @@ pub unsafe fn clock_gettime(clk_id: clockid_t, tp: *mut timespec) -> c_int {
     result
 }
 
+/// Shared time page kept fresh by an untrusted ticker thread; see
+/// u_time_page_ocall in sgx_ustdc/time.c. Reading it costs two loads
+/// instead of an enclave transition, at the ticker interval's
+/// resolution.
+#[repr(C)]
+struct time_page {
+    generation: u64,
+    real_sec: i64,
+    real_nsec: i64,
+    mono_sec: i64,
+    mono_nsec: i64,
+}
+
+/// Ticker refresh interval requested on first use.
+const TIME_PAGE_INTERVAL_NS: u64 = 1_000_000;
+/// Seqlock retries before giving up on the page for this read.
+const TIME_PAGE_RETRIES: usize = 8;
+
+static TIME_PAGE: AtomicPtr<time_page> = AtomicPtr::new(ptr::null_mut());
+static TIME_PAGE_FAILED: AtomicBool = AtomicBool::new(false);
+
+unsafe fn coarse_time_page() -> *const time_page {
+    let page = TIME_PAGE.load(Ordering::Acquire);
+    if !page.is_null() {
+        return page;
+    }
+    if TIME_PAGE_FAILED.load(Ordering::Relaxed) {
+        return ptr::null();
+    }
+
+    let mut result: *mut c_void = ptr::null_mut();
+    let mut error: c_int = 0;
+    let status = u_time_page_ocall(&mut result as *mut *mut c_void,
+                                   &mut error as *mut c_int,
+                                   TIME_PAGE_INTERVAL_NS);
+
+    if status != sgx_status_t::SGX_SUCCESS ||
+       result.is_null() ||
+       sgx_is_outside_enclave(result, mem::size_of::<time_page>()) == 0 {
+        TIME_PAGE_FAILED.store(true, Ordering::Relaxed);
+        return ptr::null();
+    }
+
+    // Concurrent initializers get the same page from the untrusted
+    // side, so losing this race is harmless.
+    TIME_PAGE.store(result as *mut time_page, Ordering::Release);
+    result as *const time_page
+}
+
+/// Coarse clock read from the shared time page, no enclave transition.
+/// Resolution is the ticker interval. Falls back to the precise
+/// clock_gettime ocall when the page is unavailable, the clock is not
+/// mirrored in it, or the seqlock stays unstable.
+pub unsafe fn clock_gettime_coarse(clk_id: clockid_t, tp: *mut timespec) -> c_int {
+    let page = coarse_time_page();
+    if !page.is_null() && (clk_id == CLOCK_REALTIME || clk_id == CLOCK_MONOTONIC) {
+        for _ in 0..TIME_PAGE_RETRIES {
+            let g1 = ptr::read_volatile(&(*page).generation);
+            if g1 & 1 == 1 {
+                spin_loop_hint();
+                continue;
+            }
+            fence(Ordering::Acquire);
+            let (sec, nsec) = if clk_id == CLOCK_REALTIME {
+                (ptr::read_volatile(&(*page).real_sec),
+                 ptr::read_volatile(&(*page).real_nsec))
+            } else {
+                (ptr::read_volatile(&(*page).mono_sec),
+                 ptr::read_volatile(&(*page).mono_nsec))
+            };
+            fence(Ordering::Acquire);
+            let g2 = ptr::read_volatile(&(*page).generation);
+            if g1 == g2 {
+                (*tp).tv_sec = sec;
+                (*tp).tv_nsec = nsec as c_long;
+                return 0;
+            }
+        }
+    }
+    clock_gettime(clk_id, tp)
+}
+
 pub unsafe fn socket(domain: c_int, ty: c_int, protocol: c_int) -> c_int {
     let mut result: c_int = 0;
     let mut error: c_int = 0;
@@ -2192,8 +3179,6 @@ pub unsafe fn sendmsg(sockfd: c_int, msg: *const msghdr, flags: c_int) -> ssize_
         set_errno(ENOMEM );
         return -1;
     }
-    hdrbase.write_bytes(0_u8, hdrsize);
-
     let mut tmpmsg: msghdr = mem::zeroed();
     ptr = hdrbase;
     if !mhdr.msg_name.is_null() && mhdr.msg_namelen > 0 {
@@ -2263,7 +3248,6 @@ pub unsafe fn recv(sockfd: c_int, buf: *mut c_void, len: size_t, flags: c_int) -
         set_errno(ENOMEM );
         return -1;
     }
-    tmp_buf.write_bytes(0_u8, len);
 
     let status = u_recv_ocall(&mut result as *mut ssize_t,
                               &mut error as *mut c_int,
@@ -2282,7 +3266,15 @@ pub unsafe fn recv(sockfd: c_int, buf: *mut c_void, len: size_t, flags: c_int) -
     }
 
     if result != -1 {
-        ptr::copy_nonoverlapping(tmp_buf as *const u8, buf as *mut u8, len);
+        let nread = result as usize;
+        if nread <= len {
+            if nread > 0 {
+                ptr::copy_nonoverlapping(tmp_buf as *const u8, buf as *mut u8, nread);
+            }
+        } else {
+            set_errno(ESGX);
+            result = -1;
+        }
     }
     if len <= MAX_OCALL_ALLOC_SIZE {
         sgx_ocfree();
@@ -2321,7 +3313,6 @@ pub unsafe fn recvfrom(sockfd: c_int,
         set_errno(ENOMEM );
         return -1;
     }
-    tmp_buf.write_bytes(0_u8, len);
 
     let status = u_recvfrom_ocall(&mut result as *mut ssize_t,
                                   &mut error as *mut c_int,
@@ -2343,7 +3334,15 @@ pub unsafe fn recvfrom(sockfd: c_int,
     }
 
     if result != -1 {
-        ptr::copy_nonoverlapping(tmp_buf as *const u8, buf as *mut u8, len);
+        let nread = result as usize;
+        if nread <= len {
+            if nread > 0 {
+                ptr::copy_nonoverlapping(tmp_buf as *const u8, buf as *mut u8, nread);
+            }
+        } else {
+            set_errno(ESGX);
+            result = -1;
+        }
     }
     if len <= MAX_OCALL_ALLOC_SIZE {
         sgx_ocfree();
@@ -2400,8 +3399,6 @@ pub unsafe fn recvmsg(sockfd: c_int, msg: *mut msghdr, flags: c_int) -> ssize_t
         set_errno(ENOMEM );
         return -1;
     }
-    hdrbase.write_bytes(0_u8, hdrsize);
-
     let mut tmpmsg: msghdr = mem::zeroed();
     ptr = hdrbase;
     if !mhdr.msg_name.is_null() && mhdr.msg_namelen > 0 {
@@ -2444,27 +3441,210 @@ pub unsafe fn recvmsg(sockfd: c_int, msg: *mut msghdr, flags: c_int) -> ssize_t
         result = -1;
     }
 
-    ptr = hdrbase;
-    if !mhdr.msg_name.is_null() && mhdr.msg_namelen > 0 {
-        ptr = ptr.add(mhdr.msg_namelen as usize);
+    if result != -1 {
+        let mut remaining = result as usize;
+        ptr = hdrbase;
+        if !mhdr.msg_name.is_null() && mhdr.msg_namelen > 0 {
+            ptr = ptr.add(mhdr.msg_namelen as usize);
+        }
+
+        if !mhdr.msg_iov.is_null() && mhdr.msg_iovlen > 0 {
+            let tmpiov = slice::from_raw_parts_mut(ptr as *mut iovec, mhdr.msg_iovlen as usize);
+            ptr = ptr.add(mhdr.msg_iovlen as usize * mem::size_of::<iovec>());
+
+            let v = slice::from_raw_parts(mhdr.msg_iov, mhdr.msg_iovlen as usize);
+            for i in 0..v.len() {
+                let n = core::cmp::min(v[i].iov_len as usize, remaining);
+                if n > 0 {
+                    ptr::copy_nonoverlapping(tmpiov[i].iov_base as *const u8, v[i].iov_base as *mut u8, n);
+                    remaining -= n;
+                }
+                ptr = ptr.add(v[i].iov_len as usize);
+            }
+        }
+
+        if !mhdr.msg_control.is_null() &&  mhdr.msg_controllen > 0 {
+            let n = core::cmp::min(tmpmsg.msg_controllen as usize, mhdr.msg_controllen as usize);
+            if n > 0 {
+                ptr::copy_nonoverlapping(tmpmsg.msg_control as *const u8, mhdr.msg_control as *mut u8, n);
+            }
+            mhdr.msg_controllen = n;
+        }
+        mhdr.msg_flags = tmpmsg.msg_flags;
     }
 
-    if !mhdr.msg_iov.is_null() && mhdr.msg_iovlen > 0 {
-        let tmpiov = slice::from_raw_parts_mut(ptr as *mut iovec, mhdr.msg_iovlen as usize);
-        ptr = ptr.add(mhdr.msg_iovlen as usize * mem::size_of::<iovec>());
+    free(hdrbase as *mut c_void);
+    result
+}
 
-        let v = slice::from_raw_parts(mhdr.msg_iov, mhdr.msg_iovlen as usize);
-        for i in 0..v.len() {
-            ptr::copy_nonoverlapping(tmpiov[i].iov_base as *const u8, v[i].iov_base as *mut u8, v[i].iov_len as usize);
-            ptr = ptr.add(v[i].iov_len as usize);
+/// Sends `nfds` open file descriptors to the peer of a unix domain
+/// socket as one SCM_RIGHTS control message, with `buf`/`len` as the
+/// accompanying data payload (the kernel requires at least one byte of
+/// data for the descriptors to be delivered). A host broker can use the
+/// mirror image of this to hand a pre-opened fd straight to enclave
+/// code in a single transition.
+pub unsafe fn sendmsg_fds(sockfd: c_int,
+                          buf: *const c_void,
+                          len: size_t,
+                          fds: *const c_int,
+                          nfds: size_t,
+                          flags: c_int) -> ssize_t {
+    if buf.is_null() || len == 0 || fds.is_null() || nfds == 0 {
+        set_errno(EINVAL);
+        return -1;
+    }
+
+    let space = CMSG_SPACE((nfds * mem::size_of::<c_int>()) as c_uint) as usize;
+    let mut control: Vec<u64> = vec![0; (space + mem::size_of::<u64>() - 1) / mem::size_of::<u64>()];
+    let mut iov = iovec {
+        iov_base: buf as *mut c_void,
+        iov_len: len,
+    };
+    let mut msg: msghdr = mem::zeroed();
+    msg.msg_iov = &mut iov as *mut iovec;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.as_mut_ptr() as *mut c_void;
+    msg.msg_controllen = space;
+
+    let cmsg = CMSG_FIRSTHDR(&msg as *const msghdr);
+    (*cmsg).cmsg_level = SOL_SOCKET;
+    (*cmsg).cmsg_type = SCM_RIGHTS;
+    (*cmsg).cmsg_len = CMSG_LEN((nfds * mem::size_of::<c_int>()) as c_uint) as socklen_t;
+    ptr::copy_nonoverlapping(fds, CMSG_DATA(cmsg) as *mut c_int, nfds);
+
+    sendmsg(sockfd, &msg as *const msghdr, flags)
+}
+
+/// Receives up to `nfds` file descriptors passed over a unix domain
+/// socket via SCM_RIGHTS, together with the accompanying data payload.
+/// On success the data byte count is returned, the received descriptors
+/// are stored in `fds` and their number in `nfds_out` (0 when the
+/// message carried no descriptors). Descriptors beyond `nfds` are
+/// closed by the kernel on truncation, as with plain recvmsg.
+pub unsafe fn recvmsg_fds(sockfd: c_int,
+                          buf: *mut c_void,
+                          len: size_t,
+                          fds: *mut c_int,
+                          nfds: size_t,
+                          nfds_out: *mut size_t,
+                          flags: c_int) -> ssize_t {
+    if buf.is_null() || len == 0 || fds.is_null() || nfds == 0 || nfds_out.is_null() {
+        set_errno(EINVAL);
+        return -1;
+    }
+    *nfds_out = 0;
+
+    let space = CMSG_SPACE((nfds * mem::size_of::<c_int>()) as c_uint) as usize;
+    let mut control: Vec<u64> = vec![0; (space + mem::size_of::<u64>() - 1) / mem::size_of::<u64>()];
+    let mut iov = iovec {
+        iov_base: buf,
+        iov_len: len,
+    };
+    let mut msg: msghdr = mem::zeroed();
+    msg.msg_iov = &mut iov as *mut iovec;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.as_mut_ptr() as *mut c_void;
+    msg.msg_controllen = space;
+
+    let result = recvmsg(sockfd, &mut msg as *mut msghdr, flags);
+    if result == -1 {
+        return -1;
+    }
+
+    let mut count: usize = 0;
+    let mut cmsg = CMSG_FIRSTHDR(&msg as *const msghdr);
+    while !cmsg.is_null() {
+        if (*cmsg).cmsg_level == SOL_SOCKET && (*cmsg).cmsg_type == SCM_RIGHTS {
+            let n = ((*cmsg).cmsg_len as usize - (CMSG_LEN(0) as usize)) / mem::size_of::<c_int>();
+            let n = core::cmp::min(n, nfds - count);
+            ptr::copy_nonoverlapping(CMSG_DATA(cmsg) as *const c_int, fds.add(count), n);
+            count += n;
         }
+        cmsg = CMSG_NXTHDR(&msg as *const msghdr, cmsg);
     }
+    *nfds_out = count;
+    result
+}
 
-    if !mhdr.msg_control.is_null() &&  mhdr.msg_controllen > 0 {
-        ptr::copy_nonoverlapping(tmpmsg.msg_control as *const u8, mhdr.msg_control as *mut u8, mhdr.msg_controllen as usize);
+/// One int-valued socket option of a batched application; mirrors
+/// struct sockopt_req_t in edl/inc/sockopt.h.
+#[repr(C)]
+#[derive(Copy, Clone)]
+pub struct sockopt_req_t {
+    pub level: c_int,
+    pub optname: c_int,
+    pub optval: c_int,
+}
+
+/// Applies a vector of int-valued socket options in one transition
+/// instead of one u_setsockopt_ocall each. Returns the number of
+/// options applied; when that is short of `nopts`, errno carries the
+/// failing option's error.
+pub unsafe fn setsockopt_batch(sockfd: c_int,
+                               opts: *const sockopt_req_t,
+                               nopts: size_t) -> c_int {
+    let mut result: c_int = 0;
+    let mut error: c_int = 0;
+    let status = u_setsockopt_batch_ocall(&mut result as *mut c_int,
+                                          &mut error as *mut c_int,
+                                          sockfd,
+                                          opts,
+                                          nopts);
+
+    if status == sgx_status_t::SGX_SUCCESS {
+        if (result as size_t) < nopts {
+            set_errno(error);
+        }
+    } else {
+        set_errno(ESGX);
+        result = -1;
     }
+    result
+}
 
-    free(hdrbase as *mut c_void);
+/// accept4 with a tuning preset applied to the accepted fd on the
+/// untrusted side before it is returned, so configuring a fresh
+/// connection costs one transition instead of one per option. Option
+/// application is best effort; `nopts_applied` (when non-null) reports
+/// how many took effect.
+pub unsafe fn accept4_preset(sockfd: c_int,
+                             addr: *mut sockaddr,
+                             addrlen: *mut socklen_t,
+                             flags: c_int,
+                             opts: *const sockopt_req_t,
+                             nopts: size_t,
+                             nopts_applied: *mut size_t) -> c_int {
+    let mut result: c_int = 0;
+    let mut error: c_int = 0;
+    let len_in: socklen_t = if !addrlen.is_null() { *addrlen } else { 0 };
+    let mut len_out: socklen_t = 0 as socklen_t;
+    let mut applied: size_t = 0;
+    let status = u_accept4_preset_ocall(&mut result as *mut c_int,
+                                        &mut error as *mut c_int,
+                                        sockfd,
+                                        addr,
+                                        len_in, // This additional arg is just for EDL
+                                        &mut len_out as *mut socklen_t,
+                                        flags,
+                                        opts,
+                                        nopts,
+                                        &mut applied as *mut size_t);
+
+    if status == sgx_status_t::SGX_SUCCESS {
+        if result == -1 {
+            set_errno(error);
+        }
+    } else {
+        set_errno(ESGX);
+        result = -1;
+    }
+
+    if !addrlen.is_null() {
+        *addrlen = len_out;
+    }
+    if !nopts_applied.is_null() {
+        *nopts_applied = applied;
+    }
     result
 }
 
@@ -2601,6 +3781,54 @@ pub unsafe fn shutdown(sockfd: c_int, how: c_int) -> c_int {
     result
 }
 
+/// Attaches the kernel TLS ULP to `sockfd`; required once per socket
+/// before traffic keys can be installed. Fails with ENOENT when the
+/// kernel tls module is unavailable.
+pub unsafe fn tls_ulp_enable(sockfd: c_int) -> c_int {
+    let mut result: c_int = 0;
+    let mut error: c_int = 0;
+    let status = u_tls_ulp_enable_ocall(&mut result as *mut c_int,
+                                        &mut error as *mut c_int,
+                                        sockfd);
+    if status == sgx_status_t::SGX_SUCCESS {
+        if result == -1 {
+            set_errno(error);
+        }
+    } else {
+        set_errno(ESGX);
+        result = -1;
+    }
+    result
+}
+
+/// Installs negotiated traffic keys for one direction (TLS_TX or
+/// TLS_RX) so the kernel performs record crypto and bulk data no
+/// longer re-enters the enclave per record. `crypto_info` is a
+/// tls12_crypto_info_* struct; handing it down deliberately moves
+/// post-handshake confidentiality for this socket out of the enclave.
+pub unsafe fn tls_crypto_info_set(sockfd: c_int,
+                                  direction: c_int,
+                                  crypto_info: *const c_void,
+                                  len: socklen_t) -> c_int {
+    let mut result: c_int = 0;
+    let mut error: c_int = 0;
+    let status = u_tls_crypto_info_set_ocall(&mut result as *mut c_int,
+                                             &mut error as *mut c_int,
+                                             sockfd,
+                                             direction,
+                                             crypto_info,
+                                             len);
+    if status == sgx_status_t::SGX_SUCCESS {
+        if result == -1 {
+            set_errno(error);
+        }
+    } else {
+        set_errno(ESGX);
+        result = -1;
+    }
+    result
+}
+
 pub unsafe fn getaddrinfo(node: *const c_char,
                           service: *const c_char,
                           hints: *const addrinfo,
@@ -2703,6 +3931,34 @@ pub unsafe fn getaddrinfo(node: *const c_char,
     result
 }
 
+/// Asks the untrusted resolver cache to resolve and cache each
+/// NUL-separated name in `nodes` (total length `nodes_len`) ahead of
+/// time, so subsequent getaddrinfo calls for those names skip the
+/// resolver round trip until the cache TTL expires. Returns the number
+/// of names cached, or -1.
+pub unsafe fn getaddrinfo_prefetch(nodes: *const c_char,
+                                   nodes_len: size_t,
+                                   service: *const c_char,
+                                   hints: *const addrinfo) -> c_int {
+    let mut result: c_int = 0;
+    let mut error: c_int = 0;
+    let status = u_getaddrinfo_prefetch_ocall(&mut result as *mut c_int,
+                                              &mut error as *mut c_int,
+                                              nodes,
+                                              nodes_len,
+                                              service,
+                                              hints);
+    if status == sgx_status_t::SGX_SUCCESS {
+        if result == -1 {
+            set_errno(error);
+        }
+    } else {
+        set_errno(ESGX);
+        result = -1;
+    }
+    result
+}
+
 pub unsafe fn freeaddrinfo(res: *mut addrinfo ) {
     let mut cur_ptr: *mut addrinfo = res;
     let mut addrinfo_vec: Vec<Box<addrinfo>> = Vec::new();
@@ -2815,7 +4071,64 @@ pub unsafe fn epoll_wait(epfd: c_int,
     result
 }
 
+/// One event-loop tick in a single transition: non-blocking writes for
+/// the queued (wfds, woffs, wlens) submissions out of the untrusted
+/// buffer wbuf, then epoll_wait, then one inline non-blocking read per
+/// EPOLLIN event into rbuf (chunk_size bytes per event slot, fd taken
+/// from the epoll data). nwritten/nreads carry per-entry byte counts or
+/// negated errno values; wbuf and rbuf must be untrusted memory.
+pub unsafe fn reactor_advance(epfd: c_int,
+                              events: *mut epoll_event,
+                              maxevents: c_int,
+                              timeout: c_int,
+                              wfds: *const c_int,
+                              woffs: *const u64,
+                              wlens: *const u64,
+                              nwritten: *mut i64,
+                              nwrites: size_t,
+                              wbuf: *const c_void,
+                              rbuf: *mut c_void,
+                              chunk_size: size_t,
+                              nreads: *mut i64) -> c_int {
+    let mut result: c_int = 0;
+    let mut error: c_int = 0;
+    let status = u_reactor_advance_ocall(&mut result as *mut c_int,
+                                         &mut error as *mut c_int,
+                                         epfd,
+                                         events,
+                                         maxevents,
+                                         timeout,
+                                         wfds,
+                                         woffs,
+                                         wlens,
+                                         nwritten,
+                                         nwrites,
+                                         wbuf,
+                                         rbuf,
+                                         chunk_size,
+                                         nreads);
+    if status == sgx_status_t::SGX_SUCCESS {
+        if result == -1 {
+            set_errno(error);
+        }
+    } else {
+        set_errno(ESGX);
+        result = -1;
+    }
+    result
+}
+
 pub unsafe fn sysconf(name: c_int) -> c_long {
+    // Only names whose answers are process-constant are memoized; the
+    // one arguable entry, _SC_NPROCESSORS_ONLN, can be re-observed
+    // through metadata_cache_refresh after CPU hot-plug.
+    let slot = SYSCONF_CACHED_NAMES.iter().position(|&n| n == name);
+    if let Some(index) = slot {
+        if SYSCONF_PRESENT.load(Ordering::Acquire) & (1 << index) != 0 {
+            return SYSCONF_VALUES[index].load(Ordering::Relaxed) as c_long;
+        }
+    }
+
     let mut result: c_long = 0;
     let mut error: c_int = 0;
     let status = u_sysconf_ocall(&mut result as *mut c_long,
@@ -2824,6 +4137,9 @@ pub unsafe fn sysconf(name: c_int) -> c_long {
     if status == sgx_status_t::SGX_SUCCESS {
         if result == -1 {
             set_errno(error);
+        } else if let Some(index) = slot {
+            SYSCONF_VALUES[index].store(result as u64, Ordering::Relaxed);
+            SYSCONF_PRESENT.fetch_or(1 << index, Ordering::Release);
         }
     } else {
         set_errno(ESGX);
@@ -2964,6 +4280,30 @@ pub unsafe fn nanosleep(rqtp: *const timespec, rmtp: *mut timespec) -> c_int {
     result
 }
 
+/// Fills the per-CPU package and last-level-cache ids of the host
+/// machine and returns its configured CPU count, so enclave workers can
+/// shard state per L3 domain and request matching affinity for their
+/// backing threads via sched_setaffinity. Host-provided values: use for
+/// placement only, never as a trust decision.
+pub unsafe fn get_cpu_topology(package_ids: *mut uint32_t, l3_ids: *mut uint32_t, count: size_t) -> c_long {
+    let mut result: c_long = 0;
+    let mut error: c_int = 0;
+    let status = u_get_cpu_topology_ocall(&mut result as *mut c_long,
+                                          &mut error as *mut c_int,
+                                          package_ids,
+                                          l3_ids,
+                                          count);
+    if status == sgx_status_t::SGX_SUCCESS {
+        if result == -1 {
+            set_errno(error);
+        }
+    } else {
+        set_errno(ESGX);
+        result = -1;
+    }
+    result
+}
+
 pub unsafe fn sigaction(signum: c_int,
                         act: *const sigaction,
                         oldact: *mut sigaction,
@@ -3022,10 +4362,16 @@ pub unsafe fn pthread_sigmask(signum: c_int, set: &sigset_t, oldset: &mut sigset
 }
 
 pub unsafe fn getpid() -> pid_t {
+    let cached = META_PID.load(Ordering::Relaxed);
+    if cached & META_PRESENT != 0 {
+        return cached as pid_t;
+    }
     let mut result = -1;
     let status = u_getpid_ocall(&mut result as *mut pid_t);
     if status != sgx_status_t::SGX_SUCCESS {
         result = -1;
+    } else {
+        META_PID.store(META_PRESENT | result as u32 as u64, Ordering::Relaxed);
     }
     result
 }
@@ -0,0 +1,166 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License..
+
+//! A buffered fast path for sampling-heavy callers.
+//!
+//! Every draw from [`SgxRng`] reaches the hardware entropy source, and
+//! even `thread_rng` pays the Isaac round plus `RefCell` bookkeeping per
+//! call. `fast_rng` trades neither security nor much memory for a
+//! different balance: a per-thread ChaCha generator keeps a block of
+//! output buffered, so the common small request is a copy out of the
+//! buffer and a pointer bump, and the hardware source is touched only
+//! when the generator reseeds.
+
+use std::cell::RefCell;
+use std::rc::Rc;
+
+use crate::reseeding::{self, ReseedingRng};
+use crate::{ChaChaRng, Rand, Rng, SeedableRng, SgxRng};
+
+/// Bytes of ChaCha output kept ready; one refill amortizes the cipher
+/// over many small requests.
+const FAST_RNG_BUFFER_SIZE: usize = 1024;
+
+/// Bytes of output after which the ChaCha key is replaced with fresh
+/// hardware entropy.
+const FAST_RNG_RESEED_THRESHOLD: u64 = 1024 * 1024;
+
+/// A wrapper that buffers blocks of an RNG's output and serves small
+/// requests from the buffer.
+///
+/// `next_u32`, `next_u64` and small `fill_bytes` requests cost a copy
+/// out of the buffer; requests at least a buffer in size bypass the
+/// buffer and go to the inner RNG directly.
+#[derive(Debug)]
+pub struct BufferedRng<R> {
+    rng: R,
+    buffer: [u8; FAST_RNG_BUFFER_SIZE],
+    /// First unconsumed byte; buffer exhausted when it reaches the end.
+    pos: usize,
+}
+
+impl<R: Rng> BufferedRng<R> {
+    /// Creates a buffered wrapper around `rng`. The buffer starts
+    /// empty; nothing is drawn until the first request.
+    pub fn new(rng: R) -> BufferedRng<R> {
+        BufferedRng {
+            rng,
+            buffer: [0_u8; FAST_RNG_BUFFER_SIZE],
+            pos: FAST_RNG_BUFFER_SIZE,
+        }
+    }
+
+    fn take(&mut self, dest: &mut [u8]) {
+        let mut done = 0_usize;
+        while done < dest.len() {
+            if self.pos == FAST_RNG_BUFFER_SIZE {
+                self.rng.fill_bytes(&mut self.buffer);
+                self.pos = 0;
+            }
+            let take = (dest.len() - done).min(FAST_RNG_BUFFER_SIZE - self.pos);
+            dest[done..done + take].copy_from_slice(&self.buffer[self.pos..self.pos + take]);
+            self.pos += take;
+            done += take;
+        }
+    }
+}
+
+impl<R: Rng> Rng for BufferedRng<R> {
+    #[inline]
+    fn next_u32(&mut self) -> u32 {
+        let mut bytes = [0_u8; 4];
+        self.take(&mut bytes);
+        u32::from_le_bytes(bytes)
+    }
+
+    #[inline]
+    fn next_u64(&mut self) -> u64 {
+        let mut bytes = [0_u8; 8];
+        self.take(&mut bytes);
+        u64::from_le_bytes(bytes)
+    }
+
+    fn fill_bytes(&mut self, dest: &mut [u8]) {
+        if dest.len() >= FAST_RNG_BUFFER_SIZE {
+            // no point staging a buffer-sized request through the buffer
+            self.rng.fill_bytes(dest);
+        } else {
+            self.take(dest);
+        }
+    }
+}
+
+/// Controls how the fast thread-local RNG is reseeded.
+#[derive(Debug)]
+struct FastRngReseeder;
+
+impl reseeding::Reseeder<ChaChaRng> for FastRngReseeder {
+    fn reseed(&mut self, rng: &mut ChaChaRng) {
+        *rng = match SgxRng::new() {
+            Ok(mut r) => ChaChaRng::rand(&mut r),
+            Err(e) => panic!("could not reseed fast_rng: {}", e),
+        }
+    }
+}
+
+type FastRngInner = BufferedRng<ReseedingRng<ChaChaRng, FastRngReseeder>>;
+
+/// The buffered thread-local RNG.
+#[derive(Clone, Debug)]
+pub struct FastRng {
+    rng: Rc<RefCell<FastRngInner>>,
+}
+
+/// Retrieve the lazily-initialized buffered thread-local random number
+/// generator, keyed from the hardware entropy source. Intended for
+/// callers that draw small amounts of randomness at high rates, where
+/// `thread_rng` shows up in profiles; each small request is served out
+/// of a per-thread ChaCha output buffer.
+///
+/// The ChaCha key is replaced with fresh hardware entropy after a
+/// megabyte of output; the reseed reaches the same sgx_read_rand-backed
+/// source that seeds `thread_rng`.
+pub fn fast_rng() -> FastRng {
+    // used to make space in TLS for the buffered generator
+    thread_local!(static FAST_RNG_KEY: Rc<RefCell<FastRngInner>> = {
+        let mut seed_rng = match SgxRng::new() {
+            Ok(r) => r,
+            Err(e) => panic!("could not initialize fast_rng: {}", e)
+        };
+        let rng = reseeding::ReseedingRng::new(ChaChaRng::rand(&mut seed_rng),
+                                               FAST_RNG_RESEED_THRESHOLD,
+                                               FastRngReseeder);
+        Rc::new(RefCell::new(BufferedRng::new(rng)))
+    });
+
+    FastRng { rng: FAST_RNG_KEY.with(|t| t.clone()) }
+}
+
+impl Rng for FastRng {
+    fn next_u32(&mut self) -> u32 {
+        self.rng.borrow_mut().next_u32()
+    }
+
+    fn next_u64(&mut self) -> u64 {
+        self.rng.borrow_mut().next_u64()
+    }
+
+    #[inline]
+    fn fill_bytes(&mut self, bytes: &mut [u8]) {
+        self.rng.borrow_mut().fill_bytes(bytes)
+    }
+}
@@ -41,6 +41,7 @@ pub use os::SgxRng;
 
 pub use isaac::{IsaacRng, Isaac64Rng};
 pub use chacha::ChaChaRng;
+pub use buffered::{fast_rng, BufferedRng, FastRng};
 
 #[cfg(target_pointer_width = "32")]
 use IsaacRng as IsaacWordRng;
@@ -50,6 +51,7 @@ use Isaac64Rng as IsaacWordRng;
 use distributions::{Range, IndependentSample};
 use distributions::range::SampleRange;
 
+pub mod buffered;
 pub mod distributions;
 pub mod isaac;
 pub mod chacha;
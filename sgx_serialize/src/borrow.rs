@@ -0,0 +1,362 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License..
+
+//!
+//! Zero-copy decoding over a borrowed input buffer
+//!
+//! [`DeSerializable`] materializes every field into owned allocations,
+//! so decoding a large checkpoint doubles its memory footprint and
+//! burns a copy pass. The borrowed path here reads the same wire format
+//! but lets byte-slice and string fields be views into the input
+//! buffer: a `&'a [u8]` field of a 100MB checkpoint costs a length read
+//! and a slice, not an allocation and a copy.
+//!
+//! A view type mirrors its owned counterpart with `&'a [u8]` / `&'a str`
+//! where the owned type has `Vec<u8>` / `String`; field order must match
+//! the encoded type. [`impl_deserializable_borrowed!`] generates the
+//! trait impl for such a struct, standing in for derive support - the
+//! derive crate predates lifetime-generic output and cannot emit view
+//! types.
+//!
+//! ```rust,ignore
+//! #[derive(Serializable)]
+//! struct Record { key: u64, payload: Vec<u8> }
+//!
+//! struct RecordView<'a> { key: u64, payload: &'a [u8] }
+//! impl_deserializable_borrowed!(RecordView<'a> { key, payload });
+//!
+//! let helper = BorrowedDeSerializeHelper::<RecordView>::new(&sealed[..]);
+//! let view = helper.decode().unwrap(); // no payload copy
+//! ```
+//!
+//! [`DeSerializable`]: crate::DeSerializable
+
+use crate::leb128::{read_signed_leb128, read_unsigned_leb128};
+use std::boxed::Box;
+use std::marker::PhantomData;
+use std::string::{String, ToString};
+use std::vec::Vec;
+
+/// A decoder over a borrowed buffer whose string and byte-slice reads
+/// return views into that buffer. Wire-compatible with [`Encoder`].
+///
+/// [`Encoder`]: crate::Encoder
+pub struct BorrowedDecoder<'a> {
+    data: &'a [u8],
+    position: usize,
+}
+
+macro_rules! borrow_read_uleb128 {
+    ($dec:expr, $t:ty) => ({
+        let (value, bytes_read) = read_unsigned_leb128($dec.data, $dec.position);
+        $dec.position += bytes_read;
+        Ok(value as $t)
+    })
+}
+
+macro_rules! borrow_read_sleb128 {
+    ($dec:expr, $t:ty) => ({
+        let (value, bytes_read) = read_signed_leb128($dec.data, $dec.position);
+        $dec.position += bytes_read;
+        Ok(value as $t)
+    })
+}
+
+impl<'a> BorrowedDecoder<'a> {
+    pub fn new(data: &'a [u8]) -> BorrowedDecoder<'a> {
+        BorrowedDecoder { data, position: 0 }
+    }
+
+    #[inline]
+    pub fn read_usize(&mut self) -> Result<usize, String> {
+        borrow_read_uleb128!(self, usize)
+    }
+
+    #[inline]
+    pub fn read_u128(&mut self) -> Result<u128, String> {
+        borrow_read_uleb128!(self, u128)
+    }
+
+    #[inline]
+    pub fn read_u64(&mut self) -> Result<u64, String> {
+        borrow_read_uleb128!(self, u64)
+    }
+
+    #[inline]
+    pub fn read_u32(&mut self) -> Result<u32, String> {
+        borrow_read_uleb128!(self, u32)
+    }
+
+    #[inline]
+    pub fn read_u16(&mut self) -> Result<u16, String> {
+        borrow_read_uleb128!(self, u16)
+    }
+
+    #[inline]
+    pub fn read_u8(&mut self) -> Result<u8, String> {
+        if self.position >= self.data.len() {
+            return Err("unexpected end of input".to_string());
+        }
+        let value = self.data[self.position];
+        self.position += 1;
+        Ok(value)
+    }
+
+    #[inline]
+    pub fn read_isize(&mut self) -> Result<isize, String> {
+        borrow_read_sleb128!(self, isize)
+    }
+
+    #[inline]
+    pub fn read_i128(&mut self) -> Result<i128, String> {
+        borrow_read_sleb128!(self, i128)
+    }
+
+    #[inline]
+    pub fn read_i64(&mut self) -> Result<i64, String> {
+        borrow_read_sleb128!(self, i64)
+    }
+
+    #[inline]
+    pub fn read_i32(&mut self) -> Result<i32, String> {
+        borrow_read_sleb128!(self, i32)
+    }
+
+    #[inline]
+    pub fn read_i16(&mut self) -> Result<i16, String> {
+        borrow_read_sleb128!(self, i16)
+    }
+
+    #[inline]
+    pub fn read_i8(&mut self) -> Result<i8, String> {
+        let as_u8 = self.read_u8()?;
+        unsafe { Ok(::std::mem::transmute(as_u8)) }
+    }
+
+    #[inline]
+    pub fn read_bool(&mut self) -> Result<bool, String> {
+        let value = self.read_u8()?;
+        Ok(value != 0)
+    }
+
+    #[inline]
+    pub fn read_f64(&mut self) -> Result<f64, String> {
+        let bits = self.read_u64()?;
+        Ok(unsafe { ::std::mem::transmute(bits) })
+    }
+
+    #[inline]
+    pub fn read_f32(&mut self) -> Result<f32, String> {
+        let bits = self.read_u32()?;
+        Ok(unsafe { ::std::mem::transmute(bits) })
+    }
+
+    #[inline]
+    pub fn read_char(&mut self) -> Result<char, String> {
+        let bits = self.read_u32()?;
+        ::std::char::from_u32(bits).ok_or_else(|| "invalid char".to_string())
+    }
+
+    /// Borrows `len` raw bytes out of the input without copying.
+    #[inline]
+    pub fn read_raw_bytes(&mut self, len: usize) -> Result<&'a [u8], String> {
+        if len > self.data.len() || self.position > self.data.len() - len {
+            return Err("unexpected end of input".to_string());
+        }
+        let bytes = &self.data[self.position..self.position + len];
+        self.position += len;
+        Ok(bytes)
+    }
+
+    /// Reads a length-prefixed byte sequence as a view into the input;
+    /// wire-compatible with an encoded `Vec<u8>`.
+    #[inline]
+    pub fn read_bytes(&mut self) -> Result<&'a [u8], String> {
+        let len = self.read_usize()?;
+        self.read_raw_bytes(len)
+    }
+
+    /// Reads a length-prefixed string as a view into the input;
+    /// wire-compatible with an encoded `String`.
+    #[inline]
+    pub fn read_str(&mut self) -> Result<&'a str, String> {
+        let bytes = self.read_bytes()?;
+        ::std::str::from_utf8(bytes).map_err(|_| "invalid utf8".to_string())
+    }
+}
+
+/// A type decodable from a [`BorrowedDecoder`], possibly borrowing from
+/// the input buffer. The lazy counterpart of [`DeSerializable`].
+///
+/// [`DeSerializable`]: crate::DeSerializable
+pub trait DeSerializableBorrowed<'a>: Sized {
+    fn decode_borrowed(d: &mut BorrowedDecoder<'a>) -> Result<Self, String>;
+}
+
+macro_rules! impl_borrowed_prim {
+    ($t:ty, $read:ident) => {
+        impl<'a> DeSerializableBorrowed<'a> for $t {
+            fn decode_borrowed(d: &mut BorrowedDecoder<'a>) -> Result<$t, String> {
+                d.$read()
+            }
+        }
+    }
+}
+
+impl_borrowed_prim! { usize, read_usize }
+impl_borrowed_prim! { u8, read_u8 }
+impl_borrowed_prim! { u16, read_u16 }
+impl_borrowed_prim! { u32, read_u32 }
+impl_borrowed_prim! { u64, read_u64 }
+impl_borrowed_prim! { u128, read_u128 }
+impl_borrowed_prim! { isize, read_isize }
+impl_borrowed_prim! { i8, read_i8 }
+impl_borrowed_prim! { i16, read_i16 }
+impl_borrowed_prim! { i32, read_i32 }
+impl_borrowed_prim! { i64, read_i64 }
+impl_borrowed_prim! { i128, read_i128 }
+impl_borrowed_prim! { f32, read_f32 }
+impl_borrowed_prim! { f64, read_f64 }
+impl_borrowed_prim! { bool, read_bool }
+impl_borrowed_prim! { char, read_char }
+
+impl<'a> DeSerializableBorrowed<'a> for () {
+    fn decode_borrowed(_d: &mut BorrowedDecoder<'a>) -> Result<(), String> {
+        Ok(())
+    }
+}
+
+impl<'a> DeSerializableBorrowed<'a> for &'a [u8] {
+    fn decode_borrowed(d: &mut BorrowedDecoder<'a>) -> Result<&'a [u8], String> {
+        d.read_bytes()
+    }
+}
+
+impl<'a> DeSerializableBorrowed<'a> for &'a str {
+    fn decode_borrowed(d: &mut BorrowedDecoder<'a>) -> Result<&'a str, String> {
+        d.read_str()
+    }
+}
+
+impl<'a> DeSerializableBorrowed<'a> for String {
+    fn decode_borrowed(d: &mut BorrowedDecoder<'a>) -> Result<String, String> {
+        d.read_str().map(|s| s.to_string())
+    }
+}
+
+impl<'a, T: DeSerializableBorrowed<'a>> DeSerializableBorrowed<'a> for Vec<T> {
+    fn decode_borrowed(d: &mut BorrowedDecoder<'a>) -> Result<Vec<T>, String> {
+        let len = d.read_usize()?;
+        let mut v = Vec::with_capacity(::std::cmp::min(len, 1024));
+        for _ in 0..len {
+            v.push(DeSerializableBorrowed::decode_borrowed(d)?);
+        }
+        Ok(v)
+    }
+}
+
+impl<'a, T: DeSerializableBorrowed<'a>> DeSerializableBorrowed<'a> for Option<T> {
+    fn decode_borrowed(d: &mut BorrowedDecoder<'a>) -> Result<Option<T>, String> {
+        // same variant-id byte the owned path reads via read_option
+        match d.read_usize()? {
+            0 => Ok(None),
+            1 => Ok(Some(DeSerializableBorrowed::decode_borrowed(d)?)),
+            _ => Err("read_option: expected 0 for None or 1 for Some".to_string()),
+        }
+    }
+}
+
+impl<'a, T: DeSerializableBorrowed<'a>> DeSerializableBorrowed<'a> for Box<T> {
+    fn decode_borrowed(d: &mut BorrowedDecoder<'a>) -> Result<Box<T>, String> {
+        DeSerializableBorrowed::decode_borrowed(d).map(Box::new)
+    }
+}
+
+macro_rules! impl_borrowed_tuple {
+    ($($name:ident),+) => {
+        impl<'a, $($name: DeSerializableBorrowed<'a>),+> DeSerializableBorrowed<'a> for ($($name,)+) {
+            #[allow(non_snake_case)]
+            fn decode_borrowed(d: &mut BorrowedDecoder<'a>) -> Result<($($name,)+), String> {
+                $(let $name = DeSerializableBorrowed::decode_borrowed(d)?;)+
+                Ok(($($name,)+))
+            }
+        }
+    }
+}
+
+impl_borrowed_tuple! { A }
+impl_borrowed_tuple! { A, B }
+impl_borrowed_tuple! { A, B, C }
+impl_borrowed_tuple! { A, B, C, D }
+
+/// Generates a [`DeSerializableBorrowed`] impl for a view struct whose
+/// fields are listed in the same order as the encoded type's fields.
+///
+/// Stands in for derive support until the derive crate can emit
+/// lifetime-generic impls; see the module documentation for an example.
+#[macro_export]
+macro_rules! impl_deserializable_borrowed {
+    ($name:ident<$lt:lifetime> { $($field:ident),+ $(,)? }) => {
+        impl<$lt> $crate::DeSerializableBorrowed<$lt> for $name<$lt> {
+            fn decode_borrowed(
+                d: &mut $crate::BorrowedDecoder<$lt>,
+            ) -> ::std::result::Result<Self, ::std::string::String> {
+                ::std::result::Result::Ok($name {
+                    $($field: $crate::DeSerializableBorrowed::decode_borrowed(d)?,)+
+                })
+            }
+        }
+    };
+    ($name:ident { $($field:ident),+ $(,)? }) => {
+        impl<'a> $crate::DeSerializableBorrowed<'a> for $name {
+            fn decode_borrowed(
+                d: &mut $crate::BorrowedDecoder<'a>,
+            ) -> ::std::result::Result<Self, ::std::string::String> {
+                ::std::result::Result::Ok($name {
+                    $($field: $crate::DeSerializableBorrowed::decode_borrowed(d)?,)+
+                })
+            }
+        }
+    };
+}
+
+/// The borrowed counterpart of [`DeSerializeHelper`]: holds a reference
+/// to the encoded buffer instead of owning it, so neither construction
+/// nor decoding copies the input.
+///
+/// [`DeSerializeHelper`]: crate::DeSerializeHelper
+pub struct BorrowedDeSerializeHelper<'a, T: DeSerializableBorrowed<'a>> {
+    data: &'a [u8],
+    mark: PhantomData<T>,
+}
+
+impl<'a, T: DeSerializableBorrowed<'a>> BorrowedDeSerializeHelper<'a, T> {
+    pub fn new(data: &'a [u8]) -> BorrowedDeSerializeHelper<'a, T> {
+        BorrowedDeSerializeHelper {
+            data,
+            mark: PhantomData,
+        }
+    }
+
+    pub fn decode(&self) -> Option<T> {
+        let mut decoder = BorrowedDecoder::new(self.data);
+        match DeSerializableBorrowed::decode_borrowed(&mut decoder) {
+            Ok(value) => Some(value),
+            Err(_) => None,
+        }
+    }
+}
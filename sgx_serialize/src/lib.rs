@@ -30,6 +30,9 @@ extern crate sgx_tstd as std;
 mod serialize;
 pub use self::serialize::{Decoder, Encoder, DeSerializable, Serializable, SerializeHelper, DeSerializeHelper};
 
+mod borrow;
+pub use self::borrow::{BorrowedDecoder, BorrowedDeSerializeHelper, DeSerializableBorrowed};
+
 mod opaque;
 mod leb128;
 
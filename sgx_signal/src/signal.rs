@@ -24,7 +24,7 @@ use sgx_libc::{
     SA_RESETHAND, SIGBUS, SIGFPE, SIGILL, SIGKILL, SIGSEGV, SIGSTOP, SIGTRAP, SIG_BLOCK, SIG_DFL,
     SIG_ERR, SIG_SETMASK, SIG_UNBLOCK,
 };
-use sgx_types::{c_int, c_void, sgx_enclave_id_t, sgx_status_t, SysResult};
+use sgx_types::{c_int, c_void, sgx_enclave_id_t, sgx_status_t, size_t, SysResult};
 use std::enclave::get_enclave_id;
 use std::io::Error;
 use std::mem;
@@ -101,6 +101,34 @@ pub extern "C" fn t_signal_handler_ecall(info: *const siginfo_t) -> c_int {
     }
 }
 
+/// Batched delivery: the untrusted side queues a signal burst and hands
+/// the whole backlog over in one transition. Each entry is checked
+/// against the current block mask individually, since a handler run
+/// earlier in the batch may change it. Returns the number dispatched.
+#[no_mangle]
+pub extern "C" fn t_signal_handler_batch_ecall(infos: *const siginfo_t, count: size_t) -> c_int {
+    if infos.is_null() || count == 0 {
+        return -1;
+    }
+    let global = GlobalData::get();
+    let mut handled: c_int = 0;
+    for i in 0..count {
+        let info = unsafe { infos.add(i) };
+        let si_info = unsafe { &*info };
+        let mask = manager::get_block_mask();
+        unsafe {
+            let signo = SigNum::from_raw_uncheck(si_info.si_signo);
+            if !mask.is_member(signo) {
+                global
+                    .signal_manager
+                    .handler(si_info.si_signo, info, 0 as *const c_void);
+                handled += 1;
+            }
+        }
+    }
+    handled
+}
+
 fn native_sigaction(signo: SigNum, act: &sigaction, oldact: &mut sigaction) -> c_int {
     let global = GlobalData::ensure();
     let mut mask = SigSet::new();
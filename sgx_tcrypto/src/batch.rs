@@ -0,0 +1,567 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License..
+
+//!
+//! Batch Cryptographic Functions
+//!
+//! Services that protect many small frames per call - message buses,
+//! per-record sealing - pay the single-message entry points' argument
+//! validation and library call overhead once per frame. The batch entry
+//! points here take a whole vector of independent messages, validate
+//! them up front, and then run the underlying library back to back with
+//! no per-message setup in between.
+//!
+//! The prebuilt libsgx_tcrypto.a exposes only single-stream AES-GCM and
+//! SHA-256 entry points, so the messages are processed sequentially
+//! inside one call rather than on interleaved schedules; callers coded
+//! against the batch API pick up vectorized throughput transparently if
+//! a multi-buffer backend appears under these functions later.
+//!
+use core::ptr;
+use sgx_types::*;
+
+///
+/// One message of an AES-GCM batch encryption: the caller provides the
+/// IV and AAD, and receives the ciphertext and MAC. IVs must be unique
+/// per message when the batch shares a key.
+///
+pub struct SgxGcmEncryptMsg<'a> {
+    pub iv: &'a [u8],
+    pub aad: &'a [u8],
+    pub src: &'a [u8],
+    pub dst: &'a mut [u8],
+    pub mac: &'a mut sgx_aes_gcm_128bit_tag_t,
+}
+
+///
+/// One message of an AES-GCM batch decryption: the caller provides the
+/// IV, AAD and the MAC produced at encryption time, and receives the
+/// plaintext.
+///
+pub struct SgxGcmDecryptMsg<'a> {
+    pub iv: &'a [u8],
+    pub aad: &'a [u8],
+    pub src: &'a [u8],
+    pub mac: &'a sgx_aes_gcm_128bit_tag_t,
+    pub dst: &'a mut [u8],
+}
+
+fn check_gcm_buffers(iv: &[u8], aad: &[u8], src: &[u8], dst: &[u8]) -> SgxError {
+    if src.len() > u32::MAX as usize {
+        return Err(sgx_status_t::SGX_ERROR_INVALID_PARAMETER);
+    }
+    if iv.len() != SGX_AESGCM_IV_SIZE {
+        return Err(sgx_status_t::SGX_ERROR_INVALID_PARAMETER);
+    }
+    if aad.len() > u32::MAX as usize {
+        return Err(sgx_status_t::SGX_ERROR_INVALID_PARAMETER);
+    }
+    if dst.len() > u32::MAX as usize {
+        return Err(sgx_status_t::SGX_ERROR_INVALID_PARAMETER);
+    }
+    if dst.len() < src.len() {
+        return Err(sgx_status_t::SGX_ERROR_INVALID_PARAMETER);
+    }
+    Ok(())
+}
+
+///
+/// rsgx_rijndael128GCM_encrypt_batch encrypts a vector of independent
+/// messages under one key in a single call.
+///
+/// # Description
+///
+/// Every message is validated before any is encrypted, so a parameter
+/// error fails the batch without producing partial output; an internal
+/// library failure aborts the batch at the failing message. Each message
+/// is encrypted exactly as by rsgx_rijndael128GCM_encrypt with the same
+/// key; the caller is responsible for IV uniqueness across the batch.
+///
+/// # Requirements
+///
+/// Library: libsgx_tcrypto.a
+///
+/// # Errors
+///
+/// **SGX_ERROR_INVALID_PARAMETER**
+///
+/// Any message has an IV length other than 12 bytes, a destination
+/// buffer shorter than its source, or both source and AAD empty.
+///
+/// **SGX_ERROR_OUT_OF_MEMORY**
+///
+/// Not enough memory is available to complete this operation.
+///
+/// **SGX_ERROR_UNEXPECTED**
+///
+/// An internal cryptography library failure occurred.
+///
+pub fn rsgx_rijndael128GCM_encrypt_batch(
+    key: &sgx_aes_gcm_128bit_key_t,
+    msgs: &mut [SgxGcmEncryptMsg],
+) -> SgxError {
+    for msg in msgs.iter() {
+        check_gcm_buffers(msg.iv, msg.aad, msg.src, msg.dst)?;
+    }
+
+    for msg in msgs.iter_mut() {
+        let ret = unsafe {
+            let p_aad = if !msg.aad.is_empty() {
+                msg.aad.as_ptr()
+            } else {
+                ptr::null()
+            };
+            let (p_src, p_dst) = if !msg.src.is_empty() {
+                (msg.src.as_ptr(), msg.dst.as_mut_ptr())
+            } else {
+                (ptr::null(), ptr::null_mut())
+            };
+
+            sgx_rijndael128GCM_encrypt(
+                key as *const sgx_aes_gcm_128bit_key_t,
+                p_src,
+                msg.src.len() as u32,
+                p_dst,
+                msg.iv.as_ptr(),
+                msg.iv.len() as u32,
+                p_aad,
+                msg.aad.len() as u32,
+                msg.mac as *mut sgx_aes_gcm_128bit_tag_t,
+            )
+        };
+        if ret != sgx_status_t::SGX_SUCCESS {
+            return Err(ret);
+        }
+    }
+    Ok(())
+}
+
+///
+/// rsgx_rijndael128GCM_decrypt_batch decrypts a vector of independent
+/// messages under one key in a single call.
+///
+/// # Description
+///
+/// Every message is validated before any is decrypted. A MAC mismatch
+/// aborts the batch at the failing message; plaintext already written
+/// for earlier messages remains valid, plaintext for later messages is
+/// never produced.
+///
+/// # Requirements
+///
+/// Library: libsgx_tcrypto.a
+///
+/// # Errors
+///
+/// **SGX_ERROR_INVALID_PARAMETER**
+///
+/// Any message has an IV length other than 12 bytes, a destination
+/// buffer shorter than its source, or both source and AAD empty.
+///
+/// **SGX_ERROR_MAC_MISMATCH**
+///
+/// The MAC of some message does not match the MAC calculated.
+///
+/// **SGX_ERROR_OUT_OF_MEMORY**
+///
+/// Not enough memory is available to complete this operation.
+///
+/// **SGX_ERROR_UNEXPECTED**
+///
+/// An internal cryptography library failure occurred.
+///
+pub fn rsgx_rijndael128GCM_decrypt_batch(
+    key: &sgx_aes_gcm_128bit_key_t,
+    msgs: &mut [SgxGcmDecryptMsg],
+) -> SgxError {
+    for msg in msgs.iter() {
+        check_gcm_buffers(msg.iv, msg.aad, msg.src, msg.dst)?;
+    }
+
+    for msg in msgs.iter_mut() {
+        let ret = unsafe {
+            let p_aad = if !msg.aad.is_empty() {
+                msg.aad.as_ptr()
+            } else {
+                ptr::null()
+            };
+            let (p_src, p_dst) = if !msg.src.is_empty() {
+                (msg.src.as_ptr(), msg.dst.as_mut_ptr())
+            } else {
+                (ptr::null(), ptr::null_mut())
+            };
+
+            sgx_rijndael128GCM_decrypt(
+                key as *const sgx_aes_gcm_128bit_key_t,
+                p_src,
+                msg.src.len() as u32,
+                p_dst,
+                msg.iv.as_ptr(),
+                msg.iv.len() as u32,
+                p_aad,
+                msg.aad.len() as u32,
+                msg.mac as *const sgx_aes_gcm_128bit_tag_t,
+            )
+        };
+        if ret != sgx_status_t::SGX_SUCCESS {
+            return Err(ret);
+        }
+    }
+    Ok(())
+}
+
+///
+/// rsgx_sha256_batch hashes a vector of independent messages in a
+/// single call, writing one 256-bit digest per message.
+///
+/// # Description
+///
+/// `hashes` must hold exactly one output element per input message.
+/// Each message is hashed exactly as by rsgx_sha256_slice; a failure
+/// aborts the batch at the failing message.
+///
+/// # Requirements
+///
+/// Library: libsgx_tcrypto.a
+///
+/// # Errors
+///
+/// **SGX_ERROR_INVALID_PARAMETER**
+///
+/// The number of hash outputs does not match the number of messages, or
+/// some message is longer than u32::MAX bytes.
+///
+/// **SGX_ERROR_OUT_OF_MEMORY**
+///
+/// Not enough memory is available to complete this operation.
+///
+/// **SGX_ERROR_UNEXPECTED**
+///
+/// The SHA256 hash calculation failed.
+///
+pub fn rsgx_sha256_batch(msgs: &[&[u8]], hashes: &mut [sgx_sha256_hash_t]) -> SgxError {
+    if msgs.len() != hashes.len() {
+        return Err(sgx_status_t::SGX_ERROR_INVALID_PARAMETER);
+    }
+    for msg in msgs {
+        if msg.len() > u32::MAX as usize {
+            return Err(sgx_status_t::SGX_ERROR_INVALID_PARAMETER);
+        }
+    }
+
+    for (msg, hash) in msgs.iter().zip(hashes.iter_mut()) {
+        let ret = unsafe {
+            sgx_sha256_msg(
+                msg.as_ptr() as *const u8,
+                msg.len() as u32,
+                hash as *mut sgx_sha256_hash_t,
+            )
+        };
+        if ret != sgx_status_t::SGX_SUCCESS {
+            return Err(ret);
+        }
+    }
+    Ok(())
+}
+
+///
+/// One node of a fused AES-CTR + CMAC pass: the caller provides the
+/// counter block (advanced by the call, as in rsgx_aes_ctr_encrypt)
+/// and receives the ciphertext and its CMAC tag. Counter blocks must
+/// be unique per node when the nodes share a key.
+///
+pub struct SgxCtrCmacNode<'a> {
+    pub ctr: &'a mut sgx_aes_ctr_128bit_ctr_t,
+    pub src: &'a [u8],
+    pub dst: &'a mut [u8],
+    pub tag: &'a mut sgx_cmac_128bit_tag_t,
+}
+
+///
+/// One node of a fused CMAC-verify + AES-CTR decrypt pass: the tag is
+/// checked against the ciphertext before any plaintext is produced.
+///
+pub struct SgxCtrCmacVerifyNode<'a> {
+    pub ctr: &'a mut sgx_aes_ctr_128bit_ctr_t,
+    pub src: &'a [u8],
+    pub tag: &'a sgx_cmac_128bit_tag_t,
+    pub dst: &'a mut [u8],
+}
+
+fn check_ctr_buffers(src: &[u8], dst: &[u8]) -> SgxError {
+    if src.is_empty() || src.len() > u32::MAX as usize {
+        return Err(sgx_status_t::SGX_ERROR_INVALID_PARAMETER);
+    }
+    if dst.len() < src.len() {
+        return Err(sgx_status_t::SGX_ERROR_INVALID_PARAMETER);
+    }
+    Ok(())
+}
+
+fn cmac_tag(
+    mac_key: &sgx_cmac_128bit_key_t,
+    data: &[u8],
+    tag: &mut sgx_cmac_128bit_tag_t,
+) -> SgxError {
+    let ret = unsafe {
+        sgx_rijndael128_cmac_msg(
+            mac_key as *const sgx_cmac_128bit_key_t,
+            data.as_ptr(),
+            data.len() as u32,
+            tag as *mut sgx_cmac_128bit_tag_t,
+        )
+    };
+    match ret {
+        sgx_status_t::SGX_SUCCESS => Ok(()),
+        _ => Err(ret),
+    }
+}
+
+fn tag_eq(a: &sgx_cmac_128bit_tag_t, b: &sgx_cmac_128bit_tag_t) -> bool {
+    // Constant-time compare: fold every byte difference before testing.
+    let mut acc = 0_u8;
+    for (x, y) in a.iter().zip(b.iter()) {
+        acc |= x ^ y;
+    }
+    acc == 0
+}
+
+///
+/// rsgx_aes_ctr_cmac_encrypt encrypts one node with AES-CTR and MACs
+/// the ciphertext in a single call.
+///
+/// # Description
+///
+/// Encrypt-then-MAC for one fixed node, fused so callers protecting a
+/// node-per-call format (the protected FS layout, for instance) make
+/// one library round trip with one set of argument checks instead of
+/// an encrypt pass and a separate MAC pass. The counter block is
+/// advanced in place exactly as rsgx_aes_ctr_encrypt advances it; the
+/// tag covers the ciphertext bytes, src.len() of them.
+///
+/// # Requirements
+///
+/// Library: libsgx_tcrypto.a
+///
+/// # Errors
+///
+/// **SGX_ERROR_INVALID_PARAMETER**
+///
+/// The source is empty or longer than the destination.
+///
+/// **SGX_ERROR_OUT_OF_MEMORY**
+///
+/// Not enough memory is available to complete this operation.
+///
+/// **SGX_ERROR_UNEXPECTED**
+///
+/// An internal cryptography library failure occurred.
+///
+pub fn rsgx_aes_ctr_cmac_encrypt(
+    ctr_key: &sgx_aes_ctr_128bit_key_t,
+    mac_key: &sgx_cmac_128bit_key_t,
+    ctr_inc_bits: u32,
+    node: &mut SgxCtrCmacNode,
+) -> SgxError {
+    check_ctr_buffers(node.src, node.dst)?;
+
+    let ret = unsafe {
+        sgx_aes_ctr_encrypt(
+            ctr_key as *const sgx_aes_ctr_128bit_key_t,
+            node.src.as_ptr(),
+            node.src.len() as u32,
+            node.ctr as *mut sgx_aes_ctr_128bit_ctr_t as *mut u8,
+            ctr_inc_bits,
+            node.dst.as_mut_ptr(),
+        )
+    };
+    if ret != sgx_status_t::SGX_SUCCESS {
+        return Err(ret);
+    }
+
+    cmac_tag(mac_key, &node.dst[..node.src.len()], node.tag)
+}
+
+///
+/// rsgx_aes_ctr_cmac_encrypt_nodes runs the fused encrypt-then-MAC
+/// pass over a whole window of nodes in one call.
+///
+/// # Description
+///
+/// Every node is validated before any is touched. The loop issues the
+/// encryption of node N before the MAC of node N-1, so the two
+/// operations of adjacent nodes sit next to each other in issue order;
+/// the prebuilt library executes them back to back on the calling TCS,
+/// and a backend with interleaved AES-NI schedules can overlap them
+/// under the same signature. Intended for read-ahead and write-behind
+/// engines that already hold a multi-node window.
+///
+/// # Requirements
+///
+/// Library: libsgx_tcrypto.a
+///
+/// # Errors
+///
+/// **SGX_ERROR_INVALID_PARAMETER**
+///
+/// Some node has an empty source or a destination shorter than its
+/// source.
+///
+/// **SGX_ERROR_OUT_OF_MEMORY**
+///
+/// Not enough memory is available to complete this operation.
+///
+/// **SGX_ERROR_UNEXPECTED**
+///
+/// An internal cryptography library failure occurred.
+///
+pub fn rsgx_aes_ctr_cmac_encrypt_nodes(
+    ctr_key: &sgx_aes_ctr_128bit_key_t,
+    mac_key: &sgx_cmac_128bit_key_t,
+    ctr_inc_bits: u32,
+    nodes: &mut [SgxCtrCmacNode],
+) -> SgxError {
+    for node in nodes.iter() {
+        check_ctr_buffers(node.src, node.dst)?;
+    }
+
+    for i in 0..nodes.len() {
+        let (done, rest) = nodes.split_at_mut(i);
+        let node = &mut rest[0];
+
+        let ret = unsafe {
+            sgx_aes_ctr_encrypt(
+                ctr_key as *const sgx_aes_ctr_128bit_key_t,
+                node.src.as_ptr(),
+                node.src.len() as u32,
+                node.ctr as *mut sgx_aes_ctr_128bit_ctr_t as *mut u8,
+                ctr_inc_bits,
+                node.dst.as_mut_ptr(),
+            )
+        };
+        if ret != sgx_status_t::SGX_SUCCESS {
+            return Err(ret);
+        }
+
+        if let Some(prev) = done.last_mut() {
+            cmac_tag(mac_key, &prev.dst[..prev.src.len()], prev.tag)?;
+        }
+    }
+
+    if let Some(last) = nodes.last_mut() {
+        cmac_tag(mac_key, &last.dst[..last.src.len()], last.tag)?;
+    }
+    Ok(())
+}
+
+///
+/// rsgx_aes_ctr_cmac_decrypt_nodes verifies and decrypts a window of
+/// nodes in one call.
+///
+/// # Description
+///
+/// Every node is validated before any is touched. Each node's tag is
+/// recomputed over the ciphertext and compared in constant time before
+/// that node is decrypted, so no unauthenticated plaintext is ever
+/// produced; the verify of node N is issued before the decrypt of node
+/// N-1 for the same issue-order pairing as the encrypt side. A
+/// mismatch aborts the window at the failing node; plaintext already
+/// written for earlier nodes remains valid.
+///
+/// # Requirements
+///
+/// Library: libsgx_tcrypto.a
+///
+/// # Errors
+///
+/// **SGX_ERROR_INVALID_PARAMETER**
+///
+/// Some node has an empty source or a destination shorter than its
+/// source.
+///
+/// **SGX_ERROR_MAC_MISMATCH**
+///
+/// The tag of some node does not match the tag calculated.
+///
+/// **SGX_ERROR_OUT_OF_MEMORY**
+///
+/// Not enough memory is available to complete this operation.
+///
+/// **SGX_ERROR_UNEXPECTED**
+///
+/// An internal cryptography library failure occurred.
+///
+pub fn rsgx_aes_ctr_cmac_decrypt_nodes(
+    ctr_key: &sgx_aes_ctr_128bit_key_t,
+    mac_key: &sgx_cmac_128bit_key_t,
+    ctr_inc_bits: u32,
+    nodes: &mut [SgxCtrCmacVerifyNode],
+) -> SgxError {
+    for node in nodes.iter() {
+        check_ctr_buffers(node.src, node.dst)?;
+    }
+
+    let mut pending_ok = false;
+    for i in 0..nodes.len() {
+        let (done, rest) = nodes.split_at_mut(i);
+        let node = &mut rest[0];
+
+        let mut actual = sgx_cmac_128bit_tag_t::default();
+        cmac_tag(mac_key, node.src, &mut actual)?;
+        let ok = tag_eq(&actual, node.tag);
+
+        if pending_ok {
+            let prev = done.last_mut().unwrap();
+            let ret = unsafe {
+                sgx_aes_ctr_decrypt(
+                    ctr_key as *const sgx_aes_ctr_128bit_key_t,
+                    prev.src.as_ptr(),
+                    prev.src.len() as u32,
+                    prev.ctr as *mut sgx_aes_ctr_128bit_ctr_t as *mut u8,
+                    ctr_inc_bits,
+                    prev.dst.as_mut_ptr(),
+                )
+            };
+            if ret != sgx_status_t::SGX_SUCCESS {
+                return Err(ret);
+            }
+        }
+
+        if !ok {
+            return Err(sgx_status_t::SGX_ERROR_MAC_MISMATCH);
+        }
+        pending_ok = true;
+    }
+
+    if pending_ok {
+        let last = nodes.last_mut().unwrap();
+        let ret = unsafe {
+            sgx_aes_ctr_decrypt(
+                ctr_key as *const sgx_aes_ctr_128bit_key_t,
+                last.src.as_ptr(),
+                last.src.len() as u32,
+                last.ctr as *mut sgx_aes_ctr_128bit_ctr_t as *mut u8,
+                ctr_inc_bits,
+                last.dst.as_mut_ptr(),
+            )
+        };
+        if ret != sgx_status_t::SGX_SUCCESS {
+            return Err(ret);
+        }
+    }
+    Ok(())
+}
@@ -27,7 +27,18 @@
 #![allow(non_snake_case)]
 #![allow(clippy::too_many_arguments)]
 
+extern crate alloc;
 extern crate sgx_types;
 
+mod batch;
 mod crypto;
+mod engine;
+mod paged;
+mod shared;
+mod streaming;
+pub use self::batch::*;
 pub use self::crypto::*;
+pub use self::engine::*;
+pub use self::paged::*;
+pub use self::shared::*;
+pub use self::streaming::*;
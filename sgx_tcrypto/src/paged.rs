@@ -0,0 +1,345 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License..
+
+//!
+//! Merkle-Verified Paged Read-Only Files
+//!
+//! [`SgxSharedRoRegion`] re-verifies on every read because the host
+//! copy is the only copy. For a dataset far larger than EPC that is
+//! the wrong trade: hot pages are re-hashed on every touch. This
+//! module keeps a bounded pool of VERIFIED page copies inside the
+//! enclave - a cached frame is trusted memory, so hits cost a map
+//! lookup and a memcpy, no hash - and verifies 4K pages lazily, on
+//! first access after a map or an eviction. A 20GB file is consumed
+//! by a 2GB-EPC enclave at roughly page-cache speed.
+//!
+//! The file itself is mapped into untrusted memory with the mmap
+//! ocall (`MAP_SHARED`, read-only), so the host page cache backs it
+//! and co-located enclaves share the physical pages. Trusted metadata
+//! is two-level to stay small at 4K granularity: the per-page leaf
+//! hashes live untrusted next to the mapping, and the enclave keeps
+//! only a digest per 4K *group* of leaves (one group covers 128 pages,
+//! i.e. 32 bytes of EPC per 512KB of file - ~1.2MB for 20GB). A page
+//! fault verifies the leaf group against its trusted digest, then the
+//! page against its leaf. The root over the group digests is the
+//! file's identity; deliver it as for [`SgxSharedRoRegion`].
+//!
+//! [`SgxSharedRoRegion`]: crate::shared::SgxSharedRoRegion
+//!
+
+use alloc::collections::BTreeMap;
+use alloc::vec;
+use alloc::vec::Vec;
+use core::mem;
+use core::ptr;
+use sgx_libc::{self, c_int, c_void, off_t};
+use sgx_libc::ocall;
+use sgx_trts::trts::rsgx_raw_is_outside_enclave;
+use sgx_types::*;
+use crate::shared::{merkle_root, sha256};
+
+/// Verification granularity; matches the hardware page so a fault
+/// never stages more than it must.
+pub const SGX_PAGED_RO_PAGE_SIZE: usize = 4096;
+
+/// Leaf hashes per group: one group of leaves fills exactly one page.
+const LEAVES_PER_GROUP: usize = SGX_PAGED_RO_PAGE_SIZE / mem::size_of::<sgx_sha256_hash_t>();
+
+/// Default verified-page pool: 4096 frames = 16MB of EPC.
+pub const SGX_PAGED_RO_DEFAULT_POOL_PAGES: usize = 4096;
+
+///
+/// rsgx_build_paged_ro_manifest hashes `data` in 4K pages and returns
+/// the per-page leaf hashes plus the root over the leaf-group digests.
+/// Publish the leaves next to the file in untrusted memory; the root
+/// travels through a trusted path.
+///
+pub fn rsgx_build_paged_ro_manifest(
+    data: &[u8],
+) -> (Vec<sgx_sha256_hash_t>, sgx_sha256_hash_t) {
+    let leaves: Vec<sgx_sha256_hash_t> = data
+        .chunks(SGX_PAGED_RO_PAGE_SIZE)
+        .map(|p| sha256(&[p]))
+        .collect();
+    let root = merkle_root(&group_digests_of(&leaves));
+    (leaves, root)
+}
+
+fn group_digests_of(leaves: &[sgx_sha256_hash_t]) -> Vec<sgx_sha256_hash_t> {
+    leaves
+        .chunks(LEAVES_PER_GROUP)
+        .map(|group| {
+            let mut ctx = crate::streaming::SgxSha256Context::new();
+            for leaf in group {
+                ctx.update(leaf);
+            }
+            ctx.finish()
+        })
+        .collect()
+}
+
+struct Frame {
+    page: usize,
+    referenced: bool,
+    data: Vec<u8>,
+}
+
+///
+/// A large read-only file mapped in untrusted memory, read through a
+/// bounded pool of Merkle-verified page copies in EPC.
+///
+/// Pages are verified on first touch and on re-fetch after eviction;
+/// a host that flips bytes under the mapping turns the next fetch of
+/// the affected page into `SGX_ERROR_MAC_MISMATCH`, never into wrong
+/// data. Eviction is CLOCK: each frame carries a reference bit set on
+/// hit, and the hand sweeps frames, clearing bits until it finds one
+/// already clear.
+///
+pub struct SgxPagedRoFile {
+    base: *const u8,
+    len: usize,
+    map_len: usize,
+    // untrusted leaf array published next to the file
+    manifest: *const sgx_sha256_hash_t,
+    // trusted digest per 4K group of leaves
+    group_digests: Vec<sgx_sha256_hash_t>,
+    frames: Vec<Frame>,
+    pool_pages: usize,
+    resident: BTreeMap<usize, usize>,
+    hand: usize,
+    // staging page for leaf groups, so verification and use of a
+    // group see the same bytes
+    leaf_scratch: Vec<u8>,
+}
+
+impl SgxPagedRoFile {
+    ///
+    /// Maps `len` bytes of the open untrusted file `fd` read-only via
+    /// the mmap ocall and attaches to it. `manifest` points to the
+    /// untrusted per-page leaf array; the enclave digests it in 4K
+    /// groups and checks the digests against `root` before keeping
+    /// them. `pool_pages` bounds the verified-copy pool (0 picks
+    /// [`SGX_PAGED_RO_DEFAULT_POOL_PAGES`]).
+    ///
+    /// # Safety
+    ///
+    /// `fd` must stay open and `manifest` must describe a live host
+    /// mapping for the lifetime of the file.
+    ///
+    pub unsafe fn map(
+        fd: c_int,
+        len: usize,
+        manifest: *const sgx_sha256_hash_t,
+        root: &sgx_sha256_hash_t,
+        pool_pages: usize,
+    ) -> SgxResult<SgxPagedRoFile> {
+        if fd < 0 || len == 0 || manifest.is_null() {
+            return Err(sgx_status_t::SGX_ERROR_INVALID_PARAMETER);
+        }
+        let npages = (len + SGX_PAGED_RO_PAGE_SIZE - 1) / SGX_PAGED_RO_PAGE_SIZE;
+        if !rsgx_raw_is_outside_enclave(
+            manifest as *const u8,
+            npages * mem::size_of::<sgx_sha256_hash_t>(),
+        ) {
+            return Err(sgx_status_t::SGX_ERROR_INVALID_PARAMETER);
+        }
+
+        let map_len = npages * SGX_PAGED_RO_PAGE_SIZE;
+        let base = ocall::mmap(
+            ptr::null_mut(),
+            map_len,
+            sgx_libc::PROT_READ,
+            sgx_libc::MAP_SHARED,
+            fd,
+            0 as off_t,
+        );
+        if base as isize == -1 || base.is_null() {
+            return Err(sgx_status_t::SGX_ERROR_UNEXPECTED);
+        }
+
+        let mut file = SgxPagedRoFile {
+            base: base as *const u8,
+            len,
+            map_len,
+            manifest,
+            group_digests: Vec::new(),
+            frames: Vec::new(),
+            pool_pages: if pool_pages == 0 {
+                SGX_PAGED_RO_DEFAULT_POOL_PAGES
+            } else {
+                pool_pages
+            },
+            resident: BTreeMap::new(),
+            hand: 0,
+            leaf_scratch: vec![0_u8; SGX_PAGED_RO_PAGE_SIZE],
+        };
+
+        // digest the untrusted leaf array in trusted staging and check
+        // the digests against the root; only the digests stay inside
+        let ngroups = (npages + LEAVES_PER_GROUP - 1) / LEAVES_PER_GROUP;
+        let mut digests = Vec::with_capacity(ngroups);
+        for group in 0..ngroups {
+            let glen = file.stage_leaf_group(group, npages);
+            digests.push(sha256(&[&file.leaf_scratch[..glen]]));
+        }
+        if merkle_root(&digests) != *root {
+            ocall::munmap(base, map_len);
+            // keep Drop from unmapping a second time
+            file.map_len = 0;
+            return Err(sgx_status_t::SGX_ERROR_MAC_MISMATCH);
+        }
+        file.group_digests = digests;
+        Ok(file)
+    }
+
+    pub fn len(&self) -> usize {
+        self.len
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.len == 0
+    }
+
+    /// Verified pages currently resident in the pool.
+    pub fn resident_pages(&self) -> usize {
+        self.resident.len()
+    }
+
+    ///
+    /// Copies `dst.len()` bytes starting at `offset` into the caller's
+    /// buffer. Pages already in the pool are served from their trusted
+    /// copies without re-hashing; missing pages are fetched, verified
+    /// and cached first, evicting with CLOCK when the pool is full.
+    ///
+    pub fn read(&mut self, offset: usize, dst: &mut [u8]) -> SgxError {
+        let end = offset
+            .checked_add(dst.len())
+            .ok_or(sgx_status_t::SGX_ERROR_INVALID_PARAMETER)?;
+        if end > self.len {
+            return Err(sgx_status_t::SGX_ERROR_INVALID_PARAMETER);
+        }
+
+        let mut copied = 0;
+        while copied < dst.len() {
+            let pos = offset + copied;
+            let page = pos / SGX_PAGED_RO_PAGE_SIZE;
+            let frame_idx = match self.resident.get(&page) {
+                Some(&idx) => {
+                    self.frames[idx].referenced = true;
+                    idx
+                }
+                None => self.fetch_page(page)?,
+            };
+
+            let in_page = pos % SGX_PAGED_RO_PAGE_SIZE;
+            let page_len = SGX_PAGED_RO_PAGE_SIZE
+                .min(self.len - page * SGX_PAGED_RO_PAGE_SIZE);
+            let n = (page_len - in_page).min(dst.len() - copied);
+            dst[copied..copied + n]
+                .copy_from_slice(&self.frames[frame_idx].data[in_page..in_page + n]);
+            copied += n;
+        }
+        Ok(())
+    }
+
+    /// Stages the `group`-th 4K block of the untrusted leaf array into
+    /// `leaf_scratch`, returning the staged byte length.
+    fn stage_leaf_group(&mut self, group: usize, npages: usize) -> usize {
+        let first = group * LEAVES_PER_GROUP;
+        let count = LEAVES_PER_GROUP.min(npages - first);
+        let glen = count * mem::size_of::<sgx_sha256_hash_t>();
+        unsafe {
+            ptr::copy_nonoverlapping(
+                self.manifest.add(first) as *const u8,
+                self.leaf_scratch.as_mut_ptr(),
+                glen,
+            );
+        }
+        glen
+    }
+
+    /// Verifies `page` against the manifest and caches it, returning
+    /// its frame index. The leaf comes out of a freshly staged and
+    /// digest-checked leaf group, so a host rewriting leaves after
+    /// attach is caught here too.
+    fn fetch_page(&mut self, page: usize) -> SgxResult<usize> {
+        let npages = (self.len + SGX_PAGED_RO_PAGE_SIZE - 1) / SGX_PAGED_RO_PAGE_SIZE;
+        let group = page / LEAVES_PER_GROUP;
+        let glen = self.stage_leaf_group(group, npages);
+        if sha256(&[&self.leaf_scratch[..glen]]) != self.group_digests[group] {
+            return Err(sgx_status_t::SGX_ERROR_MAC_MISMATCH);
+        }
+        let mut leaf: sgx_sha256_hash_t = Default::default();
+        let off = (page % LEAVES_PER_GROUP) * mem::size_of::<sgx_sha256_hash_t>();
+        leaf.copy_from_slice(&self.leaf_scratch[off..off + mem::size_of::<sgx_sha256_hash_t>()]);
+
+        let idx = self.grab_frame();
+        let page_len = SGX_PAGED_RO_PAGE_SIZE
+            .min(self.len - page * SGX_PAGED_RO_PAGE_SIZE);
+        unsafe {
+            ptr::copy_nonoverlapping(
+                self.base.add(page * SGX_PAGED_RO_PAGE_SIZE),
+                self.frames[idx].data.as_mut_ptr(),
+                page_len,
+            );
+        }
+        if sha256(&[&self.frames[idx].data[..page_len]]) != leaf {
+            return Err(sgx_status_t::SGX_ERROR_MAC_MISMATCH);
+        }
+
+        self.frames[idx].page = page;
+        self.frames[idx].referenced = true;
+        self.resident.insert(page, idx);
+        Ok(idx)
+    }
+
+    /// Returns a free frame index, growing the pool up to its bound
+    /// and evicting with CLOCK afterwards.
+    fn grab_frame(&mut self) -> usize {
+        if self.frames.len() < self.pool_pages {
+            self.frames.push(Frame {
+                page: usize::MAX,
+                referenced: false,
+                data: vec![0_u8; SGX_PAGED_RO_PAGE_SIZE],
+            });
+            return self.frames.len() - 1;
+        }
+        loop {
+            if self.hand >= self.frames.len() {
+                self.hand = 0;
+            }
+            let idx = self.hand;
+            self.hand += 1;
+            if self.frames[idx].referenced {
+                self.frames[idx].referenced = false;
+            } else {
+                self.resident.remove(&self.frames[idx].page);
+                return idx;
+            }
+        }
+    }
+}
+
+impl Drop for SgxPagedRoFile {
+    fn drop(&mut self) {
+        if self.map_len != 0 {
+            unsafe {
+                ocall::munmap(self.base as *mut c_void, self.map_len);
+            }
+        }
+    }
+}
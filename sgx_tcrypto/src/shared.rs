@@ -0,0 +1,219 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License..
+
+//!
+//! Merkle-Verified Shared Read-Only Regions
+//!
+//! EPC pages belong to exactly one enclave, so co-located enclaves
+//! cannot share them; N instances of the same large read-only table
+//! cost N copies of EPC. The supported way to share is to keep ONE
+//! copy in untrusted memory - the host maps the same file into every
+//! process, so the physical pages are shared system-wide - and have
+//! each enclave verify what it reads. [`SgxSharedRoRegion`] implements
+//! that: the region is chunked, a Merkle manifest of chunk hashes is
+//! checked against a trusted root at attach time, and every read
+//! stages its chunks through a trusted scratch buffer and rehashes
+//! them before use, so a host that flips bytes after attach produces
+//! an error, never wrong data. EPC cost per enclave drops from the
+//! table size to one scratch chunk.
+//!
+//! The root hash is the region's identity; bake it into the enclave,
+//! seal it, or deliver it over an attested channel. Re-verification on
+//! every read is what makes the shared copy safe - there is no sound
+//! "verified once" fast path over memory the host can change.
+//!
+
+use alloc::vec;
+use alloc::vec::Vec;
+use core::ptr;
+use sgx_trts::trts::rsgx_raw_is_outside_enclave;
+use sgx_types::*;
+use crate::streaming::SgxSha256Context;
+
+/// Default chunk size: the unit of verification and of trusted scratch.
+pub const SGX_SHARED_RO_CHUNK_SIZE: usize = 256 * 1024;
+
+pub(crate) fn sha256(parts: &[&[u8]]) -> sgx_sha256_hash_t {
+    let mut ctx = SgxSha256Context::new();
+    for part in parts {
+        ctx.update(part);
+    }
+    ctx.finish()
+}
+
+/// Computes the Merkle root of a slice of leaf (chunk) hashes: pairs
+/// are hashed together level by level, odd tails promoted unchanged.
+pub(crate) fn merkle_root(leaves: &[sgx_sha256_hash_t]) -> sgx_sha256_hash_t {
+    if leaves.is_empty() {
+        return sha256(&[&[]]);
+    }
+    let mut level: Vec<sgx_sha256_hash_t> = leaves.to_vec();
+    while level.len() > 1 {
+        let mut next = Vec::with_capacity((level.len() + 1) / 2);
+        for pair in level.chunks(2) {
+            if pair.len() == 2 {
+                next.push(sha256(&[&pair[0], &pair[1]]));
+            } else {
+                next.push(pair[0]);
+            }
+        }
+        level = next;
+    }
+    level[0]
+}
+
+///
+/// rsgx_build_shared_ro_manifest hashes `data` in chunks and returns
+/// the leaf hashes plus the Merkle root. Run it wherever the
+/// authoritative copy of the table lives (a provisioning enclave, a
+/// build step); publish the leaves next to the shared mapping and the
+/// root through a trusted path.
+///
+pub fn rsgx_build_shared_ro_manifest(
+    data: &[u8],
+    chunk_size: usize,
+) -> (Vec<sgx_sha256_hash_t>, sgx_sha256_hash_t) {
+    let chunk_size = chunk_size.max(1);
+    let leaves: Vec<sgx_sha256_hash_t> =
+        data.chunks(chunk_size).map(|c| sha256(&[c])).collect();
+    let root = merkle_root(&leaves);
+    (leaves, root)
+}
+
+///
+/// A read-only region in untrusted memory whose contents are verified
+/// against a trusted Merkle root on every read.
+///
+pub struct SgxSharedRoRegion {
+    base: *const u8,
+    len: usize,
+    chunk_size: usize,
+    // chunk hashes, copied into trusted memory after checking against
+    // the root; ~32B per chunk, i.e. 100KB of EPC for 800MB shared
+    leaves: Vec<sgx_sha256_hash_t>,
+    scratch: Vec<u8>,
+}
+
+impl SgxSharedRoRegion {
+    ///
+    /// Attaches to a host-mapped region. `manifest` points to the leaf
+    /// hash array published next to the mapping; it is validated
+    /// against `root` and copied inside before use. Fails if region or
+    /// manifest are not entirely outside the enclave or the manifest
+    /// does not hash to `root`.
+    ///
+    /// # Safety
+    ///
+    /// `base`/`len` and `manifest` must describe live host mappings
+    /// for the lifetime of the region.
+    ///
+    pub unsafe fn attach(
+        base: *const u8,
+        len: usize,
+        manifest: *const sgx_sha256_hash_t,
+        root: &sgx_sha256_hash_t,
+        chunk_size: usize,
+    ) -> SgxResult<SgxSharedRoRegion> {
+        let chunk_size = chunk_size.max(1);
+        let nchunks = (len + chunk_size - 1) / chunk_size;
+        if base.is_null() || len == 0 || manifest.is_null() {
+            return Err(sgx_status_t::SGX_ERROR_INVALID_PARAMETER);
+        }
+        if !rsgx_raw_is_outside_enclave(base, len)
+            || !rsgx_raw_is_outside_enclave(
+                manifest as *const u8,
+                nchunks * core::mem::size_of::<sgx_sha256_hash_t>(),
+            )
+        {
+            return Err(sgx_status_t::SGX_ERROR_INVALID_PARAMETER);
+        }
+
+        // copy the manifest into trusted memory first, then check the
+        // trusted copy against the root - the host copy is free to
+        // change afterwards without effect
+        let mut leaves: Vec<sgx_sha256_hash_t> = Vec::with_capacity(nchunks);
+        for i in 0..nchunks {
+            leaves.push(ptr::read_volatile(manifest.add(i)));
+        }
+        if merkle_root(&leaves) != *root {
+            return Err(sgx_status_t::SGX_ERROR_MAC_MISMATCH);
+        }
+
+        Ok(SgxSharedRoRegion {
+            base,
+            len,
+            chunk_size,
+            leaves,
+            scratch: vec![0_u8; chunk_size],
+        })
+    }
+
+    pub fn len(&self) -> usize {
+        self.len
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.len == 0
+    }
+
+    pub fn chunk_size(&self) -> usize {
+        self.chunk_size
+    }
+
+    ///
+    /// Copies `dst.len()` bytes starting at `offset` into the enclave,
+    /// verifying every covered chunk against its trusted leaf hash on
+    /// the way. Returns `SGX_ERROR_MAC_MISMATCH` if the host mapping
+    /// no longer matches the manifest.
+    ///
+    pub fn read_verified(&mut self, offset: usize, dst: &mut [u8]) -> SgxError {
+        let end = offset
+            .checked_add(dst.len())
+            .ok_or(sgx_status_t::SGX_ERROR_INVALID_PARAMETER)?;
+        if end > self.len {
+            return Err(sgx_status_t::SGX_ERROR_INVALID_PARAMETER);
+        }
+
+        let mut copied = 0;
+        while copied < dst.len() {
+            let pos = offset + copied;
+            let chunk_idx = pos / self.chunk_size;
+            let chunk_start = chunk_idx * self.chunk_size;
+            let chunk_len = self.chunk_size.min(self.len - chunk_start);
+
+            // stage the whole chunk inside, then hash the staged copy:
+            // verification and use see the same bytes
+            unsafe {
+                ptr::copy_nonoverlapping(
+                    self.base.add(chunk_start),
+                    self.scratch.as_mut_ptr(),
+                    chunk_len,
+                );
+            }
+            if sha256(&[&self.scratch[..chunk_len]]) != self.leaves[chunk_idx] {
+                return Err(sgx_status_t::SGX_ERROR_MAC_MISMATCH);
+            }
+
+            let in_chunk = pos - chunk_start;
+            let n = (chunk_len - in_chunk).min(dst.len() - copied);
+            dst[copied..copied + n]
+                .copy_from_slice(&self.scratch[in_chunk..in_chunk + n]);
+            copied += n;
+        }
+        Ok(())
+    }
+}
@@ -0,0 +1,288 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License..
+
+//!
+//! Streaming Hash and MAC Contexts
+//!
+//! [`SgxShaHandle`] and [`SgxHmacHandle`] wrap library-allocated state:
+//! every init heap-allocates a context through the IPP wrapper and every
+//! close frees it, which shows up as heap churn when contexts are
+//! created per stream. The contexts here are plain values - the whole
+//! state is a few hundred bytes resident wherever the caller puts them,
+//! they move like any other value, and neither construction, update nor
+//! finalization ever touches the allocator.
+//!
+//! The compression function is implemented in this crate rather than in
+//! libsgx_tcrypto.a; SHA-256 has no data-dependent branches or table
+//! lookups, so the software path leaks nothing through timing. One-shot
+//! hashing of a complete buffer should keep using [`rsgx_sha256_msg`],
+//! which goes through the hardware-tuned library.
+//!
+//! [`SgxShaHandle`]: crate::SgxShaHandle
+//! [`SgxHmacHandle`]: crate::SgxHmacHandle
+//! [`rsgx_sha256_msg`]: crate::rsgx_sha256_msg
+//!
+use sgx_types::*;
+
+const SHA256_BLOCK_SIZE: usize = 64;
+
+const K: [u32; 64] = [
+    0x428a_2f98, 0x7137_4491, 0xb5c0_fbcf, 0xe9b5_dba5,
+    0x3956_c25b, 0x59f1_11f1, 0x923f_82a4, 0xab1c_5ed5,
+    0xd807_aa98, 0x1283_5b01, 0x2431_85be, 0x550c_7dc3,
+    0x72be_5d74, 0x80de_b1fe, 0x9bdc_06a7, 0xc19b_f174,
+    0xe49b_69c1, 0xefbe_4786, 0x0fc1_9dc6, 0x240c_a1cc,
+    0x2de9_2c6f, 0x4a74_84aa, 0x5cb0_a9dc, 0x76f9_88da,
+    0x983e_5152, 0xa831_c66d, 0xb003_27c8, 0xbf59_7fc7,
+    0xc6e0_0bf3, 0xd5a7_9147, 0x06ca_6351, 0x1429_2967,
+    0x27b7_0a85, 0x2e1b_2138, 0x4d2c_6dfc, 0x5338_0d13,
+    0x650a_7354, 0x766a_0abb, 0x81c2_c92e, 0x9272_2c85,
+    0xa2bf_e8a1, 0xa81a_664b, 0xc24b_8b70, 0xc76c_51a3,
+    0xd192_e819, 0xd699_0624, 0xf40e_3585, 0x106a_a070,
+    0x19a4_c116, 0x1e37_6c08, 0x2748_774c, 0x34b0_bcb5,
+    0x391c_0cb3, 0x4ed8_aa4a, 0x5b9c_ca4f, 0x682e_6ff3,
+    0x748f_82ee, 0x78a5_636f, 0x84c8_7814, 0x8cc7_0208,
+    0x90be_fffa, 0xa450_6ceb, 0xbef9_a3f7, 0xc671_78f2,
+];
+
+const H0: [u32; 8] = [
+    0x6a09_e667, 0xbb67_ae85, 0x3c6e_f372, 0xa54f_f53a,
+    0x510e_527f, 0x9b05_688c, 0x1f83_d9ab, 0x5be0_cd19,
+];
+
+///
+/// A stack-resident streaming SHA-256 context.
+///
+/// The context is a plain value: it can be embedded in other structs,
+/// moved across stack frames, and copied to fork a hash over a common
+/// prefix. [`update`] and [`finish`] are guaranteed allocation-free.
+///
+/// [`update`]: SgxSha256Context::update
+/// [`finish`]: SgxSha256Context::finish
+///
+#[derive(Clone, Copy)]
+pub struct SgxSha256Context {
+    state: [u32; 8],
+    block: [u8; SHA256_BLOCK_SIZE],
+    block_len: usize,
+    total_len: u64,
+}
+
+impl SgxSha256Context {
+    ///
+    /// Constructs an initialized SHA-256 context.
+    ///
+    pub fn new() -> SgxSha256Context {
+        SgxSha256Context {
+            state: H0,
+            block: [0_u8; SHA256_BLOCK_SIZE],
+            block_len: 0,
+            total_len: 0,
+        }
+    }
+
+    ///
+    /// Absorbs `data` into the hash. Never allocates, so a 10GB stream
+    /// fed in 64K chunks leaves the enclave heap untouched.
+    ///
+    pub fn update(&mut self, data: &[u8]) {
+        self.total_len = self.total_len.wrapping_add(data.len() as u64);
+        let mut input = data;
+
+        if self.block_len > 0 {
+            let fill = core::cmp::min(SHA256_BLOCK_SIZE - self.block_len, input.len());
+            self.block[self.block_len..self.block_len + fill].copy_from_slice(&input[..fill]);
+            self.block_len += fill;
+            input = &input[fill..];
+            if self.block_len == SHA256_BLOCK_SIZE {
+                let block = self.block;
+                self.compress(&block);
+                self.block_len = 0;
+            }
+        }
+
+        while input.len() >= SHA256_BLOCK_SIZE {
+            let mut block = [0_u8; SHA256_BLOCK_SIZE];
+            block.copy_from_slice(&input[..SHA256_BLOCK_SIZE]);
+            self.compress(&block);
+            input = &input[SHA256_BLOCK_SIZE..];
+        }
+
+        if !input.is_empty() {
+            self.block[..input.len()].copy_from_slice(input);
+            self.block_len = input.len();
+        }
+    }
+
+    ///
+    /// Consumes the context and returns the 256-bit digest.
+    ///
+    pub fn finish(mut self) -> sgx_sha256_hash_t {
+        let bit_len = self.total_len.wrapping_mul(8);
+
+        // padding: 0x80, zeros, 64-bit big-endian length
+        self.block[self.block_len] = 0x80;
+        for byte in self.block[self.block_len + 1..].iter_mut() {
+            *byte = 0;
+        }
+        if self.block_len + 1 + 8 > SHA256_BLOCK_SIZE {
+            let block = self.block;
+            self.compress(&block);
+            self.block = [0_u8; SHA256_BLOCK_SIZE];
+        }
+        self.block[SHA256_BLOCK_SIZE - 8..].copy_from_slice(&bit_len.to_be_bytes());
+        let block = self.block;
+        self.compress(&block);
+
+        let mut hash: sgx_sha256_hash_t = Default::default();
+        for (chunk, word) in hash.chunks_exact_mut(4).zip(self.state.iter()) {
+            chunk.copy_from_slice(&word.to_be_bytes());
+        }
+        hash
+    }
+
+    fn compress(&mut self, block: &[u8; SHA256_BLOCK_SIZE]) {
+        let mut w = [0_u32; 64];
+        for (i, chunk) in block.chunks_exact(4).enumerate() {
+            let mut word = [0_u8; 4];
+            word.copy_from_slice(chunk);
+            w[i] = u32::from_be_bytes(word);
+        }
+        for i in 16..64 {
+            let s0 = w[i - 15].rotate_right(7) ^ w[i - 15].rotate_right(18) ^ (w[i - 15] >> 3);
+            let s1 = w[i - 2].rotate_right(17) ^ w[i - 2].rotate_right(19) ^ (w[i - 2] >> 10);
+            w[i] = w[i - 16]
+                .wrapping_add(s0)
+                .wrapping_add(w[i - 7])
+                .wrapping_add(s1);
+        }
+
+        let [mut a, mut b, mut c, mut d, mut e, mut f, mut g, mut h] = self.state;
+        for i in 0..64 {
+            let s1 = e.rotate_right(6) ^ e.rotate_right(11) ^ e.rotate_right(25);
+            let ch = (e & f) ^ ((!e) & g);
+            let t1 = h
+                .wrapping_add(s1)
+                .wrapping_add(ch)
+                .wrapping_add(K[i])
+                .wrapping_add(w[i]);
+            let s0 = a.rotate_right(2) ^ a.rotate_right(13) ^ a.rotate_right(22);
+            let maj = (a & b) ^ (a & c) ^ (b & c);
+            let t2 = s0.wrapping_add(maj);
+
+            h = g;
+            g = f;
+            f = e;
+            e = d.wrapping_add(t1);
+            d = c;
+            c = b;
+            b = a;
+            a = t1.wrapping_add(t2);
+        }
+
+        self.state[0] = self.state[0].wrapping_add(a);
+        self.state[1] = self.state[1].wrapping_add(b);
+        self.state[2] = self.state[2].wrapping_add(c);
+        self.state[3] = self.state[3].wrapping_add(d);
+        self.state[4] = self.state[4].wrapping_add(e);
+        self.state[5] = self.state[5].wrapping_add(f);
+        self.state[6] = self.state[6].wrapping_add(g);
+        self.state[7] = self.state[7].wrapping_add(h);
+    }
+}
+
+impl Default for SgxSha256Context {
+    fn default() -> SgxSha256Context {
+        SgxSha256Context::new()
+    }
+}
+
+///
+/// A stack-resident streaming HMAC-SHA256 context.
+///
+/// The key is absorbed at construction; [`update`] and [`finish`] are
+/// guaranteed allocation-free. The keyed pads are zeroed when the
+/// context is dropped.
+///
+/// [`update`]: SgxHmac256Context::update
+/// [`finish`]: SgxHmac256Context::finish
+///
+#[derive(Clone)]
+pub struct SgxHmac256Context {
+    inner: SgxSha256Context,
+    opad: [u8; SHA256_BLOCK_SIZE],
+}
+
+impl SgxHmac256Context {
+    ///
+    /// Constructs an HMAC-SHA256 context keyed with `key`. Keys longer
+    /// than one block are hashed first, per RFC 2104.
+    ///
+    pub fn new(key: &[u8]) -> SgxHmac256Context {
+        let mut key_block = [0_u8; SHA256_BLOCK_SIZE];
+        if key.len() > SHA256_BLOCK_SIZE {
+            let mut ctx = SgxSha256Context::new();
+            ctx.update(key);
+            let digest = ctx.finish();
+            key_block[..digest.len()].copy_from_slice(&digest);
+        } else {
+            key_block[..key.len()].copy_from_slice(key);
+        }
+
+        let mut ipad = [0x36_u8; SHA256_BLOCK_SIZE];
+        let mut opad = [0x5c_u8; SHA256_BLOCK_SIZE];
+        for i in 0..SHA256_BLOCK_SIZE {
+            ipad[i] ^= key_block[i];
+            opad[i] ^= key_block[i];
+            key_block[i] = 0;
+        }
+
+        let mut inner = SgxSha256Context::new();
+        inner.update(&ipad);
+        for byte in ipad.iter_mut() {
+            *byte = 0;
+        }
+
+        SgxHmac256Context { inner, opad }
+    }
+
+    ///
+    /// Absorbs `data` into the MAC. Never allocates.
+    ///
+    pub fn update(&mut self, data: &[u8]) {
+        self.inner.update(data);
+    }
+
+    ///
+    /// Consumes the context and returns the 256-bit tag.
+    ///
+    pub fn finish(self) -> sgx_hmac_256bit_tag_t {
+        let inner_digest = self.inner.finish();
+        let mut outer = SgxSha256Context::new();
+        outer.update(&self.opad);
+        outer.update(&inner_digest);
+        outer.finish()
+    }
+}
+
+impl Drop for SgxHmac256Context {
+    fn drop(&mut self) {
+        for byte in self.opad.iter_mut() {
+            *byte = 0;
+        }
+    }
+}
@@ -37,4 +37,7 @@ extern crate sgx_types;
 mod dh;
 pub use self::dh::*;
 
+mod session;
+pub use self::session::*;
+
 mod ecp;
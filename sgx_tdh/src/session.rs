@@ -0,0 +1,321 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License..
+
+//! # Concurrent DH Session Table
+//!
+//! SgxDhResponder and SgxDhInitiator leave session bookkeeping to the caller,
+//! which is fine for a handful of peers and error prone for thousands. This
+//! module keeps responder sessions in a sharded hash table: lookups take one
+//! short spinlock on the owning shard, the EC computations of the handshake
+//! run outside any lock, and idle sessions can be expired in bulk.
+//!
+//! The enclave has no trusted wall clock, so the table never reads time
+//! itself: callers stamp operations with their own monotonic tick value and
+//! expire against a cutoff in the same unit.
+
+use crate::dh::{SgxDhMsg1, SgxDhMsg2, SgxDhMsg3, SgxDhResponder};
+use alloc::vec::Vec;
+use core::cell::UnsafeCell;
+use sgx_types::*;
+
+const DEFAULT_SHARDS: usize = 16;
+const DEFAULT_BUCKETS_PER_SHARD: usize = 64;
+
+/// The state a peer's session is in.
+pub enum SgxDhSessionStatus {
+    /// MSG1 has been generated; waiting for the peer's MSG2.
+    Pending(SgxDhResponder),
+    /// The handshake completed: the AEK and the identity the peer proved.
+    Active(sgx_key_128bit_t, sgx_dh_session_enclave_identity_t),
+}
+
+struct SessionEntry {
+    peer_id: u64,
+    last_used: u64,
+    status: SgxDhSessionStatus,
+}
+
+struct Shard {
+    lock: UnsafeCell<sgx_spinlock_t>,
+    buckets: UnsafeCell<Vec<Vec<SessionEntry>>>,
+}
+
+///
+/// A concurrent table of DH responder sessions keyed by a caller-chosen
+/// 64-bit peer id.
+///
+/// # Description
+///
+/// The table is sharded: a peer id hashes to one shard and one bucket inside
+/// it, so concurrent handshakes with different peers contend only when they
+/// collide on a shard. Shard locks are spinlocks held just long enough to
+/// move an entry in or out; the expensive EC operations of gen_msg1 and
+/// proc_msg2 run on unshared state.
+///
+pub struct SgxDhSessionTable {
+    shards: Vec<Shard>,
+    shard_mask: usize,
+    bucket_mask: usize,
+}
+
+unsafe impl Sync for SgxDhSessionTable {}
+unsafe impl Send for SgxDhSessionTable {}
+
+#[inline]
+fn hash_peer(peer_id: u64) -> u64 {
+    peer_id.wrapping_mul(0x9E37_79B9_7F4A_7C15)
+}
+
+impl SgxDhSessionTable {
+    ///
+    /// Create a table with default sharding, sized for a few thousand
+    /// concurrent sessions.
+    ///
+    pub fn new() -> SgxDhSessionTable {
+        Self::with_capacity(DEFAULT_SHARDS, DEFAULT_BUCKETS_PER_SHARD)
+    }
+
+    ///
+    /// Create a table with `shards` lock shards of `buckets_per_shard`
+    /// buckets each; both are rounded up to powers of two. Size buckets so
+    /// that shards * buckets_per_shard is in the order of the expected
+    /// session count; buckets chain, so this affects speed, not capacity.
+    ///
+    pub fn with_capacity(shards: usize, buckets_per_shard: usize) -> SgxDhSessionTable {
+        let shards = shards.max(1).next_power_of_two();
+        let buckets = buckets_per_shard.max(1).next_power_of_two();
+        let mut v = Vec::with_capacity(shards);
+        for _ in 0..shards {
+            let mut b = Vec::with_capacity(buckets);
+            for _ in 0..buckets {
+                b.push(Vec::new());
+            }
+            v.push(Shard {
+                lock: UnsafeCell::new(0),
+                buckets: UnsafeCell::new(b),
+            });
+        }
+        SgxDhSessionTable {
+            shards: v,
+            shard_mask: shards - 1,
+            bucket_mask: buckets - 1,
+        }
+    }
+
+    #[inline]
+    fn with_bucket<R, F: FnOnce(&mut Vec<SessionEntry>) -> R>(&self, peer_id: u64, f: F) -> R {
+        let h = hash_peer(peer_id);
+        let shard = &self.shards[(h >> 48) as usize & self.shard_mask];
+        let bucket = h as usize & self.bucket_mask;
+        unsafe {
+            sgx_spin_lock(shard.lock.get());
+            let r = f(&mut (*shard.buckets.get())[bucket]);
+            sgx_spin_unlock(shard.lock.get());
+            r
+        }
+    }
+
+    ///
+    /// Start a responder session for `peer_id`, generating MSG1 into `msg1`.
+    /// An existing session for the same peer is replaced. `now` is the
+    /// caller's monotonic timestamp, stored for expiry.
+    ///
+    /// # Errors
+    ///
+    /// Errors of SgxDhResponder::gen_msg1; the table is left without a
+    /// session for this peer on failure.
+    ///
+    pub fn gen_msg1(&self, peer_id: u64, now: u64, msg1: &mut SgxDhMsg1) -> SgxError {
+        let mut responder = SgxDhResponder::init_session();
+        responder.gen_msg1(msg1)?;
+        self.with_bucket(peer_id, |bucket| {
+            bucket.retain(|e| e.peer_id != peer_id);
+            bucket.push(SessionEntry {
+                peer_id,
+                last_used: now,
+                status: SgxDhSessionStatus::Pending(responder),
+            });
+        });
+        Ok(())
+    }
+
+    ///
+    /// Start responder sessions for a batch of peers in one call, writing
+    /// one MSG1 per peer. `peers` and `msg1s` must have equal length.
+    ///
+    /// # Errors
+    ///
+    /// **SGX_ERROR_INVALID_PARAMETER**
+    ///
+    /// The slice lengths differ.
+    ///
+    /// Otherwise the first error of gen_msg1 is returned; sessions created
+    /// earlier in the batch remain valid, sessions from the failing entry
+    /// onwards were not created.
+    ///
+    pub fn gen_msg1_batch(&self, peers: &[u64], now: u64, msg1s: &mut [SgxDhMsg1]) -> SgxError {
+        if peers.len() != msg1s.len() {
+            return Err(sgx_status_t::SGX_ERROR_INVALID_PARAMETER);
+        }
+        for (peer_id, msg1) in peers.iter().zip(msg1s.iter_mut()) {
+            self.gen_msg1(*peer_id, now, msg1)?;
+        }
+        Ok(())
+    }
+
+    ///
+    /// Process the peer's MSG2, generate MSG3 and activate the session.
+    /// Returns the AEK and the identity the peer proved.
+    ///
+    /// # Errors
+    ///
+    /// **SGX_ERROR_INVALID_STATE**
+    ///
+    /// No pending session exists for this peer (never started, already
+    /// activated, expired, or taken by a concurrent call).
+    ///
+    /// Otherwise the errors of SgxDhResponder::proc_msg2; the session is
+    /// removed on failure.
+    ///
+    pub fn proc_msg2(
+        &self,
+        peer_id: u64,
+        msg2: &SgxDhMsg2,
+        now: u64,
+        msg3: &mut SgxDhMsg3,
+    ) -> SgxResult<(sgx_key_128bit_t, sgx_dh_session_enclave_identity_t)> {
+        // Take the pending responder out of the table so the EC math runs
+        // without holding the shard lock; a concurrent call for the same
+        // peer then simply finds no session.
+        let taken = self.with_bucket(peer_id, |bucket| {
+            match bucket.iter().position(|e| e.peer_id == peer_id) {
+                Some(index) => match bucket[index].status {
+                    SgxDhSessionStatus::Pending(_) => Some(bucket.swap_remove(index)),
+                    SgxDhSessionStatus::Active(..) => None,
+                },
+                None => None,
+            }
+        });
+
+        let mut responder = match taken {
+            Some(entry) => match entry.status {
+                SgxDhSessionStatus::Pending(responder) => responder,
+                SgxDhSessionStatus::Active(..) => {
+                    return Err(sgx_status_t::SGX_ERROR_INVALID_STATE)
+                }
+            },
+            None => return Err(sgx_status_t::SGX_ERROR_INVALID_STATE),
+        };
+
+        let mut aek = sgx_key_128bit_t::default();
+        let mut identity = sgx_dh_session_enclave_identity_t::default();
+        responder.proc_msg2(msg2, msg3, &mut aek, &mut identity)?;
+
+        self.with_bucket(peer_id, |bucket| {
+            bucket.retain(|e| e.peer_id != peer_id);
+            bucket.push(SessionEntry {
+                peer_id,
+                last_used: now,
+                status: SgxDhSessionStatus::Active(aek, identity),
+            });
+        });
+        Ok((aek, identity))
+    }
+
+    ///
+    /// Look up the AEK and peer identity of an active session, refreshing
+    /// its timestamp. Returns None for unknown peers and sessions still in
+    /// the handshake.
+    ///
+    pub fn get_session_key(
+        &self,
+        peer_id: u64,
+        now: u64,
+    ) -> Option<(sgx_key_128bit_t, sgx_dh_session_enclave_identity_t)> {
+        self.with_bucket(peer_id, |bucket| {
+            for entry in bucket.iter_mut() {
+                if entry.peer_id == peer_id {
+                    if let SgxDhSessionStatus::Active(aek, identity) = entry.status {
+                        entry.last_used = now;
+                        return Some((aek, identity));
+                    }
+                    return None;
+                }
+            }
+            None
+        })
+    }
+
+    ///
+    /// Remove the session for `peer_id`. Returns whether one existed.
+    ///
+    pub fn remove(&self, peer_id: u64) -> bool {
+        self.with_bucket(peer_id, |bucket| {
+            let before = bucket.len();
+            bucket.retain(|e| e.peer_id != peer_id);
+            bucket.len() != before
+        })
+    }
+
+    ///
+    /// Remove every session whose timestamp is older than `cutoff`, pending
+    /// and active alike, and return how many were dropped. Shards are swept
+    /// one at a time, so concurrent handshakes keep making progress.
+    ///
+    pub fn expire_older_than(&self, cutoff: u64) -> usize {
+        let mut dropped = 0;
+        for shard in self.shards.iter() {
+            unsafe {
+                sgx_spin_lock(shard.lock.get());
+                for bucket in (*shard.buckets.get()).iter_mut() {
+                    let before = bucket.len();
+                    bucket.retain(|e| e.last_used >= cutoff);
+                    dropped += before - bucket.len();
+                }
+                sgx_spin_unlock(shard.lock.get());
+            }
+        }
+        dropped
+    }
+
+    ///
+    /// Number of sessions currently in the table, in any state.
+    ///
+    pub fn len(&self) -> usize {
+        let mut count = 0;
+        for shard in self.shards.iter() {
+            unsafe {
+                sgx_spin_lock(shard.lock.get());
+                for bucket in (*shard.buckets.get()).iter() {
+                    count += bucket.len();
+                }
+                sgx_spin_unlock(shard.lock.get());
+            }
+        }
+        count
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.len() == 0
+    }
+}
+
+impl Default for SgxDhSessionTable {
+    fn default() -> SgxDhSessionTable {
+        SgxDhSessionTable::new()
+    }
+}
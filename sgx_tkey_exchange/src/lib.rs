@@ -24,7 +24,9 @@
 #![no_std]
 #![cfg_attr(target_env = "sgx", feature(rustc_private))]
 
+extern crate sgx_tcrypto;
 extern crate sgx_types;
+use sgx_tcrypto::rsgx_rijndael128_cmac_slice;
 use sgx_types::*;
 
 ///
@@ -253,3 +255,123 @@ pub fn rsgx_ra_close(context: sgx_ra_context_t) -> SgxError {
         _ => Err(ret),
     }
 }
+
+// Domain separation constants for the ratchet KDF. The init label keeps
+// the chain key distinct from the session key it is derived from; the
+// step labels keep output keys and successor chain keys independent.
+const RATCHET_LABEL_INIT: &[u8; 16] = b"SGX-RA-RATCHET-0";
+const RATCHET_STEP_KEY: u8 = 0x01;
+const RATCHET_STEP_CHAIN: u8 = 0x02;
+
+///
+/// SgxRaRatchet derives a sequence of forward-secure session keys from an
+/// established remote attestation and key exchange session, without any
+/// further network round trips.
+///
+/// # Description
+///
+/// A session established through sgx_ra_proc_msg2 yields fixed keys; rotating
+/// them means running the whole attestation protocol again. A ratchet is
+/// seeded once from a negotiated key of the session and then advances a local
+/// key chain with AES-CMAC: every call to advance returns the next session
+/// key and destroys the chain state that produced it, so a later compromise
+/// of the enclave cannot recover keys of earlier epochs.
+///
+/// Both endpoints of the channel run the same derivation from the same
+/// negotiated key (the service provider computes it from its copy of the key),
+/// so advancing in lockstep keeps the peers in agreement with zero messages
+/// exchanged. The epoch counter identifies the current position in the chain
+/// and can be sent in the clear to resynchronize.
+///
+pub struct SgxRaRatchet {
+    chain_key: sgx_cmac_128bit_key_t,
+    epoch: u32,
+}
+
+impl SgxRaRatchet {
+    ///
+    /// Seed a ratchet from a negotiated key of an established session.
+    ///
+    /// # Parameters
+    ///
+    /// **context**
+    ///
+    /// Context returned by rsgx_ra_init, after sgx_ra_proc_msg2 succeeded.
+    ///
+    /// **keytype**
+    ///
+    /// The session key to seed from, normally SGX_RA_KEY_SK or SGX_RA_KEY_MK.
+    ///
+    /// # Errors
+    ///
+    /// **SGX_ERROR_INVALID_PARAMETER**
+    ///
+    /// Indicates an error that the input parameters are invalid.
+    ///
+    /// **SGX_ERROR_INVALID_STATE**
+    ///
+    /// Indicates no session has been established for this context yet.
+    ///
+    pub fn new(context: sgx_ra_context_t, keytype: sgx_ra_key_type_t) -> SgxResult<SgxRaRatchet> {
+        let mut base = rsgx_ra_get_keys(context, keytype)?;
+        let result = rsgx_rijndael128_cmac_slice(&base, &RATCHET_LABEL_INIT[..]);
+        clear_key(&mut base);
+        let chain_key = result?;
+        Ok(SgxRaRatchet {
+            chain_key,
+            epoch: 0,
+        })
+    }
+
+    ///
+    /// The epoch of the key the next call to advance will return.
+    ///
+    pub fn epoch(&self) -> u32 {
+        self.epoch
+    }
+
+    ///
+    /// Derive the session key of the current epoch and step the chain.
+    ///
+    /// # Description
+    ///
+    /// Returns CMAC(chain, 0x01 || epoch) and replaces the chain key with
+    /// CMAC(chain, 0x02 || epoch) before returning, so the state that can
+    /// reproduce the returned key no longer exists inside the enclave. The
+    /// caller owns the returned key and should erase it after use.
+    ///
+    /// # Errors
+    ///
+    /// **SGX_ERROR_UNEXPECTED**
+    ///
+    /// Indicates that the underlying CMAC operation failed; the ratchet is
+    /// left unstepped.
+    ///
+    pub fn advance(&mut self) -> SgxResult<sgx_ra_key_128_t> {
+        let mut msg = [0_u8; 5];
+        msg[1..5].copy_from_slice(&self.epoch.to_le_bytes());
+
+        msg[0] = RATCHET_STEP_KEY;
+        let out_key = rsgx_rijndael128_cmac_slice(&self.chain_key, &msg[..])?;
+
+        msg[0] = RATCHET_STEP_CHAIN;
+        let next_chain = rsgx_rijndael128_cmac_slice(&self.chain_key, &msg[..])?;
+
+        self.chain_key = next_chain;
+        self.epoch = self.epoch.wrapping_add(1);
+        Ok(out_key)
+    }
+}
+
+impl Drop for SgxRaRatchet {
+    fn drop(&mut self) {
+        clear_key(&mut self.chain_key);
+    }
+}
+
+#[inline]
+fn clear_key(key: &mut sgx_cmac_128bit_key_t) {
+    for byte in key.iter_mut() {
+        unsafe { core::ptr::write_volatile(byte, 0) };
+    }
+}
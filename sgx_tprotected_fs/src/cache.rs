@@ -0,0 +1,285 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License..
+
+//! A configurable node cache layered over [`SgxFileStream`].
+//!
+//! The underlying protected FS library keeps only a small fixed cache of
+//! decrypted nodes, so random reads over a large protected file re-decrypt
+//! a whole MHT node chain on almost every access. [`CachedSgxFileStream`]
+//! keeps up to a caller-chosen number of decrypted 4KB nodes in enclave
+//! memory, so repeated reads of a hot set cost a memcpy instead of a node
+//! chain decryption.
+//!
+//! Two replacement policies are selectable at open time: plain LRU, and
+//! 2Q, which is scan resistant - a single sequential sweep over the file
+//! passes through the probationary FIFO without evicting the hot set in
+//! the main queue.
+
+use crate::fs::{SeekFrom, SgxFileStream};
+use alloc::boxed::Box;
+use alloc::collections::BTreeMap;
+use alloc::collections::VecDeque;
+use alloc::vec;
+use core::cmp;
+use sgx_trts::c_str::CStr;
+use sgx_types::{sgx_key_128bit_t, SysError, SysResult};
+
+/// Size of one cached node. Matches the protected FS data node payload
+/// granularity closely enough that one cached node covers one decrypted
+/// chain walk.
+pub const NODE_SIZE: usize = 4096;
+
+/// Replacement policy for [`CachedSgxFileStream`].
+#[derive(Clone, Copy, PartialEq, Eq, Debug)]
+pub enum CachePolicy {
+    /// Evict the least recently used node.
+    Lru,
+    /// 2Q: new nodes enter a probationary FIFO and are only promoted to
+    /// the main LRU queue when touched again after eviction, so a scan
+    /// cannot flush the hot set.
+    TwoQ,
+}
+
+enum Residency {
+    /// In the main (LRU) queue.
+    Main,
+    /// In the 2Q probationary FIFO.
+    Probation,
+}
+
+struct Node {
+    data: Box<[u8]>,
+    /// Valid prefix of `data`; shorter than NODE_SIZE only at EOF.
+    len: usize,
+    residency: Residency,
+    /// Matches the newest queue entry for this node; older queue entries
+    /// are skipped lazily during eviction.
+    stamp: u64,
+}
+
+/// A protected file stream with a private cache of decrypted nodes.
+///
+/// Reads and writes are positional; the cursor of the inner stream is
+/// repositioned as needed. Writes go straight to the protected file and
+/// invalidate overlapping cached nodes, so the cache never holds dirty
+/// data and flush semantics are unchanged.
+pub struct CachedSgxFileStream {
+    stream: SgxFileStream,
+    policy: CachePolicy,
+    capacity: usize,
+    nodes: BTreeMap<u64, Node>,
+    /// Recency queue (LRU and the 2Q main queue), lazily pruned.
+    main_queue: VecDeque<(u64, u64)>,
+    /// 2Q probationary FIFO of node numbers.
+    probation_queue: VecDeque<u64>,
+    /// 2Q ghost FIFO: node numbers recently evicted from probation.
+    ghost_queue: VecDeque<u64>,
+    next_stamp: u64,
+}
+
+impl CachedSgxFileStream {
+    /// Creates or opens a protected file as [`SgxFileStream::open`] does,
+    /// with a private node cache holding up to `capacity` decrypted nodes
+    /// replaced by `policy`.
+    pub fn open(
+        filename: &CStr,
+        mode: &CStr,
+        key: &sgx_key_128bit_t,
+        capacity: usize,
+        policy: CachePolicy,
+    ) -> SysResult<CachedSgxFileStream> {
+        SgxFileStream::open(filename, mode, key)
+            .map(|stream| Self::with_stream(stream, capacity, policy))
+    }
+
+    /// Creates or opens a protected file as [`SgxFileStream::open_auto_key`]
+    /// does, with a private node cache.
+    pub fn open_auto_key(
+        filename: &CStr,
+        mode: &CStr,
+        capacity: usize,
+        policy: CachePolicy,
+    ) -> SysResult<CachedSgxFileStream> {
+        SgxFileStream::open_auto_key(filename, mode)
+            .map(|stream| Self::with_stream(stream, capacity, policy))
+    }
+
+    fn with_stream(stream: SgxFileStream, capacity: usize, policy: CachePolicy) -> CachedSgxFileStream {
+        CachedSgxFileStream {
+            stream,
+            policy,
+            capacity: cmp::max(capacity, 1),
+            nodes: BTreeMap::new(),
+            main_queue: VecDeque::new(),
+            probation_queue: VecDeque::new(),
+            ghost_queue: VecDeque::new(),
+            next_stamp: 0,
+        }
+    }
+
+    /// Reads up to `buf.len()` bytes starting at absolute `offset`,
+    /// serving whole nodes from the cache when possible.
+    pub fn read_at(&mut self, offset: u64, buf: &mut [u8]) -> SysResult<usize> {
+        let mut done = 0_usize;
+
+        while done < buf.len() {
+            let pos = offset + done as u64;
+            let number = pos / NODE_SIZE as u64;
+            let in_node = (pos % NODE_SIZE as u64) as usize;
+
+            self.ensure_cached(number)?;
+            let node = self.nodes.get(&number).unwrap();
+            if in_node >= node.len {
+                break; // EOF inside this node
+            }
+            let take = cmp::min(buf.len() - done, node.len - in_node);
+            buf[done..done + take].copy_from_slice(&node.data[in_node..in_node + take]);
+            done += take;
+            if node.len < NODE_SIZE {
+                break; // short node: EOF
+            }
+        }
+        Ok(done)
+    }
+
+    /// Writes `buf` at absolute `offset`, bypassing and invalidating the
+    /// cache for the touched nodes.
+    pub fn write_at(&mut self, offset: u64, buf: &[u8]) -> SysResult<usize> {
+        self.stream.seek(offset as i64, SeekFrom::Start)?;
+        let written = self.stream.write(buf)?;
+
+        let first = offset / NODE_SIZE as u64;
+        let last = (offset + written as u64) / NODE_SIZE as u64;
+        for number in first..=last {
+            self.nodes.remove(&number);
+        }
+        Ok(written)
+    }
+
+    /// Forces a flush of the underlying protected file.
+    pub fn flush(&self) -> SysError {
+        self.stream.flush()
+    }
+
+    /// Drops every cached node and scrubs the underlying library cache.
+    pub fn clear_cache(&mut self) -> SysError {
+        self.nodes.clear();
+        self.main_queue.clear();
+        self.probation_queue.clear();
+        self.ghost_queue.clear();
+        self.stream.clear_cache()
+    }
+
+    fn ensure_cached(&mut self, number: u64) -> SysError {
+        if self.nodes.contains_key(&number) {
+            self.touch(number);
+            return Ok(());
+        }
+
+        self.stream.seek((number * NODE_SIZE as u64) as i64, SeekFrom::Start)?;
+        let mut data = vec![0_u8; NODE_SIZE].into_boxed_slice();
+        let len = self.stream.read(&mut data)?;
+
+        let residency = match self.policy {
+            CachePolicy::Lru => Residency::Main,
+            CachePolicy::TwoQ => {
+                // A ghost hit means the node was wanted again shortly
+                // after probation: promote straight to the main queue.
+                if let Some(index) = self.ghost_queue.iter().position(|&n| n == number) {
+                    self.ghost_queue.remove(index);
+                    Residency::Main
+                } else {
+                    Residency::Probation
+                }
+            }
+        };
+
+        let stamp = self.bump_stamp();
+        match residency {
+            Residency::Main => self.main_queue.push_back((number, stamp)),
+            Residency::Probation => self.probation_queue.push_back(number),
+        }
+        self.nodes.insert(number, Node { data, len, residency, stamp });
+        self.evict();
+        Ok(())
+    }
+
+    fn touch(&mut self, number: u64) {
+        let stamp = self.bump_stamp();
+        let node = self.nodes.get_mut(&number).unwrap();
+        match node.residency {
+            Residency::Main => {
+                node.stamp = stamp;
+                self.main_queue.push_back((number, stamp));
+            }
+            // A second touch while still in probation promotes the node;
+            // under pure FIFO a node read twice during one scan would be
+            // evicted with the scan.
+            Residency::Probation => {
+                node.residency = Residency::Main;
+                node.stamp = stamp;
+                if let Some(index) = self.probation_queue.iter().position(|&n| n == number) {
+                    self.probation_queue.remove(index);
+                }
+                self.main_queue.push_back((number, stamp));
+            }
+        }
+    }
+
+    fn bump_stamp(&mut self) -> u64 {
+        self.next_stamp += 1;
+        self.next_stamp
+    }
+
+    fn evict(&mut self) {
+        // 2Q sizing from the paper: probation holds roughly a quarter of
+        // the capacity, ghosts remember half a capacity of node numbers.
+        let probation_cap = cmp::max(self.capacity / 4, 1);
+        let ghost_cap = cmp::max(self.capacity / 2, 1);
+
+        while self.nodes.len() > self.capacity {
+            let evicted = if self.policy == CachePolicy::TwoQ
+                && self.probation_queue.len() > probation_cap {
+                let number = self.probation_queue.pop_front().unwrap();
+                self.ghost_queue.push_back(number);
+                if self.ghost_queue.len() > ghost_cap {
+                    self.ghost_queue.pop_front();
+                }
+                Some(number)
+            } else {
+                // Pop the main queue, skipping entries staled by later
+                // touches of the same node.
+                loop {
+                    match self.main_queue.pop_front() {
+                        Some((number, stamp)) => {
+                            match self.nodes.get(&number) {
+                                Some(node) if node.stamp == stamp => break Some(number),
+                                _ => continue,
+                            }
+                        }
+                        None => break self.probation_queue.pop_front(),
+                    }
+                }
+            };
+
+            match evicted {
+                Some(number) => { self.nodes.remove(&number); }
+                None => break,
+            }
+        }
+    }
+}
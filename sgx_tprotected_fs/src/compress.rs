@@ -0,0 +1,444 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License..
+
+//! Transparent compression over [`SgxFileStream`].
+//!
+//! Protected-file nodes are encrypted as-is, so highly redundant
+//! payloads - JSON-ish sealed records compress around 5:1 - pay full
+//! price in node crypto, `u_write_ocall` volume and disk. The node
+//! layer itself lives in the prebuilt protected FS library and cannot
+//! learn compression here, so [`CompressedSgxFileStream`] layers it
+//! just above: plaintext is compressed in enclave memory with an LZ4
+//! block codec BEFORE it reaches the stream, i.e. before encryption,
+//! and decompressed after decryption on the way out. The library then
+//! encrypts and ships a fifth of the bytes.
+//!
+//! The on-disk layout (inside the protected file, so itself encrypted
+//! and integrity-protected) is versioned: a fixed header carries a
+//! magic, a format version and the method byte, followed by framed
+//! blocks of `[raw_len][stored_len][payload]`. A block whose
+//! compressed form would grow is stored raw, so worst-case overhead
+//! is eight bytes per block. Frames make the stream append-and-scan:
+//! writers append, readers scan forward; there is no random seek,
+//! which matches the sealed-log shape this exists for.
+
+use crate::fs::SgxFileStream;
+use alloc::vec;
+use alloc::vec::Vec;
+use core::cmp;
+use sgx_trts::c_str::CStr;
+use sgx_trts::libc;
+use sgx_types::{sgx_key_128bit_t, SysError, SysResult};
+
+/// First eight file bytes: magic then version/method/reserved.
+pub const SGX_COMPRESS_MAGIC: u32 = 0x5347_585a; // "SGXZ"
+/// Bumped on any incompatible layout change; readers reject unknown
+/// versions instead of guessing.
+pub const SGX_COMPRESS_VERSION: u8 = 1;
+const METHOD_LZ4: u8 = 1;
+const FILE_HEADER_SIZE: usize = 8;
+const FRAME_HEADER_SIZE: usize = 8;
+
+/// Default compression block: sixteen 4KB nodes per frame, a good
+/// balance between match window and flush granularity.
+pub const SGX_COMPRESS_BLOCK_SIZE: usize = 64 * 1024;
+
+// ---------------------------------------------------------------------
+// LZ4 block codec
+//
+// Standard LZ4 block format (token, extended lengths, 16-bit match
+// offsets), greedy single-probe matcher. Self-contained because the
+// SDK vendors no compression crate and the no_std targets could not
+// use one anyway.
+// ---------------------------------------------------------------------
+
+const MIN_MATCH: usize = 4;
+/// Matching stops this close to the end; the tail is always literal,
+/// as the LZ4 block format requires.
+const MF_LIMIT: usize = 12;
+const HASH_BITS: u32 = 13;
+const MAX_OFFSET: usize = 0xffff;
+
+#[inline]
+fn hash(seq: u32) -> usize {
+    (seq.wrapping_mul(2_654_435_761) >> (32 - HASH_BITS)) as usize
+}
+
+#[inline]
+fn read_u32(src: &[u8], i: usize) -> u32 {
+    u32::from_le_bytes([src[i], src[i + 1], src[i + 2], src[i + 3]])
+}
+
+fn push_length(dst: &mut Vec<u8>, mut len: usize) {
+    while len >= 255 {
+        dst.push(255);
+        len -= 255;
+    }
+    dst.push(len as u8);
+}
+
+fn push_sequence(dst: &mut Vec<u8>, literals: &[u8], offset: usize, match_len: usize) {
+    let lit_nibble = cmp::min(literals.len(), 15) as u8;
+    let match_nibble = cmp::min(match_len - MIN_MATCH, 15) as u8;
+    dst.push((lit_nibble << 4) | match_nibble);
+    if literals.len() >= 15 {
+        push_length(dst, literals.len() - 15);
+    }
+    dst.extend_from_slice(literals);
+    dst.extend_from_slice(&(offset as u16).to_le_bytes());
+    if match_len - MIN_MATCH >= 15 {
+        push_length(dst, match_len - MIN_MATCH - 15);
+    }
+}
+
+/// Compresses `src` into `dst` (cleared first) in LZ4 block format.
+fn lz4_compress(src: &[u8], dst: &mut Vec<u8>) {
+    dst.clear();
+    // u32 slots keep the table at 32KB of stack; block sizes are far
+    // below 4GB
+    let mut table = [u32::MAX; 1 << HASH_BITS];
+    let mut anchor = 0;
+    let mut i = 0;
+
+    while i + MF_LIMIT <= src.len() {
+        let seq = read_u32(src, i);
+        let h = hash(seq);
+        let cand = table[h] as usize;
+        table[h] = i as u32;
+
+        if cand != u32::MAX as usize && i - cand <= MAX_OFFSET && read_u32(src, cand) == seq {
+            // extend; the last five bytes must stay literal
+            let limit = src.len() - 5;
+            let mut m = MIN_MATCH;
+            while i + m < limit && src[cand + m] == src[i + m] {
+                m += 1;
+            }
+            push_sequence(dst, &src[anchor..i], i - cand, m);
+            i += m;
+            anchor = i;
+        } else {
+            i += 1;
+        }
+    }
+
+    // final literal-only sequence
+    let literals = &src[anchor..];
+    let lit_nibble = cmp::min(literals.len(), 15) as u8;
+    dst.push(lit_nibble << 4);
+    if literals.len() >= 15 {
+        push_length(dst, literals.len() - 15);
+    }
+    dst.extend_from_slice(literals);
+}
+
+/// Decompresses an LZ4 block into `dst` (cleared first), failing on
+/// any malformed input or if the output is not exactly `raw_len`.
+fn lz4_decompress(src: &[u8], raw_len: usize, dst: &mut Vec<u8>) -> Result<(), ()> {
+    dst.clear();
+    dst.reserve(raw_len);
+    let mut i = 0;
+
+    loop {
+        if i >= src.len() {
+            return Err(());
+        }
+        let token = src[i];
+        i += 1;
+
+        let mut lit_len = (token >> 4) as usize;
+        if lit_len == 15 {
+            loop {
+                let b = *src.get(i).ok_or(())?;
+                i += 1;
+                lit_len += b as usize;
+                if b != 255 {
+                    break;
+                }
+            }
+        }
+        if i + lit_len > src.len() || dst.len() + lit_len > raw_len {
+            return Err(());
+        }
+        dst.extend_from_slice(&src[i..i + lit_len]);
+        i += lit_len;
+
+        // a block ends after the literals of its last sequence
+        if i == src.len() {
+            break;
+        }
+
+        if i + 2 > src.len() {
+            return Err(());
+        }
+        let offset = u16::from_le_bytes([src[i], src[i + 1]]) as usize;
+        i += 2;
+        if offset == 0 || offset > dst.len() {
+            return Err(());
+        }
+
+        let mut match_len = (token & 0x0f) as usize + MIN_MATCH;
+        if match_len == 15 + MIN_MATCH {
+            loop {
+                let b = *src.get(i).ok_or(())?;
+                i += 1;
+                match_len += b as usize;
+                if b != 255 {
+                    break;
+                }
+            }
+        }
+        if dst.len() + match_len > raw_len {
+            return Err(());
+        }
+        // byte-wise: matches may overlap their own output
+        let mut from = dst.len() - offset;
+        for _ in 0..match_len {
+            let b = dst[from];
+            dst.push(b);
+            from += 1;
+        }
+    }
+
+    if dst.len() == raw_len {
+        Ok(())
+    } else {
+        Err(())
+    }
+}
+
+// ---------------------------------------------------------------------
+// Framed stream
+// ---------------------------------------------------------------------
+
+/// A protected file stream that compresses plaintext before it is
+/// encrypted and written, and decompresses after decryption on read.
+///
+/// A stream is either a writer (created by [`create`]) or a reader
+/// (created by [`open`]); writers append frames, readers scan them
+/// forward. Buffered plaintext lives in enclave memory until a frame
+/// flush, so call [`flush`] at durability points as with any buffered
+/// writer.
+///
+/// [`create`]: CompressedSgxFileStream::create
+/// [`open`]: CompressedSgxFileStream::open
+/// [`flush`]: CompressedSgxFileStream::flush
+pub struct CompressedSgxFileStream {
+    stream: SgxFileStream,
+    writable: bool,
+    block_size: usize,
+    /// Pending plaintext (writer) or current decoded frame (reader).
+    buf: Vec<u8>,
+    /// Read cursor into `buf`; writers do not use it.
+    pos: usize,
+    /// Compressed staging for one frame.
+    scratch: Vec<u8>,
+    raw_bytes: u64,
+    stored_bytes: u64,
+}
+
+impl CompressedSgxFileStream {
+    /// Creates (truncating) a compressed protected file for writing.
+    ///
+    /// `block_size` is the plaintext bytes per frame; zero picks
+    /// [`SGX_COMPRESS_BLOCK_SIZE`]. Larger blocks compress better and
+    /// flush coarser.
+    pub fn create(
+        filename: &CStr,
+        key: &sgx_key_128bit_t,
+        block_size: usize,
+    ) -> SysResult<CompressedSgxFileStream> {
+        let mode = unsafe { CStr::from_bytes_with_nul_unchecked(b"w\0") };
+        let stream = SgxFileStream::open(filename, mode, key)?;
+        let block_size = if block_size == 0 {
+            SGX_COMPRESS_BLOCK_SIZE
+        } else {
+            block_size
+        };
+
+        let mut header = [0_u8; FILE_HEADER_SIZE];
+        header[..4].copy_from_slice(&SGX_COMPRESS_MAGIC.to_le_bytes());
+        header[4] = SGX_COMPRESS_VERSION;
+        header[5] = METHOD_LZ4;
+        write_all(&stream, &header)?;
+
+        Ok(CompressedSgxFileStream {
+            stream,
+            writable: true,
+            block_size,
+            buf: Vec::with_capacity(block_size),
+            pos: 0,
+            scratch: Vec::new(),
+            raw_bytes: 0,
+            stored_bytes: FILE_HEADER_SIZE as u64,
+        })
+    }
+
+    /// Opens a compressed protected file for reading, validating the
+    /// header and rejecting unknown versions or methods with `EPROTO`.
+    pub fn open(filename: &CStr, key: &sgx_key_128bit_t) -> SysResult<CompressedSgxFileStream> {
+        let mode = unsafe { CStr::from_bytes_with_nul_unchecked(b"r\0") };
+        let stream = SgxFileStream::open(filename, mode, key)?;
+
+        let mut header = [0_u8; FILE_HEADER_SIZE];
+        read_exact(&stream, &mut header)?;
+        let magic = u32::from_le_bytes([header[0], header[1], header[2], header[3]]);
+        if magic != SGX_COMPRESS_MAGIC
+            || header[4] != SGX_COMPRESS_VERSION
+            || header[5] != METHOD_LZ4
+        {
+            return Err(libc::EPROTO);
+        }
+
+        Ok(CompressedSgxFileStream {
+            stream,
+            writable: false,
+            block_size: SGX_COMPRESS_BLOCK_SIZE,
+            buf: Vec::new(),
+            pos: 0,
+            scratch: Vec::new(),
+            raw_bytes: 0,
+            stored_bytes: FILE_HEADER_SIZE as u64,
+        })
+    }
+
+    /// Appends plaintext, emitting a frame whenever a full block is
+    /// buffered.
+    pub fn write(&mut self, data: &[u8]) -> SysError {
+        if !self.writable {
+            return Err(libc::EBADF);
+        }
+        let mut rest = data;
+        while !rest.is_empty() {
+            let room = self.block_size - self.buf.len();
+            let n = cmp::min(room, rest.len());
+            self.buf.extend_from_slice(&rest[..n]);
+            rest = &rest[n..];
+            if self.buf.len() == self.block_size {
+                self.emit_frame()?;
+            }
+        }
+        Ok(())
+    }
+
+    /// Reads decompressed plaintext, returning 0 at end of file.
+    pub fn read(&mut self, out: &mut [u8]) -> SysResult<usize> {
+        if self.writable {
+            return Err(libc::EBADF);
+        }
+        let mut copied = 0;
+        while copied < out.len() {
+            if self.pos == self.buf.len() && !self.refill()? {
+                break;
+            }
+            let n = cmp::min(self.buf.len() - self.pos, out.len() - copied);
+            out[copied..copied + n].copy_from_slice(&self.buf[self.pos..self.pos + n]);
+            self.pos += n;
+            copied += n;
+        }
+        Ok(copied)
+    }
+
+    /// Emits any partial frame and flushes the protected file cache.
+    pub fn flush(&mut self) -> SysError {
+        if self.writable && !self.buf.is_empty() {
+            self.emit_frame()?;
+        }
+        self.stream.flush()
+    }
+
+    /// Plaintext bytes accepted and bytes handed to the protected FS
+    /// so far (headers included); the quotient is the achieved ratio.
+    pub fn stats(&self) -> (u64, u64) {
+        (self.raw_bytes, self.stored_bytes)
+    }
+
+    fn emit_frame(&mut self) -> SysError {
+        lz4_compress(&self.buf, &mut self.scratch);
+        let raw_len = self.buf.len() as u32;
+        // store raw when compression would grow the frame
+        let (stored_len, payload): (u32, &[u8]) = if self.scratch.len() < self.buf.len() {
+            (self.scratch.len() as u32, &self.scratch)
+        } else {
+            (raw_len, &self.buf)
+        };
+
+        let mut header = [0_u8; FRAME_HEADER_SIZE];
+        header[..4].copy_from_slice(&raw_len.to_le_bytes());
+        header[4..].copy_from_slice(&stored_len.to_le_bytes());
+        write_all(&self.stream, &header)?;
+        write_all(&self.stream, payload)?;
+
+        self.raw_bytes += raw_len as u64;
+        self.stored_bytes += (FRAME_HEADER_SIZE + payload.len()) as u64;
+        self.buf.clear();
+        Ok(())
+    }
+
+    /// Loads and decodes the next frame; `Ok(false)` means clean EOF.
+    fn refill(&mut self) -> SysResult<bool> {
+        let mut header = [0_u8; FRAME_HEADER_SIZE];
+        let n = self.stream.read(&mut header)?;
+        if n == 0 {
+            return Ok(false);
+        }
+        if n < FRAME_HEADER_SIZE {
+            read_exact(&self.stream, &mut header[n..])?;
+        }
+        let raw_len = u32::from_le_bytes([header[0], header[1], header[2], header[3]]) as usize;
+        let stored_len = u32::from_le_bytes([header[4], header[5], header[6], header[7]]) as usize;
+        if stored_len > raw_len || raw_len == 0 {
+            return Err(libc::EPROTO);
+        }
+
+        self.scratch = vec![0_u8; stored_len];
+        read_exact(&self.stream, &mut self.scratch)?;
+
+        if stored_len == raw_len {
+            self.buf.clear();
+            self.buf.extend_from_slice(&self.scratch);
+        } else {
+            lz4_decompress(&self.scratch, raw_len, &mut self.buf).map_err(|_| libc::EPROTO)?;
+        }
+        self.raw_bytes += raw_len as u64;
+        self.stored_bytes += (FRAME_HEADER_SIZE + stored_len) as u64;
+        self.pos = 0;
+        Ok(true)
+    }
+}
+
+fn write_all(stream: &SgxFileStream, mut buf: &[u8]) -> SysError {
+    while !buf.is_empty() {
+        let n = stream.write(buf)?;
+        if n == 0 {
+            return Err(libc::EIO);
+        }
+        buf = &buf[n..];
+    }
+    Ok(())
+}
+
+fn read_exact(stream: &SgxFileStream, mut buf: &mut [u8]) -> SysError {
+    while !buf.is_empty() {
+        let n = stream.read(buf)?;
+        if n == 0 {
+            return Err(libc::EIO);
+        }
+        let rest = buf;
+        buf = &mut rest[n..];
+    }
+    Ok(())
+}
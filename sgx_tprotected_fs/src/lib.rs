@@ -24,8 +24,17 @@
 #![no_std]
 #![cfg_attr(target_env = "sgx", feature(rustc_private))]
 
+extern crate alloc;
 extern crate sgx_trts;
 extern crate sgx_types;
 
+mod cache;
+mod compress;
 mod fs;
+mod pipeline;
+mod shard;
+pub use self::cache::*;
+pub use self::compress::*;
 pub use self::fs::*;
+pub use self::pipeline::*;
+pub use self::shard::*;
@@ -0,0 +1,234 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License..
+
+//! Sequential streaming over [`SgxFileStream`].
+//!
+//! Plain [`SgxFileStream::read`] and [`SgxFileStream::write`] hand each
+//! transfer to the protected FS library as-is, so node-sized sequential
+//! streaming pays one MHT chain walk and one set of node ocalls per node.
+//! [`SequentialSgxFileStream`] detects a sequential cursor and turns that
+//! pattern into batched transfers:
+//!
+//! * **Read ahead**: once reads are sequential the refill window doubles,
+//!   up to a caller-chosen number of nodes, and each refill pulls the
+//!   whole window through the library in a single read. A random seek
+//!   collapses the window back to one node.
+//! * **Write behind**: sequential writes are coalesced in an enclave
+//!   buffer and issued as one group write when the buffer reaches the
+//!   configured group size, on a non-sequential write, or on flush.
+//!
+//! The underlying library decrypts and encrypts synchronously on the
+//! calling TCS, so the win here is amortization, not overlap: one large
+//! transfer walks the node chain once per window instead of once per
+//! node, and crosses the enclave boundary far fewer times.
+
+use crate::cache::NODE_SIZE;
+use crate::fs::{SeekFrom, SgxFileStream};
+use alloc::vec::Vec;
+use core::cmp;
+use sgx_trts::c_str::CStr;
+use sgx_types::{sgx_key_128bit_t, SysError, SysResult};
+
+/// A protected file stream that batches sequential reads and writes.
+///
+/// Buffered writes live in enclave memory until a group flush, so a
+/// crash before [`flush`] loses at most one group; call [`flush`] at
+/// durability points exactly as with an ordinary buffered writer.
+///
+/// [`flush`]: SequentialSgxFileStream::flush
+pub struct SequentialSgxFileStream {
+    stream: SgxFileStream,
+    /// Logical cursor, which the inner stream cursor may lag.
+    pos: u64,
+    /// Current read-ahead window in nodes; doubles while reads stay
+    /// sequential, resets to one on a seek or random read.
+    window: usize,
+    max_window: usize,
+    /// File offset of `ra_buf[0]`; the buffer is empty when invalid.
+    ra_start: u64,
+    ra_buf: Vec<u8>,
+    ra_consumed: usize,
+    /// File offset of `wb_buf[0]`.
+    wb_start: u64,
+    wb_buf: Vec<u8>,
+    /// Write-behind group size in bytes.
+    group: usize,
+}
+
+impl SequentialSgxFileStream {
+    /// Creates or opens a protected file as [`SgxFileStream::open`] does.
+    ///
+    /// `max_window` caps the read-ahead window and `group` sets the
+    /// write-behind group size, both counted in 4KB nodes; zero means
+    /// one node, which degenerates to unbatched streaming.
+    pub fn open(
+        filename: &CStr,
+        mode: &CStr,
+        key: &sgx_key_128bit_t,
+        max_window: usize,
+        group: usize,
+    ) -> SysResult<SequentialSgxFileStream> {
+        SgxFileStream::open(filename, mode, key)
+            .map(|stream| Self::with_stream(stream, max_window, group))
+    }
+
+    /// Creates or opens a protected file as [`SgxFileStream::open_auto_key`]
+    /// does, with the same batching parameters as [`open`].
+    ///
+    /// [`open`]: SequentialSgxFileStream::open
+    pub fn open_auto_key(
+        filename: &CStr,
+        mode: &CStr,
+        max_window: usize,
+        group: usize,
+    ) -> SysResult<SequentialSgxFileStream> {
+        SgxFileStream::open_auto_key(filename, mode)
+            .map(|stream| Self::with_stream(stream, max_window, group))
+    }
+
+    fn with_stream(stream: SgxFileStream, max_window: usize, group: usize) -> SequentialSgxFileStream {
+        SequentialSgxFileStream {
+            stream,
+            pos: 0,
+            window: 1,
+            max_window: cmp::max(max_window, 1),
+            ra_start: 0,
+            ra_buf: Vec::new(),
+            ra_consumed: 0,
+            wb_start: 0,
+            wb_buf: Vec::new(),
+            group: cmp::max(group, 1) * NODE_SIZE,
+        }
+    }
+
+    /// Reads up to `buf.len()` bytes at the logical cursor, refilling
+    /// the read-ahead buffer in window-sized batches.
+    pub fn read(&mut self, buf: &mut [u8]) -> SysResult<usize> {
+        let mut done = 0_usize;
+
+        while done < buf.len() {
+            if self.ra_consumed >= self.ra_buf.len() {
+                let refilled = self.refill()?;
+                if refilled == 0 {
+                    break; // EOF
+                }
+            }
+            let avail = self.ra_buf.len() - self.ra_consumed;
+            let take = cmp::min(buf.len() - done, avail);
+            buf[done..done + take]
+                .copy_from_slice(&self.ra_buf[self.ra_consumed..self.ra_consumed + take]);
+            self.ra_consumed += take;
+            self.pos += take as u64;
+            done += take;
+        }
+        Ok(done)
+    }
+
+    /// Writes `buf` at the logical cursor, coalescing sequential writes
+    /// until a full group is buffered.
+    pub fn write(&mut self, buf: &[u8]) -> SysResult<usize> {
+        // The readahead snapshot went stale the moment the file changes
+        // under it; sequential streamers do not mix directions, so just
+        // drop it rather than patching it up.
+        if !self.ra_buf.is_empty() {
+            self.ra_buf.clear();
+            self.ra_consumed = 0;
+        }
+
+        if !self.wb_buf.is_empty() && self.wb_start + self.wb_buf.len() as u64 != self.pos {
+            self.flush_pending()?;
+        }
+        if self.wb_buf.is_empty() {
+            self.wb_start = self.pos;
+        }
+        self.wb_buf.extend_from_slice(buf);
+        self.pos += buf.len() as u64;
+
+        if self.wb_buf.len() >= self.group {
+            self.flush_pending()?;
+        }
+        Ok(buf.len())
+    }
+
+    /// Returns the logical cursor position.
+    pub fn tell(&self) -> SysResult<i64> {
+        Ok(self.pos as i64)
+    }
+
+    /// Moves the logical cursor, flushing pending writes and dropping
+    /// the read-ahead window.
+    pub fn seek(&mut self, offset: i64, origin: SeekFrom) -> SysError {
+        self.flush_pending()?;
+        self.stream.seek(offset, origin)?;
+        self.pos = self.stream.tell()? as u64;
+        self.ra_buf.clear();
+        self.ra_consumed = 0;
+        self.window = 1;
+        Ok(())
+    }
+
+    /// Writes out the pending group and flushes the underlying
+    /// protected file.
+    pub fn flush(&mut self) -> SysError {
+        self.flush_pending()?;
+        self.stream.flush()
+    }
+
+    fn refill(&mut self) -> SysResult<usize> {
+        self.flush_pending()?;
+
+        // Still at the end of the last window means the caller is
+        // streaming: grow. Anything else is a random read: shrink back.
+        let sequential = !self.ra_buf.is_empty()
+            && self.ra_start + self.ra_buf.len() as u64 == self.pos;
+        self.window = if sequential {
+            cmp::min(self.window * 2, self.max_window)
+        } else {
+            1
+        };
+
+        self.stream.seek(self.pos as i64, SeekFrom::Start)?;
+        self.ra_buf.clear();
+        self.ra_buf.resize(self.window * NODE_SIZE, 0);
+        let len = self.stream.read(&mut self.ra_buf)?;
+        self.ra_buf.truncate(len);
+        self.ra_start = self.pos;
+        self.ra_consumed = 0;
+        Ok(len)
+    }
+
+    fn flush_pending(&mut self) -> SysError {
+        if self.wb_buf.is_empty() {
+            return Ok(());
+        }
+        self.stream.seek(self.wb_start as i64, SeekFrom::Start)?;
+        let mut written = 0_usize;
+        while written < self.wb_buf.len() {
+            written += self.stream.write(&self.wb_buf[written..])?;
+        }
+        self.wb_buf.clear();
+        Ok(())
+    }
+}
+
+impl Drop for SequentialSgxFileStream {
+    fn drop(&mut self) {
+        // Best effort, as with the inner stream's close-on-drop; callers
+        // that care about the error flush explicitly.
+        let _ = self.flush_pending();
+    }
+}
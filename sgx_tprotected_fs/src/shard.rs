@@ -0,0 +1,234 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License..
+
+//! Multi-writer protected files via sharding.
+//!
+//! The protected FS library serializes every operation on a file handle
+//! behind one internal lock, and each file has a single Merkle hash tree
+//! whose root must be updated on every write, so a multi-threaded ingest
+//! into one protected file runs single-core no matter how many TCSs feed
+//! it. [`ShardedSgxFile`] removes both bottlenecks by striping the
+//! logical file across several physical protected files: each shard has
+//! its own handle, its own lock, and its own hash tree, so writers that
+//! touch different stripes proceed in parallel with no shared state at
+//! all.
+//!
+//! A logical file opened with `n` shards and a stripe of `s` nodes maps
+//! stripe `i` to shard `i % n`; shard `k` is stored beside the logical
+//! name as `<name>.shard<k>`. The layout is fixed at creation time, so a
+//! file must be reopened with the same shard count and stripe size it
+//! was written with.
+
+use crate::cache::NODE_SIZE;
+use crate::fs::{SeekFrom, SgxFileStream};
+use alloc::vec::Vec;
+use core::cmp;
+use core::sync::atomic::{AtomicBool, Ordering};
+use sgx_trts::c_str::{CStr, CString};
+use sgx_trts::libc;
+use sgx_types::{sgx_key_128bit_t, SysError, SysResult};
+
+struct Shard {
+    /// Guards the shard's cursor: seek and the following transfer must
+    /// not interleave across TCSs.
+    lock: AtomicBool,
+    stream: SgxFileStream,
+}
+
+impl Shard {
+    fn lock(&self) -> ShardGuard<'_> {
+        while self
+            .lock
+            .compare_exchange_weak(false, true, Ordering::Acquire, Ordering::Relaxed)
+            .is_err()
+        {
+            core::hint::spin_loop();
+        }
+        ShardGuard { shard: self }
+    }
+}
+
+struct ShardGuard<'a> {
+    shard: &'a Shard,
+}
+
+impl<'a> Drop for ShardGuard<'a> {
+    fn drop(&mut self) {
+        self.shard.lock.store(false, Ordering::Release);
+    }
+}
+
+/// A logical protected file striped over independently locked shards.
+///
+/// All I/O is positional and takes `&self`, so one `ShardedSgxFile` can
+/// be shared across TCSs; writers to different stripes never contend.
+/// Transfers that span a stripe boundary are split per shard, so a
+/// spanning write is not atomic with respect to concurrent readers of
+/// the same range - callers that need that must partition the offset
+/// space among writers, which is the layout this type is for.
+pub struct ShardedSgxFile {
+    shards: Vec<Shard>,
+    /// Stripe size in bytes; a whole number of nodes.
+    stripe: usize,
+}
+
+impl ShardedSgxFile {
+    /// Creates or opens the shard files of `filename` with the caller's
+    /// key, as [`SgxFileStream::open`] does for a single file.
+    ///
+    /// `shard_count` is clamped to at least one; `stripe_nodes` sets the
+    /// stripe size in 4KB nodes and must match the value the file was
+    /// created with.
+    pub fn open(
+        filename: &CStr,
+        mode: &CStr,
+        key: &sgx_key_128bit_t,
+        shard_count: usize,
+        stripe_nodes: usize,
+    ) -> SysResult<ShardedSgxFile> {
+        Self::open_with(filename, shard_count, stripe_nodes, |name| {
+            SgxFileStream::open(name, mode, key)
+        })
+    }
+
+    /// Creates or opens the shard files with automatic keys, as
+    /// [`SgxFileStream::open_auto_key`] does for a single file.
+    pub fn open_auto_key(
+        filename: &CStr,
+        mode: &CStr,
+        shard_count: usize,
+        stripe_nodes: usize,
+    ) -> SysResult<ShardedSgxFile> {
+        Self::open_with(filename, shard_count, stripe_nodes, |name| {
+            SgxFileStream::open_auto_key(name, mode)
+        })
+    }
+
+    fn open_with<F>(
+        filename: &CStr,
+        shard_count: usize,
+        stripe_nodes: usize,
+        open_one: F,
+    ) -> SysResult<ShardedSgxFile>
+    where
+        F: Fn(&CStr) -> SysResult<SgxFileStream>,
+    {
+        let count = cmp::max(shard_count, 1);
+        let mut shards = Vec::with_capacity(count);
+        for index in 0..count {
+            let name = shard_name(filename, index)?;
+            let stream = open_one(&name)?;
+            shards.push(Shard { lock: AtomicBool::new(false), stream });
+        }
+        Ok(ShardedSgxFile {
+            shards,
+            stripe: cmp::max(stripe_nodes, 1) * NODE_SIZE,
+        })
+    }
+
+    /// Reads up to `buf.len()` bytes at logical `offset`, locking each
+    /// touched shard in turn.
+    pub fn read_at(&self, offset: u64, buf: &mut [u8]) -> SysResult<usize> {
+        let mut done = 0_usize;
+        while done < buf.len() {
+            let pos = offset + done as u64;
+            let (shard, shard_offset, in_stripe) = self.locate(pos);
+            let take = cmp::min(buf.len() - done, self.stripe - in_stripe);
+
+            let guard = self.shards[shard].lock();
+            guard.shard.stream.seek(shard_offset as i64, SeekFrom::Start)?;
+            let len = guard.shard.stream.read(&mut buf[done..done + take])?;
+            drop(guard);
+
+            done += len;
+            if len < take {
+                break; // EOF in this shard
+            }
+        }
+        Ok(done)
+    }
+
+    /// Writes `buf` at logical `offset`, locking each touched shard in
+    /// turn; writes to different stripes from different TCSs do not
+    /// contend.
+    pub fn write_at(&self, offset: u64, buf: &[u8]) -> SysResult<usize> {
+        let mut done = 0_usize;
+        while done < buf.len() {
+            let pos = offset + done as u64;
+            let (shard, shard_offset, in_stripe) = self.locate(pos);
+            let take = cmp::min(buf.len() - done, self.stripe - in_stripe);
+
+            let guard = self.shards[shard].lock();
+            guard.shard.stream.seek(shard_offset as i64, SeekFrom::Start)?;
+            let mut written = 0_usize;
+            while written < take {
+                written += guard.shard.stream.write(&buf[done + written..done + take])?;
+            }
+            drop(guard);
+
+            done += take;
+        }
+        Ok(done)
+    }
+
+    /// Flushes every shard; each shard's hash tree root is committed
+    /// independently.
+    pub fn flush(&self) -> SysError {
+        for shard in &self.shards {
+            let guard = shard.lock();
+            guard.shard.stream.flush()?;
+        }
+        Ok(())
+    }
+
+    /// Number of shards the logical file is striped over.
+    pub fn shard_count(&self) -> usize {
+        self.shards.len()
+    }
+
+    /// Maps a logical offset to (shard index, offset inside that shard,
+    /// offset inside the stripe).
+    fn locate(&self, offset: u64) -> (usize, u64, usize) {
+        let stripe = self.stripe as u64;
+        let count = self.shards.len() as u64;
+        let stripe_index = offset / stripe;
+        let in_stripe = offset % stripe;
+        let shard = (stripe_index % count) as usize;
+        let shard_offset = (stripe_index / count) * stripe + in_stripe;
+        (shard, shard_offset, in_stripe as usize)
+    }
+}
+
+fn shard_name(filename: &CStr, index: usize) -> SysResult<CString> {
+    let mut name = filename.to_bytes().to_vec();
+    name.extend_from_slice(b".shard");
+    let mut digits = [0_u8; 20];
+    let mut len = 0_usize;
+    let mut value = index;
+    loop {
+        digits[len] = b'0' + (value % 10) as u8;
+        len += 1;
+        value /= 10;
+        if value == 0 {
+            break;
+        }
+    }
+    for digit in digits[..len].iter().rev() {
+        name.push(*digit);
+    }
+    CString::new(name).map_err(|_| libc::EINVAL)
+}
@@ -208,6 +208,72 @@ macro_rules! is_x86_feature_detected {
     };
 }
 
+/// Evaluates to the first arm whose CPU feature is present in the enclave's
+/// feature snapshot, falling back to the mandatory `_` arm. Feature names are
+/// the same strings `is_x86_feature_detected!` accepts; arms are tried in
+/// order, so list the widest ISA level first.
+///
+/// ```ignore
+/// let kernel: fn(&[u8]) -> u64 = cpu_select! {
+///     "avx512bw" => hash_avx512,
+///     "avx2" => hash_avx2,
+///     _ => hash_portable,
+/// };
+/// ```
+#[macro_export]
+macro_rules! cpu_select {
+    (_ => $default:expr $(,)?) => {
+        $default
+    };
+    ($feature:tt => $value:expr, $($rest:tt)+) => {
+        if $crate::is_x86_feature_detected!($feature) {
+            $value
+        } else {
+            $crate::cpu_select!($($rest)+)
+        }
+    };
+}
+
+/// Defines a multi-versioned function that dispatches on the enclave's CPU
+/// feature snapshot. Each arm names a feature string and an implementation
+/// with the same signature as the declared function; the `_` arm is the
+/// baseline. The winner is resolved on first call and cached in an atomic,
+/// so steady-state calls cost one relaxed load and an indirect call.
+///
+/// The snapshot is captured by the uRTS before enclave entry, so dispatch
+/// never executes CPUID inside the enclave.
+///
+/// ```ignore
+/// cpu_dispatch! {
+///     pub fn sum(data: &[u8]) -> u64 {
+///         "avx512f" => sum_avx512,
+///         "avx2" => sum_avx2,
+///         _ => sum_portable,
+///     }
+/// }
+/// ```
+#[macro_export]
+macro_rules! cpu_dispatch {
+    ($(#[$attr:meta])* $vis:vis fn $name:ident($($arg:ident: $ty:ty),* $(,)?) $(-> $ret:ty)? {
+        $($arms:tt)*
+    }) => {
+        $(#[$attr])*
+        $vis fn $name($($arg: $ty),*) $(-> $ret)? {
+            type FnTy = fn($($ty),*) $(-> $ret)?;
+            static SELECTED: ::core::sync::atomic::AtomicUsize =
+                ::core::sync::atomic::AtomicUsize::new(0);
+            let mut cached = SELECTED.load(::core::sync::atomic::Ordering::Relaxed);
+            if cached == 0 {
+                let selected: FnTy = $crate::cpu_select!($($arms)*);
+                cached = selected as usize;
+                SELECTED.store(cached, ::core::sync::atomic::Ordering::Relaxed);
+            }
+            let f: FnTy = unsafe { ::core::mem::transmute(cached) };
+            f($($arg),*)
+        }
+    };
+}
+
 impl_enum! {
     #[repr(u32)]
     #[derive(Copy, Clone, PartialEq, Eq)]
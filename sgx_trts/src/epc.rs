@@ -0,0 +1,160 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License..
+
+//! In-enclave view of the host's EPC pressure page.
+//!
+//! The untrusted side (`sgx_urts::epc::EpcMonitor`) samples the kernel's
+//! EPC statistics and publishes a pressure score into a fixed page
+//! outside the enclave. The enclave registers that page once through
+//! [`rsgx_set_epc_pressure_page`] and then polls [`rsgx_epc_pressure`]
+//! for free - no ocall - so a memory-hungry component (an in-enclave
+//! cache, a batch sizer) can shrink its working set before EWB paging
+//! starts thrashing.
+//!
+//! Everything in the page is host-provided and ADVISORY. Act on it for
+//! performance only - cache sizing, admission control - never for
+//! anything security-relevant: a malicious host can publish any score
+//! it likes, just as it can already slow the enclave arbitrarily.
+
+use crate::trts::rsgx_raw_is_outside_enclave;
+use core::mem;
+use core::ptr;
+use core::sync::atomic::{fence, AtomicUsize, Ordering};
+use sgx_types::*;
+
+const EPC_PAGE_MAGIC: u32 = 0x4550_4350; // "EPCP"
+/// Bounded retries against a writer mid-sample; the writer's critical
+/// section is a handful of stores, so this never triggers in practice.
+const READ_RETRIES: usize = 64;
+
+/// Mirror of `sgx_urts::epc::EpcPressurePage`. Layout is the
+/// untrusted/trusted contract; the fields are read volatilely from
+/// untrusted memory and revalidated through the seq counter.
+#[repr(C)]
+#[derive(Copy, Clone)]
+struct PressurePage {
+    seq: u32,
+    magic: u32,
+    score: u32,
+    paging_rate: u32,
+    epc_total: u64,
+    epc_used: u64,
+    paging_events: u64,
+    sample_ms: u64,
+}
+
+/// One consistent sample of the host's EPC pressure page.
+#[derive(Copy, Clone, Debug, Default)]
+pub struct SgxEpcPressure {
+    /// 0 (no pressure) to 100 (thrashing). Host-provided, advisory.
+    pub score: u32,
+    /// Paging events per second, exponentially smoothed.
+    pub paging_rate: u32,
+    /// EPC capacity in bytes; 0 when the host exposes none.
+    pub epc_total: u64,
+    /// EPC occupancy in bytes; 0 when the host exposes none.
+    pub epc_used: u64,
+    /// Cumulative paging events since the monitor started.
+    pub paging_events: u64,
+    /// Monitor-relative timestamp of the sample in milliseconds; a
+    /// stale value means the monitor stopped sampling.
+    pub sample_ms: u64,
+}
+
+static PRESSURE_PAGE: AtomicUsize = AtomicUsize::new(0);
+
+///
+/// rsgx_set_epc_pressure_page registers the host's pressure page for
+/// [`rsgx_epc_pressure`] reads.
+///
+/// # Description
+///
+/// Call once from an ECALL that receives the page address as a
+/// `[user_check]` pointer from `EpcMonitor::page_ptr`. The page must
+/// stay mapped for the life of the enclave; registering a null pointer
+/// deregisters.
+///
+/// # Errors
+///
+/// **SGX_ERROR_INVALID_PARAMETER**
+///
+/// The page does not lie entirely outside the enclave, or its magic
+/// does not match.
+///
+pub fn rsgx_set_epc_pressure_page(page: *const u8) -> SgxError {
+    if page.is_null() {
+        PRESSURE_PAGE.store(0, Ordering::Release);
+        return Ok(());
+    }
+    if !rsgx_raw_is_outside_enclave(page, mem::size_of::<PressurePage>()) {
+        return Err(sgx_status_t::SGX_ERROR_INVALID_PARAMETER);
+    }
+    let magic = unsafe { ptr::read_volatile(&(*(page as *const PressurePage)).magic) };
+    if magic != EPC_PAGE_MAGIC {
+        return Err(sgx_status_t::SGX_ERROR_INVALID_PARAMETER);
+    }
+    PRESSURE_PAGE.store(page as usize, Ordering::Release);
+    Ok(())
+}
+
+///
+/// rsgx_epc_pressure reads one consistent sample from the registered
+/// pressure page.
+///
+/// # Description
+///
+/// A volatile read of the page bracketed by the writer's seq counter:
+/// an odd or changed counter means the host was mid-sample and the read
+/// retries. Costs a few loads - cheap enough for a cache to check on
+/// every eviction scan.
+///
+/// Returns None when no page is registered, the page stopped looking
+/// like one, or the writer raced every retry.
+///
+pub fn rsgx_epc_pressure() -> Option<SgxEpcPressure> {
+    let addr = PRESSURE_PAGE.load(Ordering::Acquire);
+    if addr == 0 {
+        return None;
+    }
+    let page = addr as *const PressurePage;
+
+    for _ in 0..READ_RETRIES {
+        let seq1 = unsafe { ptr::read_volatile(&(*page).seq) };
+        if seq1 & 1 != 0 {
+            continue;
+        }
+        fence(Ordering::Acquire);
+        let sample = unsafe { ptr::read_volatile(page) };
+        fence(Ordering::Acquire);
+        let seq2 = unsafe { ptr::read_volatile(&(*page).seq) };
+        if seq1 != seq2 {
+            continue;
+        }
+        if sample.magic != EPC_PAGE_MAGIC {
+            return None;
+        }
+        return Some(SgxEpcPressure {
+            score: sample.score.min(100),
+            paging_rate: sample.paging_rate,
+            epc_total: sample.epc_total,
+            epc_used: sample.epc_used,
+            paging_events: sample.paging_events,
+            sample_ms: sample.sample_ms,
+        });
+    }
+    None
+}
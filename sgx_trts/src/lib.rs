@@ -91,11 +91,16 @@ pub mod c_str;
 pub mod cpu_feature;
 pub mod cpuid;
 pub mod enclave;
+pub mod epc;
 pub mod memchr;
 pub mod memeq;
+pub mod memops;
 pub mod oom;
+pub mod prefetch;
 pub mod trts;
+pub mod userbuf;
 pub mod veh;
+pub mod warmup;
 
 #[cfg(not(target_env = "sgx"))]
 pub use sgx_libc as libc;
@@ -0,0 +1,222 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License..
+
+//! Wide memory primitives for enclave hot paths.
+//!
+//! Security-sensitive code tends to fall back to byte loops: byte-wise
+//! constant-time compares for MACs, byte-wise clears for key material,
+//! and a separate bounds-check pass before every copy across the enclave
+//! boundary. This module provides the same guarantees at lane width:
+//! a constant-time compare walking 32 bytes per step on SSE2 registers,
+//! a volatile memory clear the compiler cannot elide, and copies from
+//! and to untrusted memory that fuse the enclave-boundary check, the
+//! speculation fence and a wide copy into one call.
+//!
+//! SSE2 is unconditionally available on x86_64 enclaves, so none of this
+//! depends on XSAVE-enabled AVX state.
+
+use crate::trts::{rsgx_lfence, rsgx_raw_is_outside_enclave, rsgx_raw_is_within_enclave};
+use core::arch::x86_64::*;
+use core::ptr;
+use sgx_types::marker::ContiguousMemory;
+use sgx_types::*;
+
+///
+/// rsgx_consttime_memeq compares two byte slices in constant time,
+/// processing 32-byte lanes per step.
+///
+/// # Description
+///
+/// Equivalent to the byte-loop ConsttimeMemEq in the memeq module: the
+/// running time depends only on the length, never on where the slices
+/// differ, so it is safe for MAC and tag comparison. Differences are
+/// accumulated by OR-ing XOR lanes in an SSE2 register and the single
+/// data-dependent branch is on the final, complete verdict.
+///
+/// Slices of unequal length compare unequal immediately; length is
+/// public information in every protocol this serves.
+///
+pub fn rsgx_consttime_memeq(lhs: &[u8], rhs: &[u8]) -> bool {
+    if lhs.len() != rhs.len() {
+        return false;
+    }
+    let len = lhs.len();
+    let a = lhs.as_ptr();
+    let b = rhs.as_ptr();
+    unsafe {
+        let mut acc = _mm_setzero_si128();
+        let mut i = 0;
+        while i + 32 <= len {
+            let a0 = _mm_loadu_si128(a.add(i) as *const __m128i);
+            let b0 = _mm_loadu_si128(b.add(i) as *const __m128i);
+            let a1 = _mm_loadu_si128(a.add(i + 16) as *const __m128i);
+            let b1 = _mm_loadu_si128(b.add(i + 16) as *const __m128i);
+            acc = _mm_or_si128(acc, _mm_xor_si128(a0, b0));
+            acc = _mm_or_si128(acc, _mm_xor_si128(a1, b1));
+            i += 32;
+        }
+        if i + 16 <= len {
+            let a0 = _mm_loadu_si128(a.add(i) as *const __m128i);
+            let b0 = _mm_loadu_si128(b.add(i) as *const __m128i);
+            acc = _mm_or_si128(acc, _mm_xor_si128(a0, b0));
+            i += 16;
+        }
+        let mut tail: u8 = 0;
+        while i < len {
+            tail |= *a.add(i) ^ *b.add(i);
+            i += 1;
+        }
+        let lanes_zero = _mm_movemask_epi8(_mm_cmpeq_epi8(acc, _mm_setzero_si128()));
+        (lanes_zero == 0xFFFF) & (tail == 0)
+    }
+}
+
+///
+/// rsgx_memclear overwrites a buffer with zeros through volatile stores.
+///
+/// # Description
+///
+/// A plain write loop before a free or a return is dead to the
+/// optimizer and routinely removed; these stores are volatile, so key
+/// material is gone when the call returns. Interior stores run at u64
+/// width on the aligned middle of the buffer, with byte stores on the
+/// unaligned edges.
+///
+pub fn rsgx_memclear(data: &mut [u8]) {
+    let len = data.len();
+    let p = data.as_mut_ptr();
+    unsafe {
+        let mut i = 0;
+        while i < len && (p.add(i) as usize) & 7 != 0 {
+            ptr::write_volatile(p.add(i), 0);
+            i += 1;
+        }
+        while i + 8 <= len {
+            ptr::write_volatile(p.add(i) as *mut u64, 0);
+            i += 8;
+        }
+        while i < len {
+            ptr::write_volatile(p.add(i), 0);
+            i += 1;
+        }
+    }
+}
+
+///
+/// rsgx_memclear_obj zeroes an object of any contiguous-memory type,
+/// typically a key or session structure about to be dropped.
+///
+pub fn rsgx_memclear_obj<T: ContiguousMemory>(obj: &mut T) {
+    let size = core::mem::size_of_val(obj);
+    let p = obj as *mut T as *mut u8;
+    unsafe {
+        let data = core::slice::from_raw_parts_mut(p, size);
+        rsgx_memclear(data);
+    }
+}
+
+// 32 bytes per iteration through SSE2 registers; the tail runs at u64
+// and byte width. Unaligned loads/stores: boundary buffers come from
+// ocall bridges with no alignment promise.
+unsafe fn wide_copy(dst: *mut u8, src: *const u8, count: usize) {
+    let mut i = 0;
+    while i + 32 <= count {
+        let v0 = _mm_loadu_si128(src.add(i) as *const __m128i);
+        let v1 = _mm_loadu_si128(src.add(i + 16) as *const __m128i);
+        _mm_storeu_si128(dst.add(i) as *mut __m128i, v0);
+        _mm_storeu_si128(dst.add(i + 16) as *mut __m128i, v1);
+        i += 32;
+    }
+    while i + 8 <= count {
+        let v = ptr::read_unaligned(src.add(i) as *const u64);
+        ptr::write_unaligned(dst.add(i) as *mut u64, v);
+        i += 8;
+    }
+    while i < count {
+        *dst.add(i) = *src.add(i);
+        i += 1;
+    }
+}
+
+///
+/// rsgx_copy_from_untrusted copies `count` bytes from untrusted memory
+/// into the enclave, fusing the boundary check, the speculation fence
+/// and a wide copy.
+///
+/// # Description
+///
+/// Verifies in one range comparison that the whole source lies outside
+/// the enclave and the whole destination inside it, issues an lfence so
+/// no load is speculated past an unresolved check, then copies in
+/// 32-byte lanes. This replaces the separate is-outside-enclave pass
+/// plus memcpy that every ocall wrapper performs today.
+///
+/// # Safety
+///
+/// `src` and `dst` must be valid for `count` bytes; the ranges must not
+/// overlap (they cannot, when the check passes). The source is untrusted:
+/// the caller must treat the copied bytes as attacker-controlled data.
+///
+/// # Errors
+///
+/// **SGX_ERROR_INVALID_PARAMETER**
+///
+/// The source is not entirely outside the enclave, or the destination
+/// is not entirely inside it.
+///
+pub unsafe fn rsgx_copy_from_untrusted(dst: *mut u8, src: *const u8, count: usize) -> SgxError {
+    if count == 0 {
+        return Ok(());
+    }
+    if !rsgx_raw_is_outside_enclave(src, count)
+        || !rsgx_raw_is_within_enclave(dst, count)
+    {
+        return Err(sgx_status_t::SGX_ERROR_INVALID_PARAMETER);
+    }
+    rsgx_lfence();
+    wide_copy(dst, src, count);
+    Ok(())
+}
+
+///
+/// rsgx_copy_to_untrusted copies `count` bytes from the enclave out to
+/// untrusted memory, with the mirrored checks of rsgx_copy_from_untrusted.
+///
+/// # Safety
+///
+/// `src` and `dst` must be valid for `count` bytes. Everything written
+/// becomes visible to the host immediately.
+///
+/// # Errors
+///
+/// **SGX_ERROR_INVALID_PARAMETER**
+///
+/// The source is not entirely inside the enclave, or the destination
+/// is not entirely outside it.
+///
+pub unsafe fn rsgx_copy_to_untrusted(dst: *mut u8, src: *const u8, count: usize) -> SgxError {
+    if count == 0 {
+        return Ok(());
+    }
+    if !rsgx_raw_is_within_enclave(src, count)
+        || !rsgx_raw_is_outside_enclave(dst, count)
+    {
+        return Err(sgx_status_t::SGX_ERROR_INVALID_PARAMETER);
+    }
+    wide_copy(dst, src, count);
+    Ok(())
+}
@@ -0,0 +1,303 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License..
+
+//! Lazy-pull access to large untrusted buffers.
+//!
+//! An ECALL parameter declared `[in, size=...]` is deep-copied into the
+//! enclave by the generated bridge before the function body runs, so an
+//! enclave that reads a small header and discards the message still
+//! pays the full-copy cost. The lazy-pull pattern inverts that: the
+//! ECALL takes a `[user_check]` pointer and length, wraps them in an
+//! [`SgxUserBuffer`] - validating ONCE that the whole range lies
+//! outside the enclave - and then pulls only the ranges it actually
+//! needs through the fused-check copy primitives in `memops`. A router
+//! that drops a message after a 32-byte header pull copies 32 bytes,
+//! not the megabyte behind it.
+//!
+//! The buffer is untrusted memory and the host can rewrite it between
+//! pulls. Every pull is an independent snapshot: validate and use the
+//! bytes of ONE pull; never re-pull a range and assume it still matches
+//! what was validated (classic TOCTOU). Length and offsets are enclave
+//! values, so range arithmetic here cannot be steered by the host.
+
+use crate::memops::{rsgx_copy_from_untrusted, rsgx_copy_to_untrusted};
+use crate::trts::rsgx_raw_is_outside_enclave;
+use alloc::vec::Vec;
+use core::marker::PhantomData;
+use core::mem;
+use sgx_types::marker::ContiguousMemory;
+use sgx_types::*;
+
+///
+/// SgxUserBuffer is a validated descriptor of one untrusted buffer,
+/// from which the enclave pulls ranges on demand.
+///
+/// # Description
+///
+/// Construct it at the top of an ECALL from a `[user_check]` pointer
+/// and a length; the whole-range boundary check runs once, and each
+/// pull only bounds-checks its range against the descriptor before the
+/// fused-check copy. The descriptor borrows nothing: the host owns the
+/// memory, and the lifetime parameter only ties pulls to the ECALL
+/// frame the pointer arrived in.
+///
+pub struct SgxUserBuffer<'a> {
+    base: *const u8,
+    len: usize,
+    marker: PhantomData<&'a [u8]>,
+}
+
+impl<'a> SgxUserBuffer<'a> {
+    ///
+    /// Validate a `[user_check]` pointer/length pair. The single
+    /// boundary check for all later pulls.
+    ///
+    /// # Safety
+    ///
+    /// `base` must stay mapped for the ECALL's duration; the host
+    /// controls the contents throughout.
+    ///
+    /// # Errors
+    ///
+    /// **SGX_ERROR_INVALID_PARAMETER**
+    ///
+    /// The pointer is null, the length is 0, or the range is not
+    /// entirely outside the enclave.
+    ///
+    pub unsafe fn new(base: *const u8, len: usize) -> SgxResult<SgxUserBuffer<'a>> {
+        if base.is_null() || len == 0 || !rsgx_raw_is_outside_enclave(base, len) {
+            return Err(sgx_status_t::SGX_ERROR_INVALID_PARAMETER);
+        }
+        Ok(SgxUserBuffer {
+            base,
+            len,
+            marker: PhantomData,
+        })
+    }
+
+    ///
+    /// Get the buffer length in bytes.
+    ///
+    pub fn len(&self) -> usize {
+        self.len
+    }
+
+    ///
+    /// Returns true if the descriptor covers no bytes (never, by
+    /// construction; present for slice-like completeness).
+    ///
+    pub fn is_empty(&self) -> bool {
+        self.len == 0
+    }
+
+    ///
+    /// Pull `dst.len()` bytes starting at `offset` into enclave memory.
+    /// A snapshot: later pulls of the same range may differ.
+    ///
+    /// # Errors
+    ///
+    /// **SGX_ERROR_INVALID_PARAMETER**
+    ///
+    /// The range does not fit in the buffer, or `dst` is not entirely
+    /// inside the enclave.
+    ///
+    pub fn pull_into(&self, offset: usize, dst: &mut [u8]) -> SgxError {
+        let count = dst.len();
+        if count == 0 {
+            return Ok(());
+        }
+        if offset >= self.len || count > self.len - offset {
+            return Err(sgx_status_t::SGX_ERROR_INVALID_PARAMETER);
+        }
+        unsafe { rsgx_copy_from_untrusted(dst.as_mut_ptr(), self.base.add(offset), count) }
+    }
+
+    ///
+    /// Pull `count` bytes starting at `offset` into a fresh Vec.
+    ///
+    pub fn pull_vec(&self, offset: usize, count: usize) -> SgxResult<Vec<u8>> {
+        let mut dst: Vec<u8> = Vec::with_capacity(count);
+        dst.resize(count, 0);
+        self.pull_into(offset, &mut dst)?;
+        Ok(dst)
+    }
+
+    ///
+    /// Pull one POD value at `offset` - the header peek the lazy-pull
+    /// pattern exists for. The bytes are attacker-controlled; `T` must
+    /// tolerate any bit pattern, which `ContiguousMemory` types do.
+    ///
+    pub fn pull_obj<T: Copy + ContiguousMemory>(&self, offset: usize) -> SgxResult<T> {
+        let mut value: T = unsafe { mem::zeroed() };
+        let dst = unsafe {
+            core::slice::from_raw_parts_mut(&mut value as *mut T as *mut u8, mem::size_of::<T>())
+        };
+        self.pull_into(offset, dst)?;
+        Ok(value)
+    }
+}
+
+///
+/// SgxUserBufferMut additionally pushes enclave bytes back out, for
+/// in-place reply workflows over the same descriptor.
+///
+pub struct SgxUserBufferMut<'a> {
+    inner: SgxUserBuffer<'a>,
+}
+
+impl<'a> SgxUserBufferMut<'a> {
+    ///
+    /// Validate a mutable `[user_check]` pointer/length pair.
+    ///
+    /// # Safety
+    ///
+    /// As [`SgxUserBuffer::new`]; the host also observes every push
+    /// immediately.
+    ///
+    pub unsafe fn new(base: *mut u8, len: usize) -> SgxResult<SgxUserBufferMut<'a>> {
+        Ok(SgxUserBufferMut {
+            inner: SgxUserBuffer::new(base, len)?,
+        })
+    }
+
+    ///
+    /// Push `src` to the buffer at `offset`. Everything written is
+    /// visible to the host immediately.
+    ///
+    /// # Errors
+    ///
+    /// **SGX_ERROR_INVALID_PARAMETER**
+    ///
+    /// The range does not fit in the buffer, or `src` is not entirely
+    /// inside the enclave.
+    ///
+    pub fn push_from(&self, offset: usize, src: &[u8]) -> SgxError {
+        let count = src.len();
+        if count == 0 {
+            return Ok(());
+        }
+        if offset >= self.inner.len || count > self.inner.len - offset {
+            return Err(sgx_status_t::SGX_ERROR_INVALID_PARAMETER);
+        }
+        unsafe {
+            rsgx_copy_to_untrusted(
+                self.inner.base.add(offset) as *mut u8,
+                src.as_ptr(),
+                count,
+            )
+        }
+    }
+}
+
+impl<'a> core::ops::Deref for SgxUserBufferMut<'a> {
+    type Target = SgxUserBuffer<'a>;
+    fn deref(&self) -> &SgxUserBuffer<'a> {
+        &self.inner
+    }
+}
+
+/// Default chunk size of [`SgxChunkedReader`]: big enough that the
+/// per-chunk bounds check and copy amortize, small enough that a
+/// payload of any size never pins more than this much EPC.
+pub const SGX_CHUNKED_READER_DEFAULT_CHUNK: usize = 256 * 1024;
+
+///
+/// SgxChunkedReader streams a large `[user_check]` parameter through a
+/// single bounded scratch buffer - the hand-rolled bridge for payloads
+/// too big to declare `[in, size=...]`.
+///
+/// # Description
+///
+/// The generated bridge for an `[in]` parameter deep-copies the whole
+/// payload into the EPC before the ECALL body runs: a 100MB snapshot
+/// stalls the TCS for the full copy and demands 100MB of enclave heap.
+/// Declaring the parameter `[user_check]` and walking it with this
+/// reader instead copies one chunk at a time into a scratch buffer
+/// allocated once, so the enclave processes the payload incrementally
+/// in bounded memory:
+///
+/// ```text
+/// let buffer = unsafe { SgxUserBuffer::new(ptr, len)? };
+/// let mut reader = SgxChunkedReader::new(buffer, 0);
+/// while let Some(chunk) = reader.next_chunk()? {
+///     ingest(chunk);
+/// }
+/// ```
+///
+/// Each chunk is an independent snapshot of untrusted memory, like any
+/// other pull: validate and consume the bytes of one chunk before
+/// fetching the next, and never assume two reads of the same offset
+/// agree.
+///
+pub struct SgxChunkedReader<'a> {
+    buffer: SgxUserBuffer<'a>,
+    scratch: Vec<u8>,
+    chunk_size: usize,
+    offset: usize,
+}
+
+impl<'a> SgxChunkedReader<'a> {
+    ///
+    /// Wrap a validated buffer for chunked streaming. A `chunk_size`
+    /// of 0 selects [`SGX_CHUNKED_READER_DEFAULT_CHUNK`].
+    ///
+    pub fn new(buffer: SgxUserBuffer<'a>, chunk_size: usize) -> SgxChunkedReader<'a> {
+        let chunk_size = if chunk_size == 0 {
+            SGX_CHUNKED_READER_DEFAULT_CHUNK
+        } else {
+            chunk_size
+        };
+        SgxChunkedReader {
+            buffer,
+            scratch: Vec::new(),
+            chunk_size,
+            offset: 0,
+        }
+    }
+
+    ///
+    /// Bytes already streamed into the enclave.
+    ///
+    pub fn position(&self) -> usize {
+        self.offset
+    }
+
+    ///
+    /// Total payload length.
+    ///
+    pub fn len(&self) -> usize {
+        self.buffer.len()
+    }
+
+    ///
+    /// Pull the next chunk into the scratch buffer and return it, or
+    /// `None` once the payload is exhausted. The returned slice is
+    /// valid until the next call; the scratch allocation is reused
+    /// across chunks.
+    ///
+    pub fn next_chunk(&mut self) -> SgxResult<Option<&[u8]>> {
+        let remaining = self.buffer.len() - self.offset;
+        if remaining == 0 {
+            return Ok(None);
+        }
+        let count = remaining.min(self.chunk_size);
+        self.scratch.resize(count, 0);
+        self.buffer.pull_into(self.offset, &mut self.scratch[..count])?;
+        self.offset += count;
+        Ok(Some(&self.scratch[..count]))
+    }
+}
@@ -0,0 +1,143 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License..
+
+//! Eager pre-faulting of enclave heap and stack pages.
+//!
+//! The first touch of an enclave page is expensive: on SGX2 it takes an
+//! EAUG/EACCEPT round trip through the page-fault handler, and even on
+//! SGX1 the page still has to be faulted in and zeroed. An enclave that
+//! defers all of that to its request path serves its first thousand
+//! requests against a cold heap and measurably slower than steady
+//! state. The warm-up calls here move that cost into the init window:
+//! touch the pages once while nobody is waiting, and request one runs
+//! at steady-state speed.
+//!
+//! Heap warm-up goes through the global allocator - the chunks are
+//! allocated, touched per page and then freed - so the committed pages
+//! land in the allocator's own free spans and the next real allocation
+//! reuses them. Stack pages belong to a TCS, and both calls only warm
+//! the calling thread's view, so run them from every worker TCS during
+//! its warm-up ecall; heap warm-up from several TCSs at once also
+//! spreads the page-fault handling across cores.
+
+use crate::enclave::SgxThreadData;
+use alloc::alloc::{alloc, dealloc, Layout};
+use alloc::vec::Vec;
+use core::ptr;
+
+const PAGE_SIZE: usize = 0x1000;
+/// Heap warm-up allocation granularity. Large enough that the
+/// allocator carves whole spans, small enough to stop near the
+/// requested budget when the heap cannot grow further.
+pub const WARM_HEAP_CHUNK_SIZE: usize = 2 * 1024 * 1024;
+/// Stack bytes per recursion frame while warming the stack.
+const WARM_STACK_FRAME_SIZE: usize = 16 * 1024;
+/// Stack headroom never touched by [`rsgx_warm_stack`], left for the
+/// caller's own frames underneath the warm-up recursion.
+const WARM_STACK_RESERVE: usize = 64 * 1024;
+
+///
+/// rsgx_warm_heap commits up to `bytes` of enclave heap eagerly.
+///
+/// # Description
+///
+/// Allocates the budget in [`WARM_HEAP_CHUNK_SIZE`] chunks, writes one
+/// byte per page to force the commit, and frees every chunk only after
+/// the whole budget is touched, so the warmed spans return to the
+/// allocator's free lists instead of being handed back chunk by chunk.
+/// Stops early when the allocator cannot satisfy the next chunk.
+///
+/// Safe to call concurrently; calling from several TCSs splits the
+/// page-fault work across them.
+///
+/// Returns the number of bytes actually committed.
+///
+pub fn rsgx_warm_heap(bytes: usize) -> usize {
+    let mut chunks: Vec<(*mut u8, Layout)> = Vec::new();
+    let mut warmed: usize = 0;
+
+    while warmed < bytes {
+        let size = (bytes - warmed).min(WARM_HEAP_CHUNK_SIZE);
+        let layout = match Layout::from_size_align(size, PAGE_SIZE) {
+            Ok(layout) => layout,
+            Err(_) => break,
+        };
+        let chunk = unsafe { alloc(layout) };
+        if chunk.is_null() {
+            break;
+        }
+
+        let mut offset = 0;
+        while offset < size {
+            unsafe { ptr::write_volatile(chunk.add(offset), 0) };
+            offset += PAGE_SIZE;
+        }
+
+        chunks.push((chunk, layout));
+        warmed += size;
+    }
+
+    for (chunk, layout) in chunks {
+        unsafe { dealloc(chunk, layout) };
+    }
+
+    warmed
+}
+
+///
+/// rsgx_warm_stack commits up to `bytes` of the calling TCS's stack.
+///
+/// # Description
+///
+/// Recurses in [`WARM_STACK_FRAME_SIZE`]-byte frames, touching one byte
+/// per page of each frame, until the budget is spent or the thread's
+/// stack limit (minus a reserve for the caller's own frames) is
+/// reached. Each TCS owns its stack, so warm every worker thread from
+/// its own warm-up ecall.
+///
+/// Returns the number of bytes actually touched.
+///
+pub fn rsgx_warm_stack(bytes: usize) -> usize {
+    let probe: u8 = 0;
+    let sp = &probe as *const u8 as usize;
+    let limit = SgxThreadData::current().stack_limit();
+
+    let available = sp.saturating_sub(limit).saturating_sub(WARM_STACK_RESERVE);
+    let target = bytes.min(available);
+    if target == 0 {
+        return 0;
+    }
+
+    touch_stack_frame(target)
+}
+
+#[inline(never)]
+fn touch_stack_frame(remaining: usize) -> usize {
+    let mut frame = [0_u8; WARM_STACK_FRAME_SIZE];
+
+    let mut offset = 0;
+    while offset < frame.len() {
+        unsafe { ptr::write_volatile(frame.as_mut_ptr().add(offset), 0) };
+        offset += PAGE_SIZE;
+    }
+
+    if remaining > WARM_STACK_FRAME_SIZE {
+        WARM_STACK_FRAME_SIZE + touch_stack_frame(remaining - WARM_STACK_FRAME_SIZE)
+    } else {
+        remaining
+    }
+}
@@ -0,0 +1,223 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  You may obtain a copy of the
+// specific language governing permissions and limitations
+// under the License..
+
+//! # Cached key derivation
+//!
+//! EGETKEY costs on the order of 10k cycles, and derivation is
+//! deterministic: the same sgx_key_request_t always yields the same key
+//! on the same platform. A per-record encryption layer that derives per
+//! operation pays that cost for nothing after the first call. This
+//! module keeps recently derived keys in a fixed-size table in enclave
+//! memory, keyed by the full key request (policy, key_id, SVNs, masks),
+//! so repeated requests become a probe over a few table slots.
+//!
+//! The table is statically allocated - this crate has no allocator -
+//! and holds raw key material, so it never leaves the enclave and
+//! [`rsgx_invalidate_cached_keys`] zeroes every slot for callers that
+//! want key material gone at a known point (e.g. before hibernating
+//! state to disk).
+
+use core::cell::UnsafeCell;
+use core::mem::{self, MaybeUninit};
+use core::ptr;
+use core::slice;
+use core::sync::atomic::{AtomicBool, Ordering};
+use sgx_types::*;
+use crate::se::rsgx_get_key;
+
+/// Power of two; the table is ~36KB of static enclave memory.
+const CACHE_SLOTS: usize = 64;
+/// Linear probe window before a miss evicts the home slot.
+const PROBE_WINDOW: usize = 8;
+
+#[repr(C)]
+struct Entry {
+    valid: u8,
+    request: sgx_key_request_t,
+    key: sgx_key_128bit_t,
+}
+
+struct KeyCache {
+    lock: AtomicBool,
+    initialized: AtomicBool,
+    entries: UnsafeCell<MaybeUninit<[Entry; CACHE_SLOTS]>>,
+}
+
+unsafe impl Sync for KeyCache {}
+
+static KEY_CACHE: KeyCache = KeyCache {
+    lock: AtomicBool::new(false),
+    initialized: AtomicBool::new(false),
+    entries: UnsafeCell::new(MaybeUninit::uninit()),
+};
+
+struct CacheGuard;
+
+impl CacheGuard {
+    fn lock() -> CacheGuard {
+        while KEY_CACHE
+            .lock
+            .compare_exchange_weak(false, true, Ordering::Acquire, Ordering::Relaxed)
+            .is_err()
+        {
+            core::hint::spin_loop();
+        }
+        CacheGuard
+    }
+
+    fn entries(&self) -> &mut [Entry; CACHE_SLOTS] {
+        unsafe {
+            if !KEY_CACHE.initialized.load(Ordering::Relaxed) {
+                ptr::write_bytes(KEY_CACHE.entries.get(), 0, 1);
+                KEY_CACHE.initialized.store(true, Ordering::Relaxed);
+            }
+            &mut *(*KEY_CACHE.entries.get()).as_mut_ptr()
+        }
+    }
+}
+
+impl Drop for CacheGuard {
+    fn drop(&mut self) {
+        KEY_CACHE.lock.store(false, Ordering::Release);
+    }
+}
+
+fn request_bytes(key_request: &sgx_key_request_t) -> &[u8] {
+    unsafe {
+        slice::from_raw_parts(
+            key_request as *const sgx_key_request_t as *const u8,
+            mem::size_of::<sgx_key_request_t>(),
+        )
+    }
+}
+
+/// FNV-1a over the request bytes; the key_id alone already spreads
+/// random-id requests across the table.
+fn slot_for(key_request: &sgx_key_request_t) -> usize {
+    let mut hash: u64 = 0xcbf2_9ce4_8422_2325;
+    for byte in request_bytes(key_request) {
+        hash ^= u64::from(*byte);
+        hash = hash.wrapping_mul(0x0000_0100_0000_01b3);
+    }
+    (hash as usize) & (CACHE_SLOTS - 1)
+}
+
+fn request_eq(a: &sgx_key_request_t, b: &sgx_key_request_t) -> bool {
+    request_bytes(a) == request_bytes(b)
+}
+
+fn wipe(entry: &mut Entry) {
+    unsafe {
+        ptr::write_volatile(entry as *mut Entry as *mut u8, 0);
+        for byte in entry.key.iter_mut() {
+            ptr::write_volatile(byte, 0);
+        }
+    }
+    entry.request = sgx_key_request_t::default();
+}
+
+///
+/// The rsgx_get_cached_key function returns the key for key_request,
+/// deriving it with EGETKEY only on the first request and serving
+/// repeats from an in-enclave table.
+///
+/// # Description
+///
+/// Lookup is by the full key request, so requests differing in policy,
+/// key_id, SVN, or any mask never share an entry. A miss derives via
+/// rsgx_get_key outside the table lock - a concurrent first request for
+/// the same key may derive twice, both derivations yield the same key -
+/// and inserts the result, evicting the home slot if the probe window
+/// is full. Callers whose key requests are unique per operation (for
+/// example a random key_id per record) should call rsgx_get_key
+/// directly; caching cannot help them.
+///
+/// # Requirements
+///
+/// Library: libsgx_tservice.a
+///
+/// # Errors
+///
+/// Same as rsgx_get_key.
+///
+pub fn rsgx_get_cached_key(key_request: &sgx_key_request_t) -> SgxResult<sgx_key_128bit_t> {
+    let home = slot_for(key_request);
+    {
+        let guard = CacheGuard::lock();
+        let entries = guard.entries();
+        for probe in 0..PROBE_WINDOW {
+            let entry = &entries[(home + probe) & (CACHE_SLOTS - 1)];
+            if entry.valid != 0 && request_eq(&entry.request, key_request) {
+                return Ok(entry.key);
+            }
+        }
+    }
+
+    let key = rsgx_get_key(key_request)?;
+
+    let guard = CacheGuard::lock();
+    let entries = guard.entries();
+    let mut victim = home;
+    for probe in 0..PROBE_WINDOW {
+        let index = (home + probe) & (CACHE_SLOTS - 1);
+        if entries[index].valid == 0 {
+            victim = index;
+            break;
+        }
+        if request_eq(&entries[index].request, key_request) {
+            // lost the race to a concurrent derivation of the same key
+            return Ok(key);
+        }
+    }
+    let entry = &mut entries[victim];
+    entry.request = *key_request;
+    entry.key = key;
+    entry.valid = 1;
+    Ok(key)
+}
+
+///
+/// The rsgx_invalidate_cached_key function removes and zeroes the cache
+/// entry for key_request, if present. The next request re-derives.
+///
+pub fn rsgx_invalidate_cached_key(key_request: &sgx_key_request_t) {
+    let home = slot_for(key_request);
+    let guard = CacheGuard::lock();
+    let entries = guard.entries();
+    for probe in 0..PROBE_WINDOW {
+        let index = (home + probe) & (CACHE_SLOTS - 1);
+        if entries[index].valid != 0 && request_eq(&entries[index].request, key_request) {
+            wipe(&mut entries[index]);
+            return;
+        }
+    }
+}
+
+///
+/// The rsgx_invalidate_cached_keys function zeroes every cached key.
+/// Call it whenever cached key material must provably be gone from
+/// enclave memory, e.g. before serializing enclave state.
+///
+pub fn rsgx_invalidate_cached_keys() {
+    let guard = CacheGuard::lock();
+    let entries = guard.entries();
+    for entry in entries.iter_mut() {
+        if entry.valid != 0 {
+            wipe(entry);
+        }
+    }
+}
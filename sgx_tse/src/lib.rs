@@ -26,5 +26,9 @@
 
 extern crate sgx_types;
 
+mod cache;
+mod report;
 mod se;
+pub use self::cache::*;
+pub use self::report::*;
 pub use self::se::*;
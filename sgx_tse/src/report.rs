@@ -0,0 +1,212 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License..
+
+//! # Cached report generation
+//!
+//! EREPORT is deterministic for a fixed (target, report_data) pair -
+//! the MAC is over exactly those inputs plus enclave identity - yet a
+//! peer-verification layer regenerates it for every connection in a
+//! reconnect storm, serializing the burst on the instruction. This
+//! module keeps recently generated reports in a small static table,
+//! keyed by the full target info and report data, and reuses an entry
+//! within a caller-chosen freshness window.
+//!
+//! There is no trusted wall clock inside an enclave, so the window is
+//! counted in caller-supplied ticks: the caller passes its own
+//! monotonic `now` (a coarse seconds counter is plenty) and the window
+//! in the same unit. The clock only bounds REUSE of an identical
+//! report - authenticity comes from the hardware MAC either way, and a
+//! host lying about time can at worst extend reuse of a report it
+//! could replay anyway - so an untrusted time source is acceptable
+//! here where it would not be for expiry enforcement.
+
+use core::cell::UnsafeCell;
+use core::mem::{self, MaybeUninit};
+use core::ptr;
+use core::slice;
+use core::sync::atomic::{AtomicBool, Ordering};
+use sgx_types::*;
+use crate::se::rsgx_create_report;
+
+/// Distinct (target, report_data) pairs cached; a mesh node talks to
+/// one or two quoting targets, so a handful of slots suffices.
+const REPORT_SLOTS: usize = 8;
+
+#[repr(C)]
+struct Entry {
+    valid: u8,
+    stamp: u64,
+    target_info: sgx_target_info_t,
+    report_data: sgx_report_data_t,
+    report: sgx_report_t,
+}
+
+struct ReportCache {
+    lock: AtomicBool,
+    initialized: AtomicBool,
+    entries: UnsafeCell<MaybeUninit<[Entry; REPORT_SLOTS]>>,
+}
+
+unsafe impl Sync for ReportCache {}
+
+static REPORT_CACHE: ReportCache = ReportCache {
+    lock: AtomicBool::new(false),
+    initialized: AtomicBool::new(false),
+    entries: UnsafeCell::new(MaybeUninit::uninit()),
+};
+
+struct CacheGuard;
+
+impl CacheGuard {
+    fn lock() -> CacheGuard {
+        while REPORT_CACHE
+            .lock
+            .compare_exchange_weak(false, true, Ordering::Acquire, Ordering::Relaxed)
+            .is_err()
+        {
+            core::hint::spin_loop();
+        }
+        CacheGuard
+    }
+
+    fn entries(&self) -> &mut [Entry; REPORT_SLOTS] {
+        unsafe {
+            if !REPORT_CACHE.initialized.load(Ordering::Relaxed) {
+                ptr::write_bytes(REPORT_CACHE.entries.get(), 0, 1);
+                REPORT_CACHE.initialized.store(true, Ordering::Relaxed);
+            }
+            &mut *(*REPORT_CACHE.entries.get()).as_mut_ptr()
+        }
+    }
+}
+
+impl Drop for CacheGuard {
+    fn drop(&mut self) {
+        REPORT_CACHE.lock.store(false, Ordering::Release);
+    }
+}
+
+fn bytes_of<T>(v: &T) -> &[u8] {
+    unsafe { slice::from_raw_parts(v as *const T as *const u8, mem::size_of::<T>()) }
+}
+
+fn entry_matches(
+    entry: &Entry,
+    target_info: &sgx_target_info_t,
+    report_data: &sgx_report_data_t,
+) -> bool {
+    bytes_of(&entry.target_info) == bytes_of(target_info)
+        && bytes_of(&entry.report_data) == bytes_of(report_data)
+}
+
+///
+/// The rsgx_create_report_cached function returns a report for the
+/// given target and report data, running EREPORT only when no report
+/// for the same inputs exists within the freshness window.
+///
+/// # Description
+///
+/// `now` is the caller's monotonic tick count and `window` the maximum
+/// age, in the same unit, at which a cached report is still served; an
+/// entry older than the window (or stamped later than `now`, as after
+/// a tick-source restart) is regenerated. `window` of zero bypasses
+/// the cache entirely.
+///
+/// Reuse only makes sense when `report_data` repeats across requests -
+/// e.g. a hash over a stable public key rather than a per-connection
+/// nonce. Callers binding fresh nonces into every report should call
+/// rsgx_create_report directly; caching cannot help them and the
+/// table would just churn.
+///
+/// # Requirements
+///
+/// Library: libsgx_tservice.a
+///
+/// # Errors
+///
+/// Same as rsgx_create_report.
+///
+pub fn rsgx_create_report_cached(
+    target_info: &sgx_target_info_t,
+    report_data: &sgx_report_data_t,
+    now: u64,
+    window: u64,
+) -> SgxResult<sgx_report_t> {
+    if window == 0 {
+        return rsgx_create_report(target_info, report_data);
+    }
+
+    {
+        let guard = CacheGuard::lock();
+        let entries = guard.entries();
+        for entry in entries.iter() {
+            if entry.valid != 0
+                && entry.stamp <= now
+                && now - entry.stamp <= window
+                && entry_matches(entry, target_info, report_data)
+            {
+                return Ok(entry.report);
+            }
+        }
+    }
+
+    // EREPORT outside the lock; concurrent first requests for the same
+    // inputs may generate twice, both results are equivalent
+    let report = rsgx_create_report(target_info, report_data)?;
+
+    let guard = CacheGuard::lock();
+    let entries = guard.entries();
+    let mut victim = 0;
+    let mut oldest = u64::MAX;
+    for (index, entry) in entries.iter().enumerate() {
+        if entry.valid == 0 {
+            victim = index;
+            break;
+        }
+        if entry_matches(entry, target_info, report_data) {
+            victim = index;
+            break;
+        }
+        if entry.stamp < oldest {
+            oldest = entry.stamp;
+            victim = index;
+        }
+    }
+    let entry = &mut entries[victim];
+    entry.target_info = *target_info;
+    entry.report_data = *report_data;
+    entry.report = report;
+    entry.stamp = now;
+    entry.valid = 1;
+    Ok(report)
+}
+
+///
+/// The rsgx_invalidate_cached_reports function drops every cached
+/// report; the next request per (target, report_data) pair runs
+/// EREPORT again. Call it when enclave identity-adjacent state changes
+/// mid-run (e.g. after a TCB recovery driven re-launch of the quoting
+/// flow).
+///
+pub fn rsgx_invalidate_cached_reports() {
+    let guard = CacheGuard::lock();
+    let entries = guard.entries();
+    for entry in entries.iter_mut() {
+        entry.valid = 0;
+        entry.stamp = 0;
+    }
+}
@@ -0,0 +1,607 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License..
+
+//! Incremental sealing for large evolving state.
+//!
+//! Re-sealing a multi-gigabyte state image on every checkpoint pays the
+//! full crypto and I/O cost even when almost nothing changed.
+//! [`SgxDeltaSealer`] makes checkpoint cost scale with the change rate
+//! instead: the state is split by content-defined chunking (a Gear
+//! rolling hash, so an insertion only reshapes the chunks around it,
+//! not everything downstream), each chunk is sealed as its own blob,
+//! and a checkpoint seals only the chunks whose content hash is not
+//! already covered by the previous checkpoint's manifest. Unchanged
+//! chunks keep their existing blobs; blobs no longer referenced are
+//! handed back for deletion.
+//!
+//! Each checkpoint derives one fresh seal key (an epoch); new chunks
+//! are encrypted under it with a per-epoch IV counter, and the epoch's
+//! key request rides inside the sealed manifest so restore can replay
+//! every live epoch through EGETKEY. The manifest - chunk order,
+//! lengths, content hashes and epoch keys - is itself sealed, so a host
+//! that tampers with blob bytes, swaps blobs or serves a stale mix
+//! fails MAC or hash checks on restore. The host still chooses *which*
+//! manifest to present; pair this with a monotonic counter if rollback
+//! to an older complete checkpoint must also be caught.
+//!
+//! [`SgxSealedData`]: crate::SgxSealedData
+
+use alloc::collections::BTreeMap;
+use alloc::vec::Vec;
+use core::mem;
+use core::ptr;
+use sgx_tcrypto::*;
+use sgx_trts::trts::*;
+use sgx_tse::*;
+use sgx_types::*;
+
+/* intel sgx sdk 2.4 */
+const KEY_POLICY_KSS: uint16_t =
+    SGX_KEYPOLICY_CONFIGID | SGX_KEYPOLICY_ISVFAMILYID | SGX_KEYPOLICY_ISVEXTPRODID;
+
+const MANIFEST_MAGIC: [u8; 4] = *b"SDLT";
+const MANIFEST_VERSION: u32 = 1;
+
+/// Content-defined chunking bounds: 16KB minimum, 64KB average (16 mask
+/// bits), 256KB maximum.
+const CHUNK_MIN: usize = 16 * 1024;
+const CHUNK_MAX: usize = 256 * 1024;
+const CHUNK_MASK: u64 = (1 << 16) - 1;
+
+/// Gear table for the rolling hash, fixed at compile time from a
+/// splitmix64 stream. The hash gates chunk boundaries, not secrets, so
+/// a public table is fine.
+const GEAR: [u64; 256] = gear_table();
+
+const fn gear_table() -> [u64; 256] {
+    let mut table = [0_u64; 256];
+    let mut state: u64 = 0x9e37_79b9_7f4a_7c15;
+    let mut i = 0;
+    while i < 256 {
+        state = state.wrapping_add(0x9e37_79b9_7f4a_7c15);
+        let mut z = state;
+        z = (z ^ (z >> 30)).wrapping_mul(0xbf58_476d_1ce4_e5b9);
+        z = (z ^ (z >> 27)).wrapping_mul(0x94d0_49bb_1331_11eb);
+        table[i] = z ^ (z >> 31);
+        i += 1;
+    }
+    table
+}
+
+/// Split `data` into content-defined chunks, returned as (offset, len).
+fn cdc_chunks(data: &[u8]) -> Vec<(usize, usize)> {
+    let mut chunks: Vec<(usize, usize)> = Vec::new();
+    let mut start = 0_usize;
+    while start < data.len() {
+        let remaining = data.len() - start;
+        if remaining <= CHUNK_MIN {
+            chunks.push((start, remaining));
+            break;
+        }
+        let limit = if remaining < CHUNK_MAX { remaining } else { CHUNK_MAX };
+        let mut hash = 0_u64;
+        let mut cut = limit;
+        for i in CHUNK_MIN..limit {
+            hash = (hash << 1).wrapping_add(GEAR[data[start + i] as usize]);
+            if hash & CHUNK_MASK == 0 {
+                cut = i + 1;
+                break;
+            }
+        }
+        chunks.push((start, cut));
+        start += cut;
+    }
+    chunks
+}
+
+/// Identifies one sealed chunk blob in the caller's store: the
+/// checkpoint epoch that sealed it and its IV counter within that
+/// epoch. Together they name the blob and fix its decryption IV.
+#[derive(Clone, Copy, Debug, PartialEq, Eq, PartialOrd, Ord, Default)]
+pub struct SgxChunkId {
+    pub epoch: u64,
+    pub index: u64,
+}
+
+/// One entry of the manifest: where the chunk's blob lives, how long
+/// the plaintext is and what it hashes to.
+#[derive(Clone, Copy)]
+struct ChunkRef {
+    id: SgxChunkId,
+    plain_len: u32,
+    hash: sgx_sha256_hash_t,
+}
+
+struct EpochKey {
+    epoch: u64,
+    next_iv: u64,
+    key_request: sgx_key_request_t,
+}
+
+/// The output of one checkpoint: the new sealed manifest, the blobs to
+/// write and the blobs whose content is no longer referenced.
+pub struct SgxDeltaCheckpoint {
+    /// Sealed manifest; replaces the previous one atomically from the
+    /// caller's point of view.
+    pub manifest: Vec<u8>,
+    /// Newly sealed chunk blobs to add to the store.
+    pub new_blobs: Vec<(SgxChunkId, Vec<u8>)>,
+    /// Blobs from earlier checkpoints that nothing references anymore.
+    pub released: Vec<SgxChunkId>,
+}
+
+/// Diff-aware checkpoint writer. Holds the previous checkpoint's chunk
+/// map between checkpoints so only changed content is re-sealed.
+pub struct SgxDeltaSealer {
+    next_epoch: u64,
+    epochs: Vec<EpochKey>,
+    chunks: Vec<ChunkRef>,
+}
+
+impl SgxDeltaSealer {
+    ///
+    /// Start with no previous checkpoint; the first checkpoint seals
+    /// every chunk.
+    ///
+    pub fn new() -> Self {
+        SgxDeltaSealer {
+            next_epoch: 0,
+            epochs: Vec::new(),
+            chunks: Vec::new(),
+        }
+    }
+
+    ///
+    /// Resume from a sealed manifest produced by an earlier
+    /// [`checkpoint`], so the first checkpoint after restart is already
+    /// incremental.
+    ///
+    /// [`checkpoint`]: SgxDeltaSealer::checkpoint
+    ///
+    pub fn resume(manifest: &[u8]) -> SgxResult<Self> {
+        let (next_epoch, epochs, chunks) = open_manifest(manifest)?;
+        Ok(SgxDeltaSealer { next_epoch, epochs, chunks })
+    }
+
+    ///
+    /// Checkpoint `state`: chunk it, seal the chunks not covered by the
+    /// previous checkpoint under a fresh epoch key, and return the new
+    /// sealed manifest plus the blob additions and removals. Cost is
+    /// proportional to the changed content, not the state size (the
+    /// chunking and hashing pass over everything is the unavoidable
+    /// floor).
+    ///
+    /// # Errors
+    ///
+    /// **SGX_ERROR_INVALID_PARAMETER**
+    ///
+    /// The state is empty or not within the enclave.
+    ///
+    pub fn checkpoint(&mut self, state: &[u8]) -> SgxResult<SgxDeltaCheckpoint> {
+        if state.is_empty() || !rsgx_slice_is_within_enclave(state) {
+            return Err(sgx_status_t::SGX_ERROR_INVALID_PARAMETER);
+        }
+
+        let mut previous: BTreeMap<sgx_sha256_hash_t, ChunkRef> = BTreeMap::new();
+        for chunk in &self.chunks {
+            previous.insert(chunk.hash, *chunk);
+        }
+
+        let mut epoch = EpochKey {
+            epoch: self.next_epoch,
+            next_iv: 0,
+            key_request: new_key_request()?,
+        };
+        let mut seal_key = derive_key(&epoch.key_request, true)?;
+
+        let mut new_chunks: Vec<ChunkRef> = Vec::new();
+        let mut new_blobs: Vec<(SgxChunkId, Vec<u8>)> = Vec::new();
+        let mut reused: BTreeMap<SgxChunkId, ()> = BTreeMap::new();
+        let mut sealed_this_epoch: BTreeMap<sgx_sha256_hash_t, ChunkRef> = BTreeMap::new();
+
+        for (offset, len) in cdc_chunks(state) {
+            let plain = &state[offset..offset + len];
+            let hash = rsgx_sha256_slice(plain).map_err(|ret| {
+                seal_key.key = sgx_key_128bit_t::default();
+                ret
+            })?;
+
+            if let Some(chunk) = previous.get(&hash).or_else(|| sealed_this_epoch.get(&hash)) {
+                reused.insert(chunk.id, ());
+                new_chunks.push(ChunkRef { id: chunk.id, plain_len: len as u32, hash });
+                continue;
+            }
+
+            let id = SgxChunkId { epoch: epoch.epoch, index: epoch.next_iv };
+            let payload_iv = chunk_iv(epoch.next_iv);
+            epoch.next_iv += 1;
+
+            let mut blob = vec![0_u8; SGX_SEAL_TAG_SIZE + len];
+            let (tag_slice, encrypt_slice) = blob.split_at_mut(SGX_SEAL_TAG_SIZE);
+            let mut payload_tag = [0_u8; SGX_SEAL_TAG_SIZE];
+            let error = rsgx_rijndael128GCM_encrypt(
+                &seal_key.key,
+                plain,
+                &payload_iv,
+                &[],
+                encrypt_slice,
+                &mut payload_tag,
+            );
+            if error.is_err() {
+                seal_key.key = sgx_key_128bit_t::default();
+                return Err(error.unwrap_err());
+            }
+            tag_slice.copy_from_slice(&payload_tag);
+
+            let chunk = ChunkRef { id, plain_len: len as u32, hash };
+            sealed_this_epoch.insert(hash, chunk);
+            new_chunks.push(chunk);
+            new_blobs.push((id, blob));
+        }
+        seal_key.key = sgx_key_128bit_t::default();
+
+        // Blobs of the previous checkpoint that nothing references now.
+        let mut released: Vec<SgxChunkId> = Vec::new();
+        let mut seen: BTreeMap<SgxChunkId, ()> = BTreeMap::new();
+        for chunk in &self.chunks {
+            if !reused.contains_key(&chunk.id) && seen.insert(chunk.id, ()).is_none() {
+                released.push(chunk.id);
+            }
+        }
+
+        // Keep only epochs that still back at least one chunk, plus the
+        // new epoch if it sealed anything.
+        let mut epochs: Vec<EpochKey> = Vec::new();
+        for old in self.epochs.drain(..) {
+            if new_chunks.iter().any(|c| c.id.epoch == old.epoch) {
+                epochs.push(old);
+            }
+        }
+        if epoch.next_iv > 0 {
+            epochs.push(epoch);
+        }
+
+        self.next_epoch += 1;
+        self.epochs = epochs;
+        self.chunks = new_chunks;
+
+        Ok(SgxDeltaCheckpoint {
+            manifest: self.seal_manifest()?,
+            new_blobs,
+            released,
+        })
+    }
+
+    ///
+    /// Get the number of chunks in the last checkpoint.
+    ///
+    pub fn chunk_count(&self) -> usize {
+        self.chunks.len()
+    }
+
+    fn seal_manifest(&self) -> SgxResult<Vec<u8>> {
+        let key_request_size = mem::size_of::<sgx_key_request_t>();
+
+        let mut plain: Vec<u8> = Vec::new();
+        plain.extend_from_slice(&self.next_epoch.to_le_bytes());
+        plain.extend_from_slice(&(self.epochs.len() as u32).to_le_bytes());
+        for epoch in &self.epochs {
+            plain.extend_from_slice(&epoch.epoch.to_le_bytes());
+            plain.extend_from_slice(&epoch.next_iv.to_le_bytes());
+            let at = plain.len();
+            plain.resize(at + key_request_size, 0);
+            unsafe {
+                ptr::copy_nonoverlapping(
+                    &epoch.key_request as *const _ as *const u8,
+                    plain.as_mut_ptr().add(at),
+                    key_request_size,
+                );
+            }
+        }
+        plain.extend_from_slice(&(self.chunks.len() as u64).to_le_bytes());
+        for chunk in &self.chunks {
+            plain.extend_from_slice(&chunk.id.epoch.to_le_bytes());
+            plain.extend_from_slice(&chunk.id.index.to_le_bytes());
+            plain.extend_from_slice(&chunk.plain_len.to_le_bytes());
+            plain.extend_from_slice(&chunk.hash);
+        }
+
+        // The manifest gets its own fresh key, so a zero IV is safe.
+        let key_request = new_key_request()?;
+        let mut seal_key = derive_key(&key_request, true)?;
+
+        let mut bytes: Vec<u8> =
+            Vec::with_capacity(8 + key_request_size + SGX_SEAL_TAG_SIZE + plain.len());
+        bytes.extend_from_slice(&MANIFEST_MAGIC);
+        bytes.extend_from_slice(&MANIFEST_VERSION.to_le_bytes());
+        let at = bytes.len();
+        bytes.resize(at + key_request_size, 0);
+        unsafe {
+            ptr::copy_nonoverlapping(
+                &key_request as *const _ as *const u8,
+                bytes.as_mut_ptr().add(at),
+                key_request_size,
+            );
+        }
+        bytes.resize(at + key_request_size + SGX_SEAL_TAG_SIZE + plain.len(), 0);
+
+        let payload_iv = [0_u8; SGX_SEAL_IV_SIZE];
+        let (tag_slice, encrypt_slice) =
+            bytes[at + key_request_size..].split_at_mut(SGX_SEAL_TAG_SIZE);
+        let mut payload_tag = [0_u8; SGX_SEAL_TAG_SIZE];
+        let error = rsgx_rijndael128GCM_encrypt(
+            &seal_key.key,
+            &plain,
+            &payload_iv,
+            &[],
+            encrypt_slice,
+            &mut payload_tag,
+        );
+        seal_key.key = sgx_key_128bit_t::default();
+        error?;
+        tag_slice.copy_from_slice(&payload_tag);
+
+        Ok(bytes)
+    }
+}
+
+impl Default for SgxDeltaSealer {
+    fn default() -> Self {
+        SgxDeltaSealer::new()
+    }
+}
+
+/// Restore side: opens a sealed manifest, lists the blobs to fetch and
+/// unseals them back into state chunks.
+pub struct SgxDeltaRestorer {
+    epochs: Vec<EpochKey>,
+    chunks: Vec<ChunkRef>,
+}
+
+impl SgxDeltaRestorer {
+    ///
+    /// Open a sealed manifest. A policy failure (SGX_ERROR_INVALID_CPUSVN,
+    /// SGX_ERROR_INVALID_ISVSVN) or tampered manifest fails here before
+    /// any blob is read.
+    ///
+    pub fn new(manifest: &[u8]) -> SgxResult<Self> {
+        let (_, epochs, chunks) = open_manifest(manifest)?;
+        Ok(SgxDeltaRestorer { epochs, chunks })
+    }
+
+    ///
+    /// The blobs making up the state, in state order. Fetch each id's
+    /// blob and feed it to [`unseal_chunk`]; the same id may appear more
+    /// than once when content repeats.
+    ///
+    /// [`unseal_chunk`]: SgxDeltaRestorer::unseal_chunk
+    ///
+    pub fn chunk_ids(&self) -> Vec<SgxChunkId> {
+        self.chunks.iter().map(|c| c.id).collect()
+    }
+
+    ///
+    /// Get the total plaintext size of the state.
+    ///
+    pub fn state_len(&self) -> usize {
+        self.chunks.iter().map(|c| c.plain_len as usize).sum()
+    }
+
+    ///
+    /// Unseal the chunk at position `at` (in [`chunk_ids`] order) from
+    /// its blob. The ciphertext is copied into enclave memory before
+    /// any crypto; a swapped, stale or corrupted blob fails the MAC or
+    /// the manifest hash check.
+    ///
+    /// [`chunk_ids`]: SgxDeltaRestorer::chunk_ids
+    ///
+    pub fn unseal_chunk(&self, at: usize, blob: &[u8]) -> SgxResult<Vec<u8>> {
+        let chunk = *self.chunks.get(at).ok_or(sgx_status_t::SGX_ERROR_INVALID_PARAMETER)?;
+        if blob.len() != SGX_SEAL_TAG_SIZE + chunk.plain_len as usize {
+            return Err(sgx_status_t::SGX_ERROR_MAC_MISMATCH);
+        }
+        let epoch = self
+            .epochs
+            .iter()
+            .find(|e| e.epoch == chunk.id.epoch)
+            .ok_or(sgx_status_t::SGX_ERROR_INVALID_PARAMETER)?;
+
+        let mut payload_tag = [0_u8; SGX_SEAL_TAG_SIZE];
+        payload_tag.copy_from_slice(&blob[..SGX_SEAL_TAG_SIZE]);
+        let encrypt = blob[SGX_SEAL_TAG_SIZE..].to_vec();
+
+        //
+        // see unseal_data: fence between the header sanity checks above
+        // and the crypto code, so a mispredicted check cannot feed the
+        // crypto unintended data
+        //
+        rsgx_lfence();
+
+        let mut seal_key = derive_key(&epoch.key_request, false)?;
+        let payload_iv = chunk_iv(chunk.id.index);
+        let mut plain = vec![0_u8; chunk.plain_len as usize];
+        let error = rsgx_rijndael128GCM_decrypt(
+            &seal_key.key,
+            &encrypt,
+            &payload_iv,
+            &[],
+            &payload_tag,
+            &mut plain,
+        );
+        seal_key.key = sgx_key_128bit_t::default();
+        error?;
+
+        let hash = rsgx_sha256_slice(&plain)?;
+        if hash != chunk.hash {
+            return Err(sgx_status_t::SGX_ERROR_MAC_MISMATCH);
+        }
+        Ok(plain)
+    }
+}
+
+fn chunk_iv(index: u64) -> [u8; SGX_SEAL_IV_SIZE] {
+    // One key per epoch; the per-epoch counter makes each IV unique.
+    let mut iv = [0_u8; SGX_SEAL_IV_SIZE];
+    iv[..8].copy_from_slice(&index.to_le_bytes());
+    iv
+}
+
+fn new_key_request() -> SgxResult<sgx_key_request_t> {
+    /* intel sgx sdk 1.8 */
+    let attribute_mask = sgx_attributes_t {
+        flags: TSEAL_DEFAULT_FLAGSMASK,
+        xfrm: 0,
+    };
+    /* intel sgx sdk 2.4 */
+    let mut key_policy = SGX_KEYPOLICY_MRSIGNER;
+    let mut report = rsgx_self_report();
+    if (report.body.attributes.flags & SGX_FLAGS_KSS) != 0 {
+        key_policy = SGX_KEYPOLICY_MRSIGNER | KEY_POLICY_KSS;
+    }
+
+    let mut key_id = sgx_key_id_t::default();
+    let error = rsgx_read_rand(&mut key_id.id);
+    if error.is_err() {
+        report = sgx_report_t::default();
+        key_id = sgx_key_id_t::default();
+        return Err(error.unwrap_err());
+    }
+
+    Ok(sgx_key_request_t {
+        key_name: SGX_KEYSELECT_SEAL,
+        key_policy,
+        isv_svn: report.body.isv_svn,
+        reserved1: 0_u16,
+        cpu_svn: report.body.cpu_svn,
+        attribute_mask,
+        key_id,
+        misc_mask: TSEAL_DEFAULT_MISCMASK,
+        config_svn: report.body.config_svn,
+        reserved2: [0_u8; SGX_KEY_REQUEST_RESERVED2_BYTES],
+    })
+}
+
+fn derive_key(key_request: &sgx_key_request_t, sealing: bool) -> SgxResult<sgx_align_key_128bit_t> {
+    rsgx_get_align_key(key_request).map_err(|ret| {
+        if sealing {
+            if ret != sgx_status_t::SGX_ERROR_OUT_OF_MEMORY {
+                sgx_status_t::SGX_ERROR_UNEXPECTED
+            } else {
+                ret
+            }
+        } else if (ret == sgx_status_t::SGX_ERROR_INVALID_CPUSVN)
+            || (ret == sgx_status_t::SGX_ERROR_INVALID_ISVSVN)
+            || (ret == sgx_status_t::SGX_ERROR_OUT_OF_MEMORY)
+        {
+            ret
+        } else {
+            sgx_status_t::SGX_ERROR_MAC_MISMATCH
+        }
+    })
+}
+
+fn open_manifest(manifest: &[u8]) -> SgxResult<(u64, Vec<EpochKey>, Vec<ChunkRef>)> {
+    let key_request_size = mem::size_of::<sgx_key_request_t>();
+    if manifest.len() < 8 + key_request_size + SGX_SEAL_TAG_SIZE {
+        return Err(sgx_status_t::SGX_ERROR_INVALID_PARAMETER);
+    }
+    if manifest[..4] != MANIFEST_MAGIC {
+        return Err(sgx_status_t::SGX_ERROR_INVALID_PARAMETER);
+    }
+    let mut raw = [0_u8; 4];
+    raw.copy_from_slice(&manifest[4..8]);
+    if u32::from_le_bytes(raw) != MANIFEST_VERSION {
+        return Err(sgx_status_t::SGX_ERROR_INVALID_PARAMETER);
+    }
+
+    let key_request = unsafe {
+        ptr::read_unaligned(manifest.as_ptr().add(8) as *const sgx_key_request_t)
+    };
+    let mut payload_tag = [0_u8; SGX_SEAL_TAG_SIZE];
+    payload_tag
+        .copy_from_slice(&manifest[8 + key_request_size..8 + key_request_size + SGX_SEAL_TAG_SIZE]);
+    let encrypt = manifest[8 + key_request_size + SGX_SEAL_TAG_SIZE..].to_vec();
+
+    rsgx_lfence();
+
+    let mut seal_key = derive_key(&key_request, false)?;
+    let payload_iv = [0_u8; SGX_SEAL_IV_SIZE];
+    let mut plain = vec![0_u8; encrypt.len()];
+    let error = rsgx_rijndael128GCM_decrypt(
+        &seal_key.key,
+        &encrypt,
+        &payload_iv,
+        &[],
+        &payload_tag,
+        &mut plain,
+    );
+    seal_key.key = sgx_key_128bit_t::default();
+    error?;
+
+    let mut offset = 0_usize;
+    let next_epoch = read_u64(&plain, &mut offset)?;
+    let epoch_count = read_u32(&plain, &mut offset)? as usize;
+    let mut epochs: Vec<EpochKey> = Vec::with_capacity(epoch_count);
+    for _ in 0..epoch_count {
+        let epoch = read_u64(&plain, &mut offset)?;
+        let next_iv = read_u64(&plain, &mut offset)?;
+        let raw = read_slice(&plain, &mut offset, key_request_size)?;
+        let key_request =
+            unsafe { ptr::read_unaligned(raw.as_ptr() as *const sgx_key_request_t) };
+        epochs.push(EpochKey { epoch, next_iv, key_request });
+    }
+
+    let chunk_count = read_u64(&plain, &mut offset)? as usize;
+    let mut chunks: Vec<ChunkRef> = Vec::with_capacity(chunk_count);
+    for _ in 0..chunk_count {
+        let epoch = read_u64(&plain, &mut offset)?;
+        let index = read_u64(&plain, &mut offset)?;
+        let plain_len = read_u32(&plain, &mut offset)?;
+        let mut hash = sgx_sha256_hash_t::default();
+        hash.copy_from_slice(read_slice(&plain, &mut offset, hash.len())?);
+        chunks.push(ChunkRef {
+            id: SgxChunkId { epoch, index },
+            plain_len,
+            hash,
+        });
+    }
+
+    Ok((next_epoch, epochs, chunks))
+}
+
+fn read_u32(bytes: &[u8], offset: &mut usize) -> SgxResult<u32> {
+    let slice = read_slice(bytes, offset, mem::size_of::<u32>())?;
+    let mut raw = [0_u8; 4];
+    raw.copy_from_slice(slice);
+    Ok(u32::from_le_bytes(raw))
+}
+
+fn read_u64(bytes: &[u8], offset: &mut usize) -> SgxResult<u64> {
+    let slice = read_slice(bytes, offset, mem::size_of::<u64>())?;
+    let mut raw = [0_u8; 8];
+    raw.copy_from_slice(slice);
+    Ok(u64::from_le_bytes(raw))
+}
+
+fn read_slice<'a>(bytes: &'a [u8], offset: &mut usize, len: usize) -> SgxResult<&'a [u8]> {
+    if len > bytes.len() || *offset > bytes.len() - len {
+        return Err(sgx_status_t::SGX_ERROR_INVALID_PARAMETER);
+    }
+    let slice = &bytes[*offset..*offset + len];
+    *offset += len;
+    Ok(slice)
+}
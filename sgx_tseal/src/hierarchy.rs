@@ -0,0 +1,191 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License..
+
+//! Hierarchical sealing keys for multi-tenant enclaves.
+//!
+//! Deriving one sealing key per tenant through `EGETKEY` serializes on
+//! the hardware: every key request is an enclave-mode instruction with
+//! microcode-derivation cost, and a multi-tenant service pays it per
+//! tenant per operation. [`SgxSealKeyHierarchy`] requests ONE master
+//! seal key per policy and derives per-tenant subkeys in software with
+//! HKDF-SHA256 - thousands of logical keys for a single hardware key
+//! operation, at the price of two HMAC invocations each.
+//!
+//! Security shape: every subkey is bound to the master's `EGETKEY`
+//! inputs (key policy, SVNs, the master `key_id`), so subkeys carry
+//! exactly the sealing policy of the master and nothing less. Rebuild
+//! the same hierarchy later from the same policy and master `key_id` -
+//! persist that `key_id` next to the sealed data, as `seal_data` does
+//! with its per-blob key ids. Different tenant labels yield
+//! independent keys; a tenant learning its own subkey learns nothing
+//! about siblings or the master.
+
+use core::mem;
+use sgx_tcrypto::SgxHmac256Context;
+use sgx_trts::memeq::ConsttimeMemEq;
+use sgx_tse::{rsgx_get_align_key, rsgx_self_report};
+use sgx_types::*;
+
+/// HKDF-Extract salt; versioned so a future derivation change cannot
+/// collide with existing hierarchies.
+const HIERARCHY_SALT: &[u8] = b"sgx_tseal-key-hierarchy-v1";
+
+/// A master seal key requested once, with per-tenant subkeys derived
+/// in-enclave.
+///
+/// The raw master key is erased as soon as the HKDF pseudorandom key
+/// is extracted from it; the PRK is erased on drop.
+pub struct SgxSealKeyHierarchy {
+    /// The master `EGETKEY` request, kept so callers can persist the
+    /// `key_id`/policy needed to rebuild the hierarchy at unseal time.
+    key_request: sgx_key_request_t,
+    /// HKDF-Extract(salt, master key); all subkeys expand from this.
+    prk: sgx_hmac_256bit_tag_t,
+}
+
+impl SgxSealKeyHierarchy {
+    /// Builds a hierarchy under the default sealing policy, mirroring
+    /// `seal_data`: MRSIGNER, default attribute and misc masks, KSS
+    /// policy bits when the enclave runs with KSS.
+    ///
+    /// `key_id` names the master key; reuse the same id to rebuild the
+    /// same hierarchy.
+    pub fn new(key_id: &sgx_key_id_t) -> SgxResult<SgxSealKeyHierarchy> {
+        let attribute_mask = sgx_attributes_t {
+            flags: TSEAL_DEFAULT_FLAGSMASK,
+            xfrm: 0,
+        };
+        let mut key_policy = SGX_KEYPOLICY_MRSIGNER;
+        let report = rsgx_self_report();
+        if (report.body.attributes.flags & SGX_FLAGS_KSS) != 0 {
+            key_policy = SGX_KEYPOLICY_MRSIGNER | KEY_POLICY_KSS;
+        }
+
+        Self::new_ex(key_policy, attribute_mask, TSEAL_DEFAULT_MISCMASK, key_id)
+    }
+
+    /// Builds a hierarchy with an explicit policy, validated exactly
+    /// as `seal_data_ex` validates its key request.
+    pub fn new_ex(
+        key_policy: u16,
+        attribute_mask: sgx_attributes_t,
+        misc_mask: sgx_misc_select_t,
+        key_id: &sgx_key_id_t,
+    ) -> SgxResult<SgxSealKeyHierarchy> {
+        if (key_policy
+            & (!(SGX_KEYPOLICY_MRENCLAVE
+                | SGX_KEYPOLICY_MRSIGNER
+                | KEY_POLICY_KSS
+                | SGX_KEYPOLICY_NOISVPRODID))
+            != 0)
+            || ((key_policy & (SGX_KEYPOLICY_MRENCLAVE | SGX_KEYPOLICY_MRSIGNER)) == 0)
+        {
+            return Err(sgx_status_t::SGX_ERROR_INVALID_PARAMETER);
+        }
+        if ((attribute_mask.flags & SGX_FLAGS_INITTED) == 0)
+            || ((attribute_mask.flags & SGX_FLAGS_DEBUG) == 0)
+        {
+            return Err(sgx_status_t::SGX_ERROR_INVALID_PARAMETER);
+        }
+
+        let mut report = rsgx_self_report();
+        let key_request = sgx_key_request_t {
+            key_name: SGX_KEYSELECT_SEAL,
+            key_policy,
+            isv_svn: report.body.isv_svn,
+            reserved1: 0_u16,
+            cpu_svn: report.body.cpu_svn,
+            attribute_mask,
+            key_id: *key_id,
+            misc_mask,
+            config_svn: report.body.config_svn,
+            reserved2: [0_u8; SGX_KEY_REQUEST_RESERVED2_BYTES],
+        };
+        report = sgx_report_t::default();
+
+        // the one hardware key operation of this hierarchy
+        let mut master = rsgx_get_align_key(&key_request).map_err(|ret| {
+            if ret != sgx_status_t::SGX_ERROR_OUT_OF_MEMORY {
+                sgx_status_t::SGX_ERROR_UNEXPECTED
+            } else {
+                ret
+            }
+        })?;
+
+        // HKDF-Extract; the raw master key is not needed afterwards
+        let mut ctx = SgxHmac256Context::new(HIERARCHY_SALT);
+        ctx.update(&master.key);
+        let prk = ctx.finish();
+        master.key = sgx_key_128bit_t::default();
+
+        Ok(SgxSealKeyHierarchy { key_request, prk })
+    }
+
+    /// Rebuilds a hierarchy from a persisted master key request (for
+    /// example one stored alongside sealed blobs at seal time).
+    pub fn from_key_request(key_request: &sgx_key_request_t) -> SgxResult<SgxSealKeyHierarchy> {
+        Self::new_ex(
+            key_request.key_policy,
+            key_request.attribute_mask,
+            key_request.misc_mask,
+            &key_request.key_id,
+        )
+    }
+
+    /// The master key request; persist its `key_id` (public, like the
+    /// per-blob key ids in sealed data) to rebuild the hierarchy.
+    pub fn get_key_request(&self) -> &sgx_key_request_t {
+        &self.key_request
+    }
+
+    /// Derives the 128-bit subkey for `tenant`, an application-chosen
+    /// label such as a tenant id. Two HMAC compressions, no `EGETKEY`.
+    ///
+    /// HKDF-Expand with `info = "tenant" || label`, truncated to the
+    /// AES key size; distinct labels give independent keys.
+    pub fn derive_key(&self, tenant: &[u8]) -> SgxResult<sgx_align_key_128bit_t> {
+        if tenant.is_empty() {
+            return Err(sgx_status_t::SGX_ERROR_INVALID_PARAMETER);
+        }
+
+        let mut ctx = SgxHmac256Context::new(&self.prk);
+        ctx.update(b"tenant");
+        ctx.update(tenant);
+        ctx.update(&[0x01_u8]);
+        let mut okm = ctx.finish();
+
+        let mut align_key = sgx_align_key_128bit_t::default();
+        align_key.key.copy_from_slice(&okm[..mem::size_of::<sgx_key_128bit_t>()]);
+        okm = sgx_hmac_256bit_tag_t::default();
+        Ok(align_key)
+    }
+
+    /// Constant-time check that `key` is the subkey for `tenant`;
+    /// avoids key material in branch conditions at call sites.
+    pub fn verify_key(&self, tenant: &[u8], key: &sgx_key_128bit_t) -> SgxResult<bool> {
+        let mut derived = self.derive_key(tenant)?;
+        let eq = derived.key.consttime_memeq(key);
+        derived.key = sgx_key_128bit_t::default();
+        Ok(eq)
+    }
+}
+
+impl Drop for SgxSealKeyHierarchy {
+    fn drop(&mut self) {
+        self.prk = sgx_hmac_256bit_tag_t::default();
+    }
+}
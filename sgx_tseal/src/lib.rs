@@ -90,4 +90,16 @@ pub use self::seal::{SgxSealedData, SgxUnsealedData};
 mod aad;
 pub use self::aad::SgxMacAadata;
 
+mod batch;
+pub use self::batch::{SgxBatchRecord, SgxSealedBatch, SgxUnsealedRecord};
+
+mod stream;
+pub use self::stream::{SgxSealStream, SgxUnsealStream, SGX_SEAL_STREAM_CHUNK_OVERHEAD};
+
+mod hierarchy;
+pub use self::hierarchy::SgxSealKeyHierarchy;
+
+mod delta;
+pub use self::delta::{SgxChunkId, SgxDeltaCheckpoint, SgxDeltaRestorer, SgxDeltaSealer};
+
 mod internal;
@@ -0,0 +1,476 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License..
+
+//! Streaming sealing for large state snapshots.
+//!
+//! [`SgxSealedData`] takes the whole plaintext at once, so sealing a
+//! multi-gigabyte snapshot needs the snapshot and its sealed image in
+//! memory at the same time. [`SgxSealStream`] seals incrementally: one
+//! key derivation up front (as [`SgxSealedBatch`] does), then each
+//! chunk is encrypted under that key with the chunk's stream position
+//! as its IV and handed back to the caller to write out - through the
+//! protected FS, a plain file, whatever the snapshot lives in. Peak
+//! memory is one chunk, not the snapshot.
+//!
+//! The position-as-IV binding means a reordered, duplicated or dropped
+//! chunk fails its MAC check on restore, and [`SgxSealStream::finish`]
+//! seals the chunk count into a terminator so a truncated stream is
+//! detected rather than silently restored short. The header replays
+//! the one key request through EGETKEY on restore, binding the stream
+//! to the enclave exactly as single-record sealed data is bound.
+//!
+//! [`SgxSealedData`]: crate::SgxSealedData
+//! [`SgxSealedBatch`]: crate::SgxSealedBatch
+
+use crate::batch::SgxUnsealedRecord;
+use alloc::vec::Vec;
+use core::mem;
+use core::ptr;
+use sgx_tcrypto::*;
+use sgx_trts::trts::*;
+use sgx_tse::*;
+use sgx_types::*;
+
+/* intel sgx sdk 2.4 */
+const KEY_POLICY_KSS: uint16_t =
+    SGX_KEYPOLICY_CONFIGID | SGX_KEYPOLICY_ISVFAMILYID | SGX_KEYPOLICY_ISVEXTPRODID;
+
+const STREAM_MAGIC: [u8; 4] = *b"SSTR";
+const STREAM_VERSION: u32 = 1;
+
+/// IV domain separators: data chunks and the terminator never share an
+/// IV even at the same stream position.
+const IV_DOMAIN_CHUNK: u8 = 0;
+const IV_DOMAIN_FINAL: u8 = 1;
+
+/// Framing bytes added to each chunk on top of the ciphertext:
+/// two u32 lengths and the GCM tag.
+pub const SGX_SEAL_STREAM_CHUNK_OVERHEAD: usize = 2 * mem::size_of::<u32>() + SGX_SEAL_TAG_SIZE;
+
+fn chunk_iv(index: u64, domain: u8) -> [u8; SGX_SEAL_IV_SIZE] {
+    // One key covers the whole stream, so the stream position makes
+    // each IV unique; the domain byte separates data chunks from the
+    // terminator.
+    let mut iv = [0_u8; SGX_SEAL_IV_SIZE];
+    iv[..8].copy_from_slice(&index.to_le_bytes());
+    iv[8] = domain;
+    iv
+}
+
+fn read_u32(bytes: &[u8], offset: &mut usize) -> SgxResult<u32> {
+    let slice = read_slice(bytes, offset, mem::size_of::<u32>())?;
+    let mut raw = [0_u8; 4];
+    raw.copy_from_slice(slice);
+    Ok(u32::from_le_bytes(raw))
+}
+
+fn read_slice<'a>(bytes: &'a [u8], offset: &mut usize, len: usize) -> SgxResult<&'a [u8]> {
+    if len > bytes.len() || *offset > bytes.len() - len {
+        return Err(sgx_status_t::SGX_ERROR_INVALID_PARAMETER);
+    }
+    let slice = &bytes[*offset..*offset + len];
+    *offset += len;
+    Ok(slice)
+}
+
+/// Writer half of a sealed stream: derives the seal key once, then
+/// seals chunks in order until [`finish`] emits the terminator.
+///
+/// [`finish`]: SgxSealStream::finish
+pub struct SgxSealStream {
+    key_request: sgx_key_request_t,
+    seal_key: sgx_align_key_128bit_t,
+    next_index: u64,
+}
+
+impl SgxSealStream {
+    ///
+    /// Start a sealed stream with the same default policy as
+    /// [`SgxSealedData::seal_data`].
+    ///
+    /// [`SgxSealedData::seal_data`]: crate::SgxSealedData::seal_data
+    ///
+    pub fn new() -> SgxResult<Self> {
+        /* intel sgx sdk 1.8 */
+        let attribute_mask = sgx_attributes_t {
+            flags: TSEAL_DEFAULT_FLAGSMASK,
+            xfrm: 0,
+        };
+        /* intel sgx sdk 2.4 */
+        let mut key_policy = SGX_KEYPOLICY_MRSIGNER;
+        let report = rsgx_self_report();
+        if (report.body.attributes.flags & SGX_FLAGS_KSS) != 0 {
+            key_policy = SGX_KEYPOLICY_MRSIGNER | KEY_POLICY_KSS;
+        }
+
+        Self::new_ex(key_policy, attribute_mask, TSEAL_DEFAULT_MISCMASK)
+    }
+
+    ///
+    /// Start a sealed stream with a caller-chosen policy, as
+    /// [`SgxSealedData::seal_data_ex`] allows per record.
+    ///
+    /// [`SgxSealedData::seal_data_ex`]: crate::SgxSealedData::seal_data_ex
+    ///
+    pub fn new_ex(
+        key_policy: u16,
+        attribute_mask: sgx_attributes_t,
+        misc_mask: sgx_misc_select_t,
+    ) -> SgxResult<Self> {
+        if (key_policy
+            & (!(SGX_KEYPOLICY_MRENCLAVE
+                | SGX_KEYPOLICY_MRSIGNER
+                | KEY_POLICY_KSS
+                | SGX_KEYPOLICY_NOISVPRODID))
+            != 0)
+            || ((key_policy & (SGX_KEYPOLICY_MRENCLAVE | SGX_KEYPOLICY_MRSIGNER)) == 0)
+        {
+            return Err(sgx_status_t::SGX_ERROR_INVALID_PARAMETER);
+        }
+        if ((attribute_mask.flags & SGX_FLAGS_INITTED) == 0)
+            || ((attribute_mask.flags & SGX_FLAGS_DEBUG) == 0)
+        {
+            return Err(sgx_status_t::SGX_ERROR_INVALID_PARAMETER);
+        }
+
+        let mut key_id = sgx_key_id_t::default();
+
+        /* intel sgx sdk 2.4 */
+        let mut report = rsgx_self_report();
+
+        let error = rsgx_read_rand(&mut key_id.id);
+        if error.is_err() {
+            report = sgx_report_t::default();
+            key_id = sgx_key_id_t::default();
+            return Err(error.unwrap_err());
+        }
+
+        let key_request = sgx_key_request_t {
+            key_name: SGX_KEYSELECT_SEAL,
+            key_policy,
+            isv_svn: report.body.isv_svn,
+            reserved1: 0_u16,
+            cpu_svn: report.body.cpu_svn,
+            attribute_mask,
+            key_id,
+            misc_mask,
+            config_svn: report.body.config_svn,
+            reserved2: [0_u8; SGX_KEY_REQUEST_RESERVED2_BYTES],
+        };
+
+        let seal_key = rsgx_get_align_key(&key_request).map_err(|ret| {
+            if ret != sgx_status_t::SGX_ERROR_OUT_OF_MEMORY {
+                sgx_status_t::SGX_ERROR_UNEXPECTED
+            } else {
+                ret
+            }
+        })?;
+
+        report = sgx_report_t::default();
+        key_id = sgx_key_id_t::default();
+
+        Ok(SgxSealStream {
+            key_request,
+            seal_key,
+            next_index: 0,
+        })
+    }
+
+    ///
+    /// The stream header: magic, version and the key request. Write it
+    /// before the first chunk; [`SgxUnsealStream::new`] consumes it.
+    ///
+    pub fn header(&self) -> Vec<u8> {
+        let key_request_size = mem::size_of::<sgx_key_request_t>();
+        let mut bytes: Vec<u8> = Vec::with_capacity(8 + key_request_size);
+        bytes.extend_from_slice(&STREAM_MAGIC);
+        bytes.extend_from_slice(&STREAM_VERSION.to_le_bytes());
+        bytes.resize(8 + key_request_size, 0);
+        unsafe {
+            ptr::copy_nonoverlapping(
+                &self.key_request as *const _ as *const u8,
+                bytes.as_mut_ptr().add(8),
+                key_request_size,
+            );
+        }
+        bytes
+    }
+
+    ///
+    /// Seal the next chunk of the stream, returning a self-framed blob
+    /// (lengths, tag, ciphertext, additional text) to append to the
+    /// snapshot. Chunks must be restored in the order they were sealed.
+    ///
+    /// # Errors
+    ///
+    /// **SGX_ERROR_INVALID_PARAMETER**
+    ///
+    /// The encrypt text is empty, a length exceeds u32::MAX, or a
+    /// buffer fails the enclave boundary checks.
+    ///
+    pub fn seal_chunk(&mut self, additional_text: &[u8], encrypt_text: &[u8]) -> SgxResult<Vec<u8>> {
+        let additional_len = additional_text.len();
+        let encrypt_len = encrypt_text.len();
+
+        if (additional_len >= u32::MAX as usize)
+            || (encrypt_len >= u32::MAX as usize)
+            || (encrypt_len == 0)
+        {
+            return Err(sgx_status_t::SGX_ERROR_INVALID_PARAMETER);
+        }
+        if !rsgx_slice_is_within_enclave(encrypt_text) {
+            return Err(sgx_status_t::SGX_ERROR_INVALID_PARAMETER);
+        }
+        if additional_len > 0
+            && !rsgx_slice_is_within_enclave(additional_text)
+            && !rsgx_slice_is_outside_enclave(additional_text)
+        {
+            return Err(sgx_status_t::SGX_ERROR_INVALID_PARAMETER);
+        }
+
+        let payload_iv = chunk_iv(self.next_index, IV_DOMAIN_CHUNK);
+        let mut bytes: Vec<u8> =
+            Vec::with_capacity(SGX_SEAL_STREAM_CHUNK_OVERHEAD + encrypt_len + additional_len);
+        bytes.extend_from_slice(&(additional_len as u32).to_le_bytes());
+        bytes.extend_from_slice(&(encrypt_len as u32).to_le_bytes());
+        bytes.resize(SGX_SEAL_STREAM_CHUNK_OVERHEAD + encrypt_len, 0);
+
+        let (tag_slice, encrypt_slice) =
+            bytes[2 * mem::size_of::<u32>()..].split_at_mut(SGX_SEAL_TAG_SIZE);
+        let mut payload_tag = [0_u8; SGX_SEAL_TAG_SIZE];
+
+        rsgx_rijndael128GCM_encrypt(
+            &self.seal_key.key,
+            encrypt_text,
+            &payload_iv,
+            &additional_text,
+            encrypt_slice,
+            &mut payload_tag,
+        )?;
+        tag_slice.copy_from_slice(&payload_tag);
+
+        bytes.extend_from_slice(additional_text);
+        self.next_index += 1;
+        Ok(bytes)
+    }
+
+    ///
+    /// Close the stream, returning the terminator blob. It seals the
+    /// chunk count under a separate IV domain, so a restore that never
+    /// reaches [`SgxUnsealStream::finish`] - or reaches it with fewer
+    /// chunks - fails instead of passing off a truncated snapshot.
+    ///
+    pub fn finish(mut self) -> SgxResult<Vec<u8>> {
+        let count = self.next_index.to_le_bytes();
+        let payload_iv = chunk_iv(self.next_index, IV_DOMAIN_FINAL);
+
+        let mut encrypt = [0_u8; 8];
+        let mut payload_tag = [0_u8; SGX_SEAL_TAG_SIZE];
+        rsgx_rijndael128GCM_encrypt(
+            &self.seal_key.key,
+            &count,
+            &payload_iv,
+            &[],
+            &mut encrypt,
+            &mut payload_tag,
+        )?;
+
+        let mut bytes: Vec<u8> = Vec::with_capacity(SGX_SEAL_TAG_SIZE + encrypt.len());
+        bytes.extend_from_slice(&payload_tag);
+        bytes.extend_from_slice(&encrypt);
+        Ok(bytes)
+    }
+
+    ///
+    /// Get the number of chunks sealed so far.
+    ///
+    pub fn chunk_count(&self) -> u64 {
+        self.next_index
+    }
+
+    ///
+    /// Get the key request of the stream.
+    ///
+    pub fn get_key_request(&self) -> &sgx_key_request_t {
+        &self.key_request
+    }
+}
+
+impl Drop for SgxSealStream {
+    fn drop(&mut self) {
+        self.seal_key.key = sgx_key_128bit_t::default();
+    }
+}
+
+/// Reader half of a sealed stream: replays the header's key request
+/// through EGETKEY once, then unseals chunks in stream order.
+pub struct SgxUnsealStream {
+    seal_key: sgx_align_key_128bit_t,
+    next_index: u64,
+}
+
+impl SgxUnsealStream {
+    ///
+    /// Open a sealed stream from its header.
+    ///
+    /// The whole stream shares one key request, so a policy failure
+    /// (SGX_ERROR_INVALID_CPUSVN, SGX_ERROR_INVALID_ISVSVN) fails here
+    /// before any chunk is read.
+    ///
+    pub fn new(header: &[u8]) -> SgxResult<Self> {
+        let key_request_size = mem::size_of::<sgx_key_request_t>();
+        if header.len() < 8 + key_request_size {
+            return Err(sgx_status_t::SGX_ERROR_INVALID_PARAMETER);
+        }
+        if header[..4] != STREAM_MAGIC {
+            return Err(sgx_status_t::SGX_ERROR_INVALID_PARAMETER);
+        }
+        let mut raw = [0_u8; 4];
+        raw.copy_from_slice(&header[4..8]);
+        if u32::from_le_bytes(raw) != STREAM_VERSION {
+            return Err(sgx_status_t::SGX_ERROR_INVALID_PARAMETER);
+        }
+
+        let key_request = unsafe {
+            ptr::read_unaligned(header.as_ptr().add(8) as *const sgx_key_request_t)
+        };
+
+        let seal_key = rsgx_get_align_key(&key_request).map_err(|ret| {
+            if (ret == sgx_status_t::SGX_ERROR_INVALID_CPUSVN)
+                || (ret == sgx_status_t::SGX_ERROR_INVALID_ISVSVN)
+                || (ret == sgx_status_t::SGX_ERROR_OUT_OF_MEMORY)
+            {
+                ret
+            } else {
+                sgx_status_t::SGX_ERROR_MAC_MISMATCH
+            }
+        })?;
+
+        Ok(SgxUnsealStream {
+            seal_key,
+            next_index: 0,
+        })
+    }
+
+    ///
+    /// Get the total size of the chunk blob whose first bytes are
+    /// `prefix`, so a reader can pull blobs off a byte stream. Needs at
+    /// least the two length words.
+    ///
+    pub fn chunk_size(prefix: &[u8]) -> SgxResult<usize> {
+        let mut offset = 0_usize;
+        let additional_len = read_u32(prefix, &mut offset)? as usize;
+        let encrypt_len = read_u32(prefix, &mut offset)? as usize;
+        Ok(SGX_SEAL_STREAM_CHUNK_OVERHEAD + encrypt_len + additional_len)
+    }
+
+    ///
+    /// Unseal the next chunk. The ciphertext is copied into enclave
+    /// memory before any crypto, so the blob may live outside the
+    /// enclave. A chunk presented out of order, duplicated or corrupted
+    /// fails with SGX_ERROR_MAC_MISMATCH.
+    ///
+    pub fn unseal_chunk(&mut self, chunk: &[u8]) -> SgxResult<SgxUnsealedRecord> {
+        let mut offset = 0_usize;
+        let additional_len = read_u32(chunk, &mut offset)? as usize;
+        let encrypt_len = read_u32(chunk, &mut offset)? as usize;
+        if encrypt_len == 0 {
+            return Err(sgx_status_t::SGX_ERROR_INVALID_PARAMETER);
+        }
+
+        let mut payload_tag = [0_u8; SGX_SEAL_TAG_SIZE];
+        payload_tag.copy_from_slice(read_slice(chunk, &mut offset, SGX_SEAL_TAG_SIZE)?);
+        let encrypt = read_slice(chunk, &mut offset, encrypt_len)?.to_vec();
+        let additional = read_slice(chunk, &mut offset, additional_len)?.to_vec();
+
+        //
+        // see unseal_data: fence between the framing checks above and
+        // the crypto code, so a mispredicted check cannot feed the
+        // crypto unintended data
+        //
+        rsgx_lfence();
+
+        let payload_iv = chunk_iv(self.next_index, IV_DOMAIN_CHUNK);
+        let mut out = SgxUnsealedRecord::default();
+        out.decrypt = vec![0_u8; encrypt_len].into_boxed_slice();
+
+        rsgx_rijndael128GCM_decrypt(
+            &self.seal_key.key,
+            &encrypt,
+            &payload_iv,
+            &additional,
+            &payload_tag,
+            &mut out.decrypt,
+        )?;
+
+        out.additional = additional.into_boxed_slice();
+        out.payload_size = (encrypt_len + additional_len) as u32;
+        self.next_index += 1;
+        Ok(out)
+    }
+
+    ///
+    /// Verify the terminator blob and close the stream.
+    ///
+    /// # Errors
+    ///
+    /// **SGX_ERROR_MAC_MISMATCH**
+    ///
+    /// The terminator is corrupted, or the number of chunks unsealed
+    /// does not match the number sealed - the snapshot was truncated or
+    /// extended.
+    ///
+    pub fn finish(self, terminator: &[u8]) -> SgxResult<()> {
+        if terminator.len() != SGX_SEAL_TAG_SIZE + 8 {
+            return Err(sgx_status_t::SGX_ERROR_INVALID_PARAMETER);
+        }
+        let mut payload_tag = [0_u8; SGX_SEAL_TAG_SIZE];
+        payload_tag.copy_from_slice(&terminator[..SGX_SEAL_TAG_SIZE]);
+        let encrypt = &terminator[SGX_SEAL_TAG_SIZE..];
+
+        rsgx_lfence();
+
+        let payload_iv = chunk_iv(self.next_index, IV_DOMAIN_FINAL);
+        let mut count = [0_u8; 8];
+        rsgx_rijndael128GCM_decrypt(
+            &self.seal_key.key,
+            encrypt,
+            &payload_iv,
+            &[],
+            &payload_tag,
+            &mut count,
+        )?;
+
+        if u64::from_le_bytes(count) != self.next_index {
+            return Err(sgx_status_t::SGX_ERROR_MAC_MISMATCH);
+        }
+        Ok(())
+    }
+
+    ///
+    /// Get the number of chunks unsealed so far.
+    ///
+    pub fn chunk_count(&self) -> u64 {
+        self.next_index
+    }
+}
+
+impl Drop for SgxUnsealStream {
+    fn drop(&mut self) {
+        self.seal_key.key = sgx_key_128bit_t::default();
+    }
+}
@@ -0,0 +1,399 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License..
+
+//! Asynchronous ocall submission.
+//!
+//! Every ocall wrapper in this crate blocks its TCS until the untrusted
+//! syscall returns, so a TCS sitting in fsync is lost to enclave work.
+//! This module decouples submission from completion: [`submit_fsync`]
+//! and friends fill a job descriptor in untrusted memory and hand it to
+//! an untrusted worker pool with one quick ocall, the calling TCS
+//! returns to enclave work immediately, and the result is collected
+//! later through the returned [`AioHandle`]. Completion is signalled
+//! with the same per-TCS event the sync primitives use, so
+//! [`AioHandle::wait`] parks the thread exactly as a condvar would.
+//!
+//! Outbound data (writes) is copied into untrusted memory at submit
+//! time, so the enclave buffer can be reused as soon as submit returns.
+//! Positioned reads land in an untrusted staging buffer owned by the
+//! job and are copied into the enclave when the caller collects the
+//! result through [`AioReadHandle::wait_into`]; readiness-driven socket
+//! I/O remains better served by the epoll machinery in
+//! `sgx_asyncio.edl`.
+//!
+//! Call [`aio_init`] once before the first submission; workers are
+//! plain untrusted threads and consume no TCS.
+
+use crate::io;
+use crate::sys::mutex::thread_wait_event;
+use crate::time::Duration;
+use crate::u64;
+use core::mem;
+use core::ptr;
+use core::sync::atomic::{fence, AtomicPtr, Ordering};
+use sgx_libc::{c_int, c_void};
+use sgx_trts::enclave::SgxThreadData;
+use sgx_trts::libc;
+use sgx_trts::trts::rsgx_raw_is_outside_enclave;
+use sgx_types::sgx_status_t;
+
+/* keep in sync with sgx_ustdc/aio.c */
+const AIO_OP_FSYNC: i32 = 0;
+const AIO_OP_FDATASYNC: i32 = 1;
+const AIO_OP_WRITE: i32 = 2;
+const AIO_OP_PWRITE64: i32 = 3;
+const AIO_OP_PREAD64: i32 = 4;
+
+const AIO_STATE_SUBMITTED: i32 = 0;
+const AIO_STATE_DONE: i32 = 1;
+
+#[repr(C)]
+struct AioJob {
+    op: i32,
+    fd: i32,
+    offset: u64,
+    buf: *mut c_void,
+    len: u64,
+    result: i64,
+    error: i32,
+    state: i32,
+    tcs: *const c_void,
+}
+
+extern "C" {
+    fn u_aio_queue_create_ocall(
+        result: *mut *mut c_void,
+        error: *mut c_int,
+        workers: c_int,
+    ) -> sgx_status_t;
+    fn u_aio_queue_destroy_ocall(queue: *mut c_void) -> sgx_status_t;
+    fn u_aio_submit_ocall(
+        result: *mut c_int,
+        error: *mut c_int,
+        queue: *mut c_void,
+        job: *mut c_void,
+    ) -> sgx_status_t;
+}
+
+static AIO_QUEUE: AtomicPtr<c_void> = AtomicPtr::new(ptr::null_mut());
+
+/// Starts the untrusted worker pool with `workers` threads. Must be
+/// called once before the first submission; a second call fails with
+/// `AlreadyExists`.
+pub fn aio_init(workers: u32) -> io::Result<()> {
+    let mut queue: *mut c_void = ptr::null_mut();
+    let mut error: c_int = 0;
+    let status = unsafe {
+        u_aio_queue_create_ocall(
+            &mut queue as *mut *mut c_void,
+            &mut error as *mut c_int,
+            workers as c_int,
+        )
+    };
+    if status != sgx_status_t::SGX_SUCCESS {
+        return Err(io::Error::from_raw_os_error(libc::ESGX));
+    }
+    if queue.is_null() {
+        return Err(io::Error::from_raw_os_error(error));
+    }
+    if !rsgx_raw_is_outside_enclave(queue as *const u8, 1) {
+        return Err(io::Error::from_raw_os_error(libc::ESGX));
+    }
+
+    if AIO_QUEUE
+        .compare_exchange(ptr::null_mut(), queue, Ordering::SeqCst, Ordering::SeqCst)
+        .is_err()
+    {
+        unsafe {
+            let _ = u_aio_queue_destroy_ocall(queue);
+        }
+        return Err(io::Error::from(io::ErrorKind::AlreadyExists));
+    }
+    Ok(())
+}
+
+/// Stops the worker pool. Outstanding handles stay valid: their jobs
+/// were drained before the workers joined.
+pub fn aio_shutdown() {
+    let queue = AIO_QUEUE.swap(ptr::null_mut(), Ordering::SeqCst);
+    if !queue.is_null() {
+        unsafe {
+            let _ = u_aio_queue_destroy_ocall(queue);
+        }
+    }
+}
+
+/// Submits an fsync of `fd`; returns immediately with a handle.
+pub fn submit_fsync(fd: c_int) -> io::Result<AioHandle> {
+    submit(AIO_OP_FSYNC, fd, None, 0)
+}
+
+/// Submits an fdatasync of `fd`; returns immediately with a handle.
+pub fn submit_fdatasync(fd: c_int) -> io::Result<AioHandle> {
+    submit(AIO_OP_FDATASYNC, fd, None, 0)
+}
+
+/// Submits a write of `buf` to `fd` at the file's current offset. The
+/// data is copied to untrusted memory before submit returns, so `buf`
+/// may be reused immediately.
+pub fn submit_write(fd: c_int, buf: &[u8]) -> io::Result<AioHandle> {
+    submit(AIO_OP_WRITE, fd, Some(buf), 0)
+}
+
+/// Submits a positioned write of `buf` to `fd` at `offset`, copying the
+/// data to untrusted memory first.
+pub fn submit_pwrite64(fd: c_int, buf: &[u8], offset: u64) -> io::Result<AioHandle> {
+    submit(AIO_OP_PWRITE64, fd, Some(buf), offset)
+}
+
+/// Submits a positioned read of `len` bytes from `fd` at `offset`. The
+/// data lands in an untrusted staging buffer owned by the job; collect
+/// it with [`AioReadHandle::wait_into`].
+pub fn submit_pread64(fd: c_int, len: usize, offset: u64) -> io::Result<AioReadHandle> {
+    queue_ready()?;
+    let buf = unsafe { untrusted_alloc(len)? };
+    match submit_job(AIO_OP_PREAD64, fd, buf, len, offset) {
+        Ok(inner) => Ok(AioReadHandle { inner }),
+        Err(e) => {
+            unsafe { untrusted_free(buf) };
+            Err(e)
+        }
+    }
+}
+
+fn submit(op: i32, fd: c_int, data: Option<&[u8]>, offset: u64) -> io::Result<AioHandle> {
+    queue_ready()?;
+    let len = data.map_or(0, <[u8]>::len);
+    let buf = if let Some(data) = data {
+        let buf = unsafe { untrusted_alloc(len)? };
+        unsafe {
+            ptr::copy_nonoverlapping(data.as_ptr(), buf as *mut u8, len);
+        }
+        buf
+    } else {
+        ptr::null_mut()
+    };
+
+    match submit_job(op, fd, buf, len, offset) {
+        Ok(handle) => Ok(handle),
+        Err(e) => {
+            unsafe { untrusted_free(buf) };
+            Err(e)
+        }
+    }
+}
+
+fn queue_ready() -> io::Result<()> {
+    if AIO_QUEUE.load(Ordering::SeqCst).is_null() {
+        Err(io::Error::new(
+            io::ErrorKind::Other,
+            "aio worker pool is not initialized",
+        ))
+    } else {
+        Ok(())
+    }
+}
+
+/// Fills a job descriptor around an already untrusted `buf` and hands
+/// it to the worker pool. On error the caller still owns `buf`.
+fn submit_job(op: i32, fd: c_int, buf: *mut c_void, len: usize, offset: u64) -> io::Result<AioHandle> {
+    let queue = AIO_QUEUE.load(Ordering::SeqCst);
+    if queue.is_null() {
+        return Err(io::Error::new(
+            io::ErrorKind::Other,
+            "aio worker pool is not initialized",
+        ));
+    }
+
+    let job = match unsafe { untrusted_alloc(mem::size_of::<AioJob>()) } {
+        Ok(job) => job as *mut AioJob,
+        Err(e) => return Err(e),
+    };
+
+    unsafe {
+        ptr::write_volatile(job, AioJob {
+            op,
+            fd,
+            offset,
+            buf,
+            len: len as u64,
+            result: -1,
+            error: 0,
+            state: AIO_STATE_SUBMITTED,
+            tcs: SgxThreadData::current().get_tcs() as *const c_void,
+        });
+    }
+
+    let mut result: c_int = 0;
+    let mut error: c_int = 0;
+    let status = unsafe {
+        u_aio_submit_ocall(
+            &mut result as *mut c_int,
+            &mut error as *mut c_int,
+            queue,
+            job as *mut c_void,
+        )
+    };
+    if status != sgx_status_t::SGX_SUCCESS || result == -1 {
+        unsafe {
+            untrusted_free(job as *mut c_void);
+        }
+        let errno = if status != sgx_status_t::SGX_SUCCESS { libc::ESGX } else { error };
+        return Err(io::Error::from_raw_os_error(errno));
+    }
+
+    Ok(AioHandle {
+        job,
+        len,
+        buf,
+    })
+}
+
+unsafe fn untrusted_alloc(size: usize) -> io::Result<*mut c_void> {
+    let p = sgx_libc::ocall::malloc(size);
+    if p.is_null() {
+        return Err(io::Error::from_raw_os_error(libc::ENOMEM));
+    }
+    if !rsgx_raw_is_outside_enclave(p as *const u8, size) {
+        sgx_libc::ocall::free(p);
+        return Err(io::Error::from_raw_os_error(libc::ESGX));
+    }
+    Ok(p)
+}
+
+unsafe fn untrusted_free(p: *mut c_void) {
+    if !p.is_null() {
+        sgx_libc::ocall::free(p);
+    }
+}
+
+/// An in-flight asynchronous ocall. Dropping the handle waits for the
+/// job to complete - the descriptor cannot be freed under a running
+/// worker - so collect results with [`wait`] rather than dropping
+/// handles of jobs whose outcome matters.
+///
+/// [`wait`]: AioHandle::wait
+pub struct AioHandle {
+    job: *mut AioJob,
+    len: usize,
+    buf: *mut c_void,
+}
+
+unsafe impl Send for AioHandle {}
+
+impl AioHandle {
+    /// Returns true once the job has completed; never blocks.
+    pub fn is_complete(&self) -> bool {
+        let state = unsafe { ptr::read_volatile(&(*self.job).state) };
+        if state == AIO_STATE_DONE {
+            fence(Ordering::Acquire);
+            true
+        } else {
+            false
+        }
+    }
+
+    /// Blocks the calling thread until the job completes and returns
+    /// the operation's result (bytes written; zero for syncs).
+    ///
+    /// Completion is signalled to the TCS that submitted the job, so
+    /// `wait` must be called on the submitting thread; other threads
+    /// should poll [`is_complete`] instead.
+    ///
+    /// [`is_complete`]: AioHandle::is_complete
+    pub fn wait(self) -> io::Result<usize> {
+        self.wait_keep()
+    }
+
+    fn wait_keep(&self) -> io::Result<usize> {
+        while !self.is_complete() {
+            unsafe {
+                thread_wait_event(
+                    SgxThreadData::current().get_tcs(),
+                    Duration::new(u64::MAX, 1_000_000_000 - 1),
+                );
+            }
+        }
+        self.take_result()
+    }
+
+    fn take_result(&self) -> io::Result<usize> {
+        // the job lives outside the enclave: copy the fields once and
+        // sanity-check them before trusting the outcome
+        let result = unsafe { ptr::read_volatile(&(*self.job).result) };
+        let error = unsafe { ptr::read_volatile(&(*self.job).error) };
+        if result < 0 {
+            let errno = if error > 0 { error } else { libc::EIO };
+            return Err(io::Error::from_raw_os_error(errno));
+        }
+        let written = result as usize;
+        if written > self.len && self.len != 0 {
+            return Err(io::Error::from_raw_os_error(libc::EIO));
+        }
+        Ok(written)
+    }
+}
+
+impl Drop for AioHandle {
+    fn drop(&mut self) {
+        while !self.is_complete() {
+            unsafe {
+                thread_wait_event(
+                    SgxThreadData::current().get_tcs(),
+                    Duration::from_millis(10),
+                );
+            }
+        }
+        unsafe {
+            untrusted_free(self.buf);
+            untrusted_free(self.job as *mut c_void);
+        }
+    }
+}
+
+/// An in-flight asynchronous positioned read. The data lives in an
+/// untrusted staging buffer until it is collected; dropping the handle
+/// waits for the job and discards the data, as with [`AioHandle`].
+pub struct AioReadHandle {
+    inner: AioHandle,
+}
+
+impl AioReadHandle {
+    /// Returns true once the read has completed; never blocks.
+    pub fn is_complete(&self) -> bool {
+        self.inner.is_complete()
+    }
+
+    /// Blocks until the read completes, copies the data into `dst` and
+    /// returns the byte count (zero at end of file). `dst` must be at
+    /// least as large as the submitted length.
+    ///
+    /// Like [`AioHandle::wait`], this must be called on the submitting
+    /// thread.
+    pub fn wait_into(self, dst: &mut [u8]) -> io::Result<usize> {
+        let nread = self.inner.wait_keep()?;
+        if nread > dst.len() {
+            return Err(io::Error::from_raw_os_error(libc::EIO));
+        }
+        if nread > 0 {
+            unsafe {
+                ptr::copy_nonoverlapping(self.inner.buf as *const u8, dst.as_mut_ptr(), nread);
+            }
+        }
+        Ok(nread)
+    }
+}
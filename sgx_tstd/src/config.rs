@@ -0,0 +1,241 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License..
+
+//! Hot-reloadable enclave configuration.
+//!
+//! Tuning parameters baked in at build time force an enclave restart -
+//! and the loss of every warmed page, cache and session - to change a
+//! pool depth. This module publishes a versioned configuration snapshot
+//! through [`SgxRcuCell`], so an operator can push a new blob into the
+//! running enclave via `t_config_update_ecall` while request threads
+//! keep reading: a reader that pinned the old snapshot finishes its
+//! request against it, new readers see the new one, and the old
+//! allocation is reclaimed through the epoch domain once the last
+//! pinned reader is gone. The cut-over is a single pointer swing.
+//!
+//! Blobs arrive from untrusted code, so they pass through a registered
+//! opener before parsing - typically an unseal-and-verify step the
+//! application wires up with its sealing crate (this crate cannot
+//! choose that policy). Loading fails until an opener is registered;
+//! an enclave that really wants plaintext config registers an identity
+//! opener and owns that decision. Versions must increase strictly, so
+//! an attacker replaying an older sealed blob is refused.
+//!
+//! Opened blob layout (little-endian):
+//!
+//!   u64 version, u32 entry count, then per entry:
+//!   u16 key length, key (UTF-8), u32 value length, value
+
+use crate::io;
+use crate::str;
+use crate::sync::epoch::{epoch_domain, EpochParticipant};
+use crate::sync::seqlock::{SgxRcuCell, SgxRcuReadGuard};
+use crate::sync::{Once, SgxMutex};
+use alloc_crate::collections::BTreeMap;
+use alloc_crate::string::String;
+use alloc_crate::vec::Vec;
+use core::slice;
+use core::sync::atomic::{AtomicU64, Ordering};
+
+/// Opens a raw config blob handed in from outside the enclave -
+/// typically unseal plus any application-level verification - and
+/// returns the plaintext to parse, or None to refuse the blob.
+pub type ConfigOpener = fn(blob: &[u8]) -> Option<Vec<u8>>;
+
+/// One immutable configuration version. Readers borrow it through
+/// [`config_read`]; it is never mutated after publication.
+pub struct ConfigSnapshot {
+    version: u64,
+    entries: BTreeMap<String, Vec<u8>>,
+}
+
+impl ConfigSnapshot {
+    /// The version this snapshot was published under; 0 for the empty
+    /// boot snapshot.
+    pub fn version(&self) -> u64 {
+        self.version
+    }
+
+    /// The raw value for `key`, if present.
+    pub fn get(&self, key: &str) -> Option<&[u8]> {
+        self.entries.get(key).map(|v| v.as_slice())
+    }
+
+    /// The value for `key` as UTF-8 text.
+    pub fn get_str(&self, key: &str) -> Option<&str> {
+        self.get(key).and_then(|v| str::from_utf8(v).ok())
+    }
+
+    /// The value for `key` parsed as decimal, for the usual numeric
+    /// tunables (cache sizes, pool depths, thresholds).
+    pub fn get_u64(&self, key: &str) -> Option<u64> {
+        self.get_str(key).and_then(|s| s.parse().ok())
+    }
+}
+
+struct ConfigState {
+    cell: SgxRcuCell<ConfigSnapshot>,
+    /// Mirror of the published snapshot's version, readable without
+    /// pinning; cheap "did anything change since I derived state?"
+    /// checks go here.
+    version: AtomicU64,
+    opener: SgxMutex<Option<ConfigOpener>>,
+    /// Serializes loads so the version check and the publication are
+    /// one atomic step against other loaders.
+    load_lock: SgxMutex<()>,
+}
+
+fn state() -> &'static ConfigState {
+    static INIT: Once = Once::new();
+    static mut STATE: Option<ConfigState> = None;
+    unsafe {
+        INIT.call_once(|| {
+            STATE = Some(ConfigState {
+                cell: SgxRcuCell::new(ConfigSnapshot {
+                    version: 0,
+                    entries: BTreeMap::new(),
+                }),
+                version: AtomicU64::new(0),
+                opener: SgxMutex::new(None),
+                load_lock: SgxMutex::new(()),
+            });
+        });
+        STATE.as_ref().unwrap()
+    }
+}
+
+/// Registers the opener applied to every incoming blob before parsing.
+/// Call once from enclave init, before the first update ecall can
+/// arrive.
+pub fn set_config_opener(opener: ConfigOpener) {
+    *state().opener.lock().unwrap() = Some(opener);
+}
+
+/// Borrows the current snapshot. The guard keeps `participant` pinned,
+/// so hold it for one request at most: the snapshot stays valid and
+/// internally consistent even if a load publishes a newer version
+/// meanwhile.
+pub fn config_read<'a>(participant: &'a EpochParticipant) -> SgxRcuReadGuard<'a, ConfigSnapshot> {
+    state().cell.read(participant)
+}
+
+/// The version of the currently published snapshot, without pinning.
+pub fn config_version() -> u64 {
+    state().version.load(Ordering::Acquire)
+}
+
+fn parse_snapshot(plaintext: &[u8]) -> Option<ConfigSnapshot> {
+    if plaintext.len() < 12 {
+        return None;
+    }
+    let mut version_bytes = [0_u8; 8];
+    version_bytes.copy_from_slice(&plaintext[..8]);
+    let version = u64::from_le_bytes(version_bytes);
+
+    let mut count_bytes = [0_u8; 4];
+    count_bytes.copy_from_slice(&plaintext[8..12]);
+    let count = u32::from_le_bytes(count_bytes) as usize;
+
+    let mut entries = BTreeMap::new();
+    let mut offset = 12;
+    for _ in 0..count {
+        if plaintext.len() - offset < 2 {
+            return None;
+        }
+        let mut klen_bytes = [0_u8; 2];
+        klen_bytes.copy_from_slice(&plaintext[offset..offset + 2]);
+        let klen = u16::from_le_bytes(klen_bytes) as usize;
+        offset += 2;
+        if klen == 0 || plaintext.len() - offset < klen {
+            return None;
+        }
+        let key = str::from_utf8(&plaintext[offset..offset + klen]).ok()?;
+        offset += klen;
+
+        if plaintext.len() - offset < 4 {
+            return None;
+        }
+        let mut vlen_bytes = [0_u8; 4];
+        vlen_bytes.copy_from_slice(&plaintext[offset..offset + 4]);
+        let vlen = u32::from_le_bytes(vlen_bytes) as usize;
+        offset += 4;
+        if plaintext.len() - offset < vlen {
+            return None;
+        }
+        entries.insert(String::from(key), plaintext[offset..offset + vlen].to_vec());
+        offset += vlen;
+    }
+    if offset != plaintext.len() {
+        return None;
+    }
+
+    Some(ConfigSnapshot { version, entries })
+}
+
+/// Opens, parses and publishes `blob`, returning the new version.
+///
+/// Fails with `PermissionDenied` when no opener is registered or the
+/// opener refuses the blob, `InvalidData` for a malformed payload, and
+/// `InvalidInput` when the version does not exceed the published one
+/// (a replayed or stale blob). On success every subsequent
+/// [`config_read`] sees the new snapshot; readers already pinned keep
+/// the old one until they unpin.
+pub fn load_config(blob: &[u8]) -> io::Result<u64> {
+    let opener = match *state().opener.lock().unwrap() {
+        Some(opener) => opener,
+        None => return Err(io::Error::from(io::ErrorKind::PermissionDenied)),
+    };
+    let plaintext = opener(blob)
+        .ok_or_else(|| io::Error::from(io::ErrorKind::PermissionDenied))?;
+
+    let snapshot = parse_snapshot(&plaintext)
+        .ok_or_else(|| io::Error::from(io::ErrorKind::InvalidData))?;
+    let version = snapshot.version;
+
+    let _load = state().load_lock.lock().unwrap();
+    if version <= state().version.load(Ordering::Acquire) {
+        return Err(io::Error::from(io::ErrorKind::InvalidInput));
+    }
+
+    let participant = epoch_domain().register();
+    state().cell.replace(snapshot, &participant);
+    state().version.store(version, Ordering::Release);
+    Ok(version)
+}
+
+/// Update ecall codes surfaced to the untrusted loader.
+const CONFIG_UPDATE_OK: u32 = 0;
+const CONFIG_UPDATE_REFUSED: u32 = 1;
+const CONFIG_UPDATE_MALFORMED: u32 = 2;
+const CONFIG_UPDATE_STALE: u32 = 3;
+
+#[no_mangle]
+pub extern "C" fn t_config_update_ecall(blob: *const u8, len: usize) -> u32 {
+    if blob.is_null() || len == 0 {
+        return CONFIG_UPDATE_MALFORMED;
+    }
+    // The EDL marshals the blob into enclave memory before we run.
+    let blob = unsafe { slice::from_raw_parts(blob, len) };
+    match load_config(blob) {
+        Ok(_) => CONFIG_UPDATE_OK,
+        Err(err) => match err.kind() {
+            io::ErrorKind::PermissionDenied => CONFIG_UPDATE_REFUSED,
+            io::ErrorKind::InvalidInput => CONFIG_UPDATE_STALE,
+            _ => CONFIG_UPDATE_MALFORMED,
+        },
+    }
+}
@@ -0,0 +1,391 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License..
+
+//! An M:N task executor for the enclave.
+//!
+//! TCSs are configured at signing time and each one pins a 64KB+ stack
+//! in the EPC, so a thread-per-session enclave tops out at a few dozen
+//! sessions. This executor multiplexes many lightweight tasks - plain
+//! `Future`s, no per-task stack - onto a small pool of sgx_tstd worker
+//! threads: a task that cannot make progress returns `Pending` and
+//! releases its worker to the next runnable task instead of parking a
+//! TCS.
+//!
+//! Tasks waiting on untrusted I/O pair naturally with the [`aio`]
+//! module: submit the job, then await [`AioComplete`], which yields the
+//! worker until the untrusted side has finished. Thousands of
+//! mostly-idle sessions then cost one pinned future each rather than
+//! one TCS each.
+//!
+//! On SGX2 platforms signed with TCSMaxNum above TCSNum, an executor
+//! built with [`TaskExecutor::elastic`] also grows: when tasks back up
+//! it spawns extra workers whose TCSs the runtime materializes on
+//! demand through EDMM, and idle extra workers exit and give the TCS
+//! back. The enclave then holds TCS pages for its current load instead
+//! of its signed peak.
+//!
+//! ```rust,ignore
+//! let pool = TaskExecutor::new(8).unwrap();
+//! pool.spawn(async move {
+//!     let handle = aio::submit_write(fd, &record).unwrap();
+//!     let written = aio_complete(handle).await.unwrap();
+//! });
+//! ```
+//!
+//! [`aio`]: crate::aio
+
+use crate::aio::AioHandle;
+use crate::io;
+use crate::sync::{SgxCondvar, SgxMutex};
+use crate::thread;
+use sgx_trts::libc;
+use alloc_crate::boxed::Box;
+use alloc_crate::collections::vec_deque::VecDeque;
+use alloc_crate::string::{String, ToString};
+use alloc_crate::sync::Arc;
+use alloc_crate::vec::Vec;
+use core::future::Future;
+use core::mem;
+use core::pin::Pin;
+use core::sync::atomic::{AtomicBool, AtomicUsize, Ordering};
+use core::task::{Context, Poll, RawWaker, RawWakerVTable, Waker};
+use core::time::Duration;
+
+type BoxFuture = Pin<Box<dyn Future<Output = ()> + Send + 'static>>;
+
+/// How long an elastic worker sits idle before it exits and returns
+/// its TCS to the platform.
+const ELASTIC_IDLE_TIMEOUT: Duration = Duration::from_secs(2);
+
+struct Shared {
+    run_queue: SgxMutex<VecDeque<Arc<Task>>>,
+    more_tasks: SgxCondvar,
+    shutdown: AtomicBool,
+    /// Workers currently blocked waiting for a task.
+    idle: AtomicUsize,
+    /// Workers currently running, permanent and elastic together.
+    live: AtomicUsize,
+    /// Ceiling for `live`; equals the permanent worker count when the
+    /// executor is not elastic.
+    max_workers: usize,
+}
+
+fn enqueue(shared: &Arc<Shared>, task: Arc<Task>) {
+    {
+        let mut queue = shared.run_queue.lock().unwrap();
+        queue.push_back(task);
+        shared.more_tasks.signal();
+    }
+
+    // Elastic growth: a task arrived and nobody is waiting for it.
+    // Spawning takes a new TCS - on an SGX2 platform signed with
+    // TCSMaxNum above TCSNum the runtime adds one through EDMM when the
+    // new thread first enters - so capacity is only committed under
+    // load. A failed spawn (static TCS exhausted on SGX1 hardware)
+    // leaves the task queued for the existing workers.
+    if shared.idle.load(Ordering::Acquire) == 0 {
+        let live = shared.live.load(Ordering::Acquire);
+        if live < shared.max_workers
+            && shared
+                .live
+                .compare_exchange(live, live + 1, Ordering::AcqRel, Ordering::Acquire)
+                .is_ok()
+        {
+            let worker_shared = shared.clone();
+            let spawned = thread::Builder::new()
+                .name("task-executor-elastic".to_string())
+                .spawn(move || worker_loop(worker_shared, false));
+            if spawned.is_err() {
+                shared.live.fetch_sub(1, Ordering::AcqRel);
+            }
+        }
+    }
+}
+
+struct Task {
+    future: SgxMutex<Option<BoxFuture>>,
+    /// Guards against a task sitting in the run queue twice when several
+    /// wakers fire before a worker gets to it.
+    queued: AtomicBool,
+    shared: Arc<Shared>,
+}
+
+impl Task {
+    fn schedule(self: &Arc<Task>) {
+        if !self.queued.swap(true, Ordering::AcqRel) {
+            enqueue(&self.shared, self.clone());
+        }
+    }
+}
+
+const TASK_WAKER_VTABLE: RawWakerVTable = RawWakerVTable::new(
+    waker_clone,
+    waker_wake,
+    waker_wake_by_ref,
+    waker_drop,
+);
+
+unsafe fn waker_clone(ptr: *const ()) -> RawWaker {
+    let task = Arc::from_raw(ptr as *const Task);
+    mem::forget(task.clone());
+    mem::forget(task);
+    RawWaker::new(ptr, &TASK_WAKER_VTABLE)
+}
+
+unsafe fn waker_wake(task: *const ()) {
+    let task = Arc::from_raw(task as *const Task);
+    task.schedule();
+}
+
+unsafe fn waker_wake_by_ref(task: *const ()) {
+    let task = Arc::from_raw(task as *const Task);
+    task.schedule();
+    mem::forget(task);
+}
+
+unsafe fn waker_drop(task: *const ()) {
+    drop(Arc::from_raw(task as *const Task));
+}
+
+fn task_waker(task: Arc<Task>) -> Waker {
+    let raw = RawWaker::new(Arc::into_raw(task) as *const (), &TASK_WAKER_VTABLE);
+    unsafe { Waker::from_raw(raw) }
+}
+
+/// A pool of worker threads polling spawned futures. Dropping the
+/// executor stops the workers after the run queue drains; tasks that
+/// are `Pending` and never woken again are dropped with it.
+pub struct TaskExecutor {
+    shared: Arc<Shared>,
+    workers: Vec<thread::JoinHandle<()>>,
+}
+
+impl TaskExecutor {
+    /// Spawns `workers` sgx_tstd threads - each consumes one TCS - and
+    /// returns the executor multiplexing tasks onto them.
+    pub fn new(workers: usize) -> io::Result<TaskExecutor> {
+        TaskExecutor::with_limits(workers, workers)
+    }
+
+    /// An executor that keeps `min_workers` permanent threads and grows
+    /// up to the platform's TCS ceiling under load.
+    ///
+    /// The ceiling comes from the enclave's signed TCSMaxNum (less the
+    /// caller's own TCS and the EDMM utility thread). On SGX2 hardware
+    /// the runtime materializes the extra TCS pages through EDMM only
+    /// when a grown worker first enters, so idle periods hold
+    /// `min_workers` TCSs in the EPC rather than peak; grown workers
+    /// exit after two idle seconds and give their TCS back to the
+    /// runtime for other ECALLs.
+    pub fn elastic(min_workers: usize) -> io::Result<TaskExecutor> {
+        let ceiling = sgx_trts::enclave::rsgx_get_tcs_max_num() as usize;
+        let max_workers = core::cmp::max(min_workers, ceiling.saturating_sub(2));
+        TaskExecutor::with_limits(min_workers, max_workers)
+    }
+
+    /// As [`elastic`], with an explicit worker ceiling.
+    ///
+    /// [`elastic`]: TaskExecutor::elastic
+    pub fn with_limits(min_workers: usize, max_workers: usize) -> io::Result<TaskExecutor> {
+        if min_workers == 0 || max_workers < min_workers {
+            return Err(io::Error::from_raw_os_error(libc::EINVAL));
+        }
+
+        let shared = Arc::new(Shared {
+            run_queue: SgxMutex::new(VecDeque::new()),
+            more_tasks: SgxCondvar::new(),
+            shutdown: AtomicBool::new(false),
+            idle: AtomicUsize::new(0),
+            live: AtomicUsize::new(min_workers),
+            max_workers,
+        });
+
+        let mut handles = Vec::with_capacity(min_workers);
+        for index in 0..min_workers {
+            let shared = shared.clone();
+            let mut name = String::from("task-executor-");
+            name.push_str(&index.to_string());
+            let handle = thread::Builder::new()
+                .name(name)
+                .spawn(move || worker_loop(shared, true))?;
+            handles.push(handle);
+        }
+
+        Ok(TaskExecutor {
+            shared,
+            workers: handles,
+        })
+    }
+
+    /// Worker threads currently running, permanent and elastic
+    /// together; a proxy for the TCSs the executor is holding.
+    pub fn live_workers(&self) -> usize {
+        self.shared.live.load(Ordering::Acquire)
+    }
+
+    /// Submits a future to the pool. The future starts running on the
+    /// next free worker and holds no TCS while it is `Pending`.
+    pub fn spawn<F>(&self, future: F)
+    where
+        F: Future<Output = ()> + Send + 'static,
+    {
+        let task = Arc::new(Task {
+            future: SgxMutex::new(Some(Box::pin(future))),
+            queued: AtomicBool::new(false),
+            shared: self.shared.clone(),
+        });
+        task.schedule();
+    }
+}
+
+impl Drop for TaskExecutor {
+    fn drop(&mut self) {
+        self.shared.shutdown.store(true, Ordering::Release);
+        {
+            let _queue = self.shared.run_queue.lock().unwrap();
+            self.shared.more_tasks.broadcast();
+        }
+        for handle in self.workers.drain(..) {
+            let _ = handle.join();
+        }
+        // Elastic workers are detached; wait for them to see the
+        // shutdown flag and release their TCSs before returning.
+        while self.shared.live.load(Ordering::Acquire) > 0 {
+            thread::yield_now();
+        }
+    }
+}
+
+fn worker_loop(shared: Arc<Shared>, permanent: bool) {
+    loop {
+        let task = {
+            let mut queue = shared.run_queue.lock().unwrap();
+            loop {
+                if let Some(task) = queue.pop_front() {
+                    break task;
+                }
+                if shared.shutdown.load(Ordering::Acquire) {
+                    shared.live.fetch_sub(1, Ordering::AcqRel);
+                    return;
+                }
+                shared.idle.fetch_add(1, Ordering::AcqRel);
+                if permanent {
+                    queue = shared.more_tasks.wait(queue).unwrap();
+                    shared.idle.fetch_sub(1, Ordering::AcqRel);
+                } else {
+                    let (guard, timeout) = shared
+                        .more_tasks
+                        .wait_timeout(queue, ELASTIC_IDLE_TIMEOUT)
+                        .unwrap();
+                    queue = guard;
+                    shared.idle.fetch_sub(1, Ordering::AcqRel);
+                    if timeout.timed_out() && queue.is_empty() {
+                        // Nothing arrived in a while: shrink and hand
+                        // the TCS back to the runtime.
+                        shared.live.fetch_sub(1, Ordering::AcqRel);
+                        return;
+                    }
+                }
+            }
+        };
+
+        // take the future out so a waker firing mid-poll does not poll
+        // it concurrently from another worker; a pop that finds the
+        // future already out leaves the queued flag alone - the worker
+        // holding the future requeues if a wake arrived meanwhile
+        let mut future = match task.future.lock().unwrap().take() {
+            Some(future) => future,
+            None => continue,
+        };
+        task.queued.store(false, Ordering::Release);
+
+        let waker = task_waker(task.clone());
+        let mut context = Context::from_waker(&waker);
+        match future.as_mut().poll(&mut context) {
+            Poll::Ready(()) => {}
+            Poll::Pending => {
+                *task.future.lock().unwrap() = Some(future);
+                // a wake that fired while we held the future may have
+                // been popped against an empty task slot; requeue so it
+                // is not lost (a spurious extra poll is harmless)
+                if task.queued.load(Ordering::Acquire) {
+                    enqueue(&task.shared, task.clone());
+                }
+            }
+        }
+    }
+}
+
+/// Yields the worker once and reschedules the task at the back of the
+/// run queue, for long CPU-bound tasks sharing a small pool.
+pub fn yield_task() -> YieldTask {
+    YieldTask { yielded: false }
+}
+
+/// Future returned by [`yield_task`].
+pub struct YieldTask {
+    yielded: bool,
+}
+
+impl Future for YieldTask {
+    type Output = ();
+
+    fn poll(mut self: Pin<&mut Self>, cx: &mut Context<'_>) -> Poll<()> {
+        if self.yielded {
+            Poll::Ready(())
+        } else {
+            self.yielded = true;
+            cx.waker().wake_by_ref();
+            Poll::Pending
+        }
+    }
+}
+
+/// Awaits an in-flight asynchronous ocall without holding a worker.
+///
+/// The untrusted side signals completion to the submitting TCS, not to
+/// the executor, so the task reschedules itself and re-checks the
+/// descriptor on its next turn; the check is one volatile read of
+/// untrusted memory.
+pub fn aio_complete(handle: AioHandle) -> AioComplete {
+    AioComplete {
+        handle: Some(handle),
+    }
+}
+
+/// Future returned by [`aio_complete`]; resolves to the job's result.
+pub struct AioComplete {
+    handle: Option<AioHandle>,
+}
+
+impl Future for AioComplete {
+    type Output = io::Result<usize>;
+
+    fn poll(mut self: Pin<&mut Self>, cx: &mut Context<'_>) -> Poll<io::Result<usize>> {
+        let done = self
+            .handle
+            .as_ref()
+            .map_or(true, AioHandle::is_complete);
+        if done {
+            let handle = self.handle.take().expect("AioComplete polled after completion");
+            Poll::Ready(handle.wait())
+        } else {
+            cx.waker().wake_by_ref();
+            Poll::Pending
+        }
+    }
+}
@@ -16,9 +16,16 @@
 // under the License..
 
 //! Filesystem manipulation operations.
+//!
+//! Every read and write on a [`File`] is an enclave transition, so code
+//! that writes in small pieces (a line at a time, a record at a time)
+//! should go through [`OcallWriter`] rather than the bare file; it
+//! combines small writes into transition-sized flushes and is the
+//! intended default for sequential output from an enclave.
 
 use core::fmt;
 use crate::io::{self, Initializer, IoSlice, IoSliceMut, Read, Seek, SeekFrom, Write};
+use crate::os::unix::io::AsRawFd;
 use crate::path::{Path, PathBuf};
 use crate::sys::fs as fs_imp;
 use crate::sys_common::{AsInner, AsInnerMut, FromInner, IntoInner};
@@ -1380,7 +1387,7 @@ impl DirBuilder {
         match path.parent() {
             Some(p) => self.create_dir_all(p)?,
             None => {
-                return Err(io::Error::new(io::ErrorKind::Other, "failed to create whole tree"));
+                return Err(io::Error::new_const(io::ErrorKind::Other, &"failed to create whole tree"));
             }
         }
         match self.inner.mkdir(path) {
@@ -1396,3 +1403,280 @@ impl AsInnerMut<fs_imp::DirBuilder> for DirBuilder {
         &mut self.inner
     }
 }
+
+/// Default buffer size of [`OcallWriter`].
+///
+/// Sized for the ocall boundary rather than for libc: each flush costs
+/// an enclave transition plus a copy to untrusted memory, so the
+/// break-even buffer is far larger than the 8KB `io::BufWriter`
+/// default.
+pub const OCALL_WRITE_BUF_SIZE: usize = 256 * 1024;
+
+/// A write-combining buffered writer tuned for the ocall boundary.
+///
+/// Small writes are accumulated in enclave memory and pushed out in
+/// [`OCALL_WRITE_BUF_SIZE`] batches, so line-at-a-time output costs one
+/// transition per buffer instead of one per line. When the [`aio`]
+/// worker pool is initialized the flush is submitted asynchronously and
+/// the calling thread keeps running while untrusted workers drain it
+/// (at most one flush is in flight, so writes stay ordered); otherwise
+/// the flush is a plain blocking write. An optional
+/// [`flush_interval`] bounds how long a partial buffer may sit unsent,
+/// for output that is tailed while it grows.
+///
+/// The remaining buffer is flushed on drop, but any error is ignored
+/// there; call [`flush`] (or [`into_inner`]) first if errors must be
+/// observed.
+///
+/// [`aio`]: ../aio/index.html
+/// [`flush_interval`]: #method.flush_interval
+/// [`flush`]: #method.flush
+/// [`into_inner`]: #method.into_inner
+pub struct OcallWriter {
+    file: Option<File>,
+    buf: Vec<u8>,
+    capacity: usize,
+    flush_interval: Option<crate::time::Duration>,
+    last_flush: crate::time::Instant,
+    pending: Option<crate::aio::AioHandle>,
+}
+
+impl OcallWriter {
+    /// Wraps `file` with the default [`OCALL_WRITE_BUF_SIZE`] buffer.
+    pub fn new(file: File) -> OcallWriter {
+        OcallWriter::with_capacity(OCALL_WRITE_BUF_SIZE, file)
+    }
+
+    /// Wraps `file` with a buffer of `capacity` bytes.
+    pub fn with_capacity(capacity: usize, file: File) -> OcallWriter {
+        OcallWriter {
+            file: Some(file),
+            buf: Vec::with_capacity(capacity),
+            capacity,
+            flush_interval: None,
+            last_flush: crate::time::Instant::now(),
+            pending: None,
+        }
+    }
+
+    /// Flushes a partial buffer once it is older than `interval`,
+    /// checked on each write. Without an interval a partial buffer
+    /// waits until the threshold is reached or the writer is flushed
+    /// or dropped.
+    pub fn flush_interval(mut self, interval: crate::time::Duration) -> OcallWriter {
+        self.flush_interval = Some(interval);
+        self
+    }
+
+    /// Gets a reference to the underlying file.
+    pub fn get_ref(&self) -> &File {
+        self.file.as_ref().unwrap()
+    }
+
+    /// Flushes the buffer and returns the underlying file.
+    pub fn into_inner(mut self) -> io::Result<File> {
+        self.flush()?;
+        Ok(self.file.take().unwrap())
+    }
+
+    /// Waits for the in-flight asynchronous flush, if any.
+    fn reap(&mut self) -> io::Result<()> {
+        match self.pending.take() {
+            Some(handle) => handle.wait().map(drop),
+            None => Ok(()),
+        }
+    }
+
+    fn flush_buf(&mut self) -> io::Result<()> {
+        if !self.buf.is_empty() {
+            // Only one flush may be outstanding; waiting here keeps the
+            // writes ordered and bounds untrusted memory usage.
+            self.reap()?;
+            let fd = self.file.as_ref().unwrap().as_raw_fd();
+            match crate::aio::submit_write(fd, &self.buf) {
+                Ok(handle) => self.pending = Some(handle),
+                // No aio worker pool (or submit failed): fall back to
+                // the ordinary blocking write.
+                Err(_) => self.file.as_mut().unwrap().write_all(&self.buf)?,
+            }
+            self.buf.clear();
+        }
+        self.last_flush = crate::time::Instant::now();
+        Ok(())
+    }
+}
+
+impl Write for OcallWriter {
+    fn write(&mut self, data: &[u8]) -> io::Result<usize> {
+        if self.buf.len() + data.len() > self.capacity {
+            self.flush_buf()?;
+        }
+        if data.len() >= self.capacity {
+            // Oversized writes go straight through; wait out the
+            // in-flight flush first so the file sees them in order.
+            self.reap()?;
+            self.file.as_mut().unwrap().write(data)
+        } else {
+            self.buf.extend_from_slice(data);
+            if let Some(interval) = self.flush_interval {
+                if self.last_flush.elapsed() >= interval {
+                    self.flush_buf()?;
+                }
+            }
+            Ok(data.len())
+        }
+    }
+
+    fn flush(&mut self) -> io::Result<()> {
+        self.flush_buf()?;
+        self.reap()?;
+        self.file.as_mut().unwrap().flush()
+    }
+}
+
+impl Drop for OcallWriter {
+    fn drop(&mut self) {
+        if self.file.is_some() {
+            let _r = self.flush_buf();
+            let _r = self.reap();
+        }
+    }
+}
+
+impl fmt::Debug for OcallWriter {
+    fn fmt(&self, fmt: &mut fmt::Formatter<'_>) -> fmt::Result {
+        fmt.debug_struct("OcallWriter")
+            .field("file", self.file.as_ref().unwrap())
+            .field("buffer", &format_args!("{}/{}", self.buf.len(), self.capacity))
+            .finish()
+    }
+}
+
+/// A readahead buffered reader tuned for the ocall boundary, the mirror
+/// of [`OcallWriter`].
+///
+/// Data is pulled in [`OCALL_WRITE_BUF_SIZE`] batches through positioned
+/// reads. Once the current buffer is half drained the next batch is
+/// submitted through the [`aio`] worker pool, so the refill runs on an
+/// untrusted worker while the enclave keeps parsing and a sequential
+/// job no longer alternates compute and I/O in lockstep. Without an
+/// initialized worker pool the reader degrades to plain synchronous
+/// batched reads.
+///
+/// The reader tracks its own file offset (starting from the file's
+/// position at construction) and never moves the file's cursor; after
+/// [`into_inner`] the cursor is where it was when the reader was built.
+///
+/// [`aio`]: ../aio/index.html
+/// [`into_inner`]: #method.into_inner
+pub struct OcallReader {
+    file: File,
+    buf: Vec<u8>,
+    next: Vec<u8>,
+    pos: usize,
+    offset: u64,
+    capacity: usize,
+    pending: Option<crate::aio::AioReadHandle>,
+    eof: bool,
+}
+
+impl OcallReader {
+    /// Wraps `file` with the default [`OCALL_WRITE_BUF_SIZE`] buffer.
+    pub fn new(file: File) -> OcallReader {
+        OcallReader::with_capacity(OCALL_WRITE_BUF_SIZE, file)
+    }
+
+    /// Wraps `file` with a buffer of `capacity` bytes per batch.
+    pub fn with_capacity(capacity: usize, mut file: File) -> OcallReader {
+        let offset = file.seek(SeekFrom::Current(0)).unwrap_or(0);
+        OcallReader {
+            file,
+            buf: Vec::new(),
+            next: Vec::new(),
+            pos: 0,
+            offset,
+            capacity,
+            pending: None,
+            eof: false,
+        }
+    }
+
+    /// Gets a reference to the underlying file.
+    pub fn get_ref(&self) -> &File {
+        &self.file
+    }
+
+    /// Discards the buffered data and returns the underlying file.
+    pub fn into_inner(self) -> File {
+        self.file
+    }
+
+    /// Submits the next batch if none is in flight.
+    fn prefetch(&mut self) {
+        if self.pending.is_none() {
+            let fd = self.file.as_raw_fd();
+            // Failure is not an error here: the synchronous path in
+            // refill covers the read, just without the overlap.
+            self.pending = crate::aio::submit_pread64(fd, self.capacity, self.offset).ok();
+        }
+    }
+
+    /// Replaces the drained buffer with the next batch; returns the
+    /// byte count (zero at end of file).
+    fn refill(&mut self) -> io::Result<usize> {
+        let n = match self.pending.take() {
+            Some(handle) => {
+                self.next.resize(self.capacity, 0);
+                let n = handle.wait_into(&mut self.next)?;
+                core::mem::swap(&mut self.buf, &mut self.next);
+                n
+            }
+            None => {
+                self.buf.resize(self.capacity, 0);
+                crate::os::unix::fs::FileExt::read_at(&self.file, &mut self.buf, self.offset)?
+            }
+        };
+        self.buf.truncate(n);
+        self.pos = 0;
+        self.offset += n as u64;
+        self.eof = n == 0;
+        Ok(n)
+    }
+}
+
+impl Read for OcallReader {
+    fn read(&mut self, dst: &mut [u8]) -> io::Result<usize> {
+        if self.pos == self.buf.len() {
+            // Oversized reads bypass the buffer once it is drained.
+            if dst.len() >= self.capacity && self.pending.is_none() {
+                let n = crate::os::unix::fs::FileExt::read_at(&self.file, dst, self.offset)?;
+                self.offset += n as u64;
+                self.eof = n == 0;
+                return Ok(n);
+            }
+            if self.refill()? == 0 {
+                return Ok(0);
+            }
+        }
+        let n = core::cmp::min(self.buf.len() - self.pos, dst.len());
+        dst[..n].copy_from_slice(&self.buf[self.pos..self.pos + n]);
+        self.pos += n;
+        if !self.eof && self.pos * 2 >= self.buf.len() {
+            self.prefetch();
+        }
+        Ok(n)
+    }
+
+    unsafe fn initializer(&self) -> Initializer {
+        Initializer::nop()
+    }
+}
+
+impl fmt::Debug for OcallReader {
+    fn fmt(&self, fmt: &mut fmt::Formatter<'_>) -> fmt::Result {
+        fmt.debug_struct("OcallReader")
+            .field("file", &self.file)
+            .field("buffer", &format_args!("{}/{}", self.buf.len() - self.pos, self.capacity))
+            .finish()
+    }
+}
@@ -336,7 +336,7 @@ impl<W: Write> BufWriter<W> {
             match r {
                 Ok(0) => {
                     ret =
-                        Err(Error::new(ErrorKind::WriteZero, "failed to write the buffered data"));
+                        Err(Error::new_const(ErrorKind::WriteZero, &"failed to write the buffered data"));
                     break;
                 }
                 Ok(n) => written += n,
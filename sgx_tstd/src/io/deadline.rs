@@ -0,0 +1,79 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License..
+
+//! Per-thread ocall deadline for blocking I/O.
+//!
+//! A blocking ocall like `u_recv_ocall` parks the TCS in the untrusted
+//! OS for as long as the host lets it; a stuck peer therefore eats the
+//! TCS for the rest of the request's SLA and beyond. The deadline here
+//! is a per-thread budget that every blocking socket operation in
+//! `sys::net` consults: before entering the ocall, the operation polls
+//! the descriptor with the remaining time and fails with
+//! [`ErrorKind::TimedOut`] when the budget is spent, so a tail-latency
+//! blowup becomes a fast failure inside the enclave.
+//!
+//! The budget composes with per-socket `set_read_timeout`-style
+//! timeouts: whichever bound is tighter fires first. Nesting
+//! [`with_ocall_budget`] never extends an outer deadline.
+//!
+//! [`ErrorKind::TimedOut`]: crate::io::ErrorKind::TimedOut
+
+use core::cell::Cell;
+use crate::time::{Duration, Instant};
+#[cfg(not(feature = "untrusted_time"))]
+use crate::untrusted::time::InstantEx;
+
+thread_local! { static DEADLINE: Cell<Option<Instant>> = Cell::new(None) }
+
+/// Replace the calling thread's ocall deadline, returning the previous
+/// one. `None` removes the bound. Prefer [`with_ocall_budget`], which
+/// restores the previous deadline on exit.
+pub fn set_ocall_deadline(deadline: Option<Instant>) -> Option<Instant> {
+    DEADLINE.with(|c| c.replace(deadline))
+}
+
+/// The calling thread's current ocall deadline, if any.
+pub fn ocall_deadline() -> Option<Instant> {
+    DEADLINE.with(|c| c.get())
+}
+
+/// Time left before the current deadline; `Some(ZERO)` means the
+/// budget is already spent, `None` means no deadline is set.
+pub(crate) fn remaining() -> Option<Duration> {
+    ocall_deadline().map(|d| d.saturating_duration_since(Instant::now()))
+}
+
+/// Run `f` with the thread's blocking I/O bounded by `budget`. An
+/// already-active tighter deadline is kept; the previous deadline is
+/// restored when `f` returns or panics.
+pub fn with_ocall_budget<R, F: FnOnce() -> R>(budget: Duration, f: F) -> R {
+    struct Restore(Option<Instant>);
+    impl Drop for Restore {
+        fn drop(&mut self) {
+            set_ocall_deadline(self.0);
+        }
+    }
+
+    let new = Instant::now() + budget;
+    let prev = ocall_deadline();
+    let effective = match prev {
+        Some(outer) if outer <= new => outer,
+        _ => new,
+    };
+    let _restore = Restore(set_ocall_deadline(Some(effective)));
+    f()
+}
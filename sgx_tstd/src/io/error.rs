@@ -63,6 +63,8 @@ impl fmt::Debug for Error {
 enum Repr {
     Os(i32),
     Simple(ErrorKind),
+    // &str is a fat pointer, but &&str is a thin pointer.
+    SimpleMessage(ErrorKind, &'static &'static str),
     Custom(Box<Custom>),
     SgxStatus(sgx_status_t),
 }
@@ -218,6 +220,19 @@ impl Error {
         Error { repr: Repr::Custom(Box::new(Custom { kind, error })) }
     }
 
+    /// Creates a new I/O error from a known kind of error as well as a
+    /// constant message.
+    ///
+    /// This function does not allocate.
+    ///
+    /// This function should maybe change to
+    /// `new_const<const MSG: &'static str>(kind: ErrorKind)`
+    /// in the future, when const generics allow that.
+    #[inline]
+    pub const fn new_const(kind: ErrorKind, message: &'static &'static str) -> Error {
+        Error { repr: Repr::SimpleMessage(kind, message) }
+    }
+
     /// Returns an error representing the last OS error which occurred.
     ///
     /// This function reads the value of `errno` for the target platform (e.g.
@@ -245,6 +260,7 @@ impl Error {
             Repr::Os(i) => Some(i),
             Repr::Custom(..) => None,
             Repr::Simple(..) => None,
+            Repr::SimpleMessage(..) => None,
             Repr::SgxStatus(..) => None,
         }
     }
@@ -266,6 +282,7 @@ impl Error {
             Repr::Os(..) => None,
             Repr::Custom(..) => None,
             Repr::Simple(..) => None,
+            Repr::SimpleMessage(..) => None,
             Repr::SgxStatus(status) => Some(status),
         }
     }
@@ -279,6 +296,7 @@ impl Error {
         match self.repr {
             Repr::Os(..) => None,
             Repr::Simple(..) => None,
+            Repr::SimpleMessage(..) => None,
             Repr::Custom(ref c) => Some(&*c.error),
             Repr::SgxStatus(ref s) => Some(s),
         }
@@ -294,6 +312,7 @@ impl Error {
         match self.repr {
             Repr::Os(..) => None,
             Repr::Simple(..) => None,
+            Repr::SimpleMessage(..) => None,
             Repr::Custom(ref mut c) => Some(&mut *c.error),
             Repr::SgxStatus(ref mut s) => Some(s),
         }
@@ -308,6 +327,7 @@ impl Error {
         match self.repr {
             Repr::Os(..) => None,
             Repr::Simple(..) => None,
+            Repr::SimpleMessage(..) => None,
             Repr::Custom(c) => Some(c.error),
             Repr::SgxStatus(s) => Some(Box::new(s)),
         }
@@ -320,6 +340,7 @@ impl Error {
             Repr::Os(code) => sys::decode_error_kind(code),
             Repr::Custom(ref c) => c.kind,
             Repr::Simple(kind) => kind,
+            Repr::SimpleMessage(kind, _) => kind,
             Repr::SgxStatus(..) => ErrorKind::SgxError,
         }
     }
@@ -336,6 +357,11 @@ impl fmt::Debug for Repr {
                 .finish(),
             Repr::Custom(ref c) => fmt::Debug::fmt(&c, fmt),
             Repr::Simple(kind) => fmt.debug_tuple("Kind").field(&kind).finish(),
+            Repr::SimpleMessage(kind, &message) => fmt
+                .debug_struct("Error")
+                .field("kind", &kind)
+                .field("message", &message)
+                .finish(),
             Repr::SgxStatus(status) => fmt
                 .debug_struct("Sgx")
                 .field("code", &status)
@@ -354,6 +380,7 @@ impl fmt::Display for Error {
             }
             Repr::Custom(ref c) => c.error.fmt(fmt),
             Repr::Simple(kind) => write!(fmt, "{}", kind.as_str()),
+            Repr::SimpleMessage(_, &message) => message.fmt(fmt),
             Repr::SgxStatus(status) => {
                 let detail = status.__description();
                 write!(fmt, "{} (sgx error: {})", detail, status)
@@ -366,6 +393,7 @@ impl error::Error for Error {
     fn description(&self) -> &str {
         match self.repr {
             Repr::Os(..) | Repr::Simple(..) => self.kind().as_str(),
+            Repr::SimpleMessage(_, &message) => message,
             Repr::Custom(ref c) => c.error.description(),
             Repr::SgxStatus(ref s) => s.description(),
         }
@@ -376,6 +404,7 @@ impl error::Error for Error {
         match self.repr {
             Repr::Os(..) => None,
             Repr::Simple(..) => None,
+            Repr::SimpleMessage(..) => None,
             Repr::Custom(ref c) => c.error.cause(),
             Repr::SgxStatus(ref s) => Some(s),
         }
@@ -385,6 +414,7 @@ impl error::Error for Error {
         match self.repr {
             Repr::Os(..) => None,
             Repr::Simple(..) => None,
+            Repr::SimpleMessage(..) => None,
             Repr::Custom(ref c) => c.error.source(),
             Repr::SgxStatus(ref s) => Some(s),
         }
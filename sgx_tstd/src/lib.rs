@@ -200,8 +200,10 @@ pub mod f64;
 
 #[macro_use]
 pub mod thread;
+pub mod aio;
 pub mod ascii;
 pub mod collections;
+pub mod config;
 pub mod env;
 pub mod error;
 pub mod ffi;
@@ -217,6 +219,9 @@ pub mod path;
 pub mod sync;
 pub mod time;
 pub mod enclave;
+pub mod executor;
+pub mod metrics;
+pub mod partition;
 pub mod untrusted;
 
 pub mod lazy;
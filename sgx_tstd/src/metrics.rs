@@ -0,0 +1,236 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License..
+
+//! Wait-free statistics counters.
+//!
+//! A counter guarded by an `SgxMutex` makes every increment pay a lock
+//! round-trip and bounces the counter's cache line between every TCS
+//! that touches it, which is easily more expensive than the work being
+//! measured. The types here take the opposite trade: updates are a
+//! single relaxed atomic on a cache-line-padded slot picked by the
+//! calling TCS, so concurrently entered threads never contend, and the
+//! cost of aggregation is deferred to the (rare) reader, which walks
+//! the slots and sums them.
+//!
+//! Reads are consequently not a snapshot: a [`StripedCounter::value`]
+//! racing with writers may miss increments that land behind its walk.
+//! That is the usual contract for metrics and is what "lazy
+//! aggregation" buys.
+
+use core::fmt;
+use core::sync::atomic::{AtomicU64, Ordering};
+use sgx_trts::enclave::SgxThreadData;
+
+/// Number of counter slots. Power of two, comfortably above the TCS
+/// counts our enclaves configure, so distinct TCSs map to distinct
+/// slots in practice; two TCSs sharing a slot costs correctness
+/// nothing, only a contended line.
+const COUNTER_STRIPES: usize = 64;
+
+/// One counter slot, padded out to a cache line so neighbouring slots
+/// never false-share (the Rust analogue of `sgx_align_struct_attribute`
+/// on the C side).
+#[repr(align(64))]
+struct CounterSlot {
+    value: AtomicU64,
+}
+
+const COUNTER_SLOT_INIT: CounterSlot = CounterSlot { value: AtomicU64::new(0) };
+
+/// Picks this thread's slot. TCS bases are distinct page-aligned
+/// addresses inside the enclave, so drop the page-offset bits and mix
+/// the rest before masking.
+#[inline]
+fn stripe_index() -> usize {
+    let tcs = SgxThreadData::current().get_tcs();
+    ((tcs >> 12).wrapping_mul(0x9e37_79b9_7f4a_7c15) >> 32) as usize & (COUNTER_STRIPES - 1)
+}
+
+/// A wait-free counter striped across per-TCS slots.
+///
+/// `add` is a relaxed `fetch_add` on the calling TCS's private cache
+/// line; `value` sums the stripes. Suitable as a `static`:
+///
+/// ```
+/// static REQUESTS: StripedCounter = StripedCounter::new();
+/// ```
+pub struct StripedCounter {
+    slots: [CounterSlot; COUNTER_STRIPES],
+}
+
+impl StripedCounter {
+    pub const fn new() -> StripedCounter {
+        StripedCounter { slots: [COUNTER_SLOT_INIT; COUNTER_STRIPES] }
+    }
+
+    /// Adds `n` to the counter. Wait-free; never contends with other
+    /// TCSs.
+    #[inline]
+    pub fn add(&self, n: u64) {
+        self.slots[stripe_index()].value.fetch_add(n, Ordering::Relaxed);
+    }
+
+    /// Increments the counter by one.
+    #[inline]
+    pub fn inc(&self) {
+        self.add(1);
+    }
+
+    /// Sums the stripes. Not a snapshot with respect to concurrent
+    /// writers; increments behind the walk may be missed and picked up
+    /// by the next read.
+    pub fn value(&self) -> u64 {
+        self.slots
+            .iter()
+            .fold(0_u64, |sum, slot| sum.wrapping_add(slot.value.load(Ordering::Relaxed)))
+    }
+
+    /// Resets every stripe to zero. Racing writers may re-increment
+    /// slots already cleared; use only when the writers are quiesced or
+    /// the loss is acceptable.
+    pub fn clear(&self) {
+        for slot in self.slots.iter() {
+            slot.value.store(0, Ordering::Relaxed);
+        }
+    }
+}
+
+impl Default for StripedCounter {
+    fn default() -> StripedCounter {
+        StripedCounter::new()
+    }
+}
+
+impl fmt::Debug for StripedCounter {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        f.debug_struct("StripedCounter").field("value", &self.value()).finish()
+    }
+}
+
+/// Number of histogram buckets: one per power of two of the recorded
+/// value, so bucket `i` counts values in `[2^(i-1), 2^i)` (bucket 0
+/// counts zeros).
+pub const HISTOGRAM_BUCKETS: usize = 65;
+
+/// A wait-free power-of-two histogram.
+///
+/// `observe` is a single relaxed `fetch_add` on the bucket matching the
+/// value's magnitude. The buckets are plain atomics rather than striped
+/// — a striped histogram would cost a cache line per bucket per stripe,
+/// which is real EPC — so pathological workloads where every TCS
+/// records the same magnitude do contend on one line; typical latency
+/// distributions spread across several.
+pub struct Histogram {
+    buckets: [AtomicU64; HISTOGRAM_BUCKETS],
+    sum: StripedCounter,
+}
+
+const HISTOGRAM_BUCKET_INIT: AtomicU64 = AtomicU64::new(0);
+
+impl Histogram {
+    pub const fn new() -> Histogram {
+        Histogram {
+            buckets: [HISTOGRAM_BUCKET_INIT; HISTOGRAM_BUCKETS],
+            sum: StripedCounter::new(),
+        }
+    }
+
+    #[inline]
+    fn bucket_of(value: u64) -> usize {
+        64 - value.leading_zeros() as usize
+    }
+
+    /// Records one observation. Wait-free.
+    #[inline]
+    pub fn observe(&self, value: u64) {
+        self.buckets[Histogram::bucket_of(value)].fetch_add(1, Ordering::Relaxed);
+        self.sum.add(value);
+    }
+
+    /// Total number of observations.
+    pub fn count(&self) -> u64 {
+        self.buckets
+            .iter()
+            .fold(0_u64, |sum, bucket| sum.wrapping_add(bucket.load(Ordering::Relaxed)))
+    }
+
+    /// Sum of all observed values.
+    pub fn sum(&self) -> u64 {
+        self.sum.value()
+    }
+
+    /// Copies the bucket counts out; same non-snapshot caveat as
+    /// [`StripedCounter::value`].
+    pub fn snapshot(&self) -> [u64; HISTOGRAM_BUCKETS] {
+        let mut out = [0_u64; HISTOGRAM_BUCKETS];
+        for (dst, bucket) in out.iter_mut().zip(self.buckets.iter()) {
+            *dst = bucket.load(Ordering::Relaxed);
+        }
+        out
+    }
+
+    /// Upper bound of the bucket containing the `q`-quantile
+    /// (`0.0..=1.0`) of the recorded distribution, or `None` if the
+    /// histogram is empty. Resolution is a factor of two, which is what
+    /// the bucketing pays for its fixed footprint.
+    pub fn quantile(&self, q: f64) -> Option<u64> {
+        let snapshot = self.snapshot();
+        let count: u64 = snapshot.iter().sum();
+        if count == 0 {
+            return None;
+        }
+        let q = if q < 0.0 { 0.0 } else if q > 1.0 { 1.0 } else { q };
+        let rank = (q * (count - 1) as f64) as u64;
+        let mut seen = 0_u64;
+        for (index, bucket) in snapshot.iter().enumerate() {
+            seen += *bucket;
+            if seen > rank {
+                return Some(if index == 0 {
+                    0
+                } else if index >= 64 {
+                    u64::max_value()
+                } else {
+                    (1_u64 << index) - 1
+                });
+            }
+        }
+        None
+    }
+
+    /// Resets every bucket; same caveat as [`StripedCounter::clear`].
+    pub fn clear(&self) {
+        for bucket in self.buckets.iter() {
+            bucket.store(0, Ordering::Relaxed);
+        }
+        self.sum.clear();
+    }
+}
+
+impl Default for Histogram {
+    fn default() -> Histogram {
+        Histogram::new()
+    }
+}
+
+impl fmt::Debug for Histogram {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        f.debug_struct("Histogram")
+            .field("count", &self.count())
+            .field("sum", &self.sum())
+            .finish()
+    }
+}
@@ -37,6 +37,8 @@ mod ip;
 mod addr;
 mod parser;
 #[cfg(feature = "net")]
+pub mod resolver;
+#[cfg(feature = "net")]
 mod tcp;
 #[cfg(feature = "net")]
 mod udp;
@@ -84,6 +86,6 @@ where
         }
     }
     Err(last_err.unwrap_or_else(|| {
-        Error::new(ErrorKind::InvalidInput, "could not resolve to any addresses")
+        Error::new_const(ErrorKind::InvalidInput, &"could not resolve to any addresses")
     }))
 }
\ No newline at end of file
@@ -0,0 +1,285 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License..
+
+//! Minimal in-enclave DNS resolution.
+//!
+//! Name lookups through [`ToSocketAddrs`] run untrusted getaddrinfo, so
+//! both the wire exchange and any resolution cache live outside the
+//! enclave: every lookup is an ocall and the host can rewrite cached
+//! answers at will. This module speaks the DNS wire protocol over TCP
+//! through the existing socket ocalls instead - the response is parsed
+//! and checked (transaction id and question echo) inside the enclave,
+//! and answers are cached in enclave memory with their TTLs, including
+//! negative entries, so repeat lookups cost no transition at all.
+//!
+//! Plain DNS is unauthenticated, so this is not a defense against an
+//! attacker on the network path; it removes the per-lookup ocall and
+//! the host's ability to silently alter previously resolved results.
+//!
+//! Point the resolver at a nameserver once with [`set_nameserver`],
+//! then call [`resolve`]:
+//!
+//! ```
+//! use std::net::resolver;
+//!
+//! resolver::set_nameserver("8.8.8.8:53".parse().unwrap());
+//! let addrs = resolver::resolve("example.com")?;
+//! ```
+//!
+//! [`ToSocketAddrs`]: ../trait.ToSocketAddrs.html
+
+use crate::collections::HashMap;
+use crate::io::{self, Read, Write};
+use crate::lazy::SyncLazy;
+use crate::net::{IpAddr, Ipv4Addr, Ipv6Addr, SocketAddr, TcpStream};
+use crate::string::{String, ToString};
+use crate::sync::SgxMutex;
+use crate::time::{Duration, Instant};
+use crate::vec::Vec;
+use core::convert::TryInto;
+use core::sync::atomic::{AtomicU16, Ordering};
+
+const QTYPE_A: u16 = 1;
+const QTYPE_AAAA: u16 = 28;
+const QCLASS_IN: u16 = 1;
+const RCODE_NXDOMAIN: u8 = 3;
+
+const QUERY_TIMEOUT: Duration = Duration::from_secs(5);
+/// Answers never live longer than this, whatever their TTL says.
+const TTL_CAP: Duration = Duration::from_secs(3600);
+/// How long an NXDOMAIN is remembered.
+const NEGATIVE_TTL: Duration = Duration::from_secs(30);
+/// Floor for absurdly small answer TTLs.
+const MIN_TTL: Duration = Duration::from_secs(5);
+
+struct CacheEntry {
+    /// Empty for a negative entry.
+    addrs: Vec<IpAddr>,
+    expires: Instant,
+}
+
+static NAMESERVER: SyncLazy<SgxMutex<Option<SocketAddr>>> =
+    SyncLazy::new(|| SgxMutex::new(None));
+static CACHE: SyncLazy<SgxMutex<HashMap<String, CacheEntry>>> =
+    SyncLazy::new(|| SgxMutex::new(HashMap::new()));
+static QUERY_ID: AtomicU16 = AtomicU16::new(1);
+
+/// Sets the nameserver used by [`resolve`]. Must be called before the
+/// first lookup; changing it does not invalidate cached answers.
+pub fn set_nameserver(addr: SocketAddr) {
+    *NAMESERVER.lock().unwrap() = Some(addr);
+}
+
+/// Drops all cached answers, positive and negative.
+pub fn flush_cache() {
+    CACHE.lock().unwrap().clear();
+}
+
+/// Resolves `host` to its addresses.
+///
+/// IP literals are returned as-is. Otherwise the cache is consulted
+/// first; on a miss one A query (and, only when that returns no
+/// addresses, one AAAA query) goes to the configured nameserver over
+/// TCP and the outcome is cached for the answer TTL. A name the server
+/// reports as nonexistent yields `NotFound`, remembered for a short
+/// negative TTL.
+pub fn resolve(host: &str) -> io::Result<Vec<IpAddr>> {
+    if let Ok(ip) = host.parse::<IpAddr>() {
+        let mut addrs = Vec::with_capacity(1);
+        addrs.push(ip);
+        return Ok(addrs);
+    }
+
+    let key = host.to_ascii_lowercase();
+    {
+        let cache = CACHE.lock().unwrap();
+        if let Some(entry) = cache.get(&key) {
+            if entry.expires > Instant::now() {
+                return if entry.addrs.is_empty() {
+                    Err(io::Error::new(io::ErrorKind::NotFound, "dns name not found (cached)"))
+                } else {
+                    Ok(entry.addrs.clone())
+                };
+            }
+        }
+    }
+
+    let server = (*NAMESERVER.lock().unwrap()).ok_or_else(|| {
+        io::Error::new(io::ErrorKind::Other, "resolver nameserver is not configured")
+    })?;
+
+    let (mut addrs, mut ttl_secs) = query(&server, host, QTYPE_A)?;
+    if addrs.is_empty() {
+        let aaaa = query(&server, host, QTYPE_AAAA)?;
+        addrs = aaaa.0;
+        ttl_secs = aaaa.1;
+    }
+
+    let ttl = if addrs.is_empty() {
+        NEGATIVE_TTL
+    } else {
+        Duration::from_secs(ttl_secs as u64).min(TTL_CAP).max(MIN_TTL)
+    };
+    CACHE.lock().unwrap().insert(key, CacheEntry {
+        addrs: addrs.clone(),
+        expires: Instant::now() + ttl,
+    });
+
+    if addrs.is_empty() {
+        Err(io::Error::new(io::ErrorKind::NotFound, "dns name not found"))
+    } else {
+        Ok(addrs)
+    }
+}
+
+/// One question to the nameserver over TCP. Returns the addresses of
+/// the matching record type with the smallest answer TTL in seconds;
+/// an NXDOMAIN answer is an empty list, any malformed or mismatched
+/// response is an error.
+fn query(server: &SocketAddr, host: &str, qtype: u16) -> io::Result<(Vec<IpAddr>, u32)> {
+    let id = QUERY_ID.fetch_add(1, Ordering::Relaxed);
+    let msg = encode_query(id, host, qtype)?;
+
+    let mut stream = TcpStream::connect_timeout(server, QUERY_TIMEOUT)?;
+    stream.set_read_timeout(Some(QUERY_TIMEOUT))?;
+    stream.set_write_timeout(Some(QUERY_TIMEOUT))?;
+
+    let mut framed = Vec::with_capacity(msg.len() + 2);
+    framed.extend_from_slice(&(msg.len() as u16).to_be_bytes());
+    framed.extend_from_slice(&msg);
+    stream.write_all(&framed)?;
+
+    let mut len_buf = [0u8; 2];
+    stream.read_exact(&mut len_buf)?;
+    let len = u16::from_be_bytes(len_buf) as usize;
+    let mut resp = vec![0u8; len];
+    stream.read_exact(&mut resp)?;
+
+    parse_response(&resp, &msg, id)
+}
+
+fn bad_response(what: &str) -> io::Error {
+    io::Error::new(io::ErrorKind::InvalidData, what.to_string())
+}
+
+fn encode_query(id: u16, host: &str, qtype: u16) -> io::Result<Vec<u8>> {
+    if host.is_empty() || host.len() > 253 {
+        return Err(io::Error::new(io::ErrorKind::InvalidInput, "invalid host name"));
+    }
+
+    let mut msg = Vec::with_capacity(17 + host.len());
+    msg.extend_from_slice(&id.to_be_bytes());
+    msg.extend_from_slice(&0x0100u16.to_be_bytes()); // flags: RD
+    msg.extend_from_slice(&1u16.to_be_bytes()); // QDCOUNT
+    msg.extend_from_slice(&[0u8; 6]); // AN/NS/ARCOUNT
+
+    for label in host.trim_end_matches('.').split('.') {
+        if label.is_empty() || label.len() > 63 {
+            return Err(io::Error::new(io::ErrorKind::InvalidInput, "invalid host name"));
+        }
+        msg.push(label.len() as u8);
+        msg.extend_from_slice(label.as_bytes());
+    }
+    msg.push(0);
+    msg.extend_from_slice(&qtype.to_be_bytes());
+    msg.extend_from_slice(&QCLASS_IN.to_be_bytes());
+    Ok(msg)
+}
+
+fn parse_response(resp: &[u8], msg: &[u8], id: u16) -> io::Result<(Vec<IpAddr>, u32)> {
+    if resp.len() < 12 {
+        return Err(bad_response("dns response truncated"));
+    }
+    if resp[..2] != id.to_be_bytes() {
+        return Err(bad_response("dns response id mismatch"));
+    }
+    if resp[2] & 0x80 == 0 {
+        return Err(bad_response("dns response is not an answer"));
+    }
+    let rcode = resp[3] & 0x0f;
+    if rcode == RCODE_NXDOMAIN {
+        return Ok((Vec::new(), 0));
+    }
+    if rcode != 0 {
+        return Err(bad_response("dns server returned an error"));
+    }
+    // The question must be echoed verbatim; a response carrying some
+    // other question is not an answer to what was asked.
+    let question = &msg[12..];
+    if u16::from_be_bytes([resp[4], resp[5]]) != 1
+        || resp.len() < 12 + question.len()
+        || &resp[12..12 + question.len()] != question
+    {
+        return Err(bad_response("dns response question mismatch"));
+    }
+
+    let ancount = u16::from_be_bytes([resp[6], resp[7]]) as usize;
+    let mut pos = 12 + question.len();
+    let mut addrs = Vec::new();
+    let mut min_ttl = u32::MAX;
+
+    for _ in 0..ancount {
+        pos = skip_name(resp, pos)?;
+        if pos + 10 > resp.len() {
+            return Err(bad_response("dns answer truncated"));
+        }
+        let rtype = u16::from_be_bytes([resp[pos], resp[pos + 1]]);
+        let class = u16::from_be_bytes([resp[pos + 2], resp[pos + 3]]);
+        let ttl = u32::from_be_bytes([resp[pos + 4], resp[pos + 5], resp[pos + 6], resp[pos + 7]]);
+        let rdlen = u16::from_be_bytes([resp[pos + 8], resp[pos + 9]]) as usize;
+        pos += 10;
+        if pos + rdlen > resp.len() {
+            return Err(bad_response("dns answer truncated"));
+        }
+        if class == QCLASS_IN {
+            if rtype == QTYPE_A && rdlen == 4 {
+                let octets: [u8; 4] = resp[pos..pos + 4].try_into().unwrap();
+                addrs.push(IpAddr::V4(Ipv4Addr::from(octets)));
+                min_ttl = min_ttl.min(ttl);
+            } else if rtype == QTYPE_AAAA && rdlen == 16 {
+                let octets: [u8; 16] = resp[pos..pos + 16].try_into().unwrap();
+                addrs.push(IpAddr::V6(Ipv6Addr::from(octets)));
+                min_ttl = min_ttl.min(ttl);
+            }
+            // CNAMEs need no handling of their own: the server includes
+            // the chased address records in the same answer section.
+        }
+        pos += rdlen;
+    }
+    if min_ttl == u32::MAX {
+        min_ttl = 0;
+    }
+    Ok((addrs, min_ttl))
+}
+
+/// Advances past a possibly compressed domain name.
+fn skip_name(resp: &[u8], mut pos: usize) -> io::Result<usize> {
+    loop {
+        let len = *resp.get(pos).ok_or_else(|| bad_response("dns name truncated"))? as usize;
+        if len == 0 {
+            return Ok(pos + 1);
+        }
+        if len & 0xc0 == 0xc0 {
+            // compression pointer: two bytes, ends the name
+            if pos + 2 > resp.len() {
+                return Err(bad_response("dns name truncated"));
+            }
+            return Ok(pos + 2);
+        }
+        pos += 1 + len;
+    }
+}
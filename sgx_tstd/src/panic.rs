@@ -34,7 +34,7 @@ use alloc_crate::boxed::Box;
 use alloc_crate::rc::Rc;
 use alloc_crate::sync::Arc;
 
-pub use crate::panicking::{set_panic_handler, take_panic_handler};
+pub use crate::panicking::{set_panic_abort, set_panic_handler, take_panic_handler, with_panic_abort};
 pub use core::panic::{Location, PanicInfo};
 
 /// A marker trait which represents "panic safe" types in Rust.
@@ -159,6 +159,43 @@ fn panic_handler(info: &PanicInfo<'_>) {
     handler(info);
 }
 
+/// Per-thread fast-fail switch: while set, a panic on this thread runs
+/// the panic handler (so the fault is still reported) and then aborts
+/// the enclave without unwinding. ECALLs that never catch_unwind can
+/// run under this and skip the whole landing-pad machinery; the TCS is
+/// torn down by the abort either way.
+///
+/// Enabling this is a statement that nothing on the current call stack
+/// relies on drops running during a panic.
+pub fn set_panic_abort(enabled: bool) -> bool {
+    use core::cell::Cell;
+    thread_local! { static PANIC_ABORT: Cell<bool> = Cell::new(false) }
+
+    PANIC_ABORT.with(|c| c.replace(enabled))
+}
+
+fn panic_abort_enabled() -> bool {
+    let enabled = set_panic_abort(false);
+    if enabled {
+        set_panic_abort(true);
+    }
+    enabled
+}
+
+/// Run `f` with the fast-fail panic strategy enabled, restoring the
+/// previous strategy afterwards. Intended as the top-level wrapper of
+/// an ECALL body marked fast-fail.
+pub fn with_panic_abort<R, F: FnOnce() -> R>(f: F) -> R {
+    struct Restore(bool);
+    impl Drop for Restore {
+        fn drop(&mut self) {
+            set_panic_abort(self.0);
+        }
+    }
+    let _restore = Restore(set_panic_abort(true));
+    f()
+}
+
 pub fn update_panic_count(amt: isize) -> usize {
     use core::cell::Cell;
     thread_local! { static PANIC_COUNT: Cell<usize> = Cell::new(0) }
@@ -411,6 +448,13 @@ fn rust_panic_with_hook(
     info.set_payload(payload.get());
     panic_handler(&info);
 
+    if panic_abort_enabled() {
+        // fast-fail ECALL: the fault is reported, now abort instead of
+        // unwinding - no landing pads run, no drops, no catch_unwind
+        util::dumb_print(format_args!("thread panicked in fast-fail mode. aborting.\n"));
+        rsgx_abort()
+    }
+
     if panics > 1 {
         // If a thread panics while it's already unwinding then we
         // have limited options. Currently our preference is to
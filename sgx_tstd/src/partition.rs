@@ -0,0 +1,243 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License..
+
+//! Shared-nothing per-TCS runtime partitioning.
+//!
+//! The default std plumbing is shared-everything: one heap lock, one
+//! set of global tables, stats behind atomics every worker contends
+//! on. A partitioned engine that stops scaling on those locks can
+//! instead give each worker TCS a [`Partition`]: its own bump arena
+//! and per-TCS allocation cache so steady-state allocation never
+//! takes the shared heap lock, its own epoll reactor fd so no two
+//! workers share an interest list, and plain unsynchronized counters
+//! for stats. The only cross-partition communication is explicit
+//! message passing through per-partition mailboxes.
+//!
+//! This is a mode, not a replacement: code that doesn't opt in keeps
+//! using the shared allocator and reactors unchanged. A partition's
+//! stats become visible to other threads only when its owner calls
+//! [`Partition::publish_stats`]; the published slot has a single
+//! writer, so observers never contend with the worker.
+
+use crate::io;
+use crate::metrics::StripedCounter;
+use crate::sync::{Once, SgxMutex};
+use alloc_crate::collections::VecDeque;
+use alloc_crate::vec::Vec;
+use core::sync::atomic::{AtomicU64, Ordering};
+use sgx_alloc::arena::Arena;
+use sgx_alloc::tcache;
+use sgx_trts::libc::ocall::{close, epoll_create1};
+use sgx_types::c_int;
+
+/// Upper bound on concurrently live partitions; one per worker TCS.
+pub const MAX_PARTITIONS: usize = 64;
+/// Messages a partition's mailbox holds before senders are refused.
+pub const MAILBOX_CAPACITY: usize = 1024;
+
+/// Per-partition counters. Plain fields, owned and written by exactly
+/// one TCS; extend-by-convention as the engine needs (the `custom`
+/// slots are for the application's own meaning).
+#[derive(Copy, Clone, Default, Debug)]
+pub struct PartitionStats {
+    pub requests: u64,
+    pub bytes_in: u64,
+    pub bytes_out: u64,
+    pub errors: u64,
+    pub custom: [u64; 4],
+}
+
+const STAT_SLOTS: usize = 8;
+
+struct PublishedStats {
+    slots: [AtomicU64; STAT_SLOTS],
+}
+
+struct Registry {
+    free_ids: SgxMutex<Vec<usize>>,
+    mailboxes: Vec<SgxMutex<VecDeque<Vec<u8>>>>,
+    published: Vec<PublishedStats>,
+    /// Messages refused because a mailbox was full; shared-nothing
+    /// ends at the mailbox, so this one counter stays striped.
+    pub send_overflow: StripedCounter,
+}
+
+fn registry() -> &'static Registry {
+    static INIT: Once = Once::new();
+    static mut REGISTRY: Option<Registry> = None;
+    unsafe {
+        INIT.call_once(|| {
+            let mut mailboxes = Vec::with_capacity(MAX_PARTITIONS);
+            let mut published = Vec::with_capacity(MAX_PARTITIONS);
+            for _ in 0..MAX_PARTITIONS {
+                mailboxes.push(SgxMutex::new(VecDeque::new()));
+                published.push(PublishedStats {
+                    slots: [
+                        AtomicU64::new(0),
+                        AtomicU64::new(0),
+                        AtomicU64::new(0),
+                        AtomicU64::new(0),
+                        AtomicU64::new(0),
+                        AtomicU64::new(0),
+                        AtomicU64::new(0),
+                        AtomicU64::new(0),
+                    ],
+                });
+            }
+            REGISTRY = Some(Registry {
+                free_ids: SgxMutex::new((0..MAX_PARTITIONS).rev().collect()),
+                mailboxes,
+                published,
+                send_overflow: StripedCounter::new(),
+            });
+        });
+        REGISTRY.as_ref().unwrap()
+    }
+}
+
+/// One worker's shared-nothing slice of the runtime. Create it on the
+/// worker's own TCS and keep it for the worker's lifetime; dropping it
+/// returns the id, flushes the allocation cache and closes the reactor.
+pub struct Partition {
+    id: usize,
+    arena: Arena,
+    reactor: Option<c_int>,
+    pub stats: PartitionStats,
+}
+
+impl Partition {
+    /// Claims a partition on the calling TCS and enables the per-TCS
+    /// allocation cache, so small steady-state allocations stop taking
+    /// the shared heap lock.
+    ///
+    /// Fails with `WouldBlock` when all [`MAX_PARTITIONS`] ids are
+    /// taken.
+    pub fn enter() -> io::Result<Partition> {
+        let id = registry()
+            .free_ids
+            .lock()
+            .unwrap()
+            .pop()
+            .ok_or_else(|| io::Error::from(io::ErrorKind::WouldBlock))?;
+
+        tcache::enable(true);
+
+        Ok(Partition {
+            id,
+            arena: Arena::new(),
+            reactor: None,
+            stats: PartitionStats::default(),
+        })
+    }
+
+    pub fn id(&self) -> usize {
+        self.id
+    }
+
+    /// The partition's bump arena for request-lifetime allocations;
+    /// reset it between requests.
+    pub fn arena(&mut self) -> &mut Arena {
+        &mut self.arena
+    }
+
+    /// The partition's private epoll fd, created on first use. Each
+    /// worker drives its own interest list, so readiness never routes
+    /// through a reactor another TCS is mutating.
+    pub fn reactor_fd(&mut self) -> io::Result<c_int> {
+        if let Some(fd) = self.reactor {
+            return Ok(fd);
+        }
+        let fd = unsafe { epoll_create1(0) };
+        if fd < 0 {
+            return Err(io::Error::last_os_error());
+        }
+        self.reactor = Some(fd);
+        Ok(fd)
+    }
+
+    /// Copies the partition's counters into its published slot. The
+    /// slot has this TCS as its only writer; observers read through
+    /// [`stats_of`] without contending with the worker. Individual
+    /// counters are consistent, the set as a whole is approximate.
+    pub fn publish_stats(&self) {
+        let slots = &registry().published[self.id].slots;
+        slots[0].store(self.stats.requests, Ordering::Relaxed);
+        slots[1].store(self.stats.bytes_in, Ordering::Relaxed);
+        slots[2].store(self.stats.bytes_out, Ordering::Relaxed);
+        slots[3].store(self.stats.errors, Ordering::Relaxed);
+        for i in 0..self.stats.custom.len() {
+            slots[4 + i].store(self.stats.custom[i], Ordering::Relaxed);
+        }
+    }
+
+    /// Sends a message to another partition's mailbox. Refuses with
+    /// `WouldBlock` when the target mailbox is at capacity and with
+    /// `NotFound` for an id outside the partition range; a refused
+    /// message is dropped, so clone first if it must survive refusal.
+    pub fn send_to(&self, target: usize, msg: Vec<u8>) -> io::Result<()> {
+        if target >= MAX_PARTITIONS {
+            return Err(io::Error::from(io::ErrorKind::NotFound));
+        }
+        let mut mailbox = registry().mailboxes[target].lock().unwrap();
+        if mailbox.len() >= MAILBOX_CAPACITY {
+            registry().send_overflow.add(1);
+            return Err(io::Error::from(io::ErrorKind::WouldBlock));
+        }
+        mailbox.push_back(msg);
+        Ok(())
+    }
+
+    /// Takes the oldest message from this partition's mailbox, if any.
+    /// Non-blocking by design: a shared-nothing worker polls its
+    /// mailbox from its own loop instead of sleeping on shared state.
+    pub fn try_recv(&self) -> Option<Vec<u8>> {
+        registry().mailboxes[self.id].lock().unwrap().pop_front()
+    }
+}
+
+impl Drop for Partition {
+    fn drop(&mut self) {
+        self.publish_stats();
+        tcache::flush();
+        if let Some(fd) = self.reactor.take() {
+            unsafe {
+                close(fd);
+            }
+        }
+        registry().mailboxes[self.id].lock().unwrap().clear();
+        registry().free_ids.lock().unwrap().push(self.id);
+    }
+}
+
+/// Reads the stats a partition last published. Returns zeroes for a
+/// partition that never published. Single-writer slots: each counter
+/// is consistent, the set is approximate.
+pub fn stats_of(id: usize) -> Option<PartitionStats> {
+    if id >= MAX_PARTITIONS {
+        return None;
+    }
+    let slots = &registry().published[id].slots;
+    let mut stats = PartitionStats::default();
+    stats.requests = slots[0].load(Ordering::Relaxed);
+    stats.bytes_in = slots[1].load(Ordering::Relaxed);
+    stats.bytes_out = slots[2].load(Ordering::Relaxed);
+    stats.errors = slots[3].load(Ordering::Relaxed);
+    for i in 0..stats.custom.len() {
+        stats.custom[i] = slots[4 + i].load(Ordering::Relaxed);
+    }
+    Some(stats)
+}
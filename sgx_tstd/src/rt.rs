@@ -77,3 +77,162 @@ global_dtors_object! {
     GLOBAL_DTORS, global_exit = { cleanup(); }
 }
 
+/// Staged enclave initialization with declared dependencies.
+///
+/// The constructors registered through `global_ctors_object!` run
+/// strictly sequentially on the first ecall's TCS, so an enclave whose
+/// startup is dominated by independent work - crypto self-tests,
+/// arena pre-faulting, config unsealing - pays for it serially. Tasks
+/// registered here instead form a dependency graph that any number of
+/// early TCSs can drain concurrently: each call to [`run_init_tasks`]
+/// claims ready tasks (all dependencies completed) until none remain,
+/// so wiring a handful of warm-up ecalls onto spare TCSs runs
+/// independent stages in parallel while ordered stages still observe
+/// their prerequisites.
+///
+/// A dependency must name a registered task. If a stall is detected -
+/// nothing running and nothing ready while tasks are still pending,
+/// i.e. a cycle or a missing dependency - the pending tasks are run in
+/// registration order rather than deadlocking the first ecall.
+mod init_task {
+    use alloc_crate::vec::Vec;
+    use crate::sync::SgxSpinlock;
+    use crate::thread;
+
+    #[derive(Copy, Clone, PartialEq, Eq)]
+    enum TaskState {
+        Pending,
+        Running,
+        Done,
+    }
+
+    struct TaskEntry {
+        name: &'static str,
+        deps: &'static [&'static str],
+        func: fn(),
+        state: TaskState,
+    }
+
+    static TASK_LOCK: SgxSpinlock = SgxSpinlock::new();
+    static mut TASKS: Option<Vec<TaskEntry>> = None;
+
+    fn with_tasks<F, R>(f: F) -> R
+    where
+        F: FnOnce(&mut Vec<TaskEntry>) -> R,
+    {
+        let _guard = TASK_LOCK.lock();
+        unsafe {
+            if TASKS.is_none() {
+                TASKS = Some(Vec::new());
+            }
+            f(TASKS.as_mut().unwrap())
+        }
+    }
+
+    pub fn register(name: &'static str, deps: &'static [&'static str], func: fn()) {
+        with_tasks(|tasks| {
+            tasks.push(TaskEntry {
+                name,
+                deps,
+                func,
+                state: TaskState::Pending,
+            });
+        });
+    }
+
+    fn deps_done(tasks: &[TaskEntry], entry: &TaskEntry) -> bool {
+        entry.deps.iter().all(|dep| {
+            tasks
+                .iter()
+                .find(|t| t.name == *dep)
+                .map(|t| t.state == TaskState::Done)
+                .unwrap_or(false)
+        })
+    }
+
+    // Claims one runnable task, or reports whether anything is still
+    // pending/running so the caller knows to spin or give up.
+    fn claim_next() -> (Option<usize>, bool) {
+        with_tasks(|tasks| {
+            let mut busy = false;
+            let mut claimed = None;
+            let mut stalled_pending = None;
+
+            for index in 0..tasks.len() {
+                match tasks[index].state {
+                    TaskState::Done => continue,
+                    TaskState::Running => busy = true,
+                    TaskState::Pending => {
+                        if deps_done(tasks, &tasks[index]) {
+                            claimed = Some(index);
+                            break;
+                        }
+                        if stalled_pending.is_none() {
+                            stalled_pending = Some(index);
+                        }
+                    }
+                }
+            }
+
+            // Nothing ready, nothing running, but work pending: the
+            // graph cannot make progress. Run the stalled task anyway
+            // so a cycle or missing dependency degrades to the old
+            // sequential behavior instead of hanging the first ecall.
+            if claimed.is_none() && !busy {
+                claimed = stalled_pending;
+            }
+
+            if let Some(index) = claimed {
+                tasks[index].state = TaskState::Running;
+            }
+            (claimed, busy)
+        })
+    }
+
+    pub fn run_pending() -> usize {
+        let mut ran = 0;
+        loop {
+            let (claimed, busy) = claim_next();
+            match claimed {
+                Some(index) => {
+                    let func = with_tasks(|tasks| tasks[index].func);
+                    func();
+                    with_tasks(|tasks| tasks[index].state = TaskState::Done);
+                    ran += 1;
+                }
+                None if busy => {
+                    // Another TCS is running a task our remaining ones
+                    // may depend on; yield until it settles.
+                    thread::yield_now();
+                }
+                None => return ran,
+            }
+        }
+    }
+
+    pub fn finished() -> bool {
+        with_tasks(|tasks| tasks.iter().all(|t| t.state == TaskState::Done))
+    }
+}
+
+/// Registers an initialization task. Tasks are claimed by the TCSs
+/// draining the graph in [`run_init_tasks`]; `deps` lists the names of
+/// tasks that must have completed before this one may start.
+pub fn register_init_task(name: &'static str, deps: &'static [&'static str], func: fn()) {
+    init_task::register(name, deps, func);
+}
+
+/// Drains the registered init tasks, claiming every task whose
+/// dependencies are satisfied and yielding while other TCSs hold the
+/// remaining ones. Call this from warm-up ecalls on as many TCSs as
+/// should share the startup work; it returns the number of tasks this
+/// thread ran, once the whole graph has completed.
+pub fn run_init_tasks() -> usize {
+    init_task::run_pending()
+}
+
+/// Whether every registered init task has completed.
+pub fn init_tasks_finished() -> bool {
+    init_task::finished()
+}
+
@@ -0,0 +1,208 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License..
+
+//! A bounded lock-free work-stealing deque (Chase-Lev).
+//!
+//! Each enclave worker thread owns one [`SgxWorker`] and pushes and pops
+//! tasks at the bottom of its deque without synchronization in the common
+//! case; other threads take tasks from the top through cloned
+//! [`SgxStealer`] handles. Pop and steal only contend on the last
+//! remaining task.
+//!
+//! The deque is fixed-capacity: the buffer is allocated once and never
+//! grows, so no concurrent reclamation scheme is needed and the memory
+//! footprint inside the EPC is known up front. [`SgxWorker::push`] hands
+//! the task back when the deque is full and the caller decides whether to
+//! run it inline or park.
+
+use core::cell::UnsafeCell;
+use core::fmt;
+use core::mem::MaybeUninit;
+use core::sync::atomic::{fence, AtomicIsize, Ordering};
+use alloc_crate::boxed::Box;
+use alloc_crate::sync::Arc;
+use alloc_crate::vec::Vec;
+
+struct Inner<T> {
+    /// Next slot the owner pushes into; only the owner writes it.
+    bottom: AtomicIsize,
+    /// Next slot stealers take from; advanced by CAS.
+    top: AtomicIsize,
+    buffer: Box<[UnsafeCell<MaybeUninit<T>>]>,
+    mask: isize,
+}
+
+unsafe impl<T: Send> Send for Inner<T> {}
+unsafe impl<T: Send> Sync for Inner<T> {}
+
+impl<T> Inner<T> {
+    unsafe fn read(&self, index: isize) -> T {
+        (*self.buffer[(index & self.mask) as usize].get()).as_ptr().read()
+    }
+
+    unsafe fn write(&self, index: isize, value: T) {
+        (*self.buffer[(index & self.mask) as usize].get()).as_mut_ptr().write(value);
+    }
+}
+
+impl<T> Drop for Inner<T> {
+    fn drop(&mut self) {
+        let top = self.top.load(Ordering::Relaxed);
+        let bottom = self.bottom.load(Ordering::Relaxed);
+        for index in top..bottom {
+            unsafe { drop(self.read(index)); }
+        }
+    }
+}
+
+/// The result of a steal attempt.
+#[derive(PartialEq, Eq, Debug)]
+pub enum Steal<T> {
+    /// The deque was empty.
+    Empty,
+    /// A task was taken.
+    Success(T),
+    /// The attempt lost a race and should be retried.
+    Retry,
+}
+
+/// The owner end of a deque. Not `Clone`: exactly one thread pushes and
+/// pops at the bottom.
+pub struct SgxWorker<T> {
+    inner: Arc<Inner<T>>,
+}
+
+unsafe impl<T: Send> Send for SgxWorker<T> {}
+
+/// The stealing end of a deque; clone one per thread that may steal.
+pub struct SgxStealer<T> {
+    inner: Arc<Inner<T>>,
+}
+
+unsafe impl<T: Send> Send for SgxStealer<T> {}
+unsafe impl<T: Send> Sync for SgxStealer<T> {}
+
+/// Creates a deque holding at most `capacity` tasks (rounded up to a power
+/// of two) and returns its two endpoints.
+pub fn work_steal_deque<T>(capacity: usize) -> (SgxWorker<T>, SgxStealer<T>) {
+    let capacity = capacity.next_power_of_two();
+    let buffer: Vec<UnsafeCell<MaybeUninit<T>>> =
+        (0..capacity).map(|_| UnsafeCell::new(MaybeUninit::uninit())).collect();
+
+    let inner = Arc::new(Inner {
+        bottom: AtomicIsize::new(0),
+        top: AtomicIsize::new(0),
+        buffer: buffer.into_boxed_slice(),
+        mask: capacity as isize - 1,
+    });
+
+    (SgxWorker { inner: inner.clone() }, SgxStealer { inner: inner })
+}
+
+impl<T> SgxWorker<T> {
+    /// Pushes a task onto the bottom of the deque, or returns it when the
+    /// deque is full.
+    pub fn push(&self, value: T) -> Result<(), T> {
+        let bottom = self.inner.bottom.load(Ordering::Relaxed);
+        let top = self.inner.top.load(Ordering::Acquire);
+
+        if bottom - top > self.inner.mask {
+            return Err(value);
+        }
+
+        unsafe { self.inner.write(bottom, value); }
+        self.inner.bottom.store(bottom + 1, Ordering::Release);
+        Ok(())
+    }
+
+    /// Pops a task from the bottom of the deque.
+    pub fn pop(&self) -> Option<T> {
+        let bottom = self.inner.bottom.load(Ordering::Relaxed) - 1;
+        self.inner.bottom.store(bottom, Ordering::Relaxed);
+        fence(Ordering::SeqCst);
+        let top = self.inner.top.load(Ordering::Relaxed);
+
+        if top > bottom {
+            // Deque was empty; restore bottom.
+            self.inner.bottom.store(bottom + 1, Ordering::Relaxed);
+            return None;
+        }
+
+        let value = unsafe { self.inner.read(bottom) };
+        if top == bottom {
+            // Last task: race stealers for it through top.
+            let won = self.inner.top
+                .compare_exchange(top, top + 1, Ordering::SeqCst, Ordering::Relaxed)
+                .is_ok();
+            self.inner.bottom.store(bottom + 1, Ordering::Relaxed);
+            if !won {
+                // A stealer took it; the value read above is stale.
+                core::mem::forget(value);
+                return None;
+            }
+        }
+        Some(value)
+    }
+
+    /// Returns true when the deque currently holds no tasks.
+    pub fn is_empty(&self) -> bool {
+        let bottom = self.inner.bottom.load(Ordering::Relaxed);
+        let top = self.inner.top.load(Ordering::Relaxed);
+        top >= bottom
+    }
+}
+
+impl<T> SgxStealer<T> {
+    /// Tries to take a task from the top of the deque.
+    pub fn steal(&self) -> Steal<T> {
+        let top = self.inner.top.load(Ordering::Acquire);
+        fence(Ordering::SeqCst);
+        let bottom = self.inner.bottom.load(Ordering::Acquire);
+
+        if top >= bottom {
+            return Steal::Empty;
+        }
+
+        let value = unsafe { self.inner.read(top) };
+        if self.inner.top
+            .compare_exchange(top, top + 1, Ordering::SeqCst, Ordering::Relaxed)
+            .is_err() {
+            // Lost the race; the owner or another stealer took this slot.
+            core::mem::forget(value);
+            return Steal::Retry;
+        }
+        Steal::Success(value)
+    }
+}
+
+impl<T> Clone for SgxStealer<T> {
+    fn clone(&self) -> SgxStealer<T> {
+        SgxStealer { inner: self.inner.clone() }
+    }
+}
+
+impl<T> fmt::Debug for SgxWorker<T> {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        f.pad("SgxWorker { .. }")
+    }
+}
+
+impl<T> fmt::Debug for SgxStealer<T> {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        f.pad("SgxStealer { .. }")
+    }
+}
@@ -0,0 +1,254 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License..
+
+//! Epoch-based memory reclamation.
+//!
+//! A lock-free structure that unlinks a node cannot free it while
+//! another TCS may still be traversing it, and the enclave has no
+//! crossbeam-epoch to defer the free. This module provides the classic
+//! three-epoch scheme: threads register a participant, [`pin`] marks
+//! the start of a read-side critical section, and [`defer`] queues the
+//! free into the current epoch's garbage bag. The global epoch only
+//! advances when every pinned participant has observed it, so by the
+//! time a bag is emptied no thread can still hold a reference into it -
+//! reclamation never stops the world, it just lags unlinking by two
+//! epochs.
+//!
+//! A pinned participant that stays pinned blocks the epoch (and
+//! therefore reclamation) for everyone, so keep critical sections
+//! short: pin, traverse, unpin.
+//!
+//! ```rust,ignore
+//! let participant = epoch_domain().register();
+//! {
+//!     let guard = participant.pin();
+//!     let node = head.load(Ordering::Acquire);
+//!     // ... unlink node from the structure ...
+//!     unsafe { guard.defer_destroy(node) };
+//! } // unpinned; node is freed two epochs later
+//! ```
+//!
+//! [`pin`]: EpochParticipant::pin
+//! [`defer`]: EpochGuard::defer
+
+use crate::sync::{Once, SgxMutex};
+use alloc_crate::boxed::Box;
+use alloc_crate::sync::Arc;
+use alloc_crate::vec::Vec;
+use core::sync::atomic::{AtomicUsize, Ordering};
+
+/// Try to advance the epoch after this many defers.
+const ADVANCE_PERIOD: usize = 64;
+
+type Deferred = Box<dyn FnOnce() + Send>;
+
+struct Participant {
+    /// Pin nesting depth; zero means not in a critical section.
+    active: AtomicUsize,
+    /// The global epoch this participant last observed while pinned.
+    epoch: AtomicUsize,
+}
+
+struct DomainInner {
+    epoch: AtomicUsize,
+    participants: SgxMutex<Vec<Arc<Participant>>>,
+    /// Bag `e % 3` holds garbage deferred during epoch `e`; advancing
+    /// to epoch `m` drains bag `m % 3`, whose contents are then three
+    /// epochs old.
+    bags: [SgxMutex<Vec<Deferred>>; 3],
+    /// Serializes epoch advancement so two threads never drain the
+    /// same bag.
+    advancing: SgxMutex<()>,
+    defer_count: AtomicUsize,
+}
+
+/// An independent reclamation domain; structures that never share
+/// nodes can use separate domains so one's long critical sections do
+/// not delay the other's reclamation.
+pub struct EpochDomain {
+    inner: Arc<DomainInner>,
+}
+
+/// The process-wide default domain.
+pub fn epoch_domain() -> &'static EpochDomain {
+    static INIT: Once = Once::new();
+    static mut DOMAIN: Option<EpochDomain> = None;
+    unsafe {
+        INIT.call_once(|| {
+            DOMAIN = Some(EpochDomain::new());
+        });
+        DOMAIN.as_ref().unwrap()
+    }
+}
+
+impl EpochDomain {
+    pub fn new() -> EpochDomain {
+        EpochDomain {
+            inner: Arc::new(DomainInner {
+                epoch: AtomicUsize::new(0),
+                participants: SgxMutex::new(Vec::new()),
+                bags: [
+                    SgxMutex::new(Vec::new()),
+                    SgxMutex::new(Vec::new()),
+                    SgxMutex::new(Vec::new()),
+                ],
+                advancing: SgxMutex::new(()),
+                defer_count: AtomicUsize::new(0),
+            }),
+        }
+    }
+
+    /// Registers the calling thread; keep the participant for the
+    /// thread's lifetime and pin through it. Dropping it deregisters.
+    pub fn register(&self) -> EpochParticipant {
+        let participant = Arc::new(Participant {
+            active: AtomicUsize::new(0),
+            epoch: AtomicUsize::new(self.inner.epoch.load(Ordering::SeqCst)),
+        });
+        self.inner
+            .participants
+            .lock()
+            .unwrap()
+            .push(participant.clone());
+        EpochParticipant {
+            domain: self.inner.clone(),
+            participant,
+        }
+    }
+
+    /// Attempts one epoch advance and reclamation step; useful for
+    /// draining garbage at a quiescent point such as shutdown.
+    pub fn try_collect(&self) {
+        self.inner.try_advance();
+    }
+}
+
+impl Default for EpochDomain {
+    fn default() -> EpochDomain {
+        EpochDomain::new()
+    }
+}
+
+impl DomainInner {
+    fn try_advance(&self) {
+        let _advance = match self.advancing.try_lock() {
+            Ok(guard) => guard,
+            // someone else is already advancing; their pass suffices
+            Err(_) => return,
+        };
+
+        let global = self.epoch.load(Ordering::SeqCst);
+        {
+            let participants = self.participants.lock().unwrap();
+            for participant in participants.iter() {
+                if participant.active.load(Ordering::SeqCst) != 0
+                    && participant.epoch.load(Ordering::SeqCst) != global
+                {
+                    // a pinned thread has not observed the current
+                    // epoch yet (or is pinned in an older one)
+                    return;
+                }
+            }
+        }
+
+        let next = global.wrapping_add(1);
+        // drain the bag the new epoch will reuse before publishing the
+        // epoch, so no new-epoch defer can slip into the drained batch
+        let garbage: Vec<Deferred> = {
+            let mut bag = self.bags[next % 3].lock().unwrap();
+            core::mem::replace(&mut *bag, Vec::new())
+        };
+        self.epoch.store(next, Ordering::SeqCst);
+        drop(_advance);
+
+        for deferred in garbage {
+            deferred();
+        }
+    }
+}
+
+/// A registered participant; pin through it to enter a read-side
+/// critical section.
+pub struct EpochParticipant {
+    domain: Arc<DomainInner>,
+    participant: Arc<Participant>,
+}
+
+impl EpochParticipant {
+    /// Enters a critical section: loads guarded pointers only while a
+    /// guard is alive. Nested pins share the outermost epoch.
+    pub fn pin(&self) -> EpochGuard<'_> {
+        let nesting = self.participant.active.fetch_add(1, Ordering::SeqCst);
+        if nesting == 0 {
+            let global = self.domain.epoch.load(Ordering::SeqCst);
+            self.participant.epoch.store(global, Ordering::SeqCst);
+        }
+        EpochGuard { owner: self }
+    }
+}
+
+impl Drop for EpochParticipant {
+    fn drop(&mut self) {
+        let mut participants = self.domain.participants.lock().unwrap();
+        participants.retain(|p| !Arc::ptr_eq(p, &self.participant));
+    }
+}
+
+/// Keeps the owning participant pinned; dropping it leaves the
+/// critical section and periodically triggers reclamation.
+pub struct EpochGuard<'a> {
+    owner: &'a EpochParticipant,
+}
+
+impl<'a> EpochGuard<'a> {
+    /// Runs `f` once every participant that could observe currently
+    /// unlinked nodes has unpinned.
+    pub fn defer<F>(&self, f: F)
+    where
+        F: FnOnce() + Send + 'static,
+    {
+        let domain = &self.owner.domain;
+        let epoch = domain.epoch.load(Ordering::SeqCst);
+        domain.bags[epoch % 3].lock().unwrap().push(Box::new(f));
+        domain.defer_count.fetch_add(1, Ordering::Relaxed);
+    }
+
+    /// Frees `ptr` (a `Box::into_raw` allocation unlinked from the
+    /// structure) once no participant can still reference it.
+    ///
+    /// # Safety
+    ///
+    /// `ptr` must have been produced by `Box::into_raw`, must already
+    /// be unreachable for new readers, and must not be freed elsewhere.
+    pub unsafe fn defer_destroy<T: Send + 'static>(&self, ptr: *mut T) {
+        let ptr = ptr as usize;
+        self.defer(move || {
+            drop(Box::from_raw(ptr as *mut T));
+        });
+    }
+}
+
+impl<'a> Drop for EpochGuard<'a> {
+    fn drop(&mut self) {
+        self.owner.participant.active.fetch_sub(1, Ordering::SeqCst);
+        let domain = &self.owner.domain;
+        if domain.defer_count.load(Ordering::Relaxed) >= ADVANCE_PERIOD {
+            domain.defer_count.store(0, Ordering::Relaxed);
+            domain.try_advance();
+        }
+    }
+}
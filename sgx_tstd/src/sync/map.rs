@@ -0,0 +1,188 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License..
+
+//! A sharded concurrent hash map.
+//!
+//! `SgxMutex<HashMap>` serializes every reader behind one lock, so a
+//! read-mostly in-enclave cache stops scaling at the point where lock
+//! handoff saturates - typically two cores of useful work regardless of
+//! TCS count. [`SgxConcurrentHashMap`] splits the key space over
+//! independent shards, each its own hashbrown table behind an
+//! [`SgxRwLock`]: readers of different keys proceed on different
+//! shards, readers of the same shard share the read lock, and writers
+//! block only their own shard.
+//!
+//! Shard choice reuses the map's hasher, so the shard index costs one
+//! extra mask on the hash the table needs anyway. The shard count is
+//! fixed at construction; cross-shard operations ([`len`], [`clear`],
+//! [`retain`]) lock shards one at a time and therefore observe a
+//! point-in-time view per shard, not a global snapshot - the usual
+//! trade of sharded maps.
+//!
+//! [`len`]: SgxConcurrentHashMap::len
+//! [`clear`]: SgxConcurrentHashMap::clear
+//! [`retain`]: SgxConcurrentHashMap::retain
+//! [`SgxRwLock`]: crate::sync::SgxRwLock
+
+use crate::collections::hash_map::RandomState;
+use crate::collections::HashMap;
+use crate::hash::{BuildHasher, Hash, Hasher};
+use crate::sync::SgxRwLock;
+use alloc_crate::vec::Vec;
+use core::borrow::Borrow;
+
+const DEFAULT_SHARDS: usize = 16;
+
+/// A concurrent hash map sharded over independent reader-writer locks.
+pub struct SgxConcurrentHashMap<K, V, S = RandomState> {
+    shards: Vec<SgxRwLock<HashMap<K, V, S>>>,
+    hash_builder: S,
+    mask: usize,
+}
+
+impl<K: Hash + Eq, V> SgxConcurrentHashMap<K, V, RandomState> {
+    /// Creates a map with the default shard count.
+    pub fn new() -> SgxConcurrentHashMap<K, V, RandomState> {
+        SgxConcurrentHashMap::with_shards(DEFAULT_SHARDS)
+    }
+
+    /// Creates a map with `shards` shards, rounded up to a power of
+    /// two. More shards than concurrently entered TCSs buys nothing.
+    pub fn with_shards(shards: usize) -> SgxConcurrentHashMap<K, V, RandomState> {
+        let count = shards.max(1).next_power_of_two();
+        let mut vec = Vec::with_capacity(count);
+        for _ in 0..count {
+            vec.push(SgxRwLock::new(HashMap::new()));
+        }
+        SgxConcurrentHashMap {
+            shards: vec,
+            hash_builder: RandomState::new(),
+            mask: count - 1,
+        }
+    }
+}
+
+impl<K: Hash + Eq, V> Default for SgxConcurrentHashMap<K, V, RandomState> {
+    fn default() -> SgxConcurrentHashMap<K, V, RandomState> {
+        SgxConcurrentHashMap::new()
+    }
+}
+
+impl<K: Hash + Eq, V, S: BuildHasher> SgxConcurrentHashMap<K, V, S> {
+    fn shard_for<Q: ?Sized>(&self, key: &Q) -> &SgxRwLock<HashMap<K, V, S>>
+    where
+        K: Borrow<Q>,
+        Q: Hash + Eq,
+    {
+        let mut hasher = self.hash_builder.build_hasher();
+        key.hash(&mut hasher);
+        &self.shards[(hasher.finish() as usize) & self.mask]
+    }
+
+    /// Inserts a key-value pair, returning the previous value if the
+    /// key was present. Locks one shard for writing.
+    pub fn insert(&self, key: K, value: V) -> Option<V> {
+        self.shard_for(&key).write().unwrap().insert(key, value)
+    }
+
+    /// Removes a key, returning its value if it was present.
+    pub fn remove<Q: ?Sized>(&self, key: &Q) -> Option<V>
+    where
+        K: Borrow<Q>,
+        Q: Hash + Eq,
+    {
+        self.shard_for(key).write().unwrap().remove(key)
+    }
+
+    /// Returns a clone of the value for `key`. Readers of the same
+    /// shard share the read lock and proceed in parallel.
+    pub fn get<Q: ?Sized>(&self, key: &Q) -> Option<V>
+    where
+        K: Borrow<Q>,
+        Q: Hash + Eq,
+        V: Clone,
+    {
+        self.shard_for(key).read().unwrap().get(key).cloned()
+    }
+
+    /// Applies `f` to the value for `key` under the shard's read lock,
+    /// for values too large to clone per lookup.
+    pub fn get_with<Q: ?Sized, F, R>(&self, key: &Q, f: F) -> Option<R>
+    where
+        K: Borrow<Q>,
+        Q: Hash + Eq,
+        F: FnOnce(&V) -> R,
+    {
+        self.shard_for(key).read().unwrap().get(key).map(f)
+    }
+
+    /// Applies `f` to the value for `key` under the shard's write lock.
+    pub fn update<Q: ?Sized, F, R>(&self, key: &Q, f: F) -> Option<R>
+    where
+        K: Borrow<Q>,
+        Q: Hash + Eq,
+        F: FnOnce(&mut V) -> R,
+    {
+        self.shard_for(key).write().unwrap().get_mut(key).map(f)
+    }
+
+    /// Returns true if the map contains `key`.
+    pub fn contains_key<Q: ?Sized>(&self, key: &Q) -> bool
+    where
+        K: Borrow<Q>,
+        Q: Hash + Eq,
+    {
+        self.shard_for(key).read().unwrap().contains_key(key)
+    }
+
+    /// Sums the shard sizes, locking shards one at a time; concurrent
+    /// writers can change the total while it is being computed.
+    pub fn len(&self) -> usize {
+        self.shards
+            .iter()
+            .map(|shard| shard.read().unwrap().len())
+            .sum()
+    }
+
+    /// Returns true if every shard is empty at the moment it is read.
+    pub fn is_empty(&self) -> bool {
+        self.shards.iter().all(|shard| shard.read().unwrap().is_empty())
+    }
+
+    /// Clears the map shard by shard.
+    pub fn clear(&self) {
+        for shard in self.shards.iter() {
+            shard.write().unwrap().clear();
+        }
+    }
+
+    /// Keeps only the pairs for which `f` returns true, one shard at a
+    /// time.
+    pub fn retain<F>(&self, mut f: F)
+    where
+        F: FnMut(&K, &mut V) -> bool,
+    {
+        for shard in self.shards.iter() {
+            shard.write().unwrap().retain(|k, v| f(k, v));
+        }
+    }
+
+    /// The number of shards, for callers sizing worker counts.
+    pub fn shard_count(&self) -> usize {
+        self.shards.len()
+    }
+}
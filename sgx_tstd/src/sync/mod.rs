@@ -32,18 +32,30 @@ pub use core::sync::atomic;
 
 pub use self::barrier::{Barrier, BarrierWaitResult};
 pub use self::condvar::{SgxCondvar, SgxThreadCondvar, WaitTimeoutResult};
+pub use self::deque::{work_steal_deque, SgxWorker, SgxStealer, Steal};
+pub use self::epoch::{epoch_domain, EpochDomain, EpochGuard, EpochParticipant};
+pub use self::map::SgxConcurrentHashMap;
 pub use self::mutex::{SgxMutex, SgxMutexGuard, SgxThreadMutex};
 pub use self::remutex::{SgxReentrantMutex, SgxReentrantMutexGuard, SgxReentrantThreadMutex};
 pub use self::once::{Once, OnceState, ONCE_INIT};
+pub use self::padded::{CachePadded, SgxPaddedCondvar, SgxPaddedMutex, SgxPaddedRwLock};
 pub use self::rwlock::{SgxRwLock, SgxRwLockReadGuard, SgxRwLockWriteGuard, SgxThreadRwLock};
+pub use self::seqlock::{SgxRcuCell, SgxRcuReadGuard, SgxSeqLock};
 pub use self::spinlock::{SgxSpinlock, SgxSpinlockGuard, SgxThreadSpinlock};
+pub use self::uchannel::{untrusted_channel, UntrustedReceiver, UntrustedSender};
 pub use crate::sys_common::poison::{PoisonError, TryLockError, TryLockResult, LockResult};
 #[cfg(feature = "thread")]
 pub mod mpsc;
 mod barrier;
 mod condvar;
+mod deque;
+mod epoch;
+mod map;
 mod mutex;
 mod remutex;
 mod once;
+mod padded;
 mod rwlock;
+mod seqlock;
 mod spinlock;
+mod uchannel;
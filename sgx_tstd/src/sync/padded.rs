@@ -0,0 +1,328 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License..
+
+//!
+//! Cache-line padded synchronization primitives.
+//!
+//! `SgxMutex` and friends pack their state with no alignment control, so
+//! an array of them - the natural shape of a striped-lock table - lands
+//! several locks on one cache line and every acquisition invalidates its
+//! neighbours' lines. The variants here are aligned and padded to the
+//! 64-byte x86 cache line, so each element of an array owns its lines
+//! outright. They also keep a contention counter, bumped only on the
+//! already-slow path where the lock was observed held, so a striping
+//! scheme can be validated by reading the counters instead of by
+//! guessing from throughput.
+//!
+
+use core::fmt;
+use core::ops::Deref;
+use core::sync::atomic::{AtomicU64, Ordering};
+use crate::sync::{SgxCondvar, SgxMutex, SgxMutexGuard, SgxRwLock, SgxRwLockReadGuard, SgxRwLockWriteGuard};
+use crate::sys_common::poison::{LockResult, TryLockError, TryLockResult};
+
+/// Pads and aligns a value to the length of a cache line.
+///
+/// Useful for hand-rolled per-thread or per-shard state that is written
+/// from one thread and must not share a line with its neighbours.
+#[derive(Default, Clone, Copy, PartialEq, Eq)]
+#[repr(align(64))]
+pub struct CachePadded<T> {
+    value: T,
+}
+
+impl<T> CachePadded<T> {
+    /// Pads and aligns a value to the length of a cache line.
+    pub const fn new(value: T) -> CachePadded<T> {
+        CachePadded { value }
+    }
+
+    /// Returns the inner value.
+    pub fn into_inner(self) -> T {
+        self.value
+    }
+}
+
+impl<T> Deref for CachePadded<T> {
+    type Target = T;
+    fn deref(&self) -> &T {
+        &self.value
+    }
+}
+
+impl<T> core::ops::DerefMut for CachePadded<T> {
+    fn deref_mut(&mut self) -> &mut T {
+        &mut self.value
+    }
+}
+
+impl<T> From<T> for CachePadded<T> {
+    fn from(t: T) -> Self {
+        CachePadded::new(t)
+    }
+}
+
+impl<T: fmt::Debug> fmt::Debug for CachePadded<T> {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        f.debug_struct("CachePadded").field("value", &self.value).finish()
+    }
+}
+
+/// A cache-line padded [`SgxMutex`] with a contention counter.
+///
+/// Layout-wise the lock occupies whole cache lines, so an array of
+/// `SgxPaddedMutex` never false-shares between elements. The counter is
+/// incremented only when `lock` finds the mutex already held, which
+/// costs nothing on the uncontended fast path and makes hot stripes
+/// visible via [`contention_count`].
+///
+/// [`contention_count`]: SgxPaddedMutex::contention_count
+#[repr(align(64))]
+pub struct SgxPaddedMutex<T> {
+    lock: SgxMutex<T>,
+    contended: AtomicU64,
+}
+
+impl<T> SgxPaddedMutex<T> {
+    /// Creates a new padded mutex in an unlocked state ready for use.
+    pub fn new(t: T) -> SgxPaddedMutex<T> {
+        SgxPaddedMutex {
+            lock: SgxMutex::new(t),
+            contended: AtomicU64::new(0),
+        }
+    }
+
+    /// Acquires the mutex, blocking the current thread until it is able
+    /// to do so. Counts the acquisition as contended when the lock was
+    /// observed held on entry.
+    ///
+    /// # Errors
+    ///
+    /// If another user of this mutex panicked while holding the mutex, then
+    /// this call will return an error once the mutex is acquired.
+    pub fn lock(&self) -> LockResult<SgxMutexGuard<'_, T>> {
+        match self.lock.try_lock() {
+            Ok(guard) => Ok(guard),
+            Err(TryLockError::Poisoned(err)) => Err(err),
+            Err(TryLockError::WouldBlock) => {
+                self.contended.fetch_add(1, Ordering::Relaxed);
+                self.lock.lock()
+            }
+        }
+    }
+
+    /// Attempts to acquire this lock without blocking. A `WouldBlock`
+    /// outcome counts as contention.
+    pub fn try_lock(&self) -> TryLockResult<SgxMutexGuard<'_, T>> {
+        let result = self.lock.try_lock();
+        if let Err(TryLockError::WouldBlock) = result {
+            self.contended.fetch_add(1, Ordering::Relaxed);
+        }
+        result
+    }
+
+    /// Returns how many acquisitions found the mutex already held.
+    ///
+    /// In a striped-lock table, a stripe whose count grows much faster
+    /// than its siblings' is a hashing or sizing problem.
+    pub fn contention_count(&self) -> u64 {
+        self.contended.load(Ordering::Relaxed)
+    }
+
+    /// Determines whether the mutex is poisoned.
+    pub fn is_poisoned(&self) -> bool {
+        self.lock.is_poisoned()
+    }
+
+    /// Consumes this mutex, returning the underlying data.
+    pub fn into_inner(self) -> LockResult<T> {
+        self.lock.into_inner()
+    }
+
+    /// Returns a mutable reference to the underlying data; no locking,
+    /// the mutable borrow statically guarantees no guards exist.
+    pub fn get_mut(&mut self) -> LockResult<&mut T> {
+        self.lock.get_mut()
+    }
+}
+
+impl<T: Default> Default for SgxPaddedMutex<T> {
+    fn default() -> SgxPaddedMutex<T> {
+        SgxPaddedMutex::new(Default::default())
+    }
+}
+
+impl<T> From<T> for SgxPaddedMutex<T> {
+    fn from(t: T) -> Self {
+        SgxPaddedMutex::new(t)
+    }
+}
+
+impl<T: fmt::Debug> fmt::Debug for SgxPaddedMutex<T> {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        f.debug_struct("SgxPaddedMutex")
+            .field("lock", &self.lock)
+            .field("contended", &self.contention_count())
+            .finish()
+    }
+}
+
+/// A cache-line padded [`SgxRwLock`] with a contention counter.
+///
+/// The counter covers both sides: a reader blocked by a writer and a
+/// writer blocked by anyone each count one contended acquisition.
+#[repr(align(64))]
+pub struct SgxPaddedRwLock<T> {
+    lock: SgxRwLock<T>,
+    contended: AtomicU64,
+}
+
+impl<T> SgxPaddedRwLock<T> {
+    /// Creates a new padded rwlock in an unlocked state ready for use.
+    pub fn new(t: T) -> SgxPaddedRwLock<T> {
+        SgxPaddedRwLock {
+            lock: SgxRwLock::new(t),
+            contended: AtomicU64::new(0),
+        }
+    }
+
+    /// Locks this rwlock with shared read access, blocking the current
+    /// thread until it can be acquired.
+    pub fn read(&self) -> LockResult<SgxRwLockReadGuard<'_, T>> {
+        match self.lock.try_read() {
+            Ok(guard) => Ok(guard),
+            Err(TryLockError::Poisoned(err)) => Err(err),
+            Err(TryLockError::WouldBlock) => {
+                self.contended.fetch_add(1, Ordering::Relaxed);
+                self.lock.read()
+            }
+        }
+    }
+
+    /// Attempts to acquire this rwlock with shared read access without
+    /// blocking.
+    pub fn try_read(&self) -> TryLockResult<SgxRwLockReadGuard<'_, T>> {
+        let result = self.lock.try_read();
+        if let Err(TryLockError::WouldBlock) = result {
+            self.contended.fetch_add(1, Ordering::Relaxed);
+        }
+        result
+    }
+
+    /// Locks this rwlock with exclusive write access, blocking the
+    /// current thread until it can be acquired.
+    pub fn write(&self) -> LockResult<SgxRwLockWriteGuard<'_, T>> {
+        match self.lock.try_write() {
+            Ok(guard) => Ok(guard),
+            Err(TryLockError::Poisoned(err)) => Err(err),
+            Err(TryLockError::WouldBlock) => {
+                self.contended.fetch_add(1, Ordering::Relaxed);
+                self.lock.write()
+            }
+        }
+    }
+
+    /// Attempts to lock this rwlock with exclusive write access without
+    /// blocking.
+    pub fn try_write(&self) -> TryLockResult<SgxRwLockWriteGuard<'_, T>> {
+        let result = self.lock.try_write();
+        if let Err(TryLockError::WouldBlock) = result {
+            self.contended.fetch_add(1, Ordering::Relaxed);
+        }
+        result
+    }
+
+    /// Returns how many acquisitions found the lock unavailable.
+    pub fn contention_count(&self) -> u64 {
+        self.contended.load(Ordering::Relaxed)
+    }
+
+    /// Determines whether the lock is poisoned.
+    pub fn is_poisoned(&self) -> bool {
+        self.lock.is_poisoned()
+    }
+
+    /// Consumes this rwlock, returning the underlying data.
+    pub fn into_inner(self) -> LockResult<T> {
+        self.lock.into_inner()
+    }
+
+    /// Returns a mutable reference to the underlying data.
+    pub fn get_mut(&mut self) -> LockResult<&mut T> {
+        self.lock.get_mut()
+    }
+}
+
+impl<T: Default> Default for SgxPaddedRwLock<T> {
+    fn default() -> SgxPaddedRwLock<T> {
+        SgxPaddedRwLock::new(Default::default())
+    }
+}
+
+impl<T> From<T> for SgxPaddedRwLock<T> {
+    fn from(t: T) -> Self {
+        SgxPaddedRwLock::new(t)
+    }
+}
+
+impl<T: fmt::Debug> fmt::Debug for SgxPaddedRwLock<T> {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        f.debug_struct("SgxPaddedRwLock")
+            .field("lock", &self.lock)
+            .field("contended", &self.contention_count())
+            .finish()
+    }
+}
+
+/// A cache-line padded [`SgxCondvar`].
+///
+/// A condvar signalled from many threads sits on a hot line; padding it
+/// keeps that traffic away from whatever the compiler laid out next to
+/// it. The full `SgxCondvar` API is available through `Deref`, and its
+/// guards interoperate with [`SgxPaddedMutex`] since the padded mutex
+/// hands out ordinary [`SgxMutexGuard`]s.
+#[repr(align(64))]
+pub struct SgxPaddedCondvar {
+    inner: SgxCondvar,
+}
+
+impl SgxPaddedCondvar {
+    /// Creates a new padded condition variable which is ready to be
+    /// waited on and notified.
+    pub fn new() -> SgxPaddedCondvar {
+        SgxPaddedCondvar { inner: SgxCondvar::new() }
+    }
+}
+
+impl Deref for SgxPaddedCondvar {
+    type Target = SgxCondvar;
+    fn deref(&self) -> &SgxCondvar {
+        &self.inner
+    }
+}
+
+impl Default for SgxPaddedCondvar {
+    fn default() -> SgxPaddedCondvar {
+        SgxPaddedCondvar::new()
+    }
+}
+
+impl fmt::Debug for SgxPaddedCondvar {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        f.pad("SgxPaddedCondvar { .. }")
+    }
+}
@@ -0,0 +1,227 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License..
+
+//!
+//! Read-mostly synchronization: a seqlock and an RCU-style cell.
+//!
+//! Config and routing state inside an enclave is read millions of times
+//! a second and updated rarely, yet every `SgxRwLock::read` still
+//! writes the reader count and bounces that cache line between every
+//! reading TCS. Both types here make the read path write nothing
+//! shared: [`SgxSeqLock`] readers retry the rare read that races a
+//! writer, and [`SgxRcuCell`] readers follow one atomic pointer inside
+//! an epoch critical section while writers publish a fresh value and
+//! retire the old one through the epoch domain.
+//!
+//! Rule of thumb: `SgxSeqLock` for small `Copy` records read by value,
+//! `SgxRcuCell` for anything you want to borrow in place.
+//!
+
+use crate::sync::epoch::{EpochGuard, EpochParticipant};
+use crate::sync::SgxThreadSpinlock;
+use alloc_crate::boxed::Box;
+use core::cell::UnsafeCell;
+use core::fmt;
+use core::ops::Deref;
+use core::ptr;
+use core::sync::atomic::{fence, spin_loop_hint, AtomicPtr, AtomicUsize, Ordering};
+
+/// A sequence lock over a small `Copy` record.
+///
+/// Readers never write shared memory: they sample the sequence counter,
+/// copy the record, and retry only if a writer was active in between,
+/// so concurrent readers scale without bouncing a line. Writers
+/// serialize on an internal spinlock and bump the counter to odd for
+/// the duration of the store.
+///
+/// The record is copied out whole on every read; keep `T` at a few
+/// cache lines at most, or the copy eats what the counter saved.
+pub struct SgxSeqLock<T> {
+    seq: AtomicUsize,
+    writer: SgxThreadSpinlock,
+    data: UnsafeCell<T>,
+}
+
+unsafe impl<T: Copy + Send> Send for SgxSeqLock<T> {}
+unsafe impl<T: Copy + Send> Sync for SgxSeqLock<T> {}
+
+impl<T: Copy> SgxSeqLock<T> {
+    /// Creates a new seqlock holding `t`.
+    pub const fn new(t: T) -> SgxSeqLock<T> {
+        SgxSeqLock {
+            seq: AtomicUsize::new(0),
+            writer: SgxThreadSpinlock::new(),
+            data: UnsafeCell::new(t),
+        }
+    }
+
+    /// Copies the current value out.
+    ///
+    /// Lock-free and wait-free against other readers; retries only
+    /// while a writer holds the sequence odd, which for read-mostly
+    /// state is effectively never.
+    pub fn read(&self) -> T {
+        loop {
+            let start = self.seq.load(Ordering::Acquire);
+            if start & 1 == 0 {
+                // Volatile: the compiler must not cache this read
+                // across the sequence re-check.
+                let val = unsafe { ptr::read_volatile(self.data.get()) };
+                fence(Ordering::Acquire);
+                if self.seq.load(Ordering::Relaxed) == start {
+                    return val;
+                }
+            }
+            spin_loop_hint();
+        }
+    }
+
+    /// Replaces the value.
+    pub fn write(&self, t: T) {
+        self.update(|v| *v = t);
+    }
+
+    /// Updates the value in place under the writer lock.
+    ///
+    /// `f` runs with the sequence odd, so keep it short: every reader
+    /// arriving meanwhile spins until it finishes.
+    pub fn update<F: FnOnce(&mut T)>(&self, f: F) {
+        unsafe {
+            self.writer.lock();
+            let start = self.seq.load(Ordering::Relaxed);
+            self.seq.store(start.wrapping_add(1), Ordering::Relaxed);
+            fence(Ordering::Release);
+            f(&mut *self.data.get());
+            self.seq.store(start.wrapping_add(2), Ordering::Release);
+            self.writer.unlock();
+        }
+    }
+}
+
+impl<T: Copy + Default> Default for SgxSeqLock<T> {
+    fn default() -> SgxSeqLock<T> {
+        SgxSeqLock::new(Default::default())
+    }
+}
+
+impl<T: Copy + fmt::Debug> fmt::Debug for SgxSeqLock<T> {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        f.debug_struct("SgxSeqLock").field("value", &self.read()).finish()
+    }
+}
+
+/// An RCU-style publication cell: one atomic pointer to the current
+/// value, replaced wholesale on update.
+///
+/// Readers pin their [`EpochParticipant`], follow the pointer and
+/// borrow the value in place - no shared write anywhere on the path.
+/// Writers build the new value off to the side, swing the pointer, and
+/// retire the old allocation through the epoch domain, so it is freed
+/// only after every reader that could have seen it has unpinned.
+///
+/// Reads borrow rather than copy, which suits routing tables and parsed
+/// configs too large for [`SgxSeqLock`]. Keep guards short-lived: a
+/// pinned reader delays reclamation for the whole domain.
+pub struct SgxRcuCell<T> {
+    ptr: AtomicPtr<T>,
+}
+
+unsafe impl<T: Send + Sync> Send for SgxRcuCell<T> {}
+unsafe impl<T: Send + Sync> Sync for SgxRcuCell<T> {}
+
+impl<T: Send + Sync + 'static> SgxRcuCell<T> {
+    /// Creates a cell publishing `t`.
+    pub fn new(t: T) -> SgxRcuCell<T> {
+        SgxRcuCell {
+            ptr: AtomicPtr::new(Box::into_raw(Box::new(t))),
+        }
+    }
+
+    /// Borrows the currently published value.
+    ///
+    /// The guard keeps `participant` pinned; the borrow is valid for
+    /// the guard's lifetime even if a writer replaces the value
+    /// meanwhile - the old allocation outlives every pinned reader.
+    pub fn read<'a>(&'a self, participant: &'a EpochParticipant) -> SgxRcuReadGuard<'a, T> {
+        let guard = participant.pin();
+        let ptr = self.ptr.load(Ordering::Acquire);
+        SgxRcuReadGuard {
+            value: unsafe { &*ptr },
+            _guard: guard,
+        }
+    }
+
+    /// Publishes `t` and retires the previous value through the epoch
+    /// domain.
+    pub fn replace(&self, t: T, participant: &EpochParticipant) {
+        let new = Box::into_raw(Box::new(t));
+        let old = self.ptr.swap(new, Ordering::AcqRel);
+        let guard = participant.pin();
+        unsafe {
+            guard.defer_destroy(old);
+        }
+    }
+
+    /// Publishes the result of `f` applied to the current value, for
+    /// read-copy-update of structures built incrementally.
+    ///
+    /// Not atomic against concurrent `replace`/`update` callers: a racing
+    /// write between the read and the publication is overwritten. Updates
+    /// are expected to be rare and serialized by the caller.
+    pub fn update<F: FnOnce(&T) -> T>(&self, f: F, participant: &EpochParticipant) {
+        let new = {
+            let cur = self.read(participant);
+            f(&cur)
+        };
+        self.replace(new, participant);
+    }
+}
+
+impl<T> Drop for SgxRcuCell<T> {
+    fn drop(&mut self) {
+        // Exclusive access: no guard can outlive the cell's borrow.
+        unsafe {
+            drop(Box::from_raw(self.ptr.load(Ordering::Relaxed)));
+        }
+    }
+}
+
+impl<T: Send + Sync + 'static + fmt::Debug> fmt::Debug for SgxRcuCell<T> {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        f.pad("SgxRcuCell { .. }")
+    }
+}
+
+/// Borrow of the value published in an [`SgxRcuCell`]; keeps the
+/// reader's epoch participant pinned while alive.
+pub struct SgxRcuReadGuard<'a, T> {
+    value: &'a T,
+    _guard: EpochGuard<'a>,
+}
+
+impl<'a, T> Deref for SgxRcuReadGuard<'a, T> {
+    type Target = T;
+    fn deref(&self) -> &T {
+        self.value
+    }
+}
+
+impl<'a, T: fmt::Debug> fmt::Debug for SgxRcuReadGuard<'a, T> {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        self.value.fmt(f)
+    }
+}
@@ -0,0 +1,354 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License..
+
+//! Bounded MPSC channel bridging untrusted producers to an enclave
+//! consumer.
+//!
+//! Waking an enclave thread from the host normally means hand-rolled
+//! event.c plumbing. [`untrusted_channel`] packages the pattern: the
+//! ring lives in untrusted memory, producers - host threads through
+//! `u_channel_send` in sgx_ustdc/channel.c, or trusted threads through
+//! the [`UntrustedSender`] half - claim slots with a sequence protocol
+//! and ring the consumer's per-TCS event as a doorbell, and the
+//! receiver is an ordinary blocking iterator inside the enclave with
+//! batch receive. No ecall or ocall sits on the producer fast path; the
+//! consumer ocalls only to park when the ring is empty.
+//!
+//! The ring is hostile input: message bytes cross the boundary
+//! unauthenticated, and every control field is bounds-checked before
+//! use, so a misbehaving producer can corrupt message payloads but not
+//! enclave memory. Hand the host the pointer from
+//! [`UntrustedReceiver::as_raw`]; dropping the receiver closes the
+//! channel and the ring is freed once both halves are gone, after
+//! which the host must not touch it again.
+//!
+//! ```
+//! let (tx, mut rx) = untrusted_channel(1024, 256)?;
+//! // give rx.as_raw() to the host, or send from enclave threads:
+//! tx.send(b"ping")?;
+//! while let Some(msg) = rx.recv() {
+//!     /* ... */
+//! }
+//! ```
+
+use crate::io;
+use crate::sync::Arc;
+use crate::sys::mutex::{thread_set_event, thread_wait_event};
+use crate::time::Duration;
+use crate::vec::Vec;
+use core::mem;
+use core::ptr;
+use core::sync::atomic::{AtomicU32, AtomicU64, Ordering};
+use sgx_libc::{self as libc, c_void};
+use sgx_trts::enclave::SgxThreadData;
+use sgx_trts::trts::rsgx_raw_is_outside_enclave;
+
+/* keep in sync with sgx_ustdc/channel.c */
+#[repr(C)]
+struct ChanHdr {
+    capacity: u64,
+    slot_size: u64,
+    enqueue_pos: AtomicU64,
+    dequeue_pos: AtomicU64,
+    tcs: AtomicU64,
+    waiting: AtomicU32,
+    closed: AtomicU32,
+}
+
+const SLOT_HDR_SIZE: usize = 16; /* seq + len */
+
+/// How long the consumer parks per doorbell wait; bounds the damage of
+/// a doorbell the host chooses not to ring.
+const PARK_TIMEOUT: Duration = Duration::from_millis(100);
+
+struct Ring {
+    hdr: *mut ChanHdr,
+    capacity: u64,
+    slot_size: usize,
+    stride: usize,
+}
+
+unsafe impl Send for Ring {}
+unsafe impl Sync for Ring {}
+
+impl Ring {
+    fn hdr(&self) -> &ChanHdr {
+        unsafe { &*self.hdr }
+    }
+
+    /// Slot base for `pos`; seq at +0, len at +8, payload at +16.
+    fn slot(&self, pos: u64) -> *mut u8 {
+        let idx = (pos & (self.capacity - 1)) as usize;
+        unsafe { (self.hdr.add(1) as *mut u8).add(idx * self.stride) }
+    }
+
+    fn slot_seq(&self, pos: u64) -> &AtomicU64 {
+        unsafe { &*(self.slot(pos) as *const AtomicU64) }
+    }
+}
+
+impl Drop for Ring {
+    fn drop(&mut self) {
+        unsafe {
+            libc::ocall::free(self.hdr as *mut c_void);
+        }
+    }
+}
+
+/// Creates a channel with `capacity` slots (rounded up to a power of
+/// two) of `slot_size` payload bytes each (rounded up to a multiple of
+/// eight). Messages larger than a slot are rejected at send time.
+pub fn untrusted_channel(capacity: usize, slot_size: usize) -> io::Result<(UntrustedSender, UntrustedReceiver)> {
+    if capacity == 0 || slot_size == 0 {
+        return Err(io::Error::from_raw_os_error(libc::EINVAL));
+    }
+    let capacity = capacity.next_power_of_two() as u64;
+    let slot_size = (slot_size + 7) & !7;
+    let stride = SLOT_HDR_SIZE + slot_size;
+    let bytes = mem::size_of::<ChanHdr>() + capacity as usize * stride;
+
+    let hdr = unsafe { libc::ocall::malloc(bytes) } as *mut ChanHdr;
+    if hdr.is_null() {
+        return Err(io::Error::from_raw_os_error(libc::ENOMEM));
+    }
+    if !rsgx_raw_is_outside_enclave(hdr as *const u8, bytes) {
+        unsafe { libc::ocall::free(hdr as *mut c_void) };
+        return Err(io::Error::from_raw_os_error(libc::ESGX));
+    }
+
+    let ring = Ring { hdr, capacity, slot_size, stride };
+    unsafe {
+        ptr::write_volatile(hdr, ChanHdr {
+            capacity,
+            slot_size: slot_size as u64,
+            enqueue_pos: AtomicU64::new(0),
+            dequeue_pos: AtomicU64::new(0),
+            tcs: AtomicU64::new(0),
+            waiting: AtomicU32::new(0),
+            closed: AtomicU32::new(0),
+        });
+        for pos in 0..capacity {
+            ptr::write_volatile(ring.slot(pos) as *mut u64, pos);
+        }
+    }
+
+    let ring = Arc::new(ring);
+    let sender = UntrustedSender { ring: ring.clone() };
+    let receiver = UntrustedReceiver { ring, pos: 0 };
+    Ok((sender, receiver))
+}
+
+/// The producing half; clone it freely across enclave threads. Host
+/// threads produce through `u_channel_send` instead and never touch
+/// this type.
+#[derive(Clone)]
+pub struct UntrustedSender {
+    ring: Arc<Ring>,
+}
+
+impl UntrustedSender {
+    /// Pushes one message. Fails with `WouldBlock` when the ring is
+    /// full, `BrokenPipe` when the channel is closed, `InvalidInput`
+    /// when the message does not fit a slot.
+    pub fn send(&self, data: &[u8]) -> io::Result<()> {
+        let ring = &*self.ring;
+        let hdr = ring.hdr();
+        if data.len() > ring.slot_size {
+            return Err(io::Error::from_raw_os_error(libc::EINVAL));
+        }
+        if hdr.closed.load(Ordering::Acquire) != 0 {
+            return Err(io::Error::from_raw_os_error(libc::EPIPE));
+        }
+
+        let mut pos = hdr.enqueue_pos.load(Ordering::Relaxed);
+        loop {
+            let seq = ring.slot_seq(pos).load(Ordering::Acquire);
+            let diff = seq.wrapping_sub(pos) as i64;
+            if diff == 0 {
+                match hdr.enqueue_pos.compare_exchange_weak(
+                    pos,
+                    pos + 1,
+                    Ordering::Relaxed,
+                    Ordering::Relaxed,
+                ) {
+                    Ok(_) => break,
+                    Err(cur) => pos = cur,
+                }
+            } else if diff < 0 {
+                return Err(io::Error::from_raw_os_error(libc::EAGAIN));
+            } else {
+                pos = hdr.enqueue_pos.load(Ordering::Relaxed);
+            }
+        }
+
+        unsafe {
+            let slot = self.ring.slot(pos);
+            if !data.is_empty() {
+                ptr::copy_nonoverlapping(data.as_ptr(), slot.add(SLOT_HDR_SIZE), data.len());
+            }
+            ptr::write_volatile(slot.add(8) as *mut u64, data.len() as u64);
+        }
+        ring.slot_seq(pos).store(pos + 1, Ordering::Release);
+
+        self.doorbell();
+        Ok(())
+    }
+
+    /// Closes the channel and wakes the consumer; messages already in
+    /// the ring stay receivable.
+    pub fn close(&self) {
+        self.ring.hdr().closed.store(1, Ordering::Release);
+        self.doorbell();
+    }
+
+    fn doorbell(&self) {
+        let hdr = self.ring.hdr();
+        if hdr.waiting.swap(0, Ordering::AcqRel) != 0 {
+            unsafe {
+                thread_set_event(hdr.tcs.load(Ordering::Relaxed) as usize);
+            }
+        }
+    }
+}
+
+/// The consuming half; single-owner inside the enclave. Each received
+/// message is copied into enclave memory before it is returned.
+pub struct UntrustedReceiver {
+    ring: Arc<Ring>,
+    /// The cursor of record. The mirror in the untrusted header exists
+    /// only for producer full-detection; the host rewriting it cannot
+    /// make the consumer skip or replay slots.
+    pos: u64,
+}
+
+unsafe impl Send for UntrustedReceiver {}
+
+impl UntrustedReceiver {
+    /// The ring base pointer, for handing to untrusted producers.
+    pub fn as_raw(&self) -> *mut c_void {
+        self.ring.hdr as *mut c_void
+    }
+
+    /// Pops one message without blocking; `None` when the ring is
+    /// currently empty.
+    pub fn try_recv(&mut self) -> Option<Vec<u8>> {
+        let ring = &self.ring;
+        let seq = ring.slot_seq(self.pos).load(Ordering::Acquire);
+        if seq != self.pos + 1 {
+            return None;
+        }
+
+        let msg = unsafe {
+            let slot = ring.slot(self.pos);
+            let len = ptr::read_volatile(slot.add(8) as *const u64) as usize;
+            // hostile length: clamp to the slot payload
+            let len = len.min(ring.slot_size);
+            let mut msg = vec![0u8; len];
+            if len > 0 {
+                ptr::copy_nonoverlapping(slot.add(SLOT_HDR_SIZE), msg.as_mut_ptr(), len);
+            }
+            msg
+        };
+
+        ring.slot_seq(self.pos).store(self.pos + ring.capacity, Ordering::Release);
+        self.pos += 1;
+        ring.hdr().dequeue_pos.store(self.pos, Ordering::Release);
+        Some(msg)
+    }
+
+    /// Pops one message, parking the thread while the ring is empty;
+    /// `None` once the channel is closed and drained.
+    pub fn recv(&mut self) -> Option<Vec<u8>> {
+        loop {
+            if let Some(msg) = self.try_recv() {
+                return Some(msg);
+            }
+            if self.ring.hdr().closed.load(Ordering::Acquire) != 0 {
+                // drain anything that raced with close
+                return self.try_recv();
+            }
+            self.park();
+        }
+    }
+
+    /// Receives up to `max` messages in one call: blocks for the first
+    /// like [`recv`], then drains without blocking. An empty result
+    /// means closed and drained.
+    ///
+    /// [`recv`]: UntrustedReceiver::recv
+    pub fn recv_batch(&mut self, max: usize) -> Vec<Vec<u8>> {
+        let mut batch = Vec::new();
+        if max == 0 {
+            return batch;
+        }
+        if let Some(msg) = self.recv() {
+            batch.push(msg);
+            while batch.len() < max {
+                match self.try_recv() {
+                    Some(msg) => batch.push(msg),
+                    None => break,
+                }
+            }
+        }
+        batch
+    }
+
+    /// A blocking iterator over messages, ending when the channel is
+    /// closed and drained.
+    pub fn iter(&mut self) -> Iter<'_> {
+        Iter { rx: self }
+    }
+
+    fn park(&mut self) {
+        let hdr = self.ring.hdr();
+        let tcs = SgxThreadData::current().get_tcs();
+        hdr.tcs.store(tcs as u64, Ordering::Relaxed);
+        hdr.waiting.store(1, Ordering::SeqCst);
+        // recheck after announcing, or a message published in between
+        // would be missed until the timeout
+        if self.ring.slot_seq(self.pos).load(Ordering::Acquire) == self.pos + 1
+            || hdr.closed.load(Ordering::Acquire) != 0
+        {
+            hdr.waiting.store(0, Ordering::SeqCst);
+            return;
+        }
+        unsafe {
+            thread_wait_event(tcs, PARK_TIMEOUT);
+        }
+        hdr.waiting.store(0, Ordering::SeqCst);
+    }
+}
+
+/// Iterator returned by [`UntrustedReceiver::iter`].
+pub struct Iter<'a> {
+    rx: &'a mut UntrustedReceiver,
+}
+
+impl<'a> Iterator for Iter<'a> {
+    type Item = Vec<u8>;
+
+    fn next(&mut self) -> Option<Vec<u8>> {
+        self.rx.recv()
+    }
+}
+
+impl Drop for UntrustedReceiver {
+    fn drop(&mut self) {
+        // the ring itself is freed when the last Arc goes away
+        self.ring.hdr().closed.store(1, Ordering::Release);
+    }
+}
@@ -142,7 +142,7 @@ pub mod gnu {
     pub fn get_enclave_filename() -> io::Result<Vec<c_char>> {
         let p = enclave::get_enclave_path();
         let result = match p {
-            None => { Err(Error::new(ErrorKind::Other, "Not implemented")) },
+            None => { Err(Error::new_const(ErrorKind::Other, &"Not implemented")) },
             Some(path) => {
                 let c_str = CString::new(path.as_os_str().as_bytes())?;
                 let c_vec = unsafe{ mem::transmute(c_str.into_bytes_with_nul()) };
@@ -90,7 +90,7 @@ pub trait FileExt {
             }
         }
         if !buf.is_empty() {
-            Err(io::Error::new(io::ErrorKind::UnexpectedEof, "failed to fill whole buffer"))
+            Err(io::Error::new_const(io::ErrorKind::UnexpectedEof, &"failed to fill whole buffer"))
         } else {
             Ok(())
         }
@@ -156,6 +156,19 @@ pub trait FileExt {
         }
         Ok(())
     }
+
+    /// Manipulates file space for the byte range `offset..offset + len`.
+    ///
+    /// With `mode` 0 the range is preallocated, so subsequent appends
+    /// grow into contiguous extents; other `FALLOC_FL_*` modes punch
+    /// holes or zero ranges. See `fallocate(2)`.
+    fn fallocate(&self, mode: i32, offset: u64, len: u64) -> io::Result<()>;
+
+    /// Announces the intended access pattern for the byte range
+    /// `offset..offset + len` (`POSIX_FADV_SEQUENTIAL`,
+    /// `POSIX_FADV_DONTNEED`, ...), letting the kernel tune readahead
+    /// and page-cache retention. See `posix_fadvise(2)`.
+    fn fadvise(&self, offset: u64, len: u64, advice: i32) -> io::Result<()>;
 }
 
 impl FileExt for fs::File {
@@ -165,6 +178,12 @@ impl FileExt for fs::File {
     fn write_at(&self, buf: &[u8], offset: u64) -> io::Result<usize> {
         self.as_inner().write_at(buf, offset)
     }
+    fn fallocate(&self, mode: i32, offset: u64, len: u64) -> io::Result<()> {
+        self.as_inner().fallocate(mode, offset, len)
+    }
+    fn fadvise(&self, offset: u64, len: u64, advice: i32) -> io::Result<()> {
+        self.as_inner().fadvise(offset, len, advice)
+    }
 }
 
 /// Unix-specific extensions to [`fs::Permissions`].
@@ -24,7 +24,7 @@ use crate::sys::fd::FileDesc;
 use crate::sys::time::SystemTime;
 use crate::sys::{cvt, cvt_r};
 use crate::sys_common::{AsInner, FromInner};
-use core::{fmt, mem, ptr};
+use core::{fmt, mem};
 use alloc_crate::sync::Arc;
 
 pub use crate::sys_common::fs::remove_dir_all;
@@ -51,6 +51,40 @@ struct InnerReadDir {
 pub struct ReadDir {
     inner: Arc<InnerReadDir>,
     end_of_stream: bool,
+    batch: DirBatch,
+}
+
+/// Entries fetched ahead via readdir64_batch, so iterating a large
+/// directory costs one ocall per READDIR_BATCH entries instead of one
+/// per entry. This is iteration state, not directory identity: cloning
+/// a ReadDir (as every DirEntry does for its root path) starts with an
+/// empty buffer rather than copying one.
+struct DirBatch {
+    entries: Vec<dirent64>,
+    cursor: usize,
+    /// The stream ended; no refill ocall needed once drained.
+    eof: bool,
+    /// Error hit after buffered entries; delivered once they drain.
+    pending_error: Option<i32>,
+}
+
+const READDIR_BATCH: usize = 32;
+
+impl DirBatch {
+    fn new() -> DirBatch {
+        DirBatch {
+            entries: Vec::new(),
+            cursor: 0,
+            eof: false,
+            pending_error: None,
+        }
+    }
+}
+
+impl Clone for DirBatch {
+    fn clone(&self) -> DirBatch {
+        DirBatch::new()
+    }
 }
 
 struct Dir(*mut DIR);
@@ -195,22 +229,47 @@ impl Iterator for ReadDir {
         }
 
         unsafe {
-            let mut ret = DirEntry { entry: mem::zeroed(), dir: self.clone() };
-            let mut entry_ptr = ptr::null_mut();
             loop {
-                if libc::readdir64_r(self.inner.dirp.0, &mut ret.entry, &mut entry_ptr) != 0 {
-                    if entry_ptr.is_null() {
-                        // We encountered an error (which will be returned in this iteration), but
-                        // we also reached the end of the directory stream. The `end_of_stream`
-                        // flag is enabled to make sure that we return `None` in the next iteration
-                        // (instead of looping forever)
+                if self.batch.cursor >= self.batch.entries.len() {
+                    // Buffer drained: deliver a deferred error, stop at
+                    // end of stream, or refill with one batched ocall.
+                    if let Some(err) = self.batch.pending_error.take() {
                         self.end_of_stream = true;
+                        return Some(Err(Error::from_raw_os_error(err)));
                     }
-                    return Some(Err(Error::last_os_error()));
-                }
-                if entry_ptr.is_null() {
-                    return None;
+                    if self.batch.eof {
+                        self.end_of_stream = true;
+                        return None;
+                    }
+
+                    if self.batch.entries.capacity() == 0 {
+                        self.batch.entries.reserve_exact(READDIR_BATCH);
+                    }
+                    let mut nread: usize = 0;
+                    let ret = libc::readdir64_batch(self.inner.dirp.0,
+                                                    self.batch.entries.as_mut_ptr(),
+                                                    READDIR_BATCH,
+                                                    &mut nread);
+                    self.batch.entries.set_len(nread);
+                    self.batch.cursor = 0;
+                    if ret != 0 {
+                        if nread == 0 {
+                            // Error at the head of the batch: report it
+                            // now and end the stream, as the per-entry
+                            // path did.
+                            self.end_of_stream = true;
+                            return Some(Err(Error::from_raw_os_error(ret)));
+                        }
+                        self.batch.pending_error = Some(ret);
+                    } else if nread < READDIR_BATCH {
+                        self.batch.eof = true;
+                    }
+                    continue;
                 }
+
+                let entry = self.batch.entries[self.batch.cursor];
+                self.batch.cursor += 1;
+                let ret = DirEntry { entry, dir: self.clone() };
                 if ret.name_bytes() != b"." && ret.name_bytes() != b".." {
                     return Some(Ok(ret));
                 }
@@ -429,6 +488,22 @@ impl File {
             cvt_r(|| unsafe { libc::ftruncate64(self.0.raw(), size) }).map(drop)
     }
 
+    pub fn fallocate(&self, mode: i32, offset: u64, len: u64) -> io::Result<()> {
+        cvt_r(|| unsafe {
+            libc::fallocate64(self.0.raw(), mode, offset as off64_t, len as off64_t)
+        }).map(drop)
+    }
+
+    pub fn fadvise(&self, offset: u64, len: u64, advice: i32) -> io::Result<()> {
+        // posix_fadvise returns the error code; errno is untouched.
+        match unsafe {
+            libc::posix_fadvise64(self.0.raw(), offset as off64_t, len as off64_t, advice)
+        } {
+            0 => Ok(()),
+            err => Err(io::Error::from_raw_os_error(err)),
+        }
+    }
+
     pub fn read(&self, buf: &mut [u8]) -> io::Result<usize> {
         self.0.read(buf)
     }
@@ -557,7 +632,7 @@ pub fn readdir(p: &Path) -> io::Result<ReadDir> {
             Err(Error::last_os_error())
         } else {
             let inner = InnerReadDir { dirp: Dir(ptr), root };
-            Ok(ReadDir { inner: Arc::new(inner), end_of_stream: false })
+            Ok(ReadDir { inner: Arc::new(inner), end_of_stream: false, batch: DirBatch::new() })
         }
     }
 }
@@ -686,5 +761,6 @@ mod libc {
     pub use sgx_trts::libc::*;
     pub use sgx_trts::libc::ocall::{open64, fstat64, fsync, fdatasync, ftruncate64, lseek64, fchmod,
                                     unlink, link, rename, chmod, readlink, symlink, stat64, lstat64,
-                                    fcntl_arg0, realpath, free, readdir64_r, closedir, dirfd, mkdir, rmdir, opendir, fstatat64};
+                                    fcntl_arg0, realpath, free, readdir64_batch, closedir, dirfd, mkdir, rmdir, opendir, fstatat64,
+                                    fallocate64, posix_fadvise64};
 }
\ No newline at end of file
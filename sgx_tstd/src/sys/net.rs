@@ -150,7 +150,7 @@ impl Socket {
         loop {
             let elapsed = start.elapsed();
             if elapsed >= timeout {
-                return Err(io::Error::new(io::ErrorKind::TimedOut, "connection timed out"));
+                return Err(io::Error::new_const(io::ErrorKind::TimedOut, &"connection timed out"));
             }
 
             let timeout = timeout - elapsed;
@@ -177,7 +177,7 @@ impl Socket {
                     // for POLLHUP rather than read readiness
                     if pollfd.revents & libc::POLLHUP != 0 {
                         let e = self.take_error()?.unwrap_or_else(|| {
-                            io::Error::new(io::ErrorKind::Other, "no error set after POLLHUP")
+                            io::Error::new_const(io::ErrorKind::Other, &"no error set after POLLHUP")
                         });
                         return Err(e);
                     }
@@ -199,6 +199,7 @@ impl Socket {
     // be used on demand.
     // We don't support linux kernel < 2.6.28. So we only use accept4.
     pub fn accept(&self, storage: *mut libc::sockaddr, len: *mut libc::socklen_t) -> io::Result<Socket> {
+        self.wait_deadline(libc::POLLIN)?;
         let res = cvt_r(|| unsafe {
             libc::accept4(self.0.raw(), storage, len, libc::SOCK_CLOEXEC)
         });
@@ -220,7 +221,44 @@ impl Socket {
         self.0.duplicate().map(Socket)
     }
 
+    // Enforce the calling thread's ocall deadline (io::with_ocall_budget)
+    // before entering a blocking ocall: wait for readiness with the
+    // remaining budget and fail with TimedOut once it is spent, instead
+    // of parking the TCS in the untrusted OS indefinitely.
+    fn wait_deadline(&self, events: i16) -> io::Result<()> {
+        let mut remaining = match crate::io::deadline::remaining() {
+            Some(r) => r,
+            None => return Ok(()),
+        };
+        let mut pollfd = libc::pollfd { fd: self.0.raw(), events, revents: 0 };
+        loop {
+            if remaining.as_secs() == 0 && remaining.subsec_nanos() == 0 {
+                return Err(io::Error::new_const(io::ErrorKind::TimedOut, &"ocall budget exhausted"));
+            }
+            let millis = remaining
+                .as_secs()
+                .saturating_mul(1_000)
+                .saturating_add(remaining.subsec_nanos() as u64 / 1_000_000)
+                .max(1);
+            let millis = cmp::min(millis, c_int::max_value() as u64) as c_int;
+            match unsafe { libc::poll(&mut pollfd, 1, millis) } {
+                -1 => {
+                    let err = io::Error::last_os_error();
+                    if err.kind() != io::ErrorKind::Interrupted {
+                        return Err(err);
+                    }
+                }
+                0 => {
+                    return Err(io::Error::new_const(io::ErrorKind::TimedOut, &"ocall budget exhausted"));
+                }
+                _ => return Ok(()),
+            }
+            remaining = crate::io::deadline::remaining().unwrap_or(Duration::from_secs(0));
+        }
+    }
+
     fn recv_with_flags(&self, buf: &mut [u8], flags: c_int) -> io::Result<usize> {
+        self.wait_deadline(libc::POLLIN)?;
         let ret = cvt(unsafe {
             libc::recv(self.0.raw(), buf.as_mut_ptr() as *mut c_void, buf.len(), flags)
         })?;
@@ -236,6 +274,7 @@ impl Socket {
     }
 
     pub fn read_vectored(&self, bufs: &mut [IoSliceMut<'_>]) -> io::Result<usize> {
+        self.wait_deadline(libc::POLLIN)?;
         self.0.read_vectored(bufs)
     }
 
@@ -244,6 +283,7 @@ impl Socket {
         buf: &mut [u8],
         flags: c_int,
     ) -> io::Result<(usize, SocketAddr)> {
+        self.wait_deadline(libc::POLLIN)?;
         let mut storage: libc::sockaddr_storage = unsafe { mem::zeroed() };
         let mut addrlen = mem::size_of_val(&storage) as libc::socklen_t;
 
@@ -269,10 +309,12 @@ impl Socket {
     }
 
     pub fn write(&self, buf: &[u8]) -> io::Result<usize> {
+        self.wait_deadline(libc::POLLOUT)?;
         self.0.write(buf)
     }
 
     pub fn write_vectored(&self, bufs: &[IoSlice<'_>]) -> io::Result<usize> {
+        self.wait_deadline(libc::POLLOUT)?;
         self.0.write_vectored(bufs)
     }
 
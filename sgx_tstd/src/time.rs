@@ -20,6 +20,7 @@
 use core::cmp;
 use core::fmt;
 use core::ops::{Add, AddAssign, Sub, SubAssign};
+use core::sync::atomic::{fence, AtomicU64, Ordering};
 use crate::error::Error;
 use crate::sys::time;
 use crate::sys_common::FromInner;
@@ -422,4 +423,198 @@ impl FromInner<time::SystemTime> for SystemTime {
     fn from_inner(time: time::SystemTime) -> SystemTime {
         SystemTime(time)
     }
+}
+
+/// Last anchor of the trusted clock. Guarded by the seqlock in
+/// `TRUSTED_GEN`: readers retry while the generation is odd or changes
+/// under them, writers serialize on `TRUSTED_ANCHOR_LOCK`.
+struct TrustedAnchor {
+    /// Reference nanoseconds at the anchor, on the caller's timeline.
+    nanos: u64,
+    /// Timestamp counter value captured when the anchor was set.
+    tsc: u64,
+    /// Calibrated counter frequency; 0 until two anchors exist.
+    hz: u64,
+}
+
+static TRUSTED_GEN: AtomicU64 = AtomicU64::new(0);
+static mut TRUSTED_ANCHOR: TrustedAnchor = TrustedAnchor { nanos: 0, tsc: 0, hz: 0 };
+static TRUSTED_ANCHOR_LOCK: SgxThreadMutex = SgxThreadMutex::new();
+/// Latest value handed out, so extrapolated reads never go backwards
+/// across a re-anchor that lands behind the extrapolation.
+static TRUSTED_LAST: AtomicU64 = AtomicU64::new(0);
+
+#[inline]
+fn rdtsc() -> u64 {
+    // RDTSC is enclave-legal only on SGX2 platforms; on SGX1 it raises
+    // #UD inside an enclave. Callers that must run on SGX1 should stay
+    // on the ocall clocks.
+    unsafe { core::arch::x86_64::_rdtsc() }
+}
+
+fn read_trusted_anchor() -> Option<TrustedAnchor> {
+    loop {
+        let g1 = TRUSTED_GEN.load(Ordering::Acquire);
+        if g1 == 0 {
+            return None;
+        }
+        if g1 & 1 == 1 {
+            continue;
+        }
+        fence(Ordering::Acquire);
+        let anchor = unsafe {
+            TrustedAnchor {
+                nanos: TRUSTED_ANCHOR.nanos,
+                tsc: TRUSTED_ANCHOR.tsc,
+                hz: TRUSTED_ANCHOR.hz,
+            }
+        };
+        fence(Ordering::Acquire);
+        if TRUSTED_GEN.load(Ordering::Acquire) == g1 {
+            return Some(anchor);
+        }
+    }
+}
+
+/// A measurement of the trusted hybrid clock, monotonically nondecreasing.
+///
+/// The ocall clocks behind [`Instant`] and [`SystemTime`] are answered by
+/// the untrusted OS on every read; the OS can stall them, freeze them, or
+/// roll them back at will. `TrustedInstant` instead extrapolates from the
+/// last *anchor* — a reference time the caller obtained over an attested
+/// channel (for example from the time-stamp of a quote verification
+/// response) — using the in-enclave timestamp counter, so a read is a
+/// RDTSC and a little arithmetic: no enclave transition, no OS in the
+/// loop.
+///
+/// The clock must be calibrated before it can be read: the first two
+/// calls to [`anchor`] establish the counter frequency, and `now` returns
+/// `None` until then. Between anchors the clock is as trustworthy as the
+/// platform's counter — a hypervisor that scales or offsets the TSC can
+/// still stretch it, so callers that care should re-anchor periodically
+/// and treat [`anchor_age`] as a staleness bound. Values are clamped so
+/// that reads never go backwards, including across a re-anchor that lands
+/// behind the extrapolated time.
+///
+/// [`anchor`]: #method.anchor
+/// [`anchor_age`]: #method.anchor_age
+#[derive(Copy, Clone, PartialEq, Eq, PartialOrd, Ord, Hash)]
+pub struct TrustedInstant(Duration);
+
+impl TrustedInstant {
+    /// Anchors the trusted clock to `reference`, a point on a timeline
+    /// of the caller's choosing that was obtained from an attested time
+    /// source. The first call only records the anchor; the second and
+    /// later calls also (re)calibrate the counter frequency from the
+    /// span since the previous anchor, so anchors should be far enough
+    /// apart (tens of milliseconds or more) for the ratio to be
+    /// meaningful. A reference that does not move forward is recorded
+    /// without recalibrating.
+    pub fn anchor(reference: Duration) {
+        let tsc = rdtsc();
+        let nanos = reference.as_secs()
+            .saturating_mul(1_000_000_000)
+            .saturating_add(u64::from(reference.subsec_nanos()));
+
+        unsafe {
+            let r = TRUSTED_ANCHOR_LOCK.lock();
+            let gen = TRUSTED_GEN.load(Ordering::Relaxed);
+            let mut hz = TRUSTED_ANCHOR.hz;
+            if gen != 0 && nanos > TRUSTED_ANCHOR.nanos && tsc > TRUSTED_ANCHOR.tsc {
+                let dtsc = u128::from(tsc - TRUSTED_ANCHOR.tsc);
+                let dnanos = u128::from(nanos - TRUSTED_ANCHOR.nanos);
+                let ratio = dtsc * 1_000_000_000 / dnanos;
+                if ratio > 0 && ratio <= u128::from(u64::max_value()) {
+                    hz = ratio as u64;
+                }
+            }
+            TRUSTED_GEN.store(gen + 1, Ordering::Relaxed);
+            fence(Ordering::Release);
+            TRUSTED_ANCHOR.nanos = nanos;
+            TRUSTED_ANCHOR.tsc = tsc;
+            TRUSTED_ANCHOR.hz = hz;
+            fence(Ordering::Release);
+            TRUSTED_GEN.store(gen + 2, Ordering::Release);
+            if r.is_ok() {
+                TRUSTED_ANCHOR_LOCK.unlock();
+            }
+        }
+    }
+
+    /// Returns an instant corresponding to "now" on the trusted clock,
+    /// or `None` if the clock has not been calibrated by two anchors
+    /// yet.
+    pub fn now() -> Option<TrustedInstant> {
+        let anchor = read_trusted_anchor()?;
+        if anchor.hz == 0 {
+            return None;
+        }
+        let dtsc = rdtsc().saturating_sub(anchor.tsc);
+        let dnanos = u128::from(dtsc) * 1_000_000_000 / u128::from(anchor.hz);
+        let nanos = anchor.nanos.saturating_add(cmp::min(dnanos, u128::from(u64::max_value())) as u64);
+
+        // fetch_max both publishes this read and picks up any later
+        // value another thread has already handed out
+        let prev = TRUSTED_LAST.fetch_max(nanos, Ordering::AcqRel);
+        let nanos = cmp::max(prev, nanos);
+        Some(TrustedInstant(Duration::new(nanos / 1_000_000_000, (nanos % 1_000_000_000) as u32)))
+    }
+
+    /// Returns how far the clock has extrapolated past its last anchor,
+    /// or `None` if the clock has not been calibrated yet. Callers with
+    /// a drift budget should re-anchor once this exceeds it.
+    pub fn anchor_age() -> Option<Duration> {
+        let anchor = read_trusted_anchor()?;
+        if anchor.hz == 0 {
+            return None;
+        }
+        let dtsc = rdtsc().saturating_sub(anchor.tsc);
+        let dnanos = u128::from(dtsc) * 1_000_000_000 / u128::from(anchor.hz);
+        let dnanos = cmp::min(dnanos, u128::from(u64::max_value())) as u64;
+        Some(Duration::new(dnanos / 1_000_000_000, (dnanos % 1_000_000_000) as u32))
+    }
+
+    /// Returns the amount of time elapsed from another instant to this one.
+    ///
+    /// # Panics
+    ///
+    /// This function will panic if `earlier` is later than `self`.
+    ///
+    pub fn duration_since(&self, earlier: TrustedInstant) -> Duration {
+        self.0.checked_sub(earlier.0).expect("supplied instant is later than self")
+    }
+
+    /// Returns the amount of time elapsed from another instant to this one,
+    /// or None if that instant is later than this one.
+    ///
+    pub fn checked_duration_since(&self, earlier: TrustedInstant) -> Option<Duration> {
+        self.0.checked_sub(earlier.0)
+    }
+
+    /// Returns the amount of time elapsed since this instant was created,
+    /// or `None` if the clock has lost its calibration in the meantime.
+    pub fn elapsed(&self) -> Option<Duration> {
+        TrustedInstant::now().map(|now| now.saturating_duration_since(*self))
+    }
+
+    /// Returns the amount of time elapsed from another instant to this one,
+    /// or zero duration if that instant is later than this one.
+    ///
+    pub fn saturating_duration_since(&self, earlier: TrustedInstant) -> Duration {
+        self.checked_duration_since(earlier).unwrap_or(Duration::new(0, 0))
+    }
+}
+
+impl Sub<TrustedInstant> for TrustedInstant {
+    type Output = Duration;
+
+    fn sub(self, other: TrustedInstant) -> Duration {
+        self.duration_since(other)
+    }
+}
+
+impl fmt::Debug for TrustedInstant {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        self.0.fmt(f)
+    }
 }
\ No newline at end of file
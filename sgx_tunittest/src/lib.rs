@@ -67,6 +67,25 @@
 //! In this way, `vec[0]` would panic. But `should_panic!` catches it. Thus
 //! `foo_panic` would pass the unit test.
 //!
+//! Besides pass/fail tests, this crate provides an in-enclave benchmark
+//! runner. Benchmark functions have the same shape as test functions and
+//! are launched with `rsgx_benchmarks!`:
+//!
+//! ```
+//! fn bench_seal() {
+//!     let data = [0u8; 4096];
+//!     black_box(seal(&data));
+//! }
+//!
+//! rsgx_benchmarks!(bench_seal);
+//! ```
+//!
+//! Each benchmark is warmed up, calibrated so one timed sample amortizes
+//! the clock ocalls (rdtsc is not usable inside an SGX1 enclave), sampled
+//! repeatedly with outlier rejection, and reported as one machine-readable
+//! line with min/median/p99 per iteration. `rsgx_bench_check_regressions`
+//! compares results against recorded baselines for regression tracking.
+//!
 
 #![cfg_attr(not(target_env = "sgx"), no_std)]
 #![cfg_attr(
@@ -80,6 +99,8 @@
 extern crate sgx_tstd as std;
 
 use std::string::String;
+use std::time::Instant;
+use std::untrusted::time::InstantEx;
 use std::vec::Vec;
 
 /// This macro implements the fail test.
@@ -227,3 +248,190 @@ where
         }
     }
 }
+
+/// An identity function that hides its argument from the optimizer.
+///
+/// Wrap benchmark inputs and results in `black_box` so the compiler
+/// cannot constant-fold or dead-code-eliminate the work being measured.
+pub fn black_box<T>(x: T) -> T {
+    unsafe {
+        let y = std::ptr::read_volatile(&x);
+        std::mem::forget(x);
+        y
+    }
+}
+
+/// Default number of timed samples collected per benchmark.
+pub const BENCH_DEFAULT_SAMPLES: usize = 50;
+
+// One timed sample is calibrated to run at least this long, so the two
+// clock reads bracketing it (each an ocall -- rdtsc is illegal inside
+// an SGX1 enclave) are amortized over many iterations.
+const BENCH_TARGET_SAMPLE_NS: u64 = 1_000_000;
+const BENCH_MAX_ITERS_PER_SAMPLE: u64 = 1 << 24;
+const BENCH_WARMUP_MAX_ITERS: u64 = 1_000;
+const BENCH_WARMUP_TARGET_NS: u64 = 10_000_000;
+
+/// The statistics of one benchmark, in nanoseconds per iteration.
+///
+/// Samples outside the Tukey fences (1.5 IQR beyond the quartiles) are
+/// rejected before the summary statistics are computed; `outliers`
+/// reports how many were dropped. An AEX or a page-cache miss in the
+/// middle of a sample otherwise dominates min/median on quiet code.
+pub struct BenchResult {
+    pub name: String,
+    pub iters_per_sample: u64,
+    pub samples: usize,
+    pub outliers: usize,
+    pub min_ns: u64,
+    pub median_ns: u64,
+    pub p99_ns: u64,
+    pub mean_ns: u64,
+}
+
+fn duration_ns(d: std::time::Duration) -> u64 {
+    d.as_secs().saturating_mul(1_000_000_000) + u64::from(d.subsec_nanos())
+}
+
+fn percentile(sorted: &[u64], p: usize) -> u64 {
+    sorted[(sorted.len() - 1) * p / 100]
+}
+
+/// Run one benchmark with the default sample count.
+pub fn rsgx_bench<F>(name: &str, f: F) -> BenchResult
+where
+    F: FnMut(),
+{
+    rsgx_bench_with(name, BENCH_DEFAULT_SAMPLES, f)
+}
+
+/// Run one benchmark: warm up, calibrate the per-sample iteration
+/// count, collect `samples` timed samples, reject outliers and print
+/// one machine-readable result line.
+pub fn rsgx_bench_with<F>(name: &str, samples: usize, mut f: F) -> BenchResult
+where
+    F: FnMut(),
+{
+    let samples = if samples < 3 { 3 } else { samples };
+
+    // Warmup: fault in code and data before anything is timed.
+    let warmup_start = Instant::now();
+    for _ in 0..BENCH_WARMUP_MAX_ITERS {
+        f();
+        if duration_ns(warmup_start.elapsed()) >= BENCH_WARMUP_TARGET_NS {
+            break;
+        }
+    }
+
+    // Calibrate: double the iteration count until one sample is long
+    // enough to amortize the clock ocalls around it.
+    let mut iters: u64 = 1;
+    loop {
+        let start = Instant::now();
+        for _ in 0..iters {
+            f();
+        }
+        let elapsed = duration_ns(start.elapsed());
+        if elapsed >= BENCH_TARGET_SAMPLE_NS || iters >= BENCH_MAX_ITERS_PER_SAMPLE {
+            break;
+        }
+        iters = iters.saturating_mul(2);
+    }
+
+    let mut per_iter: Vec<u64> = Vec::with_capacity(samples);
+    for _ in 0..samples {
+        let start = Instant::now();
+        for _ in 0..iters {
+            f();
+        }
+        per_iter.push(duration_ns(start.elapsed()) / iters);
+    }
+    per_iter.sort_unstable();
+
+    let q1 = percentile(&per_iter, 25);
+    let q3 = percentile(&per_iter, 75);
+    let fence = (q3 - q1).saturating_mul(3) / 2;
+    let lo = q1.saturating_sub(fence);
+    let hi = q3.saturating_add(fence);
+    let kept: Vec<u64> = per_iter.iter().cloned().filter(|&v| v >= lo && v <= hi).collect();
+
+    let result = BenchResult {
+        name: String::from(name),
+        iters_per_sample: iters,
+        samples: kept.len(),
+        outliers: per_iter.len() - kept.len(),
+        min_ns: kept[0],
+        median_ns: kept[kept.len() / 2],
+        p99_ns: percentile(&kept, 99),
+        mean_ns: kept.iter().sum::<u64>() / kept.len() as u64,
+    };
+    println!(
+        "bench {{\"name\":\"{}\",\"iters_per_sample\":{},\"samples\":{},\"outliers\":{},\
+         \"min_ns\":{},\"median_ns\":{},\"p99_ns\":{},\"mean_ns\":{}}}",
+        result.name,
+        result.iters_per_sample,
+        result.samples,
+        result.outliers,
+        result.min_ns,
+        result.median_ns,
+        result.p99_ns,
+        result.mean_ns
+    );
+    result
+}
+
+/// Compare benchmark results against recorded `(name, median_ns)`
+/// baselines. A benchmark regresses when its median exceeds the
+/// baseline by more than `tolerance_percent`. Regressions are printed
+/// and counted; benchmarks without a baseline are ignored, so new
+/// benchmarks can land before their baseline is recorded.
+pub fn rsgx_bench_check_regressions(
+    results: &[BenchResult],
+    baselines: &[(&str, u64)],
+    tolerance_percent: u64,
+) -> usize {
+    let mut regressions = 0;
+    for result in results {
+        for &(name, baseline_ns) in baselines {
+            if result.name == name {
+                let limit = baseline_ns + baseline_ns * tolerance_percent / 100;
+                if result.median_ns > limit {
+                    println!(
+                        "bench {} \x1B[1;31mregressed\x1B[0m: median {} ns/iter, baseline {} ns/iter (+{}%)",
+                        result.name,
+                        result.median_ns,
+                        baseline_ns,
+                        (result.median_ns - baseline_ns) * 100 / baseline_ns
+                    );
+                    regressions += 1;
+                }
+            }
+        }
+    }
+    regressions
+}
+
+/// This macro works as benchmark driver, mirroring `rsgx_unit_tests!`.
+///
+/// It takes a list of benchmark functions (zero arguments, any return),
+/// runs each through `rsgx_bench` and returns the collected
+/// `Vec<BenchResult>`, which can be fed to
+/// `rsgx_bench_check_regressions` for baseline comparison:
+///
+/// ```
+/// let results = rsgx_benchmarks!(bench_seal, bench_hash);
+/// rsgx_bench_check_regressions(&results, &[("bench_seal", 2_400)], 10);
+/// ```
+#[macro_export]
+macro_rules! rsgx_benchmarks {
+    (
+        $($f : expr),* $(,)?
+    ) => {
+        {
+            println!("\nstart running benches");
+            let mut results: Vec<$crate::BenchResult> = Vec::new();
+            $(results.push($crate::rsgx_bench(stringify!($f), || { $f(); })));*;
+            results
+        }
+    }
+}
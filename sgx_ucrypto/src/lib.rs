@@ -34,3 +34,5 @@ mod util;
 pub use util::*;
 mod crypto;
 pub use self::crypto::*;
+mod rsa_batch;
+pub use self::rsa_batch::*;
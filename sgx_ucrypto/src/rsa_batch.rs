@@ -0,0 +1,300 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License..
+
+//! Batched RSA-3072 signature verification.
+//!
+//! `sgx_rsa3072_verify` rebuilds its big-number context - modulus
+//! import, Montgomery constants, the lot - on every call, which is pure
+//! overhead when a service provider checks thousands of reports signed
+//! under one key (the IAS report key, in the attestation-storm case).
+//! [`Rsa3072BatchVerifier`] computes the Montgomery context once per
+//! key and reuses it across the whole batch; each verification is then
+//! just the PKCS#1 v1.5 exponentiation (17 Montgomery multiplications
+//! at e = 65537) plus a SHA-256 of the message.
+//!
+//! Buffer conventions match `sgx_rsa3072_verify`: modulus, exponent and
+//! signature are little-endian, as produced by `sgx_create_rsa_key_pair`
+//! and `sgx_rsa3072_sign`. This path is untrusted-side only and
+//! verification needs no secrets, so no constant-time effort is made.
+
+use crate::crypto::rsgx_sha256_slice;
+use core::mem;
+use sgx_types::marker::ContiguousMemory;
+use sgx_types::*;
+use std::vec::Vec;
+
+const LIMBS: usize = 48; // 3072 bits as 64-bit limbs, little-endian
+
+/// ASN.1 DigestInfo prefix for SHA-256 in EMSA-PKCS1-v1_5.
+const SHA256_DIGEST_INFO: [u8; 19] = [
+    0x30, 0x31, 0x30, 0x0d, 0x06, 0x09, 0x60, 0x86, 0x48, 0x01, 0x65, 0x03, 0x04, 0x02, 0x01,
+    0x05, 0x00, 0x04, 0x20,
+];
+
+fn limbs_from_le_bytes(bytes: &[u8; SGX_RSA3072_KEY_SIZE]) -> [u64; LIMBS] {
+    let mut limbs = [0u64; LIMBS];
+    for (i, limb) in limbs.iter_mut().enumerate() {
+        let mut word = [0u8; 8];
+        word.copy_from_slice(&bytes[i * 8..i * 8 + 8]);
+        *limb = u64::from_le_bytes(word);
+    }
+    limbs
+}
+
+fn geq(a: &[u64; LIMBS], b: &[u64; LIMBS]) -> bool {
+    for i in (0..LIMBS).rev() {
+        if a[i] != b[i] {
+            return a[i] > b[i];
+        }
+    }
+    true
+}
+
+fn sub_assign(a: &mut [u64; LIMBS], b: &[u64; LIMBS]) {
+    let mut borrow = 0u64;
+    for i in 0..LIMBS {
+        let (v, b1) = a[i].overflowing_sub(b[i]);
+        let (v, b2) = v.overflowing_sub(borrow);
+        a[i] = v;
+        borrow = (b1 | b2) as u64;
+    }
+}
+
+fn double_mod(a: &mut [u64; LIMBS], n: &[u64; LIMBS]) {
+    let mut carry = 0u64;
+    for limb in a.iter_mut() {
+        let shifted = (*limb << 1) | carry;
+        carry = *limb >> 63;
+        *limb = shifted;
+    }
+    if carry != 0 || geq(a, n) {
+        sub_assign(a, n);
+    }
+}
+
+/// Montgomery context for one RSA-3072 public key: the modulus, the
+/// word inverse -n^-1 mod 2^64 and R^2 mod n, shared by every
+/// verification under that key.
+struct MontCtx {
+    n: [u64; LIMBS],
+    n0inv: u64,
+    rr: [u64; LIMBS],
+}
+
+impl MontCtx {
+    fn new(n: [u64; LIMBS]) -> MontCtx {
+        // Word inverse by Newton iteration; six steps double the
+        // precision past 64 bits. Requires an odd modulus.
+        let mut inv = 1u64;
+        for _ in 0..6 {
+            inv = inv.wrapping_mul(2u64.wrapping_sub(n[0].wrapping_mul(inv)));
+        }
+        // R^2 mod n = 2^6144 mod n, by 6144 modular doublings of 1.
+        // Done once per key; negligible next to one exponentiation.
+        let mut rr = [0u64; LIMBS];
+        rr[0] = 1;
+        for _ in 0..(2 * 64 * LIMBS) {
+            double_mod(&mut rr, &n);
+        }
+        MontCtx { n, n0inv: inv.wrapping_neg(), rr }
+    }
+
+    /// CIOS Montgomery multiplication: returns a * b * R^-1 mod n.
+    fn mont_mul(&self, a: &[u64; LIMBS], b: &[u64; LIMBS]) -> [u64; LIMBS] {
+        let mut t = [0u64; LIMBS + 2];
+        for i in 0..LIMBS {
+            let ai = a[i] as u128;
+            let mut carry = 0u64;
+            for j in 0..LIMBS {
+                let v = ai * (b[j] as u128) + (t[j] as u128) + (carry as u128);
+                t[j] = v as u64;
+                carry = (v >> 64) as u64;
+            }
+            let v = (t[LIMBS] as u128) + (carry as u128);
+            t[LIMBS] = v as u64;
+            t[LIMBS + 1] = (v >> 64) as u64;
+
+            let m = t[0].wrapping_mul(self.n0inv) as u128;
+            let v = m * (self.n[0] as u128) + (t[0] as u128);
+            let mut carry = (v >> 64) as u64;
+            for j in 1..LIMBS {
+                let v = m * (self.n[j] as u128) + (t[j] as u128) + (carry as u128);
+                t[j - 1] = v as u64;
+                carry = (v >> 64) as u64;
+            }
+            let v = (t[LIMBS] as u128) + (carry as u128);
+            t[LIMBS - 1] = v as u64;
+            t[LIMBS] = t[LIMBS + 1] + ((v >> 64) as u64);
+            t[LIMBS + 1] = 0;
+        }
+        let mut out = [0u64; LIMBS];
+        out.copy_from_slice(&t[..LIMBS]);
+        if t[LIMBS] != 0 || geq(&out, &self.n) {
+            sub_assign(&mut out, &self.n);
+        }
+        out
+    }
+
+    /// base^e mod n by MSB-first square-and-multiply in Montgomery
+    /// form; for e = 65537 that is 17 multiplications.
+    fn pow_mod(&self, base: &[u64; LIMBS], e: u32) -> [u64; LIMBS] {
+        let base_m = self.mont_mul(base, &self.rr);
+        let mut one = [0u64; LIMBS];
+        one[0] = 1;
+        let mut acc = self.mont_mul(&one, &self.rr);
+        let bits = 32 - e.leading_zeros();
+        for i in (0..bits).rev() {
+            acc = self.mont_mul(&acc, &acc);
+            if (e >> i) & 1 == 1 {
+                acc = self.mont_mul(&acc, &base_m);
+            }
+        }
+        self.mont_mul(&acc, &one)
+    }
+}
+
+///
+/// Rsa3072BatchVerifier verifies RSASSA-PKCS1-v1_5 SHA-256 signatures,
+/// amortizing the per-key big-number setup over an entire batch.
+///
+/// # Description
+///
+/// Construct one verifier per public key and call [`verify_slice`] per
+/// report, or [`verify_batch`] over the whole vector. Results are
+/// bit-identical to `rsgx_rsa3072_verify_slice`; only the setup cost
+/// moves from every call to the constructor.
+///
+/// [`verify_slice`]: Rsa3072BatchVerifier::verify_slice
+/// [`verify_batch`]: Rsa3072BatchVerifier::verify_batch
+///
+pub struct Rsa3072BatchVerifier {
+    ctx: MontCtx,
+    e: u32,
+}
+
+impl Rsa3072BatchVerifier {
+    ///
+    /// Builds the shared Montgomery context from a public key.
+    ///
+    /// # Errors
+    ///
+    /// **SGX_ERROR_INVALID_PARAMETER**
+    ///
+    /// The modulus is even or zero, or the exponent is zero; no valid
+    /// RSA key looks like that.
+    ///
+    pub fn new(public: &sgx_rsa3072_public_key_t) -> SgxResult<Rsa3072BatchVerifier> {
+        let n = limbs_from_le_bytes(&public.modulus);
+        let e = u32::from_le_bytes(public.exponent);
+        if n[0] & 1 == 0 || e == 0 {
+            return Err(sgx_status_t::SGX_ERROR_INVALID_PARAMETER);
+        }
+        Ok(Rsa3072BatchVerifier { ctx: MontCtx::new(n), e })
+    }
+
+    ///
+    /// Verifies one signature over `data` under this verifier's key.
+    ///
+    /// # Errors
+    ///
+    /// **SGX_ERROR_INVALID_PARAMETER**
+    ///
+    /// The data size is 0 or exceeds u32::MAX.
+    ///
+    pub fn verify_slice<T>(
+        &self,
+        data: &[T],
+        signature: &sgx_rsa3072_signature_t,
+    ) -> SgxResult<bool>
+    where
+        T: Copy + ContiguousMemory,
+    {
+        let size = mem::size_of_val(data);
+        if size == 0 || size > u32::MAX as usize {
+            return Err(sgx_status_t::SGX_ERROR_INVALID_PARAMETER);
+        }
+        let hash = rsgx_sha256_slice(data)?;
+
+        let s = limbs_from_le_bytes(&signature.signature);
+        // s >= n never verifies; reject without the exponentiation.
+        if geq(&s, &self.ctx.n) {
+            return Ok(false);
+        }
+        let em = self.ctx.pow_mod(&s, self.e);
+
+        // EMSA-PKCS1-v1_5: 0x00 0x01 PS(0xff..) 0x00 DigestInfo H,
+        // big-endian. The limbs are little-endian, so compare against
+        // the reversed encoding.
+        let mut expected = [0xffu8; SGX_RSA3072_KEY_SIZE];
+        expected[0] = 0x00;
+        expected[1] = 0x01;
+        let tail = SGX_RSA3072_KEY_SIZE - SHA256_DIGEST_INFO.len() - hash.len();
+        expected[tail - 1] = 0x00;
+        expected[tail..tail + SHA256_DIGEST_INFO.len()].copy_from_slice(&SHA256_DIGEST_INFO);
+        expected[tail + SHA256_DIGEST_INFO.len()..].copy_from_slice(&hash);
+
+        let mut valid = true;
+        for (i, limb) in em.iter().enumerate() {
+            let le = limb.to_le_bytes();
+            for (j, &byte) in le.iter().enumerate() {
+                // byte (i*8 + j) from the little-endian end
+                if byte != expected[SGX_RSA3072_KEY_SIZE - 1 - (i * 8 + j)] {
+                    valid = false;
+                }
+            }
+        }
+        Ok(valid)
+    }
+
+    ///
+    /// Verifies a batch of (data, signature) pairs, returning one
+    /// verdict per pair in order. Fails only on malformed input; an
+    /// invalid signature is a `false`, not an error, so one bad report
+    /// in a storm does not abort the batch.
+    ///
+    pub fn verify_batch<T>(
+        &self,
+        items: &[(&[T], &sgx_rsa3072_signature_t)],
+    ) -> SgxResult<Vec<bool>>
+    where
+        T: Copy + ContiguousMemory,
+    {
+        let mut verdicts = Vec::with_capacity(items.len());
+        for (data, signature) in items.iter() {
+            verdicts.push(self.verify_slice(data, signature)?);
+        }
+        Ok(verdicts)
+    }
+}
+
+///
+/// rsgx_rsa3072_verify_batch verifies many signatures under one RSA
+/// 3072 public key, sharing the Montgomery context across the batch.
+///
+/// Convenience wrapper over [`Rsa3072BatchVerifier`] for one-shot use;
+/// keep the verifier itself when batches arrive repeatedly under the
+/// same key.
+///
+pub fn rsgx_rsa3072_verify_batch<T>(
+    items: &[(&[T], &sgx_rsa3072_signature_t)],
+    public: &sgx_rsa3072_public_key_t,
+) -> SgxResult<Vec<bool>>
+where
+    T: Copy + ContiguousMemory,
+{
+    Rsa3072BatchVerifier::new(public)?.verify_batch(items)
+}
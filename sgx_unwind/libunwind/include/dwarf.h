@@ -338,6 +338,13 @@ struct dwarf_rs_cache
 
     /* rs cache: */
     dwarf_reg_state_t buckets[DWARF_UNW_CACHE_SIZE];
+
+    /* proc-info for each bucket, captured when the bucket's reg-state
+       was parsed; lets repeated unwinds through the same IP skip the
+       .eh_frame_hdr binary search and FDE re-parse entirely.  The
+       cached copies never carry unwind_info (it is pool-allocated and
+       freed after parsing).  */
+    unw_proc_info_t pi_cache[DWARF_UNW_CACHE_SIZE];
 };
 
 /* A list of descriptors for loaded .debug_frame sections.  */
@@ -817,6 +817,34 @@ apply_reg_state (struct dwarf_cursor *c, struct dwarf_reg_state *rs)
     return 0;
 }
 
+/* Serve proc-info for C->IP from the rs cache.  Returns 0 and fills
+   c->pi when the IP's frame has been parsed before; the cached copy
+   carries no unwind_info, matching what fetch_proc_info produces when
+   need_unwind_info is 0.  */
+static int
+get_cached_proc_info (struct dwarf_cursor *c)
+{
+    struct dwarf_rs_cache *cache;
+    dwarf_reg_state_t *rs;
+    intrmask_t saved_mask;
+    int ret = -UNW_ENOINFO;
+
+    cache = get_rs_cache (c->as, &saved_mask);
+    if (!cache)
+        return -UNW_ENOINFO;
+
+    rs = rs_lookup (cache, c);
+    if (rs)
+    {
+        c->pi = cache->pi_cache[rs - cache->buckets];
+        c->pi_valid = 1;
+        c->pi_is_dynamic = 0;
+        ret = 0;
+    }
+    put_rs_cache (c->as, cache, &saved_mask);
+    return ret;
+}
+
 static int
 uncached_dwarf_find_save_locs (struct dwarf_cursor *c)
 {
@@ -871,6 +899,11 @@ dwarf_find_save_locs (struct dwarf_cursor *c)
         memcpy(rs, &sr.rs_current, offsetof(struct dwarf_reg_state, ip));
         cache->buckets[c->prev_rs].hint = rs - cache->buckets;
 
+        /* stash the FDE search result next to the reg-state, minus the
+           soon-to-be-freed unwind_info, for get_cached_proc_info */
+        cache->pi_cache[rs - cache->buckets] = c->pi;
+        cache->pi_cache[rs - cache->buckets].unwind_info = NULL;
+
         c->hint = rs->hint;
         c->prev_rs = rs - cache->buckets;
 
@@ -898,10 +931,8 @@ dwarf_create_state_record (struct dwarf_cursor *c, dwarf_state_record_t *sr)
 HIDDEN int
 dwarf_make_proc_info (struct dwarf_cursor *c)
 {
-#if 0
     if (c->as->caching_policy == UNW_CACHE_NONE
             || get_cached_proc_info (c) < 0)
-#endif
         /* Lookup it up the slow way... */
         return fetch_proc_info (c, c->ip, 0);
     return 0;
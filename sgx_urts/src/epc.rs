@@ -0,0 +1,287 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License..
+
+//! EPC paging pressure monitor.
+//!
+//! When an enclave's working set spills out of EPC the kernel starts
+//! EWB paging and throughput collapses, with no in-enclave signal that
+//! it is happening. This module samples what the host kernel exposes -
+//! EPC capacity from the NUMA sysfs nodes, EPC occupancy from the misc
+//! cgroup controller, and the process's major-fault counter as a paging
+//! proxy where the driver publishes nothing better - folds them into a
+//! 0-100 pressure score, and publishes the sample into a fixed shared
+//! page. The enclave maps that page through one `[user_check]` pointer
+//! (`rsgx_set_epc_pressure_page` in sgx_trts) and polls it for free,
+//! so an in-enclave cache can shrink itself before thrashing begins.
+//!
+//! Everything in the page is host-provided and advisory: an enclave may
+//! act on it for performance (cache sizing, admission control), never
+//! for security. A lying host can already slow the enclave arbitrarily.
+//!
+//! The page layout below is part of the untrusted/trusted contract with
+//! `sgx_trts::epc`; the writer bumps `seq` to odd before a sample and
+//! back to even after, seqlock-style, so readers never see a torn one.
+
+use std::fs;
+use std::io;
+use std::sync::atomic::{AtomicBool, AtomicU32, AtomicU64, Ordering};
+use std::sync::Arc;
+use std::thread;
+use std::time::{Duration, Instant};
+use std::vec::Vec;
+
+const EPC_PAGE_MAGIC: u32 = 0x4550_4350; // "EPCP"
+
+/// Occupancy below this percentage scores zero; the ramp from here to
+/// 100% occupancy spans the full score range.
+const OCCUPANCY_FLOOR_PCT: u64 = 75;
+/// Paging rate (events/s) at which the paging component reaches half
+/// scale.
+const PAGING_HALF_SCALE: u64 = 256;
+
+/// Shared pressure page. Layout is part of the untrusted/trusted
+/// contract: `sgx_trts::epc` reads this structure through a raw
+/// pointer.
+#[repr(C)]
+pub struct EpcPressurePage {
+    seq: AtomicU32,
+    magic: AtomicU32,
+    /// 0 (no pressure) to 100 (thrashing).
+    score: AtomicU32,
+    /// Paging events per second, exponentially smoothed.
+    paging_rate: AtomicU32,
+    /// EPC capacity in bytes; 0 when the host exposes none.
+    epc_total: AtomicU64,
+    /// EPC occupancy in bytes; 0 when the host exposes none.
+    epc_used: AtomicU64,
+    /// Cumulative paging events since the monitor started.
+    paging_events: AtomicU64,
+    /// Milliseconds since monitor start of the last sample.
+    sample_ms: AtomicU64,
+}
+
+/// One decoded sample of the pressure page.
+#[derive(Copy, Clone, Debug, Default)]
+pub struct EpcPressureSample {
+    pub score: u32,
+    pub paging_rate: u32,
+    pub epc_total: u64,
+    pub epc_used: u64,
+    pub paging_events: u64,
+    pub sample_ms: u64,
+}
+
+struct MonitorShared {
+    page: EpcPressurePage,
+    /// Paging events fed by callers with a better signal than majflt
+    /// (patched driver counters, perf events).
+    external_events: AtomicU64,
+    stop: AtomicBool,
+}
+
+///
+/// EpcMonitor samples host EPC statistics on a background thread and
+/// publishes a pressure score into a shared page for in-enclave
+/// consumers.
+///
+/// # Description
+///
+/// Start the monitor, pass [`page_ptr`] to the enclave through an ECALL
+/// taking a `[user_check]` pointer, and hand it to
+/// `rsgx_set_epc_pressure_page`. The page stays valid until the monitor
+/// is dropped.
+///
+/// [`page_ptr`]: EpcMonitor::page_ptr
+///
+pub struct EpcMonitor {
+    shared: Arc<MonitorShared>,
+    handle: Option<thread::JoinHandle<()>>,
+}
+
+impl EpcMonitor {
+    ///
+    /// Start sampling every `interval`. Fails only if the sampling
+    /// thread cannot be spawned; missing kernel statistics degrade the
+    /// sample (fields report 0), they do not fail the monitor.
+    ///
+    pub fn start(interval: Duration) -> io::Result<EpcMonitor> {
+        let shared = Arc::new(MonitorShared {
+            page: EpcPressurePage {
+                seq: AtomicU32::new(0),
+                magic: AtomicU32::new(EPC_PAGE_MAGIC),
+                score: AtomicU32::new(0),
+                paging_rate: AtomicU32::new(0),
+                epc_total: AtomicU64::new(0),
+                epc_used: AtomicU64::new(0),
+                paging_events: AtomicU64::new(0),
+                sample_ms: AtomicU64::new(0),
+            },
+            external_events: AtomicU64::new(0),
+            stop: AtomicBool::new(false),
+        });
+
+        let worker = Arc::clone(&shared);
+        let handle = thread::Builder::new()
+            .name("sgx_epc_monitor".into())
+            .spawn(move || sample_loop(worker, interval))?;
+
+        Ok(EpcMonitor { shared, handle: Some(handle) })
+    }
+
+    ///
+    /// Address of the shared pressure page, for the enclave's
+    /// `[user_check]` registration.
+    ///
+    pub fn page_ptr(&self) -> *const EpcPressurePage {
+        &self.shared.page as *const EpcPressurePage
+    }
+
+    ///
+    /// Feed paging events from a source better than the built-in
+    /// major-fault proxy (a patched driver counter, a perf event on the
+    /// EWB path). Counted into the next sample.
+    ///
+    pub fn add_paging_events(&self, events: u64) {
+        self.shared.external_events.fetch_add(events, Ordering::Relaxed);
+    }
+
+    ///
+    /// The latest published sample.
+    ///
+    pub fn latest(&self) -> EpcPressureSample {
+        let page = &self.shared.page;
+        EpcPressureSample {
+            score: page.score.load(Ordering::Relaxed),
+            paging_rate: page.paging_rate.load(Ordering::Relaxed),
+            epc_total: page.epc_total.load(Ordering::Relaxed),
+            epc_used: page.epc_used.load(Ordering::Relaxed),
+            paging_events: page.paging_events.load(Ordering::Relaxed),
+            sample_ms: page.sample_ms.load(Ordering::Relaxed),
+        }
+    }
+}
+
+impl Drop for EpcMonitor {
+    fn drop(&mut self) {
+        self.shared.stop.store(true, Ordering::Release);
+        if let Some(handle) = self.handle.take() {
+            let _ = handle.join();
+        }
+    }
+}
+
+fn sample_loop(shared: Arc<MonitorShared>, interval: Duration) {
+    let started = Instant::now();
+    let epc_total = read_epc_total();
+    let mut last_majflt = read_majflt().unwrap_or(0);
+    let mut cumulative = 0_u64;
+    let mut rate_ewma = 0_f64;
+    let mut last_sample = Instant::now();
+
+    while !shared.stop.load(Ordering::Acquire) {
+        thread::sleep(interval);
+
+        let elapsed = last_sample.elapsed().as_secs_f64().max(1e-3);
+        last_sample = Instant::now();
+
+        let majflt = read_majflt().unwrap_or(last_majflt);
+        let mut events = majflt.saturating_sub(last_majflt);
+        last_majflt = majflt;
+        events += shared.external_events.swap(0, Ordering::Relaxed);
+        cumulative += events;
+
+        // One-sided smoothing: jump up with a burst, decay out of it.
+        let rate = events as f64 / elapsed;
+        rate_ewma = if rate > rate_ewma { rate } else { rate_ewma * 0.5 + rate * 0.5 };
+
+        let epc_used = read_epc_used();
+        let occupancy_score = match epc_total {
+            0 => 0,
+            total => {
+                let pct = epc_used.saturating_mul(100) / total;
+                (pct.saturating_sub(OCCUPANCY_FLOOR_PCT) * 100 / (100 - OCCUPANCY_FLOOR_PCT))
+                    .min(100)
+            }
+        };
+        let rate_u = rate_ewma as u64;
+        let paging_score = rate_u * 100 / (rate_u + PAGING_HALF_SCALE);
+        let score = occupancy_score.max(paging_score) as u32;
+
+        let page = &shared.page;
+        let seq = page.seq.load(Ordering::Relaxed);
+        page.seq.store(seq.wrapping_add(1), Ordering::Release); // odd: writing
+        page.score.store(score, Ordering::Relaxed);
+        page.paging_rate.store(rate_u.min(u32::MAX as u64) as u32, Ordering::Relaxed);
+        page.epc_total.store(epc_total, Ordering::Relaxed);
+        page.epc_used.store(epc_used, Ordering::Relaxed);
+        page.paging_events.store(cumulative, Ordering::Relaxed);
+        page.sample_ms
+            .store(started.elapsed().as_millis() as u64, Ordering::Relaxed);
+        page.seq.store(seq.wrapping_add(2), Ordering::Release); // even: stable
+    }
+}
+
+/// EPC capacity: sum of the per-node sysfs totals (kernel 5.17+), else
+/// the misc cgroup capacity, else 0.
+fn read_epc_total() -> u64 {
+    let mut total = 0_u64;
+    if let Ok(nodes) = fs::read_dir("/sys/devices/system/node") {
+        for node in nodes.flatten() {
+            let path = node.path().join("x86/sgx_total_bytes");
+            if let Some(bytes) = read_u64_file(&path.to_string_lossy()) {
+                total += bytes;
+            }
+        }
+    }
+    if total > 0 {
+        return total;
+    }
+    read_misc_cgroup_row("/sys/fs/cgroup/misc.capacity").unwrap_or(0)
+}
+
+/// EPC occupancy from the misc cgroup controller ("sgx_epc" row), 0
+/// when absent.
+fn read_epc_used() -> u64 {
+    read_misc_cgroup_row("/sys/fs/cgroup/misc.current").unwrap_or(0)
+}
+
+fn read_misc_cgroup_row(path: &str) -> Option<u64> {
+    let content = fs::read_to_string(path).ok()?;
+    for line in content.lines() {
+        let mut fields = line.split_whitespace();
+        if fields.next() == Some("sgx_epc") {
+            return fields.next()?.parse().ok();
+        }
+    }
+    None
+}
+
+/// The process's cumulative major faults, field 12 of /proc/self/stat.
+/// Faults reloading EWB'd pages land here on current drivers; it
+/// over-counts by ordinary file-backed major faults, which is why it is
+/// only a proxy.
+fn read_majflt() -> Option<u64> {
+    let stat = fs::read_to_string("/proc/self/stat").ok()?;
+    // comm may contain spaces; fields are positional after the ')'.
+    let after_comm = &stat[stat.rfind(')')? + 2..];
+    let fields: Vec<&str> = after_comm.split_whitespace().collect();
+    fields.get(9)?.parse().ok()
+}
+
+fn read_u64_file(path: &str) -> Option<u64> {
+    fs::read_to_string(path).ok()?.trim().parse().ok()
+}
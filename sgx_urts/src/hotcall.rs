@@ -0,0 +1,141 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License..
+
+//! Hot-call channel: a spin-polled shared-memory request slot that lets the
+//! untrusted side invoke enclave functions without an EENTER per call.
+//!
+//! The enclave parks one worker thread inside a long-running ECALL that
+//! receives the slot address as a `[user_check]` pointer and polls it; the
+//! untrusted caller publishes `(fn_id, data)` and spins until the worker
+//! clears the busy flag. For sub-microsecond functions this trades one idle
+//! core for an order-of-magnitude lower call latency than ECALL dispatch.
+
+use std::hint;
+use std::sync::atomic::{AtomicI64, AtomicU32, AtomicUsize, Ordering};
+
+const SLOT_FREE: u32 = 0;
+const SLOT_PENDING: u32 = 1;
+
+/// Shared request slot. The layout is part of the untrusted/trusted contract:
+/// the enclave-side responder accesses this structure through a raw pointer.
+#[repr(C)]
+pub struct HotCallSlot {
+    busy: AtomicU32,
+    stop: AtomicU32,
+    fn_id: AtomicU32,
+    _pad: u32,
+    data: AtomicUsize,
+    result: AtomicI64,
+}
+
+pub struct HotCallChannel {
+    slot: Box<HotCallSlot>,
+}
+
+impl HotCallChannel {
+    pub fn new() -> HotCallChannel {
+        HotCallChannel {
+            slot: Box::new(HotCallSlot {
+                busy: AtomicU32::new(SLOT_FREE),
+                stop: AtomicU32::new(0),
+                fn_id: AtomicU32::new(0),
+                _pad: 0,
+                data: AtomicUsize::new(0),
+                result: AtomicI64::new(0),
+            }),
+        }
+    }
+
+    /// Address to hand to the enclave's responder ECALL as a
+    /// `[user_check]` parameter.
+    pub fn as_ptr(&self) -> *const HotCallSlot {
+        &*self.slot as *const HotCallSlot
+    }
+
+    /// Issue a call and spin until the enclave responder completes it.
+    /// `data` must point to untrusted memory the responder may touch.
+    pub fn call(&self, fn_id: u32, data: *mut u8) -> i64 {
+        while self
+            .slot
+            .busy
+            .compare_exchange(SLOT_FREE, SLOT_FREE, Ordering::Acquire, Ordering::Relaxed)
+            .is_err()
+        {
+            hint::spin_loop();
+        }
+        self.slot.fn_id.store(fn_id, Ordering::Relaxed);
+        self.slot.data.store(data as usize, Ordering::Relaxed);
+        self.slot.busy.store(SLOT_PENDING, Ordering::Release);
+
+        while self.slot.busy.load(Ordering::Acquire) != SLOT_FREE {
+            hint::spin_loop();
+        }
+        self.slot.result.load(Ordering::Relaxed)
+    }
+
+    /// Ask the enclave responder to leave its polling loop and return from
+    /// the parked ECALL.
+    pub fn shutdown(&self) {
+        self.slot.stop.store(1, Ordering::Release);
+    }
+}
+
+impl Default for HotCallChannel {
+    fn default() -> HotCallChannel {
+        HotCallChannel::new()
+    }
+}
+
+/// Serve at most one pending call on `slot`, returning whether a call was
+/// handled. The non-blocking unit the shared worker pool is built from; a
+/// dedicated responder loop is `serve` below.
+pub fn try_serve_one(slot: &HotCallSlot, dispatch: &mut dyn FnMut(u32, *mut u8) -> i64) -> bool {
+    if slot.busy.load(Ordering::Acquire) != SLOT_PENDING {
+        return false;
+    }
+    let fn_id = slot.fn_id.load(Ordering::Relaxed);
+    let data = slot.data.load(Ordering::Relaxed) as *mut u8;
+    let result = dispatch(fn_id, data);
+    slot.result.store(result, Ordering::Relaxed);
+    slot.busy.store(SLOT_FREE, Ordering::Release);
+    true
+}
+
+/// Whether the slot's caller has asked the responder to stop.
+pub fn is_stopped(slot: &HotCallSlot) -> bool {
+    slot.stop.load(Ordering::Acquire) != 0
+}
+
+/// Untrusted reference responder, usable when the roles are reversed and the
+/// enclave is the caller (hot ocalls). `dispatch` maps `(fn_id, data)` to a
+/// result; returning from this function requires `shutdown()` on the slot.
+pub fn serve(slot: &HotCallSlot, dispatch: &mut dyn FnMut(u32, *mut u8) -> i64) {
+    loop {
+        if slot.stop.load(Ordering::Acquire) != 0 {
+            return;
+        }
+        if slot.busy.load(Ordering::Acquire) == SLOT_PENDING {
+            let fn_id = slot.fn_id.load(Ordering::Relaxed);
+            let data = slot.data.load(Ordering::Relaxed) as *mut u8;
+            let result = dispatch(fn_id, data);
+            slot.result.store(result, Ordering::Relaxed);
+            slot.busy.store(SLOT_FREE, Ordering::Release);
+        } else {
+            hint::spin_loop();
+        }
+    }
+}
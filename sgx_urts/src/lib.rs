@@ -26,6 +26,7 @@ pub mod env;
 pub mod event;
 pub mod fd;
 pub mod file;
+pub mod hotcall;
 pub mod mem;
 pub mod net;
 pub mod pipe;
@@ -37,3 +38,17 @@ pub mod thread;
 pub mod time;
 mod enclave;
 pub use enclave::*;
+mod pool;
+pub use pool::*;
+mod preload;
+pub use preload::*;
+mod stats;
+pub use stats::*;
+mod switchless;
+pub use switchless::*;
+mod topology;
+pub use topology::*;
+mod workpool;
+pub use workpool::*;
+mod epc;
+pub use epc::*;
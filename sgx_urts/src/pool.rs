@@ -0,0 +1,191 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License..
+
+//! A warm pool of initialized enclaves.
+//!
+//! Creating a large enclave costs seconds of EADD measurement and
+//! EINIT, paid on every launch even when the same signed image is
+//! loaded a thousand times an hour. [`SgxEnclavePool`] pays that cost
+//! up front: it pre-creates a number of initialized instances of one
+//! image, and a job checks an instance out, runs its ECALLs, and
+//! returns it on drop. A checkout from a warm pool is a mutex lock and
+//! a vector pop.
+//!
+//! Enclave state does not reset itself between tenants, so a pool
+//! serving mutually distrusting jobs must be given a reset hook - an
+//! ECALL that wipes the enclave's job-visible state. An instance whose
+//! reset fails is destroyed instead of returned, and the next checkout
+//! falls back to a cold create, so a broken reset degrades latency but
+//! never leaks state between tenants.
+
+use sgx_types::*;
+use std::boxed::Box;
+use std::path::{Path, PathBuf};
+use std::sync::{Arc, Mutex};
+use std::vec::Vec;
+
+use crate::enclave::SgxEnclave;
+
+/// Wipes job-visible enclave state between tenants; returns an error
+/// to take the instance out of service.
+pub type EnclaveResetFn = Box<dyn Fn(sgx_enclave_id_t) -> SgxError + Send + Sync>;
+
+struct PoolInner {
+    path: PathBuf,
+    debug: i32,
+    capacity: usize,
+    reset: Option<EnclaveResetFn>,
+    idle: Mutex<Vec<SgxEnclave>>,
+}
+
+impl PoolInner {
+    fn create_one(&self) -> SgxResult<SgxEnclave> {
+        let mut launch_token: sgx_launch_token_t = [0; 1024];
+        let mut launch_token_updated: i32 = 0;
+        let mut misc_attr = sgx_misc_attribute_t {
+            secs_attr: sgx_attributes_t { flags: 0, xfrm: 0 },
+            misc_select: 0,
+        };
+        SgxEnclave::create(
+            &self.path,
+            self.debug,
+            &mut launch_token,
+            &mut launch_token_updated,
+            &mut misc_attr,
+        )
+    }
+}
+
+/// A pool of pre-created instances of one signed enclave image.
+///
+/// The pool is cheap to clone; clones share the same instances.
+#[derive(Clone)]
+pub struct SgxEnclavePool {
+    inner: Arc<PoolInner>,
+}
+
+impl SgxEnclavePool {
+    /// Creates a pool over the image at `file_name` and eagerly warms
+    /// it with `capacity` initialized instances, paying all EADD/EINIT
+    /// cost here rather than at checkout time.
+    ///
+    /// `reset` is invoked on every instance returned to the pool; pass
+    /// `None` only when consecutive tenants may see each other's
+    /// enclave state.
+    pub fn new<P: AsRef<Path>>(
+        file_name: P,
+        debug: i32,
+        capacity: usize,
+        reset: Option<EnclaveResetFn>,
+    ) -> SgxResult<SgxEnclavePool> {
+        let pool = SgxEnclavePool {
+            inner: Arc::new(PoolInner {
+                path: file_name.as_ref().to_owned(),
+                debug,
+                capacity,
+                reset,
+                idle: Mutex::new(Vec::with_capacity(capacity)),
+            }),
+        };
+        pool.prewarm()?;
+        Ok(pool)
+    }
+
+    /// Tops the pool back up to capacity. `new` calls this once; a
+    /// maintenance thread may call it periodically to re-create
+    /// instances lost to failed resets off the job path.
+    pub fn prewarm(&self) -> SgxError {
+        loop {
+            {
+                let idle = self.inner.idle.lock().unwrap();
+                if idle.len() >= self.inner.capacity {
+                    return Ok(());
+                }
+            }
+            // created outside the lock: EADD/EINIT takes seconds and
+            // checkouts must not wait behind it
+            let enclave = self.inner.create_one()?;
+            self.inner.idle.lock().unwrap().push(enclave);
+        }
+    }
+
+    /// Checks an instance out of the pool. Warm path is a lock and a
+    /// pop; if the pool is empty this falls back to a cold create.
+    pub fn checkout(&self) -> SgxResult<SgxPooledEnclave> {
+        let warm = self.inner.idle.lock().unwrap().pop();
+        let enclave = match warm {
+            Some(enclave) => enclave,
+            None => self.inner.create_one()?,
+        };
+        Ok(SgxPooledEnclave {
+            enclave: Some(enclave),
+            pool: self.clone(),
+        })
+    }
+
+    /// Number of instances currently idle in the pool.
+    pub fn idle_count(&self) -> usize {
+        self.inner.idle.lock().unwrap().len()
+    }
+
+    fn check_in(&self, enclave: SgxEnclave) {
+        if let Some(ref reset) = self.inner.reset {
+            if reset(enclave.geteid()).is_err() {
+                // failed reset may leave tenant state behind: destroy
+                // rather than hand it to the next job
+                return;
+            }
+        }
+        let mut idle = self.inner.idle.lock().unwrap();
+        if idle.len() < self.inner.capacity {
+            idle.push(enclave);
+        }
+        // else: drop destroys the surplus instance
+    }
+}
+
+/// An enclave checked out of an [`SgxEnclavePool`]; returns to the pool
+/// on drop after the pool's reset hook has run.
+pub struct SgxPooledEnclave {
+    enclave: Option<SgxEnclave>,
+    pool: SgxEnclavePool,
+}
+
+impl SgxPooledEnclave {
+    pub fn geteid(&self) -> sgx_enclave_id_t {
+        self.enclave.as_ref().unwrap().geteid()
+    }
+
+    pub fn get_target_info(&self) -> SgxResult<sgx_target_info_t> {
+        self.enclave.as_ref().unwrap().get_target_info()
+    }
+
+    /// Destroys the instance instead of returning it, e.g. after an
+    /// ECALL reported the enclave wedged.
+    pub fn discard(mut self) {
+        self.enclave.take();
+        // SgxEnclave's drop destroys it; our own drop then sees None
+    }
+}
+
+impl Drop for SgxPooledEnclave {
+    fn drop(&mut self) {
+        if let Some(enclave) = self.enclave.take() {
+            self.pool.check_in(enclave);
+        }
+    }
+}
@@ -0,0 +1,204 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License..
+
+//! Transition latency instrumentation.
+//!
+//! Enclave transitions are invisible in production: the generated
+//! bridges carry no timestamps, so every transition-cost investigation
+//! starts with rebuilding the enclave with printf. This module keeps
+//! per-function latency histograms on the untrusted side, where every
+//! ecall is issued and every ocall surfaces; wrapping the call site
+//! with [`rsgx_time_transition`] is the single interception point and
+//! needs no enclave rebuild.
+//!
+//! Histograms use power-of-two nanosecond buckets, so a record is a
+//! few arithmetic ops under a short mutex hold, and percentiles are
+//! read with bucket resolution (within 2x), which is what transition
+//! investigations need - distinguishing 3us warm calls from 40us cold
+//! ones and from millisecond stalls.
+//!
+//! ```rust,ignore
+//! let _t = rsgx_time_transition(TransitionKind::Ecall, "ecall_process_job");
+//! let status = unsafe { ecall_process_job(eid, &mut retval, job_ptr) };
+//! drop(_t); // records on drop
+//! ```
+
+use std::collections::HashMap;
+use std::string::{String, ToString};
+use std::sync::{Mutex, Once};
+use std::time::Instant;
+use std::vec::Vec;
+
+/// Power-of-two nanosecond buckets: bucket `i` holds samples in
+/// `[2^(i-1), 2^i)` ns, bucket 0 holds sub-nanosecond samples.
+const HISTOGRAM_BUCKETS: usize = 64;
+
+/// Which side of the boundary a timed call crosses.
+#[derive(Clone, Copy, PartialEq, Eq, Hash, Debug)]
+pub enum TransitionKind {
+    Ecall,
+    Ocall,
+}
+
+/// A latency histogram with power-of-two nanosecond buckets.
+#[derive(Clone)]
+pub struct TransitionHistogram {
+    count: u64,
+    sum_ns: u64,
+    min_ns: u64,
+    max_ns: u64,
+    buckets: [u64; HISTOGRAM_BUCKETS],
+}
+
+impl TransitionHistogram {
+    fn new() -> TransitionHistogram {
+        TransitionHistogram {
+            count: 0,
+            sum_ns: 0,
+            min_ns: u64::MAX,
+            max_ns: 0,
+            buckets: [0; HISTOGRAM_BUCKETS],
+        }
+    }
+
+    fn record(&mut self, ns: u64) {
+        self.count += 1;
+        self.sum_ns = self.sum_ns.wrapping_add(ns);
+        self.min_ns = self.min_ns.min(ns);
+        self.max_ns = self.max_ns.max(ns);
+        let index = (64 - ns.leading_zeros() as usize).min(HISTOGRAM_BUCKETS - 1);
+        self.buckets[index] += 1;
+    }
+
+    pub fn count(&self) -> u64 {
+        self.count
+    }
+
+    pub fn min_ns(&self) -> u64 {
+        if self.count == 0 { 0 } else { self.min_ns }
+    }
+
+    pub fn max_ns(&self) -> u64 {
+        self.max_ns
+    }
+
+    pub fn mean_ns(&self) -> u64 {
+        if self.count == 0 { 0 } else { self.sum_ns / self.count }
+    }
+
+    /// Upper bound of the bucket containing the `pct` percentile
+    /// (0.0..=100.0); resolution is the bucket width, i.e. within 2x.
+    pub fn value_at_percentile(&self, pct: f64) -> u64 {
+        if self.count == 0 {
+            return 0;
+        }
+        let rank = ((pct / 100.0) * self.count as f64).ceil() as u64;
+        let rank = rank.max(1).min(self.count);
+        let mut seen = 0_u64;
+        for (index, bucket) in self.buckets.iter().enumerate() {
+            seen += bucket;
+            if seen >= rank {
+                return if index == 0 { 1 } else { 1_u64 << index };
+            }
+        }
+        self.max_ns
+    }
+
+    /// The raw buckets, for export to an external metrics pipeline.
+    pub fn buckets(&self) -> &[u64; HISTOGRAM_BUCKETS] {
+        &self.buckets
+    }
+}
+
+/// One function's worth of a stats snapshot.
+#[derive(Clone)]
+pub struct TransitionStats {
+    pub name: String,
+    pub kind: TransitionKind,
+    pub histogram: TransitionHistogram,
+}
+
+fn registry() -> &'static Mutex<HashMap<(TransitionKind, String), TransitionHistogram>> {
+    static INIT: Once = Once::new();
+    static mut REGISTRY: Option<Mutex<HashMap<(TransitionKind, String), TransitionHistogram>>> =
+        None;
+    unsafe {
+        INIT.call_once(|| {
+            REGISTRY = Some(Mutex::new(HashMap::new()));
+        });
+        REGISTRY.as_ref().unwrap()
+    }
+}
+
+/// Times one transition; the elapsed time is recorded against `name`
+/// when the returned guard drops. Place the guard around the generated
+/// bridge call so the measurement includes the full crossing.
+pub fn rsgx_time_transition(kind: TransitionKind, name: &'static str) -> TransitionTimer {
+    TransitionTimer {
+        kind,
+        name,
+        start: Instant::now(),
+    }
+}
+
+/// Guard returned by [`rsgx_time_transition`]; records on drop.
+pub struct TransitionTimer {
+    kind: TransitionKind,
+    name: &'static str,
+    start: Instant,
+}
+
+impl Drop for TransitionTimer {
+    fn drop(&mut self) {
+        let elapsed = self.start.elapsed();
+        let ns = elapsed.as_secs().saturating_mul(1_000_000_000)
+            + u64::from(elapsed.subsec_nanos());
+        let mut map = registry().lock().unwrap();
+        map.entry((self.kind, self.name.to_string()))
+            .or_insert_with(TransitionHistogram::new)
+            .record(ns);
+    }
+}
+
+/// Records an externally measured transition, for callers that take
+/// their own timestamps (e.g. around a batched submission).
+pub fn rsgx_record_transition(kind: TransitionKind, name: &str, ns: u64) {
+    let mut map = registry().lock().unwrap();
+    map.entry((kind, name.to_string()))
+        .or_insert_with(TransitionHistogram::new)
+        .record(ns);
+}
+
+/// Returns a snapshot of every per-function histogram, sorted by name.
+pub fn rsgx_transition_stats_snapshot() -> Vec<TransitionStats> {
+    let map = registry().lock().unwrap();
+    let mut stats: Vec<TransitionStats> = map
+        .iter()
+        .map(|((kind, name), histogram)| TransitionStats {
+            name: name.clone(),
+            kind: *kind,
+            histogram: histogram.clone(),
+        })
+        .collect();
+    stats.sort_by(|a, b| a.name.cmp(&b.name));
+    stats
+}
+
+/// Clears all recorded histograms, e.g. between benchmark phases.
+pub fn rsgx_transition_stats_reset() {
+    registry().lock().unwrap().clear();
+}
@@ -0,0 +1,163 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License..
+
+//! NUMA-aware placement of switchless worker threads.
+//!
+//! The switchless runtime spawns its untrusted workers unpinned, so on
+//! a multi-socket host they drift wherever the scheduler puts them and
+//! a request enqueued by an enclave thread on socket 0 is routinely
+//! served by a worker spinning on socket 1 - every hand-off drags the
+//! request cachelines across the interconnect. The switchless call
+//! queue itself lives inside the prebuilt libsgx_uswitchless, so it
+//! cannot be split per socket here; what can be fixed in the loader is
+//! worker placement. [`rsgx_create_enclave_with_numa_workers`] sizes
+//! the worker pool per package and uses the switchless worker-start
+//! callback to pin each worker to its package as it comes up, so every
+//! socket that runs enclave threads also has local workers polling, and
+//! the common case is served without a cross-socket bounce.
+//!
+//! Pair it with [`pin_current_thread`](crate::pin_current_thread) on
+//! the application threads that make switchless ocalls: placement only
+//! removes cross-socket traffic when both ends of the queue stay put.
+
+use crate::topology::{cpu_topology, pin_current_thread};
+use sgx_types::*;
+use std::ffi::CStr;
+use std::ptr;
+use std::sync::atomic::{AtomicUsize, Ordering};
+use std::sync::Once;
+use std::vec::Vec;
+
+/// CPU lists of each package, in package-id order. Written once under
+/// `PACKAGES_INIT` before any worker can start.
+static mut PACKAGE_CPUS: Option<Vec<Vec<usize>>> = None;
+static PACKAGES_INIT: Once = Once::new();
+/// Round-robin cursors assigning starting workers to packages, one per
+/// worker type so trusted and untrusted workers spread independently.
+static UWORKER_SEQ: AtomicUsize = AtomicUsize::new(0);
+static TWORKER_SEQ: AtomicUsize = AtomicUsize::new(0);
+
+fn package_cpus() -> &'static [Vec<usize>] {
+    unsafe {
+        PACKAGES_INIT.call_once(|| {
+            let topo = cpu_topology();
+            let mut packages: Vec<(u32, Vec<usize>)> = Vec::new();
+            for t in topo {
+                match packages.iter_mut().find(|(id, _)| *id == t.package) {
+                    Some((_, cpus)) => cpus.push(t.cpu as usize),
+                    None => packages.push((t.package, vec![t.cpu as usize])),
+                }
+            }
+            packages.sort_by_key(|(id, _)| *id);
+            PACKAGE_CPUS = Some(packages.into_iter().map(|(_, cpus)| cpus).collect());
+        });
+        PACKAGE_CPUS.as_ref().unwrap()
+    }
+}
+
+/// Worker-start hook: pin the starting worker thread round-robin
+/// across packages. Both worker types run on host threads (trusted
+/// workers are host threads that enter the enclave and stay), so
+/// sched_setaffinity on the callback thread pins the worker itself.
+extern "C" fn numa_worker_callback(
+    worker_type: sgx_uswitchless_worker_type_t,
+    worker_event: sgx_uswitchless_worker_event_t,
+    _worker_stats: *const sgx_uswitchless_worker_stats_t,
+) {
+    if worker_event != sgx_uswitchless_worker_event_t::SGX_USWITCHLESS_WORKER_EVENT_START {
+        return;
+    }
+    let packages = package_cpus();
+    if packages.len() < 2 {
+        return;
+    }
+    let seq = match worker_type {
+        sgx_uswitchless_worker_type_t::SGX_USWITCHLESS_WORKER_TYPE_UNTRUSTED => {
+            UWORKER_SEQ.fetch_add(1, Ordering::Relaxed)
+        }
+        sgx_uswitchless_worker_type_t::SGX_USWITCHLESS_WORKER_TYPE_TRUSTED => {
+            TWORKER_SEQ.fetch_add(1, Ordering::Relaxed)
+        }
+    };
+    // best effort: an unpinned worker is merely as bad as before
+    let _ = pin_current_thread(&packages[seq % packages.len()]);
+}
+
+///
+/// The rsgx_create_enclave_with_numa_workers function loads and
+/// initializes the enclave with switchless calls enabled and the
+/// worker pool spread across CPU packages.
+///
+/// # Description
+///
+/// Behaves as rsgx_create_enclave_with_workers, except that the
+/// untrusted worker count is `uworkers_per_package` multiplied by the
+/// number of packages sysfs reports, and every switchless worker is
+/// pinned to one package as it starts, round-robin, so each socket
+/// serves its own enclave threads' requests from local workers. On a
+/// single-package host this degenerates to the plain switchless
+/// configuration with no pinning.
+///
+/// # Requirements
+///
+/// Library: libsgx_urts.so
+///
+pub fn rsgx_create_enclave_with_numa_workers(
+    file_name: &CStr,
+    debug: i32,
+    launch_token: &mut sgx_launch_token_t,
+    launch_token_updated: &mut i32,
+    misc_attr: &mut sgx_misc_attribute_t,
+    uworkers_per_package: u32,
+    num_tworkers: u32,
+) -> SgxResult<sgx_enclave_id_t> {
+    if uworkers_per_package == 0 {
+        return Err(sgx_status_t::SGX_ERROR_INVALID_PARAMETER);
+    }
+    // resolve the topology before creation so workers never race the
+    // Once from inside the callback
+    let npackages = package_cpus().len().max(1) as u32;
+
+    let mut us_config = sgx_uswitchless_config_t::default();
+    us_config.num_uworkers = uworkers_per_package.saturating_mul(npackages);
+    us_config.num_tworkers = num_tworkers;
+    us_config.callback_func
+        [sgx_uswitchless_worker_event_t::SGX_USWITCHLESS_WORKER_EVENT_START as usize] =
+        numa_worker_callback;
+
+    let mut enclave_ex_p: [*const c_void; 32] = [ptr::null(); 32];
+    enclave_ex_p[SGX_CREATE_ENCLAVE_EX_SWITCHLESS_BIT_IDX] =
+        &us_config as *const sgx_uswitchless_config_t as *const c_void;
+
+    let mut enclave_id: sgx_enclave_id_t = 0;
+    let ret = unsafe {
+        sgx_create_enclave_ex(
+            file_name.as_ptr() as *const c_schar,
+            debug as int32_t,
+            launch_token as *mut sgx_launch_token_t,
+            launch_token_updated as *mut int32_t,
+            &mut enclave_id as *mut sgx_enclave_id_t,
+            misc_attr as *mut sgx_misc_attribute_t,
+            SGX_CREATE_ENCLAVE_EX_SWITCHLESS,
+            &enclave_ex_p as *const [*const c_void; 32],
+        )
+    };
+    match ret {
+        sgx_status_t::SGX_SUCCESS => Ok(enclave_id),
+        _ => Err(ret),
+    }
+}
@@ -15,9 +15,11 @@
 // specific language governing permissions and limitations
 // under the License..
 
-use libc::{self, c_int, timespec};
+use libc::{self, c_int, c_long, timespec};
 use std::io::Error;
 
+use crate::topology;
+
 #[no_mangle]
 pub extern "C" fn u_sched_yield_ocall(error: *mut c_int) -> c_int {
     let mut errno = 0;
@@ -51,3 +53,38 @@ pub extern "C" fn u_nanosleep_ocall(
     }
     ret
 }
+
+#[no_mangle]
+pub extern "C" fn u_get_cpu_topology_ocall(
+    error: *mut c_int,
+    package_ids: *mut u32,
+    l3_ids: *mut u32,
+    count: usize,
+) -> c_long {
+    let topo = topology::cpu_topology();
+    if topo.is_empty() {
+        if !error.is_null() {
+            unsafe {
+                *error = libc::EINVAL;
+            }
+        }
+        return -1;
+    }
+    let fill = topo.len().min(count);
+    for entry in topo.iter().take(fill) {
+        unsafe {
+            if !package_ids.is_null() {
+                *package_ids.add(entry.cpu as usize) = entry.package;
+            }
+            if !l3_ids.is_null() {
+                *l3_ids.add(entry.cpu as usize) = entry.l3_id;
+            }
+        }
+    }
+    if !error.is_null() {
+        unsafe {
+            *error = 0;
+        }
+    }
+    topo.len() as c_long
+}
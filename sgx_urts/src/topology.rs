@@ -0,0 +1,112 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License..
+
+//! Host CPU topology discovery and worker-thread pinning.
+//!
+//! With the bound TCS policy the host thread that first enters the
+//! enclave on a TCS keeps backing that TCS for the enclave's lifetime,
+//! so pinning a worker thread before its first ECALL is exactly
+//! TCS-to-core affinity. Left to the scheduler, workers float across
+//! sockets and L3 domains and a partitioned enclave pays for every
+//! migration in cross-domain cache traffic; the functions here let the
+//! application read the machine's package/L3 layout and pin each worker
+//! into one domain before it enters.
+
+use libc::{self, cpu_set_t, CPU_SET, CPU_ZERO};
+use std::fs;
+use std::io::{Error, ErrorKind, Result};
+use std::mem;
+use std::vec::Vec;
+
+/// Where one logical CPU sits in the machine: its physical core, its
+/// package (socket) and its last-level-cache domain.
+#[derive(Copy, Clone, Debug, PartialEq, Eq)]
+pub struct CpuTopology {
+    pub cpu: u32,
+    pub core: u32,
+    pub package: u32,
+    pub l3_id: u32,
+}
+
+fn read_sysfs_u32(path: &str) -> Option<u32> {
+    fs::read_to_string(path).ok()?.trim().parse().ok()
+}
+
+/// Reads the topology of every configured CPU from sysfs.
+///
+/// A CPU whose L3 id is not exposed inherits its package id, so
+/// grouping by `l3_id` stays meaningful on kernels without cache ids.
+pub fn cpu_topology() -> Vec<CpuTopology> {
+    let ncpu = unsafe { libc::sysconf(libc::_SC_NPROCESSORS_CONF) };
+    let mut topo = Vec::new();
+    if ncpu <= 0 {
+        return topo;
+    }
+    for cpu in 0..ncpu as u32 {
+        let base = format!("/sys/devices/system/cpu/cpu{}", cpu);
+        let package =
+            read_sysfs_u32(&format!("{}/topology/physical_package_id", base)).unwrap_or(0);
+        let core = read_sysfs_u32(&format!("{}/topology/core_id", base)).unwrap_or(cpu);
+        let l3_id = read_sysfs_u32(&format!("{}/cache/index3/id", base)).unwrap_or(package);
+        topo.push(CpuTopology {
+            cpu,
+            core,
+            package,
+            l3_id,
+        });
+    }
+    topo
+}
+
+/// Pins the calling thread to the given CPUs.
+///
+/// Call from a worker thread before its first ECALL: with the bound TCS
+/// policy that pins the TCS the thread will back. The affinity persists
+/// across every subsequent enclave entry on this thread.
+pub fn pin_current_thread(cpus: &[usize]) -> Result<()> {
+    if cpus.is_empty() {
+        return Err(Error::from(ErrorKind::InvalidInput));
+    }
+    let mut set: cpu_set_t = unsafe { mem::zeroed() };
+    unsafe {
+        CPU_ZERO(&mut set);
+    }
+    for &cpu in cpus {
+        if cpu >= 8 * mem::size_of::<cpu_set_t>() {
+            return Err(Error::from(ErrorKind::InvalidInput));
+        }
+        unsafe {
+            CPU_SET(cpu, &mut set);
+        }
+    }
+    let ret = unsafe { libc::sched_setaffinity(0, mem::size_of::<cpu_set_t>(), &set) };
+    if ret != 0 {
+        return Err(Error::last_os_error());
+    }
+    Ok(())
+}
+
+/// Pins the calling thread to every CPU sharing the given L3 domain,
+/// the usual placement for one shard of a partitioned enclave engine.
+pub fn pin_current_thread_to_l3(l3_id: u32) -> Result<()> {
+    let cpus: Vec<usize> = cpu_topology()
+        .into_iter()
+        .filter(|t| t.l3_id == l3_id)
+        .map(|t| t.cpu as usize)
+        .collect();
+    pin_current_thread(&cpus)
+}
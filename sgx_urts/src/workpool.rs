@@ -0,0 +1,322 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License..
+
+//! Shared worker pool for co-located enclaves' hot-call channels.
+//!
+//! A dedicated responder thread per channel (`hotcall::serve`) burns one
+//! host core per enclave whether calls arrive or not; with several
+//! enclaves per host the idle spinning dominates. [`SgxSharedWorkerPool`]
+//! serves every registered channel from one set of workers, so host
+//! threads scale with aggregate load, not enclave count: one keeper
+//! thread always polls (with escalating sleep when everything is idle),
+//! extra workers are woken or spawned only while a pass leaves backlog
+//! behind, and they park again when their own passes come up empty.
+//!
+//! Scheduling is proportional-share by weight: in each pass over the
+//! channels a worker serves at most `weight` calls from one registration
+//! before moving to the next, so under contention an enclave's share of
+//! the pool is its weight over the sum of weights, and an idle channel
+//! costs one atomic load per pass.
+
+use crate::hotcall::{is_stopped, try_serve_one, HotCallSlot};
+use sgx_types::sgx_enclave_id_t;
+use std::boxed::Box;
+use std::sync::atomic::{AtomicBool, AtomicU64, AtomicUsize, Ordering};
+use std::sync::{Arc, Condvar, Mutex};
+use std::thread;
+use std::time::Duration;
+use std::vec::Vec;
+
+/// Empty passes a worker makes before it parks (extra workers) or starts
+/// sleeping between passes (the keeper).
+const IDLE_PASSES: u32 = 256;
+/// The keeper's sleep between passes escalates up to this while the whole
+/// pool is idle; the first pending call after an idle stretch pays at
+/// most this much extra latency.
+const MAX_IDLE_SLEEP_US: u64 = 500;
+
+type Dispatch = Box<dyn FnMut(u32, *mut u8) -> i64 + Send>;
+
+struct Registration {
+    eid: sgx_enclave_id_t,
+    slot: usize, // *const HotCallSlot; usize so the registry is Send
+    weight: u32,
+    serving: AtomicBool,
+    served: AtomicU64,
+    dispatch: Mutex<Dispatch>,
+}
+
+struct PoolShared {
+    registry: Mutex<Vec<Arc<Registration>>>,
+    parked: Condvar,
+    /// Workers currently scanning (live minus parked).
+    awake: AtomicUsize,
+    /// Workers blocked on `parked`.
+    parked_count: AtomicUsize,
+    /// Worker threads in existence, parked or not.
+    live: AtomicUsize,
+    max_workers: usize,
+    stop: AtomicBool,
+}
+
+/// Per-registration service counters, for sizing weights from observed
+/// load.
+#[derive(Copy, Clone, Debug, Default)]
+pub struct SgxWorkerPoolStats {
+    pub eid: sgx_enclave_id_t,
+    pub weight: u32,
+    pub served: u64,
+}
+
+///
+/// SgxSharedWorkerPool serves the hot-call channels of multiple enclave
+/// instances from one set of host worker threads.
+///
+/// # Description
+///
+/// Register each enclave's channel slot with a weight; the pool's workers
+/// poll all registered slots and complete pending calls, giving each
+/// registration up to `weight` completions per pass. `max_workers` bounds
+/// the host threads the pool will ever run; all but one park whenever
+/// their passes find no work.
+///
+pub struct SgxSharedWorkerPool {
+    shared: Arc<PoolShared>,
+}
+
+impl SgxSharedWorkerPool {
+    ///
+    /// Create a pool running at most `max_workers` host threads (at least
+    /// one). The first worker starts when the first channel is
+    /// registered.
+    ///
+    pub fn new(max_workers: usize) -> SgxSharedWorkerPool {
+        SgxSharedWorkerPool {
+            shared: Arc::new(PoolShared {
+                registry: Mutex::new(Vec::new()),
+                parked: Condvar::new(),
+                awake: AtomicUsize::new(0),
+                parked_count: AtomicUsize::new(0),
+                live: AtomicUsize::new(0),
+                max_workers: max_workers.max(1),
+                stop: AtomicBool::new(false),
+            }),
+        }
+    }
+
+    ///
+    /// Register one enclave's channel. `slot` is the address handed to
+    /// the enclave's caller side and must stay valid until `unregister`;
+    /// `dispatch` handles the channel's `(fn_id, data)` requests.
+    /// `weight` is the registration's proportional share (0 is treated
+    /// as 1).
+    ///
+    pub fn register(
+        &self,
+        eid: sgx_enclave_id_t,
+        slot: *const HotCallSlot,
+        weight: u32,
+        dispatch: Box<dyn FnMut(u32, *mut u8) -> i64 + Send>,
+    ) {
+        let registration = Arc::new(Registration {
+            eid,
+            slot: slot as usize,
+            weight: weight.max(1),
+            serving: AtomicBool::new(false),
+            served: AtomicU64::new(0),
+            dispatch: Mutex::new(dispatch),
+        });
+
+        let mut registry = self.shared.registry.lock().unwrap();
+        registry.push(registration);
+        drop(registry);
+
+        if self.shared.live.load(Ordering::Relaxed) == 0 {
+            spawn_worker(&self.shared, true);
+        }
+    }
+
+    ///
+    /// Remove an enclave's channels from the pool. Returns once no
+    /// worker is mid-call on them, after which the slot memory may be
+    /// freed.
+    ///
+    pub fn unregister(&self, eid: sgx_enclave_id_t) {
+        let removed: Vec<Arc<Registration>> = {
+            let mut registry = self.shared.registry.lock().unwrap();
+            let mut removed = Vec::new();
+            let mut index = 0;
+            while index < registry.len() {
+                if registry[index].eid == eid {
+                    removed.push(registry.remove(index));
+                } else {
+                    index += 1;
+                }
+            }
+            removed
+        };
+        for registration in removed {
+            while registration.serving.load(Ordering::Acquire) {
+                thread::yield_now();
+            }
+        }
+    }
+
+    ///
+    /// Per-registration counters, in registry order.
+    ///
+    pub fn stats(&self) -> Vec<SgxWorkerPoolStats> {
+        let registry = self.shared.registry.lock().unwrap();
+        registry
+            .iter()
+            .map(|r| SgxWorkerPoolStats {
+                eid: r.eid,
+                weight: r.weight,
+                served: r.served.load(Ordering::Relaxed),
+            })
+            .collect()
+    }
+
+    ///
+    /// Number of worker threads currently scanning (not parked).
+    ///
+    pub fn awake_workers(&self) -> usize {
+        self.shared.awake.load(Ordering::Relaxed)
+    }
+
+    ///
+    /// Stop all workers. Registered channels are not shut down; callers
+    /// blocked in them must be released by their own `shutdown`.
+    ///
+    pub fn shutdown(&self) {
+        self.shared.stop.store(true, Ordering::Release);
+        self.shared.parked.notify_all();
+    }
+}
+
+impl Drop for SgxSharedWorkerPool {
+    fn drop(&mut self) {
+        self.shutdown();
+    }
+}
+
+fn spawn_worker(shared: &Arc<PoolShared>, keeper: bool) {
+    let shared = Arc::clone(shared);
+    shared.live.fetch_add(1, Ordering::Relaxed);
+    shared.awake.fetch_add(1, Ordering::Relaxed);
+    let spawned = thread::Builder::new()
+        .name("sgx_workpool".into())
+        .spawn({
+            let shared = Arc::clone(&shared);
+            move || worker_loop(shared, keeper)
+        });
+    if spawned.is_err() {
+        // Out of host threads; existing workers keep absorbing the load.
+        shared.awake.fetch_sub(1, Ordering::Relaxed);
+        shared.live.fetch_sub(1, Ordering::Relaxed);
+    }
+}
+
+/// Wake a parked worker for backlog, or spawn one if none is parked and
+/// the caps allow another.
+fn enlist_help(shared: &Arc<PoolShared>, channels: usize) {
+    if shared.parked_count.load(Ordering::Relaxed) > 0 {
+        shared.parked.notify_one();
+        return;
+    }
+    let cap = shared.max_workers.min(channels.max(1));
+    if shared.live.load(Ordering::Relaxed) < cap {
+        spawn_worker(shared, false);
+    }
+}
+
+fn worker_loop(shared: Arc<PoolShared>, keeper: bool) {
+    let mut idle_passes = 0_u32;
+    let mut idle_sleep_us = 1_u64;
+
+    while !shared.stop.load(Ordering::Acquire) {
+        let registry: Vec<Arc<Registration>> = shared.registry.lock().unwrap().clone();
+        let mut served = 0_u64;
+        let mut backlog = false;
+
+        for registration in &registry {
+            let slot = unsafe { &*(registration.slot as *const HotCallSlot) };
+            if is_stopped(slot) {
+                continue;
+            }
+            // One worker per channel at a time; a hot-call slot holds a
+            // single in-flight request, so more would only contend.
+            if registration
+                .serving
+                .compare_exchange(false, true, Ordering::Acquire, Ordering::Relaxed)
+                .is_err()
+            {
+                continue;
+            }
+            let mut dispatch = registration.dispatch.lock().unwrap();
+            let mut quota = registration.weight;
+            while quota > 0 && try_serve_one(slot, &mut **dispatch) {
+                quota -= 1;
+                served += 1;
+            }
+            drop(dispatch);
+            registration.serving.store(false, Ordering::Release);
+            registration
+                .served
+                .fetch_add(u64::from(registration.weight - quota), Ordering::Relaxed);
+            if quota == 0 {
+                // Weight exhausted with the caller likely still issuing:
+                // leave the rest for the next pass or another worker.
+                backlog = true;
+            }
+        }
+
+        if served > 0 {
+            idle_passes = 0;
+            idle_sleep_us = 1;
+            if backlog {
+                enlist_help(&shared, registry.len());
+            }
+            continue;
+        }
+
+        idle_passes += 1;
+        if idle_passes < IDLE_PASSES {
+            thread::yield_now();
+            continue;
+        }
+
+        if keeper {
+            // The keeper never parks - an enclave-side caller cannot
+            // wake a sleeping host thread - but backs off while idle.
+            thread::sleep(Duration::from_micros(idle_sleep_us));
+            idle_sleep_us = (idle_sleep_us * 2).min(MAX_IDLE_SLEEP_US);
+            idle_passes = IDLE_PASSES;
+        } else {
+            let guard = shared.registry.lock().unwrap();
+            shared.awake.fetch_sub(1, Ordering::Relaxed);
+            shared.parked_count.fetch_add(1, Ordering::Relaxed);
+            let _guard = shared.parked.wait(guard).unwrap();
+            shared.parked_count.fetch_sub(1, Ordering::Relaxed);
+            shared.awake.fetch_add(1, Ordering::Relaxed);
+            idle_passes = 0;
+        }
+    }
+
+    shared.awake.fetch_sub(1, Ordering::Relaxed);
+    shared.live.fetch_sub(1, Ordering::Relaxed);
+}
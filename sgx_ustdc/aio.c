@@ -0,0 +1,236 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License..
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <sys/types.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <errno.h>
+#include <pthread.h>
+
+/*
+ * Asynchronous ocall completion.
+ *
+ * A blocking ocall parks its TCS until the untrusted syscall returns, so
+ * a TCS stuck in fsync is lost to enclave work. The queue here decouples
+ * the two: the enclave fills a job descriptor in untrusted memory and
+ * submits it with one quick ocall, worker threads run the syscall, and
+ * completion is published through the descriptor's state field plus the
+ * same per-TCS event the sync primitives already use for wakeups. The
+ * submitting TCS returns to enclave work immediately and polls or waits
+ * at its convenience.
+ */
+
+/* keep in sync with sgx_tstd/src/aio.rs */
+#define AIO_OP_FSYNC        0
+#define AIO_OP_FDATASYNC    1
+#define AIO_OP_WRITE        2
+#define AIO_OP_PWRITE64     3
+#define AIO_OP_PREAD64      4
+
+#define AIO_STATE_SUBMITTED 0
+#define AIO_STATE_DONE      1
+
+struct aio_job {
+    int32_t op;
+    int32_t fd;
+    uint64_t offset;
+    void *buf;
+    uint64_t len;
+    int64_t result;
+    int32_t error;
+    volatile int32_t state;
+    const void *tcs;
+};
+
+#define AIO_QUEUE_CAPACITY 1024
+#define AIO_MAX_WORKERS    64
+
+struct aio_queue {
+    pthread_mutex_t lock;
+    pthread_cond_t more;
+    struct aio_job *ring[AIO_QUEUE_CAPACITY];
+    size_t head;
+    size_t tail;
+    size_t count;
+    int stop;
+    int nworkers;
+    pthread_t workers[AIO_MAX_WORKERS];
+};
+
+/* event.c */
+int u_thread_set_event_ocall(int *error, const void *tcs);
+
+static void aio_execute(struct aio_job *job)
+{
+    ssize_t ret = -1;
+
+    switch (job->op) {
+    case AIO_OP_FSYNC:
+        ret = fsync(job->fd);
+        break;
+    case AIO_OP_FDATASYNC:
+        ret = fdatasync(job->fd);
+        break;
+    case AIO_OP_WRITE:
+        ret = write(job->fd, job->buf, (size_t)job->len);
+        break;
+    case AIO_OP_PWRITE64:
+        ret = pwrite64(job->fd, job->buf, (size_t)job->len, (off64_t)job->offset);
+        break;
+    case AIO_OP_PREAD64:
+        ret = pread64(job->fd, job->buf, (size_t)job->len, (off64_t)job->offset);
+        break;
+    default:
+        errno = EINVAL;
+        break;
+    }
+
+    job->result = (int64_t)ret;
+    job->error = ret == -1 ? errno : 0;
+    __atomic_store_n(&job->state, AIO_STATE_DONE, __ATOMIC_RELEASE);
+
+    if (job->tcs != NULL) {
+        int error = 0;
+        u_thread_set_event_ocall(&error, job->tcs);
+    }
+}
+
+static void *aio_worker(void *arg)
+{
+    struct aio_queue *queue = (struct aio_queue *)arg;
+
+    for (;;) {
+        pthread_mutex_lock(&queue->lock);
+        while (queue->count == 0 && !queue->stop) {
+            pthread_cond_wait(&queue->more, &queue->lock);
+        }
+        if (queue->count == 0 && queue->stop) {
+            pthread_mutex_unlock(&queue->lock);
+            return NULL;
+        }
+        struct aio_job *job = queue->ring[queue->head];
+        queue->head = (queue->head + 1) % AIO_QUEUE_CAPACITY;
+        queue->count--;
+        pthread_mutex_unlock(&queue->lock);
+
+        aio_execute(job);
+    }
+}
+
+void *u_aio_queue_create_ocall(int *error, int workers)
+{
+    if (workers <= 0 || workers > AIO_MAX_WORKERS) {
+        if (error) {
+            *error = EINVAL;
+        }
+        return NULL;
+    }
+
+    struct aio_queue *queue = (struct aio_queue *)calloc(1, sizeof(struct aio_queue));
+    if (queue == NULL) {
+        if (error) {
+            *error = ENOMEM;
+        }
+        return NULL;
+    }
+
+    pthread_mutex_init(&queue->lock, NULL);
+    pthread_cond_init(&queue->more, NULL);
+
+    for (int i = 0; i < workers; i++) {
+        if (pthread_create(&queue->workers[i], NULL, aio_worker, queue) != 0) {
+            int err = errno;
+            pthread_mutex_lock(&queue->lock);
+            queue->stop = 1;
+            pthread_cond_broadcast(&queue->more);
+            pthread_mutex_unlock(&queue->lock);
+            for (int j = 0; j < i; j++) {
+                pthread_join(queue->workers[j], NULL);
+            }
+            free(queue);
+            if (error) {
+                *error = err;
+            }
+            return NULL;
+        }
+        queue->nworkers++;
+    }
+
+    if (error) {
+        *error = 0;
+    }
+    return queue;
+}
+
+void u_aio_queue_destroy_ocall(void *queue_raw)
+{
+    struct aio_queue *queue = (struct aio_queue *)queue_raw;
+    if (queue == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&queue->lock);
+    queue->stop = 1;
+    pthread_cond_broadcast(&queue->more);
+    pthread_mutex_unlock(&queue->lock);
+
+    for (int i = 0; i < queue->nworkers; i++) {
+        pthread_join(queue->workers[i], NULL);
+    }
+    pthread_mutex_destroy(&queue->lock);
+    pthread_cond_destroy(&queue->more);
+    free(queue);
+}
+
+int u_aio_submit_ocall(int *error, void *queue_raw, void *job_raw)
+{
+    struct aio_queue *queue = (struct aio_queue *)queue_raw;
+    struct aio_job *job = (struct aio_job *)job_raw;
+
+    if (queue == NULL || job == NULL) {
+        if (error) {
+            *error = EINVAL;
+        }
+        return -1;
+    }
+
+    pthread_mutex_lock(&queue->lock);
+    if (queue->stop || queue->count == AIO_QUEUE_CAPACITY) {
+        int full = !queue->stop;
+        pthread_mutex_unlock(&queue->lock);
+        if (error) {
+            *error = full ? EAGAIN : ECANCELED;
+        }
+        return -1;
+    }
+    queue->ring[queue->tail] = job;
+    queue->tail = (queue->tail + 1) % AIO_QUEUE_CAPACITY;
+    queue->count++;
+    pthread_cond_signal(&queue->more);
+    pthread_mutex_unlock(&queue->lock);
+
+    if (error) {
+        *error = 0;
+    }
+    return 0;
+}
@@ -0,0 +1,139 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License..
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <sys/types.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+
+/*
+ * Untrusted producer half of sync::uchannel.
+ *
+ * The enclave allocates the ring in untrusted memory and hands the base
+ * pointer to the host; host threads then push messages with
+ * u_channel_send and ring the consumer's doorbell through the ordinary
+ * per-TCS event, with no ecall on the hot path. The slot protocol is a
+ * bounded MPMC sequence ring restricted to one consumer: a producer
+ * claims a slot by advancing enqueue_pos when the slot's sequence
+ * matches, fills it, and publishes it by bumping the sequence.
+ *
+ * Layout must stay in sync with sgx_tstd/src/sync/uchannel.rs. The
+ * consumer treats every field here as hostile input; nothing a producer
+ * writes can take the enclave past a bounds check.
+ */
+
+struct chan_hdr {
+    uint64_t capacity;    /* slots, power of two */
+    uint64_t slot_size;   /* payload bytes per slot, multiple of 8 */
+    uint64_t enqueue_pos; /* producer cursor */
+    uint64_t dequeue_pos; /* consumer cursor (mirror for full detection) */
+    uint64_t tcs;         /* parked consumer's TCS */
+    uint32_t waiting;     /* consumer is parked on the event */
+    uint32_t closed;
+};
+
+struct chan_slot {
+    uint64_t seq;
+    uint64_t len;
+    unsigned char payload[];
+};
+
+/* event.c */
+int u_thread_set_event_ocall(int *error, const void *tcs);
+
+static inline struct chan_slot *chan_slot_at(struct chan_hdr *h, uint64_t pos)
+{
+    size_t stride = sizeof(struct chan_slot) + (size_t)h->slot_size;
+    unsigned char *slots = (unsigned char *)(h + 1);
+    return (struct chan_slot *)(slots + (pos & (h->capacity - 1)) * stride);
+}
+
+static void chan_doorbell(struct chan_hdr *h)
+{
+    if (__atomic_exchange_n(&h->waiting, 0, __ATOMIC_ACQ_REL)) {
+        int error = 0;
+        u_thread_set_event_ocall(&error, (const void *)h->tcs);
+    }
+}
+
+/*
+ * Pushes one message of `len` bytes. Returns 0 on success; -1 with
+ * errno EAGAIN when the ring is full, EPIPE when the channel is closed,
+ * EINVAL when the message does not fit a slot. Safe to call from any
+ * number of host threads.
+ */
+int u_channel_send(void *chan, const void *data, size_t len)
+{
+    struct chan_hdr *h = (struct chan_hdr *)chan;
+
+    if (h == NULL || (len > 0 && data == NULL) || len > h->slot_size) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (__atomic_load_n(&h->closed, __ATOMIC_ACQUIRE)) {
+        errno = EPIPE;
+        return -1;
+    }
+
+    uint64_t pos = __atomic_load_n(&h->enqueue_pos, __ATOMIC_RELAXED);
+    struct chan_slot *slot;
+    for (;;) {
+        slot = chan_slot_at(h, pos);
+        uint64_t seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+        int64_t diff = (int64_t)(seq - pos);
+        if (diff == 0) {
+            if (__atomic_compare_exchange_n(&h->enqueue_pos, &pos, pos + 1, 1,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+        } else if (diff < 0) {
+            errno = EAGAIN;
+            return -1;
+        } else {
+            pos = __atomic_load_n(&h->enqueue_pos, __ATOMIC_RELAXED);
+        }
+    }
+
+    if (len > 0) {
+        memcpy(slot->payload, data, len);
+    }
+    slot->len = (uint64_t)len;
+    __atomic_store_n(&slot->seq, pos + 1, __ATOMIC_RELEASE);
+
+    chan_doorbell(h);
+    return 0;
+}
+
+/*
+ * Marks the channel closed and wakes the consumer; messages already in
+ * the ring stay receivable. Producers must not touch the ring after the
+ * consumer has been dropped on the trusted side.
+ */
+void u_channel_close(void *chan)
+{
+    struct chan_hdr *h = (struct chan_hdr *)chan;
+    if (h == NULL) {
+        return;
+    }
+    __atomic_store_n(&h->closed, 1, __ATOMIC_RELEASE);
+    chan_doorbell(h);
+}
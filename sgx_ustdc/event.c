@@ -3,8 +3,11 @@
 #include <unistd.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <errno.h>
+#include <time.h>
 #include <sys/syscall.h>
+#include <sys/timerfd.h>
 #include <pthread.h>
 #include <stdbool.h>
 #include <string.h>
@@ -156,15 +159,276 @@ int se_event_wait_timeout(se_handle_t se_event, const struct timespec *timeout)
     return 0;
 }
 
+/*
+ * Managed timeouts: one timerfd for every timed wait.
+ *
+ * With a timespec per waiter each timed wait arms and tears down its
+ * own kernel futex timer; at thousands of condvar timeouts that churn
+ * is pure kernel overhead. Instead, timed waiters park on an untimed
+ * futex and register their absolute deadline in a min-heap ordered by
+ * expiry. A single service thread sleeps on one timerfd armed for the
+ * earliest deadline, pops everything due in one sweep and wakes the
+ * expired waiters back to back, so wakeups batch and the kernel sees
+ * exactly one armed timer no matter how many waits are pending.
+ *
+ * A heap rather than a timing wheel: a few thousand entries do not
+ * justify wheel cascades, and the indexed heap keeps removal on the
+ * normal-wakeup path O(log n) without periodic tick work.
+ */
+struct se_timed_node {
+    se_handle_t se_event;
+    struct timespec deadline;
+    int expired;
+    size_t heap_index; /* SIZE_MAX when not in the heap */
+};
+
+static struct se_timed_node **g_timed_heap = NULL;
+static size_t g_timed_count = 0;
+static size_t g_timed_cap = 0;
+static pthread_mutex_t g_timed_lock = PTHREAD_MUTEX_INITIALIZER;
+static int g_timed_fd = -1;
+static pthread_once_t g_timed_once = PTHREAD_ONCE_INIT;
+
+static bool ts_before(const struct timespec *a, const struct timespec *b)
+{
+    return a->tv_sec < b->tv_sec ||
+           (a->tv_sec == b->tv_sec && a->tv_nsec < b->tv_nsec);
+}
+
+static void se_timed_arm(const struct timespec *deadline)
+{
+    struct itimerspec its;
+
+    memset(&its, 0, sizeof(its));
+    if (deadline != NULL) {
+        its.it_value = *deadline;
+        /* an all-zero it_value disarms; bump to the next nanosecond */
+        if (its.it_value.tv_sec == 0 && its.it_value.tv_nsec == 0)
+            its.it_value.tv_nsec = 1;
+    }
+    timerfd_settime(g_timed_fd, TFD_TIMER_ABSTIME, &its, NULL);
+}
+
+static void se_timed_heap_swap(size_t i, size_t j)
+{
+    struct se_timed_node *tmp = g_timed_heap[i];
+
+    g_timed_heap[i] = g_timed_heap[j];
+    g_timed_heap[j] = tmp;
+    g_timed_heap[i]->heap_index = i;
+    g_timed_heap[j]->heap_index = j;
+}
+
+static void se_timed_heap_up(size_t i)
+{
+    while (i > 0) {
+        size_t parent = (i - 1) / 2;
+        if (!ts_before(&g_timed_heap[i]->deadline, &g_timed_heap[parent]->deadline))
+            break;
+        se_timed_heap_swap(i, parent);
+        i = parent;
+    }
+}
+
+static void se_timed_heap_down(size_t i)
+{
+    for (;;) {
+        size_t left = 2 * i + 1;
+        size_t right = left + 1;
+        size_t least = i;
+
+        if (left < g_timed_count &&
+            ts_before(&g_timed_heap[left]->deadline, &g_timed_heap[least]->deadline))
+            least = left;
+        if (right < g_timed_count &&
+            ts_before(&g_timed_heap[right]->deadline, &g_timed_heap[least]->deadline))
+            least = right;
+        if (least == i)
+            break;
+        se_timed_heap_swap(i, least);
+        i = least;
+    }
+}
+
+static bool se_timed_heap_push(struct se_timed_node *node)
+{
+    if (g_timed_count == g_timed_cap) {
+        size_t cap = g_timed_cap ? g_timed_cap * 2 : 64;
+        struct se_timed_node **heap =
+            (struct se_timed_node **)realloc(g_timed_heap, cap * sizeof(*heap));
+        if (heap == NULL)
+            return false;
+        g_timed_heap = heap;
+        g_timed_cap = cap;
+    }
+    g_timed_heap[g_timed_count] = node;
+    node->heap_index = g_timed_count;
+    g_timed_count++;
+    se_timed_heap_up(node->heap_index);
+    return true;
+}
+
+static void se_timed_heap_remove(size_t i)
+{
+    g_timed_heap[i]->heap_index = SIZE_MAX;
+    g_timed_count--;
+    if (i != g_timed_count) {
+        g_timed_heap[i] = g_timed_heap[g_timed_count];
+        g_timed_heap[i]->heap_index = i;
+        se_timed_heap_down(i);
+        se_timed_heap_up(i);
+    }
+}
+
+static void *se_timed_thread(void *arg)
+{
+    (void)arg;
+
+    for (;;) {
+        uint64_t ticks = 0;
+        struct timespec now;
+
+        if (read(g_timed_fd, &ticks, sizeof(ticks)) < 0 && errno != EINTR)
+            continue;
+
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        pthread_mutex_lock(&g_timed_lock);
+        while (g_timed_count > 0 &&
+               !ts_before(&now, &g_timed_heap[0]->deadline)) {
+            struct se_timed_node *node = g_timed_heap[0];
+
+            se_timed_heap_remove(0);
+            /* publish expiry before any wake so the waiter sees it */
+            __atomic_store_n(&node->expired, 1, __ATOMIC_RELEASE);
+            if (__sync_val_compare_and_swap((int *)node->se_event, -1, 0) == -1) {
+                syscall(__NR_futex, node->se_event, FUTEX_WAKE, 1, NULL, NULL, 0);
+            }
+        }
+        se_timed_arm(g_timed_count > 0 ? &g_timed_heap[0]->deadline : NULL);
+        pthread_mutex_unlock(&g_timed_lock);
+    }
+    return NULL;
+}
+
+static void se_timed_init(void)
+{
+    pthread_t tid;
+
+    g_timed_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+    if (g_timed_fd < 0)
+        return;
+    if (pthread_create(&tid, NULL, se_timed_thread, NULL) != 0) {
+        close(g_timed_fd);
+        g_timed_fd = -1;
+        return;
+    }
+    pthread_detach(tid);
+}
+
+static int se_event_wait_timeout_managed(se_handle_t se_event,
+                                         const struct timespec *timeout)
+{
+    struct se_timed_node *node;
+
+    pthread_once(&g_timed_once, se_timed_init);
+    if (g_timed_fd < 0)
+        return se_event_wait_timeout(se_event, timeout);
+
+    node = (struct se_timed_node *)malloc(sizeof(*node));
+    if (node == NULL)
+        return se_event_wait_timeout(se_event, timeout);
+
+    node->se_event = se_event;
+    node->expired = 0;
+    node->heap_index = SIZE_MAX;
+    clock_gettime(CLOCK_MONOTONIC, &node->deadline);
+    node->deadline.tv_sec += timeout->tv_sec;
+    node->deadline.tv_nsec += timeout->tv_nsec;
+    if (node->deadline.tv_nsec >= 1000000000L) {
+        node->deadline.tv_sec += 1;
+        node->deadline.tv_nsec -= 1000000000L;
+    }
+
+    pthread_mutex_lock(&g_timed_lock);
+    if (!se_timed_heap_push(node)) {
+        pthread_mutex_unlock(&g_timed_lock);
+        free(node);
+        return se_event_wait_timeout(se_event, timeout);
+    }
+    if (g_timed_heap[0] == node)
+        se_timed_arm(&node->deadline);
+    pthread_mutex_unlock(&g_timed_lock);
+
+    if (__sync_fetch_and_add((int *)se_event, -1) == 0) {
+        while (!__atomic_load_n(&node->expired, __ATOMIC_ACQUIRE)) {
+            syscall(__NR_futex, se_event, FUTEX_WAIT, -1, NULL, NULL, 0);
+            if (*(volatile int *)se_event != -1)
+                break;
+        }
+    }
+
+    pthread_mutex_lock(&g_timed_lock);
+    if (node->heap_index != SIZE_MAX) {
+        bool was_root = node->heap_index == 0;
+
+        se_timed_heap_remove(node->heap_index);
+        if (was_root)
+            se_timed_arm(g_timed_count > 0 ? &g_timed_heap[0]->deadline : NULL);
+    }
+    pthread_mutex_unlock(&g_timed_lock);
+
+    int timed_out = node->expired;
+    free(node);
+
+    if (timed_out) {
+        /* mirror se_event_wait_timeout: reset a still-parked counter */
+        __sync_val_compare_and_swap((int *)se_event, -1, 0);
+        errno = ETIMEDOUT;
+        return -1;
+    }
+    return 0;
+}
+
 int se_event_wake(se_handle_t se_event)
 {
     if (se_event == NULL)
         return EINVAL;
 
     if (__sync_fetch_and_add((int*)se_event, 1) != 0) {
-       syscall(__NR_futex, se_event, FUTEX_WAKE, 1, NULL, NULL, 0);  
+       syscall(__NR_futex, se_event, FUTEX_WAKE, 1, NULL, NULL, 0);
+    }
+
+    return 0;
+}
+
+/*
+ * Wake a batch of events in two phases: first publish every counter
+ * increment, then issue the FUTEX_WAKE syscalls for the events that
+ * actually had a waiter. Flipping all counters before the first wake
+ * lets spinning waiters leave without a syscall and releases the whole
+ * batch back-to-back instead of serializing wake-ups one by one.
+ */
+int se_event_wake_batch(se_handle_t *se_events, int total)
+{
+    int i = 0;
+
+    if (se_events == NULL || total < 0)
+        return EINVAL;
+
+    for (i = 0; i < total; i++) {
+        if (se_events[i] == NULL)
+            return EINVAL;
+        if (__sync_fetch_and_add((int *)se_events[i], 1) == 0) {
+            /* no waiter: nothing to wake for this slot */
+            se_events[i] = NULL;
+        }
+    }
+
+    for (i = 0; i < total; i++) {
+        if (se_events[i] != NULL) {
+            syscall(__NR_futex, se_events[i], FUTEX_WAKE, 1, NULL, NULL, 0);
+        }
     }
-    
     return 0;
 }
 
@@ -301,7 +565,7 @@ int u_thread_wait_event_ocall(int *error, const tcs_handle_t tcs, const struct t
     if (timeout == NULL) {
         ret = se_event_wait(se_event);
     } else {
-        ret = se_event_wait_timeout(se_event, timeout);
+        ret = se_event_wait_timeout_managed(se_event, timeout);
     }
     if (ret != 0) {
         if (error) {
@@ -319,28 +583,44 @@ int u_thread_wait_event_ocall(int *error, const tcs_handle_t tcs, const struct t
 int u_thread_set_multiple_events_ocall(int *error, const tcs_handle_t *tcss, int total)
 {
     int i = 0;
-    se_handle_t se_event = NULL;
+    se_handle_t stack_events[64];
+    se_handle_t *se_events = stack_events;
 
     if (error) {
         *error = EINVAL;
     }
-        
-    for (i = 0; i < total; i ++) {
 
-        se_event = get_tcs_event(tcss[i]);
-        if (se_event == NULL) {
-           return -1;
+    if (total < 0) {
+        return -1;
+    }
+    if ((size_t)total > sizeof(stack_events) / sizeof(stack_events[0])) {
+        se_events = (se_handle_t *)malloc((size_t)total * sizeof(se_handle_t));
+        if (se_events == NULL) {
+            return -1;
         }
+    }
 
-        int ret = se_event_wake(se_event);
-        if (ret != 0) {
-            if (error) {
-                *error = errno;  
-            }   
+    for (i = 0; i < total; i ++) {
+        se_events[i] = get_tcs_event(tcss[i]);
+        if (se_events[i] == NULL) {
+            if (se_events != stack_events) {
+                free(se_events);
+            }
             return -1;
         }
     }
 
+    int ret = se_event_wake_batch(se_events, total);
+    if (se_events != stack_events) {
+        free(se_events);
+    }
+    if (ret != 0) {
+        if (error) {
+            *error = ret;
+        }
+        return -1;
+    }
+
     if (error)
         *error = 0;
 
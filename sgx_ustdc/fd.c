@@ -15,18 +15,270 @@
 // specific language governing permissions and limitations
 // under the License..
 
+#define _GNU_SOURCE
 #define _LARGEFILE64_SOURCE
 
 #include <sys/types.h>
 #include <sys/ioctl.h>
 #include <sys/uio.h>
+#include <sys/sendfile.h>
 #include <errno.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* O_DIRECT transfers must have buffer, length and offset aligned to the
+ * logical block size; 4K satisfies every NVMe namespace. The bridge
+ * buffers ocall arguments are marshalled into carry no alignment
+ * guarantee, so reads and writes on direct-I/O fds bounce through a
+ * per-thread 4K-aligned scratch buffer. That single copy replaces the
+ * kernel's page-cache copy, and the device DMAs straight from the
+ * scratch pages. */
+#define DIRECT_IO_ALIGNMENT 4096
+
+static __thread void  *direct_io_scratch = NULL;
+static __thread size_t direct_io_scratch_size = 0;
+
+static void *direct_io_scratch_get(size_t count)
+{
+    if (direct_io_scratch_size < count) {
+        size_t size = (count + DIRECT_IO_ALIGNMENT - 1) & ~(size_t)(DIRECT_IO_ALIGNMENT - 1);
+        void *buf = NULL;
+        if (posix_memalign(&buf, DIRECT_IO_ALIGNMENT, size) != 0) {
+            return NULL;
+        }
+        free(direct_io_scratch);
+        direct_io_scratch = buf;
+        direct_io_scratch_size = size;
+    }
+    return direct_io_scratch;
+}
+
+static int direct_io_misaligned(int fd, const void *buf)
+{
+    int flags;
+
+    if (((uintptr_t)buf & (DIRECT_IO_ALIGNMENT - 1)) == 0) {
+        return 0;
+    }
+    flags = fcntl(fd, F_GETFL);
+    return flags != -1 && (flags & O_DIRECT);
+}
+
+#if defined(SGX_USTDC_IO_URING) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define USE_IO_URING 1
+#endif
+#endif
+
+#ifdef USE_IO_URING
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <sys/mman.h>
+#include <pthread.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/* se_event primitives provided by event.c */
+typedef void *se_handle_t;
+extern se_handle_t se_event_init(void);
+extern int se_event_wait(se_handle_t se_event);
+extern int se_event_wake(se_handle_t se_event);
+
+#define URING_ENTRIES 64
+
+typedef struct _uring_completion_t {
+    se_handle_t se_event;
+    ssize_t res;
+} uring_completion_t;
+
+typedef struct _uring_t {
+    int ring_fd;
+    unsigned int *sq_head;
+    unsigned int *sq_tail;
+    unsigned int *sq_mask;
+    unsigned int *sq_array;
+    unsigned int *cq_head;
+    unsigned int *cq_tail;
+    unsigned int *cq_mask;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+    pthread_mutex_t sq_lock;
+    bool enabled;
+} uring_t;
+
+static uring_t g_uring;
+static pthread_once_t g_uring_once = PTHREAD_ONCE_INIT;
+
+static void *uring_reaper(void *arg)
+{
+    uring_t *ring = (uring_t *)arg;
+    unsigned int head = *ring->cq_head;
+
+    for (;;) {
+        long ret = syscall(__NR_io_uring_enter, ring->ring_fd, 0, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+        if (ret < 0 && errno != EINTR) {
+            break;
+        }
+        while (head != __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE)) {
+            struct io_uring_cqe *cqe = &ring->cqes[head & *ring->cq_mask];
+            uring_completion_t *comp = (uring_completion_t *)(uintptr_t)cqe->user_data;
+            if (comp) {
+                comp->res = cqe->res;
+                se_event_wake(comp->se_event);
+            }
+            head++;
+        }
+        __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+    }
+    return NULL;
+}
+
+static void uring_init_once(void)
+{
+    uring_t *ring = &g_uring;
+    struct io_uring_params params;
+    pthread_t tid;
+    pthread_attr_t attr;
+
+    memset(ring, 0, sizeof(*ring));
+    memset(&params, 0, sizeof(params));
+
+    ring->ring_fd = (int)syscall(__NR_io_uring_setup, URING_ENTRIES, &params);
+    if (ring->ring_fd < 0) {
+        return;
+    }
+
+    size_t sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+    size_t cq_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    size_t sqe_size = params.sq_entries * sizeof(struct io_uring_sqe);
+
+    void *sq_ptr = mmap(NULL, sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                        ring->ring_fd, IORING_OFF_SQ_RING);
+    void *cq_ptr = mmap(NULL, cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                        ring->ring_fd, IORING_OFF_CQ_RING);
+    void *sqe_ptr = mmap(NULL, sqe_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                         ring->ring_fd, IORING_OFF_SQES);
+    if (sq_ptr == MAP_FAILED || cq_ptr == MAP_FAILED || sqe_ptr == MAP_FAILED) {
+        close(ring->ring_fd);
+        return;
+    }
+
+    ring->sq_head = (unsigned int *)((char *)sq_ptr + params.sq_off.head);
+    ring->sq_tail = (unsigned int *)((char *)sq_ptr + params.sq_off.tail);
+    ring->sq_mask = (unsigned int *)((char *)sq_ptr + params.sq_off.ring_mask);
+    ring->sq_array = (unsigned int *)((char *)sq_ptr + params.sq_off.array);
+    ring->cq_head = (unsigned int *)((char *)cq_ptr + params.cq_off.head);
+    ring->cq_tail = (unsigned int *)((char *)cq_ptr + params.cq_off.tail);
+    ring->cq_mask = (unsigned int *)((char *)cq_ptr + params.cq_off.ring_mask);
+    ring->sqes = (struct io_uring_sqe *)sqe_ptr;
+    ring->cqes = (struct io_uring_cqe *)((char *)cq_ptr + params.cq_off.cqes);
+    pthread_mutex_init(&ring->sq_lock, NULL);
+
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    if (pthread_create(&tid, &attr, uring_reaper, ring) != 0) {
+        pthread_attr_destroy(&attr);
+        close(ring->ring_fd);
+        return;
+    }
+    pthread_attr_destroy(&attr);
+    ring->enabled = true;
+}
+
+/*
+ * Submit one read/write on the shared ring and wait for its completion.
+ * Concurrent callers enqueue under sq_lock, so sqes pending at the time of
+ * io_uring_enter are flushed in a single submission. Returns true if the
+ * operation was handled by the ring, false if the caller must fall back to
+ * the synchronous syscall path.
+ */
+static bool uring_try_rw(int op, int fd, void *buf, size_t count, off64_t offset, ssize_t *res)
+{
+    uring_t *ring = &g_uring;
+    static __thread uring_completion_t comp = { NULL, 0 };
+
+    pthread_once(&g_uring_once, uring_init_once);
+    if (!ring->enabled) {
+        return false;
+    }
+    if (comp.se_event == NULL) {
+        comp.se_event = se_event_init();
+        if (comp.se_event == NULL) {
+            return false;
+        }
+    }
+
+    pthread_mutex_lock(&ring->sq_lock);
+    unsigned int tail = *ring->sq_tail;
+    if (tail - __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE) >= URING_ENTRIES) {
+        pthread_mutex_unlock(&ring->sq_lock);
+        return false;
+    }
+    unsigned int idx = tail & *ring->sq_mask;
+    struct io_uring_sqe *sqe = &ring->sqes[idx];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = (uint8_t)op;
+    sqe->fd = fd;
+    sqe->addr = (uint64_t)(uintptr_t)buf;
+    sqe->len = (uint32_t)count;
+    sqe->off = (uint64_t)offset;
+    sqe->user_data = (uint64_t)(uintptr_t)&comp;
+    ring->sq_array[idx] = idx;
+    __atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+    unsigned int to_submit = tail + 1 - *ring->sq_head;
+    long ret = syscall(__NR_io_uring_enter, ring->ring_fd, to_submit, 0, 0, NULL, 0);
+    pthread_mutex_unlock(&ring->sq_lock);
+    if (ret < 0) {
+        return false;
+    }
+
+    se_event_wait(comp.se_event);
+    if (comp.res < 0) {
+        errno = (int)-comp.res;
+        *res = -1;
+    } else {
+        *res = comp.res;
+    }
+    return true;
+}
+#endif
 
 ssize_t u_read_ocall(int *error, int fd, void *buf, size_t count)
 {
-    ssize_t ret = read(fd, buf, count);
+    ssize_t ret;
+    void *bounce = NULL;
+
+    if (direct_io_misaligned(fd, buf)) {
+        bounce = direct_io_scratch_get(count);
+        if (bounce == NULL) {
+            if (error) {
+                *error = ENOMEM;
+            }
+            return -1;
+        }
+        ret = read(fd, bounce, count);
+        if (ret > 0) {
+            memcpy(buf, bounce, (size_t)ret);
+        }
+        if (error) {
+            *error = ret == -1 ? errno : 0;
+        }
+        return ret;
+    }
+#ifdef USE_IO_URING
+    /* offset -1 reads at the current file position, matching read(2) */
+    if (uring_try_rw(IORING_OP_READ, fd, buf, count, (off64_t)-1, &ret)) {
+        if (error) {
+            *error = ret == -1 ? errno : 0;
+        }
+        return ret;
+    }
+#endif
+    ret = read(fd, buf, count);
     if (error) {
         *error = ret == -1 ? errno : 0;
     }
@@ -35,7 +287,35 @@ ssize_t u_read_ocall(int *error, int fd, void *buf, size_t count)
 
 ssize_t u_pread64_ocall(int *error, int fd, void *buf, size_t count, off64_t offset)
 {
-    ssize_t ret = pread64(fd, buf, count, offset);
+    ssize_t ret;
+    void *bounce = NULL;
+
+    if (direct_io_misaligned(fd, buf)) {
+        bounce = direct_io_scratch_get(count);
+        if (bounce == NULL) {
+            if (error) {
+                *error = ENOMEM;
+            }
+            return -1;
+        }
+        ret = pread64(fd, bounce, count, offset);
+        if (ret > 0) {
+            memcpy(buf, bounce, (size_t)ret);
+        }
+        if (error) {
+            *error = ret == -1 ? errno : 0;
+        }
+        return ret;
+    }
+#ifdef USE_IO_URING
+    if (uring_try_rw(IORING_OP_READ, fd, buf, count, offset, &ret)) {
+        if (error) {
+            *error = ret == -1 ? errno : 0;
+        }
+        return ret;
+    }
+#endif
+    ret = pread64(fd, buf, count, offset);
     if (error) {
         *error = ret == -1 ? errno : 0;
     }
@@ -62,7 +342,28 @@ ssize_t u_preadv64_ocall(int *error, int fd, const struct iovec *iov, int iovcnt
 
 ssize_t u_write_ocall(int *error, int fd, const void *buf, size_t count)
 {
-    ssize_t ret = write(fd, buf, count);
+    ssize_t ret;
+
+    if (direct_io_misaligned(fd, buf)) {
+        void *bounce = direct_io_scratch_get(count);
+        if (bounce == NULL) {
+            if (error) {
+                *error = ENOMEM;
+            }
+            return -1;
+        }
+        memcpy(bounce, buf, count);
+        buf = bounce;
+    }
+#ifdef USE_IO_URING
+    if (uring_try_rw(IORING_OP_WRITE, fd, (void *)buf, count, (off64_t)-1, &ret)) {
+        if (error) {
+            *error = ret == -1 ? errno : 0;
+        }
+        return ret;
+    }
+#endif
+    ret = write(fd, buf, count);
     if (error) {
         *error = ret == -1 ? errno : 0;
     }
@@ -71,7 +372,28 @@ ssize_t u_write_ocall(int *error, int fd, const void *buf, size_t count)
 
 ssize_t u_pwrite64_ocall(int *error, int fd, const void *buf, size_t count, off64_t offset)
 {
-    ssize_t ret = pwrite64(fd, buf, count, offset);
+    ssize_t ret;
+
+    if (direct_io_misaligned(fd, buf)) {
+        void *bounce = direct_io_scratch_get(count);
+        if (bounce == NULL) {
+            if (error) {
+                *error = ENOMEM;
+            }
+            return -1;
+        }
+        memcpy(bounce, buf, count);
+        buf = bounce;
+    }
+#ifdef USE_IO_URING
+    if (uring_try_rw(IORING_OP_WRITE, fd, (void *)buf, count, offset, &ret)) {
+        if (error) {
+            *error = ret == -1 ? errno : 0;
+        }
+        return ret;
+    }
+#endif
+    ret = pwrite64(fd, buf, count, offset);
     if (error) {
         *error = ret == -1 ? errno : 0;
     }
@@ -139,4 +461,101 @@ int u_close_ocall(int *error, int fd)
         *error = ret == -1 ? errno : 0;
     }
     return ret;
-}
\ No newline at end of file
+}
+
+/* Keep in sync with struct io_desc_t in edl/sgx_fd.edl */
+#define IO_OP_READ      0
+#define IO_OP_WRITE     1
+#define IO_OP_PREAD     2
+#define IO_OP_PWRITE    3
+
+struct io_desc_t {
+    int fd;
+    int op;
+    uint64_t buf;
+    uint64_t count;
+    int64_t offset;
+    int64_t result;
+    int error;
+    int __pad;
+};
+
+/*
+ * Execute a burst of small reads/writes in one enclave transition.
+ * Each descriptor carries its own result and errno; the return value is
+ * the number of descriptors that completed without error, so the trusted
+ * wrapper can detect partial failure without inspecting every entry.
+ */
+size_t u_io_batch_ocall(struct io_desc_t *descs, size_t count)
+{
+    size_t i = 0;
+    size_t ok = 0;
+    ssize_t ret = 0;
+
+    if (descs == NULL) {
+        return 0;
+    }
+
+    for (i = 0; i < count; i++) {
+        struct io_desc_t *desc = &descs[i];
+        void *buf = (void *)(uintptr_t)desc->buf;
+
+        switch (desc->op) {
+            case IO_OP_READ:
+                ret = read(desc->fd, buf, (size_t)desc->count);
+                break;
+            case IO_OP_WRITE:
+                ret = write(desc->fd, buf, (size_t)desc->count);
+                break;
+            case IO_OP_PREAD:
+                ret = pread64(desc->fd, buf, (size_t)desc->count, (off64_t)desc->offset);
+                break;
+            case IO_OP_PWRITE:
+                ret = pwrite64(desc->fd, buf, (size_t)desc->count, (off64_t)desc->offset);
+                break;
+            default:
+                errno = EINVAL;
+                ret = -1;
+                break;
+        }
+        desc->result = (int64_t)ret;
+        desc->error = ret == -1 ? errno : 0;
+        if (ret != -1) {
+            ok++;
+        }
+    }
+    return ok;
+}
+/* In-kernel data movement: the payload never crosses into (or out of)
+ * enclave memory, so bulk plaintext relocation and file-to-socket
+ * serving cost one transition per span instead of a read/write loop
+ * with two copies through the enclave.
+ */
+ssize_t u_copy_file_range_ocall(int *error,
+                                int fd_in,
+                                int64_t *off_in,
+                                int fd_out,
+                                int64_t *off_out,
+                                size_t len,
+                                unsigned int flags)
+{
+    ssize_t ret = copy_file_range(fd_in,
+                                  (loff_t *)off_in,
+                                  fd_out,
+                                  (loff_t *)off_out,
+                                  len,
+                                  flags);
+    if (error) {
+        *error = ret == -1 ? errno : 0;
+    }
+    return ret;
+}
+
+ssize_t u_sendfile_ocall(int *error, int out_fd, int in_fd, int64_t *offset, size_t count)
+{
+    ssize_t ret = sendfile64(out_fd, in_fd, (off64_t *)offset, count);
+    if (error) {
+        *error = ret == -1 ? errno : 0;
+    }
+    return ret;
+}
@@ -15,6 +15,7 @@
 // specific language governing permissions and limitations
 // under the License..
 
+#define _GNU_SOURCE
 #define _LARGEFILE64_SOURCE
 
 #include <sys/types.h>
@@ -26,6 +27,9 @@
 #include <unistd.h>
 #include <limits.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+#include <pthread.h>
 #include <dirent.h>
 
 int u_open_ocall(int *error, const char *pathname, int flags)
@@ -154,6 +158,25 @@ int u_truncate64_ocall(int *error, const char *path, off64_t length)
     return ret;
 }
 
+int u_fallocate64_ocall(int *error, int fd, int mode, off64_t offset, off64_t len)
+{
+    int ret = fallocate64(fd, mode, offset, len);
+    if (error) {
+        *error = ret == -1 ? errno : 0;
+    }
+    return ret;
+}
+
+int u_posix_fadvise_ocall(int *error, int fd, off64_t offset, off64_t len, int advice)
+{
+    /* posix_fadvise returns the error directly and leaves errno alone. */
+    int ret = posix_fadvise64(fd, offset, len, advice);
+    if (error) {
+        *error = ret;
+    }
+    return ret == 0 ? 0 : -1;
+}
+
 int u_fsync_ocall(int *error, int fd)
 {
     int ret = fsync(fd);
@@ -172,6 +195,104 @@ int u_fdatasync_ocall(int *error, int fd)
     return ret;
 }
 
+/* Group commit: concurrent durability requests on one fd coalesce into
+ * a single device flush. A caller whose writes are already issued only
+ * needs SOME later fdatasync to cover them, so the first arrival is
+ * elected committer, holds a short window open for more writers to
+ * pile in, flushes once, and wakes everyone whose intent predates the
+ * flush. N threads fsyncing a WAL then pay one flush, not N.
+ */
+#define FSYNC_GROUP_SLOTS 16
+#define FSYNC_GROUP_WINDOW_NS 100000
+
+struct fsync_group {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int fd;            /* fd this slot currently serves */
+    int refs;          /* callers inside the slot */
+    int committing;    /* a committer is elected */
+    uint64_t seq;      /* commits started */
+    uint64_t done;     /* commits finished */
+    uint64_t fail_gen; /* generation of the last failed commit */
+    int fail_err;
+};
+
+static struct fsync_group g_fsync_groups[FSYNC_GROUP_SLOTS] = {
+    [0 ... FSYNC_GROUP_SLOTS - 1] = {
+        PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, -1, 0, 0, 0, 0, 0, 0
+    }
+};
+
+int u_fsync_group_ocall(int *error, int fd)
+{
+    struct fsync_group *grp = &g_fsync_groups[(unsigned int)fd % FSYNC_GROUP_SLOTS];
+    int err = 0;
+    int ret = 0;
+
+    pthread_mutex_lock(&grp->lock);
+    if (grp->refs > 0 && grp->fd != fd) {
+        /* Slot busy with another fd: flush directly. */
+        pthread_mutex_unlock(&grp->lock);
+        ret = fdatasync(fd);
+        if (error) {
+            *error = ret == -1 ? errno : 0;
+        }
+        return ret;
+    }
+    grp->fd = fd;
+    grp->refs++;
+
+    /* Any commit started after this point covers our writes. */
+    uint64_t target = grp->seq + 1;
+
+    while (grp->done < target) {
+        if (!grp->committing) {
+            grp->committing = 1;
+            /* Window: let concurrent writers register before the
+             * flush; everyone arriving now gets target <= batch.
+             */
+            pthread_mutex_unlock(&grp->lock);
+            struct timespec window = { 0, FSYNC_GROUP_WINDOW_NS };
+            nanosleep(&window, NULL);
+            pthread_mutex_lock(&grp->lock);
+
+            uint64_t batch = ++grp->seq;
+            pthread_mutex_unlock(&grp->lock);
+            ret = fdatasync(fd);
+            err = ret == -1 ? errno : 0;
+            pthread_mutex_lock(&grp->lock);
+
+            grp->done = batch;
+            grp->committing = 0;
+            if (ret == -1) {
+                grp->fail_gen = batch;
+                grp->fail_err = err;
+            }
+            pthread_cond_broadcast(&grp->cond);
+        } else {
+            pthread_cond_wait(&grp->cond, &grp->lock);
+        }
+    }
+
+    /* Fail if the commit that covered us (or a later one we also
+     * waited out) failed.
+     */
+    if (grp->fail_gen >= target) {
+        ret = -1;
+        err = grp->fail_err;
+    } else {
+        ret = 0;
+        err = 0;
+    }
+    grp->refs--;
+    pthread_mutex_unlock(&grp->lock);
+
+    if (error) {
+        *error = err;
+    }
+    return ret;
+}
+
 int u_fchmod_ocall(int *error, int fd, mode_t mode)
 {
     int ret = fchmod(fd, mode);
@@ -276,6 +397,29 @@ int u_readdir64_r_ocall(DIR *dirp, struct dirent64 *entry, struct dirent64 **res
     return readdir64_r(dirp, entry, result);
 }
 
+/* Fill up to count entries in one transition. *nread reports how many
+ * were produced; fewer than count means the stream ended or the
+ * returned error struck after *nread valid entries.
+ */
+int u_readdir64_batch_ocall(DIR *dirp, struct dirent64 *entries, size_t count, size_t *nread)
+{
+    size_t i = 0;
+    int ret = 0;
+
+    while (i < count) {
+        struct dirent64 *result = NULL;
+        ret = readdir64_r(dirp, &entries[i], &result);
+        if (ret != 0 || result == NULL) {
+            break;
+        }
+        i++;
+    }
+    if (nread) {
+        *nread = i;
+    }
+    return ret;
+}
+
 int u_closedir_ocall(int *error, DIR *dirp)
 {
     int ret = closedir(dirp);
@@ -0,0 +1,130 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License..
+
+#define _LARGEFILE64_SOURCE
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+/*
+ * Switchless (transition_using_threads) variants of the hot file ocalls
+ * declared in edl/sgx_fs_switchless.edl, mirroring the u_net_* pattern in
+ * edl/sgx_net_switchless.edl. The bodies intentionally match their
+ * synchronous counterparts in fd.c/file.c; only the transition mode differs.
+ */
+
+int u_fs_open64_ocall(int *error, const char *path, int oflag, int mode)
+{
+    int ret = open64(path, oflag, mode);
+    if (error) {
+        *error = ret == -1 ? errno : 0;
+    }
+    return ret;
+}
+
+int u_fs_close_ocall(int *error, int fd)
+{
+    int ret = close(fd);
+    if (error) {
+        *error = ret == -1 ? errno : 0;
+    }
+    return ret;
+}
+
+ssize_t u_fs_read_ocall(int *error, int fd, void *buf, size_t count)
+{
+    ssize_t ret = read(fd, buf, count);
+    if (error) {
+        *error = ret == -1 ? errno : 0;
+    }
+    return ret;
+}
+
+ssize_t u_fs_pread64_ocall(int *error, int fd, void *buf, size_t count, off64_t offset)
+{
+    ssize_t ret = pread64(fd, buf, count, offset);
+    if (error) {
+        *error = ret == -1 ? errno : 0;
+    }
+    return ret;
+}
+
+ssize_t u_fs_write_ocall(int *error, int fd, const void *buf, size_t count)
+{
+    ssize_t ret = write(fd, buf, count);
+    if (error) {
+        *error = ret == -1 ? errno : 0;
+    }
+    return ret;
+}
+
+ssize_t u_fs_pwrite64_ocall(int *error, int fd, const void *buf, size_t count, off64_t offset)
+{
+    ssize_t ret = pwrite64(fd, buf, count, offset);
+    if (error) {
+        *error = ret == -1 ? errno : 0;
+    }
+    return ret;
+}
+
+off64_t u_fs_lseek64_ocall(int *error, int fd, off64_t offset, int whence)
+{
+    off64_t ret = lseek64(fd, offset, whence);
+    if (error) {
+        *error = ret == -1 ? errno : 0;
+    }
+    return ret;
+}
+
+int u_fs_ftruncate64_ocall(int *error, int fd, off64_t length)
+{
+    int ret = ftruncate64(fd, length);
+    if (error) {
+        *error = ret == -1 ? errno : 0;
+    }
+    return ret;
+}
+
+int u_fs_fstat64_ocall(int *error, int fd, struct stat64 *buf)
+{
+    int ret = fstat64(fd, buf);
+    if (error) {
+        *error = ret == -1 ? errno : 0;
+    }
+    return ret;
+}
+
+int u_fs_fsync_ocall(int *error, int fd)
+{
+    int ret = fsync(fd);
+    if (error) {
+        *error = ret == -1 ? errno : 0;
+    }
+    return ret;
+}
+
+int u_fs_fdatasync_ocall(int *error, int fd)
+{
+    int ret = fdatasync(fd);
+    if (error) {
+        *error = ret == -1 ? errno : 0;
+    }
+    return ret;
+}
@@ -15,23 +15,230 @@
 // specific language governing permissions and limitations
 // under the License..
 
+#define _GNU_SOURCE
+
 #include <sys/types.h>
 #include <stdlib.h>
 #include <sys/mman.h>
+#include <sys/syscall.h>
+#include <stdint.h>
+#include <unistd.h>
 #include <errno.h>
+#include <pthread.h>
+
+#ifndef MAP_HUGETLB
+#define MAP_HUGETLB 0x40000
+#endif
+#ifndef MADV_HUGEPAGE
+#define MADV_HUGEPAGE 14
+#endif
+
+/*
+ * Size-class recycling for u_malloc_ocall/u_free_ocall. Some trusted
+ * paths legitimately allocate and free untrusted memory at high rate,
+ * and under heavy mixed I/O the glibc malloc lock they land on is
+ * shared with the urts runtime. Freed blocks are kept on per-thread
+ * freelists bucketed by power-of-two size class, so the common case is
+ * a pointer pop with no lock at all; caches spill to and refill from a
+ * per-class global list in batches, amortizing one lock round trip over
+ * half a cache. Requests above the largest class fall through to plain
+ * malloc.
+ *
+ * Every block carries a small header so free can recover the class.
+ * The magic is xored with the user pointer: a pointer that was handed
+ * to the enclave by some other host allocation fails the check and is
+ * released with plain free.
+ */
+
+#define MC_MIN_SHIFT 6  /* 64B, one cache line */
+#define MC_MAX_SHIFT 18 /* 256KB */
+#define MC_NCLASSES  (MC_MAX_SHIFT - MC_MIN_SHIFT + 1)
+#define MC_MAGIC     ((uintptr_t)0x6f63616c6c6d656dULL)
+
+struct mc_hdr {
+    uintptr_t magic; /* MC_MAGIC ^ user pointer */
+    intptr_t cls;    /* class index, or -1 straight from malloc */
+};
+
+struct mc_node {
+    struct mc_node *next;
+};
+
+static struct {
+    pthread_mutex_t lock;
+    struct mc_node *head;
+    size_t count;
+} mc_global[MC_NCLASSES] = {
+    [0 ... MC_NCLASSES - 1] = { PTHREAD_MUTEX_INITIALIZER, NULL, 0 }
+};
+
+struct mc_cache {
+    struct mc_node *head;
+    size_t count;
+};
+
+static __thread struct mc_cache mc_tls[MC_NCLASSES];
+static __thread int mc_tls_registered;
+static pthread_key_t mc_key;
+static pthread_once_t mc_once = PTHREAD_ONCE_INIT;
+
+static inline size_t mc_slab(int cls)
+{
+    return (size_t)1 << (cls + MC_MIN_SHIFT);
+}
+
+static int mc_class(size_t size)
+{
+    for (int cls = 0; cls < MC_NCLASSES; cls++) {
+        if (size <= mc_slab(cls)) {
+            return cls;
+        }
+    }
+    return -1;
+}
+
+/* Large classes cache fewer blocks so idle memory stays bounded. */
+static inline size_t mc_tls_cap(int cls)
+{
+    return mc_slab(cls) <= 4096 ? 16 : 4;
+}
+
+static inline size_t mc_global_cap(int cls)
+{
+    return mc_tls_cap(cls) * 16;
+}
+
+static void mc_cache_flush(int cls, size_t keep)
+{
+    struct mc_cache *cache = &mc_tls[cls];
+
+    pthread_mutex_lock(&mc_global[cls].lock);
+    while (cache->count > keep) {
+        struct mc_node *node = cache->head;
+        cache->head = node->next;
+        cache->count--;
+        if (mc_global[cls].count < mc_global_cap(cls)) {
+            node->next = mc_global[cls].head;
+            mc_global[cls].head = node;
+            mc_global[cls].count++;
+        } else {
+            free((struct mc_hdr *)node - 1);
+        }
+    }
+    pthread_mutex_unlock(&mc_global[cls].lock);
+}
+
+static void mc_thread_exit(void *arg)
+{
+    (void)arg;
+    for (int cls = 0; cls < MC_NCLASSES; cls++) {
+        if (mc_tls[cls].count > 0) {
+            mc_cache_flush(cls, 0);
+        }
+    }
+}
+
+static void mc_key_create(void)
+{
+    pthread_key_create(&mc_key, mc_thread_exit);
+}
+
+static void mc_thread_register(void)
+{
+    if (!mc_tls_registered) {
+        pthread_once(&mc_once, mc_key_create);
+        pthread_setspecific(mc_key, (void *)&mc_tls[0]);
+        mc_tls_registered = 1;
+    }
+}
+
+static void *mc_cache_pop(int cls)
+{
+    struct mc_cache *cache = &mc_tls[cls];
+
+    if (cache->head == NULL) {
+        /* batched refill: one lock round trip buys half a cache */
+        size_t want = mc_tls_cap(cls) / 2;
+        pthread_mutex_lock(&mc_global[cls].lock);
+        while (cache->count < want && mc_global[cls].head != NULL) {
+            struct mc_node *node = mc_global[cls].head;
+            mc_global[cls].head = node->next;
+            mc_global[cls].count--;
+            node->next = cache->head;
+            cache->head = node;
+            cache->count++;
+        }
+        pthread_mutex_unlock(&mc_global[cls].lock);
+    }
+
+    struct mc_node *node = cache->head;
+    if (node == NULL) {
+        return NULL;
+    }
+    cache->head = node->next;
+    cache->count--;
+    return node;
+}
+
+static void mc_cache_push(int cls, void *p)
+{
+    struct mc_cache *cache = &mc_tls[cls];
+    struct mc_node *node = (struct mc_node *)p;
+
+    node->next = cache->head;
+    cache->head = node;
+    cache->count++;
+    if (cache->count > mc_tls_cap(cls)) {
+        mc_cache_flush(cls, mc_tls_cap(cls) / 2);
+    }
+}
 
 void *u_malloc_ocall(int *error, size_t size)
 {
-    void *ret = malloc(size);
+    int cls = mc_class(size);
+    void *user = NULL;
+
+    mc_thread_register();
+    if (cls >= 0) {
+        user = mc_cache_pop(cls);
+    }
+    if (user == NULL) {
+        size_t bytes = sizeof(struct mc_hdr) + (cls >= 0 ? mc_slab(cls) : size);
+        struct mc_hdr *hdr = (struct mc_hdr *)malloc(bytes);
+        if (hdr == NULL) {
+            if (error) {
+                *error = errno;
+            }
+            return NULL;
+        }
+        user = hdr + 1;
+        hdr->magic = MC_MAGIC ^ (uintptr_t)user;
+        hdr->cls = cls;
+    }
     if (error) {
-        *error = ret == NULL ? errno : 0;
+        *error = 0;
     }
-    return ret;
+    return user;
 }
 
 void u_free_ocall(void *p)
 {
-    free(p);
+    if (p == NULL) {
+        return;
+    }
+
+    struct mc_hdr *hdr = (struct mc_hdr *)p - 1;
+    if (hdr->magic != (MC_MAGIC ^ (uintptr_t)p)) {
+        /* not carved here: a host allocation handed to the enclave */
+        free(p);
+        return;
+    }
+    if (hdr->cls < 0 || hdr->cls >= MC_NCLASSES) {
+        free(hdr);
+        return;
+    }
+    mc_thread_register();
+    mc_cache_push((int)hdr->cls, p);
 }
 
 void *u_mmap_ocall(int *error, void *start, size_t length, int prot, int flags, int fd, off_t offset)
@@ -68,4 +275,158 @@ int u_mprotect_ocall(int *error, void *addr, size_t length, int prot)
         *error = ret == -1 ? errno : 0;
     }
     return ret;
+}
+
+/* Hugepage request levels for u_mmap_placed_ocall. */
+#define MMAP_PLACED_HUGE_NONE 0
+#define MMAP_PLACED_HUGE_THP  1 /* transparent hugepage advice */
+#define MMAP_PLACED_HUGE_TLB  2 /* explicit MAP_HUGETLB reservation */
+
+#define MPOL_PREFERRED 1
+
+/*
+ * Anonymous staging buffer with page-size and NUMA placement. A large
+ * buffer crossed by every I/O ocall wants 2MB pages (fewer TLB misses
+ * on the copy loops) and memory on the socket running the enclave
+ * (cross-socket traffic costs a QPI hop per cacheline). huge selects
+ * none/THP-advice/explicit hugetlb -- an explicit reservation falls
+ * back to THP advice when the hugetlb pool is empty. numa_node pins
+ * first-touch allocation to one node via MPOL_PREFERRED, or -1 leaves
+ * the kernel's default policy. Placement failure is advisory and never
+ * fails the mapping.
+ */
+void *u_mmap_placed_ocall(int *error, size_t length, int prot, int huge, int numa_node)
+{
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+    void *ret = MAP_FAILED;
+
+    if (huge == MMAP_PLACED_HUGE_TLB) {
+        ret = mmap(NULL, length, prot, flags | MAP_HUGETLB, -1, 0);
+    }
+    if (ret == MAP_FAILED) {
+        ret = mmap(NULL, length, prot, flags, -1, 0);
+        if (ret != MAP_FAILED && huge != MMAP_PLACED_HUGE_NONE) {
+            madvise(ret, length, MADV_HUGEPAGE);
+        }
+    }
+    if (ret == MAP_FAILED) {
+        if (error) {
+            *error = errno;
+        }
+        return MAP_FAILED;
+    }
+
+    if (numa_node >= 0 && numa_node < (int)(8 * sizeof(unsigned long))) {
+        unsigned long nodemask = 1UL << numa_node;
+        syscall(SYS_mbind, ret, length, MPOL_PREFERRED,
+                &nodemask, (unsigned long)(8 * sizeof(unsigned long)), 0);
+    }
+
+    if (error) {
+        *error = 0;
+    }
+    return ret;
+}
+
+/*
+ * Map a read-only window of an open file for zero-copy reads: the trusted
+ * side copies straight from the shared page-cache mapping instead of paying
+ * an ocall plus an untrusted bounce buffer per read. The requested offset is
+ * aligned down to a page boundary; the caller reads at
+ * base + (offset - aligned_offset) and passes the same lengths to unmap.
+ */
+void *u_fd_map_window_ocall(int *error, int fd, uint64_t offset, size_t length, uint64_t *aligned_offset)
+{
+    long page = sysconf(_SC_PAGESIZE);
+    if (page <= 0 || length == 0 || aligned_offset == NULL) {
+        if (error) {
+            *error = EINVAL;
+        }
+        return NULL;
+    }
+
+    uint64_t aligned = offset & ~((uint64_t)page - 1);
+    size_t map_len = length + (size_t)(offset - aligned);
+    void *base = mmap(NULL, map_len, PROT_READ, MAP_SHARED, fd, (off_t)aligned);
+    if (base == MAP_FAILED) {
+        if (error) {
+            *error = errno;
+        }
+        return NULL;
+    }
+    madvise(base, map_len, MADV_WILLNEED);
+    *aligned_offset = aligned;
+    if (error) {
+        *error = 0;
+    }
+    return base;
+}
+
+int u_fd_unmap_window_ocall(int *error, void *base, uint64_t offset, size_t length, uint64_t aligned_offset)
+{
+    size_t map_len = length + (size_t)(offset - aligned_offset);
+    int ret = munmap(base, map_len);
+    if (error) {
+        *error = ret == -1 ? errno : 0;
+    }
+    return ret;
+}
+
+#define BUF_POOL_ALIGN      64
+#define BUF_POOL_PAGE_SIZE  4096
+
+static inline size_t buf_pool_round_up(size_t n, size_t align)
+{
+    return (n + align - 1) & ~(align - 1);
+}
+
+/*
+ * Reserve one contiguous untrusted region carved into buf_count slabs of
+ * buf_size bytes (rounded up to a cache line). The trusted side addresses
+ * slab i at base + i * stride and reuses the slabs across I/O ocalls, so
+ * steady-state I/O performs no untrusted malloc/free at all. The stride
+ * actually used is reported back through the stride out-parameter.
+ */
+void *u_buf_pool_create_ocall(int *error, size_t buf_size, size_t buf_count, size_t *stride)
+{
+    if (buf_size == 0 || buf_count == 0 || stride == NULL) {
+        if (error) {
+            *error = EINVAL;
+        }
+        return NULL;
+    }
+
+    size_t slab = buf_pool_round_up(buf_size, BUF_POOL_ALIGN);
+    if (slab < buf_size || slab > (size_t)-1 / buf_count) {
+        if (error) {
+            *error = EINVAL;
+        }
+        return NULL;
+    }
+
+    size_t length = buf_pool_round_up(slab * buf_count, BUF_POOL_PAGE_SIZE);
+    void *base = mmap(NULL, length, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) {
+        if (error) {
+            *error = errno;
+        }
+        return NULL;
+    }
+    *stride = slab;
+    if (error) {
+        *error = 0;
+    }
+    return base;
+}
+
+int u_buf_pool_destroy_ocall(int *error, void *base, size_t buf_size, size_t buf_count)
+{
+    size_t slab = buf_pool_round_up(buf_size, BUF_POOL_ALIGN);
+    size_t length = buf_pool_round_up(slab * buf_count, BUF_POOL_PAGE_SIZE);
+    int ret = munmap(base, length);
+    if (error) {
+        *error = ret == -1 ? errno : 0;
+    }
+    return ret;
 }
\ No newline at end of file
@@ -19,6 +19,170 @@
 #include <sys/socket.h>
 #include <netdb.h>
 #include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+
+/*
+ * Resolution cache.
+ *
+ * The trusted side resolves per connect, so an enclave dialing the same
+ * backends pays a resolver round trip (1-30ms) on every dial. Fresh
+ * results are kept here for a configurable TTL (SGX_DNS_CACHE_TTL_SECS,
+ * default 60 seconds, 0 disables; getaddrinfo does not expose the
+ * records' own TTLs, so one bound covers all names). Cache hits hand out
+ * the cached chain itself - the trusted bridge only reads it between
+ * u_getaddrinfo_ocall and u_freeaddrinfo_ocall - with a reference count
+ * so an entry evicted mid-read is freed only when its last reader
+ * returns it.
+ */
+
+#define DNS_CACHE_SLOTS 64
+#define DNS_CACHE_DEFAULT_TTL 60
+
+struct dns_entry {
+    char *node;
+    char *service;
+    int flags;
+    int family;
+    int socktype;
+    int protocol;
+    struct addrinfo *res;   /* chain as returned by getaddrinfo, owned */
+    time_t expires;
+    int refs;               /* chains handed out and not yet freed */
+    struct dns_entry *next; /* zombie chain only */
+};
+
+static struct dns_entry *g_dns_slots[DNS_CACHE_SLOTS];
+/* evicted entries whose chain is still handed out */
+static struct dns_entry *g_dns_zombies;
+static pthread_mutex_t g_dns_lock = PTHREAD_MUTEX_INITIALIZER;
+static long g_dns_ttl = -1;
+
+static long dns_ttl(void)
+{
+    if (g_dns_ttl < 0) {
+        const char *env = getenv("SGX_DNS_CACHE_TTL_SECS");
+        long ttl = DNS_CACHE_DEFAULT_TTL;
+        if (env != NULL) {
+            char *end = NULL;
+            long parsed = strtol(env, &end, 10);
+            if (end != env && *end == '\0' && parsed >= 0) {
+                ttl = parsed;
+            }
+        }
+        g_dns_ttl = ttl;
+    }
+    return g_dns_ttl;
+}
+
+static time_t dns_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec;
+}
+
+static unsigned long dns_hash(const char *node, const char *service, const struct addrinfo *hints)
+{
+    unsigned long hash = 5381;
+    const char *p;
+    for (p = node; *p != '\0'; p++) {
+        hash = hash * 33 + (unsigned char)*p;
+    }
+    hash = hash * 33 + '/';
+    for (p = service != NULL ? service : ""; *p != '\0'; p++) {
+        hash = hash * 33 + (unsigned char)*p;
+    }
+    if (hints != NULL) {
+        hash = hash * 33 + (unsigned long)hints->ai_flags;
+        hash = hash * 33 + (unsigned long)hints->ai_family;
+        hash = hash * 33 + (unsigned long)hints->ai_socktype;
+        hash = hash * 33 + (unsigned long)hints->ai_protocol;
+    }
+    return hash;
+}
+
+static int dns_entry_matches(const struct dns_entry *entry,
+                             const char *node,
+                             const char *service,
+                             const struct addrinfo *hints)
+{
+    if (strcmp(entry->node, node) != 0) {
+        return 0;
+    }
+    if ((entry->service == NULL) != (service == NULL)) {
+        return 0;
+    }
+    if (service != NULL && strcmp(entry->service, service) != 0) {
+        return 0;
+    }
+    return entry->flags == (hints != NULL ? hints->ai_flags : 0) &&
+           entry->family == (hints != NULL ? hints->ai_family : 0) &&
+           entry->socktype == (hints != NULL ? hints->ai_socktype : 0) &&
+           entry->protocol == (hints != NULL ? hints->ai_protocol : 0);
+}
+
+static void dns_entry_free(struct dns_entry *entry)
+{
+    freeaddrinfo(entry->res);
+    free(entry->node);
+    free(entry->service);
+    free(entry);
+}
+
+/* caller holds g_dns_lock */
+static void dns_entry_retire(struct dns_entry *entry)
+{
+    if (entry->refs == 0) {
+        dns_entry_free(entry);
+    } else {
+        entry->next = g_dns_zombies;
+        g_dns_zombies = entry;
+    }
+}
+
+/* caller holds g_dns_lock; takes ownership of res */
+static void dns_cache_insert(const char *node,
+                             const char *service,
+                             const struct addrinfo *hints,
+                             struct addrinfo *res,
+                             int handed_out)
+{
+    size_t slot = dns_hash(node, service, hints) % DNS_CACHE_SLOTS;
+
+    struct dns_entry *entry = (struct dns_entry *)calloc(1, sizeof(struct dns_entry));
+    if (entry == NULL) {
+        if (!handed_out) {
+            freeaddrinfo(res);
+        }
+        return;
+    }
+    entry->node = strdup(node);
+    entry->service = service != NULL ? strdup(service) : NULL;
+    if (entry->node == NULL || (service != NULL && entry->service == NULL)) {
+        free(entry->node);
+        free(entry->service);
+        free(entry);
+        if (!handed_out) {
+            freeaddrinfo(res);
+        }
+        return;
+    }
+    entry->flags = hints != NULL ? hints->ai_flags : 0;
+    entry->family = hints != NULL ? hints->ai_family : 0;
+    entry->socktype = hints != NULL ? hints->ai_socktype : 0;
+    entry->protocol = hints != NULL ? hints->ai_protocol : 0;
+    entry->res = res;
+    entry->expires = dns_now() + dns_ttl();
+    entry->refs = handed_out ? 1 : 0;
+
+    if (g_dns_slots[slot] != NULL) {
+        dns_entry_retire(g_dns_slots[slot]);
+    }
+    g_dns_slots[slot] = entry;
+}
 
 int u_getaddrinfo_ocall(int *error,
                         const char *node,
@@ -26,19 +190,131 @@ int u_getaddrinfo_ocall(int *error,
                         const struct addrinfo *hints,
                         struct addrinfo **res)
 {
+    if (node != NULL && dns_ttl() > 0) {
+        pthread_mutex_lock(&g_dns_lock);
+        size_t slot = dns_hash(node, service, hints) % DNS_CACHE_SLOTS;
+        struct dns_entry *entry = g_dns_slots[slot];
+        if (entry != NULL && dns_entry_matches(entry, node, service, hints)) {
+            if (dns_now() < entry->expires) {
+                entry->refs++;
+                *res = entry->res;
+                pthread_mutex_unlock(&g_dns_lock);
+                if (error) {
+                    *error = 0;
+                }
+                return 0;
+            }
+            g_dns_slots[slot] = NULL;
+            dns_entry_retire(entry);
+        }
+        pthread_mutex_unlock(&g_dns_lock);
+    }
+
     int ret = getaddrinfo(node, service, hints, res);
     if (error) {
         *error = ret == EAI_SYSTEM ? errno : 0;
     }
+
+    if (ret == 0 && node != NULL && dns_ttl() > 0) {
+        pthread_mutex_lock(&g_dns_lock);
+        dns_cache_insert(node, service, hints, *res, 1);
+        pthread_mutex_unlock(&g_dns_lock);
+    }
     return ret;
 }
 
+/*
+ * Resolves and caches each NUL-separated name in `nodes` (total length
+ * `nodes_len`, final name NUL-terminated) without handing a chain out,
+ * so steady-state connects that follow hit the cache. Names already
+ * fresh are skipped. Returns the number of names now cached, or -1.
+ */
+int u_getaddrinfo_prefetch_ocall(int *error,
+                                 const char *nodes,
+                                 size_t nodes_len,
+                                 const char *service,
+                                 const struct addrinfo *hints)
+{
+    if (nodes == NULL || nodes_len == 0 || dns_ttl() == 0) {
+        if (error) {
+            *error = EINVAL;
+        }
+        return -1;
+    }
+    if (error) {
+        *error = 0;
+    }
+
+    int cached = 0;
+    size_t offset = 0;
+    time_t now = dns_now();
+    while (offset < nodes_len) {
+        const char *node = nodes + offset;
+        size_t len = strnlen(node, nodes_len - offset);
+        if (len == 0 || len == nodes_len - offset) {
+            break;
+        }
+        offset += len + 1;
+
+        pthread_mutex_lock(&g_dns_lock);
+        size_t slot = dns_hash(node, service, hints) % DNS_CACHE_SLOTS;
+        struct dns_entry *entry = g_dns_slots[slot];
+        int fresh = entry != NULL &&
+                    dns_entry_matches(entry, node, service, hints) &&
+                    now < entry->expires;
+        pthread_mutex_unlock(&g_dns_lock);
+        if (fresh) {
+            cached++;
+            continue;
+        }
+
+        struct addrinfo *res = NULL;
+        if (getaddrinfo(node, service, hints, &res) == 0) {
+            pthread_mutex_lock(&g_dns_lock);
+            dns_cache_insert(node, service, hints, res, 0);
+            pthread_mutex_unlock(&g_dns_lock);
+            cached++;
+        }
+    }
+    return cached;
+}
+
 void u_freeaddrinfo_ocall(struct addrinfo *res)
 {
+    if (res == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&g_dns_lock);
+    for (size_t slot = 0; slot < DNS_CACHE_SLOTS; slot++) {
+        struct dns_entry *entry = g_dns_slots[slot];
+        if (entry != NULL && entry->res == res) {
+            if (entry->refs > 0) {
+                entry->refs--;
+            }
+            pthread_mutex_unlock(&g_dns_lock);
+            return;
+        }
+    }
+    struct dns_entry **link = &g_dns_zombies;
+    while (*link != NULL) {
+        struct dns_entry *entry = *link;
+        if (entry->res == res) {
+            if (--entry->refs == 0) {
+                *link = entry->next;
+                dns_entry_free(entry);
+            }
+            pthread_mutex_unlock(&g_dns_lock);
+            return;
+        }
+        link = &entry->next;
+    }
+    pthread_mutex_unlock(&g_dns_lock);
+
     return freeaddrinfo(res);
 }
 
 const char *u_gai_strerror_ocall(int errcode)
 {
     return gai_strerror(errcode);
-}
\ No newline at end of file
+}
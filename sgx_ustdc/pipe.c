@@ -17,6 +17,11 @@
 
 #define _GNU_SOURCE
 #include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <stdint.h>
+#include <time.h>
 #include <fcntl.h>
 #include <unistd.h>
 #include <errno.h>
@@ -39,6 +44,79 @@ int u_pipe2_ocall(int *error, int pipefd[2], int flags)
     return ret;
 }
 
+/*
+ * Shared-memory SPSC ring backing in-process pipe emulation. The trusted
+ * producer and consumer operate lock-free directly on the ring header and
+ * payload (head/tail are single-writer indices), so steady-state transfers
+ * cost zero ocalls; only blocking on an empty/full ring drops into the two
+ * futex ocalls below. Layout agreed with the trusted side:
+ *
+ *   struct pipe_ring {
+ *       uint32_t capacity;   // power of two, payload bytes
+ *       uint32_t head;       // consumer index
+ *       uint32_t tail;       // producer index
+ *       int rd_futex;        // consumer waits here
+ *       int wr_futex;        // producer waits here
+ *       int _pad;
+ *       unsigned char data[];
+ *   };
+ */
+#define PIPE_RING_HDR_SIZE  24
+
+void *u_pipe_ring_create_ocall(int *error, size_t capacity)
+{
+    if (capacity == 0 || (capacity & (capacity - 1)) != 0) {
+        if (error) {
+            *error = EINVAL;
+        }
+        return NULL;
+    }
+
+    void *ring = mmap(NULL, PIPE_RING_HDR_SIZE + capacity, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ring == MAP_FAILED) {
+        if (error) {
+            *error = errno;
+        }
+        return NULL;
+    }
+    *(uint32_t *)ring = (uint32_t)capacity;
+    if (error) {
+        *error = 0;
+    }
+    return ring;
+}
+
+int u_pipe_ring_destroy_ocall(int *error, void *ring, size_t capacity)
+{
+    int ret = munmap(ring, PIPE_RING_HDR_SIZE + capacity);
+    if (error) {
+        *error = ret == -1 ? errno : 0;
+    }
+    return ret;
+}
+
+/* Standard futex protocol: the enclave samples the word, decides to sleep
+ * and passes the observed value; a concurrent wake changing the word makes
+ * the FUTEX_WAIT return immediately instead of missing the wakeup. */
+int u_pipe_ring_wait_ocall(int *error, int *futex_word, int expected, const struct timespec *timeout)
+{
+    long ret = syscall(__NR_futex, futex_word, FUTEX_WAIT, expected, timeout, NULL, 0);
+    if (error) {
+        *error = ret == -1 ? errno : 0;
+    }
+    return (int)ret;
+}
+
+int u_pipe_ring_wake_ocall(int *error, int *futex_word, int count)
+{
+    long ret = syscall(__NR_futex, futex_word, FUTEX_WAKE, count, NULL, NULL, 0);
+    if (error) {
+        *error = ret == -1 ? errno : 0;
+    }
+    return (int)ret;
+}
+
 
 
 
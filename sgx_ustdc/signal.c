@@ -39,6 +39,7 @@ typedef struct _key_value_t {
 } key_value_t;
 
 unsigned int t_signal_handler_ecall(unsigned long long eid, int* retval, const siginfo_t* info);
+unsigned int t_signal_handler_batch_ecall(unsigned long long eid, int* retval, const siginfo_t* infos, size_t count);
 
 sgx_signal_dispatcher_t *g_signal_dispatch = NULL;
 static sgx_spinlock_t g_spin_lock;
@@ -191,6 +192,89 @@ int deregister_all_signals_for_eid(unsigned long long eid)
     return 0;
 }
 
+/* Pending-signal queue: a burst of signals (SIGCHLD storms from a child
+ * reaper, timer ticks) used to cost one enclave transition each. The
+ * handler now publishes the siginfo into a lock-free ring and only the
+ * handler that finds no drainer running enters the enclave, delivering
+ * everything queued so far in one batch ecall. Push and drainer
+ * election use only atomics, so the path stays async-signal-safe.
+ */
+#define SIGNAL_QUEUE_SLOTS 64 /* power of two */
+#define SIGNAL_BATCH_MAX   32
+
+struct signal_queue_slot {
+    int ready;
+    unsigned long long eid;
+    siginfo_t info;
+};
+
+static struct signal_queue_slot g_signal_queue[SIGNAL_QUEUE_SLOTS];
+static unsigned long long g_signal_queue_head;
+static unsigned long long g_signal_queue_tail;
+static int g_signal_draining;
+
+static int signal_queue_push(unsigned long long eid, const siginfo_t *info)
+{
+    unsigned long long head;
+    struct signal_queue_slot *slot = NULL;
+
+    for (;;) {
+        head = __atomic_load_n(&g_signal_queue_head, __ATOMIC_ACQUIRE);
+        if (head - __atomic_load_n(&g_signal_queue_tail, __ATOMIC_ACQUIRE) >= SIGNAL_QUEUE_SLOTS) {
+            return -1;
+        }
+        if (__atomic_compare_exchange_n(&g_signal_queue_head, &head, head + 1, 1,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            break;
+        }
+    }
+
+    slot = &g_signal_queue[head & (SIGNAL_QUEUE_SLOTS - 1)];
+    slot->eid = eid;
+    memcpy(&slot->info, info, sizeof(siginfo_t));
+    __atomic_store_n(&slot->ready, 1, __ATOMIC_RELEASE);
+    return 0;
+}
+
+static void signal_queue_drain(void)
+{
+    siginfo_t batch[SIGNAL_BATCH_MAX];
+    int ret = 0;
+
+    for (;;) {
+        unsigned long long tail = __atomic_load_n(&g_signal_queue_tail, __ATOMIC_RELAXED);
+        unsigned long long head = __atomic_load_n(&g_signal_queue_head, __ATOMIC_ACQUIRE);
+        unsigned long long batch_eid = 0;
+        size_t n = 0;
+
+        if (tail == head) {
+            break;
+        }
+        while (tail != head && n < SIGNAL_BATCH_MAX) {
+            struct signal_queue_slot *slot = &g_signal_queue[tail & (SIGNAL_QUEUE_SLOTS - 1)];
+            /* The producer reserved the slot but may still be copying
+             * from its signal handler; wait for the publish flag.
+             */
+            while (!__atomic_load_n(&slot->ready, __ATOMIC_ACQUIRE)) {
+                __asm__ __volatile__("pause" : : : "memory");
+            }
+            if (n > 0 && slot->eid != batch_eid) {
+                /* Flush before switching enclaves. */
+                break;
+            }
+            batch_eid = slot->eid;
+            memcpy(&batch[n], &slot->info, sizeof(siginfo_t));
+            n++;
+            __atomic_store_n(&slot->ready, 0, __ATOMIC_RELEASE);
+            tail++;
+            __atomic_store_n(&g_signal_queue_tail, tail, __ATOMIC_RELEASE);
+        }
+        if (n > 0) {
+            t_signal_handler_batch_ecall(batch_eid, &ret, batch, n);
+        }
+    }
+}
+
 static int handle_signal(int signum, const siginfo_t *info, __attribute__ ((unused))const void *context)
 {
     int ret = 0;
@@ -201,11 +285,27 @@ static int handle_signal(int signum, const siginfo_t *info, __attribute__ ((unus
     if (ret < 0) {
         return -1;
     }
-    result = t_signal_handler_ecall(eid, &ret, info);
-    if (result != 0) {
-        return -1;
+    if (signal_queue_push(eid, info) < 0) {
+        /* Queue full: deliver directly rather than drop. */
+        result = t_signal_handler_ecall(eid, &ret, info);
+        if (result != 0) {
+            return -1;
+        }
+        return ret;
     }
-    return ret;
+    /* One drainer at a time; everyone else has already published and
+     * returns without a transition. Re-check after stepping down so a
+     * push that raced the hand-off is not stranded.
+     */
+    while (__atomic_exchange_n(&g_signal_draining, 1, __ATOMIC_ACQUIRE) == 0) {
+        signal_queue_drain();
+        __atomic_store_n(&g_signal_draining, 0, __ATOMIC_RELEASE);
+        if (__atomic_load_n(&g_signal_queue_tail, __ATOMIC_ACQUIRE) ==
+            __atomic_load_n(&g_signal_queue_head, __ATOMIC_ACQUIRE)) {
+            break;
+        }
+    }
+    return 0;
 }
 
 void handle_signal_entry(int signum, siginfo_t *info, void * ucontext) {
@@ -21,6 +21,8 @@
 
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <netinet/in.h>
+#include <stddef.h>
 #include <errno.h>
 
 int u_socket_ocall(int *error, int domain, int ty, int protocol)
@@ -88,6 +90,64 @@ int u_accept4_ocall(int *error,
     return ret;
 }
 
+/* Layout-compatible with struct sockopt_req_t in edl/inc/sockopt.h. */
+struct sockopt_req_t
+{
+    int level;
+    int optname;
+    int optval;
+};
+
+static size_t apply_sockopts(int fd, const struct sockopt_req_t *opts, size_t nopts)
+{
+    size_t applied = 0;
+    for (; applied < nopts; applied++) {
+        const struct sockopt_req_t *o = &opts[applied];
+        if (setsockopt(fd, o->level, o->optname, &o->optval, sizeof(o->optval)) == -1) {
+            break;
+        }
+    }
+    return applied;
+}
+
+int u_accept4_preset_ocall(int *error,
+                           int sockfd,
+                           struct sockaddr *addr,
+                           socklen_t addrlen_in,
+                           socklen_t *addrlen_out,
+                           int flags,
+                           const struct sockopt_req_t *opts,
+                           size_t nopts,
+                           size_t *nopts_applied)
+{
+    *addrlen_out = addrlen_in;
+    int ret = accept4(sockfd, addr, addrlen_out, flags);
+    if (ret >= 0 && opts != NULL) {
+        /* Tuning is best effort: a rejected option never costs the
+         * connection, the enclave sees the applied count instead.
+         */
+        *nopts_applied = apply_sockopts(ret, opts, nopts);
+    } else {
+        *nopts_applied = 0;
+    }
+    if (error) {
+        *error = ret == -1 ? errno : 0;
+    }
+    return ret;
+}
+
+int u_setsockopt_batch_ocall(int *error,
+                             int sockfd,
+                             const struct sockopt_req_t *opts,
+                             size_t nopts)
+{
+    size_t applied = opts != NULL ? apply_sockopts(sockfd, opts, nopts) : 0;
+    if (error) {
+        *error = applied < nopts ? errno : 0;
+    }
+    return (int)applied;
+}
+
 int u_connect_ocall(int *error, int sockfd, const struct sockaddr *addr, socklen_t addrlen)
 {
     int ret = connect(sockfd, addr, addrlen);
@@ -165,6 +225,29 @@ ssize_t u_sendmsg_ocall(int *error, int sockfd, const struct msghdr *msg, int fl
     return ret;
 }
 
+int u_recvmmsg_ocall(int *error,
+                     int sockfd,
+                     struct mmsghdr *msgvec,
+                     unsigned int vlen,
+                     int flags,
+                     struct timespec *timeout)
+{
+    int ret = recvmmsg(sockfd, msgvec, vlen, flags, timeout);
+    if (error) {
+        *error = ret == -1 ? errno : 0;
+    }
+    return ret;
+}
+
+int u_sendmmsg_ocall(int *error, int sockfd, struct mmsghdr *msgvec, unsigned int vlen, int flags)
+{
+    int ret = sendmmsg(sockfd, msgvec, vlen, flags);
+    if (error) {
+        *error = ret == -1 ? errno : 0;
+    }
+    return ret;
+}
+
 int u_getsockopt_ocall(int *error,
                        int sockfd,
                        int level,
@@ -195,6 +278,49 @@ int u_setsockopt_ocall(int *error,
     return ret;
 }
 
+/*
+ * Kernel TLS offload.
+ *
+ * After an in-enclave handshake, record crypto can be delegated to the
+ * kernel: the enclave hands the negotiated traffic keys down via these
+ * ocalls and subsequent send/recv on the socket carry plaintext that
+ * the kernel encrypts/decrypts, so bulk data stops round-tripping
+ * through the enclave per record. Installing keys is an explicit
+ * decision to move post-handshake confidentiality out of the enclave.
+ */
+
+#ifndef TCP_ULP
+#define TCP_ULP 31
+#endif
+#ifndef SOL_TLS
+#define SOL_TLS 282
+#endif
+
+int u_tls_ulp_enable_ocall(int *error, int sockfd)
+{
+    int ret = setsockopt(sockfd, IPPROTO_TCP, TCP_ULP, "tls", sizeof("tls"));
+    if (error) {
+        /* ENOENT: kernel tls module not available */
+        *error = ret == -1 ? errno : 0;
+    }
+    return ret;
+}
+
+int u_tls_crypto_info_set_ocall(int *error,
+                                int sockfd,
+                                int direction,
+                                const void *crypto_info,
+                                socklen_t len)
+{
+    /* direction is TLS_TX (1) or TLS_RX (2); crypto_info is a
+     * tls12_crypto_info_* struct built by the enclave */
+    int ret = setsockopt(sockfd, SOL_TLS, direction, crypto_info, len);
+    if (error) {
+        *error = ret == -1 ? errno : 0;
+    }
+    return ret;
+}
+
 int u_getsockname_ocall(int *error,
                         int sockfd,
                         struct sockaddr *addr,
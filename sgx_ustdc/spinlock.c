@@ -17,8 +17,26 @@
 
 #include "spinlock.h"
 
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+/* Lock word states. FREE/LOCKED keep the historical 0/1 values so a
+ * lock initialized with SGX_SPINLOCK_INITIALIZER behaves as before;
+ * CONTENDED marks that at least one waiter is parked in the futex and
+ * the unlocker must wake.
+ */
+#define SPIN_FREE       0U
+#define SPIN_LOCKED     1U
+#define SPIN_CONTENDED  2U
+
+/* Spin rounds before parking; each round backs off twice as many PAUSE
+ * executions as the last, so this bounds the busy phase at roughly
+ * 2^SPIN_ROUNDS PAUSEs before the wait goes to the kernel.
+ */
+#define SPIN_ROUNDS     10
+
 static inline void _mm_pause(void) __attribute__((always_inline));
-static inline int _InterlockedExchange(int volatile *dst, int val) __attribute__((always_inline));
 
 static inline void _mm_pause(void)  /* definition requires -ffreestanding */
 {
@@ -27,35 +45,58 @@ static inline void _mm_pause(void)  /* definition requires -ffreestanding */
     );
 }
 
-static inline int _InterlockedExchange(int volatile *dst, int val)
+static inline long futex(sgx_spinlock_t *addr, int op, uint32_t val)
 {
-    int res;
-    __asm __volatile(
-        "lock xchg %2, %1;"
-        "mov %2, %0"
-        : "=m" (res)
-        : "m" (*dst),
-        "r" (val) 
-        : "memory"
-    );
-    return (res);
-   
+    return syscall(SYS_futex, (uint32_t *)addr, op, val, NULL, NULL, 0);
 }
 
 uint32_t sgx_spin_lock(sgx_spinlock_t *lock)
 {
-    while(_InterlockedExchange((volatile int *)lock, 1) != 0) {
-        while (*lock) {
-            /* tell cpu we are spinning */
+    /* Uncontended fast path: one atomic on a (hopefully) exclusive line. */
+    uint32_t expected = SPIN_FREE;
+    if (__atomic_compare_exchange_n((uint32_t *)lock, &expected, SPIN_LOCKED, 0,
+                                    __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+        return (0);
+    }
+
+    uint32_t backoff = 1;
+    for (int round = 0; round < SPIN_ROUNDS; round++) {
+        /* Test-and-test-and-set: spin on plain loads so the line stays
+         * shared, and only retry the atomic once it reads free. PAUSE
+         * between probes keeps the loop off the interconnect.
+         */
+        for (uint32_t i = 0; i < backoff; i++) {
             _mm_pause();
-        } 
+            if (__atomic_load_n((uint32_t *)lock, __ATOMIC_RELAXED) == SPIN_FREE) {
+                expected = SPIN_FREE;
+                if (__atomic_compare_exchange_n((uint32_t *)lock, &expected,
+                                                SPIN_LOCKED, 0,
+                                                __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+                    return (0);
+                }
+            }
+        }
+        backoff <<= 1;
+    }
+
+    /* Long wait: park in the kernel instead of burning a core. Taking
+     * the lock from here leaves it CONTENDED because other waiters may
+     * still be parked behind us.
+     */
+    for (;;) {
+        if (__atomic_exchange_n((uint32_t *)lock, SPIN_CONTENDED,
+                                __ATOMIC_ACQUIRE) == SPIN_FREE) {
+            return (0);
+        }
+        futex(lock, FUTEX_WAIT_PRIVATE, SPIN_CONTENDED);
     }
-    return (0);
 }
 
 uint32_t sgx_spin_unlock(sgx_spinlock_t *lock)
 {
-    *lock = 0;
+    if (__atomic_exchange_n((uint32_t *)lock, SPIN_FREE,
+                            __ATOMIC_RELEASE) == SPIN_CONTENDED) {
+        futex(lock, FUTEX_WAKE_PRIVATE, 1);
+    }
     return (0);
 }
-
@@ -18,23 +18,179 @@
 #include <sched.h>
 #include <time.h>
 #include <errno.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <unistd.h>
 
-int  u_sched_yield_ocall(int *error) 
+#define YIELD_STORM_THRESHOLD   16
+#define YIELD_STORM_WINDOW_NS   10000000LL  /* 10ms gap resets the streak */
+#define YIELD_BACKOFF_BASE_NS   50000L      /* 50us */
+#define YIELD_BACKOFF_MAX_NS    1000000L    /* 1ms cap */
+
+static inline int64_t yield_now_ns(void)
+{
+    struct timespec ts;
+    if (clock_gettime(CLOCK_MONOTONIC_COARSE, &ts) != 0) {
+        return 0;
+    }
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/*
+ * A thread stuck behind a held enclave lock re-enters this ocall in a tight
+ * loop, and a plain sched_yield() storm just burns cycles when the runqueue
+ * is empty. Track consecutive yields per untrusted thread: short streaks
+ * keep the cheap sched_yield, long ones escalate to a capped exponential
+ * nanosleep so the lock holder gets a real chance to run.
+ */
+int  u_sched_yield_ocall(int *error)
 {
-    int ret = sched_yield();
+    static __thread int64_t last_yield_ns = 0;
+    static __thread uint32_t yield_streak = 0;
+    int ret;
+
+    int64_t now = yield_now_ns();
+    if (now - last_yield_ns > YIELD_STORM_WINDOW_NS) {
+        yield_streak = 0;
+    }
+    last_yield_ns = now;
+
+    if (yield_streak < YIELD_STORM_THRESHOLD) {
+        yield_streak++;
+        ret = sched_yield();
+    } else {
+        uint32_t shift = yield_streak - YIELD_STORM_THRESHOLD;
+        if (shift > 4) {
+            shift = 4;
+        } else {
+            yield_streak++;
+        }
+        long backoff = YIELD_BACKOFF_BASE_NS << shift;
+        if (backoff > YIELD_BACKOFF_MAX_NS) {
+            backoff = YIELD_BACKOFF_MAX_NS;
+        }
+        struct timespec req = { 0, backoff };
+        ret = nanosleep(&req, NULL);
+    }
     if (error) {
         *error = ret == -1 ? errno : 0;
     }
     return ret;
 }
 
-int u_nanosleep_ocall(int *error, const struct timespec *req, struct timespec *rem) 
+#define SLEEP_COALESCE_QUANTUM_NS   500000LL   /* align wakeups on 500us edges */
+#define SLEEP_COALESCE_MIN_NS       2000000LL  /* leave short sleeps precise */
+
+/*
+ * Round longer sleeps up to a shared absolute-deadline quantum so timers
+ * armed close together by different enclave threads expire on the same
+ * tick and are serviced by one kernel timer interrupt instead of many.
+ * The rounding only ever lengthens a sleep, which nanosleep already
+ * permits, and sub-2ms requests are passed through untouched.
+ */
+int u_nanosleep_ocall(int *error, const struct timespec *req, struct timespec *rem)
 {
-    int ret = nanosleep(req, rem);
+    int ret;
+    struct timespec now;
+
+    int64_t req_ns = req ? (int64_t)req->tv_sec * 1000000000LL + req->tv_nsec : 0;
+    if (req_ns >= SLEEP_COALESCE_MIN_NS &&
+        clock_gettime(CLOCK_MONOTONIC, &now) == 0) {
+        int64_t deadline = (int64_t)now.tv_sec * 1000000000LL + now.tv_nsec + req_ns;
+        deadline += SLEEP_COALESCE_QUANTUM_NS - 1;
+        deadline -= deadline % SLEEP_COALESCE_QUANTUM_NS;
+
+        struct timespec abs_req = { deadline / 1000000000LL, deadline % 1000000000LL };
+        ret = clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &abs_req, NULL);
+        if (ret != 0) {
+            errno = ret;
+            if (ret == EINTR && rem != NULL &&
+                clock_gettime(CLOCK_MONOTONIC, &now) == 0) {
+                int64_t left = deadline - ((int64_t)now.tv_sec * 1000000000LL + now.tv_nsec);
+                if (left < 0) {
+                    left = 0;
+                }
+                rem->tv_sec = left / 1000000000LL;
+                rem->tv_nsec = left % 1000000000LL;
+            }
+            ret = -1;
+        }
+    } else {
+        ret = nanosleep(req, rem);
+    }
     if (error) {
         *error = ret == -1 ? errno : 0;
     }
-    return ret;          
+    return ret;
 }
 
 
+
+static int read_topology_id(const char *fmt, size_t cpu, uint32_t *value)
+{
+    char path[128];
+    FILE *f;
+    unsigned int v = 0;
+    int ok;
+
+    snprintf(path, sizeof(path), fmt, cpu);
+    f = fopen(path, "r");
+    if (f == NULL) {
+        return -1;
+    }
+    ok = fscanf(f, "%u", &v) == 1;
+    fclose(f);
+    if (!ok) {
+        return -1;
+    }
+    *value = (uint32_t)v;
+    return 0;
+}
+
+/*
+ * The scheduler is free to bounce the host threads backing enclave TCSs
+ * across sockets and L3 domains, and a partitioned enclave that shards
+ * its state per worker pays for that in cross-domain cache traffic.
+ * Expose the package and last-level-cache id of every CPU so the
+ * trusted side can size its shards to the machine and ask (via
+ * sched_setaffinity) for its backing threads to be pinned accordingly.
+ * Returns the number of configured CPUs; the arrays are filled up to
+ * min(count, ncpu). A CPU without an exposed L3 id inherits its
+ * package id, which keeps the grouping meaningful on older kernels.
+ */
+long u_get_cpu_topology_ocall(int *error, uint32_t *package_ids, uint32_t *l3_ids, size_t count)
+{
+    long ncpu = sysconf(_SC_NPROCESSORS_CONF);
+    if (ncpu < 0) {
+        if (error) {
+            *error = errno;
+        }
+        return -1;
+    }
+
+    size_t fill = (size_t)ncpu < count ? (size_t)ncpu : count;
+    for (size_t cpu = 0; cpu < fill; cpu++) {
+        uint32_t package = 0;
+        uint32_t l3 = 0;
+
+        if (read_topology_id("/sys/devices/system/cpu/cpu%zu/topology/physical_package_id",
+                             cpu, &package) != 0) {
+            package = 0;
+        }
+        if (read_topology_id("/sys/devices/system/cpu/cpu%zu/cache/index3/id",
+                             cpu, &l3) != 0) {
+            l3 = package;
+        }
+        if (package_ids) {
+            package_ids[cpu] = package;
+        }
+        if (l3_ids) {
+            l3_ids[cpu] = l3;
+        }
+    }
+    if (error) {
+        *error = 0;
+    }
+    return ncpu;
+}
@@ -18,6 +18,8 @@
 #include <stdio.h>
 #include <time.h>
 #include <errno.h>
+#include <stdint.h>
+#include <pthread.h>
 
 int u_clock_gettime_ocall(int *error, clockid_t clk_id, struct timespec *tp)
 {
@@ -26,4 +28,75 @@ int u_clock_gettime_ocall(int *error, clockid_t clk_id, struct timespec *tp)
         *error = ret == -1 ? errno : 0;
     }
     return ret;
+}
+
+/* Shared time page. A ticker thread refreshes it at a fixed interval
+ * and the trusted side reads it without any enclave transition, so a
+ * hot timestamping path costs two loads instead of an ocall. The
+ * generation counter is a seqlock: odd while an update is in flight,
+ * and a reader whose two generation reads differ must retry (or take
+ * the precise u_clock_gettime_ocall path).
+ */
+struct sgx_time_page {
+    volatile uint64_t generation;
+    volatile int64_t real_sec;
+    volatile int64_t real_nsec;
+    volatile int64_t mono_sec;
+    volatile int64_t mono_nsec;
+} __attribute__((aligned(64)));
+
+static struct sgx_time_page g_time_page __attribute__((aligned(64)));
+static pthread_once_t g_ticker_once = PTHREAD_ONCE_INIT;
+static uint64_t g_ticker_interval_ns = 1000000;
+static int g_ticker_rc = 0;
+
+static void *time_ticker(void *arg)
+{
+    (void)arg;
+    struct timespec real;
+    struct timespec mono;
+    struct timespec interval;
+    interval.tv_sec = (time_t)(g_ticker_interval_ns / 1000000000ULL);
+    interval.tv_nsec = (long)(g_ticker_interval_ns % 1000000000ULL);
+
+    for (;;) {
+        clock_gettime(CLOCK_REALTIME, &real);
+        clock_gettime(CLOCK_MONOTONIC, &mono);
+
+        uint64_t gen = g_time_page.generation;
+        __atomic_store_n(&g_time_page.generation, gen + 1, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+        g_time_page.real_sec = real.tv_sec;
+        g_time_page.real_nsec = real.tv_nsec;
+        g_time_page.mono_sec = mono.tv_sec;
+        g_time_page.mono_nsec = mono.tv_nsec;
+        __atomic_store_n(&g_time_page.generation, gen + 2, __ATOMIC_RELEASE);
+
+        nanosleep(&interval, NULL);
+    }
+    return NULL;
+}
+
+static void start_time_ticker(void)
+{
+    pthread_t tid;
+    pthread_attr_t attr;
+
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    g_ticker_rc = pthread_create(&tid, &attr, time_ticker, NULL);
+    pthread_attr_destroy(&attr);
+}
+
+void *u_time_page_ocall(int *error, uint64_t interval_ns)
+{
+    if (interval_ns > 0) {
+        /* First caller wins; later callers share its tick rate. */
+        g_ticker_interval_ns = interval_ns;
+    }
+    pthread_once(&g_ticker_once, start_time_ticker);
+    if (error) {
+        *error = g_ticker_rc;
+    }
+    return g_ticker_rc == 0 ? (void *)&g_time_page : NULL;
 }
\ No newline at end of file